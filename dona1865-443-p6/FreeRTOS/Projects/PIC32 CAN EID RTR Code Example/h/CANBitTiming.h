@@ -0,0 +1,75 @@
+/* ********************* CANBitTiming.h ********************************
+ * Processor:   PIC32
+ * Compiler:    MPLAB XC32
+ *
+ * Description: CAN bit timing solver. Selects the number of time quanta
+ *              and the segment lengths for a bit rate so that the
+ *              propagation segment covers the bus round trip delay and the
+ *              sample point is as close as possible to the target.
+ *********************************************************************/
+
+#ifndef _CAN_BIT_TIMING_H_
+    #define _CAN_BIT_TIMING_H_
+
+/* Limits of the PIC32 CAN bit time. A bit is 8 to 25 TQ made of the 1 TQ
+ * sync segment, 1 to 8 TQ propagation segment, 1 to 8 TQ phase segment 1
+ * and 2 to 8 TQ phase segment 2. The prescaler gives
+ * FTQ = SYSTEM_FREQ / (2 * (BRP + 1)) with BRP 0 to 63. */
+    #define CAN_MIN_BIT_TQ          8
+    #define CAN_MAX_BIT_TQ          25
+    #define CAN_MAX_SEGMENT_TQ      8
+    #define CAN_MIN_PHASE1_TQ       2   /* Room for three time sampling */
+    #define CAN_MIN_PHASE2_TQ       2   /* Information processing time */
+    #define CAN_MAX_SJW_TQ          4
+    #define CAN_MAX_BRP             63
+
+/* Signal propagation delay on the bus cable in ns per meter. */
+    #define CAN_CABLE_DELAY_NS_PER_M    5
+
+/* Bit rates up to this value use three time sampling. */
+    #define CAN_SAMPLE3_MAX_BIT_RATE    250000
+
+/* Bit timing selected by CANSolveBitTiming. Segment lengths are in TQ. The
+ * prescaler is not part of it, since CANSetSpeed derives BRP from the
+ * segment lengths, the system clock and the bit rate. */
+    typedef struct
+    {
+        BYTE totalTq;           /* TQ per bit including the sync segment */
+        BYTE propagationTq;
+        BYTE phase1Tq;
+        BYTE phase2Tq;
+        BYTE syncJumpWidthTq;
+        BOOL sample3Time;       /* TRUE to sample the bus three times */
+        WORD samplePoint;       /* Sample point in tenths of a percent */
+    } CAN_BIT_TIMING;
+#endif
+
+/****************************************************************************
+ * Function:    BOOL CANSolveBitTiming(UINT32 sysFreq, UINT32 bitRate,
+ *                                     WORD busLength, WORD transceiverDelay,
+ *                                     WORD samplePoint,
+ *                                     CAN_BIT_TIMING *timing);
+ *
+ * Description:
+ *   This function enumerates every bit time of 8 to 25 TQ that divides
+ *   sysFreq exactly into bitRate, and every segment split that meets the
+ *   PIC32 limits. The propagation segment must cover the round trip of the
+ *   bus length and transceiver delay. Of the valid settings the one with
+ *   the sample point closest to samplePoint is selected. Ties are broken by
+ *   the larger number of TQ, which gives the finest resynchronization.
+ *
+ * Precondition:    None.
+ * Parameters:      sysFreq          - system clock frequency in Hz.
+ *                  bitRate          - target CAN bit rate in bits/s.
+ *                  busLength        - bus length in meters.
+ *                  transceiverDelay - transceiver Tx to Rx loop delay in ns.
+ *                  samplePoint      - target sample point in tenths of a
+ *                                     percent, for example 875.
+ *                  timing           - receives the selected bit timing.
+ * Return Values:   TRUE if a valid bit timing was found, else FALSE.
+ * Remarks:         None.
+ * Example:    CANSolveBitTiming(SYSTEM_FREQ, 500000, 10, 150, 875, &timing);
+ ***************************************************************************/
+BOOL CANSolveBitTiming(UINT32 sysFreq, UINT32 bitRate, WORD busLength,
+                       WORD transceiverDelay, WORD samplePoint,
+                       CAN_BIT_TIMING *timing);
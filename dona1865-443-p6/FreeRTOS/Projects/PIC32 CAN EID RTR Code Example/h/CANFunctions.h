@@ -13,25 +13,126 @@
 
     #define CAN_BUS_SPEED 250000
 
-/* This is the CAN1 FIFO message area.	 * Note the size of CAN1 message area.
- * It is 2 (Channels)*8 (Messages Buffers) 16 (bytes/per message buffer) bytes.
- */
-    #define CAN1_CHANNELS       2
-    #define CAN1_FIFO_BUFFERS   8
-    #define CAN1_MSG_BUFF_SIZE  16
-    #define CAN1_MSG_MEMORY  CAN1_CHANNELS*CAN1_FIFO_BUFFERS*CAN1_MSG_BUFF_SIZE
+/* Physical bus parameters used by CANSolveBitTiming to select the bit
+ * timing for CAN_BUS_SPEED. The bus length is in meters, the transceiver
+ * Tx to Rx loop delay is in ns and the sample point is in tenths of a
+ * percent. */
+    #define CAN_BUS_LENGTH          10
+    #define CAN_TRANSCEIVER_DELAY   150
+    #define CAN_SAMPLE_POINT        875
+
+/* Message buffer sizes. A Tx buffer and a full receive Rx buffer hold the
+ * 8 byte ID header and 8 data bytes. An Rx channel configured with
+ * CAN_RX_DATA_ONLY stores only the 8 data bytes. */
+    #define CAN_MSG_BUFF_SIZE           16
+    #define CAN_DATA_ONLY_BUFF_SIZE     8
+
+/* Limits of the PIC32 CAN module. */
+    #define CAN_MAX_CHANNELS            32
+    #define CAN_MAX_FIFO_BUFFERS        32
+
+/* Helpers applied to a channel layout list. Each list entry is
+ * CH(direction, buffers, bytes per buffer) and entries are in channel number
+ * order starting with channel 0, since the CAN module places the channels
+ * in the message area in that order. Only an Rx channel can use data-only
+ * buffers; a Tx buffer always holds the ID header. */
+    #define CAN_LAYOUT_TX   1
+    #define CAN_LAYOUT_RX   0
+
+    #define CAN_LAYOUT_BYTES(dir, buffers, size)    + ((buffers) * (size))
+    #define CAN_LAYOUT_COUNT(dir, buffers, size)    + 1
+    #define CAN_LAYOUT_INVALID(dir, buffers, size)  || ((buffers) < 1)    \
+                                || ((buffers) > CAN_MAX_FIFO_BUFFERS)     \
+                                || (((size) != CAN_MSG_BUFF_SIZE)         \
+                                 && (((dir) == CAN_LAYOUT_TX)             \
+                                  || ((size) != CAN_DATA_ONLY_BUFF_SIZE)))
+
+/* CAN1 channel sizing. Set the number of message buffers (1 to 32) for each
+ * channel. Set CAN1_RX_DATA_ONLY to 1 to store only the payload of received
+ * messages, which halves the size of the Rx channel. This is allowed here
+ * because filter 0 accepts a single ID, so the header is not needed. */
+    #define CAN1_TX_URGENT_BUFFERS  8
+    #define CAN1_RX_BUFFERS         8
+    #define CAN1_TX_NORMAL_BUFFERS  8
+    #define CAN1_TX_BULK_BUFFERS    8
+    #define CAN1_RX_DATA_ONLY       0
+
+    #if CAN1_RX_DATA_ONLY
+        #define CAN1_RX_BUFF_SIZE   CAN_DATA_ONLY_BUFF_SIZE
+    #else
+        #define CAN1_RX_BUFF_SIZE   CAN_MSG_BUFF_SIZE
+    #endif
+
+/* This is the CAN1 FIFO message area. Its size is computed from the layout
+ * list below, one entry for each of channels 0 to 3. */
+    #define CAN1_CHANNEL_LAYOUT(CH)                             \
+        CH(CAN_LAYOUT_TX, CAN1_TX_URGENT_BUFFERS, CAN_MSG_BUFF_SIZE)    \
+        CH(CAN_LAYOUT_RX, CAN1_RX_BUFFERS, CAN1_RX_BUFF_SIZE)           \
+        CH(CAN_LAYOUT_TX, CAN1_TX_NORMAL_BUFFERS, CAN_MSG_BUFF_SIZE)    \
+        CH(CAN_LAYOUT_TX, CAN1_TX_BULK_BUFFERS, CAN_MSG_BUFF_SIZE)
+
+    #define CAN1_CHANNELS       (0 CAN1_CHANNEL_LAYOUT(CAN_LAYOUT_COUNT))
+    #define CAN1_MSG_MEMORY     (0 CAN1_CHANNEL_LAYOUT(CAN_LAYOUT_BYTES))
+
+    #if CAN1_CHANNELS > CAN_MAX_CHANNELS
+        #error "CAN1 layout has more than 32 channels"
+    #endif
+    #if 0 CAN1_CHANNEL_LAYOUT(CAN_LAYOUT_INVALID)
+        #error "CAN1 layout has an invalid buffer count or buffer size"
+    #endif
+
     BYTE CAN1MessageFifoArea[CAN1_MSG_MEMORY];
 
-/* This is the CAN2 FIFO message area. Note: the size of CAN2 message area.
- * It is 1 (Channel) * 8 (Messages Buffers * 16 (bytes/per message buffer)
- * bytes.
- */
-    #define CAN2_CHANNELS       1
-    #define CAN2_FIFO_BUFFERS   8
-    #define CAN2_MSG_BUFF_SIZE  16
-    #define CAN2_MSG_MEMORY  CAN2_CHANNELS*CAN2_FIFO_BUFFERS*CAN2_MSG_BUFF_SIZE
+/* CAN2 channel sizing. Channel 0 is the RTR enabled Tx channel. */
+    #define CAN2_TX_RTR_BUFFERS     8
+
+/* This is the CAN2 FIFO message area. Its size is computed from the layout
+ * list below, one entry for channel 0. */
+    #define CAN2_CHANNEL_LAYOUT(CH)                             \
+        CH(CAN_LAYOUT_TX, CAN2_TX_RTR_BUFFERS, CAN_MSG_BUFF_SIZE)
+
+    #define CAN2_CHANNELS       (0 CAN2_CHANNEL_LAYOUT(CAN_LAYOUT_COUNT))
+    #define CAN2_MSG_MEMORY     (0 CAN2_CHANNEL_LAYOUT(CAN_LAYOUT_BYTES))
+
+    #if CAN2_CHANNELS > CAN_MAX_CHANNELS
+        #error "CAN2 layout has more than 32 channels"
+    #endif
+    #if 0 CAN2_CHANNEL_LAYOUT(CAN_LAYOUT_INVALID)
+        #error "CAN2 layout has an invalid buffer count or buffer size"
+    #endif
+
     BYTE CAN2MessageFifoArea[CAN2_MSG_MEMORY];
 
+/* CAN1 channel assignment. Channel 1 is the receive channel. Each transmit
+ * class has its own Tx channel with a distinct hardware priority so that
+ * urgent control frames win internal arbitration over queued bulk frames. */
+    #define CAN1_TX_URGENT_CHANNEL  CAN_CHANNEL0
+    #define CAN1_RX_CHANNEL         CAN_CHANNEL1
+    #define CAN1_TX_NORMAL_CHANNEL  CAN_CHANNEL2
+    #define CAN1_TX_BULK_CHANNEL    CAN_CHANNEL3
+
+/* CAN1 transmit classes used by CAN1TxPostMsg, highest priority first. */
+    typedef enum
+    {
+        CAN1_TX_URGENT = 0,     /* Control frames, CAN_HIGHEST_PRIORITY */
+        CAN1_TX_NORMAL,         /* Requests and status, CAN_HIGH_MEDIUM_PRIORITY */
+        CAN1_TX_BULK,           /* Telemetry, CAN_LOWEST_PRIORITY */
+        CAN1_TX_CLASSES
+    } CAN1_TX_CLASS;
+
+/* Deadlines in ms that select the transmit class of a CAN1 message. The
+ * classes are assigned deadline monotonic: a message with a shorter
+ * deadline is posted in a higher priority class. Within a class messages
+ * are sent in the order posted, since the buffers of a channel are a
+ * hardware FIFO. */
+    #define CAN1_TX_URGENT_DEADLINE_MS  10
+    #define CAN1_TX_NORMAL_DEADLINE_MS  100
+
+    #define CAN1_TX_CLASS_FOR_DEADLINE(ms)                              \
+        (((ms) <= CAN1_TX_URGENT_DEADLINE_MS) ? CAN1_TX_URGENT :        \
+         ((ms) <= CAN1_TX_NORMAL_DEADLINE_MS) ? CAN1_TX_NORMAL :        \
+                                                CAN1_TX_BULK)
+
     #define SID_BIT_MASK      0x07FF    /* Bit masking for generating SID */
     #define EID_BIT_MASK      0x03FFFF  /* Bit masking for generating EID */
 
@@ -49,8 +150,9 @@
  * 
  * Description:
  *   This function initializes CAN1 module. It sets up speed, FIFOs,
- *   filters and interrupts. FIFO0 is set up for TX with 8 message
- *   buffers. FIFO1 is set up for RX with 8 message buffers. Filter 0
+ *   filters and interrupts. FIFO0, FIFO2 and FIFO3 are set up for TX with 8
+ *   message buffers at highest, high medium and lowest priority.
+ *   FIFO1 is set up for RX with 8 message buffers. Filter 0
  *   is set with Mask 0 for EID LED1_INDICATION_MSG. Only RXNEMPTY interrupt and
  * RBIF interrupt is enabled.
  * Precondition:    None.
@@ -110,6 +212,23 @@ void CAN1RxMsgProcess(void);
  ***************************************************************************/
  void CAN2UpdateLEDMessage(BYTE led1Indication);
 
+/****************************************************************************
+ * Function:         void CAN2PublishLEDMessage(BYTE led1Indication);
+ * Description:
+ *  This function posts the latest led1Indication value as the RTR response
+ *  message in CAN2 FIFO0. Unlike CAN2UpdateLEDMessage, an unread message
+ *  that is still pending in the channel is discarded and replaced with the
+ *  new value so that the next RTR reply always carries the newest sample.
+ *
+ * Precondition:  CAN2Init must have been called.
+ * Parameters:    led1Indication - 1 to switch on LED4, 0 to switch it off.
+ * Return Values: None.
+ * Remarks:       LEDA toggles when the channel was empty, LEDB toggles when
+ *                a stale message was replaced.
+ * Example:  CAN2PublishLEDMessage(led1Indication);
+ ***************************************************************************/
+ void CAN2PublishLEDMessage(BYTE led1Indication);
+
 /****************************************************************************
  * Function: void CAN1TxSendRTRMsg(void);
  *
@@ -126,4 +245,45 @@ void CAN1RxMsgProcess(void);
  ***************************************************************************/
 void CAN1TxSendRTRMsg(void);
 
+/****************************************************************************
+ * Function: BOOL CAN1TxPostMsg(CAN1_TX_CLASS txClass, UINT32 eid, BOOL isRTR,
+ *                              const BYTE *data, BYTE dlc);
+ *
+ * Description:
+ *   This function places an extended ID message in the CAN1 Tx channel
+ *   assigned to txClass. The message is not sent until CAN1TxFlush is
+ *   called, so several messages can be posted and flushed together. Use
+ *   CAN1_TX_CLASS_FOR_DEADLINE to select the class from the deadline of
+ *   the message.
+ *
+ * Precondition:    CAN1Init must have been called.
+ * Parameters:      txClass - transmit class that selects the Tx channel.
+ *                  eid     - 29 bit extended ID.
+ *                  isRTR   - TRUE to send a remote transmit request.
+ *                  data    - payload, may be NULL when dlc is 0.
+ *                  dlc     - payload length, 0 to 8 bytes.
+ * Return Values:   TRUE if the message was posted, FALSE if the channel
+ *                  is full.
+ * Remarks:         None.
+ * Example:    CAN1TxPostMsg(CAN1_TX_URGENT, CAN2_MSG_ID, TRUE, NULL, 0);
+ ***************************************************************************/
+BOOL CAN1TxPostMsg(CAN1_TX_CLASS txClass, UINT32 eid, BOOL isRTR,
+                   const BYTE *data, BYTE dlc);
+
+/****************************************************************************
+ * Function: void CAN1TxFlush(void);
+ *
+ * Description:
+ *   This function flushes every CAN1 Tx channel that has messages posted
+ *   since the last flush. The CAN module then transmits the pending
+ *   messages of the highest priority channel first.
+ *
+ * Precondition:    CAN1Init must have been called.
+ * Parameters:      None.
+ * Return Values:   None.
+ * Remarks:         None.
+ * Example:    CAN1TxFlush();
+ ***************************************************************************/
+void CAN1TxFlush(void);
+
 /* End of CANFunctions.h*/
@@ -0,0 +1,119 @@
+/* ********************* CANLogger.h ***********************************
+ * Processor:   PIC32MX7
+ * Compiler:    MPLAB XC32
+ *
+ * Description: CAN traffic logger. Transmitted and received frames are
+ *              recorded with a time stamp in a RAM ring buffer using a
+ *              compact delta encoded format. When the buffer is full the
+ *              oldest records are discarded. The log is copied out with
+ *              CANLogExport and decoded on a host with tools/CANLogTool.c.
+ *********************************************************************/
+
+#ifndef _CAN_LOGGER_H_
+    #define _CAN_LOGGER_H_
+
+/* Set CAN_LOG_ENABLE to 0 to remove the logger. The logging calls then
+ * expand to nothing. */
+    #define CAN_LOG_ENABLE      1
+
+/* Size of the ring buffer in bytes. Must be a power of 2 no larger than
+ * 32768. */
+    #define CAN_LOG_SIZE        2048
+
+/* Export format, all multi byte fields are little endian:
+ *
+ *  Header  4 bytes     CAN_LOG_MAGIC
+ *          4 bytes     base time in us from the core timer. The delta of
+ *                      the first record is relative to this time.
+ *          2 bytes     record bytes that follow the header
+ *          2 bytes     records discarded because the buffer was full
+ *
+ *  Record  1 byte      flags, CAN_LOG_FLAG_x bits and the DLC in bits 0-3
+ *          1 byte      FIFO level, messages in the channel after the frame
+ *                      was posted or before it was read
+ *          varint      time since the previous record in us
+ *          varint      message ID, 11 or 29 bits
+ *          DLC bytes   payload, absent for RTR frames
+ *
+ * A varint holds 7 bits per byte, least significant group first. Bit 7 is
+ * set in every byte except the last. */
+    #define CAN_LOG_MAGIC           "CLG1"
+    #define CAN_LOG_HEADER_SIZE     12
+
+    #define CAN_LOG_FLAG_TX         0x80    /* Set for Tx, clear for Rx */
+    #define CAN_LOG_FLAG_EXT        0x40    /* 29 bit ID */
+    #define CAN_LOG_FLAG_RTR        0x20    /* Remote transmit request */
+    #define CAN_LOG_FLAG_CAN2       0x10    /* CAN2 module, clear for CAN1 */
+    #define CAN_LOG_DLC_MASK        0x0F
+
+/* Longest record: flags, level, 5 byte time varint, 5 byte ID varint and
+ * 8 data bytes. */
+    #define CAN_LOG_MAX_RECORD      20
+
+    #if (CAN_LOG_SIZE & (CAN_LOG_SIZE - 1)) || (CAN_LOG_SIZE > 32768)
+        #error "CAN_LOG_SIZE must be a power of 2 no larger than 32768"
+    #endif
+#endif
+
+#if CAN_LOG_ENABLE
+/****************************************************************************
+ * Function:    void CANLogInit(void);
+ *
+ * Description:
+ *   This function empties the log and sets the base time to the current
+ *   core timer value.
+ *
+ * Precondition:    None.
+ * Parameters:      None.
+ * Return Values:   None.
+ * Remarks:         None.
+ ***************************************************************************/
+void CANLogInit(void);
+
+/****************************************************************************
+ * Function:    void CANLogFrame(BYTE flags, UINT32 id, BYTE dlc,
+ *                               const BYTE *data, BYTE fifoLevel);
+ *
+ * Description:
+ *   This function appends a frame record time stamped with the core timer.
+ *   The oldest records are discarded to make room when the log is full.
+ *
+ * Precondition:    CANLogInit must have been called.
+ * Parameters:      flags     - CAN_LOG_FLAG_x bits of the frame.
+ *                  id        - 11 or 29 bit message ID.
+ *                  dlc       - data length code, 0 to 8.
+ *                  data      - payload, not used for RTR frames.
+ *                  fifoLevel - messages in the channel.
+ * Return Values:   None.
+ * Remarks:         Records must be less than 107 seconds apart, the wrap
+ *                  period of the core timer, to keep their time stamps.
+ *                  Interrupts are disabled while the record is written so
+ *                  this function may also be called from an ISR.
+ * Example:    CANLogFrame(CAN_LOG_FLAG_TX | CAN_LOG_FLAG_EXT, eid, 1,
+ *                         data, 1);
+ ***************************************************************************/
+void CANLogFrame(BYTE flags, UINT32 id, BYTE dlc, const BYTE *data,
+                 BYTE fifoLevel);
+
+/****************************************************************************
+ * Function:    WORD CANLogExport(BYTE *dest, WORD size);
+ *
+ * Description:
+ *   This function copies the header and the records, oldest first, to
+ *   dest. The log is not changed. The copy can be sent over a serial link
+ *   or saved from the debugger as a binary file for CANLogTool.
+ *
+ * Precondition:    CANLogInit must have been called.
+ * Parameters:      dest - destination buffer.
+ *                  size - size of dest, CAN_LOG_HEADER_SIZE + CAN_LOG_SIZE
+ *                         bytes always holds the whole log.
+ * Return Values:   Number of bytes written, 0 if dest is too small.
+ * Remarks:         None.
+ ***************************************************************************/
+WORD CANLogExport(BYTE *dest, WORD size);
+#else
+    #define CANLogInit()
+    #define CANLogFrame(flags, id, dlc, data, fifoLevel)
+#endif
+
+/* End of CANLogger.h */
@@ -0,0 +1,36 @@
+/* ********************* tt_scheduler.h *******************************
+ * Processor:   PIC32MX7
+ * Platform:    Digilent chipKIT Pro MX7
+ *
+ * Description: Time triggered cyclic scheduler driven by the core timer
+ *              compare interrupt. Tasks are listed in a schedule table
+ *              with a period and an offset in minor cycles. The CPU waits
+ *              in idle mode between minor cycles.
+ *********************************************************************/
+#ifndef __TT_SCHEDULER
+    #define __TT_SCHEDULER
+
+/* Length of one minor cycle in milliseconds. */
+    #define TT_MINOR_CYCLE_MS   100
+
+/* Core timer counts per minor cycle. */
+    #define TT_CORE_TICKS       (CORE_MS_TICK_RATE * TT_MINOR_CYCLE_MS)
+
+/* A task is run in every minor cycle n where n % period == offset. */
+    typedef struct
+    {
+        void (*task)(void);     /* Function to run in the slot */
+        unsigned int period;    /* Period in minor cycles, at least 1 */
+        unsigned int offset;    /* First minor cycle, less than period */
+    } TT_TASK_ENTRY;
+
+/* Length of the major cycle in minor cycles. Every task period must divide
+ * it so that the schedule repeats exactly. */
+    #define TT_MAJOR_CYCLE      10
+#endif
+
+void TTSchedulerInit(void);
+void TTSchedulerRun(const TT_TASK_ENTRY *table, unsigned int tasks,
+                    void (*background)(void));
+
+/* End of tt_scheduler.h */
@@ -0,0 +1,133 @@
+/*  CANBitTiming.c
+ *
+ *  Processor:  PIC32
+ *  Compiler:   MPLAB XC32
+ *
+ *  CAN bit timing solver. The PIC32 CAN peripheral library CANSetSpeed
+ *  function computes the baud rate prescaler from the segment lengths in
+ *  CAN_BIT_CONFIG. This module selects those segment lengths for the bit
+ *  rate, bus length and transceiver delay so that faster bus speeds can be
+ *  used without hand tuning the bit timing.
+ *
+ *  This module has no peripheral dependencies.
+*/
+
+#include "GenericTypeDefs.h"
+#include "CANBitTiming.h"
+
+/* CANSolveBitTiming Function Description *************************************
+ * SYNTAX:          BOOL CANSolveBitTiming(UINT32 sysFreq, UINT32 bitRate,
+ *                                  WORD busLength, WORD transceiverDelay,
+ *                                  WORD samplePoint, CAN_BIT_TIMING *timing);
+ * KEYWORDS:        CAN, bit timing, baud rate, sample point
+ * DESCRIPTION:     For each bit time of N TQ the prescaler is
+ *                  sysFreq / (2 * N * bitRate) - 1 and must be exact. The
+ *                  bus round trip delay of 2 * (busLength * 5ns +
+ *                  transceiverDelay) sets the minimum propagation segment.
+ *                  The remaining TQ are split between the phase segments
+ *                  and the split with the sample point nearest samplePoint
+ *                  is kept. The sync jump width is the largest allowed by
+ *                  both phase segments.
+ * PARAMETER1:      sysFreq - system clock frequency in Hz
+ * PARAMETER2:      bitRate - target bit rate in bits/s
+ * PARAMETER3:      busLength - bus length in meters
+ * PARAMETER4:      transceiverDelay - transceiver loop delay in ns
+ * PARAMETER5:      samplePoint - target sample point in tenths of a percent
+ * PARAMETER6:      timing - receives the selected bit timing
+ * RETURN VALUE:    TRUE if a valid bit timing was found, else FALSE
+ * Notes:           timing is not modified when FALSE is returned.
+ * END DESCRIPTION ************************************************************/
+BOOL CANSolveBitTiming(UINT32 sysFreq, UINT32 bitRate, WORD busLength,
+                       WORD transceiverDelay, WORD samplePoint,
+                       CAN_BIT_TIMING *timing)
+{
+UINT32 roundTripNs;
+UINT32 divisor;
+UINT32 propMin;
+UINT32 bestError = 0xFFFFFFFF;
+UINT32 error;
+WORD point;
+BYTE n, prop, phase1, phase2, sjw;
+BOOL found = FALSE;
+
+    if((bitRate == 0) || (timing == NULL))
+    {
+        return FALSE;
+    }
+
+    roundTripNs = 2 * ((UINT32) busLength * CAN_CABLE_DELAY_NS_PER_M
+                        + transceiverDelay);
+
+    for(n = CAN_MIN_BIT_TQ; n <= CAN_MAX_BIT_TQ; n++)
+    {
+/* The prescaler must divide the system clock exactly, otherwise the bit rate
+ * differs from the other nodes on the bus. */
+        divisor = 2 * (UINT32) n * bitRate;
+        if((sysFreq % divisor) != 0)
+        {
+            continue;
+        }
+        if(((sysFreq / divisor) == 0)
+            || ((sysFreq / divisor) - 1 > CAN_MAX_BRP))
+        {
+            continue;
+        }
+
+/* TQ length is 1 / (n * bitRate) s. Round the propagation segment up so
+ * that it covers the whole round trip delay. */
+        propMin = (UINT32) (((UINT64) roundTripNs * n * bitRate
+                                + 999999999ULL) / 1000000000ULL);
+        if(propMin == 0)
+        {
+            propMin = 1;
+        }
+
+        for(prop = propMin; prop <= CAN_MAX_SEGMENT_TQ; prop++)
+        {
+            for(phase2 = CAN_MIN_PHASE2_TQ; phase2 <= CAN_MAX_SEGMENT_TQ;
+                phase2++)
+            {
+                if(n < 1 + prop + phase2 + CAN_MIN_PHASE1_TQ)
+                {
+                    break;
+                }
+                phase1 = n - 1 - prop - phase2;
+                if(phase1 > CAN_MAX_SEGMENT_TQ)
+                {
+                    continue;
+                }
+
+                point = (WORD) ((1000 * (UINT32) (n - phase2)) / n);
+                error = (point > samplePoint) ? (point - samplePoint)
+                                              : (samplePoint - point);
+                sjw = (phase1 < phase2) ? phase1 : phase2;
+                if(sjw > CAN_MAX_SJW_TQ)
+                {
+                    sjw = CAN_MAX_SJW_TQ;
+                }
+
+/* Keep the setting closest to the target. Since n increases, an equal error
+ * at a later n is preferred for its finer resolution. At the same n an
+ * equal error is resolved in favour of the larger sync jump width. */
+                if((error < bestError) || ((error == bestError)
+                    && ((n > timing->totalTq)
+                        || (sjw > timing->syncJumpWidthTq))))
+                {
+                    bestError = error;
+                    timing->totalTq = n;
+                    timing->propagationTq = prop;
+                    timing->phase1Tq = phase1;
+                    timing->phase2Tq = phase2;
+                    timing->syncJumpWidthTq = sjw;
+                    timing->sample3Time =
+                                    (bitRate <= CAN_SAMPLE3_MAX_BIT_RATE);
+                    timing->samplePoint = point;
+                    found = TRUE;
+                }
+            }
+        }
+    }
+    return found;
+} /* End of CANSolveBitTiming */
+
+/* End of CANBitTiming.c */
@@ -14,15 +14,12 @@
  *
  * Description of operation:
  *
- * CAN1 module  uses FIFO0 for transmit and FIFO1  for receive. Each FIFO
- * will be configured to be 8 messages deep. CAN2 uses FIFO0 as transmit FIFO
- * with RTR enabled. FIFO size is set to 8. CAN module configuration code is
- * in CANFunctions.c
-
- * CAN1 module uses 2 Channels (Channel 0 and Channel 1). Each channel is
- * configured to be 8 messages deep. Channel 0 is configured for Transmit
- * and Channel 1 is configured for receive. CAN module configuration code
- * is in CANFunctions.c
+ * CAN1 module uses 4 Channels (Channel 0 to Channel 3). Each channel is
+ * configured to be 8 messages deep. Channel 1 is configured for receive.
+ * Channels 0, 2 and 3 are configured for Transmit at highest, high medium
+ * and lowest priority and carry the urgent, normal and bulk transmit classes
+ * posted with CAN1TxPostMsg. CAN module configuration code is in
+ * CANFunctions.c
  *
  * CAN2 module uses 1 channel (Channel 0). This channel is configured to be 8
  * messages deep. The channel is configured as a transmit channel and is RTR
@@ -31,7 +28,7 @@
  * application
  *
  * Note the size of CAN1 message area.
- * It is 2 (Channels)*8 (Messages Buffers) 16 (bytes/per message buffer) bytes.
+ * It is 4 (Channels)*8 (Messages Buffers) 16 (bytes/per message buffer) bytes.
  *
  * Note the size of CAN2 message area.
  * It is 1 (Channel) * 8 (Messages Buffers*16 (bytes/per message buffer) bytes.
@@ -41,7 +38,10 @@
 #include "GenericTypeDefs.h"
 #include "sw_timer.h"
 #include "CANFunctions.h"
+#include "CANBitTiming.h"
+#include "CANLogger.h"
 #include "chipKIT_Pro_MX7.h"
+#include "tt_scheduler.h"
 
 /* isCAN1MsgReceived is true if CAN1 FIFO1 received
  * a message. This flag is updated in the CAN1 ISR. */
@@ -54,12 +54,46 @@ static volatile BOOL isCAN1MsgReceived = FALSE;
  * is updated in the CAN2 ISR. */
 static volatile BOOL isCAN2MsgReceived = FALSE;
 
+/* Tx channel used for each CAN1_TX_CLASS. */
+static const CAN_CHANNEL can1TxChannel[CAN1_TX_CLASSES] =
+{
+    CAN1_TX_URGENT_CHANNEL,
+    CAN1_TX_NORMAL_CHANNEL,
+    CAN1_TX_BULK_CHANNEL
+};
+
+/* Bit n of can1TxPending is set when messages of CAN1_TX_CLASS n have been
+ * posted but not yet flushed. */
+static BYTE can1TxPending = 0;
+
+#if CAN_LOG_ENABLE
+/* Number of message buffers in the Tx channel of each CAN1_TX_CLASS. */
+static const BYTE can1TxBuffers[CAN1_TX_CLASSES] =
+{
+    CAN1_TX_URGENT_BUFFERS,
+    CAN1_TX_NORMAL_BUFFERS,
+    CAN1_TX_BULK_BUFFERS
+};
+#endif
+
+/* Private function prototypes */
+static void CAN2LoadLEDMessage(BYTE led1Indication);
+static void CANSetBitTiming(CAN_MODULE module);
+#if CAN_LOG_ENABLE
+static BYTE CANChannelLevel(CAN_MODULE module, CAN_CHANNEL channel,
+                            BOOL isTx, BYTE buffers);
+static void CAN1LogRxMessage(CANRxMessageBuffer *message);
+#else
+    #define CAN1LogRxMessage(message)
+#endif
+
 /* Function Description ******************************************************
  * SYNTAX:          void CAN1Init(void);
  * KEYWORDS:        CAN1, initialize
  * DESCRIPTION:     This function initializes CAN1 for extended 29 bit ID. This
- *                  CAN1 controller is set up with two FIFO buffers that are 8
- *                  messages deep. Channel 0 is configured to be a Tx channel.
+ *                  CAN1 controller is set up with four FIFO buffers that are
+ *                  8 messages deep. Channels 0, 2 and 3 are configured to be
+ *                  Tx channels of decreasing priority.
  *                  Channel 1 is configured as a receive channel and is set to
  *                  receive a specific message, in this case EID 0x8004001 by
  *                  the value specified for CAN_FILTER0.
@@ -69,8 +103,6 @@ static volatile BOOL isCAN2MsgReceived = FALSE;
  * END DESCRIPTION ************************************************************/
 void CAN1Init(void)
 {
-    CAN_BIT_CONFIG canBitConfig;
-
 /*  chipKIT Po MX7 +++++++++++++++++++++  */
     PORTSetPinsDigitalIn(IOPORT_F, BIT_12);	/* Set CAN1 Rx to input */
     PORTSetPinsDigitalOut(IOPORT_F, BIT_13);    /* Set CAN1 Tx  to output */
@@ -84,32 +116,44 @@ void CAN1Init(void)
     CANSetOperatingMode(CAN1, CAN_CONFIGURATION);/* Set CAN mode of operation */
     while(CANGetOperatingMode(CAN1) != CAN_CONFIGURATION);/*wait for operation*/
 
-/* Step 2: Configure the Clock. The CAN_BIT_CONFIG data structure is used 
- * for this purpose. The propagation segment, phase segment 1 and phase
- * segment 2 are configured to have 3TQ. */
-    canBitConfig.phaseSeg2Tq            = CAN_BIT_3TQ;
-    canBitConfig.phaseSeg1Tq            = CAN_BIT_3TQ;
-    canBitConfig.propagationSegTq       = CAN_BIT_3TQ;
-    canBitConfig.phaseSeg2TimeSelect    = TRUE;
-    canBitConfig.sample3Time            = TRUE;
-    canBitConfig.syncJumpWidth          = CAN_BIT_2TQ;
-    CANSetSpeed(CAN1,&canBitConfig, SYSTEM_FREQ, CAN_BUS_SPEED);
+/* Step 2: Configure the Clock. The bit timing for CAN_BUS_SPEED is selected
+ * by CANSetBitTiming. */
+    CANSetBitTiming(CAN1);
    
 /* Step 3: Assign the buffer area to the CAN module. */
     CANAssignMemoryBuffer(CAN1,CAN1MessageFifoArea, CAN1_MSG_MEMORY);
 
-/* Step 4: Configure channel 0 for TX and size of 8 message buffers with RTR 
- * disabled and low medium priority. Configure channel 1 for RX and size
- * of 8 message buffers and receive the full message. There can be from 1 to
- * 32 FIFO buffers each with up to 32 message buffers that are 16 bytes. Each
- * FIFO, if it is a receive buffer, has an ID filter that specifies which
- * message to accept. */
-    CANConfigureChannelForTx(CAN1, CAN_CHANNEL0, CAN1_FIFO_BUFFERS,
+/* Step 4: Configure channels 0, 2 and 3 for TX with RTR disabled. Each Tx
+ * channel serves one CAN1_TX_CLASS and has a distinct priority so that when
+ * several channels have messages pending the CAN module transmits the urgent
+ * channel first. Configure channel 1 for RX and receive the full message, or
+ * only the payload when CAN1_RX_DATA_ONLY is set. The number of message
+ * buffers in each channel is set in CANFunctions.h. There can be
+ * from 1 to 32 FIFO buffers each with up to 32 message buffers that are 16
+ * bytes. Each FIFO, if it is a receive buffer, has an ID filter that specifies
+ * which message to accept. */
+    CANConfigureChannelForTx(CAN1, CAN1_TX_URGENT_CHANNEL,
+                                   CAN1_TX_URGENT_BUFFERS,
+                                   CAN_TX_RTR_DISABLED,
+                                   CAN_HIGHEST_PRIORITY);
+
+    CANConfigureChannelForTx(CAN1, CAN1_TX_NORMAL_CHANNEL,
+                                   CAN1_TX_NORMAL_BUFFERS,
                                    CAN_TX_RTR_DISABLED,
-                                   CAN_LOW_MEDIUM_PRIORITY);
+                                   CAN_HIGH_MEDIUM_PRIORITY);
 
-    CANConfigureChannelForRx(CAN1, CAN_CHANNEL1, CAN1_FIFO_BUFFERS,
+    CANConfigureChannelForTx(CAN1, CAN1_TX_BULK_CHANNEL,
+                                   CAN1_TX_BULK_BUFFERS,
+                                   CAN_TX_RTR_DISABLED,
+                                   CAN_LOWEST_PRIORITY);
+
+#if CAN1_RX_DATA_ONLY
+    CANConfigureChannelForRx(CAN1, CAN1_RX_CHANNEL, CAN1_RX_BUFFERS,
+                                    CAN_RX_DATA_ONLY);
+#else
+    CANConfigureChannelForRx(CAN1, CAN1_RX_CHANNEL, CAN1_RX_BUFFERS,
                                     CAN_RX_FULL_RECEIVE);
+#endif
 	
 /* Step 5: Configure filters and mask. Configure filter 0 to accept EID
  * messages with EID LED1_INDICATION_MSG. Configure Filter Mask is set to
@@ -158,8 +202,6 @@ void CAN1Init(void)
  * END DESCRIPTION ************************************************************/
 void CAN2Init(void)
 {
-CAN_BIT_CONFIG canBitConfig;
-
 /* This function will initialize CAN2 module. */
 /* chipKIT Pro MX7 ++++++++++++++++++++++*/
     PORTSetPinsDigitalIn(IOPORT_C, BIT_3);      /*Set CAN2 Rx */
@@ -174,26 +216,17 @@ CAN_BIT_CONFIG canBitConfig;
     CANSetOperatingMode(CAN2, CAN_CONFIGURATION);
     while(CANGetOperatingMode(CAN2) != CAN_CONFIGURATION);
 
-/* Step 2: Configure the Clock. The CAN_BIT_CONFIG data structure is used
- * for this purpose. The propagation,  phase segment 1 and phase segment 2
- * are configured to have 3TQ. */
-	
-    canBitConfig.phaseSeg2Tq            = CAN_BIT_3TQ;
-    canBitConfig.phaseSeg1Tq            = CAN_BIT_3TQ;
-    canBitConfig.propagationSegTq       = CAN_BIT_3TQ;
-    canBitConfig.phaseSeg2TimeSelect    = TRUE;
-    canBitConfig.sample3Time            = TRUE;
-    canBitConfig.syncJumpWidth          = CAN_BIT_2TQ;
-
-    CANSetSpeed(CAN2, &canBitConfig, SYSTEM_FREQ, CAN_BUS_SPEED);
+/* Step 2: Configure the Clock. The bit timing for CAN_BUS_SPEED is selected
+ * by CANSetBitTiming. */
+    CANSetBitTiming(CAN2);
    
 /* Step 3: Assign the buffer area to the CAN module. */ 
 
     CANAssignMemoryBuffer(CAN2,CAN2MessageFifoArea, CAN2_MSG_MEMORY);
 
-/* Step 4: Configure channel 0 for TX and size of 8 message buffers with RTR
- * enable and low medium priority. */
-    CANConfigureChannelForTx(CAN2,CAN_CHANNEL0,CAN2_FIFO_BUFFERS,
+/* Step 4: Configure channel 0 for TX and size of CAN2_TX_RTR_BUFFERS message
+ * buffers with RTR enable and low medium priority. */
+    CANConfigureChannelForTx(CAN2,CAN_CHANNEL0,CAN2_TX_RTR_BUFFERS,
                                   CAN_TX_RTR_ENABLED,
                                   CAN_LOW_MEDIUM_PRIORITY);
 	
@@ -221,6 +254,51 @@ CAN_BIT_CONFIG canBitConfig;
     while(CANGetOperatingMode(CAN2) != CAN_NORMAL_OPERATION);
 }
 
+/* Function Description ******************************************************
+ * SYNTAX:          static void CANSetBitTiming(CAN_MODULE module);
+ * KEYWORDS:        CAN, bit timing, speed
+ * DESCRIPTION:     This function sets the bit timing of a CAN module that is
+ *                  in configuration mode. CANSolveBitTiming selects the
+ *                  segment lengths for CAN_BUS_SPEED, CAN_BUS_LENGTH and
+ *                  CAN_TRANSCEIVER_DELAY. If no valid timing exists the
+ *                  original 250 kbit/s setting is used: the propagation
+ *                  segment, phase segment 1 and phase segment 2 are
+ *                  configured to have 3TQ and the SJW to have 2TQ.
+ * PARAMETER:       module - CAN1 or CAN2
+ * RETURN VALUE:    None
+ * Notes:           The CAN_BIT_TQ values are in order from CAN_BIT_1TQ, so
+ *                  a segment of n TQ is CAN_BIT_1TQ + n - 1.
+ * END DESCRIPTION ************************************************************/
+static void CANSetBitTiming(CAN_MODULE module)
+{
+CAN_BIT_CONFIG canBitConfig;
+CAN_BIT_TIMING bitTiming;
+
+    canBitConfig.phaseSeg2TimeSelect    = TRUE;
+
+    if(CANSolveBitTiming(SYSTEM_FREQ, CAN_BUS_SPEED, CAN_BUS_LENGTH,
+                         CAN_TRANSCEIVER_DELAY, CAN_SAMPLE_POINT, &bitTiming))
+    {
+        canBitConfig.phaseSeg2Tq = CAN_BIT_1TQ + bitTiming.phase2Tq - 1;
+        canBitConfig.phaseSeg1Tq = CAN_BIT_1TQ + bitTiming.phase1Tq - 1;
+        canBitConfig.propagationSegTq =
+                                CAN_BIT_1TQ + bitTiming.propagationTq - 1;
+        canBitConfig.sample3Time = bitTiming.sample3Time;
+        canBitConfig.syncJumpWidth =
+                                CAN_BIT_1TQ + bitTiming.syncJumpWidthTq - 1;
+    }
+    else
+    {
+        canBitConfig.phaseSeg2Tq            = CAN_BIT_3TQ;
+        canBitConfig.phaseSeg1Tq            = CAN_BIT_3TQ;
+        canBitConfig.propagationSegTq       = CAN_BIT_3TQ;
+        canBitConfig.sample3Time            = TRUE;
+        canBitConfig.syncJumpWidth          = CAN_BIT_2TQ;
+    }
+
+    CANSetSpeed(module, &canBitConfig, SYSTEM_FREQ, CAN_BUS_SPEED);
+}
+
 /* Function Description ******************************************************
  * SYNTAX:          void CAN1RxMsgProcess(void);
  * KEYWORDS:        CAN1, Rx Message, process
@@ -255,10 +333,16 @@ CANRxMessageBuffer * message;
 
     isCAN1MsgReceived = FALSE;
     message = (CANRxMessageBuffer *)CANGetRxMessage(CAN1,CAN_CHANNEL1);
+    CAN1LogRxMessage(message);
 
 /* Check the byte 0 of the data payload. If it is 0 then switch off LED4 else
- * switch it on. This is the remote indication. */
+ * switch it on. This is the remote indication. In data only mode the payload
+ * is at the start of the message buffer. */
+#if CAN1_RX_DATA_ONLY
+    if(message->dataOnlyMsgData[0] == 0)
+#else
     if(message->data[0] == 0)
+#endif
     {
         LATGCLR = LED4;
     }
@@ -292,7 +376,6 @@ CANRxMessageBuffer * message;
  * END DESCRIPTION ***********************************************************/
 void CAN2UpdateLEDMessage(BYTE led1Indication)
 {
-CANTxMessageBuffer * message;
 /* The CAN_TX_CHANNEL_EMPTY flag is set whenever any FIFO has a message that
  * has not been sent. */
     if((CANGetChannelEvent(CAN2,CAN_CHANNEL0) & CAN_TX_CHANNEL_EMPTY) == 0)
@@ -313,6 +396,63 @@ CANTxMessageBuffer * message;
 /* Toggle LEDA for event timing instrumentation. */
     PORTToggleBits(IOPORT_B, LEDA);
 
+    CAN2LoadLEDMessage(led1Indication);
+}
+
+/* Function Description ******************************************************
+ * SYNTAX:          void CAN2PublishLEDMessage(BYTE led1Indication);
+ * KEYWORDS:        CAN2, Tx Message, RTR, latest value
+ * DESCRIPTION:
+ *  This function posts led1Indication as the RTR response message in CAN2
+ *  Channel 0 regardless of whether the previous posting has been read.
+ *  CAN2UpdateLEDMessage drops the new value when the channel still holds an
+ *  unread message, so CAN1 can be served a value that is up to one update
+ *  period old. Here the stale message is discarded by resetting the channel
+ *  and the newest value is written in its place, so the channel only ever
+ *  holds the latest sample. LEDA is toggled when the channel was empty and
+ *  LEDB is toggled when a stale message was replaced.
+ *
+ * PARAMETER:       led1Indication - 1 to switch on LED4, 0 to switch it off.
+ * RETURN VALUE:    None
+ * Notes:           Resetting the channel only clears the FIFO pointers. The
+ *                  TX, RTR and size settings made in CAN2Init are kept.
+ * END DESCRIPTION ***********************************************************/
+void CAN2PublishLEDMessage(BYTE led1Indication)
+{
+    if((CANGetChannelEvent(CAN2,CAN_CHANNEL0) & CAN_TX_CHANNEL_EMPTY) == 0)
+    {
+/* CAN2 Channel 0 still holds a message that was not requested by CAN1.
+ * Discard it and wait for the reset to complete. Toggle LEDB for event
+ * timing instrumentation. */
+        PORTToggleBits(IOPORT_B, LEDB);
+        CANResetChannel(CAN2, CAN_CHANNEL0);
+        while(CANIsChannelReset(CAN2, CAN_CHANNEL0) == FALSE);
+    }
+    else
+    {
+/* Toggle LEDA for event timing instrumentation. */
+        PORTToggleBits(IOPORT_B, LEDA);
+    }
+
+    CAN2LoadLEDMessage(led1Indication);
+}
+
+/* Function Description ******************************************************
+ * SYNTAX:          static void CAN2LoadLEDMessage(BYTE led1Indication);
+ * KEYWORDS:        CAN2, Tx Message, RTR
+ * DESCRIPTION:
+ *  This function writes the LED1_INDICATION_MSG message with a 1 byte
+ *  payload of led1Indication into the next free buffer of CAN2 Channel 0.
+ *  The channel must have room for the message when this function is called.
+ *
+ * PARAMETER:       led1Indication - 1 to switch on LED4, 0 to switch it off.
+ * RETURN VALUE:    None
+ * Notes:           None
+ * END DESCRIPTION ***********************************************************/
+static void CAN2LoadLEDMessage(BYTE led1Indication)
+{
+CANTxMessageBuffer * message;
+
 /* Get a pointer to the next buffer in the channel. This pointer need not be
   * checked for null value because the channel is empty and will accommodate
   * a new message. */
@@ -333,6 +473,10 @@ CANTxMessageBuffer * message;
 /* This function lets the CAN module know that the message processing is done
  * and message is ready to be processed. */
     CANUpdateChannel(CAN2,CAN_CHANNEL0);
+    CANLogFrame(CAN_LOG_FLAG_TX | CAN_LOG_FLAG_EXT | CAN_LOG_FLAG_CAN2,
+                LED1_INDICATION_MSG, 1, &led1Indication,
+                CANChannelLevel(CAN2, CAN_CHANNEL0, TRUE,
+                                CAN2_TX_RTR_BUFFERS));
 
 /* Note that the CANFlushTxChannel() function is not called. Since the 
  * RTR is enabled for this channel, the CAN module will automatically
@@ -354,40 +498,198 @@ CANTxMessageBuffer * message;
  * Notes:           None
  * END DESCRIPTION ************************************************************/
 void CAN1TxSendRTRMsg(void)
+{
+    PORTToggleBits(IOPORT_B, LEDC);
+
+/* The reply is needed before the next request, one minor cycle later. That
+ * deadline selects the normal class channel, so the RTR message does not
+ * delay urgent control frames. Flushing sends it along with any other
+ * message posted since the last flush. */
+    if(CAN1TxPostMsg(CAN1_TX_CLASS_FOR_DEADLINE(TT_MINOR_CYCLE_MS),
+                     CAN2_MSG_ID, TRUE, NULL, 0))
+    {
+        CAN1TxFlush();
+    }
+}
+
+/* Function Description ******************************************************
+ * SYNTAX:          BOOL CAN1TxPostMsg(CAN1_TX_CLASS txClass, UINT32 eid,
+ *                                     BOOL isRTR, const BYTE *data, BYTE dlc);
+ * KEYWORDS:        CAN1, Tx, priority
+ * DESCRIPTION:     This function forms an extended ID message in the next
+ *                  free buffer of the Tx channel assigned to txClass. The
+ *                  channel is marked pending but is not flushed so that
+ *                  messages posted together are transmitted in one batch by
+ *                  CAN1TxFlush.
+ * PARAMETER1:      txClass - transmit class that selects the Tx channel
+ * PARAMETER2:      eid - 29 bit extended ID
+ * PARAMETER3:      isRTR - TRUE to send a remote transmit request
+ * PARAMETER4:      data - payload, may be NULL when dlc is 0
+ * PARAMETER5:      dlc - payload length, 0 to 8 bytes
+ * RETURN VALUE:    TRUE if the message was posted, FALSE if the channel is
+ *                  full or the parameters are invalid
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+BOOL CAN1TxPostMsg(CAN1_TX_CLASS txClass, UINT32 eid, BOOL isRTR,
+                   const BYTE *data, BYTE dlc)
 {
 CANTxMessageBuffer * message;
+BYTE i;
 
-    PORTToggleBits(IOPORT_B, LEDC);
+    if((txClass >= CAN1_TX_CLASSES) || (dlc > 8))
+    {
+        return FALSE;
+    }
 
 /* Get a pointer to the next buffer in the channel check if the returned
  * value is null. */
-    message = CANGetTxMessageBuffer(CAN1,CAN_CHANNEL0);
-    if(message!= NULL)
+    message = CANGetTxMessageBuffer(CAN1, can1TxChannel[txClass]);
+    if(message == NULL)
+    {
+        return FALSE;
+    }
+
+/* Form an extended ID CAN message. Start by clearing the buffer. */
+    message->messageWord[0] = 0;
+    message->messageWord[1] = 0;
+    message->messageWord[2] = 0;
+    message->messageWord[3] = 0;
+
+    message->msgSID.SID = (WORD) (eid >> 18) & SID_BIT_MASK;
+    message->msgEID.EID = eid & EID_BIT_MASK;
+    message->msgEID.IDE = 1;    /* IDE = 1 means Extended ID message. */
+    if(isRTR)
     {
-/* Form a Standard ID RTR CAN message. Start by clearing the buffer. */
-        message->messageWord[0] = 0;
-        message->messageWord[1] = 0;
-        message->messageWord[2] = 0;
-        message->messageWord[3] = 0;
-
-        message->msgSID.SID = (WORD) (CAN2_MSG_ID >> 18) & SID_BIT_MASK;
-        message->msgEID.EID = (WORD) CAN2_MSG_ID & EID_BIT_MASK;
-        message->msgEID.IDE = 1;    /* IDE = 1 means Extended ID message. */
         message->msgEID.RTR = 1;    /* For EID message Set RTR and SRR to 1 */
         message->msgEID.SRR = 1;    /* Set secondary RTR Bit */
-        message->msgEID.DLC = 0;    /* No data payload for RTR messages. */
+        dlc = 0;                    /* No data payload for RTR messages. */
+    }
+    message->msgEID.DLC = dlc;
+    for(i = 0; i < dlc; i++)
+    {
+        message->data[i] = data[i];
+    }
 
 /* This function lets the CAN module know that the message processing is done
  * and message is ready to be processed. */
+    CANUpdateChannel(CAN1, can1TxChannel[txClass]);
+    can1TxPending |= (1 << txClass);
+    CANLogFrame(CAN_LOG_FLAG_TX | CAN_LOG_FLAG_EXT
+                | (isRTR ? CAN_LOG_FLAG_RTR : 0), eid, dlc, data,
+                CANChannelLevel(CAN1, can1TxChannel[txClass], TRUE,
+                                can1TxBuffers[txClass]));
+
+    return TRUE;
+}
+
+/* Function Description ******************************************************
+ * SYNTAX:          void CAN1TxFlush(void);
+ * KEYWORDS:        CAN1, Tx, flush
+ * DESCRIPTION:     This function flushes each CAN1 Tx channel that has
+ *                  messages posted since the last flush, highest priority
+ *                  class first. Once flushed, the CAN module arbitrates
+ *                  between the channels by their configured priority, so
+ *                  pending urgent frames are always transmitted before
+ *                  normal and bulk frames.
+ * PARAMETER1:      None
+ * RETURN VALUE:    None
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+void CAN1TxFlush(void)
+{
+BYTE txClass;
 
-        CANUpdateChannel(CAN1,CAN_CHANNEL0);
+    for(txClass = 0; txClass < CAN1_TX_CLASSES; txClass++)
+    {
+        if(can1TxPending & (1 << txClass))
+        {
+            CANFlushTxChannel(CAN1, can1TxChannel[txClass]);
+        }
+    }
+    can1TxPending = 0;
+}
+
+#if CAN_LOG_ENABLE
+/* Function Description ******************************************************
+ * SYNTAX:          static BYTE CANChannelLevel(CAN_MODULE module,
+ *                          CAN_CHANNEL channel, BOOL isTx, BYTE buffers);
+ * KEYWORDS:        CAN, FIFO, level, log
+ * DESCRIPTION:     The CAN module does not report the number of messages in
+ *                  a channel, only the empty, half and full events. This
+ *                  function converts those events to a lower bound of the
+ *                  number of messages: buffers when full, buffers / 2 when
+ *                  at least half full, 1 when not empty and 0 when empty.
+ * PARAMETER1:      module - CAN module
+ * PARAMETER2:      channel - channel in module
+ * PARAMETER3:      isTx - TRUE for a Tx channel, FALSE for an Rx channel
+ * PARAMETER4:      buffers - number of message buffers in the channel
+ * RETURN VALUE:    Estimated number of messages in the channel
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+static BYTE CANChannelLevel(CAN_MODULE module, CAN_CHANNEL channel,
+                            BOOL isTx, BYTE buffers)
+{
+CAN_CHANNEL_EVENT events = CANGetChannelEvent(module, channel);
 
-/* Direct the CAN module to flush the TX channel. This will send any pending
- * message in the TX channel. */
+    if(isTx)
+    {
+        if((events & CAN_TX_CHANNEL_NOT_FULL) == 0)
+        {
+            return buffers;
+        }
+        if((events & CAN_TX_CHANNEL_HALF_EMPTY) == 0)
+        {
+            return buffers / 2;
+        }
+        return (events & CAN_TX_CHANNEL_EMPTY) ? 0 : 1;
+    }
 
-        CANFlushTxChannel(CAN1,CAN_CHANNEL0);
+    if(events & CAN_RX_CHANNEL_FULL)
+    {
+        return buffers;
+    }
+    if(events & CAN_RX_CHANNEL_HALF_FULL)
+    {
+        return buffers / 2;
+    }
+    return (events & CAN_RX_CHANNEL_NOT_EMPTY) ? 1 : 0;
+}
+
+/* Function Description ******************************************************
+ * SYNTAX:          static void CAN1LogRxMessage(CANRxMessageBuffer *message);
+ * KEYWORDS:        CAN1, Rx, log
+ * DESCRIPTION:     Logs a message read from the CAN1 Rx channel. The channel
+ *                  level includes the message since it has not been released
+ *                  yet.
+ * PARAMETER1:      message - message read from the Rx channel
+ * RETURN VALUE:    None
+ * Notes:           In data only mode the message has no header. It is logged
+ *                  with the ID accepted by filter 0 and a DLC of 8.
+ * END DESCRIPTION ************************************************************/
+static void CAN1LogRxMessage(CANRxMessageBuffer *message)
+{
+BYTE level = CANChannelLevel(CAN1, CAN1_RX_CHANNEL, FALSE, CAN1_RX_BUFFERS);
+
+#if CAN1_RX_DATA_ONLY
+    CANLogFrame(CAN_LOG_FLAG_EXT, LED1_INDICATION_MSG, CAN_DATA_ONLY_BUFF_SIZE,
+                message->dataOnlyMsgData, level);
+#else
+BYTE flags = 0;
+UINT32 id = message->msgSID.SID;
+
+    if(message->msgEID.IDE)
+    {
+        flags |= CAN_LOG_FLAG_EXT;
+        id = (id << 18) | message->msgEID.EID;
+    }
+    if(message->msgEID.RTR)
+    {
+        flags |= CAN_LOG_FLAG_RTR;
     }
+    CANLogFrame(flags, id, message->msgEID.DLC, message->data, level);
+#endif
 }
+#endif
 
 /* Function Description *******************************************************
  * SYNTAX:          CAN1InterruptHandler(void);
@@ -0,0 +1,266 @@
+/*  CANLogger.c
+ *
+ *  Processor:  PIC32MX7
+ *  Compiler:   MPLAB XC32
+ *
+ *  CAN traffic logger. Frames are recorded in a byte ring buffer. Each
+ *  record holds the time since the previous record rather than an absolute
+ *  time stamp, and the time and the message ID are stored as varints, so a
+ *  one byte extended ID frame sent every 100ms takes 10 bytes instead of
+ *  the 20 of a fixed layout record. When a new record does not fit, records
+ *  are dropped from the tail and their time deltas are added to the base
+ *  time so that the remaining records keep their time.
+ *  See CANLogger.h for the format.
+ *
+ *  The LED toggles used as scope probes in CANFunctions_RTR.c show when an
+ *  event happened. The log adds what was sent or received.
+*/
+
+#include <plib.h>
+#include "GenericTypeDefs.h"
+#include "chipKIT_Pro_MX7.h"
+#include "CANLogger.h"
+
+#if CAN_LOG_ENABLE
+
+#define CAN_LOG_MASK        (CAN_LOG_SIZE - 1)
+
+/* Core timer counts per us. */
+#define CORE_US_TICK_RATE   ((CORE_MS_TICK_RATE) / 1000)
+
+/* Ring buffer. Records are written at head and dropped from tail. */
+static BYTE canLog[CAN_LOG_SIZE];
+static WORD canLogHead;
+static WORD canLogTail;
+static WORD canLogUsed;
+static WORD canLogDropped;
+
+/* Time of the record before the tail in us. The tail record delta is
+ * relative to this time. */
+static UINT32 canLogBaseUs;
+
+/* Core timer value of the newest record. The ticks that do not make up a
+ * whole us are carried to the next record. */
+static UINT32 canLogLastTicks;
+
+/* Private function prototypes */
+static void CANLogPut(BYTE value);
+static BYTE CANLogPutVarint(BYTE *buffer, UINT32 value);
+static UINT32 CANLogGetVarint(WORD *index);
+static void CANLogDropTail(void);
+
+/* CANLogInit Function Description ********************************************
+ * SYNTAX:          void CANLogInit(void);
+ * KEYWORDS:        CAN, log, initialize
+ * DESCRIPTION:     Empties the log and starts the time base.
+ * PARAMETER1:      None
+ * RETURN VALUE:    None
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+void CANLogInit(void)
+{
+unsigned int status;
+
+    status = INTDisableInterrupts();
+    canLogHead = 0;
+    canLogTail = 0;
+    canLogUsed = 0;
+    canLogDropped = 0;
+    canLogLastTicks = ReadCoreTimer();
+    canLogBaseUs = canLogLastTicks / CORE_US_TICK_RATE;
+    INTRestoreInterrupts(status);
+}
+
+/* CANLogFrame Function Description *******************************************
+ * SYNTAX:          void CANLogFrame(BYTE flags, UINT32 id, BYTE dlc,
+ *                                   const BYTE *data, BYTE fifoLevel);
+ * KEYWORDS:        CAN, log, record
+ * DESCRIPTION:     Encodes the record in a local buffer first so that its
+ *                  length is known, makes room by dropping the oldest
+ *                  records and copies it into the ring buffer.
+ * PARAMETER1:      flags - CAN_LOG_FLAG_x bits
+ * PARAMETER2:      id - message ID
+ * PARAMETER3:      dlc - data length code, values above 8 are logged as 8
+ * PARAMETER4:      data - payload, not used for RTR frames
+ * PARAMETER5:      fifoLevel - messages in the channel
+ * RETURN VALUE:    None
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+void CANLogFrame(BYTE flags, UINT32 id, BYTE dlc, const BYTE *data,
+                 BYTE fifoLevel)
+{
+BYTE record[CAN_LOG_MAX_RECORD];
+BYTE length;
+BYTE i;
+UINT32 now;
+UINT32 deltaUs;
+unsigned int status;
+
+    if(dlc > 8)
+    {
+        dlc = 8;
+    }
+
+    status = INTDisableInterrupts();
+
+/* Whole us since the previous record. The remainder stays in
+ * canLogLastTicks so that rounding does not accumulate. */
+    now = ReadCoreTimer();
+    deltaUs = (now - canLogLastTicks) / CORE_US_TICK_RATE;
+    canLogLastTicks += deltaUs * CORE_US_TICK_RATE;
+
+    record[0] = (flags & ~CAN_LOG_DLC_MASK) | dlc;
+    record[1] = fifoLevel;
+    length = 2;
+    length += CANLogPutVarint(&record[length], deltaUs);
+    length += CANLogPutVarint(&record[length], id);
+    if((flags & CAN_LOG_FLAG_RTR) == 0)
+    {
+        for(i = 0; i < dlc; i++)
+        {
+            record[length++] = data[i];
+        }
+    }
+
+    while(CAN_LOG_SIZE - canLogUsed < length)
+    {
+        CANLogDropTail();
+    }
+    for(i = 0; i < length; i++)
+    {
+        CANLogPut(record[i]);
+    }
+
+    INTRestoreInterrupts(status);
+}
+
+/* CANLogExport Function Description ******************************************
+ * SYNTAX:          WORD CANLogExport(BYTE *dest, WORD size);
+ * KEYWORDS:        CAN, log, export
+ * DESCRIPTION:     Writes the header and the records oldest first to dest.
+ * PARAMETER1:      dest - destination buffer
+ * PARAMETER2:      size - size of dest in bytes
+ * RETURN VALUE:    Number of bytes written, 0 if dest is too small
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+WORD CANLogExport(BYTE *dest, WORD size)
+{
+WORD i;
+WORD used;
+unsigned int status;
+
+    status = INTDisableInterrupts();
+    used = canLogUsed;
+    if(size < CAN_LOG_HEADER_SIZE + used)
+    {
+        INTRestoreInterrupts(status);
+        return 0;
+    }
+
+    for(i = 0; i < 4; i++)
+    {
+        dest[i] = CAN_LOG_MAGIC[i];
+    }
+    dest[4] = (BYTE) canLogBaseUs;
+    dest[5] = (BYTE) (canLogBaseUs >> 8);
+    dest[6] = (BYTE) (canLogBaseUs >> 16);
+    dest[7] = (BYTE) (canLogBaseUs >> 24);
+    dest[8] = (BYTE) used;
+    dest[9] = (BYTE) (used >> 8);
+    dest[10] = (BYTE) canLogDropped;
+    dest[11] = (BYTE) (canLogDropped >> 8);
+
+    for(i = 0; i < used; i++)
+    {
+        dest[CAN_LOG_HEADER_SIZE + i] =
+                                    canLog[(canLogTail + i) & CAN_LOG_MASK];
+    }
+
+    INTRestoreInterrupts(status);
+    return CAN_LOG_HEADER_SIZE + used;
+}
+
+/* CANLogPut Function Description *********************************************
+ * SYNTAX:          static void CANLogPut(BYTE value);
+ * DESCRIPTION:     Appends one byte at the head of the ring buffer. The
+ *                  caller has made room for it.
+ * END DESCRIPTION ************************************************************/
+static void CANLogPut(BYTE value)
+{
+    canLog[canLogHead] = value;
+    canLogHead = (canLogHead + 1) & CAN_LOG_MASK;
+    canLogUsed++;
+}
+
+/* CANLogPutVarint Function Description ***************************************
+ * SYNTAX:          static BYTE CANLogPutVarint(BYTE *buffer, UINT32 value);
+ * DESCRIPTION:     Writes value as a varint to buffer.
+ * RETURN VALUE:    Number of bytes written, 1 to 5
+ * END DESCRIPTION ************************************************************/
+static BYTE CANLogPutVarint(BYTE *buffer, UINT32 value)
+{
+BYTE length = 0;
+
+    while(value >= 0x80)
+    {
+        buffer[length++] = (BYTE) (value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (BYTE) value;
+    return length;
+}
+
+/* CANLogGetVarint Function Description ***************************************
+ * SYNTAX:          static UINT32 CANLogGetVarint(WORD *index);
+ * DESCRIPTION:     Reads a varint from the ring buffer at *index and
+ *                  advances *index past it.
+ * RETURN VALUE:    The decoded value
+ * END DESCRIPTION ************************************************************/
+static UINT32 CANLogGetVarint(WORD *index)
+{
+UINT32 value = 0;
+BYTE shift = 0;
+BYTE b;
+
+    do
+    {
+        b = canLog[*index];
+        *index = (*index + 1) & CAN_LOG_MASK;
+        value |= (UINT32) (b & 0x7F) << shift;
+        shift += 7;
+    } while(b & 0x80);
+    return value;
+}
+
+/* CANLogDropTail Function Description ****************************************
+ * SYNTAX:          static void CANLogDropTail(void);
+ * DESCRIPTION:     Discards the oldest record and adds its time delta to the
+ *                  base time.
+ * END DESCRIPTION ************************************************************/
+static void CANLogDropTail(void)
+{
+WORD index = canLogTail;
+BYTE flags;
+BYTE length;
+
+    flags = canLog[index];
+    index = (index + 2) & CAN_LOG_MASK;     /* Skip flags and FIFO level */
+    canLogBaseUs += CANLogGetVarint(&index);
+    CANLogGetVarint(&index);
+    if((flags & CAN_LOG_FLAG_RTR) == 0)
+    {
+        index = (index + (flags & CAN_LOG_DLC_MASK)) & CAN_LOG_MASK;
+    }
+
+    length = (index - canLogTail) & CAN_LOG_MASK;
+    canLogTail = index;
+    canLogUsed -= length;
+    if(canLogDropped < 0xFFFF)
+    {
+        canLogDropped++;
+    }
+}
+
+#endif
+
+/* End of CANLogger.c */
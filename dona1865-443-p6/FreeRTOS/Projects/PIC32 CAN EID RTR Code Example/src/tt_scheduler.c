@@ -0,0 +1,131 @@
+/*  tt_scheduler.c
+ *
+ *  Processor:  PIC32MX7
+ *  Platform:   Digilent chipKIT Pro MX7
+ *
+ *  Time triggered cyclic scheduler. The core timer compare interrupt marks
+ *  the start of each minor cycle. The compare register is advanced by a
+ *  fixed TT_CORE_TICKS from its previous value rather than from the time
+ *  the interrupt is serviced, so minor cycles do not drift. Tasks run from
+ *  a schedule table at their slot and the CPU is put in idle mode until
+ *  the next interrupt.
+ *
+ *  Timing instrumentation: LEDF is high while the CPU is idle, so its duty
+ *  cycle on a scope is the CPU idle percentage. LEDG toggles at the start
+ *  of each minor cycle, so its edge jitter is the dispatch jitter. LEDH
+ *  toggles when a minor cycle is overrun.
+*/
+
+#include <plib.h>
+#include "GenericTypeDefs.h"
+#include "chipKIT_Pro_MX7.h"
+#include "tt_scheduler.h"
+
+/* Number of minor cycles started by the core timer ISR that have not been
+ * dispatched yet. */
+static volatile unsigned int ttPendingCycles = 0;
+
+/* TTSchedulerInit Function Description ***************************************
+ * SYNTAX:          void TTSchedulerInit(void);
+ * KEYWORDS:        scheduler, core timer, initialize
+ * DESCRIPTION:     Starts the core timer with a compare period of one minor
+ *                  cycle and enables the core timer interrupt at priority
+ *                  level 2, below the CAN interrupts.
+ * PARAMETER1:      None
+ * RETURN VALUE:    None
+ * Notes:           Multi vector interrupts must be configured by the caller.
+ * END DESCRIPTION ************************************************************/
+void TTSchedulerInit(void)
+{
+    ttPendingCycles = 0;
+    OpenCoreTimer(TT_CORE_TICKS);
+    mConfigIntCoreTimer(CT_INT_ON | CT_INT_PRIOR_2 | CT_INT_SUB_PRIOR_0);
+}
+
+/* TTSchedulerRun Function Description ****************************************
+ * SYNTAX:          void TTSchedulerRun(const TT_TASK_ENTRY *table,
+ *                          unsigned int tasks, void (*background)(void));
+ * PARAMETER1:      table - schedule table
+ * PARAMETER2:      tasks - number of entries in table
+ * PARAMETER3:      background - function run after every wake up, such as
+ *                  processing of received messages, may be NULL
+ * KEYWORDS:        scheduler, time triggered, idle
+ * DESCRIPTION:     Dispatches the schedule table for every minor cycle
+ *                  started by the core timer ISR. The background function is
+ *                  run after each wake up, which includes wake ups caused by
+ *                  other interrupts. When no minor cycle is pending the CPU
+ *                  enters idle mode. Interrupts are disabled around the check
+ *                  so that an interrupt cannot be missed between the check
+ *                  and the WAIT instruction. A pending interrupt still wakes
+ *                  the CPU with interrupts disabled and is serviced when
+ *                  they are restored.
+ * RETURN VALUE:    This function does not return.
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+void TTSchedulerRun(const TT_TASK_ENTRY *table, unsigned int tasks,
+                    void (*background)(void))
+{
+unsigned int cycle = 0;
+unsigned int i;
+unsigned int status;
+
+    while(1)
+    {
+        while(ttPendingCycles > 0)
+        {
+            status = INTDisableInterrupts();
+            ttPendingCycles--;
+            if(ttPendingCycles > 0)
+            {
+/* The previous minor cycle took longer than TT_MINOR_CYCLE_MS. Toggle LEDH
+ * for event timing instrumentation. */
+                LATBINV = LEDH;
+            }
+            INTRestoreInterrupts(status);
+
+            LATBINV = LEDG;
+            for(i = 0; i < tasks; i++)
+            {
+                if((cycle % table[i].period) == table[i].offset)
+                {
+                    table[i].task();
+                }
+            }
+            cycle = (cycle + 1) % TT_MAJOR_CYCLE;
+        }
+
+        if(background != NULL)
+        {
+            background();
+        }
+
+        status = INTDisableInterrupts();
+        if(ttPendingCycles == 0)
+        {
+            LATBSET = LEDF;
+            PowerSaveIdle();
+            LATBCLR = LEDF;
+        }
+        INTRestoreInterrupts(status);
+    }
+}
+
+/* CoreTimerHandler Function Description **************************************
+ * SYNTAX:          void CoreTimerHandler(void);
+ * KEYWORDS:        core timer, interrupt
+ * DESCRIPTION:     Starts a new minor cycle. UpdateCoreTimer adds
+ *                  TT_CORE_TICKS to the compare register so the next
+ *                  interrupt is exactly one minor cycle after this one
+ *                  regardless of interrupt latency.
+ * PARAMETER1:      None
+ * RETURN VALUE:    None
+ * Notes:           None
+ * END DESCRIPTION ************************************************************/
+void __ISR(_CORE_TIMER_VECTOR, ipl2) CoreTimerHandler(void)
+{
+    UpdateCoreTimer(TT_CORE_TICKS);
+    ttPendingCycles++;
+    mCTClearIntFlag();
+}
+
+/* End of tt_scheduler.c */
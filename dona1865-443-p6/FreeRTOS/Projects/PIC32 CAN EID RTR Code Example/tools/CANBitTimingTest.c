@@ -0,0 +1,133 @@
+/*  CANBitTimingTest.c
+ *
+ *  Host tool: checks CANSolveBitTiming against a table of known bit timings.
+ *
+ *  The expected settings were worked out by hand for an 80 MHz system
+ *  clock, a 10 m bus, a 150 ns transceiver delay and the target sample
+ *  points of the table. For each bit rate the solved segments, the sync
+ *  jump width, three time sampling, the sample point and the BRP that
+ *  CANSetSpeed derives from the number of TQ are compared. A bus that is
+ *  too long for 1 Mbit/s and a bit rate of 0 must have no solution.
+ *
+ *  Build:  gcc -I../h -o CANBitTimingTest CANBitTimingTest.c \
+ *              ../src/CANBitTiming.c
+ *  Usage:  CANBitTimingTest
+ *
+ *  The exit status is 0 when every case passes and 1 otherwise.
+*/
+
+#include <stdio.h>
+
+#include "GenericTypeDefs.h"
+#include "chipKIT_PRO_MX7.h"
+#include "CANBitTiming.h"
+
+#define TEST_BUS_LENGTH         10
+#define TEST_TRANSCEIVER_DELAY  150
+
+typedef struct
+{
+    UINT32 bitRate;
+    WORD targetPoint;
+    BYTE totalTq;
+    BYTE propagationTq;
+    BYTE phase1Tq;
+    BYTE phase2Tq;
+    BYTE syncJumpWidthTq;
+    BYTE brp;
+    BOOL sample3Time;
+    WORD samplePoint;
+} TIMING_CASE;
+
+static const TIMING_CASE cases[] =
+{
+    {  125000, 875, 16, 5, 8, 2, 2, 19, TRUE,  875 },
+    {  250000, 875, 16, 5, 8, 2, 2,  9, TRUE,  875 },
+    {  500000, 875, 16, 5, 8, 2, 2,  4, FALSE, 875 },
+    {  800000, 800, 10, 4, 3, 2, 2,  4, FALSE, 800 },
+    { 1000000, 875, 20, 8, 8, 3, 3,  1, FALSE, 850 },
+};
+
+#define CASES   (sizeof(cases) / sizeof(cases[0]))
+
+/* Private function prototypes */
+static BOOL check_case(const TIMING_CASE *c);
+
+int main(void)
+{
+CAN_BIT_TIMING timing;
+unsigned int failures = 0;
+unsigned int i;
+
+    for(i = 0; i < CASES; i++)
+    {
+        if(!check_case(&cases[i]))
+        {
+            failures++;
+        }
+    }
+
+    if(CANSolveBitTiming(SYSTEM_FREQ, 1000000, 40, TEST_TRANSCEIVER_DELAY,
+                         875, &timing))
+    {
+        printf("1000000 bit/s on a 40 m bus: solved, expected no timing  "
+               "FAIL\n");
+        failures++;
+    }
+    else
+    {
+        printf("1000000 bit/s on a 40 m bus: no timing  ok\n");
+    }
+
+    if(CANSolveBitTiming(SYSTEM_FREQ, 0, TEST_BUS_LENGTH,
+                         TEST_TRANSCEIVER_DELAY, 875, &timing))
+    {
+        printf("0 bit/s: solved, expected no timing  FAIL\n");
+        failures++;
+    }
+    else
+    {
+        printf("0 bit/s: no timing  ok\n");
+    }
+
+    printf("%s\n", (failures == 0) ? "All bit timing checks passed"
+                                   : "Bit timing checks failed");
+    return (failures == 0) ? 0 : 1;
+}
+
+/* check_case Function Description ********************************************
+ * SYNTAX:          static BOOL check_case(const TIMING_CASE *c);
+ * DESCRIPTION:     Solves the bit timing for one table entry on the test bus
+ *                  and prints the result.
+ * RETURN VALUE:    TRUE if the solution matches the entry, else FALSE
+ * END DESCRIPTION ************************************************************/
+static BOOL check_case(const TIMING_CASE *c)
+{
+CAN_BIT_TIMING t;
+UINT32 brp;
+BOOL pass;
+
+    if(!CANSolveBitTiming(SYSTEM_FREQ, c->bitRate, TEST_BUS_LENGTH,
+                          TEST_TRANSCEIVER_DELAY, c->targetPoint, &t))
+    {
+        printf("%7lu bit/s: no timing  FAIL\n", (unsigned long) c->bitRate);
+        return FALSE;
+    }
+
+    brp = SYSTEM_FREQ / (2 * (UINT32) t.totalTq * c->bitRate) - 1;
+    pass = (t.totalTq == c->totalTq)
+            && (t.propagationTq == c->propagationTq)
+            && (t.phase1Tq == c->phase1Tq) && (t.phase2Tq == c->phase2Tq)
+            && (t.syncJumpWidthTq == c->syncJumpWidthTq)
+            && (brp == c->brp) && (t.sample3Time == c->sample3Time)
+            && (t.samplePoint == c->samplePoint);
+
+    printf("%7lu bit/s: %2d TQ, prop %d, phase1 %d, phase2 %d, SJW %d, "
+           "BRP %2lu, sample3 %d, sample point %d  %s\n",
+           (unsigned long) c->bitRate, t.totalTq, t.propagationTq,
+           t.phase1Tq, t.phase2Tq, t.syncJumpWidthTq, (unsigned long) brp,
+           t.sample3Time, t.samplePoint, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+/* End of CANBitTimingTest.c */
@@ -0,0 +1,381 @@
+/*  CANBusAnalyzer.c
+ *
+ *  Host tool: CAN message set bus load and schedulability analyzer.
+ *
+ *  The bit rate, bus length and transceiver delay are taken from
+ *  CANFunctions.h and the bit timing is selected with the same
+ *  CANSolveBitTiming function used by the nodes. For each message the
+ *  worst case frame length including bit stuffing, the bus utilisation and
+ *  the worst case response time are computed with the non-preemptive fixed
+ *  priority analysis for CAN (Davis, Burns, Bril and Lukkien, 2007). Lower
+ *  IDs have higher priority.
+ *
+ *  Build:  gcc -I../h -o CANBusAnalyzer CANBusAnalyzer.c ../src/CANBitTiming.c
+ *  Usage:  CANBusAnalyzer [message_set_file]
+ *
+ *  Each line of the message set file describes one message:
+ *      name  id  ext  dlc  period_ms  jitter_ms  [deadline_ms]
+ *  where id is hexadecimal, ext is 1 for a 29 bit ID and 0 for an 11 bit
+ *  ID, and the deadline defaults to the period. Lines starting with '#' are
+ *  ignored. Without a file, the message set of this RTR example is used.
+ *
+ *  The exit status is 0 when every message meets its deadline and 1 when
+ *  the set is not schedulable.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GenericTypeDefs.h"
+#include "chipKIT_PRO_MX7.h"
+#include "CANFunctions.h"
+#include "CANBitTiming.h"
+
+#define MAX_MESSAGES    64
+#define MAX_NAME        24
+
+/* Fixed frame bits exposed to stuffing: SOF, ID, control and CRC fields. */
+#define STD_STUFFED_BITS    34
+#define EXT_STUFFED_BITS    54
+
+/* Fixed frame bits not exposed to stuffing: CRC delimiter, ACK, EOF and
+ * the 3 bit interframe space. */
+#define UNSTUFFED_BITS      13
+
+typedef struct
+{
+    char name[MAX_NAME];
+    UINT32 id;
+    BOOL isExtended;
+    BYTE dlc;
+    UINT64 period;      /* All times are in bit times */
+    UINT64 jitter;
+    UINT64 deadline;
+    UINT64 frameBits;   /* Worst case frame length, C */
+    UINT64 response;    /* Worst case response time, R */
+} CAN_MESSAGE;
+
+static CAN_MESSAGE messages[MAX_MESSAGES];
+static int messageCount = 0;
+
+/* Private function prototypes */
+static void add_message(const char *name, UINT32 id, BOOL isExtended,
+                        BYTE dlc, double period, double jitter,
+                        double deadline);
+static int load_message_set(const char *fileName);
+static void load_default_set(void);
+static UINT64 frame_bits(BOOL isExtended, BYTE dlc);
+static int compare_priority(const void *a, const void *b);
+static UINT32 arbitration_key(const CAN_MESSAGE *msg);
+static UINT64 response_time(int m);
+
+int main(int argc, char *argv[])
+{
+CAN_BIT_TIMING timing;
+double utilisation = 0.0;
+double bitUs = 1000000.0 / CAN_BUS_SPEED;
+BOOL schedulable = TRUE;
+int i;
+
+    if(argc > 1)
+    {
+        if(load_message_set(argv[1]) != 0)
+        {
+            return 2;
+        }
+    }
+    else
+    {
+        load_default_set();
+    }
+
+    printf("Bit rate %d bit/s, bus length %d m, transceiver delay %d ns\n",
+           CAN_BUS_SPEED, CAN_BUS_LENGTH, CAN_TRANSCEIVER_DELAY);
+    if(CANSolveBitTiming(SYSTEM_FREQ, CAN_BUS_SPEED, CAN_BUS_LENGTH,
+                         CAN_TRANSCEIVER_DELAY, CAN_SAMPLE_POINT, &timing))
+    {
+        printf("Bit timing %d TQ: prop %d, phase1 %d, phase2 %d, SJW %d, "
+               "BRP %d, sample point %d.%d%%\n\n", timing.totalTq,
+               timing.propagationTq, timing.phase1Tq, timing.phase2Tq,
+               timing.syncJumpWidthTq,
+               (int) (SYSTEM_FREQ / (2 * timing.totalTq * CAN_BUS_SPEED) - 1),
+               timing.samplePoint / 10, timing.samplePoint % 10);
+    }
+    else
+    {
+        printf("No valid bit timing for this bus, the node falls back to "
+               "the fixed 10 TQ setting\n\n");
+    }
+
+    qsort(messages, messageCount, sizeof(CAN_MESSAGE), compare_priority);
+
+    for(i = 0; i < messageCount; i++)
+    {
+        messages[i].frameBits = frame_bits(messages[i].isExtended,
+                                           messages[i].dlc);
+        utilisation += (double) messages[i].frameBits / messages[i].period;
+    }
+
+    printf("%-*s %10s %3s %6s %10s %10s %10s  %s\n", MAX_NAME - 1, "Message",
+           "ID", "DLC", "C(bit)", "T(ms)", "D(ms)", "R(ms)", "Status");
+    for(i = 0; i < messageCount; i++)
+    {
+        CAN_MESSAGE *msg = &messages[i];
+
+        msg->response = response_time(i);
+        printf("%-*s %10lX %3d %6llu %10.3f %10.3f ", MAX_NAME - 1,
+               msg->name, (unsigned long) msg->id, msg->dlc,
+               (unsigned long long) msg->frameBits,
+               msg->period * bitUs / 1000.0, msg->deadline * bitUs / 1000.0);
+        if(msg->response > msg->deadline)
+        {
+            printf("%10s  UNSCHEDULABLE\n", "-");
+            schedulable = FALSE;
+        }
+        else
+        {
+            printf("%10.3f  ok\n", msg->response * bitUs / 1000.0);
+        }
+    }
+
+    printf("\nBus utilisation %.2f%%\n", utilisation * 100.0);
+    if(utilisation > 1.0)
+    {
+        printf("Bus is overloaded\n");
+        schedulable = FALSE;
+    }
+    printf("Message set is %s\n", schedulable ? "schedulable"
+                                                : "NOT schedulable");
+    return schedulable ? 0 : 1;
+}
+
+/* add_message Function Description *******************************************
+ * SYNTAX:          static void add_message(const char *name, UINT32 id,
+ *                          BOOL isExtended, BYTE dlc, double period,
+ *                          double jitter, double deadline);
+ * DESCRIPTION:     Appends a message to the message set. Times are given in
+ *                  ms and converted to bit times at CAN_BUS_SPEED.
+ * END DESCRIPTION ************************************************************/
+static void add_message(const char *name, UINT32 id, BOOL isExtended,
+                        BYTE dlc, double period, double jitter,
+                        double deadline)
+{
+CAN_MESSAGE *msg;
+double bitsPerMs = CAN_BUS_SPEED / 1000.0;
+
+    if(messageCount >= MAX_MESSAGES)
+    {
+        fprintf(stderr, "Too many messages, %s ignored\n", name);
+        return;
+    }
+    msg = &messages[messageCount++];
+    strncpy(msg->name, name, MAX_NAME - 1);
+    msg->name[MAX_NAME - 1] = '\0';
+    msg->id = id;
+    msg->isExtended = isExtended;
+    msg->dlc = (dlc > 8) ? 8 : dlc;
+    msg->period = (UINT64) (period * bitsPerMs + 0.5);
+    msg->jitter = (UINT64) (jitter * bitsPerMs + 0.5);
+    msg->deadline = (UINT64) (deadline * bitsPerMs + 0.5);
+    if(msg->period == 0)
+    {
+        msg->period = 1;
+    }
+}
+
+/* load_message_set Function Description **************************************
+ * SYNTAX:          static int load_message_set(const char *fileName);
+ * DESCRIPTION:     Reads the message set file described at the top of this
+ *                  file.
+ * RETURN VALUE:    0 on success, -1 if the file cannot be read.
+ * END DESCRIPTION ************************************************************/
+static int load_message_set(const char *fileName)
+{
+FILE *fp;
+char line[256];
+char name[MAX_NAME];
+unsigned long id;
+int ext, dlc, fields, lineNumber = 0;
+double period, jitter, deadline;
+
+    fp = fopen(fileName, "r");
+    if(fp == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), fp) != NULL)
+    {
+        lineNumber++;
+        if((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0'))
+        {
+            continue;
+        }
+        fields = sscanf(line, "%23s %lx %d %d %lf %lf %lf", name, &id, &ext,
+                        &dlc, &period, &jitter, &deadline);
+        if(fields < 6)
+        {
+            fprintf(stderr, "%s:%d: expected name id ext dlc period jitter "
+                    "[deadline]\n", fileName, lineNumber);
+            continue;
+        }
+        if(fields == 6)
+        {
+            deadline = period;
+        }
+        add_message(name, (UINT32) id, ext ? TRUE : FALSE, (BYTE) dlc,
+                    period, jitter, deadline);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* load_default_set Function Description **************************************
+ * SYNTAX:          static void load_default_set(void);
+ * DESCRIPTION:     Loads the traffic of this example: processor_A sends the
+ *                  CAN2_MSG_ID remote request every 100 ms and processor_B
+ *                  answers with the 1 byte LED1_INDICATION_MSG data frame.
+ *                  The reply is released by the request, so it inherits the
+ *                  request period and the request response time as jitter.
+ * END DESCRIPTION ************************************************************/
+static void load_default_set(void)
+{
+    add_message("CAN1 RTR request", CAN2_MSG_ID, TRUE, 0, 100.0, 0.0, 100.0);
+    add_message("CAN2 LED1 reply", LED1_INDICATION_MSG, TRUE, 1, 100.0,
+                0.5, 100.0);
+}
+
+/* frame_bits Function Description ********************************************
+ * SYNTAX:          static UINT64 frame_bits(BOOL isExtended, BYTE dlc);
+ * DESCRIPTION:     Worst case length of a data frame in bits, including the
+ *                  maximum number of stuff bits: g + 8s + 13 +
+ *                  floor((g + 8s - 1) / 4), where g is 34 for an 11 bit ID
+ *                  and 54 for a 29 bit ID. Remote frames have dlc 0.
+ * END DESCRIPTION ************************************************************/
+static UINT64 frame_bits(BOOL isExtended, BYTE dlc)
+{
+UINT64 g = isExtended ? EXT_STUFFED_BITS : STD_STUFFED_BITS;
+UINT64 stuffed = g + 8 * (UINT64) dlc;
+
+    return stuffed + UNSTUFFED_BITS + (stuffed - 1) / 4;
+}
+
+/* compare_priority Function Description **************************************
+ * SYNTAX:          static int compare_priority(const void *a, const void *b);
+ * DESCRIPTION:     qsort comparison that orders messages by priority. An
+ *                  11 bit ID is compared with the top 11 bits of a 29 bit
+ *                  ID, and a standard frame wins over an extended frame with
+ *                  the same base ID.
+ * END DESCRIPTION ************************************************************/
+static int compare_priority(const void *a, const void *b)
+{
+const CAN_MESSAGE *x = a;
+const CAN_MESSAGE *y = b;
+UINT32 keyX = arbitration_key(x);
+UINT32 keyY = arbitration_key(y);
+
+    return (keyX > keyY) - (keyX < keyY);
+}
+
+/* arbitration_key Function Description ***************************************
+ * SYNTAX:          static UINT32 arbitration_key(const CAN_MESSAGE *msg);
+ * DESCRIPTION:     Returns a value that orders frames as bus arbitration
+ *                  does: the 11 bit base ID first, then the IDE bit, then
+ *                  the 18 bit ID extension. Lower values win.
+ * END DESCRIPTION ************************************************************/
+static UINT32 arbitration_key(const CAN_MESSAGE *msg)
+{
+    if(msg->isExtended)
+    {
+        return ((msg->id >> 18) & SID_BIT_MASK) << 19 | (1UL << 18)
+                | (msg->id & EID_BIT_MASK);
+    }
+    return (msg->id & SID_BIT_MASK) << 19;
+}
+
+/* response_time Function Description *****************************************
+ * SYNTAX:          static UINT64 response_time(int m);
+ * DESCRIPTION:     Worst case response time of message m in bit times. The
+ *                  messages must be sorted by priority. Blocking B is the
+ *                  longest lower priority frame. The level-m busy period is
+ *                  found first and every instance q released in it is
+ *                  checked:
+ *                      w(q) = B + q*C(m) + sum over higher priority k of
+ *                             ceil((w(q) + J(k) + 1) / T(k)) * C(k)
+ *                      R(q) = J(m) + w(q) - q*T(m) + C(m)
+ *                  Returns a value greater than the deadline if the
+ *                  iteration does not converge within the deadline.
+ * END DESCRIPTION ************************************************************/
+static UINT64 response_time(int m)
+{
+CAN_MESSAGE *msg = &messages[m];
+UINT64 blocking = 0, busy, next, w, r, worst = 0;
+UINT64 limit = msg->deadline + msg->jitter + msg->period;
+UINT64 q, instances;
+int k;
+
+    for(k = m + 1; k < messageCount; k++)
+    {
+        if(messages[k].frameBits > blocking)
+        {
+            blocking = messages[k].frameBits;
+        }
+    }
+
+/* Level-m busy period. */
+    busy = msg->frameBits;
+    do
+    {
+        next = blocking;
+        for(k = 0; k <= m; k++)
+        {
+            next += ((busy + messages[k].jitter + messages[k].period - 1)
+                        / messages[k].period) * messages[k].frameBits;
+        }
+        if(next == busy)
+        {
+            break;
+        }
+        busy = next;
+    } while(busy <= 16 * limit);
+
+    instances = (busy + msg->jitter + msg->period - 1) / msg->period;
+    if(instances == 0)
+    {
+        instances = 1;
+    }
+
+    for(q = 0; q < instances; q++)
+    {
+        w = blocking + q * msg->frameBits;
+        do
+        {
+            next = blocking + q * msg->frameBits;
+            for(k = 0; k < m; k++)
+            {
+                next += ((w + messages[k].jitter + 1 + messages[k].period - 1)
+                            / messages[k].period) * messages[k].frameBits;
+            }
+            if(next == w)
+            {
+                break;
+            }
+            w = next;
+        } while(w <= limit + q * msg->period);
+
+        r = msg->jitter + w + msg->frameBits - q * msg->period;
+        if(r > worst)
+        {
+            worst = r;
+        }
+        if(worst > msg->deadline)
+        {
+            break;
+        }
+    }
+    return worst;
+}
+
+/* End of CANBusAnalyzer.c */
@@ -0,0 +1,97 @@
+/*  CANLayoutTest.c
+ *
+ *  Host tool: checks the channel layout helpers of CANFunctions.h.
+ *
+ *  The CAN_LAYOUT_BYTES, CAN_LAYOUT_COUNT and CAN_LAYOUT_INVALID helpers
+ *  are applied to the CAN1 and CAN2 layouts of this example and to test
+ *  layouts for the edge cases: the default CAN1 layout, the CAN1 layout
+ *  with a data-only Rx channel, a channel with 0 or 33 buffers, a buffer
+ *  size other than 8 or 16 bytes and a Tx channel with data-only buffers.
+ *  The helpers are expanded into C expressions here, so the cases that
+ *  stop the node build with #error are evaluated instead of compiled.
+ *
+ *  Build:  gcc -I../h -o CANLayoutTest CANLayoutTest.c
+ *  Usage:  CANLayoutTest
+ *
+ *  The exit status is 0 when every case passes and 1 otherwise.
+*/
+
+#include <stdio.h>
+
+#include "GenericTypeDefs.h"
+#include "CANFunctions.h"
+
+/* CAN1 layout with a data-only Rx channel. */
+#define DATA_ONLY_LAYOUT(CH)                                        \
+    CH(CAN_LAYOUT_TX, 8, CAN_MSG_BUFF_SIZE)                         \
+    CH(CAN_LAYOUT_RX, 8, CAN_DATA_ONLY_BUFF_SIZE)                   \
+    CH(CAN_LAYOUT_TX, 8, CAN_MSG_BUFF_SIZE)                         \
+    CH(CAN_LAYOUT_TX, 8, CAN_MSG_BUFF_SIZE)
+
+#define MAX_BUFFERS_LAYOUT(CH)                                      \
+    CH(CAN_LAYOUT_TX, CAN_MAX_FIFO_BUFFERS, CAN_MSG_BUFF_SIZE)
+
+#define NO_BUFFERS_LAYOUT(CH)                                       \
+    CH(CAN_LAYOUT_TX, 8, CAN_MSG_BUFF_SIZE)                         \
+    CH(CAN_LAYOUT_RX, 0, CAN_MSG_BUFF_SIZE)
+
+#define TOO_MANY_BUFFERS_LAYOUT(CH)                                 \
+    CH(CAN_LAYOUT_RX, CAN_MAX_FIFO_BUFFERS + 1, CAN_MSG_BUFF_SIZE)
+
+#define BAD_SIZE_LAYOUT(CH)                                         \
+    CH(CAN_LAYOUT_RX, 8, 12)
+
+#define TX_DATA_ONLY_LAYOUT(CH)                                     \
+    CH(CAN_LAYOUT_TX, 8, CAN_DATA_ONLY_BUFF_SIZE)                   \
+    CH(CAN_LAYOUT_RX, 8, CAN_MSG_BUFF_SIZE)
+
+#define LAYOUT_BYTES(LIST)      (0 LIST(CAN_LAYOUT_BYTES))
+#define LAYOUT_COUNT(LIST)      (0 LIST(CAN_LAYOUT_COUNT))
+#define LAYOUT_INVALID(LIST)    (0 LIST(CAN_LAYOUT_INVALID))
+
+static unsigned int failures = 0;
+
+/* Private function prototypes */
+static void check(const char *name, long actual, long expected);
+
+int main(void)
+{
+    check("CAN1 channels", CAN1_CHANNELS, 4);
+    check("CAN1 bytes", CAN1_MSG_MEMORY, 512);
+    check("CAN1 invalid", LAYOUT_INVALID(CAN1_CHANNEL_LAYOUT), 0);
+    check("CAN2 channels", CAN2_CHANNELS, 1);
+    check("CAN2 bytes", CAN2_MSG_MEMORY, 128);
+    check("CAN2 invalid", LAYOUT_INVALID(CAN2_CHANNEL_LAYOUT), 0);
+
+    check("Data-only Rx bytes", LAYOUT_BYTES(DATA_ONLY_LAYOUT), 448);
+    check("Data-only Rx invalid", LAYOUT_INVALID(DATA_ONLY_LAYOUT), 0);
+    check("32 buffers bytes", LAYOUT_BYTES(MAX_BUFFERS_LAYOUT), 512);
+    check("32 buffers invalid", LAYOUT_INVALID(MAX_BUFFERS_LAYOUT), 0);
+    check("0 buffers channels", LAYOUT_COUNT(NO_BUFFERS_LAYOUT), 2);
+    check("0 buffers invalid", LAYOUT_INVALID(NO_BUFFERS_LAYOUT), 1);
+    check("33 buffers invalid", LAYOUT_INVALID(TOO_MANY_BUFFERS_LAYOUT), 1);
+    check("12 byte buffers invalid", LAYOUT_INVALID(BAD_SIZE_LAYOUT), 1);
+    check("Data-only Tx invalid", LAYOUT_INVALID(TX_DATA_ONLY_LAYOUT), 1);
+
+    printf("%s\n", (failures == 0) ? "All layout checks passed"
+                                   : "Layout checks failed");
+    return (failures == 0) ? 0 : 1;
+}
+
+/* check Function Description *************************************************
+ * SYNTAX:          static void check(const char *name, long actual,
+ *                                    long expected);
+ * DESCRIPTION:     Prints the result of one case and counts it as a failure
+ *                  when actual differs from expected.
+ * END DESCRIPTION ************************************************************/
+static void check(const char *name, long actual, long expected)
+{
+    printf("%-24s %5ld  %s\n", name, actual,
+           (actual == expected) ? "ok" : "FAIL");
+    if(actual != expected)
+    {
+        failures++;
+    }
+}
+
+/* End of CANLayoutTest.c */
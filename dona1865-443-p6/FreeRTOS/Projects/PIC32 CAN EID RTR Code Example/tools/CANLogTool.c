@@ -0,0 +1,447 @@
+/*  CANLogTool.c
+ *
+ *  Host tool: decoder and replay tool for logs exported with CANLogExport.
+ *
+ *  Build:  gcc -I../h -o CANLogTool CANLogTool.c
+ *  Usage:  CANLogTool dump   log_file
+ *          CANLogTool list   log_file
+ *          CANLogTool replay log_file [speed [max_delay_us]]
+ *
+ *  dump prints the frames in the candump log format, for example
+ *      (0000000001.000100) can1 08004004#R
+ *  which can be read by canplayer and the other can-utils tools. The time
+ *  is the core timer time of the node in seconds. CAN1 frames are shown on
+ *  can1 and CAN2 frames on can2.
+ *
+ *  list prints every record with its direction and FIFO level.
+ *
+ *  replay sends the frames into a simulated bus at CAN_BUS_SPEED. Each
+ *  frame is released at its logged time divided by speed, so a speed of 1
+ *  replays the original timing and a speed of 10 compresses the traffic ten
+ *  times. Pending frames are arbitrated by ID and each frame occupies the
+ *  bus for its worst case stuffed length. Tx records are replayed. Rx
+ *  records are only replayed when their ID is never transmitted in the log,
+ *  since those frames came from nodes that were not logged. The frames are
+ *  printed in the candump log format with the simulated end of frame time,
+ *  followed by the bus load and the queueing delay between release and
+ *  start of transmission. The exit status is 1 when max_delay_us is given
+ *  and a frame waited longer, which allows the replay to be used as a
+ *  performance regression test.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GenericTypeDefs.h"
+#include "CANFunctions.h"
+#include "CANLogger.h"
+
+#define MAX_RECORDS     (CAN_LOG_SIZE / 4)
+
+/* Fixed frame bits exposed to stuffing and fixed bits not exposed to
+ * stuffing, see CANBusAnalyzer.c. */
+#define STD_STUFFED_BITS    34
+#define EXT_STUFFED_BITS    54
+#define UNSTUFFED_BITS      13
+
+typedef struct
+{
+    UINT64 timeUs;      /* Time since the node core timer was 0 */
+    BYTE flags;
+    BYTE dlc;
+    BYTE level;
+    UINT32 id;
+    BYTE data[8];
+    BOOL done;          /* Replay: sent on the bus or not replayed */
+} LOG_RECORD;
+
+static LOG_RECORD records[MAX_RECORDS];
+static int recordCount = 0;
+static UINT16 droppedCount = 0;
+
+/* Private function prototypes */
+static int load_log(const char *fileName);
+static int get_varint(const BYTE *buffer, int length, int *index,
+                      UINT32 *value);
+static void print_frame(UINT64 timeUs, const LOG_RECORD *rec);
+static void list_records(void);
+static int replay(double speed, double maxDelayUs);
+static UINT64 frame_bits(BOOL isExtended, BYTE dlc);
+static UINT32 arbitration_key(const LOG_RECORD *rec);
+
+int main(int argc, char *argv[])
+{
+int i;
+
+    if(argc < 3)
+    {
+        fprintf(stderr, "Usage: %s dump|list|replay log_file "
+                        "[speed [max_delay_us]]\n", argv[0]);
+        return 2;
+    }
+    if(load_log(argv[2]) != 0)
+    {
+        return 2;
+    }
+
+    if(strcmp(argv[1], "dump") == 0)
+    {
+        for(i = 0; i < recordCount; i++)
+        {
+            print_frame(records[i].timeUs, &records[i]);
+        }
+        return 0;
+    }
+    if(strcmp(argv[1], "list") == 0)
+    {
+        list_records();
+        return 0;
+    }
+    if(strcmp(argv[1], "replay") == 0)
+    {
+        double speed = (argc > 3) ? atof(argv[3]) : 1.0;
+        double maxDelayUs = (argc > 4) ? atof(argv[4]) : -1.0;
+
+        if(speed <= 0.0)
+        {
+            fprintf(stderr, "speed must be greater than 0\n");
+            return 2;
+        }
+        return replay(speed, maxDelayUs);
+    }
+
+    fprintf(stderr, "Unknown command %s\n", argv[1]);
+    return 2;
+}
+
+/* load_log Function Description **********************************************
+ * SYNTAX:          static int load_log(const char *fileName);
+ * DESCRIPTION:     Reads and decodes a log exported with CANLogExport.
+ * RETURN VALUE:    0 on success, -1 if the file cannot be read or is not a
+ *                  valid log
+ * END DESCRIPTION ************************************************************/
+static int load_log(const char *fileName)
+{
+static BYTE buffer[CAN_LOG_HEADER_SIZE + CAN_LOG_SIZE + 1];
+FILE *file;
+int length;
+int used;
+int index;
+UINT64 timeUs;
+UINT32 delta;
+LOG_RECORD *rec;
+int i;
+
+    file = fopen(fileName, "rb");
+    if(file == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+    length = (int) fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+
+    if((length < CAN_LOG_HEADER_SIZE)
+        || (memcmp(buffer, CAN_LOG_MAGIC, 4) != 0))
+    {
+        fprintf(stderr, "%s: not a CAN log\n", fileName);
+        return -1;
+    }
+    timeUs = buffer[4] | (buffer[5] << 8) | (buffer[6] << 16)
+                | ((UINT32) buffer[7] << 24);
+    used = buffer[8] | (buffer[9] << 8);
+    droppedCount = buffer[10] | (buffer[11] << 8);
+    if(length < CAN_LOG_HEADER_SIZE + used)
+    {
+        fprintf(stderr, "%s: log is truncated\n", fileName);
+        return -1;
+    }
+
+    index = CAN_LOG_HEADER_SIZE;
+    length = CAN_LOG_HEADER_SIZE + used;
+    while(index < length)
+    {
+        if(recordCount == MAX_RECORDS)
+        {
+            fprintf(stderr, "%s: too many records\n", fileName);
+            return -1;
+        }
+        rec = &records[recordCount];
+        if(index + 2 > length)
+        {
+            break;
+        }
+        rec->flags = buffer[index] & ~CAN_LOG_DLC_MASK;
+        rec->dlc = buffer[index] & CAN_LOG_DLC_MASK;
+        rec->level = buffer[index + 1];
+        index += 2;
+        if((get_varint(buffer, length, &index, &delta) != 0)
+            || (get_varint(buffer, length, &index, &rec->id) != 0))
+        {
+            break;
+        }
+        if((rec->flags & CAN_LOG_FLAG_RTR) == 0)
+        {
+            if((rec->dlc > 8) || (index + rec->dlc > length))
+            {
+                break;
+            }
+            for(i = 0; i < rec->dlc; i++)
+            {
+                rec->data[i] = buffer[index++];
+            }
+        }
+        timeUs += delta;
+        rec->timeUs = timeUs;
+        recordCount++;
+    }
+
+    if(index != length)
+    {
+        fprintf(stderr, "%s: corrupt record at byte %d\n", fileName, index);
+        return -1;
+    }
+    if(droppedCount != 0)
+    {
+        fprintf(stderr, "%s: %u older records were overwritten on the node\n",
+                fileName, droppedCount);
+    }
+    return 0;
+}
+
+/* get_varint Function Description ********************************************
+ * SYNTAX:          static int get_varint(const BYTE *buffer, int length,
+ *                                        int *index, UINT32 *value);
+ * DESCRIPTION:     Decodes the varint at *index and advances *index.
+ * RETURN VALUE:    0 on success, -1 if the varint is truncated or too long
+ * END DESCRIPTION ************************************************************/
+static int get_varint(const BYTE *buffer, int length, int *index,
+                      UINT32 *value)
+{
+int shift = 0;
+BYTE b;
+
+    *value = 0;
+    do
+    {
+        if((*index >= length) || (shift > 28))
+        {
+            return -1;
+        }
+        b = buffer[(*index)++];
+        *value |= (UINT32) (b & 0x7F) << shift;
+        shift += 7;
+    } while(b & 0x80);
+    return 0;
+}
+
+/* print_frame Function Description *******************************************
+ * SYNTAX:          static void print_frame(UINT64 timeUs,
+ *                                          const LOG_RECORD *rec);
+ * DESCRIPTION:     Prints a frame in the candump log format.
+ * END DESCRIPTION ************************************************************/
+static void print_frame(UINT64 timeUs, const LOG_RECORD *rec)
+{
+int i;
+
+    printf("(%010llu.%06llu) can%c ", (unsigned long long) (timeUs / 1000000),
+           (unsigned long long) (timeUs % 1000000),
+           (rec->flags & CAN_LOG_FLAG_CAN2) ? '2' : '1');
+    if(rec->flags & CAN_LOG_FLAG_EXT)
+    {
+        printf("%08lX#", (unsigned long) rec->id);
+    }
+    else
+    {
+        printf("%03lX#", (unsigned long) rec->id);
+    }
+    if(rec->flags & CAN_LOG_FLAG_RTR)
+    {
+        printf("R\n");
+        return;
+    }
+    for(i = 0; i < rec->dlc; i++)
+    {
+        printf("%02X", rec->data[i]);
+    }
+    printf("\n");
+}
+
+/* list_records Function Description ******************************************
+ * SYNTAX:          static void list_records(void);
+ * DESCRIPTION:     Prints every record with the time since the previous
+ *                  record, the direction and the FIFO level.
+ * END DESCRIPTION ************************************************************/
+static void list_records(void)
+{
+UINT64 previous = recordCount ? records[0].timeUs : 0;
+int i;
+
+    printf("%12s %10s %4s %2s %5s  %s\n", "Delta(us)", "Module", "Dir",
+           "Lv", "DLC", "Frame");
+    for(i = 0; i < recordCount; i++)
+    {
+        LOG_RECORD *rec = &records[i];
+
+        printf("%12llu %10s %4s %2d %5d  ",
+               (unsigned long long) (rec->timeUs - previous),
+               (rec->flags & CAN_LOG_FLAG_CAN2) ? "CAN2" : "CAN1",
+               (rec->flags & CAN_LOG_FLAG_TX) ? "Tx" : "Rx", rec->level,
+               rec->dlc);
+        print_frame(rec->timeUs, rec);
+        previous = rec->timeUs;
+    }
+    printf("%d records, %u overwritten\n", recordCount, droppedCount);
+}
+
+/* replay Function Description ************************************************
+ * SYNTAX:          static int replay(double speed, double maxDelayUs);
+ * DESCRIPTION:     Replays the log on a simulated bus. Time is kept in bit
+ *                  times. At each step the bus either starts the released
+ *                  frame that wins arbitration or idles until the next
+ *                  release.
+ * RETURN VALUE:    1 if maxDelayUs is not negative and was exceeded, else 0
+ * END DESCRIPTION ************************************************************/
+static int replay(double speed, double maxDelayUs)
+{
+static UINT64 release[MAX_RECORDS];
+double bitUs = 1000000.0 / CAN_BUS_SPEED;
+UINT64 now = 0;
+UINT64 busy = 0;
+UINT64 bits;
+UINT64 delay;
+UINT64 maxDelay = 0;
+UINT64 totalDelay = 0;
+UINT64 startUs;
+int frames = 0;
+int pending = 0;
+int best;
+int i, j;
+
+    if(recordCount == 0)
+    {
+        printf("Log is empty\n");
+        return 0;
+    }
+    startUs = records[0].timeUs;
+
+/* Select the frames to replay. */
+    for(i = 0; i < recordCount; i++)
+    {
+        BOOL inject = (records[i].flags & CAN_LOG_FLAG_TX) != 0;
+
+        if(!inject)
+        {
+            inject = TRUE;
+            for(j = 0; j < recordCount; j++)
+            {
+                if((records[j].flags & CAN_LOG_FLAG_TX)
+                    && (records[j].id == records[i].id))
+                {
+                    inject = FALSE;
+                    break;
+                }
+            }
+        }
+        records[i].done = !inject;
+        release[i] = (UINT64) ((records[i].timeUs - startUs) / speed / bitUs);
+        if(inject)
+        {
+            pending++;
+        }
+    }
+
+    while(pending > 0)
+    {
+/* Arbitration among the frames released by now. Lower keys win. */
+        best = -1;
+        for(i = 0; i < recordCount; i++)
+        {
+            if(records[i].done || (release[i] > now))
+            {
+                continue;
+            }
+            if((best < 0) || (arbitration_key(&records[i])
+                                < arbitration_key(&records[best])))
+            {
+                best = i;
+            }
+        }
+
+        if(best < 0)
+        {
+/* Bus idle until the next release. Records are in time order so this is
+ * the first record not done. */
+            for(i = 0; records[i].done; i++);
+            now = release[i];
+            continue;
+        }
+
+        delay = now - release[best];
+        totalDelay += delay;
+        if(delay > maxDelay)
+        {
+            maxDelay = delay;
+        }
+        bits = frame_bits(records[best].flags & CAN_LOG_FLAG_EXT,
+                          (records[best].flags & CAN_LOG_FLAG_RTR)
+                            ? 0 : records[best].dlc);
+        now += bits;
+        busy += bits;
+        records[best].done = TRUE;
+        print_frame(startUs + (UINT64) (now * bitUs), &records[best]);
+        frames++;
+        pending--;
+    }
+
+    printf("\nReplayed %d frames at %.2fx speed, %d bit/s\n", frames, speed,
+           CAN_BUS_SPEED);
+    printf("Bus load %.2f%%\n", (now > 0) ? 100.0 * busy / now : 0.0);
+    printf("Queueing delay average %.1f us, maximum %.1f us\n",
+           frames ? totalDelay * bitUs / frames : 0.0, maxDelay * bitUs);
+
+    if((maxDelayUs >= 0.0) && (maxDelay * bitUs > maxDelayUs))
+    {
+        printf("Maximum delay exceeds %.1f us\n", maxDelayUs);
+        return 1;
+    }
+    return 0;
+}
+
+/* frame_bits Function Description ********************************************
+ * SYNTAX:          static UINT64 frame_bits(BOOL isExtended, BYTE dlc);
+ * DESCRIPTION:     Worst case length of a frame in bits including the stuff
+ *                  bits and the interframe space. Remote frames have dlc 0.
+ * END DESCRIPTION ************************************************************/
+static UINT64 frame_bits(BOOL isExtended, BYTE dlc)
+{
+UINT64 g = isExtended ? EXT_STUFFED_BITS : STD_STUFFED_BITS;
+UINT64 stuffed = g + 8 * (UINT64) dlc;
+
+    return stuffed + UNSTUFFED_BITS + (stuffed - 1) / 4;
+}
+
+/* arbitration_key Function Description ***************************************
+ * SYNTAX:          static UINT32 arbitration_key(const LOG_RECORD *rec);
+ * DESCRIPTION:     Orders frames as bus arbitration does: the 11 bit base
+ *                  ID, then the IDE bit, then the 18 bit ID extension. A
+ *                  data frame wins over a remote frame with the same ID.
+ * END DESCRIPTION ************************************************************/
+static UINT32 arbitration_key(const LOG_RECORD *rec)
+{
+UINT32 key;
+
+    if(rec->flags & CAN_LOG_FLAG_EXT)
+    {
+        key = ((rec->id >> 18) & SID_BIT_MASK) << 19 | (1UL << 18)
+                | (rec->id & EID_BIT_MASK);
+    }
+    else
+    {
+        key = (rec->id & SID_BIT_MASK) << 19;
+    }
+    return (key << 1) | ((rec->flags & CAN_LOG_FLAG_RTR) ? 1 : 0);
+}
+
+/* End of CANLogTool.c */
@@ -0,0 +1,364 @@
+/*  CANTxLatencySim.c
+ *
+ *  Host tool: transmit latency of CAN1 frames with a single Tx channel and
+ *  with the three transmit class channels of CANFunctions.h.
+ *
+ *  One node sends a periodic message set at CAN_BUS_SPEED: urgent control
+ *  frames, status frames, the RTR request of this example and bursts of
+ *  bulk telemetry. The bulk burst period is chosen so that the bus load is
+ *  the given percentage. Every release posts its frames and flushes, as
+ *  CAN1TxPostMsg and CAN1TxFlush do. A frame that finds its channel full is
+ *  dropped.
+ *
+ *  With the single channel all frames share one FIFO of SINGLE_TX_BUFFERS
+ *  buffers, which is how CAN1 transmitted before the transmit classes. With
+ *  the class channels each message is posted in the class selected by
+ *  CAN1_TX_CLASS_FOR_DEADLINE from its deadline, and the bus takes the head
+ *  of the highest priority channel that is not empty. A frame on the bus is
+ *  never preempted. Frame lengths are the worst case including bit stuffing.
+ *
+ *  For each class the tool prints the frames sent and dropped, the p99 and
+ *  maximum latency from release to the end of the frame, and the deadline
+ *  misses. The exit status is 1 when an urgent frame misses its deadline or
+ *  is dropped with the class channels.
+ *
+ *  Build:  gcc -I../h -o CANTxLatencySim CANTxLatencySim.c
+ *  Usage:  CANTxLatencySim [seconds [load_percent]]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "GenericTypeDefs.h"
+#include "chipKIT_PRO_MX7.h"
+#include "CANFunctions.h"
+#include "tt_scheduler.h"
+
+#define DEFAULT_SECONDS         10
+#define DEFAULT_LOAD_PERCENT    80
+
+/* Buffers of the single Tx channel CAN1 had before the transmit classes. */
+#define SINGLE_TX_BUFFERS       8
+
+/* Fixed frame bits of a 29 bit ID frame exposed to stuffing, and the bits
+ * not exposed to stuffing, as in CANBusAnalyzer. */
+#define EXT_STUFFED_BITS        54
+#define UNSTUFFED_BITS          13
+
+/* Times are in bit times. */
+#define BITS_PER_MS     ((UINT64) CAN_BUS_SPEED / 1000)
+
+typedef struct
+{
+    const char *name;
+    BYTE dlc;
+    unsigned int burst;         /* Frames posted per release */
+    UINT64 periodUs;            /* 0 for the bulk stream, set from the load */
+    UINT64 deadlineMs;
+    UINT64 offsetUs;            /* First release */
+} CAN_STREAM;
+
+static CAN_STREAM streams[] =
+{
+    { "urgent control",   8, 1, 10000,  5,    0    },
+    { "status",           4, 1, 20000,  20,   1300 },
+    { "RTR request",      0, 1, 100000, TT_MINOR_CYCLE_MS, 2700 },
+    { "bulk telemetry",   8, 8, 0,      1000, 3100 },
+};
+
+#define STREAMS     (sizeof(streams) / sizeof(streams[0]))
+#define BULK_STREAM (STREAMS - 1)
+
+/* A posted frame waiting in a channel. */
+typedef struct
+{
+    UINT64 release;
+    unsigned int stream;
+} CAN_FRAME;
+
+typedef struct
+{
+    CAN_FRAME frames[CAN_MAX_FIFO_BUFFERS];
+    unsigned int size;
+    unsigned int head;
+    unsigned int count;
+} CAN_CHANNEL;
+
+/* Statistics of one class in one run. */
+typedef struct
+{
+    UINT64 *latency;
+    UINT64 sent;
+    UINT64 dropped;
+    UINT64 missed;
+} CLASS_STATS;
+
+/* Private function prototypes */
+static UINT64 frame_bits(BYTE dlc);
+static CAN1_TX_CLASS stream_class(unsigned int stream);
+static int compare_time(const void *a, const void *b);
+static void simulate(BOOL isClassChannels, UINT64 endTime,
+                     CLASS_STATS *stats);
+
+int main(int argc, char *argv[])
+{
+unsigned int seconds = DEFAULT_SECONDS;
+unsigned int loadPercent = DEFAULT_LOAD_PERCENT;
+CLASS_STATS stats[2][CAN1_TX_CLASSES];
+static const char *classNames[CAN1_TX_CLASSES] =
+    { "urgent", "normal", "bulk" };
+double load = 0.0;
+UINT64 capacity, endTime;
+BOOL isMissed;
+unsigned int i, mode, c;
+
+    if(argc > 1)
+    {
+        seconds = (unsigned int) strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2)
+    {
+        loadPercent = (unsigned int) strtoul(argv[2], NULL, 0);
+    }
+
+/* The bulk bursts take the load that the periodic messages leave. */
+    for(i = 0; i < BULK_STREAM; i++)
+    {
+        load += (double) frame_bits(streams[i].dlc) * streams[i].burst
+                * 1000000.0 / CAN_BUS_SPEED / streams[i].periodUs;
+    }
+    if((seconds == 0) || (loadPercent >= 100)
+       || (loadPercent / 100.0 <= load))
+    {
+        fprintf(stderr, "Usage: %s [seconds [load_percent]]\n"
+                "load_percent must be above %.1f and below 100\n",
+                argv[0], 100.0 * load);
+        return 2;
+    }
+    streams[BULK_STREAM].periodUs = (UINT64)
+        (frame_bits(streams[BULK_STREAM].dlc) * streams[BULK_STREAM].burst
+         * 1000000.0 / CAN_BUS_SPEED / (loadPercent / 100.0 - load));
+
+    endTime = (UINT64) seconds * 1000 * BITS_PER_MS;
+    capacity = 0;
+    for(i = 0; i < STREAMS; i++)
+    {
+        capacity += (UINT64) seconds * 1000000 / streams[i].periodUs
+                        * streams[i].burst + streams[i].burst;
+    }
+    for(mode = 0; mode < 2; mode++)
+    {
+        for(c = 0; c < CAN1_TX_CLASSES; c++)
+        {
+            stats[mode][c].latency = malloc(sizeof(UINT64) * capacity);
+            if(stats[mode][c].latency == NULL)
+            {
+                fprintf(stderr, "Out of memory\n");
+                return 2;
+            }
+        }
+        simulate(mode != 0, endTime, stats[mode]);
+    }
+
+    printf("CAN1 at %u bit/s, %u%% bus load, %u s, bulk burst of %u every "
+           "%.3f ms\n\n", CAN_BUS_SPEED, loadPercent, seconds,
+           streams[BULK_STREAM].burst,
+           streams[BULK_STREAM].periodUs / 1000.0);
+    for(i = 0; i < STREAMS; i++)
+    {
+        printf("%-15s dlc %u, every %6.3f ms, deadline %4llu ms, %s class\n",
+               streams[i].name, streams[i].dlc,
+               streams[i].periodUs / 1000.0,
+               (unsigned long long) streams[i].deadlineMs,
+               classNames[stream_class(i)]);
+    }
+
+    printf("\n%-15s %-7s %8s %8s %9s %9s %7s\n", "Tx channels", "Class",
+           "Sent", "Dropped", "p99(ms)", "Max(ms)", "Missed");
+    isMissed = FALSE;
+    for(mode = 0; mode < 2; mode++)
+    {
+        for(c = 0; c < CAN1_TX_CLASSES; c++)
+        {
+            CLASS_STATS *s = &stats[mode][c];
+            double p99 = 0.0, max = 0.0;
+
+            if(s->sent > 0)
+            {
+                qsort(s->latency, s->sent, sizeof(UINT64), compare_time);
+                p99 = (double) s->latency[s->sent * 99 / 100] / BITS_PER_MS;
+                max = (double) s->latency[s->sent - 1] / BITS_PER_MS;
+            }
+            printf("%-15s %-7s %8llu %8llu %9.3f %9.3f %7llu\n",
+                   (c == 0) ? (mode ? "Class channels" : "Single FIFO") : "",
+                   classNames[c], (unsigned long long) s->sent,
+                   (unsigned long long) s->dropped, p99, max,
+                   (unsigned long long) s->missed);
+            if(mode && (c == CAN1_TX_URGENT)
+               && ((s->missed > 0) || (s->dropped > 0)))
+            {
+                isMissed = TRUE;
+            }
+            free(s->latency);
+        }
+    }
+
+    return isMissed ? 1 : 0;
+}
+
+/* frame_bits Function Description ********************************************
+ * SYNTAX:          static UINT64 frame_bits(BYTE dlc);
+ * DESCRIPTION:     Worst case length in bits of a 29 bit ID frame with dlc
+ *                  data bytes, including the maximum number of stuff bits.
+ * END DESCRIPTION ************************************************************/
+static UINT64 frame_bits(BYTE dlc)
+{
+UINT64 stuffed = EXT_STUFFED_BITS + 8 * (UINT64) dlc;
+
+    return stuffed + UNSTUFFED_BITS + (stuffed - 1) / 4;
+}
+
+/* stream_class Function Description ******************************************
+ * SYNTAX:          static CAN1_TX_CLASS stream_class(unsigned int stream);
+ * DESCRIPTION:     Transmit class of a stream, selected from its deadline as
+ *                  the node code does.
+ * END DESCRIPTION ************************************************************/
+static CAN1_TX_CLASS stream_class(unsigned int stream)
+{
+    return CAN1_TX_CLASS_FOR_DEADLINE(streams[stream].deadlineMs);
+}
+
+/* compare_time Function Description ******************************************
+ * SYNTAX:          static int compare_time(const void *a, const void *b);
+ * DESCRIPTION:     qsort comparison of two UINT64 times, ascending.
+ * END DESCRIPTION ************************************************************/
+static int compare_time(const void *a, const void *b)
+{
+UINT64 x = *(const UINT64 *) a;
+UINT64 y = *(const UINT64 *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* simulate Function Description **********************************************
+ * SYNTAX:          static void simulate(BOOL isClassChannels,
+ *                          UINT64 endTime, CLASS_STATS *stats);
+ * DESCRIPTION:     Runs the message set on one node until endTime and fills
+ *                  in the statistics of every class. Releases at the same
+ *                  time as the end of a frame are posted first, so they
+ *                  take part in the choice of the next frame.
+ * PARAMETER1:      isClassChannels - TRUE for one channel per transmit
+ *                                    class, FALSE for the single FIFO
+ * PARAMETER2:      endTime - simulated time in bit times
+ * PARAMETER3:      stats - receives CAN1_TX_CLASSES entries
+ * END DESCRIPTION ************************************************************/
+static void simulate(BOOL isClassChannels, UINT64 endTime,
+                     CLASS_STATS *stats)
+{
+static const unsigned int classBuffers[CAN1_TX_CLASSES] =
+{
+    CAN1_TX_URGENT_BUFFERS, CAN1_TX_NORMAL_BUFFERS, CAN1_TX_BULK_BUFFERS
+};
+CAN_CHANNEL channels[CAN1_TX_CLASSES];
+UINT64 nextRelease[STREAMS];
+UINT64 releases[STREAMS];
+UINT64 busFreeAt = 0;
+BOOL isBusy = FALSE;
+CAN_FRAME onBus = { 0, 0 };
+unsigned int channelCount = isClassChannels ? CAN1_TX_CLASSES : 1;
+unsigned int i, k;
+
+    for(i = 0; i < CAN1_TX_CLASSES; i++)
+    {
+        channels[i].size = isClassChannels ? classBuffers[i]
+                                           : SINGLE_TX_BUFFERS;
+        channels[i].head = 0;
+        channels[i].count = 0;
+        stats[i].sent = 0;
+        stats[i].dropped = 0;
+        stats[i].missed = 0;
+    }
+    for(i = 0; i < STREAMS; i++)
+    {
+        releases[i] = 0;
+        nextRelease[i] = streams[i].offsetUs * BITS_PER_MS / 1000;
+    }
+
+    for(;;)
+    {
+        UINT64 now;
+        unsigned int first = 0;
+
+        for(i = 1; i < STREAMS; i++)
+        {
+            if(nextRelease[i] < nextRelease[first])
+            {
+                first = i;
+            }
+        }
+
+        if(isBusy && (busFreeAt < nextRelease[first]))
+        {
+/* The frame on the bus completes. */
+            CLASS_STATS *s = &stats[stream_class(onBus.stream)];
+            UINT64 latency = busFreeAt - onBus.release;
+
+            now = busFreeAt;
+            s->latency[s->sent++] = latency;
+            if(latency > streams[onBus.stream].deadlineMs * BITS_PER_MS)
+            {
+                s->missed++;
+            }
+            isBusy = FALSE;
+        }
+        else
+        {
+/* The stream posts its frames and flushes. */
+            CAN_STREAM *st = &streams[first];
+            CAN_CHANNEL *ch = &channels[isClassChannels ? stream_class(first)
+                                                        : 0];
+
+            now = nextRelease[first];
+            if(now >= endTime)
+            {
+                break;
+            }
+            for(k = 0; k < st->burst; k++)
+            {
+                if(ch->count == ch->size)
+                {
+                    stats[stream_class(first)].dropped++;
+                    continue;
+                }
+                ch->frames[(ch->head + ch->count) % ch->size].release = now;
+                ch->frames[(ch->head + ch->count) % ch->size].stream = first;
+                ch->count++;
+            }
+            releases[first]++;
+            nextRelease[first] = (streams[first].offsetUs
+                                  + releases[first] * st->periodUs)
+                                    * BITS_PER_MS / 1000;
+        }
+
+        if(!isBusy)
+        {
+/* The highest priority channel with a pending frame wins the bus. */
+            for(i = 0; i < channelCount; i++)
+            {
+                CAN_CHANNEL *ch = &channels[i];
+
+                if(ch->count > 0)
+                {
+                    onBus = ch->frames[ch->head];
+                    ch->head = (ch->head + 1) % ch->size;
+                    ch->count--;
+                    busFreeAt = now + frame_bits(streams[onBus.stream].dlc);
+                    isBusy = TRUE;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* End of CANTxLatencySim.c */
@@ -0,0 +1,247 @@
+/*  RTRStalenessSim.c
+ *
+ *  Host tool: staleness of the RTR replies of CAN2 channel 0 with
+ *  CAN2UpdateLEDMessage and with CAN2PublishLEDMessage.
+ *
+ *  processor_B publishes a new sample every update period and processor_A
+ *  sends an RTR request every poll period. Each node runs on its own clock,
+ *  so the two periods drift against each other by the given ppm and every
+ *  release is delayed by a random latency. An RTR request that finds the
+ *  channel holding a message gets that message as its reply and empties the
+ *  channel. A request that finds it empty gets no reply.
+ *
+ *  CAN2UpdateLEDMessage drops a sample when the channel still holds an
+ *  unread message. CAN2PublishLEDMessage resets the channel and loads the
+ *  sample in its place. For each reply the tool records how stale it is:
+ *  the time since a newer sample than the one it carries was published, or
+ *  0 when it carries the newest sample. The distribution is printed for
+ *  both functions at several update periods.
+ *
+ *  Build:  gcc -I../h -o RTRStalenessSim RTRStalenessSim.c
+ *  Usage:  RTRStalenessSim [replies [drift_ppm [latency_us]]]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "GenericTypeDefs.h"
+#include "tt_scheduler.h"
+
+#define DEFAULT_REPLIES     100000
+#define DEFAULT_DRIFT_PPM   100
+#define DEFAULT_LATENCY_US  50
+
+/* RTR poll period of processor_A in us. */
+#define POLL_US     ((UINT64) TT_MINOR_CYCLE_MS * 1000)
+
+/* Update periods of processor_B to simulate, in ms. The first is the one of
+ * the schedule table in main.c. */
+static const unsigned int updateMs[] =
+{
+    TT_MAJOR_CYCLE * TT_MINOR_CYCLE_MS, 100, 50, 20, 10
+};
+
+#define UPDATE_PERIODS  (sizeof(updateMs) / sizeof(updateMs[0]))
+
+/* Statistics of one simulation run. Times are in us. */
+typedef struct
+{
+    UINT64 replies;
+    UINT64 staleReplies;
+    UINT64 missedPolls;     /* RTR requests that found the channel empty */
+    UINT64 p50;
+    UINT64 p99;
+    UINT64 max;
+} STALENESS;
+
+static UINT32 randomState = 12345;
+
+/* Private function prototypes */
+static UINT64 random_us(UINT64 max);
+static int compare_time(const void *a, const void *b);
+static void simulate(BOOL isPublish, UINT64 updateUs, unsigned int replies,
+                     unsigned int driftPpm, UINT64 latency,
+                     UINT64 *stale, STALENESS *result);
+
+int main(int argc, char *argv[])
+{
+unsigned int replies = DEFAULT_REPLIES;
+unsigned int driftPpm = DEFAULT_DRIFT_PPM;
+unsigned int latencyUs = DEFAULT_LATENCY_US;
+STALENESS update, publish;
+UINT64 *stale;
+unsigned int i;
+
+    if(argc > 1)
+    {
+        replies = (unsigned int) strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2)
+    {
+        driftPpm = (unsigned int) strtoul(argv[2], NULL, 0);
+    }
+    if(argc > 3)
+    {
+        latencyUs = (unsigned int) strtoul(argv[3], NULL, 0);
+    }
+    if(replies == 0)
+    {
+        fprintf(stderr, "Usage: %s [replies [drift_ppm [latency_us]]]\n",
+                argv[0]);
+        return 2;
+    }
+
+    stale = malloc(sizeof(UINT64) * replies);
+    if(stale == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 2;
+    }
+
+    printf("RTR poll every %d ms, %u replies per run, clock drift %u ppm, "
+           "release latency up to %u us\n\n", TT_MINOR_CYCLE_MS, replies,
+           driftPpm, latencyUs);
+    printf("%-9s %-22s %8s %9s %10s %10s %10s\n", "Update", "Function",
+           "Stale", "No reply", "p50(ms)", "p99(ms)", "Max(ms)");
+    for(i = 0; i < UPDATE_PERIODS; i++)
+    {
+        simulate(FALSE, (UINT64) updateMs[i] * 1000, replies, driftPpm,
+                 latencyUs, stale, &update);
+        simulate(TRUE, (UINT64) updateMs[i] * 1000, replies, driftPpm,
+                 latencyUs, stale, &publish);
+
+        printf("%6u ms %-22s %7.2f%% %8.2f%% %10.3f %10.3f %10.3f\n",
+               updateMs[i], "CAN2UpdateLEDMessage",
+               100.0 * update.staleReplies / update.replies,
+               100.0 * update.missedPolls / (update.replies
+                                             + update.missedPolls),
+               update.p50 / 1000.0, update.p99 / 1000.0, update.max / 1000.0);
+        printf("%9s %-22s %7.2f%% %8.2f%% %10.3f %10.3f %10.3f\n", "",
+               "CAN2PublishLEDMessage",
+               100.0 * publish.staleReplies / publish.replies,
+               100.0 * publish.missedPolls / (publish.replies
+                                              + publish.missedPolls),
+               publish.p50 / 1000.0, publish.p99 / 1000.0,
+               publish.max / 1000.0);
+    }
+
+    free(stale);
+    return 0;
+}
+
+/* random_us Function Description *********************************************
+ * SYNTAX:          static UINT64 random_us(UINT64 max);
+ * DESCRIPTION:     Returns a pseudo random value from 0 to max. A fixed seed
+ *                  linear congruential generator keeps runs repeatable.
+ * END DESCRIPTION ************************************************************/
+static UINT64 random_us(UINT64 max)
+{
+    randomState = randomState * 1103515245UL + 12345UL;
+    return (UINT64) ((randomState >> 8) % (max + 1));
+}
+
+/* compare_time Function Description ******************************************
+ * SYNTAX:          static int compare_time(const void *a, const void *b);
+ * DESCRIPTION:     qsort comparison of two UINT64 times, ascending.
+ * END DESCRIPTION ************************************************************/
+static int compare_time(const void *a, const void *b)
+{
+UINT64 x = *(const UINT64 *) a;
+UINT64 y = *(const UINT64 *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* simulate Function Description **********************************************
+ * SYNTAX:          static void simulate(BOOL isPublish, UINT64 updateUs,
+ *                          unsigned int replies, unsigned int driftPpm,
+ *                          UINT64 latency, UINT64 *stale,
+ *                          STALENESS *result);
+ * DESCRIPTION:     Runs processor_B and processor_A until replies RTR
+ *                  replies have been received and fills in result. The
+ *                  update releases are stretched by driftPpm against the
+ *                  poll releases, and each release is delayed by up to
+ *                  latency us. The channel holds at most one sample, since
+ *                  neither function loads a message into a channel that is
+ *                  not empty.
+ * PARAMETER1:      isPublish - TRUE for CAN2PublishLEDMessage, FALSE for
+ *                              CAN2UpdateLEDMessage
+ * PARAMETER2:      updateUs - update period of processor_B in us
+ * PARAMETER3:      replies - number of replies to simulate
+ * PARAMETER4:      driftPpm - clock drift of processor_B in ppm
+ * PARAMETER5:      latency - maximum release latency in us
+ * PARAMETER6:      stale - work array of replies entries
+ * PARAMETER7:      result - receives the staleness statistics
+ * END DESCRIPTION ************************************************************/
+static void simulate(BOOL isPublish, UINT64 updateUs, unsigned int replies,
+                     unsigned int driftPpm, UINT64 latency,
+                     UINT64 *stale, STALENESS *result)
+{
+UINT64 updateK = 1;
+UINT64 pollK = 1;
+UINT64 nextUpdate, nextPoll;
+UINT64 channelSample = 0;       /* Sequence number of the loaded sample */
+BOOL isChannelFull = FALSE;
+UINT64 newestSample = 0;
+UINT64 supersededAt = 0;        /* Time the loaded sample became stale */
+UINT64 sample = 0;
+
+    result->replies = 0;
+    result->staleReplies = 0;
+    result->missedPolls = 0;
+    randomState = 12345;
+
+    nextUpdate = updateUs * (1000000 + driftPpm) / 1000000
+                    + random_us(latency);
+    nextPoll = POLL_US + random_us(latency);
+
+    while(result->replies < replies)
+    {
+        if(nextUpdate <= nextPoll)
+        {
+/* processor_B toggles LED1 and posts the new sample. */
+            newestSample = ++sample;
+            if(!isChannelFull || isPublish)
+            {
+                channelSample = newestSample;
+                isChannelFull = TRUE;
+            }
+            else if(channelSample == newestSample - 1)
+            {
+/* The loaded sample is no longer the newest one from now on. */
+                supersededAt = nextUpdate;
+            }
+            updateK++;
+            nextUpdate = updateK * updateUs * (1000000 + driftPpm) / 1000000
+                            + random_us(latency);
+        }
+        else
+        {
+/* processor_A sends the RTR request, which flushes the channel. */
+            if(isChannelFull)
+            {
+                stale[result->replies] = (channelSample == newestSample)
+                                            ? 0 : nextPoll - supersededAt;
+                if(stale[result->replies] != 0)
+                {
+                    result->staleReplies++;
+                }
+                result->replies++;
+                isChannelFull = FALSE;
+            }
+            else
+            {
+                result->missedPolls++;
+            }
+            pollK++;
+            nextPoll = pollK * POLL_US + random_us(latency);
+        }
+    }
+
+    qsort(stale, replies, sizeof(UINT64), compare_time);
+    result->p50 = stale[replies / 2];
+    result->p99 = stale[(UINT64) replies * 99 / 100];
+    result->max = stale[replies - 1];
+}
+
+/* End of RTRStalenessSim.c */
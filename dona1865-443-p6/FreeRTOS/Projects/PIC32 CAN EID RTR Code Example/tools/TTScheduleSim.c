@@ -0,0 +1,250 @@
+/*  TTScheduleSim.c
+ *
+ *  Host tool: release jitter and CPU idle simulation of the time triggered
+ *  scheduler in tt_scheduler.c.
+ *
+ *  Time is counted in core timer ticks, CORE_MS_TICK_RATE per ms. Each
+ *  minor cycle starts when the core timer compare interrupt is serviced,
+ *  which is the absolute deadline k * TT_CORE_TICKS plus a random interrupt
+ *  latency. Tasks of the schedule table are run in table order with a fixed
+ *  execution time, followed by the background function. The CAN1 reply to
+ *  each RTR request arrives within the same minor cycle and wakes the CPU
+ *  to run the background function again.
+ *
+ *  For comparison the polling loop that the scheduler replaced is also
+ *  simulated. It recomputed each deadline from the time the expiry was
+ *  seen, so every period is lengthened by up to one loop iteration and the
+ *  release time drifts, while the CPU is never idle.
+ *
+ *  Build:  gcc -I../h -o TTScheduleSim TTScheduleSim.c
+ *  Usage:  TTScheduleSim [major_cycles [isr_latency_us]]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "GenericTypeDefs.h"
+#include "chipKIT_PRO_MX7.h"
+#include "tt_scheduler.h"
+
+/* Estimated execution times in microseconds at 80 MHz. */
+#define TASK_A_US           6       /* CAN1TxSendRTRMsg */
+#define TASK_B_US           12      /* LED1 toggle and CAN2PublishLEDMessage */
+#define BACKGROUND_US       3       /* CAN1RxMsgProcess with nothing to do */
+#define RX_PROCESS_US       8       /* CAN1RxMsgProcess with a message */
+#define RX_ISR_US           2       /* CAN1 receive interrupt */
+
+#define DEFAULT_MAJOR_CYCLES    1000
+#define DEFAULT_LATENCY_US      2
+
+/* CORE_MS_TICK_RATE is not parenthesized in chipKIT_PRO_MX7.h. */
+#define TICKS(us)   ((UINT64) (us) * (CORE_MS_TICK_RATE) / 1000)
+#define US(ticks)   ((ticks) * 1000.0 / (CORE_MS_TICK_RATE))
+
+/* Simulated copy of the schedule table in main.c with the task costs. */
+typedef struct
+{
+    const char *name;
+    unsigned int period;
+    unsigned int offset;
+    UINT64 cost;
+    UINT64 releases;
+    INT64 minJitter;
+    INT64 maxJitter;
+} SIM_TASK;
+
+static SIM_TASK tasks[] =
+{
+    { "processor_A", 1, 0, 0, 0, 0, 0 },
+    { "processor_B", TT_MAJOR_CYCLE, 5, 0, 0, 0, 0 }
+};
+
+#define TASK_COUNT  (sizeof(tasks) / sizeof(tasks[0]))
+
+static UINT32 randomState = 12345;
+
+/* Private function prototypes */
+static UINT64 random_ticks(UINT64 max);
+static void record_release(SIM_TASK *task, UINT64 release, UINT64 ideal);
+static void simulate_tt(unsigned int majorCycles, UINT64 latency);
+static void simulate_polling(unsigned int majorCycles, UINT64 latency);
+
+int main(int argc, char *argv[])
+{
+unsigned int majorCycles = DEFAULT_MAJOR_CYCLES;
+unsigned int latencyUs = DEFAULT_LATENCY_US;
+
+    if(argc > 1)
+    {
+        majorCycles = (unsigned int) strtoul(argv[1], NULL, 0);
+    }
+    if(argc > 2)
+    {
+        latencyUs = (unsigned int) strtoul(argv[2], NULL, 0);
+    }
+    if(majorCycles == 0)
+    {
+        fprintf(stderr, "Usage: %s [major_cycles [isr_latency_us]]\n",
+                argv[0]);
+        return 2;
+    }
+
+    tasks[0].cost = TICKS(TASK_A_US);
+    tasks[1].cost = TICKS(TASK_B_US);
+
+    printf("Minor cycle %d ms, major cycle %d minor cycles, %u major cycles, "
+           "interrupt latency up to %u us\n\n", TT_MINOR_CYCLE_MS,
+           TT_MAJOR_CYCLE, majorCycles, latencyUs);
+    simulate_tt(majorCycles, TICKS(latencyUs));
+    simulate_polling(majorCycles, TICKS(latencyUs));
+    return 0;
+}
+
+/* random_ticks Function Description ******************************************
+ * SYNTAX:          static UINT64 random_ticks(UINT64 max);
+ * DESCRIPTION:     Returns a pseudo random value from 0 to max. A fixed seed
+ *                  linear congruential generator keeps runs repeatable.
+ * END DESCRIPTION ************************************************************/
+static UINT64 random_ticks(UINT64 max)
+{
+    randomState = randomState * 1103515245UL + 12345UL;
+    return (UINT64) ((randomState >> 8) % (max + 1));
+}
+
+/* record_release Function Description ****************************************
+ * SYNTAX:          static void record_release(SIM_TASK *task, UINT64 release,
+ *                                             UINT64 ideal);
+ * DESCRIPTION:     Updates the release jitter range of a task. Jitter is the
+ *                  release time minus the ideal release time.
+ * END DESCRIPTION ************************************************************/
+static void record_release(SIM_TASK *task, UINT64 release, UINT64 ideal)
+{
+INT64 jitter = (INT64) release - (INT64) ideal;
+
+    if((task->releases == 0) || (jitter < task->minJitter))
+    {
+        task->minJitter = jitter;
+    }
+    if((task->releases == 0) || (jitter > task->maxJitter))
+    {
+        task->maxJitter = jitter;
+    }
+    task->releases++;
+}
+
+/* simulate_tt Function Description *******************************************
+ * SYNTAX:          static void simulate_tt(unsigned int majorCycles,
+ *                                          UINT64 latency);
+ * DESCRIPTION:     Runs the schedule table as TTSchedulerRun does and
+ *                  prints the release jitter of each task and the idle time.
+ * END DESCRIPTION ************************************************************/
+static void simulate_tt(unsigned int majorCycles, UINT64 latency)
+{
+UINT64 minorCycles = (UINT64) majorCycles * TT_MAJOR_CYCLE;
+UINT64 busy = 0;
+UINT64 overruns = 0;
+UINT64 now = 0;
+UINT64 start;
+UINT64 k;
+unsigned int cycle = 0;
+unsigned int i;
+
+    for(i = 0; i < TASK_COUNT; i++)
+    {
+        tasks[i].releases = 0;
+    }
+
+    for(k = 0; k < minorCycles; k++)
+    {
+/* The compare interrupt is due at an absolute time. It is late if the
+ * previous minor cycle has not finished. */
+        start = k * TT_CORE_TICKS + random_ticks(latency);
+        if(now > start)
+        {
+            overruns++;
+            start = now;
+        }
+        now = start;
+
+        for(i = 0; i < TASK_COUNT; i++)
+        {
+            if((cycle % tasks[i].period) == tasks[i].offset)
+            {
+                record_release(&tasks[i], now, k * TT_CORE_TICKS);
+                now += tasks[i].cost;
+            }
+        }
+        now += TICKS(BACKGROUND_US);
+        busy += now - start;
+        cycle = (cycle + 1) % TT_MAJOR_CYCLE;
+
+/* The RTR reply wakes the CPU for the receive interrupt and processing. */
+        busy += TICKS(RX_ISR_US) + TICKS(RX_PROCESS_US);
+    }
+
+    printf("Time triggered scheduler\n");
+    printf("%-12s %10s %14s %14s\n", "Task", "Releases", "Min jitter(us)",
+           "Max jitter(us)");
+    for(i = 0; i < TASK_COUNT; i++)
+    {
+        printf("%-12s %10llu %14.3f %14.3f\n", tasks[i].name,
+               (unsigned long long) tasks[i].releases,
+               US(tasks[i].minJitter), US(tasks[i].maxJitter));
+    }
+    printf("Overrun minor cycles %llu\n", (unsigned long long) overruns);
+    printf("CPU idle %.3f%%\n\n",
+           100.0 - 100.0 * busy / (minorCycles * TT_CORE_TICKS));
+}
+
+/* simulate_polling Function Description **************************************
+ * SYNTAX:          static void simulate_polling(unsigned int majorCycles,
+ *                                               UINT64 latency);
+ * DESCRIPTION:     Runs the ReadCoreTimer polling loop that the scheduler
+ *                  replaced for the same number of periods and prints the
+ *                  release jitter against the ideal period grid.
+ * END DESCRIPTION ************************************************************/
+static void simulate_polling(unsigned int majorCycles, UINT64 latency)
+{
+UINT64 loopTicks = TICKS(BACKGROUND_US) + TICKS(1);
+UINT64 tWait[TASK_COUNT];
+UINT64 period[TASK_COUNT];
+UINT64 now = 0;
+unsigned int i;
+
+    for(i = 0; i < TASK_COUNT; i++)
+    {
+        tasks[i].releases = 0;
+        period[i] = (UINT64) tasks[i].period * TT_CORE_TICKS;
+        tWait[i] = period[i];
+    }
+
+/* Run until the slowest task has been released majorCycles times. */
+    while(tasks[TASK_COUNT - 1].releases < majorCycles)
+    {
+        for(i = 0; i < TASK_COUNT; i++)
+        {
+            if(now >= tWait[i])
+            {
+                record_release(&tasks[i], now,
+                               (tasks[i].releases + 1) * period[i]);
+                now += tasks[i].cost;
+                tWait[i] = now + period[i];
+            }
+        }
+/* Other interrupts delay the loop as they delay the compare interrupt. */
+        now += loopTicks + random_ticks(latency);
+    }
+
+    printf("ReadCoreTimer polling loop\n");
+    printf("%-12s %10s %14s %14s\n", "Task", "Releases", "Min jitter(us)",
+           "Max jitter(us)");
+    for(i = 0; i < TASK_COUNT; i++)
+    {
+        printf("%-12s %10llu %14.3f %14.3f\n", tasks[i].name,
+               (unsigned long long) tasks[i].releases,
+               US(tasks[i].minJitter), US(tasks[i].maxJitter));
+    }
+    printf("CPU idle 0.000%%\n");
+}
+
+/* End of TTScheduleSim.c */
@@ -53,6 +53,7 @@
  * 04/14/2010   Added defines to uniquely identify each compiler
  * 10/13/2010   Added support for PIC10, PIC12, and PIC16 with PICC compiler
  * 02/15/2012   Added re-define check for Nop, ClrWdt, Reset, Sleep
+ * 10/18/2026   Added GCC host build for the ETHHost.c MAC driver
  ********************************************************************/
 #ifndef __COMPILER_H
 #define __COMPILER_H
@@ -115,6 +116,9 @@
     #define COMPILER_MPLAB_C32
 	#include <p32xxxx.h>
 	#include <plib.h>
+#elif defined(__linux__) && defined(__GNUC__)
+	// Host build with GCC on Linux, used with the ETHHost.c MAC driver
+	#define COMPILER_HOST_GCC
 #else
 	#error Unknown processor or compiler.  See Compiler.h
 #endif
@@ -125,7 +129,7 @@
 
 
 // Base RAM and ROM pointer types for given architecture
-#if defined(__PIC32MX__)
+#if defined(__PIC32MX__) || defined(COMPILER_HOST_GCC)
 	#define PTR_BASE		unsigned long
 	#define ROM_PTR_BASE	unsigned long
 #elif defined(__C30__)
@@ -139,6 +143,11 @@
 	#define ROM_PTR_BASE	unsigned long
 #endif
 
+// Integer type that holds either a DWORD or any RAM or ROM pointer, such as
+// the remote host parameter of TCPOpen() and UDPOpenEx().  It is the same
+// width as DWORD on every MCU and as a pointer on an LP64 host.
+#define DWORD_PTR_BASE	unsigned long
+
 
 // Definitions that apply to all except Microchip MPLAB C Compiler for PIC18 MCUs (C18)
 #if !defined(COMPILER_MPLAB_C18)
@@ -211,6 +220,16 @@
 			#define Nop()				asm("nop")
 		#endif
 	#endif
+
+	// Host build defines (pointers are 64 bits on LP64, so PTR_BASE is long)
+	#if defined(COMPILER_HOST_GCC)
+		#define far
+		#define FAR
+		#define persistent
+		#define Reset()				abort()
+		#define ClrWdt()
+		#define Nop()
+	#endif
 #endif
 
 
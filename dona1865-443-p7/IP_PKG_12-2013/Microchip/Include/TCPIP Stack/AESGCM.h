@@ -0,0 +1,82 @@
+/*********************************************************************
+ *
+ *					AES-GCM Cryptography Headers
+ *
+ *********************************************************************
+ * FileName:        AESGCM.h
+ * Dependencies:    None
+ * Processor:       PIC18, PIC24F, PIC24H, dsPIC30F, dsPIC33F, PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *					Microchip C30 v3.12 or higher
+ *					Microchip C18 v3.30 or higher
+ *					HI-TECH PICC-18 PRO 9.63PL2 or higher
+ * Company:         Microchip Technology, Inc.
+ *
+ * Software License Agreement
+ *
+ * Copyright (C) 2002-2009 Microchip Technology Inc.  All rights
+ * reserved.
+ *
+ * Microchip licenses to you the right to use, modify, copy, and
+ * distribute:
+ * (i)  the Software when embedded on a Microchip microcontroller or
+ *      digital signal controller product ("Device") which is
+ *      integrated into Licensee's product; or
+ * (ii) ONLY the Software driver source files ENC28J60.c, ENC28J60.h,
+ *		ENCX24J600.c and ENCX24J600.h ported to a non-Microchip device
+ *		used in conjunction with a Microchip ethernet controller for
+ *		the sole purpose of interfacing with the ethernet controller.
+ *
+ * You should refer to the license agreement accompanying this
+ * Software for additional information regarding your rights and
+ * obligations.
+ *
+ * THE SOFTWARE AND DOCUMENTATION ARE PROVIDED "AS IS" WITHOUT
+ * WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION, ANY WARRANTY OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * MICROCHIP BE LIABLE FOR ANY INCIDENTAL, SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF
+ * PROCUREMENT OF SUBSTITUTE GOODS, TECHNOLOGY OR SERVICES, ANY CLAIMS
+ * BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY DEFENSE
+ * THEREOF), ANY CLAIMS FOR INDEMNITY OR CONTRIBUTION, OR OTHER
+ * SIMILAR COSTS, WHETHER ASSERTED ON THE BASIS OF CONTRACT, TORT
+ * (INCLUDING NEGLIGENCE), BREACH OF WARRANTY, OR OTHERWISE.
+ *
+ * IMPORTANT:  The implementation and use of third party algorithms, 
+ * specifications and/or other technology may require a license from 
+ * various third parties.  It is your responsibility to obtain 
+ * information regarding any applicable licensing obligations.
+ *
+ *
+ * Author               Date		Comment
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *                      10/18/26	Original
+ ********************************************************************/
+
+#ifndef __AESGCM_H
+#define __AESGCM_H
+
+// Encryption Context for AES-GCM module.
+// The program need not access any of these values directly, but rather
+// only store the structure and use AESGCMInitialize to set it up.  Like
+// the ARCFOUR S-box, the GHASH table lives in a separate 256 byte array
+// so that the context stays small enough to swap in and out.
+typedef struct
+{
+	BYTE key[16];		// AES-128 key (round keys are expanded per block)
+	BYTE counter[16];	// Salt, explicit nonce and 32-bit block counter
+	BYTE stream[16];	// Key stream for the current block
+	BYTE hash[16];		// GHASH accumulator
+	DWORD textLen;		// Bytes encrypted or decrypted so far
+	WORD aadLen;		// Bytes of additional authenticated data
+	DWORD *table;		// A pointer to a 256 byte GHASH multiplication table
+} AES_GCM_CTX;
+
+void AESGCMInitialize(AES_GCM_CTX* ctx, BYTE* key, BYTE* salt);
+void AESGCMStart(AES_GCM_CTX* ctx, BYTE* nonce, BYTE* aad, WORD aadLen);
+void AESGCMEncrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len);
+void AESGCMDecrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len);
+void AESGCMCalculate(AES_GCM_CTX* ctx, BYTE* tag);
+
+#endif
@@ -71,6 +71,13 @@
 	#define BIGINT_DATA_TYPE	DWORD
 	#define BIGINT_DATA_MAX		0xFFFFFFFFu
 	#define BIGINT_DATA_TYPE_2	QWORD
+#elif defined(COMPILER_HOST_GCC)
+	// The host build has no BigInt helpers, so these only size the RSA
+	// buffers for SSLBench.c
+	#define BIGINT_DATA_SIZE	32ul	//bits
+	#define BIGINT_DATA_TYPE	DWORD
+	#define BIGINT_DATA_MAX		0xFFFFFFFFu
+	#define BIGINT_DATA_TYPE_2	QWORD
 #endif
 
 typedef struct
@@ -0,0 +1,76 @@
+/*********************************************************************
+ *
+ *            Host MAC (Linux TAP and pcap replay) definitions
+ *
+ *********************************************************************
+ * FileName:        ETHHost.h
+ * Dependencies:    None
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * The host MAC driver lets the stack run as a Linux process so that
+ * TCP.c, IP.c, HTTP2.c and the performance test modules can be run
+ * and profiled without a board.  Frames are exchanged with a TAP
+ * interface, or read from a pcap file when replaying a capture.
+ *
+ * The backend is selected at run time from environment variables:
+ *   HOST_MAC_TAP      TAP interface to attach to (default HOST_TAP_NAME).
+ *                     The interface must exist and be owned by the user,
+ *                     for example:
+ *                       ip tuntap add dev tap0 mode tap user $USER
+ *                       ip addr add 192.168.1.1/24 dev tap0
+ *                       ip link set tap0 up
+ *   HOST_MAC_PCAP_IN  pcap file to replay instead of using a TAP.  One
+ *                     frame is returned per MACGetHeader() call, without
+ *                     the capture timing.  The link goes down at the end
+ *                     of the file.
+ *   HOST_MAC_PCAP_OUT pcap file that receives every frame sent and
+ *                     received, with either backend.
+ *   HOST_MAC_RX_DELAY_US
+ *                     Time in us each received frame waits before the
+ *                     stack gets it (default 0), to emulate a longer round
+ *                     trip time on the TAP.  Can be changed at run time
+ *                     with MACHostSetRxDelay().
+ *
+ * HardwareProfile.h for a host build must define GetSystemClock(),
+ * GetInstructionClock() and GetPeripheralClock() (TICKS_PER_SECOND is
+ * derived from the peripheral clock) and BUTTON3_IO if UDPPerformanceTest
+ * is used.  It must not define ENC_CS_TRIS, ENC100_INTERFACE_MODE or
+ * WF_CS_TRIS.  As with the PIC32 internal MAC,
+ * TCP_ETH_RAM_SIZE must be 0 in TCPIPConfig.h; socket buffers go in
+ * TCP_PIC_RAM.
+ *
+ * The stack passes pointers in DWORD parameters (TCPOpen(), UDPOpenEx()),
+ * so build a 32 bit executable.  Build example from a project directory
+ * that holds HardwareProfile.h, TCPIPConfig.h and the main loop:
+ *   S=../../Microchip
+ *   gcc -m32 -O2 -I. -I$S/Include -o stack MainDemo.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers,ARP,IP,ICMP}.c \
+ *       "$S/TCPIP Stack/"{UDP,TCP,TCPPerformanceTest,UDPPerformanceTest}.c
+ * TCPPerformanceTest can then be driven with a TCP client on ports 9762
+ * (device to host) and 9763 (host to device), UDPPerformanceTest with a
+ * UDP listener on port 9, and the output capture opened in Wireshark.
+ ********************************************************************/
+#ifndef __ETHHOST_H
+#define __ETHHOST_H
+
+// Default TAP interface name
+#if !defined(HOST_TAP_NAME)
+	#define HOST_TAP_NAME		"tap0"
+#endif
+
+// RX buffer size: largest frame accepted, without the FCS.  Larger frames
+// are truncated by the TAP read and dropped.
+#if !defined(HOST_RX_BUFF_SIZE)
+	#define HOST_RX_BUFF_SIZE	(1536ul)
+#endif
+
+// Number of RX buffers.  Frames waiting for the RX delay are queued in them,
+// so there must be enough for a full TCP window of frames.
+#if !defined(HOST_RX_FRAMES)
+	#define HOST_RX_FRAMES		(256)
+#endif
+
+void MACHostSetRxDelay(DWORD dwDelay);
+
+#endif
@@ -77,6 +77,22 @@
 	#define HTTP_CACHE_LEN			("600")	// Max lifetime (sec) of static responses as string
 	#define HTTP_TIMEOUT			(45u)	// Max time (sec) to await more data before timing out and disconnecting the socket
 
+	// With HTTP_USE_KEEPALIVE, connections persist between requests 
+	// (HTTP/1.1 unless "Connection: close", HTTP/1.0 with "Connection: 
+	// keep-alive").  Static files are sent with a Content-Length and 
+	// dynamic pages with chunked transfer encoding.
+	#if !defined(HTTP_KEEPALIVE_TIMEOUT)
+		#define HTTP_KEEPALIVE_TIMEOUT	(5u)	// Max time (sec) a persistent connection may await its next request
+	#endif
+
+	// With HTTP_USE_INFLATE, GZIP files are decompressed for clients that 
+	// do not send "Accept-Encoding: gzip".  One window is shared by all 
+	// connections, and a file is only decompressed if it has an index of 
+	// blocks no larger than the window, or is itself no larger.
+	#if !defined(HTTP_INFLATE_WINDOW)
+		#define HTTP_INFLATE_WINDOW		(4096u)	// Decompression window (bytes), a power of 2
+	#endif
+
 	// Authentication requires Base64 decoding
 	#if defined(HTTP_USE_AUTHENTICATION)
 		#ifndef STACK_USE_BASE64_DECODE
@@ -129,7 +145,8 @@
 		SM_HTTP_SERVE_COOKIES,			// Adds any cookies to the response
 		SM_HTTP_SERVE_BODY,				// Serves the actual content
 		SM_HTTP_SEND_FROM_CALLBACK,		// Invokes a dynamic variable callback
-		SM_HTTP_DISCONNECT				// Disconnects the server and closes all files
+		SM_HTTP_DISCONNECT,				// Disconnects the server and closes all files
+		SM_HTTP_WAIT_REQUEST			// Persistent connection awaits its next request
 	} SM_HTTP2;
 
 	// Result states for execution callbacks
@@ -187,14 +204,24 @@
 		BYTE *ptrRead;						// Points to current read location
 		MPFS_HANDLE file;					// File pointer for the file being served
 	    MPFS_HANDLE offsets;				// File pointer for any offset info being used
+		BYTE hasVarLen;						// True if the offsets hold variable lengths
 		BYTE hasArgs;						// True if there were get or cookie arguments
 		BYTE isAuthorized;					// 0x00-0x79 on fail, 0x80-0xff on pass
+		BYTE skipLine;						// True while a header line too long for the RX FIFO is removed
 		HTTP_STATUS httpStatus;				// Request method/status
 	    HTTP_FILE_TYPE fileType;			// File type to return with Content-Type
 		BYTE data[HTTP_MAX_DATA_LEN];		// General purpose data buffer
 		#if defined(HTTP_USE_POST)
 		BYTE smPost;						// POST state machine variable
 		#endif
+		#if defined(HTTP_USE_KEEPALIVE)
+		BYTE keepAlive;						// True if the connection persists after this response
+		BYTE isChunked;						// Chunked encoding state of the response
+		#endif
+		#if defined(HTTP_USE_INFLATE)
+		BYTE acceptGzip;					// True if the client accepts GZIP content encoding
+		BYTE isInflated;					// True if the GZIP file is decompressed as it is sent
+		#endif
 	} HTTP_CONN;
 
 #if defined(HTTP_SAVE_CONTEXT_IN_PIC_RAM)
@@ -52,6 +52,7 @@
  * Author               Date		Comment
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  * Elliott Wood         05/01/07	Original
+ *                      10/18/26	Added SHA-256
  ********************************************************************/
 
 #ifndef __HASHES_H
@@ -66,7 +67,8 @@
 typedef enum
 {
 	HASH_MD5	= 0u,		// MD5 is being calculated
-	HASH_SHA1				// SHA-1 is being calculated
+	HASH_SHA1,				// SHA-1 is being calculated
+	HASH_SHA256				// SHA-256 is being calculated
 } HASH_TYPE;
 
 // Context storage for a hash operation
@@ -77,6 +79,11 @@ typedef struct
 	DWORD h2;				// Hash state h2
 	DWORD h3;				// Hash state h3
 	DWORD h4;				// Hash state h4
+	#if defined(STACK_USE_SHA256)
+	DWORD h5;				// Hash state h5 (SHA-256 only)
+	DWORD h6;				// Hash state h6 (SHA-256 only)
+	DWORD h7;				// Hash state h7 (SHA-256 only)
+	#endif
 	DWORD bytesSoFar;		// Total number of bytes hashed so far
 	BYTE partialBlock[64];	// Beginning of next 64 byte block
 	HASH_TYPE hashType;		// Type of hash being calculated
@@ -100,6 +107,18 @@ typedef struct
 	#endif
 #endif
 
+#if defined(STACK_USE_SHA256)
+	void SHA256Initialize(HASH_SUM* theSum);
+	void SHA256AddData(HASH_SUM* theSum, BYTE* data, WORD len);
+	void SHA256Calculate(HASH_SUM* theSum, BYTE* result);
+	#if defined(__18CXX)
+		void SHA256AddROMData(HASH_SUM* theSum, ROM BYTE* data, WORD len);
+	#else
+		// Non-ROM variant for C30 / C32
+		#define SHA256AddROMData(a,b,c)	SHA256AddData(a,(BYTE*)b,c)
+	#endif
+#endif
+
 #if defined(STACK_USE_MD5)
 	void MD5Initialize(HASH_SUM* theSum);
 	void MD5AddData(HASH_SUM* theSum, BYTE* data, WORD len);
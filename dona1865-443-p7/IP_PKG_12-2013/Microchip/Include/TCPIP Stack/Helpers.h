@@ -57,8 +57,9 @@
 #endif
 
 // Implement consistent ultoa() function
-#if (defined(__PIC32MX__) && (__C32_VERSION__ < 112)) || (defined (__C30__) && (__C30_VERSION__ < 325)) || defined(__C30_LEGACY_LIBC__) || defined(__C32_LEGACY_LIBC__)
-	// C32 < 1.12 and C30 < v3.25 need this 2 parameter stack implemented function
+#if (defined(__PIC32MX__) && (__C32_VERSION__ < 112)) || (defined (__C30__) && (__C30_VERSION__ < 325)) || defined(__C30_LEGACY_LIBC__) || defined(__C32_LEGACY_LIBC__) || defined(COMPILER_HOST_GCC)
+	// C32 < 1.12, C30 < v3.25 and the GCC host build (glibc has no ultoa())
+	// need this 2 parameter stack implemented function
 	void ultoa(DWORD Value, BYTE* Buffer);
 #elif defined(__18CXX) && !defined(HI_TECH_C)
 	// C18 already has a 2 parameter ultoa() function
@@ -111,6 +112,8 @@ DWORD   swapl(DWORD v);
 #endif
 
 WORD    CalcIPChecksum(BYTE* buffer, WORD len);
+WORD    CalcIPChecksumCopy(BYTE* dest, BYTE* source, WORD count);
+WORD    UpdateIPChecksum(WORD wChecksum, WORD wOld, WORD wNew);
 
 
 #if defined(__18CXX)
@@ -0,0 +1,95 @@
+/*********************************************************************
+ *
+ *					Inflate (Deflate Decompression) Headers
+ *
+ *********************************************************************
+ * FileName:        Inflate.h
+ * Dependencies:    MPFS2
+ * Processor:       PIC18, PIC24F, PIC24H, dsPIC30F, dsPIC33F, PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *					Microchip C30 v3.12 or higher
+ *					Microchip C18 v3.30 or higher
+ *					HI-TECH PICC-18 PRO 9.63PL2 or higher
+ * Company:         Microchip Technology, Inc.
+ *
+ * Software License Agreement
+ *
+ * Copyright (C) 2002-2009 Microchip Technology Inc.  All rights
+ * reserved.
+ *
+ * Microchip licenses to you the right to use, modify, copy, and
+ * distribute:
+ * (i)  the Software when embedded on a Microchip microcontroller or
+ *      digital signal controller product ("Device") which is
+ *      integrated into Licensee's product; or
+ * (ii) ONLY the Software driver source files ENC28J60.c, ENC28J60.h,
+ *		ENCX24J600.c and ENCX24J600.h ported to a non-Microchip device
+ *		used in conjunction with a Microchip ethernet controller for
+ *		the sole purpose of interfacing with the ethernet controller.
+ *
+ * You should refer to the license agreement accompanying this
+ * Software for additional information regarding your rights and
+ * obligations.
+ *
+ * THE SOFTWARE AND DOCUMENTATION ARE PROVIDED "AS IS" WITHOUT
+ * WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION, ANY WARRANTY OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * MICROCHIP BE LIABLE FOR ANY INCIDENTAL, SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF
+ * PROCUREMENT OF SUBSTITUTE GOODS, TECHNOLOGY OR SERVICES, ANY CLAIMS
+ * BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY DEFENSE
+ * THEREOF), ANY CLAIMS FOR INDEMNITY OR CONTRIBUTION, OR OTHER
+ * SIMILAR COSTS, WHETHER ASSERTED ON THE BASIS OF CONTRACT, TORT
+ * (INCLUDING NEGLIGENCE), BREACH OF WARRANTY, OR OTHERWISE.
+ *
+ * IMPORTANT:  The implementation and use of third party algorithms, 
+ * specifications and/or other technology may require a license from 
+ * various third parties.  It is your responsibility to obtain 
+ * information regarding any applicable licensing obligations.
+ *
+ *
+ * Author               Date		Comment
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *                      10/18/26    Original
+ ********************************************************************/
+
+#ifndef __INFLATE_H
+#define __INFLATE_H
+
+// Decompression states (INFLATE_CTX.vState)
+#define INFLATE_HEADER		(0u)	// Next bits are a block header
+#define INFLATE_STORED		(1u)	// In a stored block, wLen bytes remain
+#define INFLATE_CODES		(2u)	// In a compressed block
+#define INFLATE_MATCH		(3u)	// Copying a match of wLen bytes at wDist
+#define INFLATE_DONE		(4u)	// The last block has ended
+#define INFLATE_ERROR		(5u)	// The data is invalid or needs a larger window
+
+// Decompression context for the Inflate module.
+// The program need not access any of these values directly, but rather
+// only store the structure and use InflateInit to set it up.
+typedef struct
+{
+	MPFS_HANDLE hFile;			// File the compressed data is read from
+	BYTE vState;				// Decompression state
+	BYTE isLast;				// TRUE in the last block of the stream
+	BYTE isEOF;					// TRUE if the file ended within the stream
+	BYTE vBits;					// Number of bits held in dwBits
+	DWORD dwBits;				// Bits read from the file but not used, LSB first
+	BYTE *window;				// Circular buffer of the latest output
+	WORD wWindowMask;			// Window size minus 1
+	WORD wPos;					// Window position of the next output byte
+	WORD wFull;					// Bytes of output held in the window
+	WORD wLen;					// Bytes left of a stored block or match
+	WORD wDist;					// Distance back to the current match
+	WORD wLitCount[16];			// Number of literal/length codes of each bit length
+	WORD wLitSymbol[288];		// Literal/length symbols, ordered by code
+	WORD wDistCount[16];		// Number of distance codes of each bit length
+	WORD wDistSymbol[30];		// Distance symbols, ordered by code
+} INFLATE_CTX;
+
+BOOL InflateGzipHeader(MPFS_HANDLE hFile);
+void InflateInit(INFLATE_CTX* ctx, MPFS_HANDLE hFile, BYTE* window, WORD wWindowLen);
+WORD InflateGetArray(INFLATE_CTX* ctx, BYTE* cData, WORD wLen);
+
+#endif
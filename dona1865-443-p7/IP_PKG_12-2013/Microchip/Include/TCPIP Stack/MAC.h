@@ -86,6 +86,8 @@
 	#define PHYREG WORD
 #elif defined(__PIC32MX__) && defined(_ETH)
 	// extra includes for PIC32MX with embedded ETH Controller
+#elif defined(COMPILER_HOST_GCC)
+	#include "TCPIP Stack/ETHHost.h"
 #else
 	#error No Ethernet/WiFi controller defined in HardwareProfile.h.  Defines for an ENC28J60, ENC424J600/624J600, or WiFi MRF24WB10 must be present.
 #endif
@@ -103,6 +105,20 @@ typedef struct  __attribute__((aligned(2), packed))
 } ETHER_HEADER;
 
 
+// One piece of data of a frame sent with a gather list: TCPPutFragments(),
+// UDPFlushFragments() and MACFlushFragments()
+typedef struct
+{
+	union
+	{
+		BYTE* pRAM;				// Data in RAM
+		ROM BYTE* pROM;			// Data in program memory
+	} data;
+	WORD wLength;				// Number of bytes
+	BOOL bROM;					// TRUE if data.pROM is used
+} TX_FRAGMENT;
+
+
 #define MAC_IP      	(0x00u)
 #define MAC_ARP     	(0x06u)
 #define MAC_UNKNOWN 	(0xFFu)
@@ -150,6 +166,15 @@ typedef struct  __attribute__((aligned(2), packed))
 	#define BASE_SSLB_ADDR	(MACGetSslBaseAddr())
 	#define RXSIZE			(EMAC_RX_BUFF_SIZE)
 	#define RAMSIZE			(2*RXSIZE)	// not used but silences the compiler
+	#define MAC_TX_BUFFER_IN_PIC_RAM	// BASE_TX_ADDR points to PIC RAM
+#elif defined(COMPILER_HOST_GCC)
+	#define BASE_TX_ADDR	(MACGetTxBaseAddr())
+	#define BASE_HTTPB_ADDR	(MACGetHttpBaseAddr())
+	#define BASE_SSLB_ADDR	(MACGetSslBaseAddr())
+	#define RXSIZE			(HOST_RX_BUFF_SIZE)
+	#define RAMSIZE			(2*RXSIZE)	// not used but silences the compiler
+	#define MAC_TX_BUFFER_IN_PIC_RAM	// BASE_TX_ADDR points to PIC RAM
+	#define MAC_TX_GATHER_FRAGMENTS	(8u)	// MACFlushFragments() sends up to 8 fragments without copying them
 #else	// ENC28J60 or PIC18F97J60 family internal Ethernet controller
 	#define RAMSIZE			(8*1024ul)
 	#define TXSTART 		(RAMSIZE - (1ul+1518ul+7ul) - TCP_ETH_RAM_SIZE - RESERVED_HTTP_MEMORY - RESERVED_SSL_MEMORY)
@@ -313,8 +338,13 @@ void MACFlush(void);
 	#define MACPutROMArray(a,b)	MACPutArray((BYTE*)a,b)
 #endif
 
-// PIC32MX with embedded ETHC functions
-#if defined(__PIC32MX__) && defined(_ETH)
+// Gather transmit, for MACs that send fragments from where they are
+#if defined(MAC_TX_GATHER_FRAGMENTS)
+	void MACFlushFragments(TX_FRAGMENT* pFragments, BYTE vCount);
+#endif
+
+// PIC32MX with embedded ETHC and host MAC functions
+#if (defined(__PIC32MX__) && defined(_ETH)) || defined(COMPILER_HOST_GCC)
 	PTR_BASE MACGetTxBaseAddr(void);
 	PTR_BASE MACGetHttpBaseAddr(void);
 	PTR_BASE MACGetSslBaseAddr(void);
@@ -70,12 +70,31 @@
 	#endif
     #endif
 
+	// Read cache for an image in external EEPROM or SPI Flash.  Reads 
+	// shorter than a page are served from MPFS_CACHE_PAGES pages of 
+	// MPFS_CACHE_PAGE_SIZE bytes, each loaded whole by one read of the 
+	// storage, so that the short reads of MPFSOpen(), MPFSGet() and the 
+	// dynamic variable indexes stop paying a command and address per call.
+	// Longer reads go to the storage directly.  Each of the up to 255 pages
+	// costs MPFS_CACHE_PAGE_SIZE+5 bytes of RAM; 0 pages disables the cache.
+	#if !defined(MPFS_CACHE_PAGES)
+		#define MPFS_CACHE_PAGES		(0u)
+	#endif
+	#if !defined(MPFS_CACHE_PAGE_SIZE)
+		#define MPFS_CACHE_PAGE_SIZE	(32u)	// Must be a power of 2
+	#endif
+	#if (MPFS_CACHE_PAGES > 0u) && (defined(MPFS_USE_EEPROM) || defined(MPFS_USE_SPI_FLASH))
+		#define MPFS_USE_CACHE
+	#endif
+
 /****************************************************************************
   Section:
 	Type Definitions
   ***************************************************************************/
 	#define MPFS2_FLAG_ISZIPPED		((WORD)0x0001)	// Indicates a file is compressed with GZIP compression
 	#define MPFS2_FLAG_HASINDEX		((WORD)0x0002)	// Indicates a file has an associated index of dynamic variables
+	#define MPFS2_FLAG_HASVARLEN	((WORD)0x0004)	// Indicates the index also holds the length of each dynamic variable
+	#define MPFS2_FLAG_HASBLOCKS	((WORD)0x0008)	// Indicates a GZIP file has an associated index of independent deflate blocks
 	#define MPFS_INVALID			(0xffffffffu)	// Indicates a position pointer is invalid
 	#define MPFS_INVALID_FAT		(0xffffu)		// Indicates an invalid FAT cache
 	#define MPFS_INVALID_HANDLE 	(0xffu)			// Indicates that a handle is not valid
@@ -112,6 +131,17 @@
 		WORD flags;			// Flags for this file
 	} MPFS_FAT_RECORD;
 
+	// Read cache counters, since MPFSInit() or MPFSClearCacheStats()
+	typedef struct
+	{
+		DWORD dwHits;		// Short reads served from the cache
+		DWORD dwMisses;		// Short reads that loaded at least one page
+		DWORD dwBypasses;	// Reads of a page or more, sent to the storage
+		DWORD dwReads;		// Reads of the storage
+		DWORD dwBytesRead;	// Bytes read from the storage
+		DWORD dwBytesServed;// Bytes returned to the callers
+	} MPFS_CACHE_STATS;
+
 /****************************************************************************
   Section:
 	Function Definitions
@@ -153,6 +183,11 @@ BOOL MPFSGetFilename(MPFS_HANDLE hMPFS, BYTE* cName, WORD wLen);
 DWORD MPFSGetPosition(MPFS_HANDLE hMPFS);
 WORD MPFSGetID(MPFS_HANDLE hMPFS);
 
+#if defined(MPFS_USE_CACHE)
+	void MPFSGetCacheStats(MPFS_CACHE_STATS* pStats);
+	void MPFSClearCacheStats(void);
+#endif
+
 // Alias of MPFSGetPosition
 #define MPFSTell(a)	MPFSGetPosition(a)
 
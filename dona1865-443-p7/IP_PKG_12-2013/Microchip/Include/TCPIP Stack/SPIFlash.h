@@ -50,6 +50,7 @@
  * Author               Date    Comment
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  * E. Wood				3/20/08	Original
+ *                      10/18/26    Host build uses SPIFlashHost.c
 ********************************************************************/
 #ifndef __SPIFLASH_H
 #define __SPIFLASH_H
@@ -62,13 +63,38 @@
 #define SPI_FLASH_SECTOR_MASK		(SPI_FLASH_SECTOR_SIZE - 1)
 
 
-#if defined(SPIFLASH_CS_TRIS)
+#if defined(SPIFLASH_CS_TRIS) || defined(COMPILER_HOST_GCC)
 	void SPIFlashInit(void);		
 	void SPIFlashReadArray(DWORD dwAddress, BYTE *vData, WORD wLen);
 	void SPIFlashBeginWrite(DWORD dwAddr);
 	void SPIFlashWrite(BYTE vData);
 	void SPIFlashWriteArray(BYTE *vData, WORD wLen);
 	void SPIFlashEraseSector(DWORD dwAddr);
+
+	#if defined(COMPILER_HOST_GCC)
+		// SPIFlashHost.c keeps the device in the file named by the 
+		// HOST_SPIFLASH_FILE environment variable (default 
+		// HOST_SPIFLASH_NAME) and counts the SPI transactions, so that 
+		// the traffic of a module using the flash can be measured 
+		// without a board.  Each read costs a 4 byte command and address 
+		// on the bus in addition to its data.
+		#if !defined(HOST_SPIFLASH_NAME)
+			#define HOST_SPIFLASH_NAME		"spiflash.bin"
+		#endif
+		#if !defined(HOST_SPIFLASH_SIZE)
+			#define HOST_SPIFLASH_SIZE		(2ul*1024ul*1024ul)	// SST25VF016B
+		#endif
+
+		typedef struct
+		{
+			DWORD dwReads;			// SPIFlashReadArray() transactions
+			DWORD dwReadBytes;		// Data bytes read
+			DWORD dwWriteBytes;		// Bytes programmed
+			DWORD dwErases;			// Sectors erased
+		} SPI_FLASH_HOST_STATS;
+
+		extern SPI_FLASH_HOST_STATS SPIFlashHostStats;
+	#endif
 #else
 	// If you get any of these linker errors, it means that you either have an 
 	// error in your HardwareProfile.h or TCPIPConfig.h definitions.  The code 
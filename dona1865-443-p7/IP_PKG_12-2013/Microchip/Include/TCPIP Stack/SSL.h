@@ -48,6 +48,7 @@
  * Elliott Wood			6/20/07	 Original
  * Elliott Wood			12/17/07 Rewritten to integrate with TCP
  *								  and support both client & server
+ *						10/18/26 Added TLS 1.2 with AES-128-GCM
  ********************************************************************/
 
 #ifndef __SSL_H
@@ -63,6 +64,22 @@
 	#define SSL_VERSION_HI			(0x03u)		// SSL version number (high byte)
 	#define SSL_VERSION_LO			(0x00u)		// SSL version number (low byte)
 	
+	#define TLS12_VERSION			(0x0303u)	// TLS 1.2 version number, used with AES-GCM
+	#define TLS12_VERSION_HI		(0x03u)		// TLS 1.2 version number (high byte)
+	#define TLS12_VERSION_LO		(0x03u)		// TLS 1.2 version number (low byte)
+	
+	// Bulk ciphers for a connection (SSL_STUB.cipher)
+	#define SSL_CIPHER_ARCFOUR_MD5	(0u)		// SSL 3.0, ARCFOUR with an MD5 MAC
+	#define SSL_CIPHER_AES_GCM		(1u)		// TLS 1.2, AES-128-GCM
+	
+	// Space TCPIsPutReady() keeps free in the TX FIFO for the next record
+	// header and the current record's MAC (and explicit nonce), plus one
+	#if defined(STACK_USE_AES_GCM)
+		#define SSL_TX_RESERVE		(30u)		// Header 5, nonce 8, tag 16
+	#else
+		#define SSL_TX_RESERVE		(22u)		// Header 5, MAC 16
+	#endif
+	
 	#define SSL_INVALID_ID			(0xFFu)		// Identifier for invalid SSL allocations
 	
 	// Minimum lifetime for SSL Sessions
@@ -100,6 +117,7 @@
 		SSL_ALERT_CLOSE_NOTIFY			= 0u  + 0x80,	// CloseNotify alert message (dummy value used internally)
 		SSL_ALERT_UNEXPECTED_MESSAGE	= 10u + 0x80,	// UnexpectedMessage alert message (dummy value used internally)
 		SSL_ALERT_BAD_RECORD_MAC		= 20u + 0x80,	// BadRecordMAC alert message (dummy value used internally)
+		SSL_ALERT_RECORD_OVERFLOW		= 22u + 0x80,	// RecordOverflow alert message (dummy value used internally)
 		SSL_ALERT_HANDSHAKE_FAILURE		= 40u + 0x80,	// HandshakeFailure alert message (dummy value used internally)
 		
 		// No Message
@@ -156,6 +174,10 @@
 		
 		BYTE idSession;						// ID for associated session
 		BYTE idMD5, idSHA1;					// ID for current hashes
+		#if defined(STACK_USE_AES_GCM)
+		BYTE idSHA256;						// ID for the TLS 1.2 handshake hash
+		BYTE cipher;						// Negotiated bulk cipher (SSL_CIPHER_*)
+		#endif
 		BYTE idRxHash;						// ID for MAC hash (TX needs no persistence)
 		BYTE idRxBuffer, idTxBuffer;		// ID for current buffers (Sboxes)
 		
@@ -208,7 +230,7 @@
 	// hold the ServerRandom and ClientRandom values.  Once the session keys
 	// are calculated, the Local.app and Remote.app contain the MAC
 	// secret, record sequence number, and encryption context for the
-	// ARCFOUR module.
+	// ARCFOUR module, or the AES-GCM context for TLS 1.2.
 	typedef struct
 	{
 		union
@@ -219,6 +241,9 @@
 				DWORD sequence;				// Server's write sequence number
 				ARCFOUR_CTX cryptCtx;		// Server's write encryption context
 				BYTE reserved[6];			// Future expansion
+				#if defined(STACK_USE_AES_GCM)
+				AES_GCM_CTX gcmCtx;			// Server's write AES-GCM context
+				#endif
 			}app;
 			BYTE random[32];				// Server.random value
 		} Local;
@@ -231,6 +256,9 @@
 				DWORD sequence;				// Client's write sequence number
 				ARCFOUR_CTX cryptCtx;		// Client's write encryption context
 				BYTE reserved[6];			// Future expansion
+				#if defined(STACK_USE_AES_GCM)
+				AES_GCM_CTX gcmCtx;			// Client's write AES-GCM context
+				#endif
 			}app;
 			BYTE random[32];				// Client.random value
 		} Remote;		
@@ -238,7 +266,8 @@
 
 	// Generic buffer space for SSL.  The hashRounds element is used
 	// when this buffer is needed for handshake hash calculations, and
-	// the full element is used as the Sbox for ARCFOUR calculations.
+	// the full element is used as the Sbox for ARCFOUR calculations or
+	// the GHASH table for AES-GCM.
 	typedef union
 	{
 		struct
@@ -264,6 +293,9 @@
 	{
 		BYTE sessionID[32];					// The SSL Session ID for this session
 		BYTE masterSecret[48];				// Associated Master Secret for this session
+		#if defined(STACK_USE_AES_GCM)
+		BYTE cipher;						// Bulk cipher the Master Secret was made for
+		#endif
 	} SSL_SESSION;
 
 	// Stub value for an SSL_SESSION.  The tag associates this session with a 
@@ -315,6 +347,9 @@ void SSLTxMessage(TCP_SOCKET hTCP, BYTE sslStubID, BYTE msg);
 void SSLMACBegin(BYTE* MACSecret, DWORD seq, BYTE protocol, WORD len);
 void SSLMACAdd(BYTE* data, WORD len);
 void SSLMACCalc(BYTE* MACSecret, BYTE* result);
+#if defined(STACK_USE_AES_GCM)
+void SSLGCMBegin(AES_GCM_CTX* ctx, BYTE* nonce, DWORD seq, BYTE protocol, WORD len);
+#endif
 
 #if defined(STACK_USE_SSL_SERVER)
 	void SSLStartPartialRecord(TCP_SOCKET hTCP, BYTE sslStubID, BYTE txProtocol, WORD wLen);
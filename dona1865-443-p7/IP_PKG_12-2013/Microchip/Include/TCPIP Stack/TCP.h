@@ -135,7 +135,8 @@ typedef struct
         unsigned char bTXFIN : 1;           // FIN needs to be transmitted
         unsigned char bSocketReset : 1;     // Socket has been reset (self-clearing semaphore)
         unsigned char bSSLHandshaking : 1;  // Socket is in an SSL handshake
-        unsigned char filler : 2;           // Future expansion
+        unsigned char bTXHold : 1;          // New TX data is held back by TCPHoldTX()
+        unsigned char bTXHoldFlush : 1;     // TCPFlush() was called while held
     } Flags;
     WORD_VAL remoteHash;    // Consists of remoteIP, remotePort, localPort for connected sockets.  It is a localPort number only for listening server sockets.
 
@@ -151,36 +152,88 @@ typedef struct
 	
 } TCB_STUB;
 
+// Selective acknowledgements (SACK, RFC 2018) offered in SYNs and accepted 
+// from the remote node.  Out-of-order data kept in the RX FIFO is reported 
+// to the remote node, and only the holes it reports are retransmitted 
+// during a fast recovery.  Costs 31 bytes in every TCB with the default 
+// TCP_SACK_BLOCKS.  Set to 0 in TCPIPConfig.h to disable.
+#if !defined(TCP_SACK)
+	#define TCP_SACK			(1u)
+#endif
+
+// Number of out-of-order blocks kept in the RX FIFO, and of blocks 
+// selectively acknowledged by the remote node that are remembered for 
+// retransmissions.  Each costs 8 bytes in every TCB.  Without SACK, one 
+// block of out-of-order data is kept.  Can be overridden in TCPIPConfig.h.
+#if !defined(TCP_SACK_BLOCKS)
+	#define TCP_SACK_BLOCKS		(4u)
+#endif
+#if TCP_SACK
+	#define TCP_RX_BLOCKS		TCP_SACK_BLOCKS
+#else
+	#define TCP_RX_BLOCKS		(1u)
+#endif
+
+// A block of data beyond a hole, as byte offsets from a sequence number
+typedef struct
+{
+    WORD    wStart;         // Offset of the first byte of the block
+    WORD    wEnd;           // Offset of the byte after the block
+} TCP_SACK_BLOCK;
+
 /* Remainder of TCP Control Block data.
  *  The rest of the TCB is stored in Ethernet buffer RAM or elsewhere
  * as defined by vMemoryMedium.
- * Current size is 41 (PIC18), 42 (PIC24/dsPIC), or 48 bytes (PIC32) */
+ * Current size is 105 (PIC18), 106 (PIC24/dsPIC), or 116 bytes (PIC32) 
+ * with TCP_SACK and the default TCP_SACK_BLOCKS, or 74, 76 or 84 bytes 
+ * with TCP_SACK set to 0.  Before RTT measurement, congestion control and 
+ * the RFC 7323 and SACK options were added, it was 41, 42 or 48 bytes, so 
+ * TCP_PIC_RAM_SIZE or TCP_ETH_RAM_SIZE may need to grow with them. */
 typedef struct
 {
     DWORD   retryInterval;  // How long to wait before retrying transmission
     DWORD   MySEQ;          // Local sequence number
     DWORD   RemoteSEQ;      // Remote sequence number
+    DWORD   dwRecover;      // MySEQ when loss was last detected.  Data below it may be retransmitted (RFC 6582 recover)
+    DWORD   dwRTTSEQ;       // SEQ that acknowledges the segment being timed
+    DWORD   dwRTTStart;     // TickGet() when the timed segment was sent
+    DWORD   dwSRTT;         // Smoothed round trip time in ticks, times 8.  0 until the first measurement
+    DWORD   dwRTTVar;       // Round trip time variation in ticks, times 4
+    DWORD   dwTSRecent;     // Latest TSval received, echoed in our timestamps option (RFC 7323 TS.Recent)
     PTR_BASE txUnackedTail; // TX tail pointer for data that is not yet acked
     WORD_VAL remotePort;    // Remote port number
     WORD_VAL localPort;     // Local port number
     WORD    remoteWindow;   // Remote window size
-    WORD    wFutureDataSize; // How much out-of-order data has been received
     union
     {
         NODE_INFO   niRemoteMACIP;  // 10 bytes for MAC and IP address
-        DWORD       dwRemoteHost;   // RAM or ROM pointer to a hostname string (ex: "www.microchip.com")
+        DWORD_PTR_BASE dwRemoteHost;    // RAM or ROM pointer to a hostname string (ex: "www.microchip.com")
     } remote;
-    SHORT   sHoleSize;  // Size of the hole, or -1 for none exists.  (0 indicates hole has just been filled)
+    TCP_SACK_BLOCK rxBlocks[TCP_RX_BLOCKS];     // Out-of-order data in the RX FIFO, as offsets from RemoteSEQ.  Most recently received first.
+    #if TCP_SACK
+    TCP_SACK_BLOCK txSACKed[TCP_SACK_BLOCKS];   // Data SACKed by the remote node, as offsets from the first unacknowledged byte
+    WORD    wHighRxt;       // Offset from the first unacknowledged byte below which holes were already retransmitted in this recovery
+    BYTE    vTxSACKed;      // Number of txSACKed blocks in use
+    #endif
+    BYTE    vRxBlocks;      // Number of rxBlocks in use
     struct
     {
         unsigned char bFINSent : 1;         // A FIN has been sent
         unsigned char bSYNSent : 1;         // A SYN has been sent
         unsigned char bRemoteHostIsROM : 1; // Remote host is stored in ROM
-        unsigned char bRXNoneACKed1 : 1;    // A duplicate ACK was likely received
-        unsigned char bRXNoneACKed2 : 1;    // A second duplicate ACK was likely received
-        unsigned char filler : 3;           // future use
+        unsigned char bFastRecovery : 1;    // In fast recovery after a fast retransmission
+        unsigned char bRTTPending : 1;      // A segment is being timed for the round trip time
+        unsigned char bWindowScale : 1;     // Window scale option offered, or used once connected
+        unsigned char bTimestamps : 1;      // Timestamps option offered, or used once connected
+        unsigned char bSACK : 1;            // SACK permitted option offered, or SACK used once connected
+        unsigned char bProbeSent : 1;       // A loss probe was sent since data was last ACKed
     } flags;
     WORD    wRemoteMSS; // Maximum Segment Size option advirtised by the remote node during initial handshaking
+    WORD    wCongWindow;    // Congestion window (cwnd) in bytes
+    WORD    wSSThresh;      // Slow start threshold in bytes
+    BYTE    vDupACKs;       // Duplicate ACKs received in a row
+    BYTE    vTxWindowShift; // Window scale of the remote node: its windows are shifted left by this
+    BYTE    vRxWindowShift; // Our window scale: our windows are shifted right by this
     #if defined(STACK_USE_SSL)
         WORD_VAL    localSSLPort;   // Local SSL port number (for listening sockets)
     #endif
@@ -209,6 +262,11 @@ void TCPClose(TCP_SOCKET hTCP);
 WORD TCPIsPutReady(TCP_SOCKET hTCP);
 BOOL TCPPut(TCP_SOCKET hTCP, BYTE byte);
 WORD TCPPutArray(TCP_SOCKET hTCP, BYTE* Data, WORD Len);
+WORD TCPPutFragments(TCP_SOCKET hTCP, TX_FRAGMENT* pFragments, BYTE vCount);
+#if defined(STACK_USE_MPFS2)
+	// hMPFS is an MPFS_HANDLE.  MPFS2.h is included after this file.
+	WORD TCPPutMPFS(TCP_SOCKET hTCP, BYTE hMPFS, WORD wLen);
+#endif
 BYTE* TCPPutString(TCP_SOCKET hTCP, BYTE* Data);
 WORD TCPIsGetReady(TCP_SOCKET hTCP);
 WORD TCPGetRxFIFOFree(TCP_SOCKET hTCP);
@@ -222,6 +280,9 @@ void TCPDiscard(TCP_SOCKET hTCP);
 BOOL TCPProcess(NODE_INFO* remote, IP_ADDR* localIP, WORD len);
 void TCPTick(void);
 void TCPFlush(TCP_SOCKET hTCP);
+void TCPHoldTX(TCP_SOCKET hTCP, BOOL bHold);
+BOOL TCPUnput(TCP_SOCKET hTCP, WORD wLen);
+BOOL TCPPokeArray(TCP_SOCKET hTCP, BYTE* data, WORD wLen, WORD wBack);
 
 // Create a server socket and ignore dwRemoteHost.
 #define TCP_OPEN_SERVER		0u
@@ -251,7 +312,7 @@ void TCPFlush(TCP_SOCKET hTCP);
 // Emit an undeclared identifier diagnostic if code tries to use TCP_OPEN_NODE_INFO while STACK_CLIENT_MODE feature is not enabled. 
     #define TCP_OPEN_NODE_INFO	You_need_to_enable_STACK_CLIENT_MODE_to_use_TCP_OPEN_NODE_INFO
 #endif
-TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose);
+TCP_SOCKET TCPOpen(DWORD_PTR_BASE dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose);
 
 #if defined(__18CXX)
     WORD TCPFindROMArrayEx(TCP_SOCKET hTCP, ROM BYTE* cFindArray, WORD wLen, WORD wStart, WORD wSearchLen, BOOL bTextCompare);
@@ -298,6 +359,10 @@ BOOL TCPIsSSL(TCP_SOCKET hTCP);
 void TCPSSLHandshakeComplete(TCP_SOCKET hTCP);
 void TCPSSLDecryptMAC(TCP_SOCKET hTCP, ARCFOUR_CTX* ctx, WORD len);
 void TCPSSLInPlaceMACEncrypt(TCP_SOCKET hTCP, ARCFOUR_CTX* ctx, BYTE* MACSecret, WORD len);
+#if defined(STACK_USE_AES_GCM)
+void TCPSSLDecryptGCM(TCP_SOCKET hTCP, AES_GCM_CTX* ctx, WORD len);
+void TCPSSLInPlaceGCMEncrypt(TCP_SOCKET hTCP, AES_GCM_CTX* ctx, BYTE* nonce, WORD len);
+#endif
 void TCPSSLPutRecordHeader(TCP_SOCKET hTCP, BYTE* hdr, BOOL recDone);
 WORD TCPSSLGetPendingTxSize(TCP_SOCKET hTCP);
 void TCPSSLHandleIncoming(TCP_SOCKET hTCP);
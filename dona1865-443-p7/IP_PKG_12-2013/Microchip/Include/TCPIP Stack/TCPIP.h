@@ -260,6 +260,18 @@
 		#define STACK_USE_RANDOM
 	#endif
 
+	// The TLS 1.2 AES-GCM cipher suite needs SHA-256 for its PRF
+	#if defined(STACK_USE_SSL) && defined(STACK_USE_SSL_AES_GCM)
+		#define STACK_USE_AES_GCM
+		#define STACK_USE_SHA256
+	#endif
+
+	// HTTP2 decompresses gzip files from MPFS2 for clients that 
+	// cannot accept them compressed
+	#if defined(STACK_USE_HTTP2_SERVER) && defined(HTTP_USE_INFLATE) && !defined(STACK_USE_MDD)
+		#define STACK_USE_INFLATE
+	#endif
+
 	// When using either RSA operation, include the RSA module
 	#if defined(STACK_USE_RSA_ENCRYPT) || defined(STACK_USE_RSA_DECRYPT)
             #define STACK_USE_RSA
@@ -304,6 +316,10 @@
     #include "TCPIP Stack/ARCFOUR.h"
 #endif
 
+#if defined(STACK_USE_AES_GCM)
+    #include "TCPIP Stack/AESGCM.h"
+#endif
+
 #if defined(STACK_USE_AUTO_IP)
     #include "TCPIP Stack/AutoIP.h"
 #endif
@@ -312,7 +328,7 @@
     #include "TCPIP Stack/Random.h"
 #endif
 
-#if defined(STACK_USE_MD5) || defined(STACK_USE_SHA1)
+#if defined(STACK_USE_MD5) || defined(STACK_USE_SHA1) || defined(STACK_USE_SHA256)
     #include "TCPIP Stack/Hashes.h"
 #endif
 
@@ -366,6 +382,10 @@
 	#include "TCPIP Stack/MPFS2.h"
 #endif
 
+#if defined(STACK_USE_INFLATE)
+	#include "TCPIP Stack/Inflate.h"
+#endif
+
 #if defined(STACK_USE_FTP_SERVER)
 	#include "TCPIP Stack/FTP.h"
 #endif
@@ -76,7 +76,7 @@ typedef struct
 	union
 	{
 		NODE_INFO	remoteNode;		// 10 bytes for MAC and IP address
-		DWORD		remoteHost;		// RAM or ROM pointer to a hostname string (ex: "www.microchip.com")
+		DWORD_PTR_BASE	remoteHost;		// RAM or ROM pointer to a hostname string (ex: "www.microchip.com")
 	} remote;
     //NODE_INFO   remoteNode;		// IP and MAC of remote node
     UDP_PORT    remotePort;		// Remote node's UDP port number
@@ -144,7 +144,7 @@ typedef struct
   ***************************************************************************/
 void UDPInit(void);
 void UDPTask(void);
-UDP_SOCKET UDPOpenEx(DWORD remoteHost, BYTE remoteHostType, UDP_PORT localPort,UDP_PORT remotePort);
+UDP_SOCKET UDPOpenEx(DWORD_PTR_BASE remoteHost, BYTE remoteHostType, UDP_PORT localPort,UDP_PORT remotePort);
 
 //UDP_SOCKET UDPOpen(UDP_PORT localPort, NODE_INFO *remoteNode, UDP_PORT remotePort);
 void UDPClose(UDP_SOCKET s);
@@ -157,6 +157,7 @@ BOOL UDPPut(BYTE v);
 WORD UDPPutArray(BYTE *cData, WORD wDataLen);
 BYTE* UDPPutString(BYTE *strData);
 void UDPFlush(void);
+WORD UDPFlushFragments(TX_FRAGMENT* pFragments, BYTE vCount);
 
 // ROM function variants for PIC18
 #if defined(__18CXX)
@@ -210,6 +211,6 @@ BOOL UDPIsOpened(UDP_SOCKET socket);
     When finished using the UDP socket handle, call the UDPClose() function 
     to free the socket and delete the handle.
   ***************************************************************************/
-#define UDPOpen(localPort,remoteNode,remotePort)  UDPOpenEx((DWORD)remoteNode,UDP_OPEN_NODE_INFO,localPort,remotePort)
+#define UDPOpen(localPort,remoteNode,remotePort)  UDPOpenEx((DWORD_PTR_BASE)remoteNode,UDP_OPEN_NODE_INFO,localPort,remotePort)
 
 #endif
@@ -0,0 +1,627 @@
+/*********************************************************************
+ *
+ *	AES-GCM Cryptography Library
+ *  Library for Microchip TCP/IP Stack
+ *	 - Provides authenticated encryption and decryption with AES-128 in
+ *     Galois/Counter Mode, used as the bulk cipher for TLS 1.2
+ *   - Reference: FIPS 197 (AES), NIST SP 800-38D (GCM), RFC 5288
+ *
+ *********************************************************************
+ * FileName:        AESGCM.c
+ * Dependencies:    None
+ * Processor:       PIC18, PIC24F, PIC24H, dsPIC30F, dsPIC33F, PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *					Microchip C30 v3.12 or higher
+ *					Microchip C18 v3.30 or higher
+ *					HI-TECH PICC-18 PRO 9.63PL2 or higher
+ * Company:         Microchip Technology, Inc.
+ *
+ * Software License Agreement
+ *
+ * Copyright (C) 2002-2009 Microchip Technology Inc.  All rights
+ * reserved.
+ *
+ * Microchip licenses to you the right to use, modify, copy, and
+ * distribute:
+ * (i)  the Software when embedded on a Microchip microcontroller or
+ *      digital signal controller product ("Device") which is
+ *      integrated into Licensee's product; or
+ * (ii) ONLY the Software driver source files ENC28J60.c, ENC28J60.h,
+ *		ENCX24J600.c and ENCX24J600.h ported to a non-Microchip device
+ *		used in conjunction with a Microchip ethernet controller for
+ *		the sole purpose of interfacing with the ethernet controller.
+ *
+ * You should refer to the license agreement accompanying this
+ * Software for additional information regarding your rights and
+ * obligations.
+ *
+ * THE SOFTWARE AND DOCUMENTATION ARE PROVIDED "AS IS" WITHOUT
+ * WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION, ANY WARRANTY OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * MICROCHIP BE LIABLE FOR ANY INCIDENTAL, SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF
+ * PROCUREMENT OF SUBSTITUTE GOODS, TECHNOLOGY OR SERVICES, ANY CLAIMS
+ * BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY DEFENSE
+ * THEREOF), ANY CLAIMS FOR INDEMNITY OR CONTRIBUTION, OR OTHER
+ * SIMILAR COSTS, WHETHER ASSERTED ON THE BASIS OF CONTRACT, TORT
+ * (INCLUDING NEGLIGENCE), BREACH OF WARRANTY, OR OTHERWISE.
+ *
+ * IMPORTANT:  The implementation and use of third party algorithms, 
+ * specifications and/or other technology may require a license from 
+ * various third parties.  It is your responsibility to obtain 
+ * information regarding any applicable licensing obligations.
+ *
+ *
+ * Author               Date		Comment
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *                      10/18/26	Original
+ ********************************************************************/
+#define __AESGCM_C
+
+#include "TCPIPConfig.h"
+
+#if defined(STACK_USE_SSL_SERVER) || defined(STACK_USE_SSL_CLIENT)
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(STACK_USE_AES_GCM)
+
+// AES S-box, used for the key schedule and the last round
+static ROM BYTE _AES_sbox[256] = {
+	0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+	0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+	0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+	0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+	0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+	0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+	0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+	0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+	0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+	0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+	0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+	0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+	0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+	0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+	0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+	0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+// AES round table for the first column.  The tables for the other
+// columns are rotations of this one, which saves 3 KB of ROM.
+static ROM DWORD _AES_Te0[256] = {
+	0xC66363A5, 0xF87C7C84, 0xEE777799, 0xF67B7B8D, 0xFFF2F20D, 0xD66B6BBD, 0xDE6F6FB1, 0x91C5C554,
+	0x60303050, 0x02010103, 0xCE6767A9, 0x562B2B7D, 0xE7FEFE19, 0xB5D7D762, 0x4DABABE6, 0xEC76769A,
+	0x8FCACA45, 0x1F82829D, 0x89C9C940, 0xFA7D7D87, 0xEFFAFA15, 0xB25959EB, 0x8E4747C9, 0xFBF0F00B,
+	0x41ADADEC, 0xB3D4D467, 0x5FA2A2FD, 0x45AFAFEA, 0x239C9CBF, 0x53A4A4F7, 0xE4727296, 0x9BC0C05B,
+	0x75B7B7C2, 0xE1FDFD1C, 0x3D9393AE, 0x4C26266A, 0x6C36365A, 0x7E3F3F41, 0xF5F7F702, 0x83CCCC4F,
+	0x6834345C, 0x51A5A5F4, 0xD1E5E534, 0xF9F1F108, 0xE2717193, 0xABD8D873, 0x62313153, 0x2A15153F,
+	0x0804040C, 0x95C7C752, 0x46232365, 0x9DC3C35E, 0x30181828, 0x379696A1, 0x0A05050F, 0x2F9A9AB5,
+	0x0E070709, 0x24121236, 0x1B80809B, 0xDFE2E23D, 0xCDEBEB26, 0x4E272769, 0x7FB2B2CD, 0xEA75759F,
+	0x1209091B, 0x1D83839E, 0x582C2C74, 0x341A1A2E, 0x361B1B2D, 0xDC6E6EB2, 0xB45A5AEE, 0x5BA0A0FB,
+	0xA45252F6, 0x763B3B4D, 0xB7D6D661, 0x7DB3B3CE, 0x5229297B, 0xDDE3E33E, 0x5E2F2F71, 0x13848497,
+	0xA65353F5, 0xB9D1D168, 0x00000000, 0xC1EDED2C, 0x40202060, 0xE3FCFC1F, 0x79B1B1C8, 0xB65B5BED,
+	0xD46A6ABE, 0x8DCBCB46, 0x67BEBED9, 0x7239394B, 0x944A4ADE, 0x984C4CD4, 0xB05858E8, 0x85CFCF4A,
+	0xBBD0D06B, 0xC5EFEF2A, 0x4FAAAAE5, 0xEDFBFB16, 0x864343C5, 0x9A4D4DD7, 0x66333355, 0x11858594,
+	0x8A4545CF, 0xE9F9F910, 0x04020206, 0xFE7F7F81, 0xA05050F0, 0x783C3C44, 0x259F9FBA, 0x4BA8A8E3,
+	0xA25151F3, 0x5DA3A3FE, 0x804040C0, 0x058F8F8A, 0x3F9292AD, 0x219D9DBC, 0x70383848, 0xF1F5F504,
+	0x63BCBCDF, 0x77B6B6C1, 0xAFDADA75, 0x42212163, 0x20101030, 0xE5FFFF1A, 0xFDF3F30E, 0xBFD2D26D,
+	0x81CDCD4C, 0x180C0C14, 0x26131335, 0xC3ECEC2F, 0xBE5F5FE1, 0x359797A2, 0x884444CC, 0x2E171739,
+	0x93C4C457, 0x55A7A7F2, 0xFC7E7E82, 0x7A3D3D47, 0xC86464AC, 0xBA5D5DE7, 0x3219192B, 0xE6737395,
+	0xC06060A0, 0x19818198, 0x9E4F4FD1, 0xA3DCDC7F, 0x44222266, 0x542A2A7E, 0x3B9090AB, 0x0B888883,
+	0x8C4646CA, 0xC7EEEE29, 0x6BB8B8D3, 0x2814143C, 0xA7DEDE79, 0xBC5E5EE2, 0x160B0B1D, 0xADDBDB76,
+	0xDBE0E03B, 0x64323256, 0x743A3A4E, 0x140A0A1E, 0x924949DB, 0x0C06060A, 0x4824246C, 0xB85C5CE4,
+	0x9FC2C25D, 0xBDD3D36E, 0x43ACACEF, 0xC46262A6, 0x399191A8, 0x319595A4, 0xD3E4E437, 0xF279798B,
+	0xD5E7E732, 0x8BC8C843, 0x6E373759, 0xDA6D6DB7, 0x018D8D8C, 0xB1D5D564, 0x9C4E4ED2, 0x49A9A9E0,
+	0xD86C6CB4, 0xAC5656FA, 0xF3F4F407, 0xCFEAEA25, 0xCA6565AF, 0xF47A7A8E, 0x47AEAEE9, 0x10080818,
+	0x6FBABAD5, 0xF0787888, 0x4A25256F, 0x5C2E2E72, 0x381C1C24, 0x57A6A6F1, 0x73B4B4C7, 0x97C6C651,
+	0xCBE8E823, 0xA1DDDD7C, 0xE874749C, 0x3E1F1F21, 0x964B4BDD, 0x61BDBDDC, 0x0D8B8B86, 0x0F8A8A85,
+	0xE0707090, 0x7C3E3E42, 0x71B5B5C4, 0xCC6666AA, 0x904848D8, 0x06030305, 0xF7F6F601, 0x1C0E0E12,
+	0xC26161A3, 0x6A35355F, 0xAE5757F9, 0x69B9B9D0, 0x17868691, 0x99C1C158, 0x3A1D1D27, 0x279E9EB9,
+	0xD9E1E138, 0xEBF8F813, 0x2B9898B3, 0x22111133, 0xD26969BB, 0xA9D9D970, 0x078E8E89, 0x339494A7,
+	0x2D9B9BB6, 0x3C1E1E22, 0x15878792, 0xC9E9E920, 0x87CECE49, 0xAA5555FF, 0x50282878, 0xA5DFDF7A,
+	0x038C8C8F, 0x59A1A1F8, 0x09898980, 0x1A0D0D17, 0x65BFBFDA, 0xD7E6E631, 0x844242C6, 0xD06868B8,
+	0x824141C3, 0x299999B0, 0x5A2D2D77, 0x1E0F0F11, 0x7BB0B0CB, 0xA85454FC, 0x6DBBBBD6, 0x2C16163A
+};
+
+// GHASH reduction of the 4 bits shifted out of a 128-bit value
+static ROM WORD _GHASH_last4[16] = {
+	0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+	0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0
+};
+
+#define AESRotate8(x)	(((x) >> 8) | ((x) << 24))
+#define AESRotate16(x)	(((x) >> 16) | ((x) << 16))
+#define AESRotate24(x)	(((x) >> 24) | ((x) << 8))
+
+static void AESEncryptBlock(BYTE* key, BYTE* in, BYTE* out);
+static void GHASHMultiply(AES_GCM_CTX* ctx);
+static void AESGCMCrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len, BOOL bEncrypt);
+static DWORD GetBigDWORD(BYTE* data);
+static void PutBigDWORD(BYTE* data, DWORD val);
+
+/*****************************************************************************
+  Function:
+	void AESGCMInitialize(AES_GCM_CTX* ctx, BYTE* key, BYTE* salt)
+
+  Summary:
+	Initializes an AES-GCM encryption stream.
+
+  Description:
+	This function initializes an AES-GCM context with a 16 byte key and
+	the 4 byte implicit part of the nonce.  The hash subkey H is
+	calculated and the GHASH multiplication table is filled in.
+	
+	This function can be used to initialize for encryption and decryption.
+
+  Precondition:
+	ctx->table points to 256 bytes of DWORD aligned storage.
+
+  Parameters:
+	ctx - A pointer to the allocated encryption context structure
+	key - A pointer to the 16 byte key to be used
+	salt - A pointer to the 4 byte implicit nonce
+
+  Returns:
+	None
+
+  Remarks:
+	For security, the key should be destroyed after this call.
+  ***************************************************************************/
+void AESGCMInitialize(AES_GCM_CTX* ctx, BYTE* key, BYTE* salt)
+{
+	DWORD v0, v1, v2, v3, t, *m;
+	BYTE i, j;
+
+	memcpy((void*)ctx->key, (void*)key, 16);
+	memcpy((void*)ctx->counter, (void*)salt, 4);
+
+	// H is the encryption of the zero block
+	memset((void*)ctx->stream, 0x00, 16);
+	AESEncryptBlock(ctx->key, ctx->stream, ctx->stream);
+	v0 = GetBigDWORD(&ctx->stream[0]);
+	v1 = GetBigDWORD(&ctx->stream[4]);
+	v2 = GetBigDWORD(&ctx->stream[8]);
+	v3 = GetBigDWORD(&ctx->stream[12]);
+
+	// Entries 8, 4, 2 and 1 are H, H*x, H*x^2 and H*x^3
+	m = ctx->table;
+	m[0] = m[1] = m[2] = m[3] = 0;
+	m[32] = v0; m[33] = v1; m[34] = v2; m[35] = v3;
+	for(i = 4; i != 0u; i >>= 1)
+	{
+		t = (v3 & 1) ? 0xE1000000ul : 0;
+		v3 = (v3 >> 1) | (v2 << 31);
+		v2 = (v2 >> 1) | (v1 << 31);
+		v1 = (v1 >> 1) | (v0 << 31);
+		v0 = (v0 >> 1) ^ t;
+		m[i*4+0] = v0; m[i*4+1] = v1; m[i*4+2] = v2; m[i*4+3] = v3;
+	}
+
+	// The other entries are sums of those
+	for(i = 2; i <= 8u; i <<= 1)
+	{
+		for(j = 1; j < i; j++)
+		{
+			m[(i+j)*4+0] = m[i*4+0] ^ m[j*4+0];
+			m[(i+j)*4+1] = m[i*4+1] ^ m[j*4+1];
+			m[(i+j)*4+2] = m[i*4+2] ^ m[j*4+2];
+			m[(i+j)*4+3] = m[i*4+3] ^ m[j*4+3];
+		}
+	}
+}
+
+/*****************************************************************************
+  Function:
+	void AESGCMStart(AES_GCM_CTX* ctx, BYTE* nonce, BYTE* aad, WORD aadLen)
+
+  Summary:
+	Begins a new AES-GCM message.
+
+  Description:
+	This function sets up the counter block from the salt and the 8 byte
+	explicit nonce, resets the GHASH accumulator and hashes in the 
+	additional authenticated data.
+
+  Precondition:
+	The encryption context ctx has been initialized with AESGCMInitialize.
+
+  Parameters:
+	ctx - A pointer to the initialized encryption context structure
+	nonce - The 8 byte explicit nonce for this message
+	aad - The additional authenticated data
+	aadLen - The length of aad
+
+  Returns:
+	None
+
+  Remarks:
+	Each nonce must only be used once with a given key.
+  ***************************************************************************/
+void AESGCMStart(AES_GCM_CTX* ctx, BYTE* nonce, BYTE* aad, WORD aadLen)
+{
+	BYTE i;
+	
+	// Counter 1 is used for the tag, so data starts at counter 2
+	memcpy((void*)&ctx->counter[4], (void*)nonce, 8);
+	ctx->counter[12] = 0;
+	ctx->counter[13] = 0;
+	ctx->counter[14] = 0;
+	ctx->counter[15] = 2;
+	
+	ctx->textLen = 0;
+	ctx->aadLen = aadLen;
+	memset((void*)ctx->hash, 0x00, 16);
+	
+	// Hash the data in 16 byte blocks, zero padding the last one
+	while(aadLen)
+	{
+		for(i = 0; i < 16u && aadLen; i++, aadLen--)
+			ctx->hash[i] ^= *aad++;
+		GHASHMultiply(ctx);
+	}
+}
+
+/*****************************************************************************
+  Function:
+	void AESGCMEncrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len)
+
+  Summary:
+	Encrypts and authenticates an array of data.
+
+  Description:
+	This function encrypts data in place and adds the cipher text to
+	the GHASH calculation, in a single pass over the data.  It may be 
+	called several times per message with any lengths.
+
+  Precondition:
+	AESGCMStart has been called for this message.
+
+  Parameters:
+	ctx - A pointer to the initialized encryption context structure
+	data - The data to be encrypted (in place)
+	len - The length of data
+
+  Returns:
+	None
+  ***************************************************************************/
+void AESGCMEncrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len)
+{
+	AESGCMCrypt(ctx, data, len, TRUE);
+}
+
+/*****************************************************************************
+  Function:
+	void AESGCMDecrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len)
+
+  Summary:
+	Decrypts and authenticates an array of data.
+
+  Description:
+	This function adds the cipher text to the GHASH calculation and
+	decrypts it in place, in a single pass over the data.  It may be 
+	called several times per message with any lengths.
+
+  Precondition:
+	AESGCMStart has been called for this message.
+
+  Parameters:
+	ctx - A pointer to the initialized encryption context structure
+	data - The data to be decrypted (in place)
+	len - The length of data
+
+  Returns:
+	None
+
+  Remarks:
+	The data is not authentic until the tag from AESGCMCalculate has
+	been compared with the one received.
+  ***************************************************************************/
+void AESGCMDecrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len)
+{
+	AESGCMCrypt(ctx, data, len, FALSE);
+}
+
+/*****************************************************************************
+  Function:
+	void AESGCMCalculate(AES_GCM_CTX* ctx, BYTE* tag)
+
+  Summary:
+	Calculates the authentication tag of a message.
+
+  Description:
+	This function finishes the GHASH calculation with the lengths of the
+	additional data and of the text, then encrypts it to form the tag.
+
+  Precondition:
+	AESGCMStart has been called for this message.
+
+  Parameters:
+	ctx - A pointer to the initialized encryption context structure
+	tag - 16 byte array in which to store the tag
+
+  Returns:
+	None
+
+  Remarks:
+	The context cannot be used for more data until AESGCMStart is called
+	again.
+  ***************************************************************************/
+void AESGCMCalculate(AES_GCM_CTX* ctx, BYTE* tag)
+{
+	BYTE i;
+	
+	// Finish the last partial block
+	if(ctx->textLen & 0x0F)
+		GHASHMultiply(ctx);
+
+	// Hash the lengths in bits, as two 64-bit big-endian values
+	PutBigDWORD(&ctx->hash[4], GetBigDWORD(&ctx->hash[4]) ^ ((DWORD)ctx->aadLen << 3));
+	ctx->hash[11] ^= (BYTE)(ctx->textLen >> 29);
+	PutBigDWORD(&ctx->hash[12], GetBigDWORD(&ctx->hash[12]) ^ (ctx->textLen << 3));
+	GHASHMultiply(ctx);
+
+	// Encrypt the hash with counter 1
+	ctx->counter[12] = 0;
+	ctx->counter[13] = 0;
+	ctx->counter[14] = 0;
+	ctx->counter[15] = 1;
+	AESEncryptBlock(ctx->key, ctx->counter, ctx->stream);
+	for(i = 0; i < 16u; i++)
+		tag[i] = ctx->hash[i] ^ ctx->stream[i];
+}
+
+/*****************************************************************************
+  Function:
+	static void AESGCMCrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len, 
+								BOOL bEncrypt)
+
+  Summary:
+	Processes an array of data in counter mode and hashes the cipher text.
+
+  Description:
+	This function generates a new block of key stream whenever the last 
+	one has been used, XORs it with the data and adds the cipher text to
+	the GHASH accumulator, multiplying at the end of each 16 byte block.
+
+  Precondition:
+	AESGCMStart has been called for this message.
+
+  Parameters:
+	ctx - A pointer to the initialized encryption context structure
+	data - The data to be processed (in place)
+	len - The length of data
+	bEncrypt - TRUE to encrypt, FALSE to decrypt
+
+  Returns:
+	None
+  ***************************************************************************/
+static void AESGCMCrypt(AES_GCM_CTX* ctx, BYTE* data, WORD len, BOOL bEncrypt)
+{
+	BYTE pos, c;
+	
+	pos = (BYTE)ctx->textLen & 0x0F;
+	ctx->textLen += len;
+	
+	while(len--)
+	{
+		// Generate the next key stream block and increment the counter
+		if(pos == 0u)
+		{
+			AESEncryptBlock(ctx->key, ctx->counter, ctx->stream);
+			if(++ctx->counter[15] == 0u)
+				if(++ctx->counter[14] == 0u)
+					if(++ctx->counter[13] == 0u)
+						++ctx->counter[12];
+		}
+		
+		// The cipher text is hashed in both directions
+		c = *data;
+		if(bEncrypt)
+			c ^= ctx->stream[pos];
+		ctx->hash[pos] ^= c;
+		*data++ ^= ctx->stream[pos];
+		
+		if(++pos == 16u)
+		{
+			GHASHMultiply(ctx);
+			pos = 0;
+		}
+	}
+}
+
+/*****************************************************************************
+  Function:
+	static void GHASHMultiply(AES_GCM_CTX* ctx)
+
+  Summary:
+	Multiplies the GHASH accumulator by H.
+
+  Description:
+	This function multiplies ctx->hash by the hash subkey H in GF(2^128),
+	4 bits at a time using the table built by AESGCMInitialize.  The 
+	bits shifted out at each step are reduced with _GHASH_last4.
+
+  Precondition:
+	The encryption context ctx has been initialized with AESGCMInitialize.
+
+  Parameters:
+	ctx - A pointer to the initialized encryption context structure
+
+  Returns:
+	None
+  ***************************************************************************/
+static void GHASHMultiply(AES_GCM_CTX* ctx)
+{
+	DWORD z0, z1, z2, z3, *m;
+	BYTE i, nibble, rem;
+
+	z0 = z1 = z2 = z3 = 0;
+	
+	// Start with the low nibble of the last byte
+	for(i = 32; i-- != 0u; )
+	{
+		nibble = ctx->hash[i >> 1];
+		if(i & 1)
+			nibble &= 0x0F;
+		else
+			nibble >>= 4;
+		
+		// Multiply by x^4
+		rem = (BYTE)z3 & 0x0F;
+		z3 = (z3 >> 4) | (z2 << 28);
+		z2 = (z2 >> 4) | (z1 << 28);
+		z1 = (z1 >> 4) | (z0 << 28);
+		z0 = (z0 >> 4) ^ ((DWORD)_GHASH_last4[rem] << 16);
+		
+		// Add in H times the nibble
+		m = ctx->table + (nibble << 2);
+		z0 ^= m[0];
+		z1 ^= m[1];
+		z2 ^= m[2];
+		z3 ^= m[3];
+	}
+	
+	PutBigDWORD(&ctx->hash[0], z0);
+	PutBigDWORD(&ctx->hash[4], z1);
+	PutBigDWORD(&ctx->hash[8], z2);
+	PutBigDWORD(&ctx->hash[12], z3);
+}
+
+/*****************************************************************************
+  Function:
+	static void AESEncryptBlock(BYTE* key, BYTE* in, BYTE* out)
+
+  Summary:
+	Encrypts one block with AES-128.
+
+  Description:
+	This function encrypts a 16 byte block.  The round keys are expanded
+	from the key as they are needed, so no key schedule has to be kept 
+	in RAM.
+
+  Precondition:
+	None
+
+  Parameters:
+	key - The 16 byte key
+	in - The block to encrypt
+	out - Where to store the result (may be the same as in)
+
+  Returns:
+	None
+  ***************************************************************************/
+static void AESEncryptBlock(BYTE* key, BYTE* in, BYTE* out)
+{
+	DWORD rk0, rk1, rk2, rk3, s0, s1, s2, s3, t0, t1, t2, t3;
+	BYTE round, rcon;
+
+	// Load the key and the block as big-endian columns
+	rk0 = GetBigDWORD(&key[0]);
+	rk1 = GetBigDWORD(&key[4]);
+	rk2 = GetBigDWORD(&key[8]);
+	rk3 = GetBigDWORD(&key[12]);
+	s0 = GetBigDWORD(&in[0]) ^ rk0;
+	s1 = GetBigDWORD(&in[4]) ^ rk1;
+	s2 = GetBigDWORD(&in[8]) ^ rk2;
+	s3 = GetBigDWORD(&in[12]) ^ rk3;
+
+	rcon = 0x01;
+	for(round = 1; ; round++)
+	{
+		// Expand the round key
+		rk0 ^= ((DWORD)_AES_sbox[(BYTE)(rk3 >> 16)] << 24) ^ 
+				((DWORD)_AES_sbox[(BYTE)(rk3 >> 8)] << 16) ^ 
+				((DWORD)_AES_sbox[(BYTE)rk3] << 8) ^ 
+				(DWORD)_AES_sbox[(BYTE)(rk3 >> 24)] ^ 
+				((DWORD)rcon << 24);
+		rk1 ^= rk0;
+		rk2 ^= rk1;
+		rk3 ^= rk2;
+		rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0x00);
+		
+		if(round == 10u)
+			break;
+
+		// SubBytes, ShiftRows, MixColumns and AddRoundKey
+		t0 = _AES_Te0[(BYTE)(s0 >> 24)] ^ AESRotate8(_AES_Te0[(BYTE)(s1 >> 16)]) ^ 
+			 AESRotate16(_AES_Te0[(BYTE)(s2 >> 8)]) ^ AESRotate24(_AES_Te0[(BYTE)s3]) ^ rk0;
+		t1 = _AES_Te0[(BYTE)(s1 >> 24)] ^ AESRotate8(_AES_Te0[(BYTE)(s2 >> 16)]) ^ 
+			 AESRotate16(_AES_Te0[(BYTE)(s3 >> 8)]) ^ AESRotate24(_AES_Te0[(BYTE)s0]) ^ rk1;
+		t2 = _AES_Te0[(BYTE)(s2 >> 24)] ^ AESRotate8(_AES_Te0[(BYTE)(s3 >> 16)]) ^ 
+			 AESRotate16(_AES_Te0[(BYTE)(s0 >> 8)]) ^ AESRotate24(_AES_Te0[(BYTE)s1]) ^ rk2;
+		t3 = _AES_Te0[(BYTE)(s3 >> 24)] ^ AESRotate8(_AES_Te0[(BYTE)(s0 >> 16)]) ^ 
+			 AESRotate16(_AES_Te0[(BYTE)(s1 >> 8)]) ^ AESRotate24(_AES_Te0[(BYTE)s2]) ^ rk3;
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	// The last round has no MixColumns
+	out[0]  = _AES_sbox[(BYTE)(s0 >> 24)] ^ (BYTE)(rk0 >> 24);
+	out[1]  = _AES_sbox[(BYTE)(s1 >> 16)] ^ (BYTE)(rk0 >> 16);
+	out[2]  = _AES_sbox[(BYTE)(s2 >> 8)]  ^ (BYTE)(rk0 >> 8);
+	out[3]  = _AES_sbox[(BYTE)s3]         ^ (BYTE)rk0;
+	out[4]  = _AES_sbox[(BYTE)(s1 >> 24)] ^ (BYTE)(rk1 >> 24);
+	out[5]  = _AES_sbox[(BYTE)(s2 >> 16)] ^ (BYTE)(rk1 >> 16);
+	out[6]  = _AES_sbox[(BYTE)(s3 >> 8)]  ^ (BYTE)(rk1 >> 8);
+	out[7]  = _AES_sbox[(BYTE)s0]         ^ (BYTE)rk1;
+	out[8]  = _AES_sbox[(BYTE)(s2 >> 24)] ^ (BYTE)(rk2 >> 24);
+	out[9]  = _AES_sbox[(BYTE)(s3 >> 16)] ^ (BYTE)(rk2 >> 16);
+	out[10] = _AES_sbox[(BYTE)(s0 >> 8)]  ^ (BYTE)(rk2 >> 8);
+	out[11] = _AES_sbox[(BYTE)s1]         ^ (BYTE)rk2;
+	out[12] = _AES_sbox[(BYTE)(s3 >> 24)] ^ (BYTE)(rk3 >> 24);
+	out[13] = _AES_sbox[(BYTE)(s0 >> 16)] ^ (BYTE)(rk3 >> 16);
+	out[14] = _AES_sbox[(BYTE)(s1 >> 8)]  ^ (BYTE)(rk3 >> 8);
+	out[15] = _AES_sbox[(BYTE)s2]         ^ (BYTE)rk3;
+}
+
+/*****************************************************************************
+  Function:
+	static DWORD GetBigDWORD(BYTE* data)
+
+  Description:
+	Reads a big-endian DWORD.
+
+  Precondition:
+	None
+
+  Parameters:
+	data - The 4 bytes to read
+
+  Returns:
+	The value read
+  ***************************************************************************/
+static DWORD GetBigDWORD(BYTE* data)
+{
+	return ((DWORD)data[0] << 24) | ((DWORD)data[1] << 16) | ((DWORD)data[2] << 8) | (DWORD)data[3];
+}
+
+/*****************************************************************************
+  Function:
+	static void PutBigDWORD(BYTE* data, DWORD val)
+
+  Description:
+	Writes a big-endian DWORD.
+
+  Precondition:
+	None
+
+  Parameters:
+	data - Where to write the 4 bytes
+	val - The value to write
+
+  Returns:
+	None
+  ***************************************************************************/
+static void PutBigDWORD(BYTE* data, DWORD val)
+{
+	data[0] = (BYTE)(val >> 24);
+	data[1] = (BYTE)(val >> 16);
+	data[2] = (BYTE)(val >> 8);
+	data[3] = (BYTE)val;
+}
+
+#endif //#if defined(STACK_USE_AES_GCM)
+#endif //#if defined(STACK_USE_SSL_SERVER) || defined(STACK_USE_SSL_CLIENT)
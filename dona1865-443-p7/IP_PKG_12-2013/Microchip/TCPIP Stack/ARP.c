@@ -58,6 +58,8 @@
  * Nilesh Rajbharti     5/22/02 Rev 2.0 (See version.log for detail)
  * Howard Schlunder		8/17/06	Combined ARP.c and ARPTsk.c into ARP.c; 
  *								rewrote some of it to look more linear
+ *                      10/18/26 Replaced the single entry cache with a
+ *                               hashed multi-entry cache with aging
  ********************************************************************/
 #define __ARP_C
 
@@ -76,7 +78,50 @@
 #endif
 
 #ifdef STACK_CLIENT_MODE
-static NODE_INFO Cache;						// Cache for one ARP response
+// Number of addresses kept in the ARP cache.  When the cache is full, the 
+// least recently used entry is replaced.  Each entry uses 20 bytes of RAM.  
+// Can be overridden in TCPIPConfig.h.
+#if !defined(ARP_CACHE_ENTRIES)
+	#define ARP_CACHE_ENTRIES		(8u)
+#endif
+
+// Number of hash chains in the ARP cache.  Must be a power of 2.
+#if !defined(ARP_CACHE_BUCKETS)
+	#define ARP_CACHE_BUCKETS		(8u)
+#endif
+
+#if (ARP_CACHE_ENTRIES == 0u) || (ARP_CACHE_ENTRIES > 255u)
+	#error "ARP_CACHE_ENTRIES must be between 1 and 255"
+#endif
+#if (ARP_CACHE_BUCKETS & (ARP_CACHE_BUCKETS - 1)) || (ARP_CACHE_BUCKETS > 256)
+	#error "ARP_CACHE_BUCKETS must be a power of 2 no larger than 256"
+#endif
+
+#define ARP_CACHE_TIMEOUT			((DWORD)TICK_MINUTE*5)	// Time a resolved address is used without hearing from the node again
+#define ARP_CACHE_PENDING_TIMEOUT	((DWORD)TICK_SECOND*5)	// Time an unanswered request is kept
+#define ARP_CACHE_RETRY_INTERVAL	((DWORD)TICK_SECOND/4)	// Minimum time between two requests for the same address
+
+// ARP cache entry states
+#define ARP_ENTRY_FREE				(0u)	// Unused
+#define ARP_ENTRY_PENDING			(1u)	// Request sent, waiting for the response
+#define ARP_ENTRY_RESOLVED			(2u)	// MAC address known
+
+#define ARP_CACHE_INVALID			(0xFFu)	// End of a hash chain
+
+// ARP cache entry
+typedef struct
+{
+	NODE_INFO	node;		// IP address and resolved MAC address
+	DWORD		dwUpdated;	// Time of the last response, or of the last request while pending
+	DWORD		dwUsed;		// Time of the last lookup, for least recently used replacement
+	BYTE		vState;		// ARP_ENTRY_* state
+	BYTE		vNext;		// Next entry in the same hash chain
+} ARP_CACHE_ENTRY;
+
+#define ARP_CACHE_BUCKET(ip)	(((ip)->v[2] ^ (ip)->v[3]) & (ARP_CACHE_BUCKETS-1u))
+
+static ARP_CACHE_ENTRY Cache[ARP_CACHE_ENTRIES];	// Resolved and pending addresses
+static BYTE CacheHead[ARP_CACHE_BUCKETS];			// First entry of each hash chain
 #endif
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
@@ -107,6 +152,14 @@ typedef struct __attribute__((aligned(2), packed))
 
 static BOOL ARPPut(ARP_PACKET* packet);
 
+#ifdef STACK_CLIENT_MODE
+static BYTE ARPCacheFind(IP_ADDR* IPAddr);
+static BYTE ARPCacheAdd(IP_ADDR* IPAddr);
+static void ARPCacheRemove(BYTE i);
+static void ARPCacheUpdate(IP_ADDR* IPAddr, MAC_ADDR* MACAddr, BOOL bAdd);
+static IP_ADDR ARPNextHop(IP_ADDR* IPAddr);
+#endif
+
 
 /****************************************************************************
   Section:
@@ -289,18 +342,19 @@ BOOL ARPSendPkt(DWORD SrcIPAddr, DWORD DestIPAddr, BYTE op_req )
 #define KS_ARP_IP_MULTICAST_HACK y
 #ifdef KS_ARP_IP_MULTICAST_HACK
 	DWORD_VAL *DestAddr = (DWORD_VAL *)&DestIPAddr;
+	MAC_ADDR MulticastMAC;
 	if ((DestAddr->v[0] >= 224) &&(DestAddr->v[0] <= 239)) {
 		// "Resolve" the IP to MAC address mapping for
 		// IP multicast address range from 224.0.0.0 to 239.255.255.255
 	
-		Cache.MACAddr.v[0] = 0x01;
-		Cache.MACAddr.v[1] = 0x00;
-		Cache.MACAddr.v[2] = 0x5E;
-		Cache.MACAddr.v[3] = 0x7f & DestAddr->v[1];
-		Cache.MACAddr.v[4] = DestAddr->v[2];
-		Cache.MACAddr.v[5] = DestAddr->v[3];
+		MulticastMAC.v[0] = 0x01;
+		MulticastMAC.v[1] = 0x00;
+		MulticastMAC.v[2] = 0x5E;
+		MulticastMAC.v[3] = 0x7f & DestAddr->v[1];
+		MulticastMAC.v[4] = DestAddr->v[2];
+		MulticastMAC.v[5] = DestAddr->v[3];
 	
-		Cache.IPAddr.Val = DestAddr->Val;
+		ARPCacheUpdate((IP_ADDR*)DestAddr, &MulticastMAC, TRUE);
 	
 		return TRUE;
 	}
@@ -378,7 +432,7 @@ static BOOL ARPPut(ARP_PACKET* packet)
 	
   Description:
   	Initializes the ARP module.  Call this function once at boot to 
-  	invalidate the cached lookup.
+  	empty the ARP cache.
 
   Precondition:
 	None
@@ -396,14 +450,11 @@ static BOOL ARPPut(ARP_PACKET* packet)
 #ifdef STACK_CLIENT_MODE
 void ARPInit(void)
 {
-    Cache.MACAddr.v[0] = 0xff;
-    Cache.MACAddr.v[1] = 0xff;
-    Cache.MACAddr.v[2] = 0xff;
-    Cache.MACAddr.v[3] = 0xff;
-    Cache.MACAddr.v[4] = 0xff;
-    Cache.MACAddr.v[5] = 0xff;
-
-	Cache.IPAddr.Val = 0xfffffffful;
+	BYTE i;
+
+	for(i = 0; i < ARP_CACHE_ENTRIES; i++)
+		Cache[i].vState = ARP_ENTRY_FREE;
+	memset((void*)CacheHead, ARP_CACHE_INVALID, sizeof(CacheHead));
 }
 #endif
 
@@ -475,6 +526,21 @@ BOOL ARPProcess(void)
 
 			// Handle incoming ARP responses
 #ifdef STACK_CLIENT_MODE
+			// Refresh the cache entry of the sender on every ARP packet, 
+			// so that gratuitous ARPs update a changed MAC address.  
+			// Responses and requests for our address also add the sender, 
+			// since we are about to talk to it.  Probes (sender IP 0) 
+			// are ignored.
+			if(packet.SenderIPAddr.Val != 0x00000000ul)
+			{
+				// ARP_PACKET is packed, so copy the sender addresses to 
+				// aligned locals before passing pointers to them.
+				IP_ADDR SenderIPAddr = packet.SenderIPAddr;
+				MAC_ADDR SenderMACAddr = packet.SenderMACAddr;
+
+				ARPCacheUpdate(&SenderIPAddr, &SenderMACAddr, packet.Operation == ARP_OPERATION_RESP || packet.TargetIPAddr.Val == AppConfig.MyIPAddr.Val);
+			}
+
 			if(packet.Operation == ARP_OPERATION_RESP)
 			{
 /*                #if defined(STACK_USE_AUTO_IP)
@@ -482,9 +548,6 @@ BOOL ARPProcess(void)
                     if (AutoIPConfigIsInProgress(i))
                         AutoIPConflict(i);
                 #endif*/
-				Cache.MACAddr = packet.SenderMACAddr;
-				Cache.IPAddr = packet.SenderIPAddr;
-				
 				//putsUART("ARPProcess: SM_ARP_IDLE: ARP_OPERATION_RESP  \r\n"); 
 				return TRUE;
 			}
@@ -570,7 +633,10 @@ BOOL ARPProcess(void)
 	
   Description:
   	This function transmits and ARP request to determine the hardware
-  	address of a given IP address.
+  	address of a given IP address.  No request is sent if the address is 
+  	already in the ARP cache, or if a request for it was sent less than 
+  	ARP_CACHE_RETRY_INTERVAL ago, so any number of modules waiting for the 
+  	same node share one request.
 
   Precondition:
 	None
@@ -592,23 +658,27 @@ BOOL ARPProcess(void)
 void ARPResolve(IP_ADDR* IPAddr)
 {
     ARP_PACKET packet;
+	IP_ADDR NextHop;
+	BYTE i;
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
 #define KS_ARP_IP_MULTICAST_HACK y
 #ifdef KS_ARP_IP_MULTICAST_HACK
     if ((IPAddr->v[0] >= 224) &&(IPAddr->v[0] <= 239))
     {
+		MAC_ADDR MulticastMAC;
+
 		// "Resolve" the IP to MAC address mapping for
 		// IP multicast address range from 224.0.0.0 to 239.255.255.255
 
-		Cache.MACAddr.v[0] = 0x01;
-		Cache.MACAddr.v[1] = 0x00;
-		Cache.MACAddr.v[2] = 0x5E;
-		Cache.MACAddr.v[3] = 0x7f & IPAddr->v[1];
-		Cache.MACAddr.v[4] = IPAddr->v[2];
-		Cache.MACAddr.v[5] = IPAddr->v[3];
+		MulticastMAC.v[0] = 0x01;
+		MulticastMAC.v[1] = 0x00;
+		MulticastMAC.v[2] = 0x5E;
+		MulticastMAC.v[3] = 0x7f & IPAddr->v[1];
+		MulticastMAC.v[4] = IPAddr->v[2];
+		MulticastMAC.v[5] = IPAddr->v[3];
 
-		Cache.IPAddr.Val = IPAddr->Val;
+		ARPCacheUpdate(IPAddr, &MulticastMAC, TRUE);
 
 		return;
 	}
@@ -626,7 +696,25 @@ void ARPResolve(IP_ADDR* IPAddr)
 	//putsUART("ARPResolve() \r\n"); 
 
     // ARP query either the IP address directly (on our subnet), or do an ARP query for our Gateway if off of our subnet
-	packet.TargetIPAddr			= ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val) ? AppConfig.MyGateway : *IPAddr;
+	NextHop = ARPNextHop(IPAddr);
+
+	// Nothing to send if the address is known or was just asked for
+	i = ARPCacheFind(&NextHop);
+	if(i != ARP_CACHE_INVALID)
+	{
+		if(Cache[i].vState == ARP_ENTRY_RESOLVED)
+			return;
+		if(TickGet() - Cache[i].dwUpdated < ARP_CACHE_RETRY_INTERVAL)
+			return;
+	}
+	else
+	{
+		i = ARPCacheAdd(&NextHop);
+		Cache[i].vState = ARP_ENTRY_PENDING;
+	}
+	Cache[i].dwUpdated = TickGet();
+
+	packet.TargetIPAddr			= NextHop;
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
 	packet.SenderIPAddr			= AppConfig.MyIPAddr;
 #endif
@@ -676,10 +764,15 @@ void ARPResolve(IP_ADDR* IPAddr)
 #ifdef STACK_CLIENT_MODE
 BOOL ARPIsResolved(IP_ADDR* IPAddr, MAC_ADDR* MACAddr)
 {
-    if((Cache.IPAddr.Val == IPAddr->Val) || 
-	  ((Cache.IPAddr.Val == AppConfig.MyGateway.Val) && ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val)))
+	IP_ADDR NextHop;
+	BYTE i;
+
+	NextHop = ARPNextHop(IPAddr);
+	i = ARPCacheFind(&NextHop);
+    if((i != ARP_CACHE_INVALID) && (Cache[i].vState == ARP_ENTRY_RESOLVED))
     {
-        *MACAddr = Cache.MACAddr;		
+        *MACAddr = Cache[i].node.MACAddr;
+		Cache[i].dwUsed = TickGet();
 		//putsUART("ARPIsResolved  \r\n"); 
         return TRUE;
     }
@@ -692,6 +785,191 @@ BOOL ARPIsResolved(IP_ADDR* IPAddr, MAC_ADDR* MACAddr)
 
 
 
+/****************************************************************************
+  Section:
+	ARP Cache Functions
+  ***************************************************************************/
+#ifdef STACK_CLIENT_MODE
+
+/*****************************************************************************
+  Function:
+	static IP_ADDR ARPNextHop(IP_ADDR* IPAddr)
+
+  Description:
+	Returns the address that must be resolved to reach a node: the node 
+	itself if it is on our subnet, otherwise the gateway.
+
+  Precondition:
+	None
+
+  Parameters:
+	IPAddr - The destination IP address
+
+  Returns:
+  	The IP address of the next hop
+  ***************************************************************************/
+static IP_ADDR ARPNextHop(IP_ADDR* IPAddr)
+{
+	return ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val) ? AppConfig.MyGateway : *IPAddr;
+}
+
+/*****************************************************************************
+  Function:
+	static BYTE ARPCacheFind(IP_ADDR* IPAddr)
+
+  Description:
+	Looks up an IP address in the ARP cache.  Entries that have timed out 
+	are removed when they are found.
+
+  Precondition:
+	ARPInit() has been called.
+
+  Parameters:
+	IPAddr - The IP address to find
+
+  Returns:
+  	Index of the pending or resolved entry, or ARP_CACHE_INVALID if the 
+  	address is not in the cache
+  ***************************************************************************/
+static BYTE ARPCacheFind(IP_ADDR* IPAddr)
+{
+	BYTE i;
+	DWORD dwAge;
+
+	for(i = CacheHead[ARP_CACHE_BUCKET(IPAddr)]; i != ARP_CACHE_INVALID; i = Cache[i].vNext)
+	{
+		if(Cache[i].node.IPAddr.Val != IPAddr->Val)
+			continue;
+
+		dwAge = TickGet() - Cache[i].dwUpdated;
+		if((Cache[i].vState == ARP_ENTRY_RESOLVED && dwAge > ARP_CACHE_TIMEOUT) ||
+		   (Cache[i].vState == ARP_ENTRY_PENDING && dwAge > ARP_CACHE_PENDING_TIMEOUT))
+		{
+			ARPCacheRemove(i);
+			return ARP_CACHE_INVALID;
+		}
+		return i;
+	}
+
+	return ARP_CACHE_INVALID;
+}
+
+/*****************************************************************************
+  Function:
+	static BYTE ARPCacheAdd(IP_ADDR* IPAddr)
+
+  Description:
+	Adds an IP address to the ARP cache.  A free entry is used if there is 
+	one, otherwise the least recently used entry is replaced.
+
+  Precondition:
+	The address is not in the cache.
+
+  Parameters:
+	IPAddr - The IP address to add
+
+  Returns:
+  	Index of the new entry.  The caller sets its state and times.
+  ***************************************************************************/
+static BYTE ARPCacheAdd(IP_ADDR* IPAddr)
+{
+	BYTE i, vOldest;
+	DWORD dwNow;
+
+	dwNow = TickGet();
+	vOldest = 0;
+	for(i = 0; i < ARP_CACHE_ENTRIES; i++)
+	{
+		if(Cache[i].vState == ARP_ENTRY_FREE)
+			break;
+		if(dwNow - Cache[i].dwUsed > dwNow - Cache[vOldest].dwUsed)
+			vOldest = i;
+	}
+	if(i == ARP_CACHE_ENTRIES)
+	{
+		i = vOldest;
+		ARPCacheRemove(i);
+	}
+
+	Cache[i].node.IPAddr.Val = IPAddr->Val;
+	Cache[i].dwUsed = dwNow;
+	Cache[i].vNext = CacheHead[ARP_CACHE_BUCKET(IPAddr)];
+	CacheHead[ARP_CACHE_BUCKET(IPAddr)] = i;
+
+	return i;
+}
+
+/*****************************************************************************
+  Function:
+	static void ARPCacheRemove(BYTE i)
+
+  Description:
+	Removes an entry from its hash chain and frees it.
+
+  Precondition:
+	The entry is not free.
+
+  Parameters:
+	i - Index of the entry
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void ARPCacheRemove(BYTE i)
+{
+	BYTE *p;
+
+	for(p = &CacheHead[ARP_CACHE_BUCKET(&Cache[i].node.IPAddr)]; *p != ARP_CACHE_INVALID; p = &Cache[*p].vNext)
+	{
+		if(*p == i)
+		{
+			*p = Cache[i].vNext;
+			break;
+		}
+	}
+	Cache[i].vState = ARP_ENTRY_FREE;
+}
+
+/*****************************************************************************
+  Function:
+	static void ARPCacheUpdate(IP_ADDR* IPAddr, MAC_ADDR* MACAddr, BOOL bAdd)
+
+  Description:
+	Records the MAC address of a node.  The entry of the node is refreshed 
+	if it is in the cache.  Otherwise, an entry is added only if bAdd is 
+	set, so that ARP traffic between other nodes doesn't push out the 
+	nodes we talk to.
+
+  Precondition:
+	ARPInit() has been called.
+
+  Parameters:
+	IPAddr - The IP address of the node
+	MACAddr - The MAC address of the node
+	bAdd - TRUE to add the node if it is not in the cache
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void ARPCacheUpdate(IP_ADDR* IPAddr, MAC_ADDR* MACAddr, BOOL bAdd)
+{
+	BYTE i;
+
+	i = ARPCacheFind(IPAddr);
+	if(i == ARP_CACHE_INVALID)
+	{
+		if(!bAdd)
+			return;
+		i = ARPCacheAdd(IPAddr);
+	}
+
+	memcpy((void*)&Cache[i].node.MACAddr, (void*)MACAddr, sizeof(MAC_ADDR));
+	Cache[i].vState = ARP_ENTRY_RESOLVED;
+	Cache[i].dwUpdated = TickGet();
+}
+
+#endif
+
 /*****************************************************************************
   Function:
 	void SwapARPPacket(ARP_PACKET* p)
@@ -383,7 +383,7 @@ BOOL DNSIsResolved(IP_ADDR* HostIP)
 		case DNS_OPEN_SOCKET:
 			//MySocket = UDPOpen(0, &ResolvedInfo, DNS_PORT);
 			
-			MySocket = UDPOpenEx((DWORD)(PTR_BASE)&ResolvedInfo,UDP_OPEN_NODE_INFO,0, DNS_PORT);
+			MySocket = UDPOpenEx((DWORD_PTR_BASE)(PTR_BASE)&ResolvedInfo,UDP_OPEN_NODE_INFO,0, DNS_PORT);
 			if(MySocket == INVALID_UDP_SOCKET)
 				break;
 
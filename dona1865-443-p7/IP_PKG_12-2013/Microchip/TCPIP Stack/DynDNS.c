@@ -281,12 +281,12 @@ void DDNSTask(void)
 			// Connect a socket to the remote server
 			if(DDNSClient.ROMPointers.CheckIPServer)
 			{	
-				MySocket = TCPOpen((DWORD)(ROM_PTR_BASE)DDNSClient.CheckIPServer.szROM, TCP_OPEN_ROM_HOST,
+				MySocket = TCPOpen((DWORD_PTR_BASE)(ROM_PTR_BASE)DDNSClient.CheckIPServer.szROM, TCP_OPEN_ROM_HOST,
 					DDNSClient.CheckIPPort, TCP_PURPOSE_DEFAULT);
 			}
 			else
 			{
-				MySocket = TCPOpen((DWORD)(PTR_BASE)DDNSClient.CheckIPServer.szRAM, TCP_OPEN_RAM_HOST,
+				MySocket = TCPOpen((DWORD_PTR_BASE)(PTR_BASE)DDNSClient.CheckIPServer.szRAM, TCP_OPEN_RAM_HOST,
 					DDNSClient.CheckIPPort, TCP_PURPOSE_DEFAULT);						
 			}
 			
@@ -426,12 +426,12 @@ void DDNSTask(void)
 			// Connect a socket to the remote server
 			if(DDNSClient.ROMPointers.UpdateServer)
 			{
-				MySocket = TCPOpen((DWORD)(ROM_PTR_BASE)DDNSClient.UpdateServer.szROM, TCP_OPEN_ROM_HOST, 
+				MySocket = TCPOpen((DWORD_PTR_BASE)(ROM_PTR_BASE)DDNSClient.UpdateServer.szROM, TCP_OPEN_ROM_HOST, 
 					DDNSClient.UpdatePort, TCP_PURPOSE_DEFAULT);
 			}
 			else
 			{
-				MySocket = TCPOpen((DWORD)(PTR_BASE)DDNSClient.UpdateServer.szRAM, TCP_OPEN_RAM_HOST,
+				MySocket = TCPOpen((DWORD_PTR_BASE)(PTR_BASE)DDNSClient.UpdateServer.szRAM, TCP_OPEN_RAM_HOST,
 					DDNSClient.UpdatePort, TCP_PURPOSE_DEFAULT);
 			}
 	
@@ -0,0 +1,1238 @@
+/*********************************************************************
+ *
+ *     MAC Module (Linux TAP and pcap replay) for Microchip TCP/IP Stack
+ *
+ *********************************************************************
+ * FileName:        ETHHost.c
+ * Dependencies:    see the include section below
+ *
+ * Processor:       Linux host
+ *
+ * Compiler:        GCC
+ *
+ * Runs the stack in a host process.  The buffer model is the one of the
+ * PIC32 internal MAC driver (ETHPIC32IntMac.c): the TX, RX, HTTP and SSL
+ * buffers are in process memory and the read and write pointers are
+ * plain pointers, so MACGetArray() and MACPutArray() are memcpy() calls.
+ * Only the frame I/O differs.  See ETHHost.h for the backend selection.
+ *
+********************************************************************/
+#include <string.h>
+
+
+#include "TCPIP Stack/TCPIP.h"
+#include "TCPIP Stack/MAC.h"
+
+
+// Compile only for the GCC host build
+#if defined(COMPILER_HOST_GCC)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+
+/** D E F I N I T I O N S ****************************************************/
+
+
+#define ETHER_IP    (0x00u)
+#define ETHER_ARP   (0x06u)
+
+#define PCAP_MAGIC			0xA1B2C3D4u		// microsecond time stamps
+#define PCAP_MAGIC_NSEC		0xA1B23C4Du		// nanosecond time stamps
+#define PCAP_LINKTYPE_ETH	1u
+
+typedef struct
+{
+	DWORD	magic;
+	WORD	versionMajor;
+	WORD	versionMinor;
+	LONG	thisZone;
+	DWORD	sigFigs;
+	DWORD	snapLen;
+	DWORD	linkType;
+}sPcapFileHdr;	// pcap file header
+
+typedef struct
+{
+	DWORD	tsSec;
+	DWORD	tsUsec;
+	DWORD	inclLen;
+	DWORD	origLen;
+}sPcapRecHdr;	// pcap record header
+
+/******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+static int		_TapOpen(const char* name);
+static FILE*	_PcapOpenIn(const char* name);
+static FILE*	_PcapOpenOut(const char* name);
+static int		_PcapRead(unsigned char* pBuff, int buffSize);
+static void		_PcapWrite(const unsigned char* pFrame, int len);
+static DWORD	_PcapSwap(DWORD v);
+static void		_RxFill(void);
+static int		_RxReadyCount(void);
+static unsigned long long	_NowUs(void);
+
+
+// TX buffer
+static unsigned int			_TxBuffer[(MAC_TX_BUFFER_SIZE+sizeof(ETHER_HEADER)+sizeof(int)-1)/sizeof(int)];
+static unsigned short int	_TxCurrSize=0;						// the current TX frame size
+
+
+// RX buffers: a queue of frames read from the backend, each handed to the
+// stack when its RX delay has elapsed
+static unsigned int			_RxBuffers[HOST_RX_FRAMES][(HOST_RX_BUFF_SIZE+sizeof(int)-1)/sizeof(int)];
+static unsigned short int	_RxLens[HOST_RX_FRAMES];			// frame sizes
+static unsigned long long	_RxDue[HOST_RX_FRAMES];				// time each frame is due, in us
+static int					_RxFirst=0;							// oldest queued frame
+static int					_RxCount=0;							// queued frames, including the current one
+static DWORD				_RxDelay=0;							// RX delay in us
+static unsigned char*		_pRxCurrBuff=0;						// the current RX frame
+static unsigned short int	_RxCurrSize=0;						// the current RX frame size
+
+
+// HTTP +SSL buffers
+static unsigned char		_HttpSSlBuffer[RESERVED_HTTP_MEMORY+RESERVED_SSL_MEMORY];
+
+
+// general stuff
+static unsigned char*		_CurrWrPtr=0;						// the current write pointer
+static unsigned char*		_CurrRdPtr=0;						// the current read pointer
+
+
+// backends
+static int					_tapFd=-1;							// TAP file descriptor, -1 when replaying
+static FILE*				_pcapIn=0;							// replayed capture
+static int					_pcapInSwap=0;						// capture has the other byte order
+static FILE*				_pcapOut=0;							// output capture
+static int					_linkUp=0;
+
+// run time statistics
+/*static*/ int			_stackMgrRxOkPkts=0;
+/*static*/ int			_stackMgrRxBadPkts=0;
+/*static*/ int			_stackMgrInGetHdr=0;
+/*static*/ int			_stackMgrRxDiscarded=0;
+/*static*/ int			_stackMgrTxNotReady=0;
+/*static*/ int			_stackMgrTxPkts=0;
+/*static*/ int			_stackMgrTxArpPkts=0;				// ARP requests and responses sent
+
+
+/*
+ * interface functions
+ *
+*/
+
+
+/****************************************************************************
+ * Function:        MACInit
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Opens the TAP interface or the replayed capture and the
+ *                  output capture, if any.
+ *
+ * Overview:        This function selects and opens the backend given by the
+ *                  HOST_MAC_TAP, HOST_MAC_PCAP_IN and HOST_MAC_PCAP_OUT
+ *                  environment variables, and sets the RX delay from
+ *                  HOST_MAC_RX_DELAY_US.
+ *
+ * Note:            The link stays down if the backend cannot be opened.
+ *                  The reason is printed to stderr.
+ *****************************************************************************/
+void MACInit(void)
+{
+	const char*	name;
+
+	_stackMgrRxBadPkts=_stackMgrRxOkPkts=_stackMgrInGetHdr=_stackMgrRxDiscarded=0;
+	_stackMgrTxNotReady=_stackMgrTxPkts=_stackMgrTxArpPkts=0;
+	_CurrWrPtr=_CurrRdPtr=0;
+	_TxCurrSize=0;
+	_pRxCurrBuff=0; _RxCurrSize=0;
+	_RxFirst=_RxCount=0;
+
+	if(_tapFd>=0)
+	{
+		close(_tapFd);
+		_tapFd=-1;
+	}
+	if(_pcapIn)
+	{
+		fclose(_pcapIn);
+		_pcapIn=0;
+	}
+	if(_pcapOut)
+	{
+		fclose(_pcapOut);
+		_pcapOut=0;
+	}
+
+	name=getenv("HOST_MAC_PCAP_IN");
+	if(name && *name)
+	{
+		_pcapIn=_PcapOpenIn(name);
+		_linkUp=_pcapIn!=0;
+	}
+	else
+	{
+		name=getenv("HOST_MAC_TAP");
+		_tapFd=_TapOpen((name && *name)?name:HOST_TAP_NAME);
+		_linkUp=_tapFd>=0;
+	}
+
+	name=getenv("HOST_MAC_PCAP_OUT");
+	if(name && *name)
+	{
+		_pcapOut=_PcapOpenOut(name);
+	}
+
+	name=getenv("HOST_MAC_RX_DELAY_US");
+	_RxDelay=(name && *name)?strtoul(name, 0, 10):0;
+}
+
+
+/****************************************************************************
+ * Function:        void MACHostSetRxDelay(DWORD dwDelay)
+ *
+ * PreCondition:    None
+ *
+ * Input:           dwDelay - RX delay in us
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sets the time each received frame waits before it is
+ *                  handed to the stack, which adds to the round trip time
+ *                  of every connection.
+ *
+ * Note:            Frames already queued keep their due time.
+ *****************************************************************************/
+void MACHostSetRxDelay(DWORD dwDelay)
+{
+	_RxDelay=dwDelay;
+}
+
+
+/****************************************************************************
+ * Function:        MACIsLinked
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          TRUE if link is up
+ *                  FALSE otherwise
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The link is up while the backend is open.  A replayed
+ *                  capture goes down when all its frames have been read.
+ *
+ * Note:            None
+ *****************************************************************************/
+BOOL MACIsLinked(void)
+{
+	return _linkUp!=0;
+}
+
+
+/****************************************************************************
+ * Function:        MACGetTxBaseAddr
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          TX buffer base address
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function returns the address of the TX buffer.
+ *
+ * Note:            There is a single TX buffer.  It is always available
+ *                  since MACFlush() writes the frame synchronously.
+ *****************************************************************************/
+PTR_BASE MACGetTxBaseAddr(void)
+{
+	return (PTR_BASE)_TxBuffer;
+}
+
+/****************************************************************************
+ * Function:        MACGetHttpBaseAddr
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          HTTP buffer base address
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function returns the address of the HTTP buffer.
+ *
+ * Note:            The HTTP buffer is a static one, always available.
+ *****************************************************************************/
+PTR_BASE MACGetHttpBaseAddr(void)
+{
+	return (PTR_BASE)_HttpSSlBuffer;
+}
+
+/****************************************************************************
+ * Function:        MACGetSslBaseAddr
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          SSL buffer base address
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function returns the address of the SSL buffer.
+ *
+ * Note:            The SSL buffer is a static one, always available.
+ *****************************************************************************/
+PTR_BASE MACGetSslBaseAddr(void)
+{
+	return (PTR_BASE)(_HttpSSlBuffer+RESERVED_HTTP_MEMORY);
+}
+
+
+/**************************
+ * TX functions
+ ***********************************************/
+
+/****************************************************************************
+ * Function:        MACSetWritePtr
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          old write pointer
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function sets the new write pointer.
+ *
+ * Note:            None
+ *****************************************************************************/
+PTR_BASE MACSetWritePtr(PTR_BASE address)
+{
+	unsigned char* oldPtr;
+
+	oldPtr=_CurrWrPtr;
+	_CurrWrPtr=(unsigned char*)address;
+	return (PTR_BASE)oldPtr;
+}
+
+
+/******************************************************************************
+ * Function:        BOOL MACIsTxReady(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          TRUE: If data can be inserted in the TX buffer
+ *                  FALSE: the link is down
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The TX buffer is free as soon as MACFlush() returns, so
+ *                  this only reports the link state.
+ *
+ * Note:            None
+ *****************************************************************************/
+BOOL MACIsTxReady(void)
+{
+	if(!_linkUp)
+	{
+		_stackMgrTxNotReady++;
+	}
+
+	return _linkUp!=0;
+}
+
+/******************************************************************************
+ * Function:        void MACPut(BYTE val)
+ *
+ * PreCondition:    None
+ *
+ * Input:           byte to be written
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:       Writes a byte to the current write location and increments the write pointer.
+ *
+ * Note:            None
+ *****************************************************************************/
+void MACPut(BYTE val)
+{
+	*_CurrWrPtr++=val;
+}
+
+/******************************************************************************
+ * Function:        void MACPutArray(BYTE* buff, WORD len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           buff - buffer to be written
+ *                  len - buffer length
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes a buffer to the current write location and updates the write pointer.
+ *
+ * Note:            None
+ *****************************************************************************/
+void MACPutArray(BYTE *buff, WORD len)
+{
+	memcpy(_CurrWrPtr, buff, len);
+	_CurrWrPtr+=len;
+}
+
+
+/******************************************************************************
+ * Function:        void MACPutHeader(MAC_ADDR *remote, BYTE type, WORD dataLen)
+ *
+ * PreCondition:    None
+ *
+ * Input:           remote - Pointer to memory which contains the destination MAC address (6 bytes)
+ *                  type - packet type: MAC_IP or ARP
+ *                  dataLen - ethernet frame payload
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:       Sets the write pointer at the beginning of the TX buffer
+ *                 and sets the ETH header and the frame length. Updates the write pointer
+ *
+ * Note:            None
+ *****************************************************************************/
+void MACPutHeader(MAC_ADDR *remote, BYTE type, WORD dataLen)
+{
+	_TxCurrSize=dataLen+sizeof(ETHER_HEADER);
+	_CurrWrPtr=(unsigned char*)_TxBuffer;		// point at the beg of the buffer
+
+	memcpy(_CurrWrPtr, remote, sizeof(*remote));
+	_CurrWrPtr+=sizeof(*remote);
+	memcpy(_CurrWrPtr, &AppConfig.MyMACAddr, sizeof(AppConfig.MyMACAddr));
+	_CurrWrPtr+=sizeof(AppConfig.MyMACAddr);
+
+	*_CurrWrPtr++=0x08;
+	*_CurrWrPtr++=(type == MAC_IP) ? ETHER_IP : ETHER_ARP;
+	if(type != MAC_IP)
+	{
+		_stackMgrTxArpPkts++;
+	}
+}
+
+
+/******************************************************************************
+ * Function:        void MACFlush(void)
+ *
+ * PreCondition:    MACPutHeader() has been called and the frame written.
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    The frame is added to the output capture, if any.
+ *
+ * Overview:        Writes the frame in the TX buffer to the TAP interface.
+ *                  When replaying a capture the frame only goes to the
+ *                  output capture.
+ *
+ * Note:            A frame the TAP cannot take is dropped, as a real MAC
+ *                  would drop it on a collision; TCP retransmits.
+ *****************************************************************************/
+void MACFlush(void)
+{
+	if(_TxCurrSize)
+	{	// there is a frame to transmit
+		if(_tapFd>=0)
+		{
+			if(write(_tapFd, _TxBuffer, _TxCurrSize)!=_TxCurrSize)
+			{
+				_stackMgrTxNotReady++;
+			}
+		}
+		_PcapWrite((unsigned char*)_TxBuffer, _TxCurrSize);
+		_stackMgrTxPkts++;
+		_TxCurrSize=0;
+	}
+}
+
+/******************************************************************************
+ * Function:        void MACFlushFragments(TX_FRAGMENT* pFragments, BYTE vCount)
+ *
+ * PreCondition:    MACPutHeader() has been called with a length that
+ *                  includes the fragments, and the headers written.
+ *
+ * Input:           pFragments - data that follows the TX buffer contents
+ *                  vCount - number of fragments, up to
+ *                           MAC_TX_GATHER_FRAGMENTS
+ *
+ * Output:          None
+ *
+ * Side Effects:    The frame is added to the output capture, if any.
+ *
+ * Overview:        Writes the start of the frame from the TX buffer and
+ *                  the fragments from where they are to the TAP interface
+ *                  with one writev() call.
+ *
+ * Note:            The fragments are copied after the headers only when
+ *                  there is an output capture to write.
+ *****************************************************************************/
+void MACFlushFragments(TX_FRAGMENT* pFragments, BYTE vCount)
+{
+	struct iovec	iov[1+MAC_TX_GATHER_FRAGMENTS];
+	unsigned char*	pDst;
+	int				i, fragSize;
+
+	fragSize=0;
+	for(i=0; i<vCount; i++)
+	{
+		iov[i+1].iov_base=(void*)pFragments[i].data.pRAM;
+		iov[i+1].iov_len=pFragments[i].wLength;
+		fragSize+=pFragments[i].wLength;
+	}
+	iov[0].iov_base=_TxBuffer;
+	iov[0].iov_len=_TxCurrSize-fragSize;
+
+	if(_tapFd>=0)
+	{
+		if(writev(_tapFd, iov, vCount+1)!=_TxCurrSize)
+		{
+			_stackMgrTxNotReady++;
+		}
+	}
+	if(_pcapOut)
+	{
+		pDst=(unsigned char*)_TxBuffer+iov[0].iov_len;
+		for(i=0; i<vCount; i++)
+		{
+			memcpy(pDst, iov[i+1].iov_base, iov[i+1].iov_len);
+			pDst+=iov[i+1].iov_len;
+		}
+		_PcapWrite((unsigned char*)_TxBuffer, _TxCurrSize);
+	}
+	_stackMgrTxPkts++;
+	_TxCurrSize=0;
+}
+
+/**************************
+ * RX functions
+ ***********************************************/
+
+
+/******************************************************************************
+ * Function:        void MACDiscardRx(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Marks the last received packet (obtained using
+ *                  MACGetHeader())as being processed and frees the buffer
+ *                  memory associated with it.  This removes it from the RX
+ *                  queue.
+ *
+ * Note:            Is is safe to call this function multiple times between
+ *                  MACGetHeader() calls.  Extra packets won't be thrown away
+ *                  until MACGetHeader() makes it available.
+ *****************************************************************************/
+void MACDiscardRx(void)
+{
+	if(_pRxCurrBuff)
+	{	// an already existing packet
+		_pRxCurrBuff=0;
+		_RxCurrSize=0;
+		_RxFirst=(_RxFirst+1)%HOST_RX_FRAMES;
+		_RxCount--;
+
+		_stackMgrRxDiscarded++;
+	}
+}
+
+
+
+/******************************************************************************
+ * Function:        BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
+ *
+ * PreCondition:    None
+ *
+ * Input:           *remote: Location to store the Source MAC address of the
+ *                           received frame.
+ *                  *type: Location of a BYTE to store the constant
+ *                         MAC_UNKNOWN, ETHER_IP, or ETHER_ARP, representing
+ *                         the contents of the Ethernet type field.
+ *
+ * Output:          TRUE: If a packet was waiting in the RX buffer.  The
+ *                        remote, and type values are updated.
+ *                  FALSE: If a packet was not pending.  remote and type are
+ *                         not changed.
+ *
+ * Side Effects:    Last packet is discarded if MACDiscardRx() hasn't already
+ *                  been called.
+ *
+ * Overview:        Queues the frames waiting in the TAP interface, or the
+ *                  next frame of the replayed capture, and returns the
+ *                  oldest queued frame once its RX delay has elapsed.
+ *
+ * Note:            Sets the read pointer at the beginning of the new packet
+ *****************************************************************************/
+BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
+{
+	WORD_VAL newType;
+
+	_stackMgrInGetHdr++;
+
+	MACDiscardRx();		// discard the old RX buffer, if any
+
+	_RxFill();
+	if(_RxCount==0 || _RxDue[_RxFirst]>_NowUs())
+	{	// nothing pending
+		return FALSE;
+	}
+
+	// valid packet
+	_RxCurrSize=_RxLens[_RxFirst];
+	_pRxCurrBuff=(unsigned char*)_RxBuffers[_RxFirst];
+	_PcapWrite(_pRxCurrBuff, _RxCurrSize);
+	_CurrRdPtr=_pRxCurrBuff+sizeof(ETHER_HEADER);	// skip the packet header
+	// set the packet type
+	memcpy(remote, &((ETHER_HEADER*)_pRxCurrBuff)->SourceMACAddr, sizeof(*remote));
+	*type=MAC_UNKNOWN;
+	newType=((ETHER_HEADER*)_pRxCurrBuff)->Type;
+	if( newType.v[0]==0x08 && (newType.v[1]==ETHER_IP || newType.v[1]==ETHER_ARP) )
+	{
+		*type=newType.v[1];
+	}
+
+	_stackMgrRxOkPkts++;
+
+	return TRUE;
+}
+
+
+
+/******************************************************************************
+ * Function:        void MACSetReadPtrInRx(WORD offset)
+ *
+ * PreCondition:    A packet has been obtained by calling MACGetHeader() and
+ *                  getting a TRUE result.
+ *
+ * Input:           offset: WORD specifying how many bytes beyond the Ethernet
+ *                          header's type field to relocate the read pointer.
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The current read pointer is updated.  All calls to
+ *                  MACGet() and MACGetArray() will use these new values.
+ *
+ * Note:
+ ******************************************************************************/
+void MACSetReadPtrInRx(WORD offset)
+{
+	_CurrRdPtr=_pRxCurrBuff+sizeof(ETHER_HEADER)+offset;
+}
+
+
+/****************************************************************************
+ * Function:        MACSetReadPtr
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          old read pointer
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function sets the new read pointer value.
+ *
+ * Note:            None
+ *****************************************************************************/
+PTR_BASE MACSetReadPtr(PTR_BASE address)
+{
+	unsigned char* oldPtr;
+
+	oldPtr=_CurrRdPtr;
+	_CurrRdPtr=(unsigned char*)address;
+	return (PTR_BASE)oldPtr;
+}
+
+
+/******************************************************************************
+ * Function:        BYTE MACGet()
+ *
+ * PreCondition:    A valid packet should have been obtained or the read pointer properly set.
+ *
+ * Input:           None
+ *
+ * Output:          Byte read from the current read pointer location
+ *
+ * Side Effects:    None
+ *
+ * Overview:        MACGet returns the byte pointed to by the current read pointer location and
+ *                  increments the read pointer.
+ *
+ * Note:            None
+ *****************************************************************************/
+BYTE MACGet(void)
+{
+	return *_CurrRdPtr++;
+}
+
+
+/******************************************************************************
+ * Function:        WORD MACGetArray(BYTE *address, WORD len)
+ *
+ * PreCondition:    A valid packet should have been obtained or the read pointer properly set.
+ *
+ * Input:           address: Pointer to storage location, NULL to skip
+ *                  len:  Number of bytes to read from the data buffer.
+ *
+ * Output:          number of bytes copied to the data buffer.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies data in the supplied buffer.
+ *
+ * Note:            The read pointer is updated
+ *****************************************************************************/
+WORD MACGetArray(BYTE *address, WORD len)
+{
+	if(address)
+	{
+		memcpy(address, _CurrRdPtr, len);
+	}
+
+	_CurrRdPtr+=len;
+	return len;
+}
+
+/******************************************************************************
+ * Function:        WORD MACGetFreeRxSize(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          An estimate of how much RX buffer space is free at the present time.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        As with the PIC32 MAC, the free RX buffers times the
+ *                  buffer size.  Frames still waiting for their RX delay
+ *                  are on the wire and do not use a buffer.
+ *
+ * Note:            None
+ *****************************************************************************/
+WORD MACGetFreeRxSize(void)
+{
+	DWORD	freeSize=(DWORD)(HOST_RX_FRAMES-_RxReadyCount())*HOST_RX_BUFF_SIZE;
+
+	return freeSize>0xFFFFu?0xFFFFu:(WORD)freeSize;
+}
+
+
+/******************************************************************************
+ * Function:        void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+ *
+ * PreCondition:    Read and write pointers properly set if using the current ponter values
+ *
+ * Input:           destAddr - Destination address in the memory to copy to.  If it equals -1,
+ *                     the current write pointer will be used.
+ *                  sourceAddr - Source address to read from.  If it equals -1,
+ *                     the current read pointer will be used.
+ *                  len - number of bytes to copy
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies data from one address to another within the Ethernet memory.
+ *                  Overlapped memory regions are allowed only if the destination start address
+ *                  is at a lower memory address than the source address.
+ *
+ * Note:            The current pointers are not updated, as with the PIC32 MAC.
+ *****************************************************************************/
+void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+{
+	if(len)
+	{
+		unsigned char	*pDst, *pSrc;
+
+		pDst=(destAddr==(PTR_BASE)-1)?_CurrWrPtr:(unsigned char*)destAddr;
+		pSrc=(sourceAddr==(PTR_BASE)-1)?_CurrRdPtr:(unsigned char*)sourceAddr;
+
+		memmove(pDst, pSrc, len);
+	}
+}
+
+/******************************************************************************
+ * Function:        void MACIsMemCopyDone(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          TRUE
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The copy is done by MACMemCopyAsync() itself.
+ *
+ * Note:            None
+ *****************************************************************************/
+BOOL MACIsMemCopyDone(void)
+{
+	return 1;
+}
+
+
+/******************************************************************************
+ * Function:        WORD CalcIPBufferChecksum(WORD len)
+ *
+ * PreCondition:    Read buffer pointer set to starting of checksum data
+ *
+ * Input:           len: Total number of bytes to calculate the checksum over.
+ *
+ * Output:          16-bit checksum as defined by RFC 793
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function performs a checksum calculation of the buffer
+ *                  pointed by the current value of the read pointer.
+ *
+ * Note:            None
+ *****************************************************************************/
+WORD CalcIPBufferChecksum(WORD len)
+{
+	return CalcIPChecksum(_CurrRdPtr, len);
+}
+
+
+/******************************************************************************
+ * Function:        WORD MACCalcRxChecksum(WORD offset, WORD len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           offset  - Number of bytes beyond the beginning of the
+ *                          Ethernet data (first byte after the type field)
+ *                          where the checksum should begin
+ *                  len     - Total number of bytes to include in the checksum
+ *
+ * Output:          16-bit checksum as defined by RFC 793.
+ *
+ * Side Effects:    None
+ *
+ * Overview:        This function performs a checksum calculation in the current receive buffer.
+ *
+ * Note:            None
+ *****************************************************************************/
+WORD MACCalcRxChecksum(WORD offset, WORD len)
+{
+	return CalcIPChecksum(_pRxCurrBuff+sizeof(ETHER_HEADER)+offset, len);
+}
+
+/******************************************************************************
+ * Function:        void SetRXHashTableEntry(MAC_ADDR DestMACAddr)
+ *
+ * PreCondition:    MACInit() should have been called.
+ *
+ * Input:           DestMACAddr: 6 byte group destination MAC address
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The TAP interface passes all multicast frames, so there
+ *                  is no filter to program.
+ *
+ * Note:            None
+ *****************************************************************************/
+void SetRXHashTableEntry(MAC_ADDR DestMACAddr)
+{
+}
+
+
+
+/**************************
+ * local functions and helpers
+ ***********************************************/
+
+/*********************************************************************
+* Function:        int _TapOpen(const char* name)
+ *
+ * PreCondition:    None
+ *
+ * Input:           name - TAP interface name
+ *
+ * Output:          file descriptor, -1 on failure
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Attaches to the TAP interface without packet information
+ *                  headers, so reads and writes are plain Ethernet frames,
+ *                  and makes reads non-blocking for MACGetHeader().
+ *
+ * Note:            None
+ ********************************************************************/
+static int _TapOpen(const char* name)
+{
+	struct ifreq	ifr;
+	int				fd;
+
+	fd=open("/dev/net/tun", O_RDWR);
+	if(fd<0)
+	{
+		perror("ETHHost: /dev/net/tun");
+		return -1;
+	}
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags=IFF_TAP|IFF_NO_PI;
+	strncpy(ifr.ifr_name, name, IFNAMSIZ-1);
+	if(ioctl(fd, TUNSETIFF, &ifr)<0 || fcntl(fd, F_SETFL, O_NONBLOCK)<0)
+	{
+		fprintf(stderr, "ETHHost: %s: %s\n", name, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*********************************************************************
+* Function:        FILE* _PcapOpenIn(const char* name)
+ *
+ * PreCondition:    None
+ *
+ * Input:           name - capture file name
+ *
+ * Output:          opened file positioned at the first record, 0 on failure
+ *
+ * Side Effects:    Sets _pcapInSwap for captures of the other byte order.
+ *
+ * Overview:        Opens a pcap capture with Ethernet link type for replay.
+ *
+ * Note:            None
+ ********************************************************************/
+static FILE* _PcapOpenIn(const char* name)
+{
+	sPcapFileHdr	hdr;
+	FILE*			f;
+
+	f=fopen(name, "rb");
+	if(f==0)
+	{
+		perror(name);
+		return 0;
+	}
+
+	_pcapInSwap=0;
+	if(fread(&hdr, sizeof(hdr), 1, f)==1)
+	{
+		if(hdr.magic==_PcapSwap(PCAP_MAGIC) || hdr.magic==_PcapSwap(PCAP_MAGIC_NSEC))
+		{
+			_pcapInSwap=1;
+			hdr.magic=_PcapSwap(hdr.magic);
+			hdr.linkType=_PcapSwap(hdr.linkType);
+		}
+		if((hdr.magic==PCAP_MAGIC || hdr.magic==PCAP_MAGIC_NSEC) && hdr.linkType==PCAP_LINKTYPE_ETH)
+		{
+			return f;
+		}
+	}
+
+	fprintf(stderr, "%s: not an Ethernet pcap file\n", name);
+	fclose(f);
+	return 0;
+}
+
+/*********************************************************************
+* Function:        FILE* _PcapOpenOut(const char* name)
+ *
+ * PreCondition:    None
+ *
+ * Input:           name - capture file name
+ *
+ * Output:          opened file, 0 on failure
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Creates a pcap capture with Ethernet link type.
+ *
+ * Note:            None
+ ********************************************************************/
+static FILE* _PcapOpenOut(const char* name)
+{
+	sPcapFileHdr	hdr;
+	FILE*			f;
+
+	f=fopen(name, "wb");
+	if(f==0)
+	{
+		perror(name);
+		return 0;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic=PCAP_MAGIC;
+	hdr.versionMajor=2;
+	hdr.versionMinor=4;
+	hdr.snapLen=65535;
+	hdr.linkType=PCAP_LINKTYPE_ETH;
+	fwrite(&hdr, sizeof(hdr), 1, f);
+
+	return f;
+}
+
+/*********************************************************************
+* Function:        int _PcapRead(unsigned char* pBuff, int buffSize)
+ *
+ * PreCondition:    _pcapIn is open
+ *
+ * Input:           pBuff    - frame buffer
+ *                  buffSize - size of pBuff
+ *
+ * Output:          frame length, buffSize for a frame that did not fit,
+ *                  0 at the end of the capture
+ *
+ * Side Effects:    Takes the link down at the end of the capture.
+ *
+ * Overview:        Reads the next record of the replayed capture.
+ *
+ * Note:            None
+ ********************************************************************/
+static int _PcapRead(unsigned char* pBuff, int buffSize)
+{
+	sPcapRecHdr		rec;
+	DWORD			len;
+
+	if(fread(&rec, sizeof(rec), 1, _pcapIn)!=1)
+	{
+		_linkUp=0;
+		return 0;
+	}
+
+	len=_pcapInSwap?_PcapSwap(rec.inclLen):rec.inclLen;
+	if(len>buffSize)
+	{	// skip what does not fit, the caller drops the frame
+		if(fread(pBuff, buffSize, 1, _pcapIn)!=1 || fseek(_pcapIn, len-buffSize, SEEK_CUR)!=0)
+		{
+			_linkUp=0;
+			return 0;
+		}
+		return buffSize;
+	}
+
+	if(len && fread(pBuff, len, 1, _pcapIn)!=1)
+	{
+		_linkUp=0;
+		return 0;
+	}
+
+	return len;
+}
+
+/*********************************************************************
+* Function:        void _PcapWrite(const unsigned char* pFrame, int len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           pFrame - Ethernet frame
+ *                  len    - frame length
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Appends the frame to the output capture, if any, time
+ *                  stamped with the current time.
+ *
+ * Note:            None
+ ********************************************************************/
+static void _PcapWrite(const unsigned char* pFrame, int len)
+{
+	sPcapRecHdr		rec;
+	struct timeval	tv;
+
+	if(_pcapOut==0)
+	{
+		return;
+	}
+
+	gettimeofday(&tv, 0);
+	rec.tsSec=tv.tv_sec;
+	rec.tsUsec=tv.tv_usec;
+	rec.inclLen=rec.origLen=len;
+	fwrite(&rec, sizeof(rec), 1, _pcapOut);
+	fwrite(pFrame, len, 1, _pcapOut);
+	fflush(_pcapOut);
+}
+
+/*********************************************************************
+* Function:        void _RxFill(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Frames that are too short or too long are counted in
+ *                  _stackMgrRxBadPkts and discarded.
+ *
+ * Overview:        Moves the frames waiting in the TAP interface to the RX
+ *                  queue, due after the RX delay.  When replaying, the next
+ *                  frame is read only once the queue is empty.
+ *
+ * Note:            Frames stay in the kernel while the queue is full.
+ ********************************************************************/
+static void _RxFill(void)
+{
+	unsigned char*	pBuff;
+	int				len;
+
+	while(_RxCount<HOST_RX_FRAMES)
+	{
+		pBuff=(unsigned char*)_RxBuffers[(_RxFirst+_RxCount)%HOST_RX_FRAMES];
+		if(_tapFd>=0)
+		{
+			len=read(_tapFd, pBuff, sizeof(_RxBuffers[0]));
+		}
+		else if(_pcapIn && _RxCount==0)
+		{
+			len=_PcapRead(pBuff, sizeof(_RxBuffers[0]));
+		}
+		else
+		{
+			len=-1;
+		}
+
+		if(len<=0)
+		{	// nothing pending
+			return;
+		}
+
+		if(len<sizeof(ETHER_HEADER) || len>=sizeof(_RxBuffers[0]))
+		{	// runt or truncated frame, discard
+			_PcapWrite(pBuff, len);
+			_stackMgrRxBadPkts++;
+			continue;
+		}
+
+		_RxLens[(_RxFirst+_RxCount)%HOST_RX_FRAMES]=len;
+		_RxDue[(_RxFirst+_RxCount)%HOST_RX_FRAMES]=_NowUs()+_RxDelay;
+		_RxCount++;
+	}
+}
+
+/*********************************************************************
+* Function:        int _RxReadyCount(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          number of queued frames whose RX delay has elapsed
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The queue is in arrival order, so the count stops at
+ *                  the first frame that is not due yet.
+ *
+ * Note:            None
+ ********************************************************************/
+static int _RxReadyCount(void)
+{
+	unsigned long long	now=_NowUs();
+	int					n;
+
+	for(n=0; n<_RxCount; n++)
+	{
+		if(_RxDue[(_RxFirst+n)%HOST_RX_FRAMES]>now)
+		{
+			break;
+		}
+	}
+
+	return n;
+}
+
+/*********************************************************************
+* Function:        unsigned long long _NowUs(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          current time in us
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads the monotonic clock.
+ *
+ * Note:            None
+ ********************************************************************/
+static unsigned long long _NowUs(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec*1000000u+ts.tv_nsec/1000u;
+}
+
+/*********************************************************************
+* Function:        DWORD _PcapSwap(DWORD v)
+ *
+ * PreCondition:    None
+ *
+ * Input:           v - 32 bit value
+ *
+ * Output:          v with its bytes reversed
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Converts header fields of a capture written on a host
+ *                  of the other byte order.
+ *
+ * Note:            None
+ ********************************************************************/
+static DWORD _PcapSwap(DWORD v)
+{
+	return (v>>24) | ((v>>8)&0xFF00u) | ((v<<8)&0xFF0000u) | (v<<24);
+}
+
+
+
+#endif	// defined(COMPILER_HOST_GCC)
+
@@ -52,6 +52,18 @@
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  * Nilesh Rajbharti     8/14/01     Original
  * Elliott Wood			6/4/07		Complete rewrite, known as HTTP2
+ *                      10/18/26    Files copied straight to the TX FIFO
+ *                      10/18/26    Variables skipped with one seek
+ *                      10/18/26    Persistent connections and
+ *									pipelining (HTTP_USE_KEEPALIVE)
+ *                      10/18/26    Header names found by a perfect
+ *									hash instead of a table scan, and
+ *									header lines longer than the RX
+ *									FIFO skipped
+ *                      10/18/26    MPFS2.2 images accepted for upload
+ *                      10/18/26    GZIP files decompressed for clients
+ *									without "Accept-Encoding: gzip"
+ *									(HTTP_USE_INFLATE)
  ********************************************************************/
 
 #define __HTTP2_C
@@ -68,6 +80,21 @@
   ***************************************************************************/
 	static ROM BYTE HTTP_CRLF[] = "\r\n";	// New line sequence
 	#define HTTP_CRLF_LEN	2				// Length of above string
+
+	#if defined(HTTP_USE_KEEPALIVE)
+	// Status line of responses on a persistent connection
+	static ROM BYTE HTTP_KEEPALIVE_OK[] = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n";
+
+	// Chunked encoding states (curHTTP.isChunked)
+	#define HTTP_CHUNK_NONE		(0u)	// Response is not chunked
+	#define HTTP_CHUNK_FIRST	(1u)	// Response is chunked, no chunk written yet
+	#define HTTP_CHUNK_OPEN		(2u)	// Last chunk still needs its CRLF
+	#define HTTP_CHUNK_WRITING	(3u)	// A chunk is being written and the TX FIFO is held
+
+	#define HTTP_CHUNK_OVERHEAD	(15u)	// Largest chunk header plus the last-chunk marker
+	#define HTTP_HEADER_SPACE	(300u)	// TX space needed to start a pipelined response
+	#define HTTP_KEEPALIVE_RX	(256u)	// RX FIFO kept for pipelined requests during a response
+	#endif
 		
 /****************************************************************************
   Section:
@@ -147,11 +174,61 @@
 	{
 		"Cookie:",
 		"Authorization:",
-		"Content-Length:"
+		"Content-Length:",
+		"Connection:",
+		"Accept-Encoding:"
 	};
 	
 	// Set to length of longest string above
-	#define HTTP_MAX_HEADER_LEN		(15u)
+	#define HTTP_MAX_HEADER_LEN		(16u)
+
+	// Header names are found with a perfect hash of the name without its 
+	// colon, computed as the name is read.  Each character is folded to
+	// lower case, so that names match in any case:
+	//    hash = hash*31 + (c | 0x20)
+	// The low bits of the hash select a slot holding the index of the 
+	// only string above that can match, or HTTP_HEADER_NONE.  When 
+	// adding a header, check that its slot is free.
+	#define HTTP_HEADER_SLOTS		(8u)
+	#define HTTP_HEADER_NONE		(0xffu)
+	static ROM BYTE HTTPRequestHeaderSlots[HTTP_HEADER_SLOTS] =
+	{
+		4,					// 0: Accept-Encoding
+		1,					// 1: Authorization
+		2,					// 2: Content-Length
+		HTTP_HEADER_NONE,	// 3
+		0,					// 4: Cookie
+		HTTP_HEADER_NONE,	// 5
+		3,					// 6: Connection
+		HTTP_HEADER_NONE	// 7
+	};
+
+#if defined(HTTP_USE_INFLATE)
+/****************************************************************************
+  Section:
+	Decompression Globals
+  ***************************************************************************/
+	
+	// GZIP files are decompressed for one response at a time, in a window
+	// shared by all connections.  A response that finds the window used by
+	// another restarts at the block holding its next byte.
+	#define HTTP_INFLATE_NONE		(0xffu)
+	static INFLATE_CTX httpInflate;						// Decompression state
+	static BYTE httpInflateWindow[HTTP_INFLATE_WINDOW];	// Latest decompressed bytes
+	static BYTE httpInflateOwner;						// Connection httpInflate belongs to, or HTTP_INFLATE_NONE
+#endif
+
+#if defined(HTTP_USE_KEEPALIVE)
+/****************************************************************************
+  Section:
+	Chunked Encoding Globals
+  ***************************************************************************/
+
+	// Output of one HTTPProcess() pass goes into a single chunk, which is 
+	// only written by the connection being processed.
+	static WORD httpChunkFree;		// TX FIFO space left after the header of the chunk being written
+	static BYTE httpChunkHeaderLen;	// Bytes written by HTTPOpenChunk(), including the previous CRLF
+#endif
 
 /****************************************************************************
   Section:
@@ -177,6 +254,7 @@
   Section:
 	Function Prototypes
   ***************************************************************************/
+	static BYTE HTTPHeaderFind(WORD wLineLen, BYTE* pNameLen);
 	static void HTTPHeaderParseLookup(BYTE i);
 	#if defined(HTTP_USE_COOKIES)
 	static void HTTPHeaderParseCookie(void);
@@ -188,6 +266,16 @@
 	static void HTTPHeaderParseContentLength(void);
 	static HTTP_READ_STATUS HTTPReadTo(BYTE delim, BYTE* buf, WORD len);
 	#endif
+	#if defined(HTTP_USE_KEEPALIVE)
+	static void HTTPHeaderParseConnection(void);
+	static void HTTPOpenChunk(void);
+	static void HTTPCloseChunk(void);
+	#endif
+	#if defined(HTTP_USE_INFLATE)
+	static void HTTPHeaderParseAcceptEncoding(void);
+	static BOOL HTTPCanInflate(DWORD* pdwLen);
+	static BOOL HTTPSendInflated(void);
+	#endif
 	
 	static void HTTPProcess(void);
 	static BOOL HTTPSendFile(void);
@@ -247,6 +335,10 @@ void HTTPInit(void)
 		#endif
     }
 
+	#if defined(HTTP_USE_INFLATE)
+	httpInflateOwner = HTTP_INFLATE_NONE;
+	#endif
+
 	// Set curHTTPID to zero so that first call to HTTPLoadConn() doesn't write 
 	// dummy data outside reserved HTTP memory.
     curHTTPID = 0;	
@@ -296,6 +388,9 @@ void HTTPServer(void)
 		{
 			HTTPLoadConn(conn);
 			smHTTP = SM_HTTP_IDLE;
+			#if defined(HTTP_USE_KEEPALIVE)
+			curHTTP.keepAlive = FALSE;
+			#endif
 
 			// Make sure any opened files are closed
 			if(curHTTP.file != MPFS_INVALID_HANDLE)
@@ -392,6 +487,9 @@ static void HTTPProcess(void)
     BOOL isDone;
 	BYTE *ext;
 	BYTE buffer[HTTP_MAX_HEADER_LEN+1];
+	#if defined(HTTP_USE_INFLATE)
+	DWORD dwLen;
+	#endif
 
     do
     {
@@ -400,6 +498,24 @@ static void HTTPProcess(void)
         switch(smHTTP)
         {
 
+		#if defined(HTTP_USE_KEEPALIVE)
+		case SM_HTTP_WAIT_REQUEST:
+
+			// Close the connection if the client goes quiet or closes its side
+			if(TCPIsGetReady(sktHTTP) == 0u)
+			{
+				if(!TCPIsConnected(sktHTTP) || (LONG)(TickGet() - curHTTP.callbackID) > (LONG)0)
+				{
+					smHTTP = SM_HTTP_DISCONNECT;
+					isDone = FALSE;
+				}
+				break;
+			}
+
+			// The next request has arrived, possibly pipelined behind the last one
+			smHTTP = SM_HTTP_IDLE;
+		#endif
+
         case SM_HTTP_IDLE:
 
 			// Check how much data is waiting
@@ -415,13 +531,26 @@ static void HTTPProcess(void)
 				curHTTP.callbackID = TickGet() + HTTP_TIMEOUT*TICK_SECOND;
 				curHTTP.callbackPos = 0xffffffff;
 				curHTTP.byteCount = 0;
+				curHTTP.skipLine = FALSE;
 				#if defined(HTTP_USE_POST)
 				curHTTP.smPost = 0x00;
 				#endif
+				#if defined(HTTP_USE_INFLATE)
+				curHTTP.acceptGzip = FALSE;
+				curHTTP.isInflated = FALSE;
+				#endif
 				
 				// Adjust the TCP FIFOs for optimal reception of 
 				// the next HTTP request from the browser
+				#if defined(HTTP_USE_KEEPALIVE)
+				// Persistent connections keep an even split, since the
+				// next request may arrive while a response is being sent.
+				// The TX FIFO may still hold the last response.
+				if(!curHTTP.keepAlive || TCPGetTxFIFOFull(sktHTTP) == 0u)
+					TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_PRESERVE_RX);
+				#else
 				TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_PRESERVE_RX | TCP_ADJUST_GIVE_REST_TO_RX);
+				#endif
  			}
  			else
  				// Don't break for new connections.  There may be 
@@ -562,6 +691,7 @@ static void HTTPProcess(void)
 				(MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_HASINDEX) )
 			{
 				curHTTP.offsets = MPFSOpenID(MPFSGetID(curHTTP.file) + 1);
+				curHTTP.hasVarLen = (MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_HASVARLEN) != 0u;
 			}
 
 			// Read GET args, up to buffer size - 1
@@ -591,6 +721,12 @@ static void HTTPProcess(void)
 
 			// Clear the rest of the line
 			lenA = TCPFind(sktHTTP, '\n', 0, FALSE);
+			#if defined(HTTP_USE_KEEPALIVE)
+			// HTTP/1.1 connections persist and can take chunked responses.
+			// The Connection: header may override the first.
+			curHTTP.keepAlive = (TCPFindROMArrayEx(sktHTTP, (ROM BYTE*)"HTTP/1.1", 8, 0, lenA, FALSE) != 0xffffu);
+			curHTTP.isChunked = curHTTP.keepAlive ? HTTP_CHUNK_FIRST : HTTP_CHUNK_NONE;
+			#endif
 			TCPGetArray(sktHTTP, NULL, lenA + 1);
 
 			// Move to parsing the headers
@@ -608,10 +744,19 @@ static void HTTPProcess(void)
 				if(lenA == 0xffff)
 				{// If not, make sure we can receive more data
 					if(TCPGetRxFIFOFree(sktHTTP) == 0u)
-					{// Overflow
-						curHTTP.httpStatus = HTTP_OVERFLOW;
-						smHTTP = SM_HTTP_SERVE_HEADERS;
-						isDone = FALSE;
+					{
+						lenA = TCPIsGetReady(sktHTTP);
+						if(curHTTP.skipLine || HTTPHeaderFind(lenA, &i) == HTTP_HEADER_NONE)
+						{// A line we don't parse is skipped as it arrives
+							TCPGetArray(sktHTTP, NULL, lenA);
+							curHTTP.skipLine = TRUE;
+						}
+						else
+						{// Overflow
+							curHTTP.httpStatus = HTTP_OVERFLOW;
+							smHTTP = SM_HTTP_SERVE_HEADERS;
+							isDone = FALSE;
+						}
 					}
 					if((LONG)(TickGet() - curHTTP.callbackID) > (LONG)0)
 					{// A timeout has occured
@@ -624,6 +769,14 @@ static void HTTPProcess(void)
 				
 				// Reset the watchdog timer
 				curHTTP.callbackID = TickGet() + HTTP_TIMEOUT*TICK_SECOND;
+
+				// Remove the end of a skipped line
+				if(curHTTP.skipLine)
+				{
+					TCPGetArray(sktHTTP, NULL, lenA+1);
+					curHTTP.skipLine = FALSE;
+					continue;
+				}
 				
 				// If a CRLF is immediate, then headers are done
 				if(lenA == 1u)
@@ -634,31 +787,14 @@ static void HTTPProcess(void)
 					break;
 				}
 	
-				// Find the header name, and use isDone as a flag to indicate a match
-				lenB = TCPFindEx(sktHTTP, ':', 0, lenA, FALSE) + 2;
+				// Find the header, and use isDone as a flag to indicate a match
+				c = HTTPHeaderFind(lenA, &i);
 				isDone = FALSE;
-	
-				// If name is too long or this line isn't a header, ignore it
-				if(lenB > sizeof(buffer))
-				{
-					TCPGetArray(sktHTTP, NULL, lenA+1);
-					continue;
-				}
-				
-				// Read in the header name
-				TCPGetArray(sktHTTP, buffer, lenB);
-				buffer[lenB-1] = '\0';
-				lenA -= lenB;
-		
-				// Compare header read to ones we're interested in
-				for(i = 0; i < sizeof(HTTPRequestHeaders)/sizeof(HTTPRequestHeaders[0]); i++)
-				{
-					if(strcmppgm2ram((char*)buffer, (ROM char *)HTTPRequestHeaders[i]) == 0)
-					{// Parse the header and stop the loop
-						HTTPHeaderParseLookup(i);
-						isDone = TRUE;
-						break;
-					}
+				if(c != HTTP_HEADER_NONE)
+				{// Remove the name and parse the header
+					TCPGetArray(sktHTTP, NULL, i);
+					HTTPHeaderParseLookup(c);
+					isDone = TRUE;
 				}
 				
 				// Clear the rest of the line, and call the loop again
@@ -785,6 +921,12 @@ static void HTTPProcess(void)
 			}
 			#endif
 
+			#if defined(HTTP_USE_KEEPALIVE)
+			// Unread POST data would be taken for the next request
+			if(curHTTP.byteCount)
+				curHTTP.keepAlive = FALSE;
+			#endif
+
 			// We're done with POST
 			smHTTP = SM_HTTP_PROCESS_REQUEST;
 			// No break, continue to sending request
@@ -816,12 +958,43 @@ static void HTTPProcess(void)
 
 		case SM_HTTP_SERVE_HEADERS:
 
+			#if defined(HTTP_USE_KEEPALIVE)
+			// The headers are written in one go, so a pipelined response
+			// waits until the previous one has left room for them
+			if(TCPGetTxFIFOFull(sktHTTP) != 0u && TCPIsPutReady(sktHTTP) < HTTP_HEADER_SPACE)
+				break;
+
+			// Only GET and POST responses can be followed by another
+			// request.  Dynamic pages are chunked, which needs HTTP/1.1.
+			if((curHTTP.httpStatus != HTTP_GET && curHTTP.httpStatus != HTTP_POST) ||
+				(curHTTP.nextCallback != 0xffffffff && curHTTP.isChunked == HTTP_CHUNK_NONE))
+				curHTTP.keepAlive = FALSE;
+			if(!curHTTP.keepAlive || curHTTP.nextCallback == 0xffffffff)
+				curHTTP.isChunked = HTTP_CHUNK_NONE;
+			#endif
+
 			// We're in write mode now:
 			// Adjust the TCP FIFOs for optimal transmission of 
 			// the HTTP response to the browser
+			#if defined(HTTP_USE_KEEPALIVE)
+			// A persistent connection keeps some RX FIFO for the next
+			// requests.  The FIFOs are only adjusted once no earlier 
+			// response is left in the TX FIFO.
+			if(curHTTP.keepAlive)
+			{
+				if(TCPGetTxFIFOFull(sktHTTP) == 0u)
+					TCPAdjustFIFOSize(sktHTTP, HTTP_KEEPALIVE_RX, 0, TCP_ADJUST_PRESERVE_RX | TCP_ADJUST_GIVE_REST_TO_TX);
+			}
+			else if(TCPGetTxFIFOFull(sktHTTP) == 0u)
+			#endif
 			TCPAdjustFIFOSize(sktHTTP, 1, 0, TCP_ADJUST_GIVE_REST_TO_TX);
 				
 			// Send headers
+			#if defined(HTTP_USE_KEEPALIVE)
+			if(curHTTP.keepAlive)
+				TCPPutROMString(sktHTTP, HTTP_KEEPALIVE_OK);
+			else
+			#endif
 			TCPPutROMString(sktHTTP, (ROM BYTE*)HTTPResponseHeaders[curHTTP.httpStatus]);
 			
 			// If this is a redirect, print the rest of the Location: header			   
@@ -849,7 +1022,19 @@ static void HTTPProcess(void)
 			}
 			
 			// Output the gzip encoding header if needed
+			#if defined(HTTP_USE_INFLATE)
+			// Clients that do not accept it get the file decompressed
+			dwLen = MPFSGetSize(curHTTP.file);
+			if((MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_ISZIPPED) && !curHTTP.acceptGzip)
+			{
+				curHTTP.isInflated = HTTPCanInflate(&dwLen);
+				if(curHTTP.isInflated && httpInflateOwner == curHTTPID)
+					httpInflateOwner = HTTP_INFLATE_NONE;
+			}
+			if((MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_ISZIPPED) && !curHTTP.isInflated)
+			#else
 			if(MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_ISZIPPED)
+			#endif
 			{
 				TCPPutROMString(sktHTTP, (ROM BYTE*)"Content-Encoding: gzip\r\n");
 			}
@@ -866,6 +1051,25 @@ static void HTTPProcess(void)
 				TCPPutROMString(sktHTTP, (ROM BYTE*)HTTP_CACHE_LEN);
 			}
 			TCPPutROMString(sktHTTP, HTTP_CRLF);
+
+			#if defined(HTTP_USE_KEEPALIVE)
+			// The client finds the end of the body by its length
+			if(curHTTP.isChunked != HTTP_CHUNK_NONE)
+			{
+				TCPPutROMString(sktHTTP, (ROM BYTE*)"Transfer-Encoding: chunked\r\n");
+			}
+			else if(curHTTP.keepAlive)
+			{// Static files are sent whole
+				TCPPutROMString(sktHTTP, (ROM BYTE*)"Content-Length: ");
+				#if defined(HTTP_USE_INFLATE)
+				ultoa(dwLen, buffer);
+				#else
+				ultoa(MPFSGetSize(curHTTP.file), buffer);
+				#endif
+				TCPPutString(sktHTTP, buffer);
+				TCPPutROMString(sktHTTP, HTTP_CRLF);
+			}
+			#endif
 			
 			// Check if we should output cookies
 			if(curHTTP.hasArgs)
@@ -945,9 +1149,35 @@ static void HTTPProcess(void)
 				curHTTP.file = MPFS_INVALID_HANDLE;
 				smHTTP = SM_HTTP_DISCONNECT;
 				isDone = TRUE;
+
+				#if defined(HTTP_USE_KEEPALIVE)
+				// HTTPSendFile() left room for the last-chunk marker
+				HTTPCloseChunk();
+				if(curHTTP.isChunked == HTTP_CHUNK_OPEN)
+					TCPPutROMArray(sktHTTP, HTTP_CRLF, HTTP_CRLF_LEN);
+				if(curHTTP.isChunked != HTTP_CHUNK_NONE)
+					TCPPutROMString(sktHTTP, (ROM BYTE*)"0\r\n\r\n");
+
+				if(curHTTP.keepAlive)
+				{// Send the end of the response and await the next request
+					if(curHTTP.offsets != MPFS_INVALID_HANDLE)
+					{
+						MPFSClose(curHTTP.offsets);
+						curHTTP.offsets = MPFS_INVALID_HANDLE;
+					}
+					TCPFlush(sktHTTP);
+					curHTTP.callbackID = TickGet() + HTTP_KEEPALIVE_TIMEOUT*TICK_SECOND;
+					smHTTP = SM_HTTP_WAIT_REQUEST;
+					isDone = FALSE;
+				}
+				#endif
 			}
 			
 			// If the TX FIFO is full, then return to main app loop
+			#if defined(HTTP_USE_KEEPALIVE)
+			if(curHTTP.isChunked != HTTP_CHUNK_NONE && TCPIsPutReady(sktHTTP) <= HTTP_CHUNK_OVERHEAD)
+				isDone = TRUE;
+			#endif
 			if(TCPIsPutReady(sktHTTP) == 0u)
 				isDone = TRUE;
             break;
@@ -957,11 +1187,25 @@ static void HTTPProcess(void)
 			isDone = TRUE;
 
 			// Check that at least the minimum bytes are free
-			if(TCPIsPutReady(sktHTTP) < HTTP_MIN_CALLBACK_FREE)
-				break;
+			#if defined(HTTP_USE_KEEPALIVE)
+			if(curHTTP.isChunked != HTTP_CHUNK_NONE)
+			{
+				if(TCPIsPutReady(sktHTTP) < HTTP_MIN_CALLBACK_FREE + HTTP_CHUNK_OVERHEAD)
+					break;
 
-			// Fill TX FIFO from callback
-			HTTPPrint(curHTTP.callbackID);
+				// Fill TX FIFO from callback, in the chunk being written
+				HTTPOpenChunk();
+				HTTPPrint(curHTTP.callbackID);
+			}
+			else
+			#endif
+			{
+				if(TCPIsPutReady(sktHTTP) < HTTP_MIN_CALLBACK_FREE)
+					break;
+
+				// Fill TX FIFO from callback
+				HTTPPrint(curHTTP.callbackID);
+			}
 			
 			if(curHTTP.callbackPos == 0u)
 			{// Callback finished its output, so move on
@@ -972,6 +1216,10 @@ static void HTTPProcess(void)
 			break;
 
 		case SM_HTTP_DISCONNECT:
+			#if defined(HTTP_USE_KEEPALIVE)
+			HTTPCloseChunk();
+			#endif
+
 			// Make sure any opened files are closed
 			if(curHTTP.file != MPFS_INVALID_HANDLE)
 			{
@@ -986,10 +1234,17 @@ static void HTTPProcess(void)
 
 			TCPDisconnect(sktHTTP);
             smHTTP = SM_HTTP_IDLE;
+			#if defined(HTTP_USE_KEEPALIVE)
+			curHTTP.keepAlive = FALSE;
+			#endif
             break;
 		}
 	} while(!isDone);
 
+	#if defined(HTTP_USE_KEEPALIVE)
+	// Send what this pass wrote
+	HTTPCloseChunk();
+	#endif
 }
 
 
@@ -1014,23 +1269,39 @@ static void HTTPProcess(void)
 static BOOL HTTPSendFile(void)
 {
 	WORD numBytes, len;
-	BYTE c, data[64];
+	DWORD dwVarLen;
+	BYTE c;
 	
+	#if defined(HTTP_USE_INFLATE)
+	if(curHTTP.isInflated)
+		return HTTPSendInflated();
+	#endif
+
 	// Determine how many bytes we can read right now
 	len = TCPIsPutReady(sktHTTP);
+	#if defined(HTTP_USE_KEEPALIVE)
+	if(curHTTP.isChunked != HTTP_CHUNK_NONE)
+	{// Leave room for the chunk header and the last-chunk marker
+		if(len <= HTTP_CHUNK_OVERHEAD)
+			return FALSE;
+		len -= HTTP_CHUNK_OVERHEAD;
+	}
+	#endif
 	numBytes = mMIN(len, curHTTP.nextCallback - curHTTP.byteCount);
 	
-	// Get/put as many bytes as possible
+	// Copy as many bytes as possible straight into the TX FIFO
 	curHTTP.byteCount += numBytes;
-	while(numBytes > 0u)
-	{
-		len = MPFSGetArray(curHTTP.file, data, mMIN(numBytes, sizeof(data)));
-		if(len == 0u)
-			return TRUE;
-		else
-			TCPPutArray(sktHTTP, data, len);
-		numBytes -= len;
+	#if defined(HTTP_USE_KEEPALIVE)
+	if(curHTTP.isChunked != HTTP_CHUNK_NONE)
+	{// Add them to the chunk being written
+		HTTPOpenChunk();
+		len = TCPPutMPFS(sktHTTP, curHTTP.file, numBytes);
 	}
+	else
+	#endif
+		len = TCPPutMPFS(sktHTTP, curHTTP.file, numBytes);
+	if(len < numBytes)
+		return TRUE;
 	
 	// Check if a callback index was reached
 	if(curHTTP.byteCount == curHTTP.nextCallback)
@@ -1039,15 +1310,23 @@ static BOOL HTTPSendFile(void)
 		smHTTP = SM_HTTP_SEND_FROM_CALLBACK;
 		curHTTP.callbackPos = 0;
 
-		// Read past the variable name and close the MPFS
-		MPFSGet(curHTTP.file, NULL);
-		do
-		{
-			if(!MPFSGet(curHTTP.file, &c))
-				break;
+		if(curHTTP.hasVarLen)
+		{// The index holds the variable length, so seek past it
+			MPFSGetLong(curHTTP.offsets, &dwVarLen);
+			MPFSSeek(curHTTP.file, dwVarLen, MPFS_SEEK_FORWARD);
+			curHTTP.byteCount += dwVarLen;
+		}
+		else
+		{// Read past the variable name and close the MPFS
+			MPFSGet(curHTTP.file, NULL);
+			do
+			{
+				if(!MPFSGet(curHTTP.file, &c))
+					break;
+				curHTTP.byteCount++;
+			} while(c != '~');
 			curHTTP.byteCount++;
-		} while(c != '~');
-		curHTTP.byteCount++;
+		}
 		
 		// Read in the callback address and next offset
 		MPFSGetLong(curHTTP.offsets, &(curHTTP.callbackID));
@@ -1063,6 +1342,230 @@ static BOOL HTTPSendFile(void)
     return FALSE;
 }
 
+#if defined(HTTP_USE_INFLATE)
+/*****************************************************************************
+  Function:
+	static void HTTPHeaderParseAcceptEncoding(void)
+
+  Description:
+	Parses the "Accept-Encoding:" header for a request.  GZIP files are
+	sent compressed only to clients that list "gzip".
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPHeaderParseAcceptEncoding(void)
+{
+	WORD len;
+
+	// The encodings end with the line
+	len = TCPFind(sktHTTP, '\n', 0, FALSE);
+
+	curHTTP.acceptGzip = (TCPFindROMArrayEx(sktHTTP, (ROM BYTE*)"gzip", 4, 0, len, TRUE) != 0xffffu);
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL HTTPCanInflate(DWORD* pdwLen)
+
+  Description:
+	Determines whether curHTTP's GZIP file can be decompressed with a 
+	window of HTTP_INFLATE_WINDOW bytes.  That is the case if it has an 
+	index of blocks no longer than the window, as no match reaches back
+	past the start of its block, or if the whole file decompresses to no
+	more than the window.
+
+  Precondition:
+	curHTTP.file is a GZIP file open for reading.
+
+  Parameters:
+	pdwLen - receives the decompressed length of the file, if it can be
+		decompressed
+
+  Return Values:
+	TRUE - the file can be decompressed
+	FALSE - the file must be sent compressed
+  ***************************************************************************/
+static BOOL HTTPCanInflate(DWORD* pdwLen)
+{
+	MPFS_HANDLE hIndex;
+	DWORD dwBlockLen, dwSize;
+
+	// The last 4 bytes of a GZIP file hold its decompressed length
+	if(!MPFSSeek(curHTTP.file, 4, MPFS_SEEK_END) || !MPFSGetLong(curHTTP.file, &dwSize))
+		return FALSE;
+	MPFSSeek(curHTTP.file, 0, MPFS_SEEK_START);
+
+	if(MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_HASBLOCKS)
+	{// The index starts with the block length
+		hIndex = MPFSOpenID(MPFSGetID(curHTTP.file) + 1);
+		if(hIndex == MPFS_INVALID_HANDLE)
+			return FALSE;
+		dwBlockLen = 0;
+		MPFSGetLong(hIndex, &dwBlockLen);
+		MPFSClose(hIndex);
+		if(dwBlockLen == 0u || dwBlockLen > HTTP_INFLATE_WINDOW)
+			return FALSE;
+	}
+	else if(dwSize > HTTP_INFLATE_WINDOW)
+		return FALSE;
+
+	*pdwLen = dwSize;
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL HTTPSendInflated(void)
+
+  Description:
+	Decompresses the next part of curHTTP's GZIP file into the TX FIFO,
+	up to the available space.  If another response has used the shared
+	window since this one last did, decompression restarts at the block 
+	holding the next byte (or the start of a file without blocks), and 
+	the output before that byte is discarded.
+
+  Precondition:
+	HTTPCanInflate returned TRUE for curHTTP.file.
+
+  Parameters:
+	None
+
+  Return Values:
+	TRUE - the end of the file was reached and reading is done
+	FALSE - more data remains to be read
+  ***************************************************************************/
+static BOOL HTTPSendInflated(void)
+{
+	MPFS_HANDLE hIndex;
+	DWORD dwBlockLen, dwOffset;
+	WORD len, wGot;
+
+	if(httpInflateOwner != curHTTPID)
+	{
+		dwBlockLen = 0;
+		dwOffset = 0;
+		if(MPFSGetFlags(curHTTP.file) & MPFS2_FLAG_HASBLOCKS)
+		{// Find the block in the index
+			hIndex = MPFSOpenID(MPFSGetID(curHTTP.file) + 1);
+			if(hIndex != MPFS_INVALID_HANDLE && (!MPFSGetLong(hIndex, &dwBlockLen) || dwBlockLen == 0u))
+			{
+				MPFSClose(hIndex);
+				hIndex = MPFS_INVALID_HANDLE;
+			}
+			if(hIndex == MPFS_INVALID_HANDLE)
+			{// The index is missing or invalid, so the response is cut short
+				#if defined(HTTP_USE_KEEPALIVE)
+				curHTTP.keepAlive = FALSE;
+				#endif
+				return TRUE;
+			}
+			dwOffset = curHTTP.byteCount / dwBlockLen;
+			dwBlockLen *= dwOffset;
+			MPFSSeek(hIndex, 4*dwOffset, MPFS_SEEK_FORWARD);
+			if(!MPFSGetLong(hIndex, &dwOffset))
+			{// Every block has been sent
+				MPFSClose(hIndex);
+				return TRUE;
+			}
+			MPFSClose(hIndex);
+		}
+		if(dwOffset != 0u)
+			MPFSSeek(curHTTP.file, dwOffset, MPFS_SEEK_START);
+		else
+		{
+			MPFSSeek(curHTTP.file, 0, MPFS_SEEK_START);
+			InflateGzipHeader(curHTTP.file);
+		}
+		InflateInit(&httpInflate, curHTTP.file, httpInflateWindow, HTTP_INFLATE_WINDOW);
+		httpInflateOwner = curHTTPID;
+
+		// Discard the output up to the next byte to send
+		for(dwOffset = curHTTP.byteCount - dwBlockLen; dwOffset != 0u; dwOffset -= wGot)
+		{
+			wGot = InflateGetArray(&httpInflate, NULL, (dwOffset > 0x8000u) ? 0x8000u : (WORD)dwOffset);
+			if(wGot == 0u)
+				break;
+		}
+	}
+	
+	// Decompress through curHTTP.data, which a GZIP file has no 
+	// arguments or callbacks to need
+	len = TCPIsPutReady(sktHTTP);
+	while(len)
+	{
+		wGot = InflateGetArray(&httpInflate, curHTTP.data, mMIN(len, HTTP_MAX_DATA_LEN));
+		TCPPutArray(sktHTTP, curHTTP.data, wGot);
+		curHTTP.byteCount += wGot;
+		if(wGot < mMIN(len, HTTP_MAX_DATA_LEN))
+		{// End of the file, or invalid data
+			#if defined(HTTP_USE_KEEPALIVE)
+			if(httpInflate.vState == INFLATE_ERROR)
+				curHTTP.keepAlive = FALSE;
+			#endif
+			httpInflateOwner = HTTP_INFLATE_NONE;
+			return TRUE;
+		}
+		len -= wGot;
+	}
+
+	return FALSE;
+}
+#endif
+
+/*****************************************************************************
+  Function:
+	static BYTE HTTPHeaderFind(WORD wLineLen, BYTE* pNameLen)
+
+  Description:
+	Determines which of the HTTPRequestHeaders, if any, starts the line at
+	the front of the TCP buffer.  The name is hashed as it is read, and 
+	only the string in its slot of HTTPRequestHeaderSlots is compared.
+
+  Precondition:
+	Front of TCP buffer is the beginning of a header line.
+
+  Parameters:
+	wLineLen - the number of bytes of the line in the TCP buffer
+	pNameLen - receives the length of the name, including its colon
+
+  Return Values:
+	the index of the string in HTTPRequestHeaders, or HTTP_HEADER_NONE
+	if the line is not a header to parse
+  ***************************************************************************/
+static BYTE HTTPHeaderFind(WORD wLineLen, BYTE* pNameLen)
+{
+	BYTE name[HTTP_MAX_HEADER_LEN+1];
+	WORD wHash;
+	BYTE i, len, c;
+
+	// Look at as much of the line as the longest header name
+	len = TCPPeekArray(sktHTTP, name, (wLineLen < HTTP_MAX_HEADER_LEN) ? wLineLen : HTTP_MAX_HEADER_LEN, 0);
+
+	// Hash the name up to its colon
+	wHash = 0;
+	for(i = 0; i < len && name[i] != ':'; i++)
+		wHash = (wHash << 5) - wHash + (name[i] | 0x20);
+
+	// If name is too long or this line isn't a header, it isn't ours
+	if(i == len)
+		return HTTP_HEADER_NONE;
+	name[i+1] = '\0';
+	*pNameLen = i+1;
+
+	// Compare the header to the only one it can be
+	c = HTTPRequestHeaderSlots[wHash & (HTTP_HEADER_SLOTS-1)];
+	if(c != HTTP_HEADER_NONE && stricmppgm2ram(name, (ROM BYTE*)HTTPRequestHeaders[c]) != 0)
+		c = HTTP_HEADER_NONE;
+	return c;
+}
+
 /*****************************************************************************
   Function:
 	static void HTTPHeaderParseLookup(BYTE i)
@@ -1108,8 +1611,141 @@ static void HTTPHeaderParseLookup(BYTE i)
 		return;
 	}
 	#endif
+
+	#if defined(HTTP_USE_KEEPALIVE)
+	if(i == 3u)
+	{
+		HTTPHeaderParseConnection();
+		return;
+	}
+	#endif
+
+	#if defined(HTTP_USE_INFLATE)
+	if(i == 4u)
+	{
+		HTTPHeaderParseAcceptEncoding();
+		return;
+	}
+	#endif
 }
 
+#if defined(HTTP_USE_KEEPALIVE)
+/*****************************************************************************
+  Function:
+	static void HTTPHeaderParseConnection(void)
+
+  Description:
+	Parses the "Connection:" header for a request.  "close" ends the
+	connection after the response, and "keep-alive" keeps an HTTP/1.0
+	connection open.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPHeaderParseConnection(void)
+{
+	WORD len;
+
+	// The options end with the line
+	len = TCPFind(sktHTTP, '\n', 0, FALSE);
+
+	if(TCPFindROMArrayEx(sktHTTP, (ROM BYTE*)"close", 5, 0, len, TRUE) != 0xffffu)
+		curHTTP.keepAlive = FALSE;
+	else if(TCPFindROMArrayEx(sktHTTP, (ROM BYTE*)"keep-alive", 10, 0, len, TRUE) != 0xffffu)
+		curHTTP.keepAlive = TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	static void HTTPOpenChunk(void)
+
+  Description:
+	Starts a chunk of a response sent with chunked transfer encoding, 
+	unless one is already being written.  The chunk header is written with 
+	a blank length and the TX FIFO is held, so that everything written 
+	until HTTPCloseChunk() goes into this chunk.  The CRLF that ends the 
+	previous chunk is written here, since a callback may fill the TX FIFO 
+	without leaving room for it.
+
+  Precondition:
+	curHTTP.isChunked is not HTTP_CHUNK_NONE, and at least 8 bytes are
+	free in the TX FIFO.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPOpenChunk(void)
+{
+	if(curHTTP.isChunked == HTTP_CHUNK_WRITING)
+		return;
+
+	TCPHoldTX(sktHTTP, TRUE);
+	httpChunkHeaderLen = 6;
+	if(curHTTP.isChunked == HTTP_CHUNK_OPEN)
+	{
+		TCPPutROMArray(sktHTTP, HTTP_CRLF, HTTP_CRLF_LEN);
+		httpChunkHeaderLen = 8;
+	}
+	TCPPutROMArray(sktHTTP, (ROM BYTE*)"0000\r\n", 6);
+	httpChunkFree = TCPIsPutReady(sktHTTP);
+	curHTTP.isChunked = HTTP_CHUNK_WRITING;
+}
+
+/*****************************************************************************
+  Function:
+	static void HTTPCloseChunk(void)
+
+  Description:
+	Fills in the length of the chunk started by HTTPOpenChunk() and
+	releases the TX FIFO.  If no data was written, the chunk header is
+	removed again, since an empty chunk would end the response.  Does 
+	nothing if no chunk is being written.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void HTTPCloseChunk(void)
+{
+	BYTE vLength[4];
+	WORD wLen;
+
+	if(curHTTP.isChunked != HTTP_CHUNK_WRITING)
+		return;
+
+	wLen = httpChunkFree - TCPIsPutReady(sktHTTP);
+	if(wLen == 0u)
+	{
+		TCPUnput(sktHTTP, httpChunkHeaderLen);
+		curHTTP.isChunked = (httpChunkHeaderLen == 8u) ? HTTP_CHUNK_OPEN : HTTP_CHUNK_FIRST;
+	}
+	else
+	{
+		vLength[0] = btohexa_high((BYTE)(wLen>>8));
+		vLength[1] = btohexa_low((BYTE)(wLen>>8));
+		vLength[2] = btohexa_high((BYTE)wLen);
+		vLength[3] = btohexa_low((BYTE)wLen);
+		TCPPokeArray(sktHTTP, vLength, sizeof(vLength), wLen + 6);
+		curHTTP.isChunked = HTTP_CHUNK_OPEN;
+	}
+	TCPHoldTX(sktHTTP, FALSE);
+}
+#endif
+
 /*****************************************************************************
   Function:
 	static void HTTPHeaderParseAuthorization(void)
@@ -1732,8 +2368,8 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
 				// Make sure it's an MPFS of the correct version
 				lenA = TCPGetArray(sktHTTP, c, 10);
 				curHTTP.byteCount -= lenA;
-				if(memcmppgm2ram(c, (ROM void*)"\r\n\r\nMPFS\x02\x01", 10) == 0)
-				{// Read as Ver 2.1
+				if(memcmppgm2ram(c, (ROM void*)"\r\n\r\nMPFS\x02", 9) == 0 && (c[9] == 0x01u || c[9] == 0x02u))
+				{// Read as Ver 2.1 or 2.2
 					curHTTP.httpStatus = HTTP_MPFS_OK;
 					
 					// Format MPFS storage and put 6 byte tag
@@ -1836,8 +2472,7 @@ static HTTP_IO_RESULT HTTPMPFSUpload(void)
   ***************************************************************************/
 void HTTPIncFile(ROM BYTE* cFile)
 {
-	WORD wCount, wLen;
-	BYTE data[64];
+	WORD wCount;
 	MPFS_HANDLE fp;
 	
 	// Check if this is a first round call
@@ -1860,22 +2495,13 @@ void HTTPIncFile(ROM BYTE* cFile)
 		MPFSSeek(fp, ((DWORD_VAL*)&curHTTP.callbackPos)->w[1], MPFS_SEEK_FORWARD);
 	}
 	
-	// Get/put as many bytes as possible
+	// Copy as many bytes as possible straight into the TX FIFO
 	wCount = TCPIsPutReady(sktHTTP);
-	while(wCount > 0u)
-	{
-		wLen = MPFSGetArray(fp, data, mMIN(wCount, sizeof(data)));
-		if(wLen == 0u)
-		{// If no bytes were read, an EOF was reached
-			MPFSClose(fp);
-			curHTTP.callbackPos = 0x00;
-			return;
-		}
-		else
-		{// Write the bytes to the socket
-			TCPPutArray(sktHTTP, data, wLen);
-			wCount -= wLen;
-		}
+	if(TCPPutMPFS(sktHTTP, fp, wCount) < wCount)
+	{// If the FIFO could not be filled, an EOF was reached
+		MPFSClose(fp);
+		curHTTP.callbackPos = 0x00;
+		return;
 	}
 	
 	// Save the new address and close the file
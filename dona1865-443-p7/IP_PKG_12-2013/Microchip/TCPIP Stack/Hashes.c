@@ -2,8 +2,9 @@
  *
  *	Hash Function Library
  *  Library for Microchip TCP/IP Stack
- *	 -Calculates MD5 and SHA-1 Hashes
- *	 -Reference: RFC 1321 (MD5), RFC 3174 and FIPS 180-1 (SHA-1)
+ *	 -Calculates MD5, SHA-1 and SHA-256 Hashes
+ *	 -Reference: RFC 1321 (MD5), RFC 3174 and FIPS 180-1 (SHA-1),
+ *	             FIPS 180-2 (SHA-256)
  *
  *********************************************************************
  * FileName:        Hashes.c
@@ -57,6 +58,7 @@
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  * Elliott Wood	        5/01/07		Original
  * Elliott Wood			11/21/07	Greatly increased HashBlock speed
+ *                      10/18/26	Added SHA-256 for TLS 1.2
  ********************************************************************/
 #define __HASHES_C
 
@@ -79,7 +81,7 @@
 	Functions and variables required for both hash types
   ***************************************************************************/
 
-#if defined(STACK_USE_MD5) || defined(STACK_USE_SHA1)
+#if defined(STACK_USE_MD5) || defined(STACK_USE_SHA1) || defined(STACK_USE_SHA256)
 
 // Stores a copy of the last block with the required padding
 BYTE lastBlock[64];
@@ -116,6 +118,10 @@ void HashAddData(HASH_SUM* theSum, BYTE* data, WORD len)
 	if(theSum->hashType == HASH_SHA1)
 		SHA1AddData(theSum, data, len);
 	#endif
+	#if defined(STACK_USE_SHA256)
+	if(theSum->hashType == HASH_SHA256)
+		SHA256AddData(theSum, data, len);
+	#endif
 }
 
 /*****************************************************************************
@@ -153,6 +159,10 @@ void HashAddROMData(HASH_SUM* theSum, ROM BYTE* data, WORD len)
 	if(theSum->hashType == HASH_SHA1)
 		SHA1AddROMData(theSum, data, len);
 	#endif
+	#if defined(STACK_USE_SHA256)
+	if(theSum->hashType == HASH_SHA256)
+		SHA256AddROMData(theSum, data, len);
+	#endif
 }
 #endif
 
@@ -838,3 +848,346 @@ void SHA1Calculate(HASH_SUM* theSum, BYTE* result)
 }
 
 #endif	//#end SHA-1
+
+
+/****************************************************************************
+  Section:
+	Functions and variables required for SHA-256
+  ***************************************************************************/
+
+#if defined(STACK_USE_SHA256)
+
+// Round constants: the first 32 bits of the fractional parts of the cube
+// roots of the first 64 primes
+static ROM DWORD _SHA256_k[64] = { 0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5, 
+									0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 
+									0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA, 
+									0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967, 
+									0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 
+									0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070, 
+									0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3, 
+									0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2 };
+
+#define rightRotateDWORD(x, n)		leftRotateDWORD(x, 32-(n))
+
+static void SHA256HashBlock(BYTE* data, DWORD* h);
+
+/*****************************************************************************
+  Function:
+	void SHA256Initialize(HASH_SUM* theSum)
+
+  Description:
+	Initializes a new SHA-256 hash.
+
+  Precondition:
+	None
+
+  Parameters:
+	theSum - pointer to the allocated HASH_SUM object to initialize as 
+		SHA-256
+
+  Returns:
+  	None
+  ***************************************************************************/
+void SHA256Initialize(HASH_SUM* theSum)
+{
+	theSum->h0 = 0x6A09E667;
+	theSum->h1 = 0xBB67AE85;
+	theSum->h2 = 0x3C6EF372;
+	theSum->h3 = 0xA54FF53A;
+	theSum->h4 = 0x510E527F;
+	theSum->h5 = 0x9B05688C;
+	theSum->h6 = 0x1F83D9AB;
+	theSum->h7 = 0x5BE0CD19;
+	theSum->bytesSoFar = 0;
+	theSum->hashType = HASH_SHA256;
+}
+
+/*****************************************************************************
+  Function:
+	void SHA256AddData(HASH_SUM* theSum, BYTE* data, WORD len)
+
+  Description:
+	Adds data to a SHA-256 hash calculation.
+
+  Precondition:
+	The hash context has already been initialized.
+
+  Parameters:
+	theSum - a pointer to the hash context structure
+	data - the data to add to the hash
+	len - the length of the data to add
+
+  Returns:
+  	None
+  ***************************************************************************/
+void SHA256AddData(HASH_SUM* theSum, BYTE* data, WORD len)
+{
+	DWORD h[8];
+	BYTE *blockPtr;
+
+	// Seek to the first free byte
+	blockPtr = theSum->partialBlock + ( theSum->bytesSoFar & 0x3f );
+
+	// Update the total number of bytes
+	theSum->bytesSoFar += len;
+
+	// Nothing to hash if the partial block will not fill
+	if(blockPtr + len < theSum->partialBlock + 64)
+	{
+		while(len--)
+			*blockPtr++ = *data++;
+		return;
+	}
+
+	// Load the context once for all the blocks
+	h[0] = theSum->h0;
+	h[1] = theSum->h1;
+	h[2] = theSum->h2;
+	h[3] = theSum->h3;
+	h[4] = theSum->h4;
+	h[5] = theSum->h5;
+	h[6] = theSum->h6;
+	h[7] = theSum->h7;
+
+	// Copy data into the partial block
+	while(len != 0u)
+	{
+		*blockPtr++ = *data++;
+
+		// If the partial block is full, hash the data and start over
+		if(blockPtr == theSum->partialBlock + 64)
+		{
+			SHA256HashBlock(theSum->partialBlock, h);
+			blockPtr = theSum->partialBlock;
+		}
+		
+		len--;
+	}
+	
+	// Save the new context
+	theSum->h0 = h[0];
+	theSum->h1 = h[1];
+	theSum->h2 = h[2];
+	theSum->h3 = h[3];
+	theSum->h4 = h[4];
+	theSum->h5 = h[5];
+	theSum->h6 = h[6];
+	theSum->h7 = h[7];
+}
+
+/*****************************************************************************
+  Function:
+	void SHA256AddROMData(HASH_SUM* theSum, ROM BYTE* data, WORD len)
+
+  Description:
+	Adds data to a SHA-256 hash calculation.
+
+  Precondition:
+	The hash context has already been initialized.
+
+  Parameters:
+	theSum - a pointer to the hash context structure
+	data - the data to add to the hash
+	len - the length of the data to add
+
+  Returns:
+  	None
+  	
+  Remarks:
+  	This function is aliased to SHA256AddData on non-PIC18 platforms.
+  ***************************************************************************/
+#if defined(__18CXX)
+void SHA256AddROMData(HASH_SUM* theSum, ROM BYTE* data, WORD len)
+{
+	BYTE buffer[16], chunk;
+
+	// Copy to RAM in small pieces
+	while(len)
+	{
+		chunk = sizeof(buffer);
+		if(chunk > len)
+			chunk = len;
+		memcpypgm2ram((void*)buffer, (ROM void*)data, chunk);
+		SHA256AddData(theSum, buffer, chunk);
+		data += chunk;
+		len -= chunk;
+	}
+}
+#endif
+
+/*****************************************************************************
+  Function:
+	static void SHA256HashBlock(BYTE* data, DWORD* h)
+
+  Summary:
+	Calculates the SHA-256 hash sum of a block.
+
+  Description:
+	This function calculates the SHA-256 hash sum over a block and updates
+	the values of h[0]-h[7] with the next context.
+
+  Precondition:
+	None
+
+  Parameters:
+	data - The block of 64 bytes to hash
+	h - the current hash context h0 to h7 values
+
+  Returns:
+  	None
+
+  Remarks:
+	The message schedule is kept in lastBlock as 16 words, each replaced
+	by the word 16 rounds later once it has been used.
+  ***************************************************************************/
+static void SHA256HashBlock(BYTE* data, DWORD* h)
+{
+	DWORD a, b, c, d, e, f, g, k, temp, temp2;
+	DWORD_VAL *w = (DWORD_VAL*)lastBlock;
+	BYTE i;
+
+	// Set up the w[] vector, swapping endian-ness
+	for(i = 0; i < 16u; i++)
+	{
+		w[i].v[3] = *data++;
+		w[i].v[2] = *data++;
+		w[i].v[1] = *data++;
+		w[i].v[0] = *data++;
+	}
+
+	// Set up a, b, c, d, e, f, g, k (k is used as the eighth variable)
+	a = h[0];
+	b = h[1];
+	c = h[2];
+	d = h[3];
+	e = h[4];
+	f = h[5];
+	g = h[6];
+	k = h[7];
+
+	// Main mixer loop for 64 operations
+	for(i = 0; i < 64u; i++)
+	{
+		// Calculate the w[] value and store it in the array for future use
+		if(i >= 16u)
+		{
+			temp = w[(i+1)&0x0f].Val;
+			temp2 = w[(i+14)&0x0f].Val;
+			w[i&0x0f].Val += (rightRotateDWORD(temp, 7) ^ rightRotateDWORD(temp, 18) ^ (temp >> 3))
+							+ w[(i+9)&0x0f].Val
+							+ (rightRotateDWORD(temp2, 17) ^ rightRotateDWORD(temp2, 19) ^ (temp2 >> 10));
+		}
+
+		// Calculate the new mixers
+		temp = k + (rightRotateDWORD(e, 6) ^ rightRotateDWORD(e, 11) ^ rightRotateDWORD(e, 25))
+				+ ((e & f) ^ ((~e) & g)) + _SHA256_k[i] + w[i&0x0f].Val;
+		temp2 = (rightRotateDWORD(a, 2) ^ rightRotateDWORD(a, 13) ^ rightRotateDWORD(a, 22))
+				+ ((a & b) ^ (a & c) ^ (b & c));
+		k = g;
+		g = f;
+		f = e;
+		e = d + temp;
+		d = c;
+		c = b;
+		b = a;
+		a = temp + temp2;
+	}
+
+	// Add the new hash to the sum
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+	h[5] += f;
+	h[6] += g;
+	h[7] += k;
+}
+
+/*****************************************************************************
+  Function:
+	void SHA256Calculate(HASH_SUM* theSum, BYTE* result)
+
+  Summary:
+	Calculates a SHA-256 hash
+
+  Description:
+	This function calculates the hash sum of all input data so far.  It is
+	non-destructive to the hash context, so more data may be added after
+	this function is called.
+
+  Precondition:
+	The hash context has been properly initialized.
+
+  Parameters:
+	theSum - the current hash context
+	result - 32 byte array in which to store the resulting hash
+
+  Returns:
+  	None
+  ***************************************************************************/
+void SHA256Calculate(HASH_SUM* theSum, BYTE* result)
+{
+	DWORD h[8];
+	BYTE i, j, block[64];
+
+	// Initialize the hash variables
+	h[0] = theSum->h0;
+	h[1] = theSum->h1;
+	h[2] = theSum->h2;
+	h[3] = theSum->h3;
+	h[4] = theSum->h4;
+	h[5] = theSum->h5;
+	h[6] = theSum->h6;
+	h[7] = theSum->h7;
+
+	// Copy the partial block.  The message schedule is kept in lastBlock,
+	// so the padded block is built separately.
+	j = theSum->bytesSoFar & 0x3f;
+	for(i = 0; i < j; i++)
+		block[i] = theSum->partialBlock[i];
+
+	// Add one more bit and 7 zeros
+	block[i++] = 0x80;
+
+	// If there's 8 or more bytes left to 64, then this is the last block
+	if(i > 56u)
+	{// If there's not enough space, then zero fill this and add a new block
+		// Zero pad the remainder
+		for( ; i < 64u; block[i++] = 0x00);
+
+		// Calculate a hash on this block and add it to the sum
+		SHA256HashBlock(block, h);
+
+		//create a new block for the size
+		i = 0;
+	}
+
+	// Zero fill the rest of the block
+	for( ; i < 56u; block[i++] = 0x00);
+
+	// Fill in the size, in bits, in big-endian
+	block[63] = theSum->bytesSoFar << 3;
+	block[62] = theSum->bytesSoFar >> 5;
+	block[61] = theSum->bytesSoFar >> 13;
+	block[60] = theSum->bytesSoFar >> 21;
+	block[59] = theSum->bytesSoFar >> 29;
+	block[58] = 0;
+	block[57] = 0;
+	block[56] = 0;
+
+	// Calculate a hash on this final block and add it to the sum
+	SHA256HashBlock(block, h);
+	
+	// Format the result in big-endian format
+	for(i = 0; i < 8u; i++)
+	{
+		*result++ = ((BYTE*)&h[i])[3];
+		*result++ = ((BYTE*)&h[i])[2];
+		*result++ = ((BYTE*)&h[i])[1];
+		*result++ = ((BYTE*)&h[i])[0];
+	}
+}
+
+#endif	//#end SHA-256
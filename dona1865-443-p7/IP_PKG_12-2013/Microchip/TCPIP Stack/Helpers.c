@@ -51,6 +51,9 @@
               btohexa_high(), and btohexa_low(); Optimized swapl();
               Added leftRotateDWORD()
   5.36        Updated compile time check for ultoa();
+  10/18/26    CalcIPChecksum() sums 32-bit words on PIC32 and accepts
+              any buffer alignment; added UpdateIPChecksum()
+  10/18/26    Added CalcIPChecksumCopy()
 
  ********************************************************************/
 #define __HELPERS_C
@@ -286,6 +289,21 @@ DWORD GenerateRandomDWORD(void)
 	TMR0L = TMR0LSave;
 	T0CON = T0CONSave;
 }
+#elif defined(COMPILER_HOST_GCC)
+{
+	FILE *f;
+
+	// The host build takes its entropy from the kernel
+	randomResult.w[0] = LFSRRand();
+	randomResult.w[1] = LFSRRand();
+	f = fopen("/dev/urandom", "rb");
+	if(f)
+	{
+		if(fread(&randomResult.dw, sizeof(randomResult.dw), 1, f) != 1)
+			randomResult.dw ^= TickGet();
+		fclose(f);
+	}
+}
 #else
 {
 	WORD AD1CON1Save, AD1CON2Save, AD1CON3Save;
@@ -876,8 +894,8 @@ void uitoa(WORD Value, BYTE* Buffer)
   ***************************************************************************/
 // HI-TECH PICC-18 PRO 9.63, C30 v3.25, and C32 v1.12 already have a ultoa() library function
 // C18 already has a ultoa() function that more-or-less matches this one
-// C32 < 1.12 and C30 < v3.25 need this function
-#if (defined(__PIC32MX__) && (__C32_VERSION__ < 112)) || (defined (__C30__) && (__C30_VERSION__ < 325)) || defined(__C30_LEGACY_LIBC__) || defined(__C32_LEGACY_LIBC__)
+// C32 < 1.12, C30 < v3.25 and the GCC host build need this function
+#if (defined(__PIC32MX__) && (__C32_VERSION__ < 112)) || (defined (__C30__) && (__C30_VERSION__ < 325)) || defined(__C30_LEGACY_LIBC__) || defined(__C32_LEGACY_LIBC__) || defined(COMPILER_HOST_GCC)
 void ultoa(DWORD Value, BYTE* Buffer)
 {
 	BYTE i;
@@ -1147,7 +1165,7 @@ DWORD swapl(DWORD v)
 	summed).  This checksum is defined in RFC 793.
 
   Precondition:
-	buffer is WORD aligned (even memory address) on 16- and 32-bit PICs.
+	None
 
   Parameters:
 	buffer - pointer to the data to be checksummed
@@ -1156,42 +1174,326 @@ DWORD swapl(DWORD v)
   Returns:
 	The calculated checksum.
 	
-  Internal:
-	This function could be improved to do 32-bit sums on PIC32 platforms.
+  Remarks:
+	On PIC32 and the host build, 32-bit words are summed into a 64-bit 
+	accumulator, four words per loop iteration.  Other platforms sum 16-bit 
+	words into a 32-bit accumulator, four words per iteration.  The buffer 
+	may start at any address: the words are always read from aligned 
+	addresses, as in RFC 1071 section 4.
   ***************************************************************************/
 WORD CalcIPChecksum(BYTE* buffer, WORD count)
 {
 	WORD i;
+	BOOL bOdd;
+#if defined(__C32__) || defined(COMPILER_HOST_GCC)
+	DWORD *val;
+	QWORD_VAL sum;
+#else
 	WORD *val;
-	union
+	DWORD_VAL sum;
+#endif
+
+	sum.Val = 0;
+
+	// If the buffer starts at an odd address, sum the first byte as the 
+	// upper byte of a word and the rest from the next even address.  This 
+	// gives the byte swapped sum, which is swapped back at the end.
+	bOdd = ((PTR_BASE)buffer & 0x1u) && count;
+	if(bOdd)
 	{
-		WORD w[2];
-		DWORD dw;
-	} sum;
+		sum.Val = (WORD)*buffer++ << 8;
+		count--;
+	}
 
-	i = count >> 1;
-	val = (WORD*)buffer;
+#if defined(__C32__) || defined(COMPILER_HOST_GCC)
+	// Align to 32 bits
+	if(((PTR_BASE)buffer & 0x2u) && (count >= 2u))
+	{
+		sum.Val += *(WORD*)buffer;
+		buffer += 2;
+		count -= 2;
+	}
+
+	// Calculate the sum of all 32-bit words.  The carries collect in the 
+	// upper half of the sum, which cannot overflow for a WORD count.
+	val = (DWORD*)buffer;
+	for(i = count >> 4; i; i--)
+	{
+		sum.Val += (QWORD)val[0] + (QWORD)val[1] + (QWORD)val[2] + (QWORD)val[3];
+		val += 4;
+	}
+	for(i = (count >> 2) & 0x3u; i; i--)
+		sum.Val += *val++;
+	buffer = (BYTE*)val;
+	if(count & 0x2u)
+	{
+		sum.Val += *(WORD*)buffer;
+		buffer += 2;
+	}
+
+	// Add in the sum of the remaining byte, if present
+	if(count & 0x1u)
+		sum.Val += *buffer;
 
+	// Fold the 64-bit sum to 32 bits
+	sum.Val = (QWORD)sum.d[0] + (QWORD)sum.d[1];
+	sum.d[0] += sum.d[1];
+#else
 	// Calculate the sum of all words
-	sum.dw = 0x00000000ul;
-	while(i--)
-		sum.dw += (DWORD)*val++;
+	val = (WORD*)buffer;
+	for(i = count >> 3; i; i--)
+	{
+		sum.Val += (DWORD)val[0] + (DWORD)val[1] + (DWORD)val[2] + (DWORD)val[3];
+		val += 4;
+	}
+	for(i = (count >> 1) & 0x3u; i; i--)
+		sum.Val += (DWORD)*val++;
 
 	// Add in the sum of the remaining byte, if present
-	if(count & 0x1)
-		sum.dw += (DWORD)*(BYTE*)val;
+	if(count & 0x1u)
+		sum.Val += (DWORD)*(BYTE*)val;
+#endif
 
 	// Do an end-around carry (one's complement arrithmatic)
-	sum.dw = (DWORD)sum.w[0] + (DWORD)sum.w[1];
+	sum.Val = (DWORD)sum.w[0] + (DWORD)sum.w[1];
 
 	// Do another end-around carry in case if the prior add 
 	// caused a carry out
 	sum.w[0] += sum.w[1];
 
+	// Undo the byte swap of an odd start address
+	if(bOdd)
+		sum.w[0] = swaps(sum.w[0]);
+
 	// Return the resulting checksum
 	return ~sum.w[0];
 }
 
+/*****************************************************************************
+  Function:
+	WORD CalcIPChecksumCopy(BYTE* dest, BYTE* source, WORD count)
+
+  Summary:
+	Copies data and calculates its IP checksum.
+
+  Description:
+	This function copies count bytes from source to dest and returns the 
+	same checksum as CalcIPChecksum(dest, count) would after the copy, 
+	reading each word of the data only once.
+
+  Precondition:
+	None
+
+  Parameters:
+	dest   - where to copy the data
+	source - pointer to the data to be copied and checksummed
+	count  - number of bytes to be copied and checksummed
+
+  Returns:
+	The calculated checksum.
+	
+  Remarks:
+	The words are copied and summed in the same loop when dest and source 
+	have the same alignment: 32-bit words on PIC32 and the host build if 
+	the addresses are equal modulo 4, 16-bit words otherwise.  When one 
+	address is odd and the other even, the data is copied with memcpy() 
+	and the copy is summed with CalcIPChecksum().  The regions must not 
+	overlap.
+  ***************************************************************************/
+WORD CalcIPChecksumCopy(BYTE* dest, BYTE* source, WORD count)
+{
+	WORD i;
+	BOOL bOdd;
+	WORD *val, *dst;
+#if defined(__C32__) || defined(COMPILER_HOST_GCC)
+	DWORD *val32, *dst32;
+	DWORD w0, w1, w2, w3;
+	QWORD_VAL sum;
+#else
+	WORD w0, w1, w2, w3;
+	DWORD_VAL sum;
+#endif
+
+	if(((PTR_BASE)dest ^ (PTR_BASE)source) & 0x1u)
+	{
+		memcpy((void*)dest, (void*)source, count);
+		return CalcIPChecksum(dest, count);
+	}
+
+	sum.Val = 0;
+
+	// Sum an odd first byte as the upper byte of a word, as in 
+	// CalcIPChecksum()
+	bOdd = ((PTR_BASE)source & 0x1u) && count;
+	if(bOdd)
+	{
+		*dest++ = *source;
+		sum.Val = (WORD)*source++ << 8;
+		count--;
+	}
+
+#if defined(__C32__) || defined(COMPILER_HOST_GCC)
+	// Align the source to 32 bits
+	if(((PTR_BASE)source & 0x2u) && (count >= 2u))
+	{
+		*(WORD*)dest = *(WORD*)source;
+		sum.Val += *(WORD*)source;
+		dest += 2;
+		source += 2;
+		count -= 2;
+	}
+
+	// Copy and sum 32-bit words.  If the destination is only 16-bit 
+	// aligned, each word is stored as two halves.
+	val32 = (DWORD*)source;
+	if(!(((PTR_BASE)dest ^ (PTR_BASE)source) & 0x2u))
+	{
+		dst32 = (DWORD*)dest;
+		for(i = count >> 4; i; i--)
+		{
+			w0 = val32[0];
+			w1 = val32[1];
+			w2 = val32[2];
+			w3 = val32[3];
+			dst32[0] = w0;
+			sum.Val += w0;
+			dst32[1] = w1;
+			sum.Val += w1;
+			dst32[2] = w2;
+			sum.Val += w2;
+			dst32[3] = w3;
+			sum.Val += w3;
+			val32 += 4;
+			dst32 += 4;
+		}
+		for(i = (count >> 2) & 0x3u; i; i--)
+		{
+			w0 = *val32++;
+			*dst32++ = w0;
+			sum.Val += w0;
+		}
+		dest = (BYTE*)dst32;
+	}
+	else
+	{
+		dst = (WORD*)dest;
+		for(i = count >> 3; i; i--)
+		{
+			w0 = val32[0];
+			w1 = val32[1];
+			dst[0] = (WORD)w0;
+			dst[1] = (WORD)(w0 >> 16);
+			sum.Val += w0;
+			dst[2] = (WORD)w1;
+			dst[3] = (WORD)(w1 >> 16);
+			sum.Val += w1;
+			val32 += 2;
+			dst += 4;
+		}
+		if(count & 0x4u)
+		{
+			w0 = *val32++;
+			dst[0] = (WORD)w0;
+			dst[1] = (WORD)(w0 >> 16);
+			sum.Val += w0;
+			dst += 2;
+		}
+		dest = (BYTE*)dst;
+	}
+	source = (BYTE*)val32;
+	count &= 0x3u;
+#endif
+
+	// Copy and sum the (remaining) 16-bit words
+	val = (WORD*)source;
+	dst = (WORD*)dest;
+	for(i = count >> 3; i; i--)
+	{
+		w0 = val[0];
+		w1 = val[1];
+		w2 = val[2];
+		w3 = val[3];
+		dst[0] = w0;
+		dst[1] = w1;
+		dst[2] = w2;
+		dst[3] = w3;
+		sum.Val += (DWORD)(WORD)w0 + (DWORD)(WORD)w1 + (DWORD)(WORD)w2 + (DWORD)(WORD)w3;
+		val += 4;
+		dst += 4;
+	}
+	for(i = (count >> 1) & 0x3u; i; i--)
+	{
+		w0 = *val++;
+		*dst++ = w0;
+		sum.Val += (DWORD)(WORD)w0;
+	}
+
+	// Copy and add in the remaining byte, if present
+	if(count & 0x1u)
+	{
+		*(BYTE*)dst = *(BYTE*)val;
+		sum.Val += *(BYTE*)val;
+	}
+
+#if defined(__C32__) || defined(COMPILER_HOST_GCC)
+	// Fold the 64-bit sum to 32 bits
+	sum.Val = (QWORD)sum.d[0] + (QWORD)sum.d[1];
+	sum.d[0] += sum.d[1];
+#endif
+
+	// Do the end-around carries
+	sum.Val = (DWORD)sum.w[0] + (DWORD)sum.w[1];
+	sum.w[0] += sum.w[1];
+
+	// Undo the byte swap of an odd start address
+	if(bOdd)
+		sum.w[0] = swaps(sum.w[0]);
+
+	return ~sum.w[0];
+}
+
+/*****************************************************************************
+  Function:
+	WORD UpdateIPChecksum(WORD wChecksum, WORD wOld, WORD wNew)
+
+  Summary:
+	Updates an IP checksum for a changed word.
+
+  Description:
+	This function returns the checksum of data in which one 16-bit word was 
+	changed from wOld to wNew, given the checksum wChecksum of the original 
+	data, without summing the data again.  It uses equation 3 of RFC 1624, 
+	HC' = ~(~HC + ~m + m'), which never gives 0xFFFF for nonzero data.  To 
+	change several words, call it once per word.
+
+  Precondition:
+	None
+
+  Parameters:
+	wChecksum - checksum of the original data, as returned by 
+				CalcIPChecksum() or stored in a header
+	wOld	  - the word before the change
+	wNew	  - the word after the change
+
+  Returns:
+	The updated checksum.
+
+  Remarks:
+	The words must be in the byte order used to calculate wChecksum.
+  ***************************************************************************/
+WORD UpdateIPChecksum(WORD wChecksum, WORD wOld, WORD wNew)
+{
+	DWORD_VAL sum;
+
+	sum.Val = (DWORD)(WORD)~wChecksum + (DWORD)(WORD)~wOld + (DWORD)wNew;
+
+	// Do the end-around carries
+	sum.Val = (DWORD)sum.w[0] + (DWORD)sum.w[1];
+	sum.w[0] += sum.w[1];
+
+	return ~sum.w[0];
+}
+
 
 /*****************************************************************************
   Function:
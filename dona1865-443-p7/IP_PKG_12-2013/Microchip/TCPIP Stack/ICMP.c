@@ -50,6 +50,8 @@
  * Author               Date    	Comment
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  * Howard Schlunder		03/16/07	Original
+ *                      10/18/26	Echo reply checksum with
+ *								UpdateIPChecksum()
  ********************************************************************/
 #define __ICMP_C
 
@@ -149,14 +151,8 @@ void ICMPProcess(NODE_INFO *remote, WORD len)
 			return;
 	
 		// Calculate new Type, Code, and Checksum values
-		dwVal.v[0] = 0x00;	// Type: 0 (ICMP echo/ping reply)
-		dwVal.v[2] += 8;	// Subtract 0x0800 from the checksum
-		if(dwVal.v[2] < 8u)
-		{
-			dwVal.v[3]++;
-			if(dwVal.v[3] == 0u)
-				dwVal.v[2]++;
-		}
+		dwVal.w[0] = 0x0000;	// Type: 0 (ICMP echo/ping reply)
+		dwVal.w[1] = UpdateIPChecksum(dwVal.w[1], 0x0008, 0x0000);
 	
 	    // Wait for TX hardware to become available (finish transmitting 
 	    // any previous packet)
@@ -0,0 +1,624 @@
+/*********************************************************************
+ *
+ *	Inflate (Deflate Decompression) Library
+ *  Library for Microchip TCP/IP Stack
+ *	 - Decompresses deflate streams, such as gzip files in an MPFS2 
+ *     image, with a window of a chosen size
+ *   - Reference: RFC 1951, RFC 1952
+ *
+ *********************************************************************
+ * FileName:        Inflate.c
+ * Dependencies:    MPFS2.c
+ * Processor:       PIC18, PIC24F, PIC24H, dsPIC30F, dsPIC33F, PIC32
+ * Compiler:        Microchip C32 v1.05 or higher
+ *					Microchip C30 v3.12 or higher
+ *					Microchip C18 v3.30 or higher
+ *					HI-TECH PICC-18 PRO 9.63PL2 or higher
+ * Company:         Microchip Technology, Inc.
+ *
+ * Software License Agreement
+ *
+ * Copyright (C) 2002-2009 Microchip Technology Inc.  All rights
+ * reserved.
+ *
+ * Microchip licenses to you the right to use, modify, copy, and
+ * distribute:
+ * (i)  the Software when embedded on a Microchip microcontroller or
+ *      digital signal controller product ("Device") which is
+ *      integrated into Licensee's product; or
+ * (ii) ONLY the Software driver source files ENC28J60.c, ENC28J60.h,
+ *		ENCX24J600.c and ENCX24J600.h ported to a non-Microchip device
+ *		used in conjunction with a Microchip ethernet controller for
+ *		the sole purpose of interfacing with the ethernet controller.
+ *
+ * You should refer to the license agreement accompanying this
+ * Software for additional information regarding your rights and
+ * obligations.
+ *
+ * THE SOFTWARE AND DOCUMENTATION ARE PROVIDED "AS IS" WITHOUT
+ * WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION, ANY WARRANTY OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * MICROCHIP BE LIABLE FOR ANY INCIDENTAL, SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF
+ * PROCUREMENT OF SUBSTITUTE GOODS, TECHNOLOGY OR SERVICES, ANY CLAIMS
+ * BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY DEFENSE
+ * THEREOF), ANY CLAIMS FOR INDEMNITY OR CONTRIBUTION, OR OTHER
+ * SIMILAR COSTS, WHETHER ASSERTED ON THE BASIS OF CONTRACT, TORT
+ * (INCLUDING NEGLIGENCE), BREACH OF WARRANTY, OR OTHERWISE.
+ *
+ * IMPORTANT:  The implementation and use of third party algorithms, 
+ * specifications and/or other technology may require a license from 
+ * various third parties.  It is your responsibility to obtain 
+ * information regarding any applicable licensing obligations.
+ *
+ *
+ * Author               Date		Comment
+ *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *                      10/18/26    Original
+ ********************************************************************/
+#define __INFLATE_C
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(STACK_USE_INFLATE)
+
+/****************************************************************************
+  Section:
+	Deflate Code Tables
+  ***************************************************************************/
+
+// Base lengths and extra bits of length symbols 257 to 285
+static ROM WORD wLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static ROM BYTE vLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Base distances and extra bits of distance symbols 0 to 29
+static ROM WORD wDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static ROM BYTE vDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order in which a dynamic block lists the code lengths of the code 
+// length code
+static ROM BYTE vCodeOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+#define INFLATE_MAX_BITS	(15u)	// Longest Huffman code
+#define INFLATE_LIT_CODES	(288u)	// Literal/length symbols, including 2 unused
+#define INFLATE_DIST_CODES	(30u)	// Distance symbols
+
+static WORD _GetBits(INFLATE_CTX* ctx, BYTE n);
+static WORD _Decode(INFLATE_CTX* ctx, WORD* count, WORD* symbol);
+static BOOL _Build(WORD* count, WORD* symbol, BYTE* lengths, WORD n);
+static void _Fixed(INFLATE_CTX* ctx);
+static BOOL _Dynamic(INFLATE_CTX* ctx);
+
+/****************************************************************************
+  Section:
+	Function Implementations
+  ***************************************************************************/
+
+/*****************************************************************************
+  Function:
+	BOOL InflateGzipHeader(MPFS_HANDLE hFile)
+
+  Summary:
+	Reads past a gzip header.
+
+  Description:
+	Reads the gzip header at the current position of hFile, including any 
+	extra field, file name, comment and header CRC, so that the file is 
+	left at the start of the deflate data.
+
+  Precondition:
+	hFile is open at the start of a gzip file.
+
+  Parameters:
+	hFile - the file to read
+
+  Return Values:
+	TRUE - the header is valid and was read
+	FALSE - the file is not a deflate compressed gzip file
+  ***************************************************************************/
+BOOL InflateGzipHeader(MPFS_HANDLE hFile)
+{
+	BYTE header[10];
+	WORD wExtra;
+	BYTE c;
+
+	// ID1, ID2, CM (8 = deflate), FLG, MTIME, XFL, OS
+	if(MPFSGetArray(hFile, header, 10) != 10u || header[0] != 0x1fu || 
+		header[1] != 0x8bu || header[2] != 0x08u)
+		return FALSE;
+	
+	// FEXTRA
+	if(header[3] & 0x04)
+	{
+		if(MPFSGetArray(hFile, (BYTE*)&wExtra, 2) != 2u)
+			return FALSE;
+		if(!MPFSSeek(hFile, wExtra, MPFS_SEEK_FORWARD))
+			return FALSE;
+	}
+	
+	// FNAME, then FCOMMENT, are each null terminated
+	for(c = 0x08; c <= 0x10u; c <<= 1)
+	{
+		if(header[3] & c)
+		{
+			do
+			{
+				if(!MPFSGet(hFile, &header[0]))
+					return FALSE;
+			} while(header[0] != 0u);
+		}
+	}
+	
+	// FHCRC
+	if(header[3] & 0x02)
+		return MPFSSeek(hFile, 2, MPFS_SEEK_FORWARD);
+	
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	void InflateInit(INFLATE_CTX* ctx, MPFS_HANDLE hFile, BYTE* window, 
+						WORD wWindowLen)
+
+  Summary:
+	Starts decompressing a deflate stream.
+
+  Description:
+	Sets up ctx to decompress the deflate blocks that start at the current
+	position of hFile.  The window holds the latest output, which matches
+	copy from, so it limits how far back a match may reach.  Data that was
+	compressed with a larger window can still be decompressed if its 
+	matches do not reach further back than wWindowLen bytes.
+
+  Precondition:
+	hFile is open at the start of a deflate block.
+
+  Parameters:
+	ctx - the context to set up
+	hFile - the file to read the compressed data from
+	window - a buffer of wWindowLen bytes
+	wWindowLen - size of window, a power of 2
+
+  Returns:
+	None
+
+  Remarks:
+	A deflate stream can be started at any block that the compressor 
+	began with an empty history, such as after a full flush.  
+  ***************************************************************************/
+void InflateInit(INFLATE_CTX* ctx, MPFS_HANDLE hFile, BYTE* window, WORD wWindowLen)
+{
+	ctx->hFile = hFile;
+	ctx->vState = INFLATE_HEADER;
+	ctx->isLast = FALSE;
+	ctx->isEOF = FALSE;
+	ctx->vBits = 0;
+	ctx->dwBits = 0;
+	ctx->window = window;
+	ctx->wWindowMask = wWindowLen - 1;
+	ctx->wPos = 0;
+	ctx->wFull = 0;
+}
+
+/*****************************************************************************
+  Function:
+	WORD InflateGetArray(INFLATE_CTX* ctx, BYTE* cData, WORD wLen)
+
+  Summary:
+	Decompresses bytes from a deflate stream.
+
+  Description:
+	Decompresses up to wLen bytes.  The stream can be read in any 
+	number of calls, with the file position of ctx->hFile left to this
+	module in between.
+
+  Precondition:
+	InflateInit has been called on ctx.
+
+  Parameters:
+	ctx - the stream to read
+	cData - buffer for the output, or NULL to discard it
+	wLen - number of bytes to decompress
+
+  Returns:
+	The number of bytes decompressed.  This is less than wLen at the end
+	of the stream, or if the data is invalid.
+  ***************************************************************************/
+WORD InflateGetArray(INFLATE_CTX* ctx, BYTE* cData, WORD wLen)
+{
+	WORD wDone, w, sym;
+	BYTE c;
+
+	wDone = 0;
+	while(wDone < wLen)
+	{
+		// Bits past the end of the file are not part of the stream
+		if(ctx->isEOF)
+			ctx->vState = INFLATE_ERROR;
+
+		switch(ctx->vState)
+		{
+			case INFLATE_HEADER:
+				if(ctx->isLast)
+				{
+					ctx->vState = INFLATE_DONE;
+					break;
+				}
+				ctx->isLast = (BYTE)_GetBits(ctx, 1);
+				switch(_GetBits(ctx, 2))
+				{
+					case 0:
+						// Stored blocks start on a byte boundary with their
+						// length and its complement
+						ctx->dwBits >>= ctx->vBits & 0x07;
+						ctx->vBits &= ~0x07;
+						w = _GetBits(ctx, 16);
+						if(w != (WORD)~_GetBits(ctx, 16))
+						{
+							ctx->vState = INFLATE_ERROR;
+							break;
+						}
+						ctx->wLen = w;
+						if(w != 0u)
+							ctx->vState = INFLATE_STORED;
+						break;
+					case 1:
+						_Fixed(ctx);
+						ctx->vState = INFLATE_CODES;
+						break;
+					case 2:
+						ctx->vState = _Dynamic(ctx) ? INFLATE_CODES : INFLATE_ERROR;
+						break;
+					default:
+						ctx->vState = INFLATE_ERROR;
+						break;
+				}
+				break;
+
+			case INFLATE_STORED:
+				// Bytes are read straight from the file, except for any
+				// left in dwBits
+				if(ctx->vBits != 0u)
+					c = (BYTE)_GetBits(ctx, 8);
+				else if(!MPFSGet(ctx->hFile, &c))
+				{
+					ctx->isEOF = TRUE;
+					break;
+				}
+				ctx->window[ctx->wPos] = c;
+				ctx->wPos = (ctx->wPos + 1) & ctx->wWindowMask;
+				if(ctx->wFull <= ctx->wWindowMask)
+					ctx->wFull++;
+				if(cData)
+					*cData++ = c;
+				wDone++;
+				if(--ctx->wLen == 0u)
+					ctx->vState = INFLATE_HEADER;
+				break;
+
+			case INFLATE_CODES:
+				sym = _Decode(ctx, ctx->wLitCount, ctx->wLitSymbol);
+				if(sym < 256u)
+				{// Literal
+					c = (BYTE)sym;
+					ctx->window[ctx->wPos] = c;
+					ctx->wPos = (ctx->wPos + 1) & ctx->wWindowMask;
+					if(ctx->wFull <= ctx->wWindowMask)
+						ctx->wFull++;
+					if(cData)
+						*cData++ = c;
+					wDone++;
+					break;
+				}
+				if(sym == 256u)
+				{// End of block
+					ctx->vState = INFLATE_HEADER;
+					break;
+				}
+				
+				// A match: length, then distance
+				sym -= 257;
+				if(sym >= 29u)
+				{
+					ctx->vState = INFLATE_ERROR;
+					break;
+				}
+				ctx->wLen = wLengthBase[sym] + _GetBits(ctx, vLengthExtra[sym]);
+				sym = _Decode(ctx, ctx->wDistCount, ctx->wDistSymbol);
+				if(sym >= INFLATE_DIST_CODES)
+				{
+					ctx->vState = INFLATE_ERROR;
+					break;
+				}
+				ctx->wDist = wDistBase[sym] + _GetBits(ctx, vDistExtra[sym]);
+				
+				// The match must be within the output held in the window
+				ctx->vState = (ctx->wDist > ctx->wFull) ? INFLATE_ERROR : INFLATE_MATCH;
+				break;
+
+			case INFLATE_MATCH:
+				// Copy as much of the match as fits
+				w = wLen - wDone;
+				if(w > ctx->wLen)
+					w = ctx->wLen;
+				ctx->wLen -= w;
+				wDone += w;
+				if(ctx->wFull <= ctx->wWindowMask)
+				{
+					ctx->wFull += w;
+					if(ctx->wFull > ctx->wWindowMask)
+						ctx->wFull = ctx->wWindowMask + 1;
+				}
+				sym = (ctx->wPos - ctx->wDist) & ctx->wWindowMask;
+				while(w--)
+				{
+					c = ctx->window[sym];
+					sym = (sym + 1) & ctx->wWindowMask;
+					ctx->window[ctx->wPos] = c;
+					ctx->wPos = (ctx->wPos + 1) & ctx->wWindowMask;
+					if(cData)
+						*cData++ = c;
+				}
+				if(ctx->wLen == 0u)
+					ctx->vState = INFLATE_CODES;
+				break;
+
+			default:
+				// INFLATE_DONE or INFLATE_ERROR
+				return wDone;
+		}
+	}
+	
+	return wDone;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD _GetBits(INFLATE_CTX* ctx, BYTE n)
+
+  Description:
+	Reads n bits of the stream, LSB first.  Bytes are only read from the
+	file as they are needed, so that nothing after the stream is read.
+	
+  Precondition:
+	None
+
+  Parameters:
+	ctx - the stream to read
+	n - number of bits, 0 to 16
+
+  Returns:
+	The bits read.  If the file ends, ctx->isEOF is set and the missing 
+	bits are 0.
+  ***************************************************************************/
+static WORD _GetBits(INFLATE_CTX* ctx, BYTE n)
+{
+	WORD w;
+	BYTE c;
+	
+	while(ctx->vBits < n)
+	{
+		if(!MPFSGet(ctx->hFile, &c))
+		{
+			ctx->isEOF = TRUE;
+			c = 0;
+		}
+		ctx->dwBits |= (DWORD)c << ctx->vBits;
+		ctx->vBits += 8;
+	}
+	
+	w = (WORD)ctx->dwBits & (WORD)((1ul << n) - 1);
+	ctx->dwBits >>= n;
+	ctx->vBits -= n;
+	return w;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD _Decode(INFLATE_CTX* ctx, WORD* count, WORD* symbol)
+
+  Description:
+	Reads one Huffman coded symbol.  The code is read a bit at a time and
+	compared with the first code of each length, as the codes of one 
+	length are consecutive in a canonical Huffman code.
+	
+  Precondition:
+	count and symbol were set up by _Build.
+
+  Parameters:
+	ctx - the stream to read
+	count - number of codes of each length
+	symbol - symbols in code order
+
+  Returns:
+	The symbol, or 0xffff if the bits are not a code
+  ***************************************************************************/
+static WORD _Decode(INFLATE_CTX* ctx, WORD* count, WORD* symbol)
+{
+	WORD code, first, index;
+	BYTE len;
+
+	code = first = index = 0;
+	for(len = 1; len <= INFLATE_MAX_BITS; len++)
+	{
+		code |= _GetBits(ctx, 1);
+		if(code - first < count[len])
+			return symbol[index + (code - first)];
+		index += count[len];
+		first = (first + count[len]) << 1;
+		code <<= 1;
+	}
+	
+	return 0xffff;
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL _Build(WORD* count, WORD* symbol, BYTE* lengths, WORD n)
+
+  Description:
+	Sets up the tables of a canonical Huffman code from the code length
+	of each symbol.
+	
+  Precondition:
+	None
+
+  Parameters:
+	count - receives the number of codes of each length
+	symbol - receives the symbols in code order
+	lengths - code length of each symbol, 0 if it is not used
+	n - number of symbols
+
+  Return Values:
+	TRUE - the code is valid
+	FALSE - more codes have a length than the length allows
+  ***************************************************************************/
+static BOOL _Build(WORD* count, WORD* symbol, BYTE* lengths, WORD n)
+{
+	WORD offs[INFLATE_MAX_BITS+1];
+	SHORT left;
+	WORD i;
+
+	memset((void*)count, 0x00, (INFLATE_MAX_BITS+1)*sizeof(WORD));
+	for(i = 0; i < n; i++)
+		count[lengths[i]]++;
+	count[0] = 0;
+
+	// Each length doubles the codes left, and its codes use some of them
+	left = 1;
+	for(i = 1; i <= INFLATE_MAX_BITS; i++)
+	{
+		left <<= 1;
+		left -= count[i];
+		if(left < 0)
+			return FALSE;
+	}
+
+	// Sort the symbols by length, then by value
+	offs[1] = 0;
+	for(i = 1; i < INFLATE_MAX_BITS; i++)
+		offs[i+1] = offs[i] + count[i];
+	for(i = 0; i < n; i++)
+	{
+		if(lengths[i] != 0u)
+			symbol[offs[lengths[i]]++] = i;
+	}
+	
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	static void _Fixed(INFLATE_CTX* ctx)
+
+  Description:
+	Sets up the fixed Huffman codes of a block of type 1.
+	
+  Precondition:
+	None
+
+  Parameters:
+	ctx - the stream being read
+
+  Returns:
+	None
+  ***************************************************************************/
+static void _Fixed(INFLATE_CTX* ctx)
+{
+	BYTE lengths[INFLATE_LIT_CODES];
+	WORD i;
+
+	for(i = 0; i < 144u; i++)
+		lengths[i] = 8;
+	for(; i < 256u; i++)
+		lengths[i] = 9;
+	for(; i < 280u; i++)
+		lengths[i] = 7;
+	for(; i < INFLATE_LIT_CODES; i++)
+		lengths[i] = 8;
+	_Build(ctx->wLitCount, ctx->wLitSymbol, lengths, INFLATE_LIT_CODES);
+
+	memset((void*)lengths, 5, INFLATE_DIST_CODES);
+	_Build(ctx->wDistCount, ctx->wDistSymbol, lengths, INFLATE_DIST_CODES);
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL _Dynamic(INFLATE_CTX* ctx)
+
+  Description:
+	Reads the Huffman codes at the start of a block of type 2.  The code
+	lengths are themselves Huffman coded, with a code whose tables are 
+	kept in the literal/length tables until the lengths have been read.
+	
+  Precondition:
+	The block type has been read.
+
+  Parameters:
+	ctx - the stream being read
+
+  Return Values:
+	TRUE - the codes were read
+	FALSE - the codes are invalid
+  ***************************************************************************/
+static BOOL _Dynamic(INFLATE_CTX* ctx)
+{
+	BYTE lengths[INFLATE_LIT_CODES + INFLATE_DIST_CODES];
+	WORD nlen, ndist, ncode, i, sym, rep;
+	BYTE c;
+
+	nlen = _GetBits(ctx, 5) + 257;
+	ndist = _GetBits(ctx, 5) + 1;
+	ncode = _GetBits(ctx, 4) + 4;
+	if(nlen > 286u || ndist > INFLATE_DIST_CODES)
+		return FALSE;
+
+	// Code length code
+	memset((void*)lengths, 0x00, 19);
+	for(i = 0; i < ncode; i++)
+		lengths[vCodeOrder[i]] = (BYTE)_GetBits(ctx, 3);
+	if(!_Build(ctx->wLitCount, ctx->wLitSymbol, lengths, 19))
+		return FALSE;
+
+	// Literal/length and distance code lengths, as one sequence
+	for(i = 0; i < nlen + ndist; )
+	{
+		sym = _Decode(ctx, ctx->wLitCount, ctx->wLitSymbol);
+		if(sym < 16u)
+		{
+			lengths[i++] = (BYTE)sym;
+			continue;
+		}
+		
+		// Repeat the previous length, or 0
+		c = 0;
+		if(sym == 16u)
+		{
+			if(i == 0u)
+				return FALSE;
+			c = lengths[i-1];
+			rep = 3 + _GetBits(ctx, 2);
+		}
+		else if(sym == 17u)
+			rep = 3 + _GetBits(ctx, 3);
+		else if(sym == 18u)
+			rep = 11 + _GetBits(ctx, 7);
+		else
+			return FALSE;
+		if(i + rep > nlen + ndist)
+			return FALSE;
+		while(rep--)
+			lengths[i++] = c;
+	}
+
+	// A block must be able to end
+	if(lengths[256] == 0u)
+		return FALSE;
+
+	return _Build(ctx->wLitCount, ctx->wLitSymbol, lengths, nlen) &&
+		_Build(ctx->wDistCount, ctx->wDistSymbol, &lengths[nlen], ndist);
+}
+
+#endif //#if defined(STACK_USE_INFLATE)
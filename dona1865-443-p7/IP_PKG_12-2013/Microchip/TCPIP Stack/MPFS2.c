@@ -52,6 +52,11 @@
  *~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  * Elliott Wood			07/2007		Complete rewrite as MPFS2
  * E. Wood				04/2008		Updated as MPFS2.1
+ *                      10/18/26    Host build support
+ *                      10/18/26    Dynamic variable lengths in the index
+ *                      10/18/26    MPFS2.2 sorted hash index, binary search
+ *                      10/18/26    Index of deflate blocks for GZIP files
+ *                      10/18/26    Read cache for EEPROM and SPI Flash
  ********************************************************************/
 #define __MPFS2_C
 
@@ -67,6 +72,7 @@
  *     [M][P][F][S]
  *     [BYTE Ver Hi][BYTE Ver Lo][WORD Number of Files]
  *     [Name Hash 0][Name Hash 1]...[Name Hash N]
+ *     [File ID 0][File ID 1]...[File ID N]          (2.2 only)
  *     [File Record 0][File Record 1]...[File Record N]
  *     [String 0][String 1]...[String N]
  *     [File Data 0][File Data 1]...[File Data N]
@@ -80,6 +86,20 @@
  *     Technically this means the hash only includes the 
  *     final 15 characters of a name.
  *
+ * Sorted Index (2.2):
+ *     The name hashes are sorted in ascending order, and each is
+ *     followed in the File ID list by the WORD number of its file.
+ *     File records, strings and data stay in file order, so an
+ *     index file is still the file after the one it belongs to.
+ *     The name hash covers the whole path:
+ *         hash = 0
+ *         for each(byte in name)
+ *             hash = hash*31 + byte
+ *     so that files of the same name in different directories
+ *     do not collide, and MPFSOpen finds a name with a binary 
+ *     search rather than reading every hash.  Index files have
+ *     no name and the hash 0xffff in both versions.
+ *
  * File Record Structure (22 bytes):
  *     [DWORD String Ptr][DWORD Data Ptr]
  *     [DWORD Len][DWORD Timestamp][DWORD Microtime]
@@ -97,15 +117,44 @@
  *
  * Unlike previous versions, there are no delimiters.
  *
- * Name hash is calculated as follows:
+ * Name hash (2.1) is calculated as follows:
  *      hash = 0
  *      for each(byte in name)
  *          hash += byte, hash <<= 1
  *
  * When a file has an index, that index file has no file name,
  * but is accessible as the file immediately following in the image.
+ * It holds one record per dynamic variable, in file order:
+ *     [DWORD Offset][DWORD Callback ID]
+ * or, if the file has MPFS2_FLAG_HASVARLEN:
+ *     [DWORD Offset][DWORD Length][DWORD Callback ID]
+ * Length includes both '~' delimiters of the variable.
+ *
+ * A GZIP file with MPFS2_FLAG_HASBLOCKS is instead followed by an
+ * index of its deflate blocks:
+ *     [DWORD Block Length][DWORD Offset 0]...[DWORD Offset N]
+ * Each block holds Block Length bytes of uncompressed data, except
+ * perhaps the last, and starts at a byte aligned Offset within the 
+ * GZIP file with no reference to earlier data (a full flush), so 
+ * decompression can begin at any block.  Block 0 is the first after
+ * the GZIP header.  Files with dynamic variables are not compressed,
+ * so a file has either kind of index but not both.
  *
- * Current version is 2.1
+ * Current version is 2.2.  Version 2.1 images, whose hashes are in
+ * file order, are still read with a linear search.
+ *
+ * Read Cache (MPFS_USE_CACHE):
+ *     Each EEPROM or SPI Flash read sends a command and a 2 to 3 byte
+ *     address before the data, so MPFSGet() and the 2 to 22 byte reads
+ *     of hashes, FAT records and index entries spend most of the bus
+ *     time on overhead.  Reads shorter than MPFS_CACHE_PAGE_SIZE are
+ *     copied from MPFS_CACHE_PAGES pages aligned in the image, and a
+ *     missing page is read whole, which reads ahead of the caller for
+ *     the next MPFSGet() or record.  The least recently used page is
+ *     replaced.  Longer reads, such as the file data TCPPutMPFS()
+ *     sends, go to the storage in one transaction and leave the pages
+ *     alone.  The image is only written between MPFSFormat() and 
+ *     MPFSPutEnd(), which drop the pages.
  */
 
 /****************************************************************************
@@ -129,9 +178,34 @@ static WORD fatCacheID;
 // Number of files in this MPFS image
 static WORD numFiles;
 
+// TRUE if this is an MPFS2.2 image, whose name hashes are sorted
+static BOOL isSorted;
+
+#if defined(MPFS_USE_CACHE)
+	// Read cache pages.  A page is empty when its addr is MPFS_INVALID.
+	static struct
+	{
+		MPFS_PTR addr;		// Image address of the page, a multiple of MPFS_CACHE_PAGE_SIZE
+		BYTE vAge;			// Number of other pages used since this one
+		BYTE data[MPFS_CACHE_PAGE_SIZE];
+	} MPFSCache[MPFS_CACHE_PAGES];
+
+	// Read cache counters
+	static MPFS_CACHE_STATS MPFSCacheStats;
+
+	static void _CacheRead(MPFS_PTR addr, BYTE* cData, WORD wLen);
+	static void _CacheInvalidate(void);
+#endif
+
 
 static void _LoadFATRecord(WORD fatID);
 static void _Validate(void);
+static WORD _ReadWord(MPFS_PTR addr);
+static WORD _SearchHash(WORD nameHash);
+
+// Address of the file ID list and the FAT records in the image
+#define MPFS_ID_BASE		(8ul + (DWORD)numFiles*2ul)
+#define MPFS_FAT_BASE		(isSorted ? 8ul + (DWORD)numFiles*4ul : MPFS_ID_BASE)
 
 /****************************************************************************
   Section:
@@ -147,16 +221,27 @@ static void _Validate(void);
 	// data overhead to switch locations.
 	MPFS_PTR lastRead;
 
+	// Reads an array from the storage
+	#define _ReadStorage(a,c,l)	XEEReadArray((a)+MPFS_HEAD, (c), (l))
+
 
 #elif defined(MPFS_USE_SPI_FLASH)
 
 	// Beginning address of MPFS Image
 	#define MPFS_HEAD		MPFS_RESERVE_BLOCK
+
+	// Reads an array from the storage
+	#define _ReadStorage(a,c,l)	SPIFlashReadArray((a)+MPFS_HEAD, (c), (l))
 	
 #else
 
-	// An address where MPFS data starts in program memory.
-    #if defined(__18CXX) || defined(__C32__)
+	// An address where MPFS data starts in program memory.  The host 
+	// build reads an image in RAM, which may lie above 4 GB on an LP64
+	// host, so the address is kept at pointer width.
+    #if defined(COMPILER_HOST_GCC)
+  		extern ROM BYTE MPFS_Start[];
+	    #define MPFS_HEAD		((DWORD_PTR_BASE)(&MPFS_Start[0]))
+    #elif defined(__18CXX) || defined(__C32__)
   		extern ROM BYTE MPFS_Start[];
 	    #define MPFS_HEAD		((DWORD)(&MPFS_Start[0]))
     #else
@@ -214,6 +299,11 @@ void MPFSInit(void)
 	SPIFlashInit();
 	#endif
 
+	#if defined(MPFS_USE_CACHE)
+	_CacheInvalidate();
+	MPFSClearCacheStats();
+	#endif
+
 	// Validate the image and load numFiles
 	_Validate();
 
@@ -242,11 +332,16 @@ void MPFSInit(void)
   Returns:
 	An MPFS_HANDLE to the opened file if found, or MPFS_INVALID_HANDLE
 	if the file could not be found or no free handles exist.
+
+  Remarks:
+	Names are full paths within the image, such as "dir/sub/file.htm".
+	An MPFS2.2 image is searched in O(log n) reads of the hash list, and
+	an MPFS2.1 image in O(n).
   ***************************************************************************/
 MPFS_HANDLE MPFSOpen(BYTE* cFile)
 {
 	MPFS_HANDLE hMPFS;
-	WORD nameHash, i;
+	WORD nameHash, i, fatID;
 	WORD hashCache[8];
 	BYTE *ptr, c;
 	
@@ -260,8 +355,15 @@ MPFS_HANDLE MPFSOpen(BYTE* cFile)
 	// Calculate the name hash to speed up searching
 	for(nameHash = 0, ptr = cFile; *ptr != '\0'; ptr++)
 	{
-		nameHash += *ptr;
-		nameHash <<= 1;
+		if(isSorted)
+		{
+			nameHash = (nameHash << 5) - nameHash + *ptr;
+		}
+		else
+		{
+			nameHash += *ptr;
+			nameHash <<= 1;
+		}
 	}
 	
 	// Find a free file handle to use
@@ -271,41 +373,55 @@ MPFS_HANDLE MPFSOpen(BYTE* cFile)
 	if(hMPFS == MAX_MPFS_HANDLES)
 		return MPFS_INVALID_HANDLE;
 		
-	// Read in hashes, and check remainder on a match.  Store 8 in cache for performance
-	for(i = 0; i < numFiles; i++)
+	// Sorted hashes are binary searched for the first match, and older 
+	// images are searched from the start
+	i = isSorted ? _SearchHash(nameHash) : 0;
+		
+	// Read in hashes, and check remainder on a match
+	for(; i < numFiles; i++)
 	{
-		// For new block of 8, read in data
-		if((i & 0x07) == 0u)
+		if(isSorted)
 		{
-			MPFSStubs[0].addr = 8 + i*2;
-			MPFSStubs[0].bytesRem = 16;
-			MPFSGetArray(0, (BYTE*)hashCache, 16);
+			// The matches are adjacent, so stop at the first other hash
+			if(_ReadWord(8 + (DWORD)i*2) != nameHash)
+				break;
+			fatID = _ReadWord(MPFS_ID_BASE + (DWORD)i*2);
 		}
-		
-		// If the hash matches, compare the full filename
-		if(hashCache[i&0x07] == nameHash)
+		else
 		{
-			_LoadFATRecord(i);
-			MPFSStubs[0].addr = fatCache.string;
-			MPFSStubs[0].bytesRem = 255;
-			
-			// Loop over filename to perform comparison
-			for(ptr = cFile; *ptr != '\0'; ptr++)
+			// For new block of 8, read in data.  Store 8 in cache for performance
+			if((i & 0x07) == 0u)
 			{
-				MPFSGet(0, &c);
-				if(*ptr != c)
-					break;
+				MPFSStubs[0].addr = 8 + i*2;
+				MPFSStubs[0].bytesRem = 16;
+				MPFSGetArray(0, (BYTE*)hashCache, 16);
 			}
-			
+			if(hashCache[i&0x07] != nameHash)
+				continue;
+			fatID = i;
+		}
+		
+		// The hash matches, so compare the full filename
+		_LoadFATRecord(fatID);
+		MPFSStubs[0].addr = fatCache.string;
+		MPFSStubs[0].bytesRem = 255;
+		
+		// Loop over filename to perform comparison
+		for(ptr = cFile; *ptr != '\0'; ptr++)
+		{
 			MPFSGet(0, &c);
-
-			if(c == '\0' && *ptr == '\0')
-			{// Filename matches, so return true
-				MPFSStubs[hMPFS].addr = fatCache.data;
-				MPFSStubs[hMPFS].bytesRem = fatCache.len;
-				MPFSStubs[hMPFS].fatID = i;
-				return hMPFS;
-			}
+			if(*ptr != c)
+				break;
+		}
+		
+		MPFSGet(0, &c);
+
+		if(c == '\0' && *ptr == '\0')
+		{// Filename matches, so return true
+			MPFSStubs[hMPFS].addr = fatCache.data;
+			MPFSStubs[hMPFS].bytesRem = fatCache.len;
+			MPFSStubs[hMPFS].fatID = fatID;
+			return hMPFS;
 		}
 	}
 	
@@ -337,7 +453,7 @@ MPFS_HANDLE MPFSOpen(BYTE* cFile)
 MPFS_HANDLE MPFSOpenROM(ROM BYTE* cFile) 
 {
 	MPFS_HANDLE hMPFS;
-	WORD nameHash, i;
+	WORD nameHash, i, fatID;
 	WORD hashCache[8];
 	ROM BYTE *ptr;
 	BYTE c;
@@ -349,8 +465,15 @@ MPFS_HANDLE MPFSOpenROM(ROM BYTE* cFile)
 	// Calculate the name hash to speed up searching
 	for(nameHash = 0, ptr = cFile; *ptr != '\0'; ptr++)
 	{
-		nameHash += *ptr;
-		nameHash <<= 1;
+		if(isSorted)
+		{
+			nameHash = (nameHash << 5) - nameHash + *ptr;
+		}
+		else
+		{
+			nameHash += *ptr;
+			nameHash <<= 1;
+		}
 	}
 	
 	// Find a free file handle to use
@@ -360,41 +483,55 @@ MPFS_HANDLE MPFSOpenROM(ROM BYTE* cFile)
 	if(hMPFS == MAX_MPFS_HANDLES)
 		return MPFS_INVALID_HANDLE;
 		
-	// Read in hashes, and check remainder on a match.  Store 8 in cache for performance
-	for(i = 0; i < numFiles; i++)
+	// Sorted hashes are binary searched for the first match, and older 
+	// images are searched from the start
+	i = isSorted ? _SearchHash(nameHash) : 0;
+		
+	// Read in hashes, and check remainder on a match
+	for(; i < numFiles; i++)
 	{
-		// For new block of 8, read in data
-		if((i & 0x07) == 0u)
+		if(isSorted)
 		{
-			MPFSStubs[0].addr = 8 + i*2;
-			MPFSStubs[0].bytesRem = 16;
-			MPFSGetArray(0, (BYTE*)hashCache, 16);
+			// The matches are adjacent, so stop at the first other hash
+			if(_ReadWord(8 + (DWORD)i*2) != nameHash)
+				break;
+			fatID = _ReadWord(MPFS_ID_BASE + (DWORD)i*2);
 		}
-		
-		// If the hash matches, compare the full filename
-		if(hashCache[i&0x07] == nameHash)
+		else
 		{
-			_LoadFATRecord(i);
-			MPFSStubs[0].addr = fatCache.string;
-			MPFSStubs[0].bytesRem = 255;
-			
-			// Loop over filename to perform comparison
-			for(ptr = cFile; *ptr != '\0'; ptr++)
+			// For new block of 8, read in data.  Store 8 in cache for performance
+			if((i & 0x07) == 0u)
 			{
-				MPFSGet(0, &c);
-				if(*ptr != c)
-					break;
+				MPFSStubs[0].addr = 8 + i*2;
+				MPFSStubs[0].bytesRem = 16;
+				MPFSGetArray(0, (BYTE*)hashCache, 16);
 			}
-			
+			if(hashCache[i&0x07] != nameHash)
+				continue;
+			fatID = i;
+		}
+		
+		// The hash matches, so compare the full filename
+		_LoadFATRecord(fatID);
+		MPFSStubs[0].addr = fatCache.string;
+		MPFSStubs[0].bytesRem = 255;
+		
+		// Loop over filename to perform comparison
+		for(ptr = cFile; *ptr != '\0'; ptr++)
+		{
 			MPFSGet(0, &c);
-
-			if(c == '\0' && *ptr == '\0')
-			{// Filename matches, so return true
-				MPFSStubs[hMPFS].addr = fatCache.data;
-				MPFSStubs[hMPFS].bytesRem = fatCache.len;
-				MPFSStubs[hMPFS].fatID = i;
-				return hMPFS;
-			}
+			if(*ptr != c)
+				break;
+		}
+		
+		MPFSGet(0, &c);
+
+		if(c == '\0' && *ptr == '\0')
+		{// Filename matches, so return true
+			MPFSStubs[hMPFS].addr = fatCache.data;
+			MPFSStubs[hMPFS].bytesRem = fatCache.len;
+			MPFSStubs[hMPFS].fatID = fatID;
+			return hMPFS;
 		}
 	}
 	
@@ -519,8 +656,12 @@ BOOL MPFSGet(MPFS_HANDLE hMPFS, BYTE* c)
 	}
 
 
+    #if defined(MPFS_USE_CACHE)
+		// Read through the page cache
+		_CacheRead(MPFSStubs[hMPFS].addr, c, 1);
+		MPFSStubs[hMPFS].addr++;
     // Read function for EEPROM
-    #if defined(MPFS_USE_EEPROM)
+    #elif defined(MPFS_USE_EEPROM)
 	    // For performance, cache the last read address
 		if(MPFSStubs[hMPFS].addr != lastRead+1)
 			XEEBeginRead(MPFSStubs[hMPFS].addr + MPFS_HEAD);
@@ -571,7 +712,7 @@ BOOL MPFSGet(MPFS_HANDLE hMPFS, BYTE* c)
 		}
 		#else
 		{
-			DWORD dwHITECHWorkaround = MPFS_HEAD;
+			DWORD_PTR_BASE dwHITECHWorkaround = MPFS_HEAD;
 	  	*c = *((ROM BYTE*)(MPFSStubs[hMPFS].addr+dwHITECHWorkaround));
 		    MPFSStubs[hMPFS].addr++;
 		}
@@ -623,7 +764,11 @@ WORD MPFSGetArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen)
 	}
 	
 	// Read the data
-	#if defined(MPFS_USE_EEPROM)
+	#if defined(MPFS_USE_CACHE)
+		_CacheRead(MPFSStubs[hMPFS].addr, cData, wLen);
+		MPFSStubs[hMPFS].addr += wLen;
+		MPFSStubs[hMPFS].bytesRem -= wLen;
+	#elif defined(MPFS_USE_EEPROM)
 		XEEReadArray(MPFSStubs[hMPFS].addr+MPFS_HEAD, cData, wLen);
 		MPFSStubs[hMPFS].addr += wLen;
 		MPFSStubs[hMPFS].bytesRem -= wLen;
@@ -690,7 +835,7 @@ WORD MPFSGetArray(MPFS_HANDLE hMPFS, BYTE* cData, WORD wLen)
 		}
 		#else
 		{
-			DWORD dwHITECHWorkaround = MPFS_HEAD;
+			DWORD_PTR_BASE dwHITECHWorkaround = MPFS_HEAD;
 			memcpypgm2ram(cData, (ROM void*)(MPFSStubs[hMPFS].addr + dwHITECHWorkaround), wLen);
 			MPFSStubs[hMPFS].addr += wLen;
 			MPFSStubs[hMPFS].bytesRem -= wLen;
@@ -844,6 +989,11 @@ MPFS_HANDLE MPFSFormat(void)
 	
 	// Lock the image
 	isMPFSLocked = TRUE;
+
+	#if defined(MPFS_USE_CACHE)
+		// The cached pages are about to be overwritten
+		_CacheInvalidate();
+	#endif
 	
 	#if defined(MPFS_USE_EEPROM)
 		// Set FAT ptr for writing
@@ -946,6 +1096,11 @@ void MPFSPutEnd(BOOL final)
 	    XEEEndWrite();
     	while(XEEIsBusy());
     #endif
+
+	#if defined(MPFS_USE_CACHE)
+		// Drop any page read while the image was being written
+		_CacheInvalidate();
+	#endif
     
 	if(final)
 		_Validate();
@@ -984,7 +1139,7 @@ static void _LoadFATRecord(WORD fatID)
 	
 	// Read the FAT record to the cache
 	MPFSStubs[0].bytesRem = 22;
-	MPFSStubs[0].addr = 8 + numFiles*2 + fatID*22;
+	MPFSStubs[0].addr = MPFS_FAT_BASE + fatID*22;
 	MPFSGetArray(0, (BYTE*)&fatCache, 22);
 	fatCacheID = fatID;
 }
@@ -1323,10 +1478,275 @@ static void _Validate(void)
 	MPFSStubs[0].addr = 0;
 	MPFSStubs[0].bytesRem = 8;
 	MPFSGetArray(0, (BYTE*)&fatCache, 6);
-	if(!memcmppgm2ram((void*)&fatCache, (ROM void*)"MPFS\x02\x01", 6))
+	isSorted = !memcmppgm2ram((void*)&fatCache, (ROM void*)"MPFS\x02\x02", 6);
+	if(isSorted || !memcmppgm2ram((void*)&fatCache, (ROM void*)"MPFS\x02\x01", 6))
 		MPFSGetArray(0, (BYTE*)&numFiles, 2);
 	else
 		numFiles = 0;
 	fatCacheID = MPFS_INVALID_FAT;
 }	
+
+/*****************************************************************************
+  Function:
+	static WORD _ReadWord(MPFS_PTR addr)
+
+  Description:
+	Reads a WORD from the hash or file ID list of the image.
+	
+  Precondition:
+	None
+
+  Parameters:
+	addr - the address of the WORD in the image
+
+  Returns:
+	The WORD at addr
+  ***************************************************************************/
+static WORD _ReadWord(MPFS_PTR addr)
+{
+	WORD w;
+	
+	MPFSStubs[0].addr = addr;
+	MPFSStubs[0].bytesRem = 2;
+	MPFSGetArray(0, (BYTE*)&w, 2);
+	return w;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD _SearchHash(WORD nameHash)
+
+  Summary:
+	Finds a name hash in the sorted hash list.
+
+  Description:
+	Binary searches the sorted name hashes of an MPFS2.2 image for the 
+	first one that is not less than nameHash.
+	
+  Precondition:
+	isSorted is TRUE
+
+  Parameters:
+	nameHash - the name hash to find
+
+  Returns:
+	The position of that hash in the list, or numFiles if all hashes
+	are less than nameHash.
+	
+  Remarks:
+	Several files may share a hash.  They follow the returned position.
+  ***************************************************************************/
+static WORD _SearchHash(WORD nameHash)
+{
+	WORD lo, hi, mid;
+	WORD hashCache[8];
+	
+	lo = 0;
+	hi = numFiles;
+	while(hi - lo > 8u)
+	{
+		mid = lo + ((hi - lo) >> 1);
+		if(_ReadWord(8 + (DWORD)mid*2) < nameHash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	
+	// Read the last 8 or fewer hashes at once
+	MPFSStubs[0].addr = 8 + (DWORD)lo*2;
+	MPFSStubs[0].bytesRem = (hi - lo)*2;
+	MPFSGetArray(0, (BYTE*)hashCache, (hi - lo)*2);
+	for(mid = 0; lo < hi; lo++, mid++)
+	{
+		if(hashCache[mid] >= nameHash)
+			break;
+	}
+	return lo;
+}
+
+/****************************************************************************
+  Section:
+	Read Cache
+  ***************************************************************************/
+#if defined(MPFS_USE_CACHE)
+
+/*****************************************************************************
+  Function:
+	void MPFSGetCacheStats(MPFS_CACHE_STATS* pStats)
+
+  Description:
+	Copies the read cache counters.
+	
+  Precondition:
+	MPFSInit has been called
+
+  Parameters:
+	pStats - where to store the counters
+
+  Returns:
+	None
+
+  Remarks:
+	The hit rate of short reads is dwHits / (dwHits + dwMisses).  Without
+	the cache the storage would have been read dwHits + dwMisses + 
+	dwBypasses times for dwBytesServed bytes.
+  ***************************************************************************/
+void MPFSGetCacheStats(MPFS_CACHE_STATS* pStats)
+{
+	memcpy((void*)pStats, (void*)&MPFSCacheStats, sizeof(MPFS_CACHE_STATS));
+}
+
+/*****************************************************************************
+  Function:
+	void MPFSClearCacheStats(void)
+
+  Description:
+	Resets the read cache counters to 0.
+	
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+void MPFSClearCacheStats(void)
+{
+	memset((void*)&MPFSCacheStats, 0x00, sizeof(MPFSCacheStats));
+}
+
+/*****************************************************************************
+  Function:
+	static void _CacheInvalidate(void)
+
+  Description:
+	Empties every page of the read cache.
+	
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+	None
+
+  Remarks:
+	The ages stay distinct, from 0 to MPFS_CACHE_PAGES-1, as _CacheRead
+	expects.
+  ***************************************************************************/
+static void _CacheInvalidate(void)
+{
+	BYTE i;
+	
+	for(i = 0; i < MPFS_CACHE_PAGES; i++)
+	{
+		MPFSCache[i].addr = MPFS_INVALID;
+		MPFSCache[i].vAge = i;
+	}
+}
+
+/*****************************************************************************
+  Function:
+	static void _CacheRead(MPFS_PTR addr, BYTE* cData, WORD wLen)
+
+  Summary:
+	Reads an array of bytes from the image through the read cache.
+
+  Description:
+	Reads of MPFS_CACHE_PAGE_SIZE bytes or more are sent to the storage 
+	as they are.  Shorter reads are copied from the one or two pages they
+	cover, loading each missing page over the least recently used one.
+	
+  Precondition:
+	_CacheInvalidate has been called
+
+  Parameters:
+	addr - the address in the image to read from
+	cData - where to store the bytes
+	wLen - how many bytes to read
+
+  Returns:
+	None
+
+  Remarks:
+	A page may extend past the end of the image.  The bytes there are 
+	read from the storage but never returned.
+  ***************************************************************************/
+static void _CacheRead(MPFS_PTR addr, BYTE* cData, WORD wLen)
+{
+	MPFS_PTR page;
+	WORD wOffset, wChunk;
+	BYTE i, vOldest, vAge;
+	BOOL isMiss;
+
+	MPFSCacheStats.dwBytesServed += wLen;
+
+	// Long reads gain nothing from the pages and would evict them
+	if(wLen >= MPFS_CACHE_PAGE_SIZE)
+	{
+		MPFSCacheStats.dwBypasses++;
+		MPFSCacheStats.dwReads++;
+		MPFSCacheStats.dwBytesRead += wLen;
+		_ReadStorage(addr, cData, wLen);
+		return;
+	}
+
+	isMiss = FALSE;
+	while(wLen)
+	{
+		page = addr & ~(MPFS_PTR)(MPFS_CACHE_PAGE_SIZE-1);
+		wOffset = (WORD)(addr - page);
+		wChunk = MPFS_CACHE_PAGE_SIZE - wOffset;
+		if(wChunk > wLen)
+			wChunk = wLen;
+
+		// Find the page, noting the oldest one in case it is missing
+		vOldest = 0;
+		for(i = 0; i < MPFS_CACHE_PAGES; i++)
+		{
+			if(MPFSCache[i].addr == page)
+				break;
+			if(MPFSCache[i].vAge > MPFSCache[vOldest].vAge)
+				vOldest = i;
+		}
+		
+		if(i == MPFS_CACHE_PAGES)
+		{
+			i = vOldest;
+			MPFSCache[i].addr = page;
+			_ReadStorage(page, MPFSCache[i].data, MPFS_CACHE_PAGE_SIZE);
+			MPFSCacheStats.dwReads++;
+			MPFSCacheStats.dwBytesRead += MPFS_CACHE_PAGE_SIZE;
+			isMiss = TRUE;
+		}
+
+		// Make this page the most recently used, unless it already is,
+		// as for a run of MPFSGet() calls
+		vAge = MPFSCache[i].vAge;
+		if(vAge != 0u)
+		{
+			for(vOldest = 0; vOldest < MPFS_CACHE_PAGES; vOldest++)
+			{
+				if(MPFSCache[vOldest].vAge < vAge)
+					MPFSCache[vOldest].vAge++;
+			}
+			MPFSCache[i].vAge = 0;
+		}
+
+		memcpy((void*)cData, (void*)&MPFSCache[i].data[wOffset], wChunk);
+		cData += wChunk;
+		addr += wChunk;
+		wLen -= wChunk;
+	}
+	
+	if(isMiss)
+		MPFSCacheStats.dwMisses++;
+	else
+		MPFSCacheStats.dwHits++;
+}
+#endif
+
 #endif //#if defined(STACK_USE_MPFS2)
@@ -184,7 +184,7 @@ void SNTPClient(void)
 	{
 		case SM_HOME:
 			if(MySocket == INVALID_UDP_SOCKET)
-				MySocket = UDPOpenEx((DWORD)(PTR_BASE)NTP_SERVER,UDP_OPEN_ROM_HOST,0,NTP_SERVER_PORT);
+				MySocket = UDPOpenEx((DWORD_PTR_BASE)(PTR_BASE)NTP_SERVER,UDP_OPEN_ROM_HOST,0,NTP_SERVER_PORT);
 			
 			SNTPState++;
 			break;
@@ -0,0 +1,270 @@
+/*********************************************************************
+ *
+ *     SPI Flash Memory Driver (host file) for Microchip TCP/IP Stack
+ *
+ *********************************************************************
+ * FileName:        SPIFlashHost.c
+ * Dependencies:    SPIFlash.h
+ *
+ * Processor:       Linux host
+ *
+ * Compiler:        GCC
+ *
+ * Replaces SPIFlash.c in the host build.  The device is a file of
+ * HOST_SPIFLASH_SIZE bytes, named by the HOST_SPIFLASH_FILE environment
+ * variable (default HOST_SPIFLASH_NAME), and behaves as an SST25 part:
+ * writing the first byte of a sector erases the sector, erased bytes
+ * read 0xFF and programming can only clear bits.  Bytes past the end of
+ * a shorter file read as erased, so an MPFS image written by the MPFS2
+ * utility can be used as is.  Every transaction is counted in
+ * SPIFlashHostStats.
+ *
+********************************************************************/
+#define __SPIFLASH_C
+
+#include "HardwareProfile.h"
+#include "TCPIP Stack/TCPIP.h"
+#include "TCPIP Stack/SPIFlash.h"
+
+
+// Compile only for the GCC host build
+#if defined(COMPILER_HOST_GCC)
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+SPI_FLASH_HOST_STATS SPIFlashHostStats;
+
+static int _flashFd = -1;			// Device file
+static DWORD _dwWriteAddr;			// Next address for SPIFlashWrite()
+
+
+/****************************************************************************
+ * Function:        void SPIFlashInit(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Opens the device file and clears SPIFlashHostStats.
+ *
+ * Overview:        This function opens the file named by HOST_SPIFLASH_FILE,
+ *                  creating it if needed.
+ *
+ * Note:            If the file cannot be opened, the reason is printed to
+ *                  stderr, reads return 0xFF and writes are discarded.
+ *****************************************************************************/
+void SPIFlashInit(void)
+{
+	const char* name;
+
+	if(_flashFd >= 0)
+	{
+		close(_flashFd);
+		_flashFd = -1;
+	}
+	memset(&SPIFlashHostStats, 0x00, sizeof(SPIFlashHostStats));
+
+	name = getenv("HOST_SPIFLASH_FILE");
+	if(!name || !*name)
+		name = HOST_SPIFLASH_NAME;
+	_flashFd = open(name, O_RDWR | O_CREAT, 0644);
+	if(_flashFd < 0)
+		perror(name);
+}
+
+
+/****************************************************************************
+ * Function:        static void _Read(DWORD dwAddress, BYTE* vData, WORD wLen)
+ *
+ * PreCondition:    None
+ *
+ * Input:           dwAddress - device address
+ *                  vData - buffer for the bytes
+ *                  wLen - number of bytes
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads the file without counting a transaction.  Bytes
+ *                  past the end of the file or of the device read 0xFF.
+ *
+ * Note:            None
+ *****************************************************************************/
+static void _Read(DWORD dwAddress, BYTE* vData, WORD wLen)
+{
+	ssize_t n = 0;
+
+	if(_flashFd >= 0 && dwAddress < HOST_SPIFLASH_SIZE)
+	{
+		if(wLen > HOST_SPIFLASH_SIZE - dwAddress)
+			n = HOST_SPIFLASH_SIZE - dwAddress;
+		else
+			n = wLen;
+		n = pread(_flashFd, vData, n, dwAddress);
+		if(n < 0)
+			n = 0;
+	}
+	memset(vData + n, 0xFF, wLen - n);
+}
+
+
+/****************************************************************************
+ * Function:        void SPIFlashReadArray(DWORD dwAddress, BYTE* vData, WORD wLen)
+ *
+ * PreCondition:    SPIFlashInit() has been called
+ *
+ * Input:           dwAddress - device address to start reading at
+ *                  vData - buffer for the bytes
+ *                  wLen - number of bytes to read
+ *
+ * Output:          None
+ *
+ * Side Effects:    Counts one transaction and wLen bytes.
+ *
+ * Overview:        Reads an array of bytes, as one READ command would.
+ *
+ * Note:            A read of 0 bytes is not counted.
+ *****************************************************************************/
+void SPIFlashReadArray(DWORD dwAddress, BYTE* vData, WORD wLen)
+{
+	if(wLen == 0u)
+		return;
+
+	SPIFlashHostStats.dwReads++;
+	SPIFlashHostStats.dwReadBytes += wLen;
+	_Read(dwAddress, vData, wLen);
+}
+
+
+/****************************************************************************
+ * Function:        void SPIFlashBeginWrite(DWORD dwAddr)
+ *
+ * PreCondition:    SPIFlashInit() has been called
+ *
+ * Input:           dwAddr - address where writing starts
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sets the address for SPIFlashWrite() and
+ *                  SPIFlashWriteArray().
+ *
+ * Note:            None
+ *****************************************************************************/
+void SPIFlashBeginWrite(DWORD dwAddr)
+{
+	_dwWriteAddr = dwAddr;
+}
+
+
+/****************************************************************************
+ * Function:        void SPIFlashWrite(BYTE vData)
+ *
+ * PreCondition:    SPIFlashBeginWrite() has been called
+ *
+ * Input:           vData - byte to write
+ *
+ * Output:          None
+ *
+ * Side Effects:    May erase a sector.
+ *
+ * Overview:        Writes one byte at the write address.
+ *
+ * Note:            None
+ *****************************************************************************/
+void SPIFlashWrite(BYTE vData)
+{
+	SPIFlashWriteArray(&vData, 1);
+}
+
+
+/****************************************************************************
+ * Function:        void SPIFlashWriteArray(BYTE* vData, WORD wLen)
+ *
+ * PreCondition:    SPIFlashBeginWrite() has been called
+ *
+ * Input:           vData - bytes to write
+ *                  wLen - number of bytes
+ *
+ * Output:          None
+ *
+ * Side Effects:    Erases each sector whose first byte is written.
+ *
+ * Overview:        Programs bytes at the write address and advances it.
+ *                  Each byte is ANDed into the current contents, as with
+ *                  a flash that is not erased first.
+ *
+ * Note:            Writes past the end of the device are discarded.
+ *****************************************************************************/
+void SPIFlashWriteArray(BYTE* vData, WORD wLen)
+{
+	BYTE vOld[64];
+	WORD w, wChunk;
+
+	while(wLen)
+	{
+		if(_dwWriteAddr >= HOST_SPIFLASH_SIZE)
+			return;
+		if((_dwWriteAddr & SPI_FLASH_SECTOR_MASK) == 0u)
+			SPIFlashEraseSector(_dwWriteAddr);
+
+		// Program up to the next sector boundary
+		wChunk = sizeof(vOld);
+		if(wChunk > wLen)
+			wChunk = wLen;
+		if(wChunk > SPI_FLASH_SECTOR_SIZE - (_dwWriteAddr & SPI_FLASH_SECTOR_MASK))
+			wChunk = SPI_FLASH_SECTOR_SIZE - (_dwWriteAddr & SPI_FLASH_SECTOR_MASK);
+
+		_Read(_dwWriteAddr, vOld, wChunk);
+		for(w = 0; w < wChunk; w++)
+			vOld[w] &= vData[w];
+		if(_flashFd >= 0 && pwrite(_flashFd, vOld, wChunk, _dwWriteAddr) != (ssize_t)wChunk)
+			perror("SPIFlashWriteArray");
+
+		SPIFlashHostStats.dwWriteBytes += wChunk;
+		_dwWriteAddr += wChunk;
+		vData += wChunk;
+		wLen -= wChunk;
+	}
+}
+
+
+/****************************************************************************
+ * Function:        void SPIFlashEraseSector(DWORD dwAddr)
+ *
+ * PreCondition:    SPIFlashInit() has been called
+ *
+ * Input:           dwAddr - an address in the sector to erase
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sets every byte of the sector to 0xFF.
+ *
+ * Note:            None
+ *****************************************************************************/
+void SPIFlashEraseSector(DWORD dwAddr)
+{
+	BYTE vErased[SPI_FLASH_SECTOR_SIZE];
+
+	dwAddr &= ~SPI_FLASH_SECTOR_MASK;
+	if(dwAddr >= HOST_SPIFLASH_SIZE)
+		return;
+
+	SPIFlashHostStats.dwErases++;
+	memset(vErased, 0xFF, sizeof(vErased));
+	if(_flashFd >= 0 && pwrite(_flashFd, vErased, sizeof(vErased), dwAddr) != (ssize_t)sizeof(vErased))
+		perror("SPIFlashEraseSector");
+}
+
+#endif	// defined(COMPILER_HOST_GCC)
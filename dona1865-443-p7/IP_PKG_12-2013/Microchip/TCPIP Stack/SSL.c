@@ -4,6 +4,11 @@
  *  Module for Microchip TCP/IP Stack
  *    - Implements an SSL layer supporting both client and server
  *		operation for any given TCP socket.
+ *    - With STACK_USE_SSL_AES_GCM, also negotiates TLS 1.2 with
+ *		TLS_RSA_WITH_AES_128_GCM_SHA256.  AES-GCM records are only
+ *		used once all of the record is in the RX FIFO and its tag is
+ *		verified, so records larger than the socket's RX FIFO are
+ *		refused with a RecordOverflow alert.
  *
  **********************************************************************
  * FileName:        SSL.c
@@ -109,6 +114,14 @@
 	static void GenerateHashRounds(BYTE num, BYTE* rand1, BYTE* rand2);
 	static void CalculateFinishedHash(BYTE hashID, BOOL fromClient, BYTE *result);
 	static void GenerateSessionKeys(void);
+	static BOOL SSLMACMatches(BYTE* received, BYTE* expected);
+	#if defined(STACK_USE_AES_GCM)
+	static void GeneratePRF(ROM BYTE* label, BYTE labelLen, BYTE* seed1, BYTE* seed2, BYTE* result, BYTE len);
+	static void PRFHMACBegin(void);
+	static void PRFHMACCalc(BYTE *result);
+	static void CalculateFinishedPRF(BOOL fromClient, BYTE *result);
+	static void SSLSelectCipher(BYTE cipher);
+	#endif
 
 	// Section: Ethernet Buffer RAM Management
 	static void SSLStubSync(BYTE id);
@@ -130,6 +143,8 @@
 	// Section: Handshake Hash and I/O Functions
 	static void HSStart(void);
 	static void HSEnd(void);
+	static void HSAddData(BYTE *data, WORD len);
+	static void HSHashData(BYTE hashID, BYTE *data, WORD len);
 	static WORD HSGet(TCP_SOCKET skt, BYTE *b);
 	static WORD HSGetWord(TCP_SOCKET skt, WORD *w);
 	static WORD HSGetArray(TCP_SOCKET skt, BYTE *data, WORD len);
@@ -174,6 +189,7 @@
 
 	#define SSL_RSA_EXPORT_WITH_ARCFOUR_40_MD5	0x0003u
 	#define SSL_RSA_WITH_ARCFOUR_128_MD5		0x0004u
+	#define TLS_RSA_WITH_AES_128_GCM_SHA256		0x009Cu
 
 /****************************************************************************
   Section:
@@ -307,6 +323,12 @@ void SSLPeriodic(TCP_SOCKET hTCP, BYTE id)
 				// Generate the Master Secret
 				SSLKeysSync(sslStubID);
 				SSLBufferSync(SSL_INVALID_ID);
+				#if defined(STACK_USE_AES_GCM)
+				if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+					GeneratePRF((ROM BYTE*)"master secret", 13, sslKeys.Remote.random,
+						sslKeys.Local.random, sslBuffer.hashRounds.temp, 48);
+				else
+				#endif
 				GenerateHashRounds(3, sslKeys.Remote.random, sslKeys.Local.random);
 				memcpy(sslSession.masterSecret, (void*)sslBuffer.hashRounds.temp, 48);
 				
@@ -360,6 +382,10 @@ BYTE SSLStartSession(TCP_SOCKET hTCP, void * buffer, BYTE supDataType)
 	sslStub.idRxHash = SSL_INVALID_ID;
 	sslStub.idMD5 = SSL_INVALID_ID;
 	sslStub.idSHA1 = SSL_INVALID_ID;
+	#if defined(STACK_USE_AES_GCM)
+	sslStub.idSHA256 = SSL_INVALID_ID;
+	sslStub.cipher = SSL_CIPHER_ARCFOUR_MD5;
+	#endif
 	sslStub.idRxBuffer = SSL_INVALID_ID;
 	sslStub.idTxBuffer = SSL_INVALID_ID;
 	sslStub.requestedMessage = SSL_NO_MESSAGE;
@@ -367,18 +393,31 @@ BYTE SSLStartSession(TCP_SOCKET hTCP, void * buffer, BYTE supDataType)
 	sslStub.supplementaryBuffer = buffer;
     sslStub.supplementaryDataType = supDataType;
 
-	// Allocate handshake hashes for use, or fail
+	// Allocate handshake hashes for use, or fail.  Until the cipher is
+	// chosen, both the SSL 3.0 and the TLS 1.2 hashes are kept.
 	SSLHashAlloc(&sslStub.idMD5);
 	SSLHashAlloc(&sslStub.idSHA1);
+	#if defined(STACK_USE_AES_GCM)
+	SSLHashAlloc(&sslStub.idSHA256);
+	if(sslStub.idSHA256 == SSL_INVALID_ID)
+		SSLHashFree(&sslStub.idSHA1);
+	#endif
 	if(sslStub.idMD5 == SSL_INVALID_ID || sslStub.idSHA1 == SSL_INVALID_ID)
 	{
 		SSLHashFree(&sslStub.idMD5);
 		SSLHashFree(&sslStub.idSHA1);
+		#if defined(STACK_USE_AES_GCM)
+		SSLHashFree(&sslStub.idSHA256);
+		#endif
 		SSLStubFree(sslStubID);
 		return SSL_INVALID_ID;
 	}
 	
 	// Initialize the handshake hashes
+	#if defined(STACK_USE_AES_GCM)
+	SSLHashSync(sslStub.idSHA256);
+	SHA256Initialize(&sslHash);
+	#endif
 	SSLHashSync(sslStub.idSHA1);
 	SHA1Initialize(&sslHash);
 	SSLHashSync(sslStub.idMD5);
@@ -443,6 +482,9 @@ void SSLTerminate(BYTE id)
 	SSLBufferFree(&sslStub.idTxBuffer);
 	SSLHashFree(&sslStub.idMD5);
 	SSLHashFree(&sslStub.idSHA1);
+	#if defined(STACK_USE_AES_GCM)
+	SSLHashFree(&sslStub.idSHA256);
+	#endif
 	SSLHashFree(&sslStub.idRxHash);
 	SSLStubFree(id);
 	if(sslRSAStubID == id)
@@ -516,22 +558,29 @@ WORD SSLRxRecord(TCP_SOCKET hTCP, BYTE id)
 			// Read the MAC
 			TCPGetArray(hTCP, temp, 16);
 			
-			// Calculate the expected MAC
-			SSLBufferSync(sslStub.idRxBuffer);
-			SSLKeysSync(id);
-			SSLHashSync(sslStub.idRxHash);
-			
-			ARCFOURCrypt(&sslKeys.Remote.app.cryptCtx, temp, 16);
-			SSLMACCalc(sslKeys.Remote.app.MACSecret, &temp[16]);
-			
 			// MAC no longer expected
 			sslStub.Flags.bExpectingMAC = 0;
 			
-			// Verify the MAC
-			if(memcmp((void*)temp, (void*)&temp[16], 16) != 0)
-			{// MAC fails
-				TCPRequestSSLMessage(hTCP, SSL_ALERT_BAD_RECORD_MAC);
-				return 0;
+			// AES-GCM tags were verified when the record header was read,
+			// before any of the record was used, so they are just dropped
+			#if defined(STACK_USE_AES_GCM)
+			if(sslStub.cipher != SSL_CIPHER_AES_GCM)
+			#endif
+			{
+				// Calculate the expected MAC
+				SSLBufferSync(sslStub.idRxBuffer);
+				SSLKeysSync(id);
+				SSLHashSync(sslStub.idRxHash);
+			
+				ARCFOURCrypt(&sslKeys.Remote.app.cryptCtx, temp, 16);
+				SSLMACCalc(sslKeys.Remote.app.MACSecret, &temp[16]);
+			
+				// Verify the MAC
+				if(!SSLMACMatches(temp, &temp[16]))
+				{// MAC fails
+					TCPRequestSSLMessage(hTCP, SSL_ALERT_BAD_RECORD_MAC);
+					return 0;
+				}
 			}
 		}	
 		
@@ -540,6 +589,25 @@ WORD SSLRxRecord(TCP_SOCKET hTCP, BYTE id)
 		if(TCPIsGetReady(hTCP) < 5u)
 			return 0;
 		
+		#if defined(STACK_USE_AES_GCM)
+		// AES-GCM records are only read once the whole record is in the
+		// RX FIFO, so that no data is used before its tag is verified.
+		// Records that can never fit in the RX FIFO are refused.
+		if(sslStub.Flags.bRemoteChangeCipherSpec && 
+			sslStub.cipher == SSL_CIPHER_AES_GCM)
+		{
+			TCPPeekArray(hTCP, temp, 5, 0);
+			wLen = ((WORD)temp[3] << 8) | temp[4];
+			if((DWORD)wLen + 5u > (DWORD)TCPIsGetReady(hTCP) + TCPGetRxFIFOFree(hTCP))
+			{
+				TCPRequestSSLMessage(hTCP, SSL_ALERT_RECORD_OVERFLOW);
+				return 0;
+			}
+			if((DWORD)TCPIsGetReady(hTCP) < (DWORD)wLen + 5u)
+				return 0;
+		}
+		#endif
+		
 		// Read the record type (BYTE)
 		TCPGet(hTCP, &sslStub.rxProtocol);
 		
@@ -572,6 +640,44 @@ WORD SSLRxRecord(TCP_SOCKET hTCP, BYTE id)
 			TCPGet(hTCP, ((BYTE*)&sslStub.wRxBytesRem));
 			
 			// Determine if a MAC is expected
+			#if defined(STACK_USE_AES_GCM)
+			if(sslStub.Flags.bRemoteChangeCipherSpec &&
+				sslStub.cipher == SSL_CIPHER_AES_GCM)
+			{
+				// Records too short for the nonce and tag can't be valid
+				if(sslStub.wRxBytesRem < 8u+16u)
+				{
+					sslStub.wRxBytesRem -= TCPGetArray(hTCP, NULL, sslStub.wRxBytesRem);
+					TCPRequestSSLMessage(hTCP, SSL_ALERT_BAD_RECORD_MAC);
+					return 0;
+				}
+				sslStub.Flags.bExpectingMAC = 1;
+				sslStub.wRxBytesRem -= 8+16;
+				
+				// Read the explicit nonce and start the AES-GCM calculation
+				TCPGetArray(hTCP, temp, 8);
+				SSLKeysSync(sslStubID);
+				SSLBufferSync(sslStub.idRxBuffer);
+				SSLGCMBegin(&sslKeys.Remote.app.gcmCtx, temp,
+					sslKeys.Remote.app.sequence++,
+					sslStub.rxProtocol, sslStub.wRxBytesRem);
+				
+				// Decrypt the whole record in place and check the tag that
+				// follows it.  A forged record is dropped unused.
+				TCPSSLDecryptGCM(hTCP, &sslKeys.Remote.app.gcmCtx, sslStub.wRxBytesRem);
+				AESGCMCalculate(&sslKeys.Remote.app.gcmCtx, &temp[16]);
+				TCPPeekArray(hTCP, temp, 16, sslStub.wRxBytesRem);
+				if(!SSLMACMatches(temp, &temp[16]))
+				{
+					TCPGetArray(hTCP, NULL, sslStub.wRxBytesRem + 16);
+					sslStub.wRxBytesRem = 0;
+					sslStub.Flags.bExpectingMAC = 0;
+					TCPRequestSSLMessage(hTCP, SSL_ALERT_BAD_RECORD_MAC);
+					return 0;
+				}
+			}
+			else
+			#endif
 			if(sslStub.Flags.bRemoteChangeCipherSpec)
 			{
 				sslStub.Flags.bExpectingMAC = 1;
@@ -599,13 +705,17 @@ WORD SSLRxRecord(TCP_SOCKET hTCP, BYTE id)
 		if(wLen > sslStub.wRxBytesRem)
 			wLen = sslStub.wRxBytesRem;
 						
-		// Prepare for decryption
-		SSLKeysSync(id);
-		SSLBufferSync(sslStub.idRxBuffer);
-		SSLHashSync(sslStub.idRxHash);
-
-		// Decrypt application data to proper location, non-app in place
-		TCPSSLDecryptMAC(hTCP, &sslKeys.Remote.app.cryptCtx, wLen);
+		// Decrypt application data to proper location, non-app in place.
+		// AES-GCM records were already decrypted with their header.
+		#if defined(STACK_USE_AES_GCM)
+		if(sslStub.cipher != SSL_CIPHER_AES_GCM)
+		#endif
+		{
+			SSLKeysSync(id);
+			SSLBufferSync(sslStub.idRxBuffer);
+			SSLHashSync(sslStub.idRxHash);
+			TCPSSLDecryptMAC(hTCP, &sslKeys.Remote.app.cryptCtx, wLen);
+		}
 	}
 	
 	// Determine what to do with the rest of the data
@@ -673,6 +783,39 @@ void SSLTxRecord(TCP_SOCKET hTCP, BYTE id, BYTE txProtocol)
 		return;
 	
 	// Determine if a MAC is required
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.Flags.bLocalChangeCipherSpec &&
+		sslStub.cipher == SSL_CIPHER_AES_GCM)
+	{// Perform the AES-GCM encryption and tag
+		BYTE nonce[8];
+		
+		// Sync needed data
+		SSLKeysSync(sslStubID);
+		SSLBufferSync(sslStub.idTxBuffer);
+		
+		// The sequence number is used as the explicit nonce
+		nonce[0] = 0x00;
+		nonce[1] = 0x00;
+		nonce[2] = 0x00;
+		nonce[3] = 0x00;
+		nonce[4] = *((BYTE*)&sslKeys.Local.app.sequence+3);
+		nonce[5] = *((BYTE*)&sslKeys.Local.app.sequence+2);
+		nonce[6] = *((BYTE*)&sslKeys.Local.app.sequence+1);
+		nonce[7] = *((BYTE*)&sslKeys.Local.app.sequence+0);
+		
+		// Start the AES-GCM calculation
+		SSLGCMBegin(&sslKeys.Local.app.gcmCtx, nonce, 
+			sslKeys.Local.app.sequence, txProtocol, wLen.Val);
+		sslKeys.Local.app.sequence++;
+		
+		// Get ready to send
+		TCPSSLInPlaceGCMEncrypt(hTCP, &sslKeys.Local.app.gcmCtx, nonce, wLen.Val);
+		
+		// Add nonce and tag length to the data length
+		wLen.Val += 8+16;
+	}
+	else
+	#endif
 	if(sslStub.Flags.bLocalChangeCipherSpec)
 	{// Perform the encryption and MAC
 		// Sync needed data
@@ -697,6 +840,10 @@ void SSLTxRecord(TCP_SOCKET hTCP, BYTE id, BYTE txProtocol)
 	hdr[0] = txProtocol;
 	hdr[1] = SSL_VERSION_HI;
 	hdr[2] = SSL_VERSION_LO;
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+		hdr[2] = TLS12_VERSION_LO;
+	#endif
 	hdr[3] = wLen.v[1];
 	hdr[4] = wLen.v[0];
 	
@@ -748,6 +895,10 @@ void SSLStartPartialRecord(TCP_SOCKET hTCP, BYTE id, BYTE txProtocol, WORD wLen)
 	hdr[0] = txProtocol;
 	hdr[1] = SSL_VERSION_HI;
 	hdr[2] = SSL_VERSION_LO;
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+		hdr[2] = TLS12_VERSION_LO;
+	#endif
 	hdr[3] = wLen >> 8;
 	hdr[4] = wLen;
 	
@@ -996,6 +1147,17 @@ static void SSLTxClientHello(TCP_SOCKET hTCP)
 	// Send handshake message header (hashed)
 	HSPut(hTCP, SSL_CLIENT_HELLO);
 	HSPut(hTCP, 0x00);				
+	#if defined(STACK_USE_AES_GCM)
+	HSPut(hTCP, 0x00);				// Message length is 45 bytes,
+	if(sslStub.Flags.bNewSession)	// plus 32 more if a session
+		HSPut(hTCP, 45);			// ID is being included.
+	else
+		HSPut(hTCP, 45+32);
+	
+	// Send the highest version supported
+	HSPut(hTCP, TLS12_VERSION_HI);
+	HSPut(hTCP, TLS12_VERSION_LO);
+	#else
 	HSPut(hTCP, 0x00);				// Message length is 40 bytes,
 	if(sslStub.Flags.bNewSession)	// plus 32 more if a session
 		HSPut(hTCP, 43);			// ID is being included.
@@ -1005,8 +1167,10 @@ static void SSLTxClientHello(TCP_SOCKET hTCP)
 	// Send 
 	HSPut(hTCP, SSL_VERSION_HI);
 	HSPut(hTCP, SSL_VERSION_LO);
+	#endif
 	
 	// Put Client.Random
+	SSLKeysSync(sslStubID);
 	HSPutArray(hTCP, sslKeys.Local.random, 32);
 	
 	// Put Session ID
@@ -1022,7 +1186,12 @@ static void SSLTxClientHello(TCP_SOCKET hTCP)
 	}
 	
 	// Put Cipher Suites List
+	#if defined(STACK_USE_AES_GCM)
+	HSPutWord(hTCP, 0x0006);
+	HSPutWord(hTCP, TLS_RSA_WITH_AES_128_GCM_SHA256);
+	#else
 	HSPutWord(hTCP, 0x0004);
+	#endif
 	HSPutWord(hTCP, SSL_RSA_WITH_ARCFOUR_128_MD5);
 	HSPutWord(hTCP, SSL_RSA_EXPORT_WITH_ARCFOUR_40_MD5);
 	
@@ -1065,6 +1234,10 @@ static void SSLRxClientHello(TCP_SOCKET hTCP)
 {
 	WORD w;
 	BYTE c, *ptrID;
+	#if defined(STACK_USE_AES_GCM)
+	WORD version, suite;
+	BYTE cipher;
+	#endif
 	
 	// Make sure entire message is ready
 	if(TCPIsGetReady(hTCP) < sslStub.wRxHsBytesRem)
@@ -1082,6 +1255,10 @@ static void SSLRxClientHello(TCP_SOCKET hTCP)
 	// Ignore the version here.  It must be at least 3.0 to receive this type
 	// of message, and Safari 3.1 sends 0x0301 (TLS 1.0) even when the last 
 	// connection was only 0x0300 (SSL 3.0)
+	// TLS 1.2 clients may be offered AES-GCM instead.
+	#if defined(STACK_USE_AES_GCM)
+	version = w;
+	#endif
 		
 	// Make sure the session keys are synced
 	SSLKeysSync(sslStubID);
@@ -1106,10 +1283,6 @@ static void SSLRxClientHello(TCP_SOCKET hTCP)
 			sslStub.Flags.bNewSession = FALSE;
 	}
 	
-	// If we we're starting a new session, try to obtain a free one
-	if(sslStub.Flags.bNewSession)
-		sslStub.idSession = SSLSessionNew();
-	
 	// Read CipherSuites length
 	HSGetWord(hTCP, &w);
 	
@@ -1117,8 +1290,32 @@ static void SSLRxClientHello(TCP_SOCKET hTCP)
 	// Right now we just ignore this and assume support for 
 	// SSL_RSA_WITH_ARCFOUR_128_MD5.  If we request this suite later 
 	// and it isn't supported, the client will kill the connection.
+	#if defined(STACK_USE_AES_GCM)
+	// TLS_RSA_WITH_AES_128_GCM_SHA256 is preferred whenever a TLS 1.2
+	// client offers it.
+	cipher = SSL_CIPHER_ARCFOUR_MD5;
+	for(; w >= 2u; w -= 2)
+	{
+		HSGetWord(hTCP, &suite);
+		if(suite == TLS_RSA_WITH_AES_128_GCM_SHA256 && version >= TLS12_VERSION)
+			cipher = SSL_CIPHER_AES_GCM;
+	}
+	SSLSelectCipher(cipher);
+	
+	// A session can only be resumed with the cipher it was made for
+	if(!sslStub.Flags.bNewSession)
+	{
+		SSLSessionSync(sslStub.idSession);
+		if(sslSession.cipher != cipher)
+			sslStub.Flags.bNewSession = TRUE;
+	}
+	#endif
 	HSGetArray(hTCP, NULL, w);
 	
+	// If we we're starting a new session, try to obtain a free one
+	if(sslStub.Flags.bNewSession)
+		sslStub.idSession = SSLSessionNew();
+	
 	// Read the Compression Methods length
 	HSGet(hTCP, &c);
 	
@@ -1220,6 +1417,9 @@ static void SSLRxAntiqueClientHello(TCP_SOCKET hTCP)
 	// Obtain a new session
 	sslStub.idSession = SSLSessionNew();
 	sslStub.Flags.bNewSession = 1;
+	#if defined(STACK_USE_AES_GCM)
+	SSLSelectCipher(SSL_CIPHER_ARCFOUR_MD5);
+	#endif
 	
 	// Read Client.Random
 	// This needs to be 32 bytes, so zero-pad the left side
@@ -1254,6 +1454,10 @@ static void SSLRxServerHello(TCP_SOCKET hTCP)
 {
 	BYTE b, sessionID[32];
 	WORD w;
+	#if defined(STACK_USE_AES_GCM)
+	WORD version;
+	BOOL bResumed = FALSE;
+	#endif
 		
 	// Make sure entire message is ready
 	if(TCPIsGetReady(hTCP) < sslStub.wRxHsBytesRem)
@@ -1267,7 +1471,11 @@ static void SSLRxServerHello(TCP_SOCKET hTCP)
 	SSLKeysSync(sslStubID);
 	
 	// Read Version (2)
+	#if defined(STACK_USE_AES_GCM)
+	HSGetWord(hTCP, &version);
+	#else
 	HSGetWord(hTCP, NULL);
+	#endif
 	
 	// Read Server.Random (32)
 	HSGetArray(hTCP, sslKeys.Remote.random, 32);
@@ -1286,6 +1494,9 @@ static void SSLRxServerHello(TCP_SOCKET hTCP)
 			memcmp((void*)sslSession.sessionID, (void*)sessionID, 32) == 0)
 		{// Session restart was accepted
 			// Nothing to do here...move along
+			#if defined(STACK_USE_AES_GCM)
+			bResumed = TRUE;
+			#endif
 		}
 		else
 		{// This is a new session
@@ -1303,8 +1514,22 @@ static void SSLRxServerHello(TCP_SOCKET hTCP)
 	
 	// Read and verify Cipher Suite (WORD)
 	HSGetWord(hTCP, &w);
+	#if defined(STACK_USE_AES_GCM)
+	// The version must match the suite, and a resumed session must keep
+	// the cipher its master secret was made for
+	if(w == TLS_RSA_WITH_AES_128_GCM_SHA256 && version == TLS12_VERSION)
+		SSLSelectCipher(SSL_CIPHER_AES_GCM);
+	else if(w == SSL_RSA_WITH_ARCFOUR_128_MD5 && version == SSL_VERSION)
+		SSLSelectCipher(SSL_CIPHER_ARCFOUR_MD5);
+	else
+		TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+	if(bResumed && sslSession.cipher != sslStub.cipher)
+		TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+	sslSession.cipher = sslStub.cipher;
+	#else
 	if(w != SSL_RSA_WITH_ARCFOUR_128_MD5)
 		TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+	#endif
 	
 	// Read and verify Compression Method (BYTE)
 	HSGet(hTCP, &b);
@@ -1364,6 +1589,10 @@ static void SSLTxServerHello(TCP_SOCKET hTCP)
 		// Tag this session identifier
 		memcpy((void*)&sslSessionStubs[sslStub.idSession].tag.v[1],
 			(void*)(sslSession.sessionID), 3);
+		
+		#if defined(STACK_USE_AES_GCM)
+		sslSession.cipher = sslStub.cipher;
+		#endif
 	}
 
 	// Send handshake message header (hashed)
@@ -1374,6 +1603,11 @@ static void SSLTxServerHello(TCP_SOCKET hTCP)
 	
 	// Send the version number
 	HSPut(hTCP, SSL_VERSION_HI);
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+		HSPut(hTCP, TLS12_VERSION_LO);
+	else
+	#endif
 	HSPut(hTCP, SSL_VERSION_LO);
 	
 	// Put Server.Random
@@ -1400,6 +1634,11 @@ static void SSLTxServerHello(TCP_SOCKET hTCP)
 	HSPutArray(hTCP, sslSession.sessionID, 32);
 	
 	// Put Cipher Suites
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+		HSPutWord(hTCP, TLS_RSA_WITH_AES_128_GCM_SHA256);
+	else
+	#endif
 	HSPutWord(hTCP, SSL_RSA_WITH_ARCFOUR_128_MD5);
 	
 	// Put Compression Method (just null)
@@ -1577,15 +1816,18 @@ static void SSLRxServerCertificate(TCP_SOCKET hTCP)
 
 
 			// Hash what we just read
-			SSLHashSync(sslStub.idSHA1);
-			HashAddData(&sslHash, sslBuffer.full, sslStub.dwTemp.w[1]);
-			SSLHashSync(sslStub.idMD5);
-			HashAddData(&sslHash, sslBuffer.full, sslStub.dwTemp.w[1]);
+			HSAddData(sslBuffer.full, sslStub.dwTemp.w[1]);
 			
 			// Generate { SSL_VERSION rand[46] } as pre-master secret & save
+			// The version is the one sent in ClientHello
 			SSLSessionSync(sslStub.idSession);
+			#if defined(STACK_USE_AES_GCM)
+			sslSession.masterSecret[0] = TLS12_VERSION_HI;
+			sslSession.masterSecret[1] = TLS12_VERSION_LO;
+			#else
 			sslSession.masterSecret[0] = SSL_VERSION_HI;
 			sslSession.masterSecret[1] = SSL_VERSION_LO;
+			#endif
 			for(i = 2; i < 48u; i++)
 				sslSession.masterSecret[i] = RandomGet();
 			SSLSessionUpdated();
@@ -1816,8 +2058,8 @@ static void SSLTxClientKeyExchange(TCP_SOCKET hTCP)
 	// Load length of modulus from RxServerCertificate
 	len = sslStub.dwTemp.w[1];
 	
-	// Make sure there's len+9 bytes free
-	if(TCPIsPutReady(hTCP) < len + 9)
+	// Make sure there's len+11 bytes free
+	if(TCPIsPutReady(hTCP) < len + 11)
 		return;
 	
 	// Start the handshake processor
@@ -1826,8 +2068,18 @@ static void SSLTxClientKeyExchange(TCP_SOCKET hTCP)
 	// Send handshake message header (hashed)
 	HSPut(hTCP, SSL_CLIENT_KEY_EXCHANGE);
 	HSPut(hTCP, 0x00);				
-	HSPut(hTCP, (len>>8)&0xFF);				// Message length is (length of key) bytes
-	HSPut(hTCP, len&0xFF);
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+	{// TLS prefixes the encrypted pre-master secret with its length
+		HSPutWord(hTCP, len + 2);
+		HSPutWord(hTCP, len);
+	}
+	else
+	#endif
+	{
+		HSPut(hTCP, (len>>8)&0xFF);			// Message length is (length of key) bytes
+		HSPut(hTCP, len&0xFF);
+	}
 	
 	// Suspend the handshake hasher and load the buffer
 	HSEnd();
@@ -1841,14 +2093,17 @@ static void SSLTxClientKeyExchange(TCP_SOCKET hTCP)
 	sslRSAStubID = SSL_INVALID_ID;
 
 	// Hash what we just sent
-	SSLHashSync(sslStub.idSHA1);
-	HashAddData(&sslHash, sslBuffer.full + len, len);
-	SSLHashSync(sslStub.idMD5);
-	HashAddData(&sslHash, sslBuffer.full + len, len);
+	HSAddData(sslBuffer.full + len, len);
 	
 	// Generate the Master Secret
 	SSLKeysSync(sslStubID);
 	SSLSessionSync(sslStub.idSession);
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+		GeneratePRF((ROM BYTE*)"master secret", 13, sslKeys.Local.random,
+			sslKeys.Remote.random, sslBuffer.hashRounds.temp, 48);
+	else
+	#endif
 	GenerateHashRounds(3, sslKeys.Local.random, sslKeys.Remote.random);
 	memcpy(sslSession.masterSecret, (void*)sslBuffer.hashRounds.temp, 48);
 	SSLSessionUpdated();
@@ -1915,6 +2170,15 @@ static void SSLRxClientKeyExchange(TCP_SOCKET hTCP)
 	wKeyLength = sslStub.wRxHsBytesRem;
 	HSEnd();
 	HSStart();
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+	{// Skip the length TLS puts before the encrypted pre-master secret
+		HSGetWord(hTCP, NULL);
+		HSEnd();
+		HSStart();
+		wKeyLength -= 2;
+	}
+	#endif
 	HSGetArray(hTCP, NULL, wKeyLength);
 	HSEnd();
 	RSASetData(sslBuffer.full, wKeyLength, RSA_BIG_ENDIAN);
@@ -1989,17 +2253,34 @@ static void SSLTxCCSFin(TCP_SOCKET hTCP)
 	// Start the handshake data processor
 	HSStart();
 
-	// First, write the handshake header
-	HSPut(hTCP, SSL_FINISHED);
-	HSPut(hTCP, 0x00);
-	HSPut(hTCP, 0x00);
-	HSPut(hTCP, 0x24);
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+	{
+		// First, write the handshake header
+		HSPut(hTCP, SSL_FINISHED);
+		HSPut(hTCP, 0x00);
+		HSPut(hTCP, 0x00);
+		HSPut(hTCP, 0x0C);
+		
+		// Calculate the TLS 1.2 verify_data
+		CalculateFinishedPRF(!sslStub.Flags.bIsServer, data);
+		HSPutArray(hTCP, data, 12);
+	}
+	else
+	#endif
+	{
+		// First, write the handshake header
+		HSPut(hTCP, SSL_FINISHED);
+		HSPut(hTCP, 0x00);
+		HSPut(hTCP, 0x00);
+		HSPut(hTCP, 0x24);
 
-	// Calculate the Finished hashes
-	CalculateFinishedHash(sslStub.idMD5, !sslStub.Flags.bIsServer, data);
-	HSPutArray(hTCP, data, 16);
-	CalculateFinishedHash(sslStub.idSHA1, !sslStub.Flags.bIsServer, data);
-	HSPutArray(hTCP, data, 20);	
+		// Calculate the Finished hashes
+		CalculateFinishedHash(sslStub.idMD5, !sslStub.Flags.bIsServer, data);
+		HSPutArray(hTCP, data, 16);
+		CalculateFinishedHash(sslStub.idSHA1, !sslStub.Flags.bIsServer, data);
+		HSPutArray(hTCP, data, 20);	
+	}
 
 	// Hash this message to the handshake hash
 	HSEnd();
@@ -2017,6 +2298,9 @@ static void SSLTxCCSFin(TCP_SOCKET hTCP)
 		TCPSSLHandshakeComplete(hTCP);
 		SSLHashFree(&sslStub.idMD5);
 		SSLHashFree(&sslStub.idSHA1);
+		#if defined(STACK_USE_AES_GCM)
+		SSLHashFree(&sslStub.idSHA256);
+		#endif
 	}
 
 }
@@ -2046,12 +2330,18 @@ static void SSLRxCCS(TCP_SOCKET hTCP)
 	if(!sslStub.Flags.bClientHello || !sslStub.Flags.bServerHello)
 		TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
 	
-	// Allocate a hash for MACing data
-	SSLHashAlloc(&sslStub.idRxHash);
+	// Allocate a hash for MACing data (AES-GCM needs none)
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher != SSL_CIPHER_AES_GCM)
+	#endif
+	{
+		SSLHashAlloc(&sslStub.idRxHash);
+		if(sslStub.idRxHash == SSL_INVALID_ID)
+			return;
+	}
 
-	// Make sure entire message is ready and an RX hash is allocated
-	if(TCPIsGetReady(hTCP) < sslStub.wRxBytesRem 
-		|| sslStub.idRxHash == SSL_INVALID_ID)
+	// Make sure entire message is ready
+	if(TCPIsGetReady(hTCP) < sslStub.wRxBytesRem)
 		return;
 	
 	// If keys are not ready, generate them
@@ -2115,24 +2405,41 @@ static void SSLRxFinished(TCP_SOCKET hTCP)
 	SSLSessionSync(sslStub.idSession);
 	SSLKeysSync(sslStubID);
 	
-	// Read md5_sum to temporary location
-	HSGetArray(hTCP, rxHash, 16);
-	
-	// Calculate expected MD5 hash
-	CalculateFinishedHash(sslStub.idMD5, sslStub.Flags.bIsServer, expectedHash);	
-	if(memcmp((void*)rxHash, (void*)expectedHash, 16) != 0)
-	{// Handshake hash fails
-		TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+	{
+		// Read verify_data to temporary location
+		HSGetArray(hTCP, rxHash, 12);
+		
+		// Calculate expected verify_data
+		CalculateFinishedPRF(sslStub.Flags.bIsServer, expectedHash);
+		if(memcmp((void*)rxHash, (void*)expectedHash, 12) != 0)
+		{// Handshake hash fails
+			TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+		}
 	}
-	
-	// Read sha_sum to temporary location
-	HSGetArray(hTCP, rxHash, 20);
-	
-	// Calculate expected SHA-1 hash	
-	CalculateFinishedHash(sslStub.idSHA1, sslStub.Flags.bIsServer, expectedHash);
-	if(memcmp((void*)rxHash, (void*)expectedHash, 20) != 0)
-	{// Handshake hash fails
-		TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+	else
+	#endif
+	{
+		// Read md5_sum to temporary location
+		HSGetArray(hTCP, rxHash, 16);
+		
+		// Calculate expected MD5 hash
+		CalculateFinishedHash(sslStub.idMD5, sslStub.Flags.bIsServer, expectedHash);	
+		if(memcmp((void*)rxHash, (void*)expectedHash, 16) != 0)
+		{// Handshake hash fails
+			TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+		}
+		
+		// Read sha_sum to temporary location
+		HSGetArray(hTCP, rxHash, 20);
+		
+		// Calculate expected SHA-1 hash	
+		CalculateFinishedHash(sslStub.idSHA1, sslStub.Flags.bIsServer, expectedHash);
+		if(memcmp((void*)rxHash, (void*)expectedHash, 20) != 0)
+		{// Handshake hash fails
+			TCPRequestSSLMessage(hTCP, SSL_ALERT_HANDSHAKE_FAILURE);
+		}
 	}
 	
 	// Note that message was received
@@ -2144,6 +2451,9 @@ static void SSLRxFinished(TCP_SOCKET hTCP)
 		TCPSSLHandshakeComplete(hTCP);
 		SSLHashFree(&sslStub.idMD5);
 		SSLHashFree(&sslStub.idSHA1);
+		#if defined(STACK_USE_AES_GCM)
+		SSLHashFree(&sslStub.idSHA256);
+		#endif
 	}
 	else
 		TCPRequestSSLMessage(hTCP, SSL_CHANGE_CIPHER_SPEC);
@@ -2303,6 +2613,42 @@ void GenerateHashRounds(BYTE num, BYTE* rand1, BYTE* rand2)
  ********************************************************************/
 void GenerateSessionKeys(void)
 {
+	#if defined(STACK_USE_AES_GCM)
+	if(sslStub.cipher == SSL_CIPHER_AES_GCM)
+	{
+		BYTE i;
+		
+		// Generate the key block: client and server write keys, then
+		// client and server salts.  There are no MAC secrets.
+		if(sslStub.Flags.bIsServer)
+		{
+			GeneratePRF((ROM BYTE*)"key expansion", 13, sslKeys.Local.random, 
+				sslKeys.Remote.random, sslBuffer.hashRounds.temp, 40);
+			i = 0;
+		}
+		else
+		{
+			GeneratePRF((ROM BYTE*)"key expansion", 13, sslKeys.Remote.random, 
+				sslKeys.Local.random, sslBuffer.hashRounds.temp, 40);
+			i = 16;
+		}
+		
+		// Save write keys elsewhere temporarily
+		SSLHashSync(SSL_INVALID_ID);
+		memcpy(&sslHash, (void*)sslBuffer.hashRounds.temp, 40);
+		
+		// Generate the GHASH tables
+		SSLBufferSync(sslStub.idRxBuffer);
+		sslKeys.Remote.app.gcmCtx.table = (DWORD*)sslBuffer.full;
+		AESGCMInitialize(&sslKeys.Remote.app.gcmCtx, (BYTE*)(&sslHash)+i, (BYTE*)(&sslHash)+32+i/4);
+		SSLBufferSync(sslStub.idTxBuffer);
+		sslKeys.Local.app.gcmCtx.table = (DWORD*)sslBuffer.full;
+		AESGCMInitialize(&sslKeys.Local.app.gcmCtx, (BYTE*)(&sslHash)+16-i, (BYTE*)(&sslHash)+36-i/4);
+		
+		return;
+	}
+	#endif
+	
 	// This functionality differs slightly for client and server operations
 
 	#if defined(STACK_USE_SSL_SERVER)
@@ -2432,6 +2778,203 @@ static void CalculateFinishedHash(BYTE hashID, BOOL fromClient, BYTE *result)
 	
 }
 
+/*********************************************************************
+ * Function:        static void GeneratePRF(ROM BYTE* label, 
+ *									BYTE labelLen, BYTE* seed1,
+ *									BYTE* seed2, BYTE* result, BYTE len)
+ *
+ * PreCondition:    The secret is in sslSession.masterSecret.
+ *
+ * Input:           label    - the ASCII label
+ *					labelLen - the length of label
+ *					seed1    - the first 32 byte seed block
+ *					seed2    - the second 32 byte seed block, or NULL
+ *					result   - where to store results
+ *					len      - how many bytes to generate
+ *
+ * Output:          None
+ *
+ * Side Effects:    Destroys the contents of sslHash
+ *
+ * Overview:        Generates len bytes of the TLS 1.2 PRF (P_SHA256)
+ *					over label + seed1 + seed2.  This gives the 
+ *					Master Secret, the key block and the Finished
+ *					verify_data.
+ *
+ * Note:            result may not overlap sslSession.masterSecret.
+ ********************************************************************/
+#if defined(STACK_USE_AES_GCM)
+static void GeneratePRF(ROM BYTE* label, BYTE labelLen, BYTE* seed1, BYTE* seed2, BYTE* result, BYTE len)
+{
+	BYTE a[32], out[32], i;
+	
+	// Make sure no hash in use is overwritten
+	SSLHashSync(SSL_INVALID_ID);
+	
+	// A(1) = HMAC(secret, label + seed)
+	PRFHMACBegin();
+	SHA256AddROMData(&sslHash, label, labelLen);
+	SHA256AddData(&sslHash, seed1, 32);
+	if(seed2)
+		SHA256AddData(&sslHash, seed2, 32);
+	PRFHMACCalc(a);
+	
+	while(1)
+	{
+		// Next output block is HMAC(secret, A(i) + label + seed)
+		PRFHMACBegin();
+		SHA256AddData(&sslHash, a, 32);
+		SHA256AddROMData(&sslHash, label, labelLen);
+		SHA256AddData(&sslHash, seed1, 32);
+		if(seed2)
+			SHA256AddData(&sslHash, seed2, 32);
+		PRFHMACCalc(out);
+		
+		i = (len < 32u) ? len : 32;
+		memcpy((void*)result, (void*)out, i);
+		result += i;
+		len -= i;
+		if(len == 0u)
+			break;
+		
+		// A(i+1) = HMAC(secret, A(i))
+		PRFHMACBegin();
+		SHA256AddData(&sslHash, a, 32);
+		PRFHMACCalc(a);
+	}
+}
+
+/*********************************************************************
+ * Function:        static void PRFHMACBegin(void)
+ *
+ * PreCondition:    sslHash is ready to be written
+ *					(any pending data saved, nothing useful stored)
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Begins an HMAC-SHA256 calculation in sslHash, 
+ *					keyed with sslSession.masterSecret
+ *
+ * Note:            None
+ ********************************************************************/
+static void PRFHMACBegin(void)
+{
+	BYTE i, pad[64];
+	
+	// Hash in the secret, padded to a block, XOR'd with ipad
+	for(i = 0; i < 48u; i++)
+		pad[i] = sslSession.masterSecret[i] ^ 0x36;
+	memset((void*)&pad[48], 0x36, 16);
+	SHA256Initialize(&sslHash);
+	SHA256AddData(&sslHash, pad, 64);
+}
+
+/*********************************************************************
+ * Function:        static void PRFHMACCalc(BYTE *result)
+ *
+ * PreCondition:    PRFHMACBegin has been called and the message
+ *					added to sslHash
+ *
+ * Input:           result - a 32 byte buffer to store result
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Finishes the HMAC-SHA256 calculation, and places
+ *					the result in the *result array
+ *
+ * Note:            None
+ ********************************************************************/
+static void PRFHMACCalc(BYTE *result)
+{
+	BYTE i, pad[64];
+	
+	// Get inner hash result
+	SHA256Calculate(&sslHash, result);
+	
+	// Hash in the secret, padded to a block, XOR'd with opad
+	for(i = 0; i < 48u; i++)
+		pad[i] = sslSession.masterSecret[i] ^ 0x5c;
+	memset((void*)&pad[48], 0x5c, 16);
+	SHA256Initialize(&sslHash);
+	SHA256AddData(&sslHash, pad, 64);
+	
+	// Hash in the inner hash result and calculate
+	SHA256AddData(&sslHash, result, 32);
+	SHA256Calculate(&sslHash, result);
+}
+
+/*********************************************************************
+ * Function:        static void CalculateFinishedPRF(BOOL fromClient,
+ *									BYTE *result)
+ *
+ * PreCondition:    sslStub.idSHA256 has all handshake data hashed so
+ *					far.
+ *
+ * Input:           fromClient - TRUE if client is sender
+ *					result     - where to store the 12 byte result
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Calculates the TLS 1.2 Finished verify_data from
+ *					the SHA-256 handshake hash.
+ *
+ * Note:            None
+ ********************************************************************/
+static void CalculateFinishedPRF(BOOL fromClient, BYTE *result)
+{
+	BYTE hash[32];
+	
+	// Load the hash, but make sure updates aren't saved
+	SSLHashSync(sslStub.idSHA256);
+	sslHashID = SSL_INVALID_ID;
+	SHA256Calculate(&sslHash, hash);
+	
+	// Sync the session data so masterSecret is available
+	SSLSessionSync(sslStub.idSession);
+	
+	if(fromClient)
+		GeneratePRF((ROM BYTE*)"client finished", 15, hash, NULL, result, 12);
+	else
+		GeneratePRF((ROM BYTE*)"server finished", 15, hash, NULL, result, 12);
+}
+
+/*********************************************************************
+ * Function:        static void SSLSelectCipher(BYTE cipher)
+ *
+ * PreCondition:    sslStub is synchronized.
+ *
+ * Input:           cipher - the SSL_CIPHER_* negotiated
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Records the negotiated cipher and releases the
+ *					handshake hashes its Finished message won't use.
+ *
+ * Note:            None
+ ********************************************************************/
+static void SSLSelectCipher(BYTE cipher)
+{
+	sslStub.cipher = cipher;
+	if(cipher == SSL_CIPHER_AES_GCM)
+	{
+		SSLHashFree(&sslStub.idMD5);
+		SSLHashFree(&sslStub.idSHA1);
+	}
+	else
+		SSLHashFree(&sslStub.idSHA256);
+}
+#endif
+
 
 /****************************************************************************
   ===========================================================================
@@ -3121,20 +3664,72 @@ static void HSStart()
 static void HSEnd()
 {
 	// Hash in the received data and reset the pointer
+	HSAddData(sslBuffer.full, ptrHS - sslBuffer.full);
+	ptrHS = sslBuffer.full;
+}
+
+/*********************************************************************
+ * Function:        static void HSAddData(BYTE *data, WORD len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           data - the data to hash
+ *					len  - the length of data
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Adds data to each of the handshake hashes.
+ *
+ * Note:            The hash already loaded is updated first, which
+ *					saves one swap.
+ ********************************************************************/
+static void HSAddData(BYTE *data, WORD len)
+{
 	if(sslHashID == sslStub.idMD5)
 	{
-		HashAddData(&sslHash, sslBuffer.full, ptrHS - sslBuffer.full);
-		SSLHashSync(sslStub.idSHA1);
-		HashAddData(&sslHash, sslBuffer.full, ptrHS - sslBuffer.full);
+		HSHashData(sslStub.idMD5, data, len);
+		HSHashData(sslStub.idSHA1, data, len);
+		#if defined(STACK_USE_AES_GCM)
+		HSHashData(sslStub.idSHA256, data, len);
+		#endif
 	}
 	else
 	{
-		SSLHashSync(sslStub.idSHA1);
-		HashAddData(&sslHash, sslBuffer.full, ptrHS - sslBuffer.full);
-		SSLHashSync(sslStub.idMD5);
-		HashAddData(&sslHash, sslBuffer.full, ptrHS - sslBuffer.full);
+		#if defined(STACK_USE_AES_GCM)
+		HSHashData(sslStub.idSHA256, data, len);
+		#endif
+		HSHashData(sslStub.idSHA1, data, len);
+		HSHashData(sslStub.idMD5, data, len);
 	}
-	ptrHS = sslBuffer.full;
+}
+
+/*********************************************************************
+ * Function:        static void HSHashData(BYTE hashID, BYTE *data,
+ *											WORD len)
+ *
+ * PreCondition:    None
+ *
+ * Input:           hashID - the handshake hash to update
+ *					data   - the data to hash
+ *					len    - the length of data
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Adds data to one handshake hash, unless it has
+ *					been released.
+ *
+ * Note:            None
+ ********************************************************************/
+static void HSHashData(BYTE hashID, BYTE *data, WORD len)
+{
+	if(hashID == SSL_INVALID_ID)
+		return;
+	SSLHashSync(hashID);
+	HashAddData(&sslHash, data, len);
 }
 
 /*********************************************************************
@@ -3583,4 +4178,78 @@ void SSLMACCalc(BYTE *MACSecret, BYTE *result)
 	MD5Calculate(&sslHash, result);	
 }
 
+/*********************************************************************
+ * Function:        void SSLGCMBegin(AES_GCM_CTX* ctx, BYTE* nonce,
+ *									DWORD seq, BYTE protocol, WORD len)
+ *
+ * PreCondition:    The GHASH table for ctx is loaded
+ *
+ * Input:           ctx       - the AES-GCM context for this direction
+ *					nonce     - the 8 byte explicit nonce of the record
+ *					seq       - the sequence number for this message
+ *					protocol  - the SSL_PROTOCOL for this message
+ *					len       - the length of the message's plain text
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Begins the AES-GCM calculation for a TLS 1.2 
+ *					record, authenticating its header
+ *
+ * Note:            None
+ ********************************************************************/
+#if defined(STACK_USE_AES_GCM)
+void SSLGCMBegin(AES_GCM_CTX* ctx, BYTE* nonce, DWORD seq, BYTE protocol, WORD len)
+{
+	BYTE aad[13];
+	
+	// Form the additional data (seq, protocol, version, len)
+	aad[0] = 0x00;
+	aad[1] = 0x00;
+	aad[2] = 0x00;
+	aad[3] = 0x00;
+	aad[4] = *((BYTE*)&seq+3);
+	aad[5] = *((BYTE*)&seq+2);
+	aad[6] = *((BYTE*)&seq+1);
+	aad[7] = *((BYTE*)&seq+0);
+	aad[8] = protocol;
+	aad[9] = TLS12_VERSION_HI;
+	aad[10] = TLS12_VERSION_LO;
+	aad[11] = *((BYTE*)&len+1);
+	aad[12] = *((BYTE*)&len+0);
+	
+	AESGCMStart(ctx, nonce, aad, 13);
+}
+#endif
+
+/*********************************************************************
+ * Function:        static BOOL SSLMACMatches(BYTE* received, 
+ *											BYTE* expected)
+ *
+ * PreCondition:    None
+ *
+ * Input:           received  - the 16 byte MAC or tag of a record
+ *					expected  - the 16 byte value calculated for it
+ *
+ * Output:          TRUE if both are equal, FALSE otherwise
+ *
+ * Side Effects:    None
+ *
+ * Overview:		Compares every byte, whatever the result, so the
+ *					time taken does not show where they differ
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL SSLMACMatches(BYTE* received, BYTE* expected)
+{
+	BYTE i, diff;
+	
+	diff = 0;
+	for(i = 0; i < 16u; i++)
+		diff |= received[i] ^ expected[i];
+	
+	return diff == 0u;
+}
+
 #endif
@@ -55,6 +55,25 @@
  * Nilesh Rajbharti     5/8/01  	Original        (Rev 1.0)
  * Howard Schlunder		12/11/06	Changed almost everything to 
  *									better meet RFC 793.
+ *                      10/18/26    Hashed socket lookup in
+ *									FindMatchingSocket()
+ *                      10/18/26    NewReno congestion control,
+ *									RFC 6298 retransmission timer
+ *                      10/18/26    RFC 7323 window scaling and
+ *									timestamps, 1460 byte RX MSS
+ *                      10/18/26    SACK (RFC 2018), multi-hole
+ *									out-of-order reassembly
+ *                      10/18/26    TX data summed while copied to
+ *									the MAC (TCP_CHECKSUM_ON_COPY)
+ *                      10/18/26    Added TCPPutFragments()
+ *                      10/18/26    TCP_PIC_RAM FIFOs allocated per
+ *									connection (TCP_DYNAMIC_FIFOS)
+ *                      10/18/26    Added TCPPutMPFS()
+ *                      10/18/26    Added TCPHoldTX(), TCPUnput()
+ *									and TCPPokeArray()
+ *                      10/18/26    Single bytes found with memchr()
+ *                      10/18/26    AES-GCM SSL records, encrypted
+ *									in place in one pass
  ********************************************************************/
 #define __TCP_C
 
@@ -105,12 +124,42 @@
 #define TCP_MAX_SEG_SIZE_TX			(1460u)
 
 // TCP Maximum Segment Size for RX.  This value is advirtised during connection 
-// establishment and the remote node should obey it.  This should be set to 536 
-// to avoid IP layer fragmentation from causing packet loss.  However, raising 
-// its value can enhance performance at the (small) risk of introducing 
-// incompatibility with certain special remote nodes (ex: ones connected via a 
-// slow dial up modem).
-#define TCP_MAX_SEG_SIZE_RX			(536u)
+// establishment and the remote node should obey it.  1460 fills an Ethernet 
+// frame, so bulk uploads need about a third of the segments they need with 
+// the 536 byte default of RFC 879.  Lower it to 536 if the MAC RX buffers 
+// cannot hold a full frame or if remote nodes are reached through links with 
+// a smaller MTU (ex: some VPN or dial up links), since IP fragments are not 
+// reassembled.  Can be overridden in TCPIPConfig.h.
+#if !defined(TCP_MAX_SEG_SIZE_RX)
+	#define TCP_MAX_SEG_SIZE_RX		(1460u)
+#endif
+
+// RFC 7323 options offered in SYNs and accepted from the remote node.  Window 
+// scaling lets RX FIFOs larger than 64 KB be advirtised.  Timestamps give a 
+// round trip time sample with every ACK, including ACKs of retransmissions, 
+// and protect against old duplicate segments (PAWS), at a cost of 12 bytes 
+// in every segment.  Set to 0 in TCPIPConfig.h to disable.
+#if !defined(TCP_WINDOW_SCALE)
+	#define TCP_WINDOW_SCALE		(1u)
+#endif
+#if !defined(TCP_TIMESTAMPS)
+	#define TCP_TIMESTAMPS			(1u)
+#endif
+
+// Sum the data of outgoing segments while it is copied from a TX FIFO in 
+// PIC RAM to the MAC TX buffer, so that only the TCP header and options are 
+// read back to calculate the checksum.  Only possible where the MAC TX 
+// buffer is in PIC RAM; the other MACs calculate the checksum with their 
+// DMA engine.  May help on PIC32, which has no data cache, so the second 
+// pass reads every word again from RAM.  Slower on the host build, where 
+// memcpy() is vectorized and the second pass hits the cache; see 
+// TxBench.c.  Off by default; set to 1 in TCPIPConfig.h to enable.
+#if !defined(MAC_TX_BUFFER_IN_PIC_RAM)
+	#undef TCP_CHECKSUM_ON_COPY
+	#define TCP_CHECKSUM_ON_COPY		(0u)
+#elif !defined(TCP_CHECKSUM_ON_COPY)
+	#define TCP_CHECKSUM_ON_COPY		(0u)
+#endif
 
 // TCP Timeout and retransmit numbers
 #define TCP_START_TIMEOUT_VAL   	((DWORD)TICK_SECOND*1)	// Timeout to retransmit unacked data
@@ -128,6 +177,58 @@
 #define TCP_SYN_QUEUE_MAX_ENTRIES	(3u) 					// Number of TCP RX SYN packets to save if they cannot be serviced immediately
 #define TCP_SYN_QUEUE_TIMEOUT		((DWORD)TICK_SECOND*3)	// Timeout for when SYN queue entries are deleted if unserviceable
 
+// Retransmission timeout (RTO) limits.  The RTO is calculated from the 
+// measured round trip time as described in RFC 6298, starting at 
+// TCP_START_TIMEOUT_VAL until the first measurement, and doubles on each 
+// retry.  RFC 6298 recommends a 1 second minimum, but on a LAN that leaves 
+// the link idle for most of a second after each lost segment.  A smaller 
+// minimum recovers faster on a LAN, but risks needless retransmissions to 
+// peers that delay their ACKs until the round trip time measurements 
+// include the delay, so only lower it in TCPIPConfig.h for LAN-only 
+// applications.  See LossBench.c.
+#if !defined(TCP_MIN_RTO_VAL)
+	#define TCP_MIN_RTO_VAL			((DWORD)TICK_SECOND/5)	// Smallest retransmission timeout
+#endif
+#define TCP_MAX_RTO_VAL				((DWORD)TICK_SECOND*60)	// Largest retransmission timeout
+
+// Number of duplicate ACKs that trigger a fast retransmission (RFC 5681)
+#define TCP_DUP_ACK_THRESHOLD		(3u)
+
+// Smallest loss probe timeout.  When the last segments in flight are lost, 
+// or a fast retransmission is lost while the whole TX FIFO is in flight, no 
+// more duplicate ACKs arrive to recover the data.  A loss probe (RFC 8985 
+// section 7) retransmits the first hole as a fast retransmission after two 
+// round trip times without an ACK, instead of waiting for the retransmission 
+// timeout.  Can be overridden in TCPIPConfig.h.
+#if !defined(TCP_MIN_PTO_VAL)
+	#define TCP_MIN_PTO_VAL			((DWORD)TICK_SECOND/100)	// Smallest loss probe timeout
+#endif
+
+// Number of hash chains used to find the socket for an incoming segment.  
+// Every socket is chained in the bucket of its remoteHash, so a lookup only 
+// loads the stubs that share a bucket with the segment instead of all 
+// TCP_SOCKET_COUNT stubs.  Must be a power of 2.  Costs one byte of RAM per 
+// bucket plus one per socket.  Can be overridden in TCPIPConfig.h.
+#if !defined(TCP_HASH_BUCKETS)
+	#define TCP_HASH_BUCKETS		(16u)
+#endif
+#if (TCP_HASH_BUCKETS & (TCP_HASH_BUCKETS - 1)) || (TCP_HASH_BUCKETS > 256)
+	#error "TCP_HASH_BUCKETS must be a power of 2 no larger than 256"
+#endif
+
+// Allocate the FIFOs of TCP_PIC_RAM sockets only while they are connected.  
+// The TCBs are then an array at the start of TCP_PIC_RAM, one per socket of 
+// TCPSocketInitializer[], and the rest is a pool of FIFO space.  When a 
+// connection is opened or accepted, the socket takes the TX and RX FIFO 
+// sizes of its TCPSocketInitializer[] entry from the pool, and it gives them 
+// back when the connection closes.  An idle Telnet or FTP socket then leaves 
+// its buffer space to HTTP connections.  A SYN that finds no room is queued 
+// as if all listening sockets were busy.  TCP_PIC_RAM_SIZE must hold every 
+// TCB, but not every FIFO.  Can be overridden in TCPIPConfig.h.
+#if !defined(TCP_DYNAMIC_FIFOS)
+	#define TCP_DYNAMIC_FIFOS			(0u)
+#endif
+
 /****************************************************************************
   Section:
 	TCP Header Data Types
@@ -177,12 +278,14 @@ typedef struct
 #define TCP_OPTIONS_END_OF_LIST     (0x00u)		// End of List TCP Option Flag
 #define TCP_OPTIONS_NO_OP           (0x01u)		// No Op TCP Option
 #define TCP_OPTIONS_MAX_SEG_SIZE    (0x02u)		// Maximum segment size TCP flag
-typedef struct
-{
-	BYTE        Kind;							// Type of option
-	BYTE        Length;							// Length
-	WORD_VAL    MaxSegSize;						// Maximum segment size
-} TCP_OPTIONS;									// TCP Options data structure							
+#define TCP_OPTIONS_WINDOW_SCALE    (0x03u)		// Window scale TCP Option (RFC 7323)
+#define TCP_OPTIONS_SACK_PERMITTED  (0x04u)		// SACK permitted TCP Option (RFC 2018)
+#define TCP_OPTIONS_SACK            (0x05u)		// SACK TCP Option (RFC 2018)
+#define TCP_OPTIONS_TIMESTAMP       (0x08u)		// Timestamps TCP Option (RFC 7323)
+
+#define TCP_MAX_WINDOW_SHIFT        (14u)		// Largest window scale allowed by RFC 7323
+#define TCP_TIMESTAMP_OPTION_LEN    (12u)		// Two NOPs and the timestamps option, as sent in every segment
+#define TCP_MAX_OPTIONS_LEN         (40u)		// Longest options a TCP header can hold.  SACK blocks and timestamps may fill it.
 
 // Structure containing all the important elements of an incomming 
 // SYN packet in order to establish a connection at a future time 
@@ -245,6 +348,13 @@ static WORD NextPort __attribute__((persistent));	// Tracking variable for next
 
 static TCB MyTCB;									// Currently loaded TCB
 static TCP_SOCKET hCurrentTCP = INVALID_SOCKET;		// Current TCP socket
+
+// Hash chains of sockets by remoteHash.  Listening sockets are found in the 
+// bucket of their local port, connected sockets in the bucket of the 
+// (remote IP, remote port, local port) hash.  Chains end with INVALID_SOCKET.
+#define TCP_HASH_BUCKET(w)	((BYTE)((w) ^ ((w)>>8)) & (TCP_HASH_BUCKETS-1u))
+static TCP_SOCKET TCPHashHead[TCP_HASH_BUCKETS];	// First socket of each chain
+static TCP_SOCKET TCPHashNext[TCP_SOCKET_COUNT];	// Next socket in the same chain
 #if TCP_SYN_QUEUE_MAX_ENTRIES
 	#if defined(__18CXX) && !defined(HI_TECH_C)	
 		#pragma udata SYN_QUEUE_RAM_SECT
@@ -274,6 +384,30 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote);
 static void SwapTCPHeader(TCP_HEADER* header);
 static void CloseSocket(void);
 static void SyncTCB(void);
+static void SetRemoteHash(WORD wHash);
+static void ResetCongestionWindow(void);
+static WORD GetFlightSize(void);
+static WORD GetSendRoom(void);
+static WORD GetUnsentSize(PTR_BASE* pwHead);
+static DWORD GetRTO(void);
+static DWORD GetPTO(void);
+static void UpdateRTT(DWORD dwRTT);
+static BOOL GetNextHole(WORD* pwStart, WORD* pwEnd);
+static BOOL RetransmitLostSegment(void);
+#if TCP_SACK
+static void UpdateScoreboard(DWORD dwAckNumber);
+#endif
+static BYTE AddSACKBlock(TCP_SACK_BLOCK* pBlocks, BYTE vBlocks, WORD wStart, WORD wEnd);
+static BYTE ShiftSACKBlocks(TCP_SACK_BLOCK* pBlocks, BYTE vBlocks, WORD wShift);
+static WORD GetOutOfOrderEnd(void);
+static BYTE SeekOption(BYTE vKind, BYTE vLength);
+static BOOL GetTimestampOption(DWORD* pdwTSVal, DWORD* pdwTSEcr);
+#if TCP_DYNAMIC_FIFOS
+static BOOL ResizeSocket(WORD wTXSize, WORD wRXSize);
+#endif
+#if defined(STACK_USE_SSL) && defined(STACK_USE_AES_GCM)
+static PTR_BASE TCPSSLCopyTx(PTR_BASE pos, BYTE* data, WORD len, BOOL bWrite);
+#endif
 
 #if defined(WF_CS_TRIS)
 UINT16 WFGetTCBSize(void);
@@ -324,6 +458,19 @@ UINT16 WFGetTCBSize(void);
 
 
 
+// Address of the TCB of socket h, whose stub is stub.  With 
+// TCP_DYNAMIC_FIFOS the TCB of a TCP_PIC_RAM socket does not move with its 
+// FIFOs.
+#if TCP_DYNAMIC_FIFOS && TCP_PIC_RAM_SIZE > 0
+	#define TCB_ADDRESS(stub, h)	((stub).vMemoryMedium == TCP_PIC_RAM ? TCP_PIC_RAM_BASE_ADDRESS + (PTR_BASE)(h)*sizeof(TCB) : (stub).bufferTxStart - sizeof(TCB))
+
+	// First byte of the TCP_PIC_RAM FIFO pool.  Sockets without FIFOs 
+	// share the two bytes before it.
+	#define TCP_PIC_RAM_POOL_ADDRESS	(TCP_PIC_RAM_BASE_ADDRESS + TCP_SOCKET_COUNT*sizeof(TCB) + 2u)
+#else
+	#define TCB_ADDRESS(stub, h)	((stub).bufferTxStart - sizeof(TCB))
+#endif
+
 // Flushes MyTCB cache and loads up the specified TCB.
 // Does nothing on cache hit.
 static void SyncTCB(void)
@@ -336,12 +483,12 @@ static void SyncTCB(void)
 	if(hLastTCB != INVALID_SOCKET)
 	{
 		// Save the current TCB
-		TCPRAMCopy(TCBStubs[hLastTCB].bufferTxStart - sizeof(MyTCB), TCBStubs[hLastTCB].vMemoryMedium, (PTR_BASE)&MyTCB, TCP_PIC_RAM, sizeof(MyTCB));
+		TCPRAMCopy(TCB_ADDRESS(TCBStubs[hLastTCB], hLastTCB), TCBStubs[hLastTCB].vMemoryMedium, (PTR_BASE)&MyTCB, TCP_PIC_RAM, sizeof(MyTCB));
 	}
 
 	// Load up the new TCB
 	hLastTCB = hCurrentTCP;
-	TCPRAMCopy((PTR_BASE)&MyTCB, TCP_PIC_RAM, MyTCBStub.bufferTxStart - sizeof(MyTCB), MyTCBStub.vMemoryMedium, sizeof(MyTCB));
+	TCPRAMCopy((PTR_BASE)&MyTCB, TCP_PIC_RAM, TCB_ADDRESS(MyTCBStub, hCurrentTCP), MyTCBStub.vMemoryMedium, sizeof(MyTCB));
 }
 
 
@@ -380,7 +527,7 @@ void TCPInit(void)
 	#if TCP_ETH_RAM_SIZE > 0
 	WORD wCurrentETHAddress = TCP_ETH_RAM_BASE_ADDRESS;
 	#endif
-	#if TCP_PIC_RAM_SIZE > 0
+	#if TCP_PIC_RAM_SIZE > 0 && !TCP_DYNAMIC_FIFOS
 	PTR_BASE ptrCurrentPICAddress = TCP_PIC_RAM_BASE_ADDRESS;
 	#endif
 	#if TCP_SPI_RAM_SIZE > 0
@@ -402,6 +549,9 @@ void TCPInit(void)
 	#if TCP_SYN_QUEUE_MAX_ENTRIES
 		memset((void*)SYNQueue, 0x00, sizeof(SYNQueue));
 	#endif
+
+	// Empty all hash chains
+	memset((void*)TCPHashHead, INVALID_SOCKET, sizeof(TCPHashHead));
 	
 	// Allocate all socket FIFO addresses
 	vSocketsAllocated = 0;
@@ -413,6 +563,15 @@ void TCPInit(void)
 		vMedium = TCPSocketInitializer[i].vMemoryMedium;
 		wTXSize = TCPSocketInitializer[i].wTXBufferSize;
 		wRXSize = TCPSocketInitializer[i].wRXBufferSize;
+
+		// A TCP_PIC_RAM socket gets its FIFOs when it connects
+		#if TCP_DYNAMIC_FIFOS
+		if(vMedium == TCP_PIC_RAM)
+		{
+			wTXSize = 0;
+			wRXSize = 0;
+		}
+		#endif
 	
 		switch(vMedium)
 		{
@@ -432,11 +591,18 @@ void TCPInit(void)
 				
 			#if TCP_PIC_RAM_SIZE > 0
 			case TCP_PIC_RAM:
+				#if TCP_DYNAMIC_FIFOS
+				// The TCB is in the array at the start of TCP_PIC_RAM.  The 
+				// empty FIFOs are the two shared bytes before the pool.
+				ptrBaseAddress = TCP_PIC_RAM_POOL_ADDRESS - 2u - sizeof(TCB);
+				while(TCP_PIC_RAM_POOL_ADDRESS > TCP_PIC_RAM_BASE_ADDRESS + TCP_PIC_RAM_SIZE);
+				#else
 				ptrBaseAddress = ptrCurrentPICAddress;
 				ptrCurrentPICAddress += sizeof(TCB) + wTXSize+1 + wRXSize+1;
 				// Do a sanity check to ensure that we aren't going to use memory that hasn't been allocated to us.
 				// If your code locks up right here, it means you've incorrectly allocated your TCP socket buffers in TCPIPConfig.h.  See the TCP memory allocation section.  More RAM needs to be allocated to the base memory mediums, or the individual sockets TX and RX FIFOS and socket quantiy needs to be shrunken.
 				while(ptrCurrentPICAddress > TCP_PIC_RAM_BASE_ADDRESS + TCP_PIC_RAM_SIZE);
+				#endif
 				break;
 			#endif
 				
@@ -464,6 +630,12 @@ void TCPInit(void)
 		MyTCBStub.sslStubID = SSL_INVALID_ID;
 		#endif		
 
+		// Chain the socket under hash 0 so that CloseSocket() can move it 
+		// to the chain of its local port
+		MyTCBStub.remoteHash.Val = 0;
+		TCPHashNext[i] = TCPHashHead[0];
+		TCPHashHead[0] = i;
+
 		SyncTCB();
 		MyTCB.vSocketPurpose = TCPSocketInitializer[i].vSocketPurpose;
 		CloseSocket();
@@ -478,7 +650,7 @@ void TCPInit(void)
 
 /*****************************************************************************
   Function:
-	TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
+	TCP_SOCKET TCPOpen(DWORD_PTR_BASE dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
     
   Summary:
     Opens a TCP socket for listening or as a client.
@@ -582,16 +754,16 @@ void TCPInit(void)
     
     // Open a client socket to www.microchip.com
     // The double cast here prevents compiler warnings
-    skt = TCPOpen((DWORD)(PTR_BASE)"www.microchip.com",
+    skt = TCPOpen((DWORD_PTR_BASE)(PTR_BASE)"www.microchip.com",
                     TCP_OPEN_ROM_HOST, 80, TCP_PURPOSE_DEFAULT);
     
     // Reopen a client socket without repeating DNS or ARP
     SOCKET_INFO cache = TCPGetSocketInfo(skt);  // Call with the old socket
-    skt = TCPOpen((DWORD)(PTR_BASE)&amp;cache.remote, TCP_OPEN_NODE_INFO,
+    skt = TCPOpen((DWORD_PTR_BASE)(PTR_BASE)&amp;cache.remote, TCP_OPEN_NODE_INFO,
                     cache.remotePort.Val, TCP_PURPOSE_DEFAULT);
     </code>                                                    
   *****************************************************************************/
-TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
+TCP_SOCKET TCPOpen(DWORD_PTR_BASE dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
 {
 	TCP_SOCKET hTCP;
 
@@ -610,9 +782,17 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 		if(MyTCB.vSocketPurpose != vSocketPurpose)
 			continue;
 
+		// A client socket needs its FIFOs now.  A server socket gets them 
+		// when it accepts a connection.
+		#if TCP_DYNAMIC_FIFOS
+		if(vRemoteHostType != TCP_OPEN_SERVER && !ResizeSocket(TCPSocketInitializer[hTCP].wTXBufferSize, TCPSocketInitializer[hTCP].wRXBufferSize))
+			continue;
+		#endif
+
 		// Start out assuming worst case Maximum Segment Size (changes when MSS 
 		// option is received from remote node)
 		MyTCB.wRemoteMSS = 536;
+		ResetCongestionWindow();
 
 		// See if this is a server socket
 		if(vRemoteHostType == TCP_OPEN_SERVER)
@@ -620,7 +800,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 			MyTCB.localPort.Val = wPort;
 			MyTCBStub.Flags.bServer = TRUE;
 			MyTCBStub.smState = TCP_LISTEN;
-			MyTCBStub.remoteHash.Val = wPort;
+			SetRemoteHash(wPort);
 			#if defined(STACK_USE_SSL_SERVER)
 			MyTCB.localSSLPort.Val = 0;
 			#endif
@@ -658,7 +838,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 						// dwRemoteHost is a literal IP address.  This 
 						// doesn't need DNS and can skip directly to the 
 						// Gateway ARPing step.
-						MyTCBStub.remoteHash.Val = (((DWORD_VAL*)&dwRemoteHost)->w[1]+((DWORD_VAL*)&dwRemoteHost)->w[0] + wPort) ^ MyTCB.localPort.Val;
+						SetRemoteHash((((DWORD_VAL*)&dwRemoteHost)->w[1]+((DWORD_VAL*)&dwRemoteHost)->w[0] + wPort) ^ MyTCB.localPort.Val);
 						MyTCB.remote.niRemoteMACIP.IPAddr.Val = dwRemoteHost;
 						MyTCB.retryCount = 0;
 						MyTCB.retryInterval = (TICK_SECOND/4)/256;
@@ -666,7 +846,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 						break;
 		
 					case TCP_OPEN_NODE_INFO:
-						MyTCBStub.remoteHash.Val = (((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[1]+((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[0] + wPort) ^ MyTCB.localPort.Val;
+						SetRemoteHash((((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[1]+((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[0] + wPort) ^ MyTCB.localPort.Val);
 						memcpy((void*)(BYTE*)&MyTCB.remote, (void*)(BYTE*)(PTR_BASE)dwRemoteHost, sizeof(NODE_INFO));
 						MyTCBStub.smState = TCP_SYN_SENT;
 						SendTCP(SYN, SENDTCP_RESET_TIMERS);
@@ -828,6 +1008,8 @@ BOOL TCPIsConnected(TCP_SOCKET hTCP)
   ***************************************************************************/
 void TCPDisconnect(TCP_SOCKET hTCP)
 {
+	PTR_BASE txUnackedTail;
+
 	if(hTCP >= TCP_SOCKET_COUNT)
     {
         return;
@@ -876,11 +1058,13 @@ void TCPDisconnect(TCP_SOCKET hTCP)
 			// more data wating in the TX FIFO than can be sent in a single 
 			// packet (due to the remote Max Segment Size packet size limit), 
 			// we will keep generating more packets until either all data gets 
-			// transmitted or the remote node's receive window fills up.
+			// transmitted or the remote node's receive window or the 
+			// congestion window fills up.
 			do
 			{
+				txUnackedTail = MyTCB.txUnackedTail;
 				SendTCP(FIN | ACK, SENDTCP_RESET_TIMERS);
-				if(MyTCB.remoteWindow == 0u)
+				if((MyTCB.remoteWindow == 0u) || (MyTCB.txUnackedTail == txUnackedTail))
 					break;
 			} while(MyTCBStub.txHead != MyTCB.txUnackedTail);
 			
@@ -892,11 +1076,13 @@ void TCPDisconnect(TCP_SOCKET hTCP)
 			// more data wating in the TX FIFO than can be sent in a single 
 			// packet (due to the remote Max Segment Size packet size limit), 
 			// we will keep generating more packets until either all data gets 
-			// transmitted or the remote node's receive window fills up.
+			// transmitted or the remote node's receive window or the 
+			// congestion window fills up.
 			do
 			{
+				txUnackedTail = MyTCB.txUnackedTail;
 				SendTCP(FIN | ACK, SENDTCP_RESET_TIMERS);
-				if(MyTCB.remoteWindow == 0u)
+				if((MyTCB.remoteWindow == 0u) || (MyTCB.txUnackedTail == txUnackedTail))
 					break;
 			} while(MyTCBStub.txHead != MyTCB.txUnackedTail);
 
@@ -1041,7 +1227,8 @@ SOCKET_INFO* TCPGetRemoteInfo(TCP_SOCKET hTCP)
 
   Remarks:
 	SSL application data is automatically flushed, so this function has 
-	no effect for SSL sockets.
+	no effect for SSL sockets.  Nothing is sent while the socket is held
+	with TCPHoldTX().
   ***************************************************************************/
 void TCPFlush(TCP_SOCKET hTCP)
 {
@@ -1051,11 +1238,21 @@ void TCPFlush(TCP_SOCKET hTCP)
     }
     
 	SyncTCBStub(hTCP);
+
+	// Held data may still be rewritten by the application
+	if(MyTCBStub.Flags.bTXHold)
+	{
+		MyTCBStub.Flags.bTXHoldFlush = 1;
+		return;
+	}
+
 	SyncTCB();
 
 	// NOTE: Pending SSL data will NOT be transferred here
 
-	if(MyTCBStub.txHead != MyTCB.txUnackedTail)
+	// Nothing can be sent while the congestion window is full.  The data 
+	// goes out as ACKs open the window.
+	if((MyTCBStub.txHead != MyTCB.txUnackedTail) && (GetSendRoom() >= MyTCB.wRemoteMSS))
 	{
 		// Send the TCP segment with all unacked bytes
 		SendTCP(ACK, SENDTCP_RESET_TIMERS);
@@ -1115,8 +1312,8 @@ WORD TCPIsPutReady(TCP_SOCKET hTCP)
 			rem = MyTCBStub.txTail - MyTCBStub.sslTxHead - 1;
 			
 		// Reserve space for a new MAC and header
-		if(rem > 22u)
-			return rem - 22;
+		if(rem > SSL_TX_RESERVE)
+			return rem - SSL_TX_RESERVE;
 		else
 			return 0;
 	}
@@ -1445,6 +1642,248 @@ WORD TCPPutROMArray(TCP_SOCKET hTCP, ROM BYTE* data, WORD len)
 }
 #endif
 
+/*****************************************************************************
+  Function:
+	WORD TCPPutFragments(TCP_SOCKET hTCP, TX_FRAGMENT* pFragments, BYTE vCount)
+
+  Description:
+	Writes a list of fragments from RAM or ROM to a TCP socket, in order, 
+	as a single write.  An application can send a header and a payload held
+	in different buffers without assembling them first or calling 
+	TCPPutArray once for each, and the socket state, free space and 
+	transmit timers are only checked once.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to which data is to be written.
+	pFragments - The fragments to be written.
+	vCount - Number of fragments in pFragments.
+
+  Returns:
+	The number of bytes written to the socket.  If less than the total 
+	length of the fragments, the buffer became full or the socket is not 
+	conected.
+
+  Remarks:
+	The data is copied to the TX FIFO, which holds it until it is 
+	acknowledged, so the fragments only need to stay valid until this 
+	function returns.  Check TCPIsPutReady first to write a message 
+	completely or not at all.
+  ***************************************************************************/
+WORD TCPPutFragments(TCP_SOCKET hTCP, TX_FRAGMENT* pFragments, BYTE vCount)
+{
+	WORD wFreeTXSpace;
+	WORD wTotal, wLength, wOffset, wChunk;
+	PTR_BASE wHead;
+	BYTE i;
+
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return 0;
+    }
+    
+	SyncTCBStub(hTCP);
+
+	wFreeTXSpace = TCPIsPutReady(hTCP);
+	if(wFreeTXSpace == 0u)
+	{
+		TCPFlush(hTCP);
+		return 0;
+	}
+
+	// Send all current bytes if we are crossing half full
+	// This is required to improve performance with the delayed 
+	// acknowledgement algorithm
+	if((!MyTCBStub.Flags.bHalfFullFlush) && (wFreeTXSpace <= ((MyTCBStub.bufferRxStart-MyTCBStub.bufferTxStart)>>1)))
+	{
+		TCPFlush(hTCP);	
+		MyTCBStub.Flags.bHalfFullFlush = TRUE;
+	}
+
+	wHead = MyTCBStub.txHead;
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		wHead = MyTCBStub.sslTxHead;
+	#endif
+
+	wTotal = 0;
+	for(i = 0; (i < vCount) && (wTotal < wFreeTXSpace); i++)
+	{
+		wLength = pFragments[i].wLength;
+		if(wLength > wFreeTXSpace - wTotal)
+			wLength = wFreeTXSpace - wTotal;
+		wTotal += wLength;
+
+		// Copy in up to two parts, wrapping at the end of the TX FIFO
+		for(wOffset = 0; wOffset < wLength; wOffset += wChunk)
+		{
+			wChunk = wLength - wOffset;
+			if(wHead + wChunk >= MyTCBStub.bufferRxStart)
+				wChunk = MyTCBStub.bufferRxStart - wHead;
+
+			#if defined(__18CXX)
+			if(pFragments[i].bROM)
+				TCPRAMCopyROM(wHead, MyTCBStub.vMemoryMedium, pFragments[i].data.pROM + wOffset, wChunk);
+			else
+			#endif
+				TCPRAMCopy(wHead, MyTCBStub.vMemoryMedium, (PTR_BASE)(pFragments[i].data.pRAM + wOffset), TCP_PIC_RAM, wChunk);
+
+			wHead += wChunk;
+			if(wHead >= MyTCBStub.bufferRxStart)
+				wHead = MyTCBStub.bufferTxStart;
+		}
+	}
+
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		MyTCBStub.sslTxHead = wHead;
+	else
+	#endif
+		MyTCBStub.txHead = wHead;
+
+	// Send these bytes right now if we are out of TX buffer space
+	if(wTotal == wFreeTXSpace)
+	{
+		TCPFlush(hTCP);
+	}
+	// If not already enabled, start a timer so this data will 
+	// eventually get sent even if the application doens't call
+	// TCPFlush()
+	else if(!MyTCBStub.Flags.bTimer2Enabled)
+	{
+		MyTCBStub.Flags.bTimer2Enabled = TRUE;
+		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull;
+	}
+
+	return wTotal;
+}
+
+#if defined(STACK_USE_MPFS2)
+/*****************************************************************************
+  Function:
+	WORD TCPPutMPFS(TCP_SOCKET hTCP, MPFS_HANDLE hMPFS, WORD wLen)
+
+  Description:
+	Writes bytes from an open MPFS file to a TCP socket.  When the socket's 
+	TX FIFO is in PIC RAM, MPFSGetArray reads the file straight into the 
+	FIFO, so each byte is copied once instead of through a buffer on the 
+	stack.  Sockets in Ethernet or SPI RAM are written through a 64 byte 
+	buffer, as before.
+
+  Precondition:
+	TCP is initialized and hMPFS is open.
+
+  Parameters:
+	hTCP - The socket to which data is to be written.
+	hMPFS - The file from which data is to be read.
+	wLen - Number of bytes to be written.
+
+  Returns:
+	The number of bytes written to the socket.  If less than wLen, the 
+	buffer became full, the socket is not conected, or the end of the file 
+	was reached.
+
+  Remarks:
+	The file position advances by the number of bytes written.
+  ***************************************************************************/
+WORD TCPPutMPFS(TCP_SOCKET hTCP, MPFS_HANDLE hMPFS, WORD wLen)
+{
+	WORD wFreeTXSpace;
+	WORD wTotal, wChunk, wRead;
+	PTR_BASE wHead;
+	#if TCP_ETH_RAM_SIZE > 0 || TCP_SPI_RAM_SIZE > 0
+	BYTE vBuffer[64];
+	#endif
+
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return 0;
+    }
+    
+	SyncTCBStub(hTCP);
+
+	wFreeTXSpace = TCPIsPutReady(hTCP);
+	if(wFreeTXSpace == 0u)
+	{
+		TCPFlush(hTCP);
+		return 0;
+	}
+
+	// Send all current bytes if we are crossing half full
+	// This is required to improve performance with the delayed 
+	// acknowledgement algorithm
+	if((!MyTCBStub.Flags.bHalfFullFlush) && (wFreeTXSpace <= ((MyTCBStub.bufferRxStart-MyTCBStub.bufferTxStart)>>1)))
+	{
+		TCPFlush(hTCP);	
+		MyTCBStub.Flags.bHalfFullFlush = TRUE;
+	}
+
+	if(wLen > wFreeTXSpace)
+		wLen = wFreeTXSpace;
+
+	wHead = MyTCBStub.txHead;
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		wHead = MyTCBStub.sslTxHead;
+	#endif
+
+	// Read in up to two parts, wrapping at the end of the TX FIFO, until 
+	// the end of the file
+	for(wTotal = 0; wTotal < wLen; wTotal += wRead)
+	{
+		wChunk = wLen - wTotal;
+		if(wHead + wChunk >= MyTCBStub.bufferRxStart)
+			wChunk = MyTCBStub.bufferRxStart - wHead;
+
+		#if TCP_ETH_RAM_SIZE > 0 || TCP_SPI_RAM_SIZE > 0
+		if(MyTCBStub.vMemoryMedium != TCP_PIC_RAM)
+		{
+			if(wChunk > sizeof(vBuffer))
+				wChunk = sizeof(vBuffer);
+			wRead = MPFSGetArray(hMPFS, vBuffer, wChunk);
+			TCPRAMCopy(wHead, MyTCBStub.vMemoryMedium, (PTR_BASE)vBuffer, TCP_PIC_RAM, wRead);
+		}
+		else
+		#endif
+			wRead = MPFSGetArray(hMPFS, (BYTE*)wHead, wChunk);
+
+		wHead += wRead;
+		if(wHead >= MyTCBStub.bufferRxStart)
+			wHead = MyTCBStub.bufferTxStart;
+		if(wRead < wChunk)
+		{
+			wTotal += wRead;
+			break;
+		}
+	}
+
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		MyTCBStub.sslTxHead = wHead;
+	else
+	#endif
+		MyTCBStub.txHead = wHead;
+
+	// Send these bytes right now if we are out of TX buffer space
+	if(wTotal == wFreeTXSpace)
+	{
+		TCPFlush(hTCP);
+	}
+	// If not already enabled, start a timer so this data will 
+	// eventually get sent even if the application doens't call
+	// TCPFlush()
+	else if(!MyTCBStub.Flags.bTimer2Enabled)
+	{
+		MyTCBStub.Flags.bTimer2Enabled = TRUE;
+		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull;
+	}
+
+	return wTotal;
+}
+#endif
+
 /*****************************************************************************
   Function:
 	BYTE* TCPPutString(TCP_SOCKET hTCP, BYTE* data)
@@ -1550,83 +1989,252 @@ WORD TCPGetTxFIFOFull(TCP_SOCKET hTCP)
 	return wFIFOSize - wDataLen;
 }
 
-
-
-/****************************************************************************
-  Section:
-	Receive Functions
-  ***************************************************************************/
-
 /*****************************************************************************
   Function:
-	void TCPDiscard(TCP_SOCKET hTCP)
+	void TCPHoldTX(TCP_SOCKET hTCP, BOOL bHold)
+
+  Summary:
+	Holds new TX data in the FIFO so that it can still be rewritten.
 
   Description:
-	Discards any pending data in the TCP RX FIFO.
+	While a socket is held, TCPFlush() and the TCPPut functions transmit
+	nothing, so the bytes written since the last transmission can still
+	be changed with TCPPokeArray() or removed with TCPUnput().  This lets
+	an application reserve room for a length field, write data of unknown
+	length behind it, and fill in the length afterwards.  If TCPFlush() 
+	was called while the socket was held, for example by the TCPPut 
+	functions when the FIFO became half full, the data is flushed when 
+	the socket is released.
 
   Precondition:
 	TCP is initialized.
 
   Parameters:
-	hTCP - The socket whose RX FIFO is to be cleared.
+	hTCP - The socket to hold or release.
+	bHold - TRUE to hold the TX data, FALSE to release it.
 
   Returns:
 	None
+
+  Remarks:
+	The socket must be released before returning to the main stack loop,
+	since the automatic transmit timer is not held.
   ***************************************************************************/
-void TCPDiscard(TCP_SOCKET hTCP)
+void TCPHoldTX(TCP_SOCKET hTCP, BOOL bHold)
 {
-	if(TCPIsGetReady(hTCP))
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return;
+    }
+
+	SyncTCBStub(hTCP);
+	MyTCBStub.Flags.bTXHold = bHold;
+
+	// Send what would have been sent while held
+	if(!bHold && MyTCBStub.Flags.bTXHoldFlush)
 	{
-		SyncTCBStub(hTCP);
-	
-		// Delete all data in the RX buffer
-		MyTCBStub.rxTail = MyTCBStub.rxHead;
-	
-		// Send a Window update message to the remote node
-		SendTCP(ACK, SENDTCP_RESET_TIMERS);
+		MyTCBStub.Flags.bTXHoldFlush = 0;
+		TCPFlush(hTCP);
 	}
 }
 
-
 /*****************************************************************************
   Function:
-	void WORD TCPIsGetReady(TCP_SOCKET hTCP)
+	BOOL TCPUnput(TCP_SOCKET hTCP, WORD wLen)
 
   Summary:
-	Determines how many bytes can be read from the TCP RX buffer.
+	Removes the last bytes written to the TX FIFO.
 
   Description:
-	Call this function to determine how many bytes can be read from the 
-	TCP RX buffer.  If this function returns zero, the application must 
-	return to the main stack loop before continuing in order to wait for
-	more data to arrive.
+	Takes back the last wLen bytes written with the TCPPut functions,
+	provided none of them have been transmitted yet.
 
   Precondition:
 	TCP is initialized.
 
   Parameters:
-	hTCP - The socket to check.
+	hTCP - The socket whose data is to be removed.
+	wLen - Number of bytes to remove.
 
-  Returns:
-	The number of bytes available to be read from the TCP RX buffer.
+  Return Values:
+	TRUE - The bytes were removed.
+	FALSE - Some of the bytes were already transmitted, so nothing was
+		removed.
+
+  Remarks:
+	Use TCPHoldTX() to keep the data from being transmitted.
   ***************************************************************************/
-WORD TCPIsGetReady(TCP_SOCKET hTCP)
+BOOL TCPUnput(TCP_SOCKET hTCP, WORD wLen)
 {
+	PTR_BASE wHead;
+
 	if(hTCP >= TCP_SOCKET_COUNT)
     {
-        return 0;
+        return FALSE;
     }
-    
+
 	SyncTCBStub(hTCP);
-		
-	if(MyTCBStub.rxHead >= MyTCBStub.rxTail)
-		return MyTCBStub.rxHead - MyTCBStub.rxTail;
-	else
-		return (MyTCBStub.bufferEnd - MyTCBStub.rxTail + 1) + (MyTCBStub.rxHead - MyTCBStub.bufferRxStart);
-}
+	SyncTCB();
 
+	if(wLen > GetUnsentSize(&wHead))
+		return FALSE;
 
-/*****************************************************************************
+	wHead -= wLen;
+	if(wHead < MyTCBStub.bufferTxStart)
+		wHead += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		MyTCBStub.sslTxHead = wHead;
+	else
+	#endif
+		MyTCBStub.txHead = wHead;
+
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL TCPPokeArray(TCP_SOCKET hTCP, BYTE* data, WORD wLen, WORD wBack)
+
+  Summary:
+	Overwrites data already written to the TX FIFO.
+
+  Description:
+	Copies wLen bytes over the data in the TX FIFO, starting wBack bytes
+	before the next byte to be written.  This is the transmit counterpart
+	of TCPPeekArray(), and can be used to fill in a length field once the
+	data behind it has been written.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket whose data is to be changed.
+	data - Pointer to the new data.
+	wLen - Number of bytes to write.
+	wBack - Position of the first byte to write, counted back from the
+		head of the TX FIFO.  Must be at least wLen.
+
+  Return Values:
+	TRUE - The data was changed.
+	FALSE - Some of the bytes were already transmitted, or wLen exceeds
+		wBack, so nothing was changed.
+
+  Remarks:
+	Use TCPHoldTX() to keep the data from being transmitted.
+  ***************************************************************************/
+BOOL TCPPokeArray(TCP_SOCKET hTCP, BYTE* data, WORD wLen, WORD wBack)
+{
+	PTR_BASE wHead;
+	WORD wRightLen;
+
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return FALSE;
+    }
+
+	SyncTCBStub(hTCP);
+	SyncTCB();
+
+	if(wLen > wBack || wBack > GetUnsentSize(&wHead))
+		return FALSE;
+
+	wHead -= wBack;
+	if(wHead < MyTCBStub.bufferTxStart)
+		wHead += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+
+	// Copy in up to two parts, wrapping at the end of the TX FIFO
+	if(wHead + wLen > MyTCBStub.bufferRxStart)
+	{
+		wRightLen = MyTCBStub.bufferRxStart - wHead;
+		TCPRAMCopy(wHead, MyTCBStub.vMemoryMedium, (PTR_BASE)data, TCP_PIC_RAM, wRightLen);
+		data += wRightLen;
+		wLen -= wRightLen;
+		wHead = MyTCBStub.bufferTxStart;
+	}
+	TCPRAMCopy(wHead, MyTCBStub.vMemoryMedium, (PTR_BASE)data, TCP_PIC_RAM, wLen);
+
+	return TRUE;
+}
+
+
+
+/****************************************************************************
+  Section:
+	Receive Functions
+  ***************************************************************************/
+
+/*****************************************************************************
+  Function:
+	void TCPDiscard(TCP_SOCKET hTCP)
+
+  Description:
+	Discards any pending data in the TCP RX FIFO.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket whose RX FIFO is to be cleared.
+
+  Returns:
+	None
+  ***************************************************************************/
+void TCPDiscard(TCP_SOCKET hTCP)
+{
+	if(TCPIsGetReady(hTCP))
+	{
+		SyncTCBStub(hTCP);
+	
+		// Delete all data in the RX buffer
+		MyTCBStub.rxTail = MyTCBStub.rxHead;
+	
+		// Send a Window update message to the remote node
+		SendTCP(ACK, SENDTCP_RESET_TIMERS);
+	}
+}
+
+
+/*****************************************************************************
+  Function:
+	void WORD TCPIsGetReady(TCP_SOCKET hTCP)
+
+  Summary:
+	Determines how many bytes can be read from the TCP RX buffer.
+
+  Description:
+	Call this function to determine how many bytes can be read from the 
+	TCP RX buffer.  If this function returns zero, the application must 
+	return to the main stack loop before continuing in order to wait for
+	more data to arrive.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to check.
+
+  Returns:
+	The number of bytes available to be read from the TCP RX buffer.
+  ***************************************************************************/
+WORD TCPIsGetReady(TCP_SOCKET hTCP)
+{
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return 0;
+    }
+    
+	SyncTCBStub(hTCP);
+		
+	if(MyTCBStub.rxHead >= MyTCBStub.rxTail)
+		return MyTCBStub.rxHead - MyTCBStub.rxTail;
+	else
+		return (MyTCBStub.bufferEnd - MyTCBStub.rxTail + 1) + (MyTCBStub.rxHead - MyTCBStub.bufferRxStart);
+}
+
+
+/*****************************************************************************
   Function:
 	BOOL TCPGet(TCP_SOCKET hTCP, BYTE* byte)
 
@@ -1978,6 +2586,7 @@ WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, WORD wStart, W
 	BYTE i, j, k;
 	BOOL isFinding;
 	BYTE buffer[32];
+	BYTE *pFound;
 
 	if(hTCP >= TCP_SOCKET_COUNT || wLen == 0)
     {
@@ -2062,6 +2671,12 @@ WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, WORD wStart, W
 				}
 			}
 		}
+		else if(wLenStart == 1u)	// Find a single byte
+		{
+			pFound = memchr((void*)buffer, j, k);
+			if(pFound)
+				return ptrLocation + (WORD)(pFound - buffer);
+		}
 		else	// Compare as is
 		{
 			for(i = 0; i < k; i++)
@@ -2441,18 +3056,37 @@ void TCPTick(void)
 					{
 						// Set up our socket and generate a reponse SYN+ACK packet
 						SyncTCB();
+
+						// Leave the SYN in the queue until there is room for 
+						// the FIFOs
+						#if TCP_DYNAMIC_FIFOS
+						if(!ResizeSocket(TCPSocketInitializer[hTCP].wTXBufferSize, TCPSocketInitializer[hTCP].wRXBufferSize))
+							break;
+						#endif
 						
 						#if defined(STACK_USE_SSL_SERVER)
 						// If this matches the SSL port, make sure that can be configured
 						// before continuing.  If not, break and leave this in the queue
 						if(SYNQueue[w].wDestPort == MyTCBStub.sslTxHead && !TCPStartSSLServer(hTCP))
+						{
+							#if TCP_DYNAMIC_FIFOS
+							ResizeSocket(0, 0);
+							#endif
 							break;
+						}
 						#endif
 						
 						memcpy((void*)&MyTCB.remote.niRemoteMACIP, (void*)&SYNQueue[w].niSourceAddress, sizeof(NODE_INFO));
 						MyTCB.remotePort.Val = SYNQueue[w].wSourcePort;
 						MyTCB.RemoteSEQ = SYNQueue[w].dwSourceSEQ + 1;
-						MyTCBStub.remoteHash.Val = (MyTCB.remote.niRemoteMACIP.IPAddr.w[1] + MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val;
+
+						// The options of a queued SYN are not kept, so none 
+						// can be used in the SYN+ACK
+						MyTCB.flags.bWindowScale = 0;
+						MyTCB.flags.bTimestamps = 0;
+						MyTCB.flags.bSACK = 0;
+						MyTCB.vRxWindowShift = 0;
+						SetRemoteHash((MyTCB.remote.niRemoteMACIP.IPAddr.w[1] + MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val);
 						vFlags = SYN | ACK;
 						MyTCBStub.smState = TCP_SYN_RECEIVED;
 						
@@ -2520,6 +3154,29 @@ void TCPTick(void)
 		// Load up extended TCB information
 		SyncTCB();
 
+		// If the timer was started with the loss probe timeout, retransmit 
+		// the first hole as a fast retransmission.  The congestion window is 
+		// halved once per loss, as for duplicate ACKs, and the next timeout 
+		// is the retransmission timeout.
+		if(GetPTO())
+		{
+			MyTCB.flags.bProbeSent = 1;
+			if(!MyTCB.flags.bFastRecovery)
+			{
+				w = GetFlightSize()>>1;
+				MyTCB.wSSThresh = (w > MyTCB.wRemoteMSS<<1) ? w : MyTCB.wRemoteMSS<<1;
+				MyTCB.wCongWindow = MyTCB.wSSThresh;
+				MyTCB.dwRecover = MyTCB.MySEQ;
+				MyTCB.flags.bFastRecovery = 1;
+				MyTCB.flags.bRTTPending = 0;
+			}
+			#if TCP_SACK
+			MyTCB.wHighRxt = 0;
+			#endif
+			RetransmitLostSegment();
+			continue;
+		}
+
 		// A timeout has occured.  Respond to this timeout condition
 		// depending on what state this socket is in.
 		switch(MyTCBStub.smState)
@@ -2554,7 +3211,7 @@ void TCPTick(void)
 					{
 						MyTCB.remote.niRemoteMACIP.IPAddr.Val = ipResolvedDNSIP.Val;
 						MyTCBStub.smState = TCP_GATEWAY_SEND_ARP;
-						MyTCBStub.remoteHash.Val = (MyTCB.remote.niRemoteMACIP.IPAddr.w[1]+MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val;
+						SetRemoteHash((MyTCB.remote.niRemoteMACIP.IPAddr.w[1]+MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val);
 						MyTCB.retryCount = 0;
 						MyTCB.retryInterval = (TICK_SECOND/4)/256;
 					}
@@ -2736,11 +3393,34 @@ void TCPTick(void)
 				// Set the appropriate retry time
 				MyTCB.retryCount++;
 				MyTCB.retryInterval <<= 1;
+				if(MyTCB.retryInterval > TCP_MAX_RTO_VAL)
+					MyTCB.retryInterval = TCP_MAX_RTO_VAL;
 		
 				// Calculate how many bytes we have to roll back and retransmit
-				w = MyTCB.txUnackedTail - MyTCBStub.txTail;
-				if(MyTCB.txUnackedTail < MyTCBStub.txTail)
-					w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+				w = GetFlightSize();
+
+				// Data was lost: remember what was sent so far, shrink the 
+				// congestion window to one segment and restart slow start 
+				// (RFC 5681 section 3.1).  The slow start threshold is kept 
+				// when the same data times out again.
+				if(w)
+				{
+					if(MyTCB.retryCount == 1u)
+						MyTCB.wSSThresh = (w>>1 > MyTCB.wRemoteMSS<<1) ? w>>1 : MyTCB.wRemoteMSS<<1;
+					MyTCB.wCongWindow = MyTCB.wRemoteMSS;
+					if((LONG)(MyTCB.MySEQ - MyTCB.dwRecover) > 0)
+						MyTCB.dwRecover = MyTCB.MySEQ;
+					MyTCB.flags.bFastRecovery = 0;
+					MyTCB.flags.bRTTPending = 0;
+					MyTCB.vDupACKs = 0;
+
+					// The remote node may discard data it SACKed (RFC 2018), 
+					// so everything is sent again
+					#if TCP_SACK
+					MyTCB.vTxSACKed = 0;
+					MyTCB.wHighRxt = 0;
+					#endif
+				}
 				
 				// Perform roll back of local SEQuence counter, remote window 
 				// adjustment, and cause all unacknowledged data to be 
@@ -2928,10 +3608,21 @@ BOOL TCPProcess(NODE_INFO* remote, IP_ADDR* localIP, WORD len)
 static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 {
 	WORD_VAL        wVal;
+	DWORD_VAL		dwVal;
 	TCP_HEADER      header;
-	TCP_OPTIONS     options;
+	BYTE			vOptions[TCP_MAX_OPTIONS_LEN];
+	BYTE			vOptionsLen;
+	BYTE			vSACKLen;
+	BYTE			i;
 	PSEUDO_HEADER   pseudoHeader;
 	WORD 			len;
+	WORD			wCwnd;
+	WORD			wMSS;
+	DWORD			dwPTO;
+	#if TCP_CHECKSUM_ON_COPY
+	WORD			wDataSummed;
+	DWORD_VAL		dwDataSum;
+	#endif
 	
 	SyncTCB();
 
@@ -2954,7 +3645,96 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	//  Make sure that we can write to the MAC transmit area
 	while(!IPIsTxReady());
 
+	// Assemble the TCP options, which go between the header and the data.  
+	// The MSS (Maximum Segment Size), window scale and SACK permitted 
+	// options are only sent in SYN packets, the timestamps in every packet 
+	// once both nodes use them, and SACK blocks while out-of-order data is 
+	// held.
+	vOptionsLen = 0;
+	if(vTCPFlags & SYN)
+	{
+		vOptions[0] = TCP_OPTIONS_MAX_SEG_SIZE;
+		vOptions[1] = 4;
+		vOptions[2] = (BYTE)((TCP_MAX_SEG_SIZE_RX)>>8);
+		vOptions[3] = (BYTE)(TCP_MAX_SEG_SIZE_RX);
+		vOptionsLen = 4;
+		if(MyTCB.flags.bWindowScale)
+		{
+			vOptions[4] = TCP_OPTIONS_NO_OP;
+			vOptions[5] = TCP_OPTIONS_WINDOW_SCALE;
+			vOptions[6] = 3;
+			vOptions[7] = MyTCB.vRxWindowShift;
+			vOptionsLen = 8;
+		}
+		if(MyTCB.flags.bSACK && !MyTCB.flags.bTimestamps)
+		{
+			vOptions[vOptionsLen++] = TCP_OPTIONS_NO_OP;
+			vOptions[vOptionsLen++] = TCP_OPTIONS_NO_OP;
+			vOptions[vOptionsLen++] = TCP_OPTIONS_SACK_PERMITTED;
+			vOptions[vOptionsLen++] = 2;
+		}
+	}
+	if(MyTCB.flags.bTimestamps)
+	{
+		// In a SYN, the SACK permitted option takes the place of the NOPs
+		if((vTCPFlags & SYN) && MyTCB.flags.bSACK)
+		{
+			vOptions[vOptionsLen++] = TCP_OPTIONS_SACK_PERMITTED;
+			vOptions[vOptionsLen++] = 2;
+		}
+		else
+		{
+			vOptions[vOptionsLen++] = TCP_OPTIONS_NO_OP;
+			vOptions[vOptionsLen++] = TCP_OPTIONS_NO_OP;
+		}
+		vOptions[vOptionsLen++] = TCP_OPTIONS_TIMESTAMP;
+		vOptions[vOptionsLen++] = 10;
+
+		// TSval is our clock, TSecr echoes the remote node's latest TSval
+		dwVal.Val = TickGetDiv256();
+		vOptions[vOptionsLen++] = dwVal.v[3];
+		vOptions[vOptionsLen++] = dwVal.v[2];
+		vOptions[vOptionsLen++] = dwVal.v[1];
+		vOptions[vOptionsLen++] = dwVal.v[0];
+		dwVal.Val = MyTCB.dwTSRecent;
+		vOptions[vOptionsLen++] = dwVal.v[3];
+		vOptions[vOptionsLen++] = dwVal.v[2];
+		vOptions[vOptionsLen++] = dwVal.v[1];
+		vOptions[vOptionsLen++] = dwVal.v[0];
+	}
+	vSACKLen = 0;
+	if(MyTCB.flags.bSACK && MyTCB.vRxBlocks && !(vTCPFlags & SYN))
+	{
+		// Report the out-of-order blocks, most recently received first, 
+		// as many as fit
+		i = (TCP_MAX_OPTIONS_LEN - 4u - vOptionsLen)>>3;
+		if(i > MyTCB.vRxBlocks)
+			i = MyTCB.vRxBlocks;
+		vSACKLen = 4u + (i<<3);
+		vOptions[vOptionsLen++] = TCP_OPTIONS_NO_OP;
+		vOptions[vOptionsLen++] = TCP_OPTIONS_NO_OP;
+		vOptions[vOptionsLen++] = TCP_OPTIONS_SACK;
+		vOptions[vOptionsLen++] = vSACKLen - 2u;
+		for(i = 0; i < (vSACKLen>>3); i++)
+		{
+			dwVal.Val = MyTCB.RemoteSEQ + MyTCB.rxBlocks[i].wStart;
+			vOptions[vOptionsLen++] = dwVal.v[3];
+			vOptions[vOptionsLen++] = dwVal.v[2];
+			vOptions[vOptionsLen++] = dwVal.v[1];
+			vOptions[vOptionsLen++] = dwVal.v[0];
+			dwVal.Val = MyTCB.RemoteSEQ + MyTCB.rxBlocks[i].wEnd;
+			vOptions[vOptionsLen++] = dwVal.v[3];
+			vOptions[vOptionsLen++] = dwVal.v[2];
+			vOptions[vOptionsLen++] = dwVal.v[1];
+			vOptions[vOptionsLen++] = dwVal.v[0];
+		}
+	}
+
 	// Put all socket application data in the TX space
+	#if TCP_CHECKSUM_ON_COPY
+	wDataSummed = 0;
+	dwDataSum.Val = 0;
+	#endif
 	if(vTCPFlags & (SYN | RST))
 	{
 		// Don't put any data in SYN and RST messages
@@ -2962,6 +3742,12 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	}
 	else
 	{
+		// Room left in the congestion window
+		wCwnd = GetSendRoom();
+
+		// SACK blocks take room from the data, so that the frame still fits
+		wMSS = MyTCB.wRemoteMSS - vSACKLen;
+
 		// Begin copying any application data over to the TX space
 		if(MyTCBStub.txHead == MyTCB.txUnackedTail)
 		{
@@ -2975,14 +3761,26 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 			if(len > MyTCB.remoteWindow)
 				len = MyTCB.remoteWindow;
 
-			if(len > MyTCB.wRemoteMSS)
+			// Only send whole segments when the congestion window is the limit
+			if(len > wCwnd)
+				len = wCwnd - wCwnd % MyTCB.wRemoteMSS;
+
+			if(len > wMSS)
 			{
-				len = MyTCB.wRemoteMSS;
+				len = wMSS;
 				MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
 			}
 
 			// Copy application data into the raw TX buffer
-			TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, len);
+			#if TCP_CHECKSUM_ON_COPY
+			if(MyTCBStub.vMemoryMedium == TCP_PIC_RAM)
+			{
+				dwDataSum.Val = (WORD)~CalcIPChecksumCopy((BYTE*)(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+vOptionsLen), (BYTE*)MyTCB.txUnackedTail, len);
+				wDataSummed = len;
+			}
+			else
+			#endif
+			TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+vOptionsLen, TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, len);
 			MyTCB.txUnackedTail += len;
 		}
 		else
@@ -2993,9 +3791,13 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 			if(len > MyTCB.remoteWindow)
 				len = MyTCB.remoteWindow;
 
-			if(len > MyTCB.wRemoteMSS)
+			// Only send whole segments when the congestion window is the limit
+			if(len > wCwnd)
+				len = wCwnd - wCwnd % MyTCB.wRemoteMSS;
+
+			if(len > wMSS)
 			{
-				len = MyTCB.wRemoteMSS;
+				len = wMSS;
 				MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
 			}
 
@@ -3003,13 +3805,33 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 				pseudoHeader.Length = len;
 
 			// Copy application data into the raw TX buffer
-			TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+			#if TCP_CHECKSUM_ON_COPY
+			if(MyTCBStub.vMemoryMedium == TCP_PIC_RAM)
+			{
+				dwDataSum.Val = (WORD)~CalcIPChecksumCopy((BYTE*)(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+vOptionsLen), (BYTE*)MyTCB.txUnackedTail, pseudoHeader.Length);
+				wDataSummed = len;
+			}
+			else
+			#endif
+			TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+vOptionsLen, TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
 			pseudoHeader.Length = len - pseudoHeader.Length;
 	
 			// Copy any left over chunks of application data over
 			if(pseudoHeader.Length)
 			{
-				TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+(MyTCBStub.bufferRxStart-MyTCB.txUnackedTail), TCP_ETH_RAM, MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+				#if TCP_CHECKSUM_ON_COPY
+				if(MyTCBStub.vMemoryMedium == TCP_PIC_RAM)
+				{
+					// A chunk starting at an odd offset in the segment has 
+					// its bytes swapped relative to the first one
+					wVal.Val = ~CalcIPChecksumCopy((BYTE*)(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+vOptionsLen+(MyTCBStub.bufferRxStart-MyTCB.txUnackedTail)), (BYTE*)MyTCBStub.bufferTxStart, pseudoHeader.Length);
+					if((MyTCBStub.bufferRxStart-MyTCB.txUnackedTail) & 0x1u)
+						wVal.Val = swaps(wVal.Val);
+					dwDataSum.Val += wVal.Val;
+				}
+				else
+				#endif
+				TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+vOptionsLen+(MyTCBStub.bufferRxStart-MyTCB.txUnackedTail), TCP_ETH_RAM, MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
 			}
 
 			MyTCB.txUnackedTail += len;
@@ -3020,7 +3842,7 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		// If we are to transmit a FIN, make sure we can put one in this packet
 		if(MyTCBStub.Flags.bTXFIN)
 		{
-			if((len != MyTCB.remoteWindow) && (len != MyTCB.wRemoteMSS))
+			if((MyTCB.txUnackedTail == MyTCBStub.txHead) && (len != MyTCB.remoteWindow) && (len != MyTCB.wRemoteMSS))
 				vTCPFlags |= FIN;
 		}
 	}
@@ -3042,10 +3864,27 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		if(vSendFlags & SENDTCP_RESET_TIMERS)
 		{
 			MyTCB.retryCount = 0;
-			MyTCB.retryInterval = TCP_START_TIMEOUT_VAL;
+			MyTCB.retryInterval = GetRTO();
 		}	
 
-		MyTCBStub.eventTime = TickGet() + MyTCB.retryInterval;
+		#if defined(DEBUG_COUNT_TX_RETRANSMITS)
+		// Count the data that was sent before the last loss was detected
+		if(len && ((LONG)(MyTCB.MySEQ - MyTCB.dwRecover) < 0))
+			DEBUG_COUNT_TX_RETRANSMITS += (MyTCB.dwRecover - MyTCB.MySEQ < len) ? MyTCB.dwRecover - MyTCB.MySEQ : len;
+		#endif
+
+		// Without timestamps, time one segment at a time to measure the 
+		// round trip time.  Data below dwRecover may be a retransmission 
+		// and is never timed (Karn's algorithm).
+		if(len && !MyTCB.flags.bTimestamps && !MyTCB.flags.bRTTPending && ((LONG)(MyTCB.MySEQ - MyTCB.dwRecover) >= 0))
+		{
+			MyTCB.flags.bRTTPending = 1;
+			MyTCB.dwRTTSEQ = MyTCB.MySEQ + len;
+			MyTCB.dwRTTStart = TickGet();
+		}
+
+		dwPTO = GetPTO();
+		MyTCBStub.eventTime = TickGet() + (dwPTO ? dwPTO : MyTCB.retryInterval);
 		MyTCBStub.Flags.bTimerEnabled = 1;
 	}
 	else if(vSendFlags & SENDTCP_KEEP_ALIVE)
@@ -3057,7 +3896,7 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		MyTCB.MySEQ -= 1;
 		len = 1;
 	}
-	else if(MyTCBStub.Flags.bTimerEnabled) 
+	else if(MyTCBStub.Flags.bTimerEnabled && (MyTCB.remoteWindow == 0u)) 
 	{
 		// If we have data to transmit, but the remote RX window is zero, 
 		// so we aren't transmitting any right now then make sure to not 
@@ -3113,9 +3952,9 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 
 	// Calculate the amount of free space in the RX buffer area of this socket
 	if(MyTCBStub.rxHead >= MyTCBStub.rxTail)
-		header.Window = (MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart) - (MyTCBStub.rxHead - MyTCBStub.rxTail);
+		dwVal.Val = (MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart) - (MyTCBStub.rxHead - MyTCBStub.rxTail);
 	else
-		header.Window = MyTCBStub.rxTail - MyTCBStub.rxHead - 1;
+		dwVal.Val = MyTCBStub.rxTail - MyTCBStub.rxHead - 1;
 
 	// Calculate the amount of free space in the MAC RX buffer area and adjust window if needed
 	wVal.Val = MACGetFreeRxSize();
@@ -3128,27 +3967,19 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		wVal.Val -= 64;
     }
 	// Force the remote node to throttle back if we are running low on general RX buffer space
-	if(header.Window > wVal.Val)
-		header.Window = wVal.Val;
-
-	SwapTCPHeader(&header);
+	if(dwVal.Val > wVal.Val)
+		dwVal.Val = wVal.Val;
 
+	// The window in a SYN is never scaled (RFC 7323)
+	if(!(vTCPFlags & SYN))
+		dwVal.Val >>= MyTCB.vRxWindowShift;
+	header.Window = (dwVal.Val > 0xFFFFul) ? 0xFFFF : dwVal.w[0];
 
-	len += sizeof(header);
-	header.DataOffset.Val   = sizeof(header) >> 2;
-
-	// Insert the MSS (Maximum Segment Size) TCP option if this is SYN packet
-	if(vTCPFlags & SYN)
-	{
-		len += sizeof(options);
-		options.Kind = TCP_OPTIONS_MAX_SEG_SIZE;
-		options.Length = 0x04;
+	SwapTCPHeader(&header);
 
-		// Load MSS and swap to big endian
-		options.MaxSegSize.Val = (((TCP_MAX_SEG_SIZE_RX)&0x00FF)<<8) | (((TCP_MAX_SEG_SIZE_RX)&0xFF00)>>8);
 
-		header.DataOffset.Val   += sizeof(options) >> 2;
-	}
+	len += sizeof(header) + vOptionsLen;
+	header.DataOffset.Val   = (sizeof(header) + vOptionsLen) >> 2;
 
 	// Calculate IP pseudoheader checksum.
 	pseudoHeader.SourceAddress	= AppConfig.MyIPAddr;
@@ -3158,17 +3989,28 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	pseudoHeader.Length			= len;
 	SwapPseudoHeader(pseudoHeader);
 	header.Checksum = ~CalcIPChecksum((BYTE*)&pseudoHeader, sizeof(pseudoHeader));
+	#if TCP_CHECKSUM_ON_COPY
+	// Add the sum of the data, taken while it was copied, so that only the 
+	// header and options are summed below
+	dwDataSum.Val += header.Checksum;
+	dwDataSum.Val = (DWORD)dwDataSum.w[0] + (DWORD)dwDataSum.w[1];
+	header.Checksum = dwDataSum.w[0] + dwDataSum.w[1];
+	#endif
 
 	// Write IP header
 	MACSetWritePtr(BASE_TX_ADDR + sizeof(ETHER_HEADER));
 	IPPutHeader(&MyTCB.remote.niRemoteMACIP, IP_PROT_TCP, len);
 	MACPutArray((BYTE*)&header, sizeof(header));
-	if(vTCPFlags & SYN)
-		MACPutArray((BYTE*)&options, sizeof(options));
+	if(vOptionsLen)
+		MACPutArray(vOptions, vOptionsLen);
 
 	// Update the TCP checksum
 	MACSetReadPtr(BASE_TX_ADDR + sizeof(ETHER_HEADER) + sizeof(IP_HEADER));
+	#if TCP_CHECKSUM_ON_COPY
+	wVal.Val = CalcIPBufferChecksum(len - wDataSummed);
+	#else
 	wVal.Val = CalcIPBufferChecksum(len);
+	#endif
 #if defined(DEBUG_GENERATE_TX_LOSS)
 	// Damage TCP checksums on TX packets randomly
 	if(LFSRRand() > DEBUG_GENERATE_TX_LOSS)
@@ -3196,6 +4038,10 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	index is saved in hCurrentTCP and the associated MyTCBStub and MyTCB are
 	loaded. Otherwise, INVALID_SOCKET is placed in hCurrentTCP.
 	
+	Only the hash chain of the segment's connection hash and the hash chain 
+	of its destination port are searched, so the cost does not grow with 
+	TCP_SOCKET_COUNT as long as TCP_HASH_BUCKETS is large enough.
+	
   Precondition:
 	TCP is initialized.
 
@@ -3220,34 +4066,15 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 	partialMatch = INVALID_SOCKET;
 	hash = (remote->IPAddr.w[1]+remote->IPAddr.w[0] + h->SourcePort) ^ h->DestPort;
 
-	// Loop through all sockets looking for a socket that is expecting this 
-	// packet or can handle it.
-	for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++ )
+	// Look for a connected socket that is expecting this packet
+	for(hTCP = TCPHashHead[TCP_HASH_BUCKET(hash)]; hTCP != INVALID_SOCKET; hTCP = TCPHashNext[hTCP])
 	{
 		SyncTCBStub(hTCP);
 
-		if(MyTCBStub.smState == TCP_CLOSED)
-		{
-			continue;
-		}
-		else if(MyTCBStub.smState == TCP_LISTEN)
-		{// For listening ports, check if this is the correct port
-			if(MyTCBStub.remoteHash.Val == h->DestPort)
-				partialMatch = hTCP;
-			
-			#if defined(STACK_USE_SSL_SERVER)
-			// Check the SSL port as well for SSL Servers
-			// 0 is defined as an invalid port number
-			if(MyTCBStub.sslTxHead == h->DestPort)
-				partialMatch = hTCP;
-			#endif
-			
-			continue;
-		}
-		else if(MyTCBStub.remoteHash.Val != hash)
-		{// Ignore if the hash doesn't match
+		// Ignore if the hash doesn't match (the bucket is shared) or if 
+		// the socket isn't connected
+		if(MyTCBStub.remoteHash.Val != hash || MyTCBStub.smState == TCP_CLOSED || MyTCBStub.smState == TCP_LISTEN)
 			continue;
-		}
 
 		SyncTCB();
 		if(	h->DestPort == MyTCB.localPort.Val &&
@@ -3258,6 +4085,36 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 		}
 	}
 
+	// Look for a socket listening on the destination port.  The 
+	// remoteHash of a listening socket is its local port.
+	for(hTCP = TCPHashHead[TCP_HASH_BUCKET(h->DestPort)]; hTCP != INVALID_SOCKET; hTCP = TCPHashNext[hTCP])
+	{
+		SyncTCBStub(hTCP);
+		if(MyTCBStub.smState == TCP_LISTEN && MyTCBStub.remoteHash.Val == h->DestPort)
+		{
+			partialMatch = hTCP;
+			break;
+		}
+	}
+
+	#if defined(STACK_USE_SSL_SERVER)
+	// Check the SSL port as well for SSL Servers.  These are not chained by 
+	// their SSL port, so search all sockets.
+	// 0 is defined as an invalid port number
+	if(partialMatch == INVALID_SOCKET)
+	{
+		for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++)
+		{
+			SyncTCBStub(hTCP);
+			if(MyTCBStub.smState == TCP_LISTEN && MyTCBStub.sslTxHead == h->DestPort)
+			{
+				partialMatch = hTCP;
+				break;
+			}
+		}
+	}
+	#endif
+
 
 	// If there is a partial match, then a listening socket is currently 
 	// available.  Set up the extended TCB with the info needed 
@@ -3267,15 +4124,27 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 	{
 		SyncTCBStub(partialMatch);
 		SyncTCB();
+
+		// A SYN needs the FIFOs of the new connection.  If there is no 
+		// room for them, the SYN is queued below.
+		#if TCP_DYNAMIC_FIFOS
+		if(h->Flags.bits.flagSYN && !ResizeSocket(TCPSocketInitializer[partialMatch].wTXBufferSize, TCPSocketInitializer[partialMatch].wRXBufferSize))
+			partialMatch = INVALID_SOCKET;
+		#endif
 	
 		// For SSL ports, begin the SSL Handshake
 		#if defined(STACK_USE_SSL_SERVER)
-		if(MyTCBStub.sslTxHead == h->DestPort)
+		if(partialMatch != INVALID_SOCKET && MyTCBStub.sslTxHead == h->DestPort)
 		{
 			// Try to start an SSL session.  If no stubs are available,
 			// we can't service this request right now, so ignore it.
 			if(!TCPStartSSLServer(partialMatch))
+			{
 				partialMatch = INVALID_SOCKET;
+				#if TCP_DYNAMIC_FIFOS
+				ResizeSocket(0, 0);
+				#endif
+			}
 		}
 		#endif
 	
@@ -3284,7 +4153,7 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 		// and add to the SYN queue.
 		if(partialMatch != INVALID_SOCKET)
 		{
-			MyTCBStub.remoteHash.Val = hash;
+			SetRemoteHash(hash);
 		
 			memcpy((void*)&MyTCB.remote, (void*)remote, sizeof(NODE_INFO));
 			MyTCB.remotePort.Val = h->SourcePort;
@@ -3403,174 +4272,1055 @@ static void SwapTCPHeader(TCP_HEADER* header)
 
 /*****************************************************************************
   Function:
-	static void CloseSocket(void)
+	static void SetRemoteHash(WORD wHash)
+
+  Summary:
+	Sets the remoteHash of the current socket.
+
+  Description:
+	This function sets MyTCBStub.remoteHash and moves the socket to the 
+	hash chain of the new value, so that FindMatchingSocket() can find it.  
+	remoteHash must not be written directly.
+
+  Precondition:
+	The TCPStub corresponding to the socket is synced.
+
+  Parameters:
+	wHash - Local port for listening sockets, or the hash of the remote 
+		IP address, remote port and local port for other sockets
+
+  Returns:
+	None
+  ***************************************************************************/
+static void SetRemoteHash(WORD wHash)
+{
+	TCP_SOCKET *p;
+	BYTE vOld, vNew;
+
+	vOld = TCP_HASH_BUCKET(MyTCBStub.remoteHash.Val);
+	vNew = TCP_HASH_BUCKET(wHash);
+	MyTCBStub.remoteHash.Val = wHash;
+	if(vOld == vNew)
+		return;
+
+	// Unlink from the old chain
+	for(p = &TCPHashHead[vOld]; *p != hCurrentTCP; p = &TCPHashNext[*p]);
+	*p = TCPHashNext[hCurrentTCP];
+
+	// Insert at the head of the new chain
+	TCPHashNext[hCurrentTCP] = TCPHashHead[vNew];
+	TCPHashHead[vNew] = hCurrentTCP;
+}
+
+/*****************************************************************************
+  Function:
+	static void CloseSocket(void)
+
+  Summary:
+	Closes a TCP socket.
+
+  Description:
+	This function closes a TCP socket.  All socket state information is 
+	reset, and any buffered bytes are discarded.  The socket is no longer
+	accessible by the application after this point.
+
+  Precondition:
+	The TCPStub corresponding to the socket to be closed is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void CloseSocket(void)
+{
+	#if defined(STACK_USE_SSL)
+	WORD wSSLPort;
+	#endif
+
+	SyncTCB();
+
+	// Give the FIFOs back, keeping only the TCB
+	#if TCP_DYNAMIC_FIFOS
+	if(MyTCBStub.bufferEnd - MyTCBStub.bufferTxStart > 1u)
+		ResizeSocket(0, 0);
+	#endif
+
+	MyTCBStub.txHead = MyTCBStub.bufferTxStart;
+	MyTCBStub.txTail = MyTCBStub.bufferTxStart;
+	MyTCBStub.rxHead = MyTCBStub.bufferRxStart;
+	MyTCBStub.rxTail = MyTCBStub.bufferRxStart;
+	MyTCBStub.smState = MyTCBStub.Flags.bServer ? TCP_LISTEN : TCP_CLOSED;
+	MyTCBStub.Flags.vUnackedKeepalives = 0;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	MyTCBStub.Flags.bTimer2Enabled = 0;
+	MyTCBStub.Flags.bDelayedACKTimerEnabled = 0;
+	MyTCBStub.Flags.bOneSegmentReceived = 0;
+	MyTCBStub.Flags.bHalfFullFlush = 0;
+	MyTCBStub.Flags.bTXASAP = 0;
+	MyTCBStub.Flags.bTXASAPWithoutTimerReset = 0;
+	MyTCBStub.Flags.bTXFIN = 0;
+	MyTCBStub.Flags.bTXHold = 0;
+	MyTCBStub.Flags.bTXHoldFlush = 0;
+	MyTCBStub.Flags.bSocketReset = 1;
+
+	#if defined(STACK_USE_SSL)
+	// If SSL is active, then we need to close it
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+	{
+		SSLTerminate(MyTCBStub.sslStubID);
+		MyTCBStub.sslStubID = SSL_INVALID_ID;
+
+		// Swap the SSL port and local port back to proper values
+		wSSLPort = MyTCB.localSSLPort.Val;
+		MyTCB.localSSLPort.Val = MyTCB.localPort.Val;
+		MyTCB.localPort.Val = wSSLPort;
+	}
+
+	// Reset the SSL buffer pointers
+	MyTCBStub.sslRxHead = MyTCBStub.bufferRxStart;
+	MyTCBStub.sslTxHead = MyTCBStub.bufferTxStart;
+	#endif
+	
+	#if defined(STACK_USE_SSL_SERVER)
+	MyTCBStub.sslTxHead = MyTCB.localSSLPort.Val;
+	#endif
+
+	SetRemoteHash(MyTCB.localPort.Val);
+
+	MyTCB.flags.bFINSent = 0;
+	MyTCB.flags.bSYNSent = 0;
+	MyTCB.flags.bFastRecovery = 0;
+	MyTCB.flags.bRTTPending = 0;
+	MyTCB.flags.bProbeSent = 0;
+	MyTCB.vDupACKs = 0;
+	MyTCB.dwSRTT = 0;
+	MyTCB.dwRTTVar = 0;
+	MyTCB.dwTSRecent = 0;
+
+	// Offer the RFC 7323 options in our SYN, with the smallest window scale 
+	// that can advirtise the whole RX FIFO
+	MyTCB.flags.bWindowScale = TCP_WINDOW_SCALE;
+	MyTCB.flags.bTimestamps = TCP_TIMESTAMPS;
+	MyTCB.flags.bSACK = TCP_SACK;
+	MyTCB.vTxWindowShift = 0;
+	MyTCB.vRxWindowShift = 0;
+	while((((DWORD)(MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart) >> MyTCB.vRxWindowShift) > 0xFFFFul) && (MyTCB.vRxWindowShift < TCP_MAX_WINDOW_SHIFT))
+		MyTCB.vRxWindowShift++;
+
+	MyTCB.txUnackedTail = MyTCBStub.bufferTxStart;
+	((DWORD_VAL*)(&MyTCB.MySEQ))->w[0] = LFSRRand();
+	((DWORD_VAL*)(&MyTCB.MySEQ))->w[1] = LFSRRand();
+	MyTCB.dwRecover = MyTCB.MySEQ;
+	MyTCB.vRxBlocks = 0;
+	#if TCP_SACK
+	MyTCB.vTxSACKed = 0;
+	MyTCB.wHighRxt = 0;
+	#endif
+	MyTCB.remoteWindow = 1;
+	ResetCongestionWindow();
+}
+
+#if TCP_DYNAMIC_FIFOS
+/*****************************************************************************
+  Function:
+	static BOOL ResizeSocket(WORD wTXSize, WORD wRXSize)
+
+  Summary:
+	Gives a TCP_PIC_RAM socket new, empty FIFOs of the given sizes.
+
+  Description:
+	This function takes the lowest gap of the TCP_PIC_RAM FIFO pool that 
+	holds the requested TX and RX FIFOs, ignoring the FIFOs the socket has 
+	now.  With sizes of 0 the socket gives its FIFOs back to the pool.  A 
+	socket in any other medium keeps the FIFOs that TCPInit() gave it.
+
+  Precondition:
+	The TCPStub corresponding to the socket is synced.
+
+  Parameters:
+	wTXSize - Size of the TX FIFO, in bytes
+	wRXSize - Size of the RX FIFO, in bytes
+
+  Returns:
+	TRUE - The socket has the requested FIFOs
+	FALSE - There is no gap large enough and the socket is unchanged
+
+  Remarks:
+	Any data in the FIFOs is discarded, so this is only called when the 
+	socket is closed or about to connect.  The search takes O(n^2) stub 
+	reads in the worst case, where n is TCP_SOCKET_COUNT.
+  ***************************************************************************/
+static BOOL ResizeSocket(WORD wTXSize, WORD wRXSize)
+{
+	#if TCP_PIC_RAM_SIZE > 0
+	PTR_BASE ptrStart, ptrEnd;
+	TCP_SOCKET i;
+
+	if(MyTCBStub.vMemoryMedium != TCP_PIC_RAM)
+		return TRUE;
+
+	SyncTCB();
+
+	if(wTXSize == 0u && wRXSize == 0u)
+	{
+		ptrStart = TCP_PIC_RAM_POOL_ADDRESS - 2u;
+	}
+	else
+	{
+		// First fit: whenever the candidate overlaps the FIFOs of another 
+		// socket, move it past them and check all sockets again
+		ptrStart = TCP_PIC_RAM_POOL_ADDRESS;
+		ptrEnd = ptrStart + wTXSize+1 + wRXSize+1;
+		for(i = 0; i < TCP_SOCKET_COUNT; i++)
+		{
+			if(i == hCurrentTCP || TCBStubs[i].vMemoryMedium != TCP_PIC_RAM)
+				continue;
+			if(TCBStubs[i].bufferTxStart >= ptrEnd || TCBStubs[i].bufferEnd < ptrStart)
+				continue;
+
+			ptrStart = TCBStubs[i].bufferEnd + 1;
+			ptrEnd = ptrStart + wTXSize+1 + wRXSize+1;
+			if(ptrEnd > TCP_PIC_RAM_BASE_ADDRESS + TCP_PIC_RAM_SIZE)
+				return FALSE;
+			i = (TCP_SOCKET)-1;
+		}
+		if(ptrEnd > TCP_PIC_RAM_BASE_ADDRESS + TCP_PIC_RAM_SIZE)
+			return FALSE;
+	}
+
+	MyTCBStub.bufferTxStart	= ptrStart;
+	MyTCBStub.bufferRxStart	= MyTCBStub.bufferTxStart + wTXSize + 1;
+	MyTCBStub.bufferEnd		= MyTCBStub.bufferRxStart + wRXSize;
+	MyTCBStub.txHead = MyTCBStub.bufferTxStart;
+	MyTCBStub.txTail = MyTCBStub.bufferTxStart;
+	MyTCBStub.rxHead = MyTCBStub.bufferRxStart;
+	MyTCBStub.rxTail = MyTCBStub.bufferRxStart;
+	#if defined(STACK_USE_SSL)
+	MyTCBStub.sslRxHead = MyTCBStub.bufferRxStart;
+	#if !defined(STACK_USE_SSL_SERVER)
+	MyTCBStub.sslTxHead = MyTCBStub.bufferTxStart;
+	#endif
+	#endif
+
+	MyTCB.txUnackedTail = MyTCBStub.bufferTxStart;
+	MyTCB.vRxWindowShift = 0;
+	while((((DWORD)(MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart) >> MyTCB.vRxWindowShift) > 0xFFFFul) && (MyTCB.vRxWindowShift < TCP_MAX_WINDOW_SHIFT))
+		MyTCB.vRxWindowShift++;
+	#endif
+
+	return TRUE;
+}
+#endif
+
+/*****************************************************************************
+  Function:
+	static void ResetCongestionWindow(void)
+
+  Summary:
+	Sets the initial congestion window of a connection.
+
+  Description:
+	This function sets the congestion window to the initial window of 
+	RFC 5681 for the current remote MSS, and the slow start threshold to 
+	its maximum, so that the connection starts in slow start.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+static void ResetCongestionWindow(void)
+{
+	if(MyTCB.wRemoteMSS > 2190u)
+		MyTCB.wCongWindow = MyTCB.wRemoteMSS<<1;
+	else if(MyTCB.wRemoteMSS > 1095u)
+		MyTCB.wCongWindow = MyTCB.wRemoteMSS*3u;
+	else
+		MyTCB.wCongWindow = MyTCB.wRemoteMSS<<2;
+	MyTCB.wSSThresh = 0xFFFF;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD GetFlightSize(void)
+
+  Summary:
+	Returns the number of bytes sent but not yet acknowledged.
+
+  Description:
+	This function returns the number of TX FIFO bytes between txTail and 
+	txUnackedTail, which is the amount of data in flight.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	Number of unacknowledged bytes
+  ***************************************************************************/
+static WORD GetFlightSize(void)
+{
+	PTR_BASE w;
+
+	w = MyTCB.txUnackedTail - MyTCBStub.txTail;
+	if(MyTCB.txUnackedTail < MyTCBStub.txTail)
+		w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+	return (WORD)w;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD GetSendRoom(void)
+
+  Summary:
+	Returns how many more bytes the congestion window lets us send.
+
+  Description:
+	This function returns the congestion window minus the data in flight.  
+	The first duplicate ACKs each allow one more segment beyond the 
+	congestion window (Limited Transmit, RFC 3042), so that a small window 
+	still gets enough duplicate ACKs for a fast retransmission.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	Number of bytes that can be sent
+  ***************************************************************************/
+static WORD GetSendRoom(void)
+{
+	DWORD dwWindow;
+	WORD wFlight;
+
+	dwWindow = MyTCB.wCongWindow;
+	if(!MyTCB.flags.bFastRecovery)
+		dwWindow += (DWORD)MyTCB.vDupACKs * MyTCB.wRemoteMSS;
+
+	wFlight = GetFlightSize();
+	if(wFlight >= dwWindow)
+		return 0;
+	dwWindow -= wFlight;
+	return (dwWindow > 0xFFFFu) ? 0xFFFF : (WORD)dwWindow;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD GetUnsentSize(PTR_BASE* pwHead)
+
+  Summary:
+	Returns how many bytes at the head of the TX FIFO have not been sent.
+
+  Description:
+	Untransmitted data lies between txUnackedTail and txHead.  On SSL
+	sockets the application writes plain text between txHead and
+	sslTxHead, which is only encrypted and sent by TCPTick().
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	pwHead - Receives the pointer that the TCPPut functions write to next
+
+  Returns:
+	Number of bytes that may still be rewritten
+  ***************************************************************************/
+static WORD GetUnsentSize(PTR_BASE* pwHead)
+{
+	PTR_BASE wStart, w;
+
+	wStart = MyTCB.txUnackedTail;
+	*pwHead = MyTCBStub.txHead;
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+	{
+		wStart = MyTCBStub.txHead;
+		*pwHead = MyTCBStub.sslTxHead;
+	}
+	#endif
+
+	w = *pwHead - wStart;
+	if(*pwHead < wStart)
+		w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+	return (WORD)w;
+}
+
+/*****************************************************************************
+  Function:
+	static DWORD GetRTO(void)
+
+  Summary:
+	Calculates the retransmission timeout.
+
+  Description:
+	This function returns the retransmission timeout (RTO) of RFC 6298, 
+	SRTT + max(G, 4*RTTVAR), with a clock granularity G of one tick.  
+	Before the first round trip time measurement TCP_START_TIMEOUT_VAL 
+	is returned.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	The RTO in ticks, between TCP_MIN_RTO_VAL and TCP_MAX_RTO_VAL
+  ***************************************************************************/
+static DWORD GetRTO(void)
+{
+	DWORD dwRTO;
+
+	if(MyTCB.dwSRTT == 0u)
+		return TCP_START_TIMEOUT_VAL;
+
+	// dwRTTVar already holds 4*RTTVAR
+	dwRTO = MyTCB.dwRTTVar;
+	if(dwRTO == 0u)
+		dwRTO = 1;
+	dwRTO += MyTCB.dwSRTT>>3;
+
+	if(dwRTO < TCP_MIN_RTO_VAL)
+		return TCP_MIN_RTO_VAL;
+	if(dwRTO > TCP_MAX_RTO_VAL)
+		return TCP_MAX_RTO_VAL;
+	return dwRTO;
+}
+
+/*****************************************************************************
+  Function:
+	static DWORD GetPTO(void)
+
+  Summary:
+	Calculates the loss probe timeout.
+
+  Description:
+	This function returns the probe timeout (PTO) of RFC 8985 section 7.2, 
+	2*SRTT, plus the delayed ACK timeout when only one segment is in flight 
+	since the remote node may wait that long to ACK it.  A probe is only sent 
+	for data in flight on a connected socket with a round trip time 
+	estimate, once until new data is ACKed, and not after a retransmission 
+	timeout.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	The PTO in ticks, between TCP_MIN_PTO_VAL and retryInterval, or 0 if 
+	no loss probe may be sent
+  ***************************************************************************/
+static DWORD GetPTO(void)
+{
+	DWORD dwPTO;
+	WORD wFlight;
+
+	if((MyTCBStub.smState != TCP_ESTABLISHED) && (MyTCBStub.smState != TCP_CLOSE_WAIT))
+		return 0;
+	wFlight = GetFlightSize();
+	if(MyTCB.flags.bProbeSent || MyTCB.retryCount || (MyTCB.dwSRTT == 0u) || (wFlight == 0u))
+		return 0;
+
+	// dwSRTT holds 8*SRTT
+	dwPTO = MyTCB.dwSRTT>>2;
+	if(wFlight <= MyTCB.wRemoteMSS)
+		dwPTO += TCP_DELAYED_ACK_TIMEOUT;
+
+	if(dwPTO < TCP_MIN_PTO_VAL)
+		dwPTO = TCP_MIN_PTO_VAL;
+	if(dwPTO > MyTCB.retryInterval)
+		return MyTCB.retryInterval;
+	return dwPTO;
+}
+
+/*****************************************************************************
+  Function:
+	static void UpdateRTT(DWORD dwRTT)
+
+  Summary:
+	Adds a round trip time measurement to the RTO estimate.
+
+  Description:
+	This function updates the smoothed round trip time and its variation 
+	as described in RFC 6298 section 2, with alpha = 1/8 and beta = 1/4.  
+	The values are kept scaled by 8 and 4 so that the updates are shifts.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	dwRTT - Measured round trip time in ticks
+
+  Returns:
+	None
+  ***************************************************************************/
+static void UpdateRTT(DWORD dwRTT)
+{
+	LONG lDelta;
+
+	if(dwRTT == 0u)
+		dwRTT = 1;
+
+	// First measurement: SRTT = R, RTTVAR = R/2
+	if(MyTCB.dwSRTT == 0u)
+	{
+		MyTCB.dwSRTT = dwRTT<<3;
+		MyTCB.dwRTTVar = dwRTT<<1;
+		return;
+	}
+
+	// SRTT = 7/8*SRTT + 1/8*R, RTTVAR = 3/4*RTTVAR + 1/4*|SRTT - R|
+	lDelta = (LONG)dwRTT - (LONG)(MyTCB.dwSRTT>>3);
+	MyTCB.dwSRTT += lDelta;
+	if(MyTCB.dwSRTT == 0u)
+		MyTCB.dwSRTT = 1;
+	if(lDelta < 0)
+		lDelta = -lDelta;
+	MyTCB.dwRTTVar += lDelta - (LONG)(MyTCB.dwRTTVar>>2);
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL GetNextHole(WORD* pwStart, WORD* pwEnd)
+
+  Summary:
+	Finds the next range of data to retransmit in a fast recovery.
+
+  Description:
+	This function returns the first hole at or after wHighRxt that the 
+	remote node has not selectively acknowledged.  The hole ends where the 
+	next SACKed block starts.  Data above the highest SACKed block may still 
+	be in flight, so it is not a hole.  Without SACK information, the hole 
+	is all data in flight from wHighRxt on, which is the first unacknowledged 
+	segment of NewReno when wHighRxt is 0.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	pwStart - Receives the offset of the hole from the first unacknowledged 
+		byte
+	pwEnd - Receives the offset of the byte after the hole
+
+  Returns:
+	TRUE if there is a hole, FALSE otherwise
+  ***************************************************************************/
+static BOOL GetNextHole(WORD* pwStart, WORD* pwEnd)
+{
+	WORD wStart, wEnd, wFlight;
+	#if TCP_SACK
+	BYTE i;
+	BOOL bMoved;
+	#endif
+
+	wFlight = GetFlightSize();
+	wStart = 0;
+	wEnd = wFlight;
+	#if TCP_SACK
+	wStart = MyTCB.wHighRxt;
+	if(MyTCB.vTxSACKed)
+	{
+		// Skip data the remote node already has
+		do
+		{
+			bMoved = FALSE;
+			for(i = 0; i < MyTCB.vTxSACKed; i++)
+			{
+				if((wStart >= MyTCB.txSACKed[i].wStart) && (wStart < MyTCB.txSACKed[i].wEnd))
+				{
+					wStart = MyTCB.txSACKed[i].wEnd;
+					bMoved = TRUE;
+				}
+			}
+		} while(bMoved);
+
+		wEnd = 0;
+		for(i = 0; i < MyTCB.vTxSACKed; i++)
+		{
+			if((MyTCB.txSACKed[i].wStart > wStart) && ((wEnd == 0u) || (MyTCB.txSACKed[i].wStart < wEnd)))
+				wEnd = MyTCB.txSACKed[i].wStart;
+		}
+		if(wEnd > wFlight)
+			wEnd = wFlight;
+	}
+	#endif
+
+	if(wStart >= wEnd)
+		return FALSE;
+	*pwStart = wStart;
+	*pwEnd = wEnd;
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL RetransmitLostSegment(void)
+
+  Summary:
+	Retransmits one segment from the next hole.
+
+  Description:
+	This function transmits one segment from the hole found by 
+	GetNextHole(), for fast retransmissions and during fast recovery.  
+	Unlike a retransmission timeout, the rest of the data in flight is not 
+	sent again: the send state is restored afterwards.  When SACK is used, 
+	wHighRxt is moved past the retransmitted data so that the next call 
+	retransmits the next hole.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	TRUE if a segment was retransmitted, FALSE if there was no hole
+  ***************************************************************************/
+static BOOL RetransmitLostSegment(void)
+{
+	PTR_BASE txHead, txUnackedTail;
+	DWORD dwSEQ;
+	WORD wWindow, wCongWindow, wFlight, wStart, wEnd;
+	BYTE vTXFIN;
+
+	if(!GetNextHole(&wStart, &wEnd))
+		return FALSE;
+
+	txHead = MyTCBStub.txHead;
+	txUnackedTail = MyTCB.txUnackedTail;
+	dwSEQ = MyTCB.MySEQ;
+	wWindow = MyTCB.remoteWindow;
+	wCongWindow = MyTCB.wCongWindow;
+	vTXFIN = MyTCBStub.Flags.bTXFIN;
+
+	// Roll back to the start of the hole, and end the TX data at the end of 
+	// the hole.  The data was sent before, so neither window limits it.
+	wFlight = GetFlightSize();
+	MyTCB.MySEQ -= wFlight - wStart;
+	MyTCB.txUnackedTail = MyTCBStub.txTail + wStart;
+	if(MyTCB.txUnackedTail >= MyTCBStub.bufferRxStart)
+		MyTCB.txUnackedTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+	MyTCBStub.txHead = MyTCB.txUnackedTail + (wEnd - wStart);
+	if(MyTCBStub.txHead >= MyTCBStub.bufferRxStart)
+		MyTCBStub.txHead -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+	MyTCB.remoteWindow = wEnd - wStart;
+	MyTCB.wCongWindow = wEnd;
+	MyTCBStub.Flags.bTXFIN = 0;
+	SendTCP(ACK, 0);
+	#if TCP_SACK
+	if(MyTCB.flags.bSACK)
+		MyTCB.wHighRxt = GetFlightSize();
+	#endif
+
+	MyTCBStub.txHead = txHead;
+	MyTCB.txUnackedTail = txUnackedTail;
+	MyTCB.MySEQ = dwSEQ;
+	MyTCB.remoteWindow = wWindow;
+	MyTCB.wCongWindow = wCongWindow;
+	MyTCBStub.Flags.bTXFIN = vTXFIN;
+	MyTCBStub.Flags.bTXASAPWithoutTimerReset = 0;
+	return TRUE;
+}
+
+#if TCP_SACK
+/*****************************************************************************
+  Function:
+	static void UpdateScoreboard(DWORD dwAckNumber)
+
+  Summary:
+	Updates the SACKed blocks with an incoming ACK.
+
+  Description:
+	This function moves the txSACKed blocks and wHighRxt past the data 
+	acknowledged by the current segment, then adds the blocks of its SACK 
+	option.  Blocks at or below the ACK number (D-SACK, RFC 2883) and 
+	beyond the data in flight are ignored.
+
+  Precondition:
+	Must be called while a TCP packet is present and being processed via 
+	HandleTCPSeg(), before the TX FIFO pointers are moved for the ACK.
+
+  Parameters:
+	dwAckNumber - ACK number of the current segment
+
+  Returns:
+	None
+
+  Remarks:
+	The internal MAC Read Pointer is moved but not restored.
+  ***************************************************************************/
+static void UpdateScoreboard(DWORD dwAckNumber)
+{
+	DWORD dwEdges[2];
+	LONG lStart, lEnd;
+	WORD wFlight, wAcked;
+	BYTE vLength;
+
+	wFlight = GetFlightSize();
+	dwEdges[0] = dwAckNumber - (MyTCB.MySEQ - wFlight);
+	if((LONG)dwEdges[0] < 0)
+		return;
+	if(dwEdges[0] > wFlight)
+	{
+		// ACK beyond the data in flight after a retransmission timeout
+		MyTCB.vTxSACKed = 0;
+		MyTCB.wHighRxt = 0;
+		return;
+	}
+
+	wAcked = (WORD)dwEdges[0];
+	MyTCB.vTxSACKed = ShiftSACKBlocks(MyTCB.txSACKed, MyTCB.vTxSACKed, wAcked);
+	MyTCB.wHighRxt = (MyTCB.wHighRxt > wAcked) ? MyTCB.wHighRxt - wAcked : 0;
+	wFlight -= wAcked;
+
+	vLength = SeekOption(TCP_OPTIONS_SACK, 0);
+	if(vLength < 10u)
+		return;
+	for(vLength = (vLength - 2u)>>3; vLength; vLength--)
+	{
+		MACGetArray((BYTE*)dwEdges, sizeof(dwEdges));
+		lStart = (LONG)(swapl(dwEdges[0]) - dwAckNumber);
+		lEnd = (LONG)(swapl(dwEdges[1]) - dwAckNumber);
+		if((lStart <= 0) || (lEnd <= lStart) || (lStart >= (LONG)wFlight))
+			continue;
+		if(lEnd > (LONG)wFlight)
+			lEnd = wFlight;
+		MyTCB.vTxSACKed = AddSACKBlock(MyTCB.txSACKed, MyTCB.vTxSACKed, (WORD)lStart, (WORD)lEnd);
+	}
+}
+#endif
+
+/*****************************************************************************
+  Function:
+	static BYTE AddSACKBlock(TCP_SACK_BLOCK* pBlocks, BYTE vBlocks, 
+							 WORD wStart, WORD wEnd)
+
+  Summary:
+	Adds a block of data to a list of SACK blocks.
+
+  Description:
+	This function merges the new block with the blocks it overlaps or 
+	touches, and puts the result first in the list, as the most recent 
+	block.  If the list is full, the oldest block is dropped.
+
+  Precondition:
+	None
+
+  Parameters:
+	pBlocks - List of TCP_RX_BLOCKS blocks (TCP_SACK_BLOCKS when TCP_SACK 
+		is enabled)
+	vBlocks - Number of blocks in use
+	wStart - Offset of the first byte of the new block
+	wEnd - Offset of the byte after the new block
+
+  Returns:
+	New number of blocks in use
+  ***************************************************************************/
+static BYTE AddSACKBlock(TCP_SACK_BLOCK* pBlocks, BYTE vBlocks, WORD wStart, WORD wEnd)
+{
+	BYTE i, j;
+
+	for(i = 0, j = 0; i < vBlocks; i++)
+	{
+		if((pBlocks[i].wEnd < wStart) || (pBlocks[i].wStart > wEnd))
+		{
+			pBlocks[j++] = pBlocks[i];
+			continue;
+		}
+		if(pBlocks[i].wStart < wStart)
+			wStart = pBlocks[i].wStart;
+		if(pBlocks[i].wEnd > wEnd)
+			wEnd = pBlocks[i].wEnd;
+	}
+
+	if(j == TCP_RX_BLOCKS)
+		j--;
+	for(i = j; i; i--)
+		pBlocks[i] = pBlocks[i-1];
+	pBlocks[0].wStart = wStart;
+	pBlocks[0].wEnd = wEnd;
+	return j + 1;
+}
+
+/*****************************************************************************
+  Function:
+	static BYTE ShiftSACKBlocks(TCP_SACK_BLOCK* pBlocks, BYTE vBlocks, 
+								WORD wShift)
+
+  Summary:
+	Moves a list of SACK blocks to a later base sequence number.
+
+  Description:
+	This function subtracts wShift from the offsets of all blocks.  Blocks 
+	that end at or below the new base are removed, and blocks that span it 
+	start at offset 0.
+
+  Precondition:
+	None
+
+  Parameters:
+	pBlocks - List of blocks
+	vBlocks - Number of blocks in use
+	wShift - Number of bytes the base sequence number advanced
+
+  Returns:
+	New number of blocks in use
+  ***************************************************************************/
+static BYTE ShiftSACKBlocks(TCP_SACK_BLOCK* pBlocks, BYTE vBlocks, WORD wShift)
+{
+	BYTE i, j;
+
+	for(i = 0, j = 0; i < vBlocks; i++)
+	{
+		if(pBlocks[i].wEnd <= wShift)
+			continue;
+		pBlocks[j].wStart = (pBlocks[i].wStart > wShift) ? pBlocks[i].wStart - wShift : 0;
+		pBlocks[j].wEnd = pBlocks[i].wEnd - wShift;
+		j++;
+	}
+	return j;
+}
+
+/*****************************************************************************
+  Function:
+	static WORD GetOutOfOrderEnd(void)
+
+  Summary:
+	Returns the end of the out-of-order data in the RX FIFO.
+
+  Description:
+	This function returns the offset from rxHead of the byte after the 
+	last out-of-order block, or 0 if there is no out-of-order data.
+
+  Precondition:
+	The TCB corresponding to the socket is synced.
+
+  Parameters:
+	None
+
+  Returns:
+	Number of RX FIFO bytes after rxHead in use by out-of-order data and 
+	the holes before it
+  ***************************************************************************/
+static WORD GetOutOfOrderEnd(void)
+{
+	WORD wEnd;
+	BYTE i;
+
+	wEnd = 0;
+	for(i = 0; i < MyTCB.vRxBlocks; i++)
+	{
+		if(MyTCB.rxBlocks[i].wEnd > wEnd)
+			wEnd = MyTCB.rxBlocks[i].wEnd;
+	}
+	return wEnd;
+}
+
+
+/*****************************************************************************
+  Function:
+	static WORD GetMaxSegSizeOption(void)
+
+  Summary:
+	Obtains the Maximum Segment Size (MSS) TCP Option out of the TCP header 
+	for the current socket, and sets up the RFC 7323 and SACK options.
+
+  Description:
+	Parses the current TCP packet header and extracts the Maximum Segment Size 
+	option.  The window scale, SACK and timestamps options are used only if 
+	the remote node sent them in its SYN and they are enabled here.  Otherwise 
+	windows are not scaled and no SACK blocks or timestamps are sent.  When 
+	timestamps are used, the remote node's TSval is saved for the echo in 
+	our next segment.
+
+  Precondition:
+	Must be called while a TCP packet is present and being processed via 
+	HandleTCPSeg() and only if the the TCP SYN flag is set.
+
+  Parameters:
+	None
+
+  Returns:
+	Maximum segment size option value.  If illegal or not present, a failsafe 
+	value of 536 is returned.  If the option is larger than the 
+	TCP_MAX_SEG_SIZE_TX upper limit, then TCP_MAX_SEG_SIZE_TX is returned.  
+	When timestamps are used, the value is reduced by the size of the 
+	timestamps option, which goes in every segment.
+
+  Remarks:
+	The internal MAC Read Pointer is moved but not restored.
+  ***************************************************************************/
+static WORD GetMaxSegSizeOption(void)
+{
+	WORD wMSS;
+	BYTE vShift;
+
+	// Use the minimum Maximum Segment Size value of 536 bytes if none is 
+	// present or the option is illegal
+	wMSS = 536;
+	if(SeekOption(TCP_OPTIONS_MAX_SEG_SIZE, 4))
+	{
+		// Retrieve MSS and swap value to little endian
+		((BYTE*)&wMSS)[1] = MACGet();
+		((BYTE*)&wMSS)[0] = MACGet();
+		if(wMSS < 536u)
+			wMSS = 536;
+		else if(wMSS > TCP_MAX_SEG_SIZE_TX)
+			wMSS = TCP_MAX_SEG_SIZE_TX;
+	}
+
+	// Scale windows only if both nodes sent the option
+	MyTCB.vTxWindowShift = 0;
+	if(MyTCB.flags.bWindowScale && SeekOption(TCP_OPTIONS_WINDOW_SCALE, 3))
+	{
+		vShift = MACGet();
+		MyTCB.vTxWindowShift = (vShift > TCP_MAX_WINDOW_SHIFT) ? TCP_MAX_WINDOW_SHIFT : vShift;
+	}
+	else
+	{
+		MyTCB.flags.bWindowScale = 0;
+		MyTCB.vRxWindowShift = 0;
+	}
+
+	// Send SACK blocks only if both nodes sent the SACK permitted option
+	if(!MyTCB.flags.bSACK || !SeekOption(TCP_OPTIONS_SACK_PERMITTED, 2))
+		MyTCB.flags.bSACK = 0;
+
+	// Send timestamps only if both nodes sent the option
+	if(!MyTCB.flags.bTimestamps || !GetTimestampOption(&MyTCB.dwTSRecent, NULL))
+	{
+		MyTCB.flags.bTimestamps = 0;
+		return wMSS;
+	}
+	return wMSS - TCP_TIMESTAMP_OPTION_LEN;
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL GetTimestampOption(DWORD* pdwTSVal, DWORD* pdwTSEcr)
 
   Summary:
-	Closes a TCP socket.
+	Obtains the timestamps TCP Option out of the TCP header for the current 
+	socket.
 
   Description:
-	This function closes a TCP socket.  All socket state information is 
-	reset, and any buffered bytes are discarded.  The socket is no longer
-	accessible by the application after this point.
+	Parses the current TCP packet header and extracts the TSval and TSecr 
+	fields of the timestamps option (RFC 7323).
 
   Precondition:
-	The TCPStub corresponding to the socket to be closed is synced.
+	Must be called while a TCP packet is present and being processed via 
+	HandleTCPSeg().
 
   Parameters:
-	None
+	pdwTSVal - Receives the remote node's clock (TSval)
+	pdwTSEcr - Receives the echo of our clock (TSecr), or NULL
 
   Returns:
-	None
+	TRUE if the option was found, FALSE otherwise
+
+  Remarks:
+	The internal MAC Read Pointer is moved but not restored.
   ***************************************************************************/
-static void CloseSocket(void)
+static BOOL GetTimestampOption(DWORD* pdwTSVal, DWORD* pdwTSEcr)
 {
-	SyncTCB();
-
-	MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
-	MyTCBStub.txHead = MyTCBStub.bufferTxStart;
-	MyTCBStub.txTail = MyTCBStub.bufferTxStart;
-	MyTCBStub.rxHead = MyTCBStub.bufferRxStart;
-	MyTCBStub.rxTail = MyTCBStub.bufferRxStart;
-	MyTCBStub.smState = MyTCBStub.Flags.bServer ? TCP_LISTEN : TCP_CLOSED;
-	MyTCBStub.Flags.vUnackedKeepalives = 0;
-	MyTCBStub.Flags.bTimerEnabled = 0;
-	MyTCBStub.Flags.bTimer2Enabled = 0;
-	MyTCBStub.Flags.bDelayedACKTimerEnabled = 0;
-	MyTCBStub.Flags.bOneSegmentReceived = 0;
-	MyTCBStub.Flags.bHalfFullFlush = 0;
-	MyTCBStub.Flags.bTXASAP = 0;
-	MyTCBStub.Flags.bTXASAPWithoutTimerReset = 0;
-	MyTCBStub.Flags.bTXFIN = 0;
-	MyTCBStub.Flags.bSocketReset = 1;
-
-	#if defined(STACK_USE_SSL)
-	// If SSL is active, then we need to close it
-	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
-	{
-		SSLTerminate(MyTCBStub.sslStubID);
-		MyTCBStub.sslStubID = SSL_INVALID_ID;
-
-		// Swap the SSL port and local port back to proper values
-		MyTCBStub.remoteHash.Val = MyTCB.localSSLPort.Val;
-		MyTCB.localSSLPort.Val = MyTCB.localPort.Val;
-		MyTCB.localPort.Val = MyTCBStub.remoteHash.Val;
-	}
+	DWORD dwTS[2];
 
-	// Reset the SSL buffer pointers
-	MyTCBStub.sslRxHead = MyTCBStub.bufferRxStart;
-	MyTCBStub.sslTxHead = MyTCBStub.bufferTxStart;
-	#endif
-	
-	#if defined(STACK_USE_SSL_SERVER)
-	MyTCBStub.sslTxHead = MyTCB.localSSLPort.Val;
-	#endif
+	if(!SeekOption(TCP_OPTIONS_TIMESTAMP, 10))
+		return FALSE;
 
-	MyTCB.flags.bFINSent = 0;
-	MyTCB.flags.bSYNSent = 0;
-	MyTCB.flags.bRXNoneACKed1 = 0;
-	MyTCB.flags.bRXNoneACKed2 = 0;
-	MyTCB.txUnackedTail = MyTCBStub.bufferTxStart;
-	((DWORD_VAL*)(&MyTCB.MySEQ))->w[0] = LFSRRand();
-	((DWORD_VAL*)(&MyTCB.MySEQ))->w[1] = LFSRRand();
-	MyTCB.sHoleSize = -1;
-	MyTCB.remoteWindow = 1;
+	MACGetArray((BYTE*)dwTS, sizeof(dwTS));
+	*pdwTSVal = swapl(dwTS[0]);
+	if(pdwTSEcr)
+		*pdwTSEcr = swapl(dwTS[1]);
+	return TRUE;
 }
 
-
 /*****************************************************************************
   Function:
-	static WORD GetMaxSegSizeOption(void)
+	static BYTE SeekOption(BYTE vKind, BYTE vLength)
 
   Summary:
-	Obtains the Maximum Segment Size (MSS) TCP Option out of the TCP header 
-	for the current socket.
+	Finds a TCP Option in the TCP header for the current socket.
 
   Description:
-	Parses the current TCP packet header and extracts the Maximum Segment Size 
-	option.  
+	Walks the options of the current TCP packet header and moves the MAC 
+	read pointer to the data of the first option of the given kind.  The 
+	option must have the given length, unless vLength is 0.
 
   Precondition:
 	Must be called while a TCP packet is present and being processed via 
-	HandleTCPSeg() and only if the the TCP SYN flag is set.
+	HandleTCPSeg().
 
   Parameters:
-	None
+	vKind - Option kind, one of the TCP_OPTIONS_* constants
+	vLength - Expected option length, including the kind and length bytes, 
+		or 0 for options of variable length
 
   Returns:
-	Maximum segment size option value.  If illegal or not present, a failsafe 
-	value of 536 is returned.  If the option is larger than the 
-	TCP_MAX_SEG_SIZE_TX upper limit, then TCP_MAX_SEG_SIZE_TX is returned.
+	Length of the option, including the kind and length bytes, if it was 
+	found and the read pointer is at its data, 0 otherwise
 
   Remarks:
 	The internal MAC Read Pointer is moved but not restored.
   ***************************************************************************/
-static WORD GetMaxSegSizeOption(void)
+static BYTE SeekOption(BYTE vKind, BYTE vLength)
 {
 	BYTE vOptionsBytes;
 	BYTE vOption;
-	WORD wMSS;
+	BYTE vOptionLength;
 
 	// Find out how many options bytes are in this packet.
 	IPSetRxBuffer(2+2+4+4);	// Seek to data offset field, skipping Source port (2), Destination port (2), Sequence number (4), and Acknowledgement number (4)
 	vOptionsBytes = MACGet();
 	vOptionsBytes = ((vOptionsBytes&0xF0)>>2) - sizeof(TCP_HEADER);
 
-	// Return minimum Maximum Segment Size value of 536 bytes if none are 
-	// present
+	// Return if none are present
 	if(vOptionsBytes == 0u)
-		return 536;
+		return FALSE;
 		
 	// Seek to beginning of options
 	MACGetArray(NULL, 7);
 
-	// Search for the Maximum Segment Size option	
 	while(vOptionsBytes--)
 	{
 		vOption = MACGet();
 		
-		if(vOption == 0u)	// End of Options list
+		if(vOption == TCP_OPTIONS_END_OF_LIST)
 			break;
 		
-		if(vOption == 1u)	// NOP option
+		if(vOption == TCP_OPTIONS_NO_OP)
 			continue;
-			
-		if(vOption == 2u)	// Maximum Segment Size option
-		{
-			if(vOptionsBytes < 3u)
-				break;
 
-			wMSS = 0;
-				
-			// Get option length
-			vOption = MACGet();
-			if(vOption == 4u)
-			{// Retrieve MSS and swap value to little endian
-				((BYTE*)&wMSS)[1] = MACGet();
-				((BYTE*)&wMSS)[0] = MACGet();
-			}
-			
-			if(wMSS < 536u)
-				break;
-			if(wMSS > TCP_MAX_SEG_SIZE_TX)
-				return TCP_MAX_SEG_SIZE_TX;
-			else 
-				return wMSS;
-		}
-		else
-		{ // Assume this is a multi byte option and throw it way
-			if(vOptionsBytes < 2u)
-				break;
-			vOption = MACGet();
-			if(vOptionsBytes < vOption)
-				break;
-			MACGetArray(NULL, vOption);
-			vOptionsBytes -= vOption;
-		}
-		
+		// Every other option has a length byte, which counts the kind and 
+		// length bytes too
+		if(vOptionsBytes == 0u)
+			break;
+		vOptionLength = MACGet();
+		vOptionsBytes--;
+		if((vOptionLength < 2u) || (vOptionLength - 2u > vOptionsBytes))
+			break;
+
+		if(vOption == vKind)
+			return ((vLength == 0u) || (vOptionLength == vLength)) ? vOptionLength : 0;
+
+		// Throw away any other option
+		MACGetArray(NULL, vOptionLength - 2u);
+		vOptionsBytes -= vOptionLength - 2u;
 	}
 	
-	// Did not find MSS option, return worst case default
-	return 536;
+	return 0;
 }
 
 /*****************************************************************************
@@ -3609,7 +5359,16 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 	DWORD localSeqNumber;
 	WORD wSegmentLength;
 	BOOL bSegmentAcceptable;
-	WORD wNewWindow;
+	BOOL bRetransmit;
+	BOOL bImmediateACK;
+	#if TCP_SACK
+	WORD wStart, wEnd;
+	#endif
+	BYTE i;
+	BOOL bTimestamp;
+	DWORD dwTSVal;
+	DWORD dwTSEcr;
+	DWORD dwNewWindow;
 
 
 	// Cache a few variables in local RAM.  
@@ -3658,6 +5417,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 
 				// Get MSS option
 				MyTCB.wRemoteMSS = GetMaxSegSizeOption();
+				ResetCongestionWindow();
 
 				// Set Initial Send Sequence (ISS) number
 				// Nothing to do on this step... ISS already set in CloseSocket()
@@ -3711,6 +5471,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 
 				// Get MSS option
 				MyTCB.wRemoteMSS = GetMaxSegSizeOption();
+				ResetCongestionWindow();
 
 				if(localHeaderFlags & ACK)
 				{
@@ -3736,6 +5497,21 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 			break;
 	}
 
+	// Read the timestamps and drop old duplicate segments: their TSval is 
+	// older than the last one seen (PAWS, RFC 7323 section 5)
+	bTimestamp = FALSE;
+	dwTSVal = 0;
+	dwTSEcr = 0;
+	if(MyTCB.flags.bTimestamps && (h->DataOffset.Val > (sizeof(TCP_HEADER)>>2)))
+	{
+		bTimestamp = GetTimestampOption(&dwTSVal, &dwTSEcr);
+		if(bTimestamp && !(localHeaderFlags & RST) && ((LONG)(dwTSVal - MyTCB.dwTSRecent) < 0))
+		{
+			SendTCP(ACK, SENDTCP_RESET_TIMERS);
+			return;
+		}
+	}
+
 	//
 	// First: check the sequence number
 	//
@@ -3768,11 +5544,11 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 			else
 			{
 				// RCV.NXT =< SEG.SEQ+SEG.LEN-1 < RCV.NXT+RCV.WND
-				if((lMissingBytes + (LONG)wSegmentLength > (LONG)0) && (lMissingBytes <= (LONG)(SHORT)(wFreeSpace - wSegmentLength)))
+				if((lMissingBytes + (LONG)wSegmentLength > (LONG)0) && (lMissingBytes <= (LONG)wFreeSpace - (LONG)wSegmentLength))
 					bSegmentAcceptable = TRUE;
 			}
 			
-			if((lMissingBytes < (LONG)wFreeSpace) && ((SHORT)wMissingBytes + (SHORT)wSegmentLength > (SHORT)0))
+			if((lMissingBytes < (LONG)wFreeSpace) && (lMissingBytes + (LONG)wSegmentLength > (LONG)0))
 				bSegmentAcceptable = TRUE;
 		}
 		// Segments with data are not acceptable if we have no free space
@@ -3801,6 +5577,10 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 		return;
 	}
 
+	// Echo the TSval of the segment that will be acknowledged next
+	if(bTimestamp && (lMissingBytes <= 0))
+		MyTCB.dwTSRecent = dwTSVal;
+
 
 	//
 	// Second: check the RST bit
@@ -3875,12 +5655,19 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 			if(MyTCB.txUnackedTail < MyTCBStub.txTail)
 				dwTemp -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
 	
+			// Forget the SACKed blocks this packet ACKs and add the ones it 
+			// reports
+			#if TCP_SACK
+			if(MyTCB.flags.bSACK)
+				UpdateScoreboard(localAckNumber);
+			#endif
+
 			// Calcluate how many bytes were ACKed with this packet
 			dwTemp = localAckNumber - dwTemp;
+			bRetransmit = FALSE;
 			if(((LONG)(dwTemp) > (LONG)0) && (dwTemp <= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart))
 			{
-				MyTCB.flags.bRXNoneACKed1 = 0;
-				MyTCB.flags.bRXNoneACKed2 = 0;
+				MyTCB.vDupACKs = 0;
 				MyTCBStub.Flags.bHalfFullFlush = FALSE;
 	
 				// Bytes ACKed, free up the TX FIFO space
@@ -3907,27 +5694,102 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 					MyTCBStub.txTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
 				if(MyTCB.txUnackedTail >= MyTCBStub.bufferRxStart)
 					MyTCB.txUnackedTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+
+				// Take a round trip time sample from the echoed timestamp, or 
+				// if the timed segment was ACKed
+				if(bTimestamp && dwTSEcr)
+				{
+					UpdateRTT((TickGetDiv256() - dwTSEcr)<<8);
+				}
+				else if(MyTCB.flags.bRTTPending && ((LONG)(localAckNumber - MyTCB.dwRTTSEQ) >= 0))
+				{
+					MyTCB.flags.bRTTPending = 0;
+					UpdateRTT(TickGet() - MyTCB.dwRTTStart);
+				}
+
+				if(MyTCB.flags.bFastRecovery)
+				{
+					if((LONG)(localAckNumber - MyTCB.dwRecover) >= 0)
+					{
+						// Everything sent before the loss was detected is ACKed: 
+						// deflate the window and leave fast recovery (RFC 6582)
+						MyTCB.wCongWindow = MyTCB.wSSThresh;
+						MyTCB.flags.bFastRecovery = 0;
+						#if TCP_SACK
+						MyTCB.wHighRxt = 0;
+						#endif
+					}
+					else
+					{
+						// Partial ACK: the next segment was lost as well.  Retransmit 
+						// it, unless SACK shows it was already retransmitted, and 
+						// deflate the window by the amount of new data ACKed.
+						if(dwTemp > MyTCB.wCongWindow)
+							dwTemp = MyTCB.wCongWindow;
+						MyTCB.wCongWindow -= (WORD)dwTemp;
+						if(dwTemp >= MyTCB.wRemoteMSS)
+							MyTCB.wCongWindow += MyTCB.wRemoteMSS;
+						if(MyTCB.wCongWindow < MyTCB.wRemoteMSS)
+							MyTCB.wCongWindow = MyTCB.wRemoteMSS;
+						bRetransmit = TRUE;
+					}
+				}
+				else
+				{
+					// Track the ACKs so that only data sent after a loss is timed
+					if((LONG)(localAckNumber - MyTCB.dwRecover) > 0)
+						MyTCB.dwRecover = localAckNumber;
+
+					// Slow start below the threshold, congestion avoidance above it
+					if(MyTCB.wCongWindow < MyTCB.wSSThresh)
+						wTemp = (dwTemp < MyTCB.wRemoteMSS) ? (WORD)dwTemp : MyTCB.wRemoteMSS;
+					else
+						wTemp = ((DWORD)MyTCB.wRemoteMSS * MyTCB.wRemoteMSS) / MyTCB.wCongWindow + 1;
+					MyTCB.wCongWindow = ((DWORD)MyTCB.wCongWindow + wTemp > 0xFFFFu) ? 0xFFFF : MyTCB.wCongWindow + wTemp;
+				}
+
+				// Restart the retransmission timer for the remaining data, 
+				// and allow another loss probe
+				MyTCB.retryCount = 0;
+				MyTCB.retryInterval = GetRTO();
+				MyTCB.flags.bProbeSent = 0;
+				dwTemp = GetPTO();
+				MyTCBStub.eventTime = TickGet() + (dwTemp ? dwTemp : MyTCB.retryInterval);
 			}
-			else
+			else if((dwTemp == 0u) && (len == 0u) && !(localHeaderFlags & (SYN | FIN)) && (MyTCBStub.txTail != MyTCB.txUnackedTail))
 			{
-				// See if we have outstanding TX data that is waiting for an ACK
-				if(MyTCBStub.txTail != MyTCB.txUnackedTail)
+				// Duplicate ACK: no data, nothing new ACKed and data waiting 
+				// for an ACK (RFC 5681)
+				if(MyTCB.flags.bFastRecovery)
 				{
-					if(MyTCB.flags.bRXNoneACKed1)
+					// Another segment has left the network.  Use it for the 
+					// next hole the remote node reported, or else inflate 
+					// the window to send new data.
+					#if TCP_SACK
+					if(MyTCB.vTxSACKed && GetNextHole(&wStart, &wEnd))
+						bRetransmit = TRUE;
+					else
+					#endif
+					if(MyTCB.wCongWindow < 0xFFFFu - MyTCB.wRemoteMSS)
+						MyTCB.wCongWindow += MyTCB.wRemoteMSS;
+				}
+				else if(MyTCB.vDupACKs < TCP_DUP_ACK_THRESHOLD)
+				{
+					// Fast retransmit, unless this ACK is below the data that 
+					// was already being retransmitted after a timeout
+					if((++MyTCB.vDupACKs == TCP_DUP_ACK_THRESHOLD) && ((LONG)(localAckNumber - MyTCB.dwRecover) >= 0))
 					{
-						if(MyTCB.flags.bRXNoneACKed2)
-						{
-							// Set up to perform a fast retransmission
-							// Roll back unacknowledged TX tail pointer to cause retransmit to occur
-							MyTCB.MySEQ -= (LONG)(SHORT)(MyTCB.txUnackedTail - MyTCBStub.txTail);
-							if(MyTCB.txUnackedTail < MyTCBStub.txTail)
-								MyTCB.MySEQ -= (LONG)(SHORT)(MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart);
-							MyTCB.txUnackedTail = MyTCBStub.txTail;
-							MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
-						}
-						MyTCB.flags.bRXNoneACKed2 = 1;
+						wTemp = GetFlightSize()>>1;
+						MyTCB.wSSThresh = (wTemp > MyTCB.wRemoteMSS<<1) ? wTemp : MyTCB.wRemoteMSS<<1;
+						MyTCB.wCongWindow = ((DWORD)MyTCB.wSSThresh + 3u*MyTCB.wRemoteMSS > 0xFFFFu) ? 0xFFFF : MyTCB.wSSThresh + 3u*MyTCB.wRemoteMSS;
+						MyTCB.dwRecover = MyTCB.MySEQ;
+						MyTCB.flags.bFastRecovery = 1;
+						MyTCB.flags.bRTTPending = 0;
+						#if TCP_SACK
+						MyTCB.wHighRxt = 0;
+						#endif
+						bRetransmit = TRUE;
 					}
-					MyTCB.flags.bRXNoneACKed1 = 1;
 				}
 			}
 
@@ -3954,17 +5816,33 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				}
 			}
 
-			// The window size advirtised in this packet is adjusted to account 
-			// for any bytes that we have transmitted but haven't been ACKed yet 
-			// by this segment.
-			wNewWindow = h->Window - ((WORD)(MyTCB.MySEQ - localAckNumber));
+			// The window size advirtised in this packet is scaled, and adjusted 
+			// to account for any bytes that we have transmitted but haven't been 
+			// ACKed yet by this segment.  We never have more than 64 KB in 
+			// flight, so larger windows are limited to that before the 
+			// adjustment.  This keeps remoteWindow plus the flight size within 
+			// a WORD when data is rolled back for retransmission.
+			dwNewWindow = (DWORD)h->Window << MyTCB.vTxWindowShift;
+			if(dwNewWindow > 0xFFFFul)
+				dwNewWindow = 0xFFFF;
+			dwTemp = MyTCB.MySEQ - localAckNumber;
+			if((LONG)dwTemp < 0)
+				dwTemp = 0;
+			dwNewWindow = (dwNewWindow > dwTemp) ? dwNewWindow - dwTemp : 0;
 
 			// Update the local stored copy of the RemoteWindow.
 			// If previously we had a zero window, and now we don't, then 
 			// immediately send whatever was pending.
-			if((MyTCB.remoteWindow == 0u) && wNewWindow)
+			if((MyTCB.remoteWindow == 0u) && dwNewWindow)
 				MyTCBStub.Flags.bTXASAP = 1;
-			MyTCB.remoteWindow = wNewWindow;
+			MyTCB.remoteWindow = (WORD)dwNewWindow;
+
+			if(bRetransmit)
+				RetransmitLostSegment();
+
+			// Send more data if the congestion window has room for a segment
+			if((MyTCBStub.txHead != MyTCB.txUnackedTail) && (GetSendRoom() >= MyTCB.wRemoteMSS))
+				MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
 
 			// A couple of states must do all of the TCP_ESTABLISHED stuff, but also a little more
 			if(MyTCBStub.smState == TCP_FIN_WAIT_1)
@@ -4055,11 +5933,16 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 //	if(MyTCBStub.smState == TCP_TIME_WAIT)
 //		return;
 
+	// Out-of-order segments, and segments that fill a hole, are ACKed 
+	// immediately so that the remote node learns of the hole quickly 
+	// (RFC 5681 section 4.2)
+	bImmediateACK = (len && (lMissingBytes > 0)) || MyTCB.vRxBlocks;
+
 	// Copy any valid segment data into our RX FIFO, if any
 	if(len)
 	{
 		// See if there are bytes we must skip
-		if((SHORT)wMissingBytes <= 0)
+		if(lMissingBytes <= 0)
 		{
 			// Position packet read pointer to start of useful data area.
 			IPSetRxBuffer((h->DataOffset.Val << 2) - wMissingBytes);
@@ -4087,28 +5970,31 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				MyTCBStub.rxHead += len;
 			}
 		
-			// See if we have a hole and other data waiting already in the RX FIFO
-			if(MyTCB.sHoleSize != -1)
+			// See if we have holes and other data waiting already in the RX 
+			// FIFO.  Out-of-order blocks that this data reaches are now in 
+			// order, which may in turn reach the next block.
+			wTemp = len;
+			while(MyTCB.vRxBlocks)
 			{
-				MyTCB.sHoleSize -= len;
-				wTemp = MyTCB.wFutureDataSize + MyTCB.sHoleSize;
-		
-				// See if we just closed up a hole, and if so, advance head pointer
-				if((SHORT)wTemp < (SHORT)0)
-				{
-					MyTCB.sHoleSize = -1;
-				}
-				else if(MyTCB.sHoleSize <= 0)
+				MyTCB.vRxBlocks = ShiftSACKBlocks(MyTCB.rxBlocks, MyTCB.vRxBlocks, wTemp);
+				for(i = 0; i < MyTCB.vRxBlocks; i++)
 				{
-					MyTCB.RemoteSEQ += wTemp;
-					MyTCBStub.rxHead += wTemp;
-					if(MyTCBStub.rxHead > MyTCBStub.bufferEnd)
-						MyTCBStub.rxHead -= MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart + 1;							
-					MyTCB.sHoleSize = -1;
+					if(MyTCB.rxBlocks[i].wStart == 0u)
+						break;
 				}
+				if(i == MyTCB.vRxBlocks)
+					break;
+
+				// Advance the head pointer over the block, which is then 
+				// removed by the next shift
+				wTemp = MyTCB.rxBlocks[i].wEnd;
+				MyTCB.RemoteSEQ += wTemp;
+				MyTCBStub.rxHead += wTemp;
+				if(MyTCBStub.rxHead > MyTCBStub.bufferEnd)
+					MyTCBStub.rxHead -= MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart + 1;
 			}
 		} // This packet is out of order or we lost a packet, see if we can generate a hole to accomodate it
-		else if((SHORT)wMissingBytes > 0)
+		else if(lMissingBytes > 0)
 		{
 			// Truncate packets that would overflow our TCP RX FIFO
 			if(len + wMissingBytes > wFreeSpace)
@@ -4122,7 +6008,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 			{
 				// Calculate number of data bytes to copy before wraparound
 				wTemp = MyTCBStub.bufferEnd - MyTCBStub.rxHead + 1 - wMissingBytes;
-				if((SHORT)wTemp >= 0)
+				if(MyTCBStub.rxHead + wMissingBytes <= MyTCBStub.bufferEnd)
 				{
 					TCPRAMCopy(MyTCBStub.rxHead + wMissingBytes, MyTCBStub.vMemoryMedium, (PTR_BASE)-1, TCP_ETH_RAM, wTemp);
 					TCPRAMCopy(MyTCBStub.bufferRxStart, MyTCBStub.vMemoryMedium, (PTR_BASE)-1, TCP_ETH_RAM, len - wTemp);
@@ -4137,33 +6023,11 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				TCPRAMCopy(MyTCBStub.rxHead + wMissingBytes, MyTCBStub.vMemoryMedium, (PTR_BASE)-1, TCP_ETH_RAM, len);
 			}
 		
-			// Record the hole is here
-			if(MyTCB.sHoleSize == -1)
-			{
-				MyTCB.sHoleSize = wMissingBytes;
-				MyTCB.wFutureDataSize = len;
-			}
-			else
-			{
-				// We already have a hole, see if we can shrink the hole 
-				// or extend the future data size
-				if(wMissingBytes < (WORD)MyTCB.sHoleSize)
-				{
-					if((wMissingBytes + len > (WORD)MyTCB.sHoleSize + MyTCB.wFutureDataSize) || (wMissingBytes + len < (WORD)MyTCB.sHoleSize))
-						MyTCB.wFutureDataSize = len;
-					else
-						MyTCB.wFutureDataSize = (WORD)MyTCB.sHoleSize + MyTCB.wFutureDataSize - wMissingBytes;
-					MyTCB.sHoleSize = wMissingBytes;
-				}
-				else if(wMissingBytes + len > (WORD)MyTCB.sHoleSize + MyTCB.wFutureDataSize)
-				{
-					// Make sure that there isn't a second hole between 
-					// our future data and this TCP segment's future data
-					if(wMissingBytes <= (WORD)MyTCB.sHoleSize + MyTCB.wFutureDataSize)
-						MyTCB.wFutureDataSize += wMissingBytes + len - (WORD)MyTCB.sHoleSize - MyTCB.wFutureDataSize;
-				}
-				
-			}
+			// Record the block of data beyond the hole.  It is joined to 
+			// any blocks it overlaps or touches, and reported first in our 
+			// SACK option.  If TCP_SACK_BLOCKS blocks are already kept, the 
+			// oldest one is forgotten and will be received again.
+			MyTCB.vRxBlocks = AddSACKBlock(MyTCB.rxBlocks, MyTCB.vRxBlocks, wMissingBytes, wMissingBytes + len);
 		}
 	}
 
@@ -4187,7 +6051,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 		if(MyTCBStub.smState != TCP_ESTABLISHED)
 			MyTCBStub.rxTail = MyTCBStub.rxHead;
 
-		if(MyTCBStub.Flags.bOneSegmentReceived)
+		if(MyTCBStub.Flags.bOneSegmentReceived || bImmediateACK)
 		{
 			SendTCP(ACK, SENDTCP_RESET_TIMERS);
 			SyncTCB();
@@ -4367,10 +6231,10 @@ BOOL TCPAdjustFIFOSize(TCP_SOCKET hTCP, WORD wMinRXSize, WORD wMinTXSize, BYTE v
 	// SSL connections need to be able to send or receive at least 
 	// a full Alert record, MAC, and FIN
 	#if defined(STACK_USE_SSL)
-	if(TCPIsSSL(hTCP) && wMinRXSize < 25u)
-		wMinRXSize = 25;
-	if(TCPIsSSL(hTCP) && wMinTXSize < 25u)
-		wMinTXSize = 25;
+	if(TCPIsSSL(hTCP) && wMinRXSize < SSL_TX_RESERVE+3u)
+		wMinRXSize = SSL_TX_RESERVE+3u;
+	if(TCPIsSSL(hTCP) && wMinTXSize < SSL_TX_RESERVE+3u)
+		wMinTXSize = SSL_TX_RESERVE+3u;
 	#endif
 	
 	// Make sure space is available for minimums
@@ -4414,9 +6278,9 @@ BOOL TCPAdjustFIFOSize(TCP_SOCKET hTCP, WORD wMinRXSize, WORD wMinTXSize, BYTE v
 	#endif
 	
 	// If there's out-of-order data pending, adjust the head pointer to compensate
-	if(MyTCB.sHoleSize != -1)
+	if(MyTCB.vRxBlocks)
 	{
-		ptrHead += MyTCB.sHoleSize + MyTCB.wFutureDataSize;
+		ptrHead += GetOutOfOrderEnd();
 		if(ptrHead > MyTCBStub.bufferEnd)
 			ptrHead -= MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart + 1;
 	}
@@ -4886,6 +6750,7 @@ BOOL TCPStartSSLClientEx(TCP_SOCKET hTCP, BYTE* host, void * buffer, BYTE suppDa
 BOOL TCPStartSSLServer(TCP_SOCKET hTCP)
 {
 	BYTE i;
+	WORD wPort;
 	
 	if(hTCP >= TCP_SOCKET_COUNT)
     {
@@ -4907,9 +6772,9 @@ BOOL TCPStartSSLServer(TCP_SOCKET hTCP)
 		return FALSE;
 
 	// Swap the localPort and localSSLPort
-	MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
+	wPort = MyTCB.localPort.Val;
 	MyTCB.localPort.Val = MyTCB.localSSLPort.Val;
-	MyTCB.localSSLPort.Val = MyTCBStub.remoteHash.Val;	
+	MyTCB.localSSLPort.Val = wPort;
 
 	// Mark connection as handshaking and return
 	MyTCBStub.sslReqMessage = SSL_NO_MESSAGE;
@@ -5315,6 +7180,212 @@ void TCPSSLInPlaceMACEncrypt(TCP_SOCKET hTCP, ARCFOUR_CTX* ctx, BYTE* MACSecret,
 }	
 #endif // SSL
 
+/*****************************************************************************
+  Function:
+	void TCPSSLDecryptGCM(TCP_SOCKET hTCP, AES_GCM_CTX* ctx, WORD len)
+
+  Summary:
+	Decrypts and authenticates AES-GCM data arriving via SSL.
+
+  Description:
+	This function decrypts data in the TCP buffer and adds it to the 
+	GHASH calculation of ctx, in one pass over the data.  All data is left
+	in the exact same location in the TCP buffer.  It is called to help 
+	process incoming TLS 1.2 records.
+	
+  Precondition:
+	TCP is initialized, hTCP is connected, ctx's GHASH table is loaded and
+	AESGCMStart() has been called for the record.
+
+  Parameters:
+	hTCP		- TCP connection to decrypt in
+	ctx			- AES-GCM context to use
+	len 		- Number of bytes to decrypt
+
+  Returns:
+	None
+
+  Remarks:
+	This function should never be called by an application.  It is used 
+	only by the SSL module itself.
+  ***************************************************************************/
+#if defined(STACK_USE_SSL) && defined(STACK_USE_AES_GCM)
+void TCPSSLDecryptGCM(TCP_SOCKET hTCP, AES_GCM_CTX* ctx, WORD len)
+{
+	PTR_BASE pos;
+	WORD blockLen;
+	BYTE buffer[32];
+	
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return;
+    }
+    
+	// Set up the pointers
+	SyncTCBStub(hTCP);
+	pos = MyTCBStub.rxTail;
+	
+	// Handle 32 bytes at a time, stopping at the end of the buffer
+	while(len)
+	{
+		blockLen = sizeof(buffer);
+		if(blockLen > len)
+			blockLen = len;
+		if(blockLen > MyTCBStub.bufferEnd - pos + 1)
+			blockLen = MyTCBStub.bufferEnd - pos + 1;
+		
+		TCPRAMCopy((PTR_BASE)buffer, TCP_PIC_RAM, pos, MyTCBStub.vMemoryMedium, blockLen);
+		AESGCMDecrypt(ctx, buffer, blockLen);
+		TCPRAMCopy(pos, MyTCBStub.vMemoryMedium, (PTR_BASE)buffer, TCP_PIC_RAM, blockLen);
+		
+		pos += blockLen;
+		len -= blockLen;
+		if(pos > MyTCBStub.bufferEnd)
+			pos = MyTCBStub.bufferRxStart;
+	}
+}	
+#endif // SSL && AES-GCM
+
+/*****************************************************************************
+  Function:
+	void TCPSSLInPlaceGCMEncrypt(TCP_SOCKET hTCP, AES_GCM_CTX* ctx, 
+									BYTE* nonce, WORD len)
+
+  Summary:
+	Encrypts and authenticates data in place in the TCP TX buffer.
+
+  Description:
+	This function turns the pending record data in the TCP TX buffer into
+	a TLS 1.2 AES-GCM record body: the 8 byte explicit nonce, the cipher
+	text and the 16 byte tag.  The data is read, encrypted, hashed and 
+	written back 8 bytes further on in a single pass, so no second copy
+	of the record is needed.  When finished, the record will be ready to
+	transmit.
+	
+  Precondition:
+	TCP is initialized, hTCP is connected, ctx's GHASH table is loaded and
+	AESGCMStart() has been called with nonce.
+
+  Parameters:
+	hTCP		- TCP connection to encrypt in
+	ctx			- AES-GCM context to use
+	nonce		- The 8 byte explicit nonce to send
+	len 		- Number of bytes to encrypt
+
+  Returns:
+	None
+
+  Remarks:
+	This function should never be called by an application.  It is used 
+	only by the SSL module itself.  TCPIsPutReady() keeps SSL_TX_RESERVE
+	bytes free so that the nonce and tag fit.
+  ***************************************************************************/
+#if defined(STACK_USE_SSL) && defined(STACK_USE_AES_GCM)
+void TCPSSLInPlaceGCMEncrypt(TCP_SOCKET hTCP, AES_GCM_CTX* ctx, BYTE* nonce, WORD len)
+{
+	PTR_BASE rd, wr;
+	WORD blockLen, have;
+	BYTE buffer[8+32];
+	
+	if(hTCP >= TCP_SOCKET_COUNT)
+    {
+        return;
+    }
+    
+	// Set up the pointers
+	SyncTCBStub(hTCP);
+	rd = MyTCBStub.txHead;
+	for(blockLen = 0; blockLen < 5u; blockLen++)
+	{// Skips first 5 bytes for the header
+		if(++rd >= MyTCBStub.bufferRxStart)
+			rd = MyTCBStub.bufferTxStart;
+	}
+	wr = rd;
+	
+	// Read ahead the bytes the nonce will overwrite
+	have = 8;
+	if(have > len)
+		have = len;
+	rd = TCPSSLCopyTx(rd, buffer, have, FALSE);
+	len -= have;
+	wr = TCPSSLCopyTx(wr, nonce, 8, TRUE);
+	
+	// Handle 32 bytes at a time.  While data remains to be read, the 
+	// last 8 bytes are held back because writing them would overwrite
+	// unread data.
+	while(have)
+	{
+		blockLen = sizeof(buffer) - 8;
+		if(blockLen > len)
+			blockLen = len;
+		rd = TCPSSLCopyTx(rd, &buffer[have], blockLen, FALSE);
+		have += blockLen;
+		len -= blockLen;
+		
+		blockLen = have;
+		if(len)
+			blockLen -= 8;
+		AESGCMEncrypt(ctx, buffer, blockLen);
+		wr = TCPSSLCopyTx(wr, buffer, blockLen, TRUE);
+		have -= blockLen;
+		memmove((void*)buffer, (void*)&buffer[blockLen], have);
+	}
+	
+	// Calculate and add the tag
+	// Can't use TCPPutArray here because TCPIsPutReady() saves space for the 
+	// nonce and tag.  TCPPut* functions use this to prevent writing too 
+	// much data.
+	AESGCMCalculate(ctx, buffer);
+	MyTCBStub.sslTxHead = TCPSSLCopyTx(wr, buffer, 16, TRUE);
+}
+
+/*****************************************************************************
+  Function:
+	static PTR_BASE TCPSSLCopyTx(PTR_BASE pos, BYTE* data, WORD len,
+									BOOL bWrite)
+
+  Summary:
+	Copies data to or from the TCP TX buffer of the loaded socket.
+
+  Description:
+	This function copies len bytes between data and the TX FIFO at pos,
+	wrapping around the end of the FIFO if needed.
+	
+  Precondition:
+	The TCB stub is synced.
+
+  Parameters:
+	pos			- Position in the TX FIFO
+	data		- RAM buffer
+	len			- Number of bytes to copy
+	bWrite		- TRUE to write data to the FIFO, FALSE to read it
+
+  Returns:
+	The position following the bytes copied
+  ***************************************************************************/
+static PTR_BASE TCPSSLCopyTx(PTR_BASE pos, BYTE* data, WORD len, BOOL bWrite)
+{
+	WORD part;
+	
+	while(len)
+	{
+		part = len;
+		if(part > MyTCBStub.bufferRxStart - pos)
+			part = MyTCBStub.bufferRxStart - pos;
+		if(bWrite)
+			TCPRAMCopy(pos, MyTCBStub.vMemoryMedium, (PTR_BASE)data, TCP_PIC_RAM, part);
+		else
+			TCPRAMCopy((PTR_BASE)data, TCP_PIC_RAM, pos, MyTCBStub.vMemoryMedium, part);
+		data += part;
+		len -= part;
+		pos += part;
+		if(pos >= MyTCBStub.bufferRxStart)
+			pos = MyTCBStub.bufferTxStart;
+	}
+	return pos;
+}
+#endif // SSL && AES-GCM
+
 /*****************************************************************************
   Function:
 	void TCPSSLPutRecordHeader(TCP_SOCKET hTCP, BYTE* hdr, BOOL recDone)
@@ -5503,13 +7574,13 @@ void TCPSSLHandleIncoming(TCP_SOCKET hTCP)
 				SyncTCB();
 
 				// Calculate how big the SSL hole is
-				if(MyTCB.sHoleSize == -1)
+				if(MyTCB.vRxBlocks == 0u)
 				{// Just need to move pending SSL data
 					wToMove = TCPIsGetReady(hTCP);
 				}
 				else
 				{// A TCP hole exists, so move all data
-					wToMove = TCPIsGetReady(hTCP) + MyTCB.sHoleSize + MyTCB.wFutureDataSize;
+					wToMove = TCPIsGetReady(hTCP) + GetOutOfOrderEnd();
 				}
 				
 				// Start with the destination as the startRxTail and source as current rxTail
@@ -346,7 +346,7 @@ CHAR TFTPGetUploadStatus(void)
 	if(UDPIsOpened(_tftpSocket)== FALSE)
 	{
 
-		_tftpSocket = UDPOpenEx((DWORD)(ROM_PTR_BASE)vUploadRemoteHost,
+		_tftpSocket = UDPOpenEx((DWORD_PTR_BASE)(ROM_PTR_BASE)vUploadRemoteHost,
 										 UDP_OPEN_ROM_HOST,TFTP_CLIENT_PORT,
 										 TFTP_SERVER_PORT);
 	}
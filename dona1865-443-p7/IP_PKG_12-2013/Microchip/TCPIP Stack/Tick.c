@@ -54,11 +54,19 @@
  *									writing for perfect accuracy.
  *                      6/17/13     Updated to remove compile warnings
  * Richard Wall         12/4/13     Only references PIC32
+ *                      10/18/26    Added the GCC host build
 ********************************************************************/
 #define __TICK_C
 
 #include "TCPIP Stack/TCPIP.h"
 
+#if defined(COMPILER_HOST_GCC)
+	#include <time.h>
+
+	// Monotonic clock value when TickInit() was called
+	static struct timespec tsTickStart;
+#endif
+
 // Internal counter to store Ticks.  This variable is incremented in an ISR and 
 // therefore must be marked volatile to prevent the compiler optimizer from 
 // reordering code to use this value in the main context while interrupts are 
@@ -80,6 +88,10 @@ static void GetTickCopy(void);
   ***************************************************************************/
 void TickInit(void)
 {
+#if defined(COMPILER_HOST_GCC)
+	// The host build derives the tick from the monotonic clock
+	clock_gettime(CLOCK_MONOTONIC, &tsTickStart);
+#else
 	// Use Timer 1 for 16-bit and 32-bit processors
 	// 1:256 prescale
 	T1CONbits.TCKPS = 3;
@@ -94,6 +106,7 @@ void TickInit(void)
 
 	// Start timer
 	T1CONbits.TON = 1;
+#endif
 }
 
 /*****************************************************************************
@@ -107,6 +120,22 @@ void TickInit(void)
   ***************************************************************************/
 static void GetTickCopy(void)
 {
+#if defined(COMPILER_HOST_GCC)
+	// Scale the time since TickInit() to TICKS_PER_SECOND.  The 48-bit 
+	// value wraps after several years at the usual tick rates.
+	struct timespec ts;
+	QWORD qwTicks;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	qwTicks = (QWORD)(ts.tv_sec - tsTickStart.tv_sec)*TICKS_PER_SECOND;
+	qwTicks += ((QWORD)(ts.tv_nsec + 1000000000l - tsTickStart.tv_nsec)*TICKS_PER_SECOND)/1000000000ull;
+	qwTicks -= TICKS_PER_SECOND;
+	for(i = 0; i < 6; i++)
+	{
+		vTickReading[i] = (BYTE)(qwTicks >> (8*i));
+	}
+#else
 	// Perform an Interrupt safe and synchronized read of the 48-bit 
 	// tick value
 	// PIC32
@@ -142,6 +171,7 @@ static void GetTickCopy(void)
 		vTickReading[5] = ((BYTE*)&dwTempTicks)[3];
 	} while(IFS0bits.T1IF);
 	IEC0SET = _IEC0_T1IE_MASK;		// Enable interrupt
+#endif
 }
 
 
@@ -83,6 +83,9 @@
  *								 UDPInit(), UDPClose(), or reseting 
  *								 the part without clearing all the 
  *								 PIC memory.
+ *                      10/18/26 Hashed socket lookup in
+ *                               FindMatchingSocket()
+ *                      10/18/26 Added UDPFlushFragments()
  ********************************************************************/
 #define __UDP_C
 
@@ -101,6 +104,16 @@
 // Last port number for randomized local port number selection
 #define LOCAL_UDP_PORT_END_NUMBER   (8192u)
 
+// Number of hash chains used to find the socket for an incoming segment.  
+// Open sockets are chained in the bucket of their local port.  Must be a 
+// power of 2.  Can be overridden in TCPIPConfig.h.
+#if !defined(UDP_HASH_BUCKETS)
+	#define UDP_HASH_BUCKETS		(8u)
+#endif
+#if (UDP_HASH_BUCKETS & (UDP_HASH_BUCKETS - 1)) || (UDP_HASH_BUCKETS > 256)
+	#error "UDP_HASH_BUCKETS must be a power of 2 no larger than 256"
+#endif
+
 /****************************************************************************
   Section:
 	UDP Global Variables
@@ -128,6 +141,12 @@ static struct
 // Indicates which socket has currently received data for this loop
 static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
 
+// Hash chains of open sockets by local port.  Chains end with 
+// INVALID_UDP_SOCKET.
+#define UDP_HASH_BUCKET(w)	((BYTE)((w) ^ ((w)>>8)) & (UDP_HASH_BUCKETS-1u))
+static UDP_SOCKET UDPHashHead[UDP_HASH_BUCKETS];	// First socket of each chain
+static UDP_SOCKET UDPHashNext[MAX_UDP_SOCKETS];		// Next socket in the same chain
+
 /****************************************************************************
   Section:
 	Function Prototypes
@@ -135,6 +154,9 @@ static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
 
 static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h, NODE_INFO *remoteNode,
                                     IP_ADDR *localIP);
+static void UDPHashLink(UDP_SOCKET s);
+static void UDPHashUnlink(UDP_SOCKET s);
+static void UDPPutHeaders(WORD wFragmentLength, WORD wFragmentSum);
 
 /****************************************************************************
   Section:
@@ -168,8 +190,11 @@ void UDPInit(void)
 {
     UDP_SOCKET s;
 
+	memset((void*)UDPHashHead, INVALID_UDP_SOCKET, sizeof(UDPHashHead));
     for ( s = 0; s < MAX_UDP_SOCKETS; s++ )
     {
+		// Mark as free first so that UDPClose() doesn't unlink it
+		UDPSocketInfo[s].localPort = INVALID_UDP_PORT;
 		UDPClose(s);
     }
 	Flags.bWasDiscarded = 1;
@@ -178,7 +203,7 @@ void UDPInit(void)
 
 /*****************************************************************************
 Function:
-	UDP_SOCKET UDPOpenEx(DWORD remoteHost, BYTE remoteHostType, UDP_PORT localPort,
+	UDP_SOCKET UDPOpenEx(DWORD_PTR_BASE remoteHost, BYTE remoteHostType, UDP_PORT localPort,
 	UDP_PORT remotePort)
 
  Summary:
@@ -237,7 +262,7 @@ Remarks:
 	socket and delete the handle.
 
 *****************************************************************************/
-UDP_SOCKET UDPOpenEx(DWORD remoteHost, BYTE remoteHostType, UDP_PORT localPort,
+UDP_SOCKET UDPOpenEx(DWORD_PTR_BASE remoteHost, BYTE remoteHostType, UDP_PORT localPort,
 		UDP_PORT remotePort)
 {
 	UDP_SOCKET s;
@@ -260,6 +285,7 @@ UDP_SOCKET UDPOpenEx(DWORD remoteHost, BYTE remoteHostType, UDP_PORT localPort,
 
 			   p->localPort    = NextPort++;
 		   	}
+			UDPHashLink(s);
 			if((remoteHostType == UDP_OPEN_SERVER) || (remoteHost == 0))
 			{
 				  //Set remote node as 0xFF ( broadcast address)
@@ -564,6 +590,7 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
 	
 	            p->localPort    = NextPort++;
 			}
+			UDPHashLink(s);
 
             // If remoteNode is supplied, remember it.
             if(remoteNode)
@@ -624,6 +651,8 @@ void UDPClose(UDP_SOCKET s)
 	if(s >= MAX_UDP_SOCKETS)
 		return;
 
+	if(UDPSocketInfo[s].localPort != INVALID_UDP_PORT)
+		UDPHashUnlink(s);
 	UDPSocketInfo[s].localPort = INVALID_UDP_PORT;
 	UDPSocketInfo[s].remote.remoteNode.IPAddr.Val = 0x00000000;
 	UDPSocketInfo[s].smState = UDP_CLOSED;
@@ -956,6 +985,151 @@ ROM BYTE* UDPPutROMString(ROM BYTE *strData)
 	the main stack loop.  There is no auto transmit for UDP segments.
   ***************************************************************************/
 void UDPFlush(void)
+{
+	UDPPutHeaders(0, 0x0000);
+	
+	// Transmit the packet
+    MACFlush();
+
+	// Reset packet size counter for the next TX operation
+    UDPTxCount = 0;
+	LastPutSocket = INVALID_UDP_SOCKET;
+}
+
+/*****************************************************************************
+  Function:
+	WORD UDPFlushFragments(TX_FRAGMENT* pFragments, BYTE vCount)
+
+  Summary:
+	Transmits the pending data of a UDP socket followed by a list of 
+	fragments.
+	
+  Description:
+	This function sends one UDP packet holding the data already written 
+	with the UDPPut family of functions followed by the data of each 
+	fragment, in order.  It lets an application send a header and a payload
+	held in different RAM or ROM buffers without assembling them first.
+	
+	When the MAC can gather a frame (MAC_TX_GATHER_FRAGMENTS is defined), 
+	the fragments are summed for the UDP checksum and sent from where they 
+	are, without being copied to the MAC TX buffer.  Otherwise, or when 
+	there are more fragments than the MAC can gather, they are copied to 
+	the MAC TX buffer and the packet is sent as by UDPFlush().
+
+  Precondition:
+	UDPIsPutReady() was previously called to specify the current socket.
+
+  Parameters:
+	pFragments - The fragments to send after the pending data.
+	vCount - Number of fragments in pFragments.
+	
+  Returns:
+  	The number of fragment bytes sent.  If this value is less than the 
+  	total length of the fragments, the packet became full and the data was
+  	truncated.
+
+  Remarks:
+	The fragments only need to stay valid until this function returns.
+  ***************************************************************************/
+WORD UDPFlushFragments(TX_FRAGMENT* pFragments, BYTE vCount)
+{
+	WORD wRoom, wLength, wTotal;
+	BYTE i;
+
+	wRoom = MAC_TX_BUFFER_SIZE - sizeof(IP_HEADER) - sizeof(UDP_HEADER) - UDPTxCount;
+
+	#if defined(MAC_TX_GATHER_FRAGMENTS)
+	if(vCount <= MAC_TX_GATHER_FRAGMENTS)
+	{
+		DWORD_VAL dwSum;
+		#if defined(UDP_USE_TX_CHECKSUM)
+		WORD wSum;
+		#endif
+		
+		// Find out if every fragment fits in the packet
+		wTotal = 0;
+		for(i = 0; i < vCount; i++)
+		{
+			if(pFragments[i].wLength > wRoom - wTotal)
+				break;
+			wTotal += pFragments[i].wLength;
+		}
+
+		if(i == vCount)
+		{
+			// Sum the fragments, swapping the sum of those that start at an
+			// odd offset in the UDP data
+			dwSum.Val = 0x00000000ul;
+			#if defined(UDP_USE_TX_CHECKSUM)
+			wTotal = 0;
+			for(i = 0; i < vCount; i++)
+			{
+				wSum = ~CalcIPChecksum(pFragments[i].data.pRAM, pFragments[i].wLength);
+				if((UDPTxCount + wTotal) & 0x1u)
+					wSum = swaps(wSum);
+				dwSum.Val += (DWORD)wSum;
+				wTotal += pFragments[i].wLength;
+			}
+			dwSum.Val = (DWORD)dwSum.w[0] + (DWORD)dwSum.w[1];
+			dwSum.w[0] += dwSum.w[1];
+			#endif
+
+			UDPPutHeaders(wTotal, dwSum.w[0]);
+			MACFlushFragments(pFragments, vCount);
+
+			UDPTxCount = 0;
+			LastPutSocket = INVALID_UDP_SOCKET;
+			return wTotal;
+		}
+	}
+	#endif
+
+	// Copy the fragments after the pending data, truncating the data that
+	// does not fit
+	MACSetWritePtr(BASE_TX_ADDR + sizeof(ETHER_HEADER) + sizeof(IP_HEADER) + sizeof(UDP_HEADER) + UDPTxCount);
+	wTotal = 0;
+	for(i = 0; i < vCount && wTotal < wRoom; i++)
+	{
+		wLength = pFragments[i].wLength;
+		if(wLength > wRoom - wTotal)
+			wLength = wRoom - wTotal;
+		if(pFragments[i].bROM)
+			MACPutROMArray(pFragments[i].data.pROM, wLength);
+		else
+			MACPutArray(pFragments[i].data.pRAM, wLength);
+		wTotal += wLength;
+	}
+
+	UDPTxCount += wTotal;
+	UDPFlush();
+	return wTotal;
+}
+
+/*****************************************************************************
+  Function:
+	static void UDPPutHeaders(WORD wFragmentLength, WORD wFragmentSum)
+
+  Summary:
+	Writes the IP and UDP headers of the packet being sent.
+	
+  Description:
+	This function writes the IP and UDP headers in front of the pending TX 
+	data and, if UDP_USE_TX_CHECKSUM is defined, the UDP checksum.  The 
+	packet is UDPTxCount bytes of data in the MAC TX buffer followed by 
+	wFragmentLength bytes that the MAC gathers from elsewhere.
+
+  Precondition:
+	UDPIsPutReady() was previously called to specify the current socket.
+
+  Parameters:
+	wFragmentLength - Number of data bytes that follow the pending TX data.
+	wFragmentSum - One's complement sum of those bytes, as words of the 
+		UDP data.
+	
+  Returns:
+  	None
+  ***************************************************************************/
+static void UDPPutHeaders(WORD wFragmentLength, WORD wFragmentSum)
 {
     UDP_HEADER      h;
     UDP_SOCKET_INFO *p;
@@ -963,7 +1137,7 @@ void UDPFlush(void)
 
     p = &UDPSocketInfo[activeUDPSocket];
 
-	wUDPLength = UDPTxCount + sizeof(UDP_HEADER);
+	wUDPLength = UDPTxCount + sizeof(UDP_HEADER) + wFragmentLength;
 
 	// Generate the correct UDP header
     h.SourcePort        = swaps(p->localPort);
@@ -972,10 +1146,11 @@ void UDPFlush(void)
 	h.Checksum 			= 0x0000;
     
 	// Calculate IP pseudoheader checksum if we are going to enable 
-	// the checksum field
+	// the checksum field.  The sum of the fragments is added to it.
 	#if defined(UDP_USE_TX_CHECKSUM)
 	{
 		PSEUDO_HEADER   pseudoHeader;
+		DWORD_VAL		dwSum;
 		
 		pseudoHeader.SourceAddress	= AppConfig.MyIPAddr;
 		pseudoHeader.DestAddress    = p->remote.remoteNode.IPAddr;
@@ -983,7 +1158,11 @@ void UDPFlush(void)
 		pseudoHeader.Protocol       = IP_PROT_UDP;
 		pseudoHeader.Length			= wUDPLength;
 		SwapPseudoHeader(pseudoHeader);
-		h.Checksum = ~CalcIPChecksum((BYTE*)&pseudoHeader, sizeof(pseudoHeader));
+		dwSum.Val = (DWORD)(WORD)~CalcIPChecksum((BYTE*)&pseudoHeader, sizeof(pseudoHeader)) + (DWORD)wFragmentSum;
+		dwSum.w[0] += dwSum.w[1];
+		if(dwSum.w[0] < dwSum.w[1])
+			dwSum.w[0]++;
+		h.Checksum = dwSum.w[0];
 	}
 	#endif
 
@@ -1004,7 +1183,7 @@ void UDPFlush(void)
         WORD		wChecksum;
 
 		wReadPtrSave = MACSetReadPtr(BASE_TX_ADDR + sizeof(ETHER_HEADER) + sizeof(IP_HEADER));
-		wChecksum = CalcIPBufferChecksum(wUDPLength);
+		wChecksum = CalcIPBufferChecksum(UDPTxCount + sizeof(UDP_HEADER));
 		if(wChecksum == 0x0000u)
 			wChecksum = 0xFFFF;
 		MACSetReadPtr(wReadPtrSave);
@@ -1012,17 +1191,9 @@ void UDPFlush(void)
 		MACPutArray((BYTE*)&wChecksum, sizeof(wChecksum));
 	}
 	#endif
-    
-	// Transmit the packet
-    MACFlush();
-
-	// Reset packet size counter for the next TX operation
-    UDPTxCount = 0;
-	LastPutSocket = INVALID_UDP_SOCKET;
 }
 
 
-
 /****************************************************************************
   Section:
 	Receive Functions
@@ -1289,7 +1460,8 @@ BOOL UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, WORD len)
 	
   Description:
 	This function attempts to match an incoming UDP segment to a currently
-	active socket for processing.
+	active socket for processing.  Only the sockets chained in the bucket 
+	of the destination port are searched.
 
   Precondition:
 	UDP segment header and IP header have both been retrieved.
@@ -1326,9 +1498,10 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 
 	partialMatch = INVALID_UDP_SOCKET;
 
-	p = UDPSocketInfo;
-    for(s = 0; s < MAX_UDP_SOCKETS; s++)
+    for(s = UDPHashHead[UDP_HASH_BUCKET(h->DestinationPort)]; s != INVALID_UDP_SOCKET; s = UDPHashNext[s])
 	{
+		p = &UDPSocketInfo[s];
+
 		// This packet is said to be matching with current socket:
 		// 1. If its destination port matches with our local port and
 		// 2. Packet source IP address matches with previously saved socket remote IP address and
@@ -1345,7 +1518,6 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 
 			partialMatch = s;
 		}
-		p++;
 	}
 
 	if(partialMatch != INVALID_UDP_SOCKET)
@@ -1361,5 +1533,68 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 	return partialMatch;
 }
 
+/*****************************************************************************
+  Function:
+	static void UDPHashLink(UDP_SOCKET s)
+
+  Summary:
+	Adds a socket to the hash chain of its local port.
+	
+  Description:
+	This function inserts the socket at the head of the hash chain that 
+	FindMatchingSocket() searches for its local port.
+
+  Precondition:
+	The socket's localPort has been set and the socket is not chained.
+
+  Parameters:
+	s - The socket to add.
+	
+  Returns:
+  	None
+  ***************************************************************************/
+static void UDPHashLink(UDP_SOCKET s)
+{
+	BYTE b;
+
+	b = UDP_HASH_BUCKET(UDPSocketInfo[s].localPort);
+	UDPHashNext[s] = UDPHashHead[b];
+	UDPHashHead[b] = s;
+}
+
+/*****************************************************************************
+  Function:
+	static void UDPHashUnlink(UDP_SOCKET s)
+
+  Summary:
+	Removes a socket from the hash chain of its local port.
+	
+  Description:
+	This function removes the socket from the hash chain it was added to 
+	by UDPHashLink().  Nothing happens if the socket is not found.
+
+  Precondition:
+	The socket's localPort has not changed since UDPHashLink().
+
+  Parameters:
+	s - The socket to remove.
+	
+  Returns:
+  	None
+  ***************************************************************************/
+static void UDPHashUnlink(UDP_SOCKET s)
+{
+	UDP_SOCKET *p;
+
+	for(p = &UDPHashHead[UDP_HASH_BUCKET(UDPSocketInfo[s].localPort)]; *p != INVALID_UDP_SOCKET; p = &UDPHashNext[*p])
+	{
+		if(*p == s)
+		{
+			*p = UDPHashNext[s];
+			break;
+		}
+	}
+}
+
 
 #endif //#if defined(STACK_USE_UDP)
@@ -131,7 +131,7 @@ void UDPPerformanceTask(void)
 	memset(&Remote, 0xFF, sizeof(Remote));
 	
 	// Open a UDP socket for outbound transmission
-	MySocket = UDPOpenEx((DWORD)(PTR_BASE)&Remote,UDP_OPEN_NODE_INFO,0,PERFORMANCE_PORT);
+	MySocket = UDPOpenEx((DWORD_PTR_BASE)(PTR_BASE)&Remote,UDP_OPEN_NODE_INFO,0,PERFORMANCE_PORT);
 	//MySocket = UDPOpen(0, &Remote, PERFORMANCE_PORT);
 	
 	// Abort operation if no UDP sockets are available
@@ -51,6 +51,7 @@ public class DynVar {
     private Pattern parser = Pattern.compile(regEx);
 
     private String projectDir;
+    private boolean varLengths = false;
 
     String HTTPPRINT_H_HEADER =
         "/*********************************************************************\r\n" +
@@ -159,6 +160,15 @@ public class DynVar {
     }
 
 
+    /// <summary>
+    /// Sets whether index records hold the length of each variable
+    /// (MPFS2_FLAG_HASVARLEN), which earlier firmware cannot read
+    /// </summary>
+    public void VarLengths(boolean enable)
+    {
+        this.varLengths = enable;
+    }
+
     /// <summary>
     /// Parses and indexes a file for dynamic variables
     /// </summary>
@@ -179,6 +189,15 @@ public class DynVar {
             resizeArray.write((byte)(matches.start()>>8));
             resizeArray.write((byte)(matches.start()>>16));
             resizeArray.write((byte)(matches.start()>>24));
+            // Length, so that the server can seek past the variable
+            // (MPFS2_FLAG_HASVARLEN)
+            if (varLengths)
+            {
+                resizeArray.write((byte)(matches.end() - matches.start()));
+                resizeArray.write((byte)((matches.end() - matches.start())>>8));
+                resizeArray.write((byte)((matches.end() - matches.start())>>16));
+                resizeArray.write((byte)((matches.end() - matches.start())>>24));
+            }
             resizeArray.write((byte)i);
             resizeArray.write((byte)(i>>8));
             resizeArray.write((byte)(i>>16));
@@ -48,6 +48,9 @@ public class MPFS2Lib //: MPFS2Writer
     public String SourcePath;
     private Collection<String> dynamicTypes;
     private Collection<String> nonGZipTypes;
+    private boolean inflateBlocks;
+    private boolean varLengths;
+    private boolean sortedIndex;
     private DynVar dynVarParser;
     public List<String> log;
     public List<MPFSFileRecord> files;
@@ -57,6 +60,13 @@ public class MPFS2Lib //: MPFS2Writer
     public DataOutputStream data_out;
     public int MPFS2_FLAG_ISZIPPED = 0x0001;
     public int MPFS2_FLAG_HASINDEX = 0x0002;
+    public int MPFS2_FLAG_HASVARLEN = 0x0004;
+    public int MPFS2_FLAG_HASBLOCKS = 0x0008;
+
+    // Uncompressed bytes in each deflate block of a GZIP file.  Each
+    // block starts with a full flush, so that HTTP_USE_INFLATE can
+    // decompress it alone, with a window of this size.
+    public static final int GZIP_BLOCK_LEN = 4096;
     //public static long ImageLength=0;
     public static String ASCIILine;
     public static String emptyStr;
@@ -140,6 +150,9 @@ public class MPFS2Lib //: MPFS2Writer
         //this.SourcePath = sourcePath;
         this.dynamicTypes = new ArrayList<String>();
         this.nonGZipTypes = new ArrayList<String>();
+        this.inflateBlocks = false;
+        this.varLengths = false;
+        this.sortedIndex = false;
         this.log = new ArrayList<String>();
         this.files = new LinkedList<MPFSFileRecord>();
         this.dynVarParser = new MicrochipMPFS.DynVar(localPath);
@@ -180,6 +193,36 @@ public class MPFS2Lib //: MPFS2Writer
         }
     }
 
+    /// <summary>
+    /// Sets whether GZIP files are written in blocks of GZIP_BLOCK_LEN
+    /// bytes with a block index, for HTTP_USE_INFLATE
+    /// </summary>
+    public void InflateBlocks(boolean enable)
+    {
+        this.inflateBlocks = enable;
+    }
+
+    /// <summary>
+    /// Sets whether dynamic variable indexes hold the length of each
+    /// variable (MPFS2_FLAG_HASVARLEN).  Firmware built before this
+    /// flag reads such indexes wrongly, so it is off by default.
+    /// </summary>
+    public void VarLengths(boolean enable)
+    {
+        this.varLengths = enable;
+        this.dynVarParser.VarLengths(enable);
+    }
+
+    /// <summary>
+    /// Sets whether a version 2.2 image with a sorted hash index is
+    /// written.  Firmware built before 2.2 rejects such images, so
+    /// version 2.1 is the default.
+    /// </summary>
+    public void SortedIndex(boolean enable)
+    {
+        this.sortedIndex = enable;
+    }
+
     /// <summary>
     /// Adds a file to the MPFS image
     /// </summary>
@@ -255,69 +298,32 @@ public class MPFS2Lib //: MPFS2Writer
 
         // GZip the file if possible
         int gzipRatio = 0;
+        MPFSFileRecord blkFile = null;
         if (idxFile == null && !this.FileMatches(localName, this.nonGZipTypes))
         {
-            inputFile = new FileInputStream(localName);
-           /*ZipOutputStream zipout = new ZipOutputStream(new FileOutputStream("output.zip"));
-            zipout.putNextEntry(new ZipEntry("output.zip"));*/
-            GZIPOutputStream zipout  =  new GZIPOutputStream(new
-                                        FileOutputStream("output.gzip"));
-            if(fileSizeLength < 10000000)
-            {
-                fileData = new byte[fileSizeLength];               
-            }
-            else
+            ByteArrayOutputStream blockIndex = this.inflateBlocks ? new ByteArrayOutputStream() : null;
+            byte[] zipData = GZipBlocks(newFile.data, newFile.fileSizeLen, blockIndex);
+            int indexLen = (blockIndex != null) ? blockIndex.size() : 0;
+
+            // Only use zipped copy if it's smaller, with its block index
+            if (zipData.length + indexLen < newFile.fileSizeLen)
             {
-                fileData = new byte[100000];             
+                gzipRatio = (int)(100 - (100 * (long)(zipData.length + indexLen) / newFile.fileSizeLen));
+                newFile.data = zipData;
+                newFile.fileSizeLen = zipData.length;
+                newFile.isZipped = true;
             }
-            while((byteRead = inputFile.read(fileData)) != -1)
+            if (newFile.isZipped && blockIndex != null)
             {
-                if(byteRead == 0) break;
-                zipout.write(fileData,0,byteRead);
+                newFile.hasBlocks = true;
+
+                blkFile = new MPFSFileRecord();
+                blkFile.SetFileName("");
+                blkFile.SetFiledate(newFile.fileDate);
+                blkFile.isIndex = true;
+                blkFile.data = blockIndex.toByteArray();
+                blkFile.fileSizeLen = blockIndex.size();
             }
-            zipout.finish();
-//            byteRead = inputFile.read();
-//            while (byteRead != -1){
-//            zipout.write(byteRead);
-//            byteRead = inputFile.read();
-//            }
-            //zipout.closeEntry();
-            zipout.close();
-            File file_zip = new File("output.gzip");
-//            if(file_zip.isFile())
-//                System.out.println("original:"+file.length()+
-//                        "   zip file length" +file_zip.getName()+file_zip.length()) ;
-            FileInputStream inputZipFile = new FileInputStream("output.gzip");
-
-            // Only use zipped copy if it's smaller
-            if ((file_zip.length() < newFile.fileSizeLen) && (file_zip.length() > 0))
-            {
-                ByteArrayInputStream tempNewFileDataArray =
-                        new ByteArrayInputStream(newFile.data);
-                gzipRatio = (int)(100 - (100 * file_zip.length() / newFile.fileSizeLen));
-                if(file_zip.length() < 100000)
-                {
-                    fileData = new byte[(int)file_zip.length()];
-                }
-                else
-                {
-                    fileData = new byte[100000];
-                }
-                //newFile.data.clear();
-                tempNewFileDataArray.reset();
-                tempout = new ByteArrayOutputStream();
-                while((byteRead=inputZipFile.read(fileData))!= -1)
-                {
-                    if(byteRead == 0) break;
-                    tempout.write(fileData);
-                }
-                newFile.data = tempout.toByteArray();
-                newFile.fileSizeLen = tempout.size();
-                newFile.isZipped = true;
-            }
-            inputZipFile.close();
-            file_zip.delete();
-            inputFile.close();
         }
 
         // Add the file and return
@@ -326,6 +332,8 @@ public class MPFS2Lib //: MPFS2Writer
             log.add("    " + imageName + ": " + newFile.fileSizeLen + " bytes" +
                 ((gzipRatio > 0) ? " (gzipped by " + gzipRatio + "%)" : ""));
             files.add(newFile);
+            if (blkFile != null)
+                files.add(blkFile);
         }
         else
         {
@@ -341,6 +349,82 @@ public class MPFS2Lib //: MPFS2Writer
         return true;
     }
 
+    /// <summary>
+    /// Compresses data into a GZIP file.  With a block index, the data is
+    /// split into deflate blocks of GZIP_BLOCK_LEN bytes, each started
+    /// with a full flush.  Otherwise it is compressed as one stream.
+    /// </summary>
+    /// <param name="data">Data to compress</param>
+    /// <param name="len">Number of bytes of data</param>
+    /// <param name="blockIndex">Receives the block length and the offset
+    /// in the GZIP file of each block, as MPFS2.c describes, or null</param>
+    /// <returns>The GZIP file</returns>
+    private byte[] GZipBlocks(byte[] data, int len, ByteArrayOutputStream blockIndex)
+    {
+        ByteArrayOutputStream out = new ByteArrayOutputStream();
+        Deflater deflater = new Deflater(Deflater.BEST_COMPRESSION, true);
+        byte[] buf = new byte[GZIP_BLOCK_LEN + 1024];
+        CRC32 crc = new CRC32();
+        int blockLen = (blockIndex != null) ? GZIP_BLOCK_LEN : len;
+        int pos, n;
+
+        // Header: deflate, no flags or time, maximum compression, unknown OS
+        out.write(new byte[] {0x1f, (byte)0x8b, 0x08, 0, 0, 0, 0, 0, 0x02, (byte)0xff}, 0, 10);
+        if (blockIndex != null)
+            WriteLE(blockIndex, GZIP_BLOCK_LEN);
+
+        for (pos = 0; pos < len; pos += blockLen)
+        {
+            if (blockIndex != null)
+                WriteLE(blockIndex, out.size());
+            deflater.setInput(data, pos, Math.min(blockLen, len - pos));
+            if (pos + blockLen >= len)
+            {
+                deflater.finish();
+                while (!deflater.finished())
+                {
+                    n = deflater.deflate(buf, 0, buf.length);
+                    out.write(buf, 0, n);
+                }
+            }
+            else
+            {
+                do
+                {
+                    n = deflater.deflate(buf, 0, buf.length, Deflater.FULL_FLUSH);
+                    out.write(buf, 0, n);
+                } while (n == buf.length);
+            }
+        }
+        if (len == 0)
+        {
+            deflater.finish();
+            while (!deflater.finished())
+            {
+                n = deflater.deflate(buf, 0, buf.length);
+                out.write(buf, 0, n);
+            }
+        }
+        deflater.end();
+
+        // Trailer: CRC-32 and length of the data
+        crc.update(data, 0, len);
+        WriteLE(out, (int)crc.getValue());
+        WriteLE(out, len);
+        return out.toByteArray();
+    }
+
+    /// <summary>
+    /// Writes a little-endian DWORD
+    /// </summary>
+    private static void WriteLE(ByteArrayOutputStream out, int value)
+    {
+        out.write(value);
+        out.write(value >> 8);
+        out.write(value >> 16);
+        out.write(value >> 24);
+    }
+
     public boolean AddDirectory(String dataPath)
     {
        String imagePath="",tempImagePath="";
@@ -438,7 +522,7 @@ public class MPFS2Lib //: MPFS2Writer
         // Determine address of each file and string
         int numFiles = (int)files.size();
         int lenHeader = 8;
-        int lenHashes = 2 * numFiles;
+        int lenHashes = (sortedIndex ? 4 : 2) * numFiles;   // Hashes, and file IDs if sorted
         int lenFAT = 22 * numFiles;
         int baseAddr = lenHeader + lenHashes + lenFAT;
         int counter=0;
@@ -497,14 +581,44 @@ public class MPFS2Lib //: MPFS2Writer
         w = x;
         w.Write("MPFS");
         w.Write((byte)0x02);
-        w.Write((byte)0x01);
+        w.Write((byte)(sortedIndex ? 0x02 : 0x01));
         w.Write((short)(files.size()));
 
-        for(MPFSFileRecord file : files)
+        if (sortedIndex)
         {
-           //byte[0]
-           w.Write((byte)(file.nameHash));
-           w.Write((byte)(file.nameHash>>8));
+            // Write the path hashes in ascending order, then the file ID
+            // of each, so MPFSOpen can binary search them.  The FAT stays
+            // in file order, so index files follow their files.
+            final MPFSFileRecord[] fileArray = files.toArray(new MPFSFileRecord[0]);
+            List<Integer> sortedIDs = new ArrayList<Integer>();
+            for(int i = 0; i < fileArray.length; i++)
+                sortedIDs.add(i);
+            Collections.sort(sortedIDs, new Comparator<Integer>()
+            {
+                public int compare(Integer a, Integer b)
+                {
+                    int diff = fileArray[a].pathHash - fileArray[b].pathHash;
+                    return (diff != 0) ? diff : a - b;
+                }
+            });
+            for(int id : sortedIDs)
+            {
+               w.Write((byte)(fileArray[id].pathHash));
+               w.Write((byte)(fileArray[id].pathHash>>8));
+            }
+            for(int id : sortedIDs)
+            {
+               w.Write((byte)(id));
+               w.Write((byte)(id>>8));
+            }
+        }
+        else
+        {
+            for(MPFSFileRecord file : files)
+            {
+               w.Write((byte)(file.nameHash));
+               w.Write((byte)(file.nameHash>>8));
+            }
         }
 
         int flags;
@@ -519,8 +633,12 @@ public class MPFS2Lib //: MPFS2Writer
             flags = 0;
             if (file.hasIndex)
                 flags |= MPFS2_FLAG_HASINDEX;
+            if (file.hasIndex && this.varLengths)
+                flags |= MPFS2_FLAG_HASVARLEN;
             if (file.isZipped)
                 flags |= MPFS2_FLAG_ISZIPPED;
+            if (file.hasBlocks)
+                flags |= MPFS2_FLAG_HASBLOCKS;
             w.Write((short)(flags));
             timeVal=(long)621355968000000000L;
         }
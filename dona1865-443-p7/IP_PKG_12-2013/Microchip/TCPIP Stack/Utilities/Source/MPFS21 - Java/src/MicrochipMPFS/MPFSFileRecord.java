@@ -37,6 +37,7 @@ public class MPFSFileRecord
 {
     private String fileName;
     public int nameHash;
+    public int pathHash;    /*MPFS2.2 hash of the whole path*/
     public long fileDate;
     public byte[] data;
     //public Vector<Byte> data;
@@ -45,6 +46,7 @@ public class MPFSFileRecord
     public boolean hasIndex;
     public boolean isIndex;
     public boolean isZipped;
+    public boolean hasBlocks;   /*GZIP file is followed by an index of its deflate blocks*/
     public int dynVarCntr=0;/*Number of Dynamic Variables in the file*/
     public Vector<Byte> dynVarOffsetAndIndexID = new Vector<Byte>(8,8);/*Location of dynamic var and its ID*/
     public int fileRecordOffset;/* Byte location in the Record file where this file record/information is written from*/
@@ -60,6 +62,7 @@ public class MPFSFileRecord
         hasIndex = false;
         isIndex = false;
         isZipped = false;
+        hasBlocks = false;
         dynVarCntr=0;
         //data = new Vector<Byte>(0);
         //Calendar cl = Calendar.getInstance();
@@ -75,14 +78,19 @@ public class MPFSFileRecord
     {
         this.fileName = value;
         if(value.compareTo("")==0)
+        {
             this.nameHash = 0xffff;
+            this.pathHash = 0xffff;
+        }
         else
         {
             this.nameHash = 0;
+            this.pathHash = 0;
             for(byte b : value.getBytes())
             {
                 nameHash += b;
                 nameHash <<= 1;
+                pathHash = (pathHash*31 + (b & 0xff)) & 0xffff;
             }
         }
         //System.out.println ("Vlaue : " + value + "nameHash  "+String.format("%x",nameHash));
@@ -1823,7 +1823,10 @@ public class MainMPFS extends javax.swing.JFrame {
                     "    /mpfs2\t\t(/2)\t: MPFS2 format (Default)\n" +
                 //    "    /reserve #\t\t(/r #)\t: Reserved space for Classic BINs (Default 64)\n" +
                     "    /html \"...\"\t\t(/h)\t: Dynamic file types (\"*.htm, *.html, *.xml, *.cgi\")\n" +
-                    "    /xgzip \"...\"\t(/z)\t: Non-compressible types (\"snmp.bib, *.inc\")\n\n" +
+                    "    /xgzip \"...\"\t(/z)\t: Non-compressible types (\"snmp.bib, *.inc\")\n" +
+                    "    /inflate\t\t(/i)\t: Write GZIP files in blocks for HTTP_USE_INFLATE\n" +
+                    "    /varlen\t\t(/v)\t: Store variable lengths in indexes (needs current firmware)\n" +
+                    "    /sorted\t\t(/o)\t: MPFS2.2 image with a sorted index (needs current firmware)\n\n" +
                     "SourceDir, ProjectDir, and OutputFile are required and should be enclosed in quotes.\n" +
                     "OutputFile is placed relative to ProjectDir and *CANNOT* be a full path name.");
                 return;
@@ -1847,6 +1850,9 @@ public class MainMPFS extends javax.swing.JFrame {
             int reserveBlock = 64;
             String htmlTypes = "*.htm, *.html, *.xml, *.cgi";
             String noGZipTypes = "*.inc, snmp.bib";
+            boolean inflateBlocks = false;
+            boolean varLengths = false;
+            boolean sortedIndex = false;
 
             // Process each command line argument
             for(int i =0; i < (args.length - 3); i++)
@@ -1867,6 +1873,12 @@ public class MainMPFS extends javax.swing.JFrame {
   //                      version = 1;
                 else if(arg.compareTo("/mpfs2")==0 || arg.compareTo("/2")==0)
                         version = 2;
+                else if(arg.compareTo("/inflate")==0 || arg.compareTo("/i")==0)
+                        inflateBlocks = true;
+                else if(arg.compareTo("/varlen")==0 || arg.compareTo("/v")==0)
+                        varLengths = true;
+                else if(arg.compareTo("/sorted")==0 || arg.compareTo("/o")==0)
+                        sortedIndex = true;
 
                 // Check for string parameters
 //                else if(arg.contains("/reserve") || arg.contains("/r"))
@@ -1887,6 +1899,9 @@ public class MainMPFS extends javax.swing.JFrame {
                 builder.MPFS2Builder(projectDir,outputFile);
                 builder.DynamicTypes(htmlTypes);
                 builder.NonGZipTypes(noGZipTypes);
+                builder.InflateBlocks(inflateBlocks);
+                builder.VarLengths(varLengths);
+                builder.SortedIndex(sortedIndex);
                 // Add the files to the image and generate the image
                 builder.AddDirectory(sourceDir);
                 genResult = builder.Generate(fmt);
@@ -79,7 +79,9 @@ namespace MPFS21
                         "    /mpfs2\t\t(/2)\t: MPFS2 format (Default)\n" +
                         "    /reserve #\t(/r #)\t: Reserved space for Classic BINs (Default 64)\n" +
                         "    /html \"...\"\t(/h)\t: Dynamic file types (\"*.htm, *.html, *.xml, *.cgi\")\n" +
-                        "    /xgzip \"...\"\t(/z)\t: Non-compressible types (\"snmp.bib, *.inc\")\n\n" +
+                        "    /xgzip \"...\"\t(/z)\t: Non-compressible types (\"snmp.bib, *.inc\")\n" +
+                        "    /varlen\t\t(/v)\t: Store variable lengths in indexes (needs current firmware)\n" +
+                        "    /sorted\t\t(/o)\t: MPFS2.2 image with a sorted index (needs current firmware)\n\n" +
                         "SourceDir, ProjectDir, and OutputFile are required and should be enclosed in quotes.\n" +
                         "OutputFile is placed relative to ProjectDir and *CANNOT* be a full path name.",
                         "MPFS2 Console Error", MessageBoxButtons.OK, MessageBoxIcon.Stop);
@@ -97,6 +99,8 @@ namespace MPFS21
                 int reserveBlock = 64;
                 String htmlTypes = "*.htm, *.html, *.xml, *.cgi";
                 String noGZipTypes = "*.inc, snmp.bib";
+                bool varLengths = false;
+                bool sortedIndex = false;
 
                 // Process each command line argument
                 for(int i =0; i < args.Length - 3; i++)
@@ -116,6 +120,10 @@ namespace MPFS21
 				        version = 1;
 			        else if(arg == "/mpfs2" || arg == "/2")
 				        version = 2;
+			        else if(arg == "/varlen" || arg == "/v")
+				        varLengths = true;
+			        else if(arg == "/sorted" || arg == "/o")
+				        sortedIndex = true;
 
                     // Check for string parameters
 			        else if(arg == "/reserve" || arg == "/r")
@@ -142,6 +150,8 @@ namespace MPFS21
                     builder = new MPFS2Builder(projectDir, outputFile);
                     ((MPFS2Builder)builder).DynamicTypes = htmlTypes;
                     ((MPFS2Builder)builder).NonGZipTypes = noGZipTypes;
+                    ((MPFS2Builder)builder).VarLengths = varLengths;
+                    ((MPFS2Builder)builder).SortedIndex = sortedIndex;
                 }
                 else
                 {
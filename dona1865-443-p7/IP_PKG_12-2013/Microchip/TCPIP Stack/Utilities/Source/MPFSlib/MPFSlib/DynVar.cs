@@ -58,6 +58,7 @@ namespace Microchip
         private Regex parser = new Regex(@"~(inc:[A-Za-z0-9\ \.-_\\/]{1,60}|[A-Za-z0-9_]{0,40}(\([A-Za-z0-9_,\ ]*\))?)~");
         private ASCIIEncoding ascii = new ASCIIEncoding();
         private String projectDir;
+        private bool varLengths = false;
         #endregion
 
         #region String Constants
@@ -130,6 +131,17 @@ namespace Microchip
         }
         #endregion
 
+        #region Properties
+        /// <summary>
+        /// Sets whether index records hold the length of each variable
+        /// (MPFS2_FLAG_HASVARLEN), which earlier firmware cannot read
+        /// </summary>
+        public bool VarLengths
+        {
+            set { this.varLengths = value; }
+        }
+        #endregion
+
         /// <summary>
         /// Parses and indexes a file for dynamic variables
         /// </summary>
@@ -145,11 +157,22 @@ namespace Microchip
             foreach(Match m in matches)
             {
                 int i = GetIndex(m.Value.Replace(" ","").Replace("~",""));
-				Array.Resize(ref idxData, idxData.Length + 8);                
-                idxData[idxData.Length - 8] = (byte)m.Index;
-                idxData[idxData.Length - 7] = (byte)(m.Index >> 8);
-                idxData[idxData.Length - 6] = (byte)(m.Index >> 16);
-                idxData[idxData.Length - 5] = (byte)(m.Index >> 24);
+
+                // Offset, length if enabled, and callback ID, so that the
+                // server can seek past the variable (MPFS2_FLAG_HASVARLEN)
+                int recLen = varLengths ? 12 : 8;
+				Array.Resize(ref idxData, idxData.Length + recLen);                
+                idxData[idxData.Length - recLen] = (byte)m.Index;
+                idxData[idxData.Length - recLen + 1] = (byte)(m.Index >> 8);
+                idxData[idxData.Length - recLen + 2] = (byte)(m.Index >> 16);
+                idxData[idxData.Length - recLen + 3] = (byte)(m.Index >> 24);
+                if (varLengths)
+                {
+                    idxData[idxData.Length - 8] = (byte)m.Length;
+                    idxData[idxData.Length - 7] = (byte)(m.Length >> 8);
+                    idxData[idxData.Length - 6] = (byte)(m.Length >> 16);
+                    idxData[idxData.Length - 5] = (byte)(m.Length >> 24);
+                }
                 idxData[idxData.Length - 4] = (byte)i;
                 idxData[idxData.Length - 3] = (byte)(i >> 8);
                 idxData[idxData.Length - 2] = (byte)(i >> 16);
@@ -576,11 +576,14 @@ namespace Microchip
         private Collection<String> dynamicTypes;
         private Collection<String> nonGZipTypes;
         private DynamicVariableParser dynVarParser;
+        private bool varLengths;
+        private bool sortedIndex;
         #endregion
 
         #region Constants
         private const UInt16 MPFS2_FLAG_ISZIPPED = 0x0001;
         private const UInt16 MPFS2_FLAG_HASINDEX = 0x0002;
+        private const UInt16 MPFS2_FLAG_HASVARLEN = 0x0004;
         #endregion
 
         #region Constructor
@@ -600,6 +603,8 @@ namespace Microchip
             this.log = new List<string>();
             this.files = new List<MPFSFileRecord>();
             this.dynVarParser = new DynamicVariableParser(localPath);
+            this.varLengths = false;
+            this.sortedIndex = false;
             this.indexUpdated = false;
         }
         #endregion
@@ -640,6 +645,30 @@ namespace Microchip
                 }
             }
         }
+
+        /// <summary>
+        /// Sets whether dynamic variable indexes hold the length of each
+        /// variable (MPFS2_FLAG_HASVARLEN).  Firmware built before this
+        /// flag reads such indexes wrongly, so it is off by default.
+        /// </summary>
+        public bool VarLengths
+        {
+            set
+            {
+                this.varLengths = value;
+                dynVarParser.VarLengths = value;
+            }
+        }
+
+        /// <summary>
+        /// Sets whether a version 2.2 image with a sorted hash index is
+        /// written.  Firmware built before 2.2 rejects such images, so
+        /// version 2.1 is the default.
+        /// </summary>
+        public bool SortedIndex
+        {
+            set { this.sortedIndex = value; }
+        }
         #endregion
 
         #region Public Methods
@@ -791,7 +820,7 @@ namespace Microchip
             // Determine address of each file and string
             UInt32 numFiles = (UInt32)files.Count;
             UInt32 lenHeader = 8;
-            UInt32 lenHashes = 2 * numFiles;
+            UInt32 lenHashes = (sortedIndex ? 4u : 2u) * numFiles;    // Hashes, and file IDs if sorted
             UInt32 lenFAT = 22 * numFiles;
             UInt32 baseAddr = lenHeader + lenHashes + lenFAT;
 			UInt32 counter=0;
@@ -850,11 +879,32 @@ namespace Microchip
 				// Write the image
             w.Write("MPFS");
             w.Write((byte)0x02);
-            w.Write((byte)0x01);
+            w.Write((byte)(sortedIndex ? 0x02 : 0x01));
             w.Write((UInt16)files.Count);
 
-			foreach (MPFSFileRecord file in files)
-                w.Write((UInt16)file.nameHash);
+            if (sortedIndex)
+            {
+                // Write the path hashes in ascending order, then the file ID
+                // of each, so MPFSOpen can binary search them.  The FAT stays
+                // in file order, so index files follow their files.
+                List<int> sortedIDs = new List<int>();
+                for (int i = 0; i < files.Count; i++)
+                    sortedIDs.Add(i);
+                sortedIDs.Sort(delegate(int a, int b)
+                {
+                    int diff = files[a].pathHash.CompareTo(files[b].pathHash);
+                    return (diff != 0) ? diff : a.CompareTo(b);
+                });
+                foreach (int id in sortedIDs)
+                    w.Write((UInt16)files[id].pathHash);
+                foreach (int id in sortedIDs)
+                    w.Write((UInt16)id);
+            }
+            else
+            {
+                foreach (MPFSFileRecord file in files)
+                    w.Write((UInt16)file.nameHash);
+            }
 
 			UInt16 flags;
 			foreach (MPFSFileRecord file in files)
@@ -867,6 +917,8 @@ namespace Microchip
                 flags = 0;
                 if (file.hasIndex)
                     flags |= MPFS2_FLAG_HASINDEX;
+                if (file.hasIndex && varLengths)
+                    flags |= MPFS2_FLAG_HASVARLEN;
                 if (file.isZipped)
                     flags |= MPFS2_FLAG_ISZIPPED;
                 w.Write(flags);
@@ -1340,6 +1392,7 @@ namespace Microchip
         #region Fields
         private String fileName;
         public UInt16 nameHash;
+        public UInt16 pathHash;     /*MPFS2.2 hash of the whole path*/
 	    public DateTime fileDate;
         public byte[] data;
         public UInt32 locStr;
@@ -1375,14 +1428,19 @@ namespace Microchip
             {
                 this.fileName = value;
                 if(value == "")
+                {
                     this.nameHash = 0xffff;
+                    this.pathHash = 0xffff;
+                }
                 else
                 {
                     this.nameHash = 0;
+                    this.pathHash = 0;
                     foreach (byte b in value)
                     {
                         nameHash += b;
                         nameHash <<= 1;
+                        pathHash = (UInt16)(pathHash * 31 + b);
                     }
                 }
             }
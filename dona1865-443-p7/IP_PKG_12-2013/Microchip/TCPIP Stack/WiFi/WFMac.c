@@ -1735,12 +1735,10 @@ WORD CalcIPBufferChecksum(WORD len)
 {
     DWORD_VAL Checksum;
     
-    BYTE DataBuffer[20]; // Must be an even size
+    BYTE DataBuffer[32]; // Must be an even size
     WORD ChunkLen;
-    WORD *DataPtr;
 
-    Checksum.w[0] = 0;  
-    Checksum.w[1] = 0;
+    Checksum.Val = 0;
     while(len)
     {
         // Obtain a chunk of data (less SPI overhead compared 
@@ -1749,20 +1747,9 @@ WORD CalcIPBufferChecksum(WORD len)
         MACGetArray(DataBuffer, ChunkLen);
         len -= ChunkLen;
 
-        // Take care of a last odd numbered data byte
-        if(((WORD_VAL*)&ChunkLen)->bits.b0)
-        {
-            DataBuffer[ChunkLen] = 0x00;
-            ChunkLen++;
-        }
-
-        // Calculate the checksum over this chunk
-        DataPtr = (WORD*)&DataBuffer[0];
-        while(ChunkLen)
-        {
-            Checksum.Val += *DataPtr++;
-            ChunkLen -= 2;
-        }
+        // Add the sum of this chunk.  Only the last chunk can have an 
+        // odd size, so the chunk sums add up to the sum of the data.
+        Checksum.Val += (WORD)~CalcIPChecksum(DataBuffer, ChunkLen);
     }
 
     // Do an end-around carry (one's complement arrithmatic)
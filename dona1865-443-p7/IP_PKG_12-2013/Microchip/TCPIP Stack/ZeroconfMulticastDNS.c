@@ -2151,7 +2151,7 @@ MDNS_STATIC void mDNSResponder(void)
             mDNSRemote.MACAddr.v[5]=0xFB;
 
 			INFO_MDNS_PRINT("mDNSResponder: MDNS_RESPONDER_INIT: Opening mDNS socket \r\n");
-			mDNS_socket = UDPOpenEx((DWORD)(PTR_BASE)&mDNSRemote,UDP_OPEN_NODE_INFO,MDNS_PORT,MDNS_PORT);
+			mDNS_socket = UDPOpenEx((DWORD_PTR_BASE)(PTR_BASE)&mDNSRemote,UDP_OPEN_NODE_INFO,MDNS_PORT,MDNS_PORT);
 
 			if(mDNS_socket == INVALID_UDP_SOCKET)
             {
@@ -0,0 +1,124 @@
+/*********************************************************************
+ *
+ *  ARP resolution benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        ARPBench.c
+ * Dependencies:    TCPIP.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Opens HOST_BENCH_SOCKETS TCP client sockets at once, each to its own
+ * peer on the TAP subnet, and reports how many ARP frames the stack sent
+ * and how long each connection took to be established.
+ *
+ * The peers are addresses of the Linux side of the TAP, starting at
+ * 192.168.1.101, with a TCP listener on ARP_BENCH_PORT, for example
+ * for 50 peers:
+ *   for i in $(seq 101 150); do ip addr add 192.168.1.$i/24 dev tap0; done
+ *   python3 -c 'import socket, time; s = socket.socket(); \
+ *     s.bind(("", 9000)); s.listen(256); time.sleep(3600)' &
+ * The kernel completes the connections; they need not be accepted.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_BENCH_SOCKETS=50 -I. -I$S/Include -o arpbench \
+ *       ARPBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers}.c \
+ *       "$S/TCPIP Stack/"{ARP,IP,ICMP,UDP,TCP}.c \
+ *       "$S/TCPIP Stack/"{TCPPerformanceTest,UDPPerformanceTest}.c
+ *   HOST_MAC_TAP=tap0 ./arpbench
+ * ARP_CACHE_ENTRIES can be set with -D to compare cache sizes.
+ ********************************************************************/
+#define THIS_IS_STACK_APPLICATION
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+
+#if !defined(HOST_BENCH_SOCKETS)
+	#define HOST_BENCH_SOCKETS	(50u)
+#endif
+
+#define ARP_BENCH_PORT		(9000u)					// Listener port of the peers
+#define ARP_BENCH_FIRST		(101u)					// Last byte of the first peer address
+#define ARP_BENCH_TIMEOUT	((DWORD)TICK_SECOND*30)	// Give up on connections after this time
+
+// Declare AppConfig structure and some other supporting stack variables
+APP_CONFIG AppConfig;
+
+// ARP frames sent, counted by ETHHost.c
+extern int _stackMgrTxArpPkts;
+
+static TCP_SOCKET hSockets[HOST_BENCH_SOCKETS];
+static DWORD dwConnectTime[HOST_BENCH_SOCKETS];	// Ticks from TCPOpen() to connected, 0 while connecting
+
+int main(void)
+{
+	DWORD dwStart, dwElapsed, dwSum, dwMax;
+	WORD i, wConnected;
+	IP_ADDR Peer;
+
+	TickInit();
+	InitAppConfig();
+	StackInit();
+
+	// Let the link come up
+	while(!MACIsLinked())
+		StackTask();
+
+	Peer.Val = AppConfig.MyIPAddr.Val;
+	dwStart = TickGet();
+	for(i = 0; i < HOST_BENCH_SOCKETS; i++)
+	{
+		Peer.v[3] = ARP_BENCH_FIRST + i;
+		hSockets[i] = TCPOpen(Peer.Val, TCP_OPEN_IP_ADDRESS, ARP_BENCH_PORT, TCP_PURPOSE_DEFAULT);
+		if(hSockets[i] == INVALID_SOCKET)
+		{
+			printf("TCPOpen() failed at socket %u\n", i);
+			return 1;
+		}
+	}
+
+	// Run the stack until every socket is connected
+	wConnected = 0;
+	while(wConnected < HOST_BENCH_SOCKETS && TickGet() - dwStart < ARP_BENCH_TIMEOUT)
+	{
+		StackTask();
+		for(i = 0; i < HOST_BENCH_SOCKETS; i++)
+		{
+			if(dwConnectTime[i] == 0u && TCPIsConnected(hSockets[i]))
+			{
+				dwConnectTime[i] = TickGet() - dwStart;
+				if(dwConnectTime[i] == 0u)
+					dwConnectTime[i] = 1;
+				wConnected++;
+			}
+		}
+	}
+	dwElapsed = TickGet() - dwStart;
+
+	dwSum = 0;
+	dwMax = 0;
+	for(i = 0; i < HOST_BENCH_SOCKETS; i++)
+	{
+		dwSum += dwConnectTime[i];
+		if(dwConnectTime[i] > dwMax)
+			dwMax = dwConnectTime[i];
+		TCPDisconnect(hSockets[i]);
+	}
+	StackTask();
+
+	printf("%u peers: %u connected in %lu ms, %d ARP frames sent (%.1f/s)\n",
+		(unsigned)HOST_BENCH_SOCKETS, wConnected,
+		(unsigned long)TickConvertToMilliseconds(dwElapsed),
+		_stackMgrTxArpPkts, _stackMgrTxArpPkts * (double)TICK_SECOND / (dwElapsed ? dwElapsed : 1));
+	if(wConnected)
+	{
+		printf("connection setup: mean %lu ms, max %lu ms\n",
+			(unsigned long)TickConvertToMilliseconds(dwSum / wConnected),
+			(unsigned long)TickConvertToMilliseconds(dwMax));
+	}
+	return wConnected == HOST_BENCH_SOCKETS ? 0 : 1;
+}
@@ -0,0 +1,652 @@
+/*********************************************************************
+ *
+ *  MPFS2 read cache benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        CacheBench.c
+ * Dependencies:    TCP.c, HTTP2.c, MPFS2.c, SPIFlashHost.c, HTTPPrint.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the SPI Flash traffic of the HTTP2 server for an image laid
+ * out like the demo web pages, with and without the MPFS2 read cache
+ * (MPFS_CACHE_PAGES in MPFS2.h).  The workloads are
+ *   page load   index.htm, style.css, mchp.js, mchp.gif and status.xml,
+ *               as a browser fetches them on first load.  index.htm
+ *               and status.xml have dynamic variables.
+ *   status      status.xml alone, as the demo pages poll it.
+ *   not found   a name that is not in the image.
+ * For each it reports the SPI Flash reads and bus bytes per request,
+ * counted by SPIFlashHost.c, the bus time they take, the hit rate of
+ * the cache and the CPU time per request.  A read costs a command and
+ * a 3 byte address on the bus besides its data, which are clocked at
+ * BENCH_SPI_MHZ, and BENCH_READ_US for the driver call and the chip
+ * select.
+ *
+ * The MPFS2.2 image is built at startup and written to a temporary file
+ * that SPIFlashHost.c reads.  Requests are served as in HTTPBench.c,
+ * with "Connection: close", and the response bodies are compared with
+ * the files in a first pass.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_CACHE_BENCH -I. -I$S -I$S/Include -o cachebench \
+ *       CacheBench.c HostAppConfig.c "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP,SPIFlashHost,MPFS2,Inflate,HTTP2}.c \
+ *       && ./cachebench
+ * Add -DMPFS_CACHE_PAGES=0 for the figures without the cache, or set
+ * MPFS_CACHE_PAGES and MPFS_CACHE_PAGE_SIZE to compare cache sizes.
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_LOCAL_PORT	(80u)
+#define BENCH_REMOTE_PORT	(40000u)
+#define BENCH_FAT_RECORD	(22u)					// Size of an MPFS2 FAT record
+#define BENCH_FILES			(32u)					// Files in the image, including the indexes
+#define BENCH_MAX_FILE		(8192u)					// Largest file or response body
+#define BENCH_LOADS			(2000ul)				// Times each workload is served
+#define BENCH_SPI_MHZ		(20.0)					// SPI clock for the bus time
+#define BENCH_READ_US		(2.0)					// Fixed cost of a read for the bus time
+
+// Dynamic variables, in the order of their callback IDs in HTTPPrint.h,
+// and the text HTTPPrint() writes for them
+static const char* sVarNames[] = {"~version~", "~builddate~", "~uptime~", "~led(0)~", "~led(1)~"};
+static const char* sVarValues[] = {"5.42", "Oct 18 2026 12:00:00", "1234567", "0", "1"};
+#define BENCH_VARS			(sizeof(sVarNames)/sizeof(sVarNames[0]))
+
+// Files of the image, before the fillers.  A dynamic file is followed
+// by its index.
+static const struct
+{
+	const char* sName;
+	WORD wLen;				// Approximate length
+	WORD wVars;				// Number of dynamic variables
+} Pages[] =
+{
+	{"index.htm", 4096, 24},
+	{"status.xml", 640, 16},
+	{"style.css", 6144, 0},
+	{"mchp.js", 8000, 0},
+	{"mchp.gif", 2900, 0},
+};
+#define BENCH_PAGES			(sizeof(Pages)/sizeof(Pages[0]))
+
+// Workloads: names requested, ending with NULL
+static const char* sPageLoad[] = {"index.htm", "style.css", "mchp.js", "mchp.gif", "status.xml", NULL};
+static const char* sStatus[] = {"status.xml", NULL};
+static const char* sNotFound[] = {"missing.htm", NULL};
+static const struct
+{
+	const char* sName;
+	const char** sFiles;
+} Workloads[] = {{"page load", sPageLoad}, {"status", sStatus}, {"not found", sNotFound}};
+#define BENCH_WORKLOADS		(sizeof(Workloads)/sizeof(Workloads[0]))
+
+// Files and expected response bodies.  Expected bodies of missing files
+// are empty.
+static struct
+{
+	char sName[16];
+	BYTE vData[BENCH_MAX_FILE];
+	DWORD dwLen;
+	WORD wFlags;
+	BYTE vExpected[BENCH_MAX_FILE];
+	DWORD dwExpectedLen;
+} Files[BENCH_FILES];
+
+// The image written to the SPI Flash file
+static BYTE vImage[128ul*1024ul];
+static DWORD dwImageLen;
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// Private helper functions.
+static void BuildFiles(void);
+static void BuildImage(void);
+static WORD HashName(const char* sName);
+static int CompareIDs(const void* a, const void* b);
+static BYTE FindFile(const char* sName);
+static DWORD ServeRequest(const char* sFile, BYTE* pResponse);
+static TCP_SOCKET ConnectSocket(void);
+static DWORD SendAll(TCP_SOCKET hSocket, BYTE* pResponse);
+static BOOL CheckResponse(const char* sFile, BYTE* pResponse, DWORD dwLen);
+
+int main(void)
+{
+	static BYTE vResponse[BENCH_MAX_FILE + 512];
+	char sFlash[] = "/tmp/cachebenchXXXXXX";
+	const char** p;
+	DWORD j, dwRequests, dwLen, dwBus;
+	double dCPU;
+	BYTE i;
+	int fd;
+	#if defined(MPFS_USE_CACHE)
+	MPFS_CACHE_STATS stats;
+	#endif
+
+	BuildFiles();
+	BuildImage();
+
+	// Put the image in the SPI Flash at MPFS_RESERVE_BLOCK
+	fd = mkstemp(sFlash);
+	if(fd < 0 || pwrite(fd, vImage, dwImageLen, MPFS_RESERVE_BLOCK) != (ssize_t)dwImageLen)
+	{
+		printf("cannot create %s\n", sFlash);
+		return 1;
+	}
+	close(fd);
+	setenv("HOST_SPIFLASH_FILE", sFlash, 1);
+
+	// Replay an empty capture: the link is up and nothing is received
+	if(!InitHostReplay())
+		return 1;
+
+	MPFSInit();
+	TCPInit();
+	HTTPInit();
+	unlink(sFlash);
+
+	for(i = 0; i < BENCH_WORKLOADS; i++)
+	{
+		for(p = Workloads[i].sFiles; *p; p++)
+		{
+			dwLen = ServeRequest(*p, vResponse);
+			if(!CheckResponse(*p, vResponse, dwLen))
+			{
+				printf("wrong response for %s\n", *p);
+				return 1;
+			}
+		}
+	}
+	printf("Response bodies match the files\n");
+
+	#if defined(MPFS_USE_CACHE)
+	printf("%u byte image, cache of %u pages of %u bytes\n", (unsigned)dwImageLen, MPFS_CACHE_PAGES, MPFS_CACHE_PAGE_SIZE);
+	#else
+	printf("%u byte image, no cache\n", (unsigned)dwImageLen);
+	#endif
+
+	for(i = 0; i < BENCH_WORKLOADS; i++)
+	{
+		memset((void*)&SPIFlashHostStats, 0x00, sizeof(SPIFlashHostStats));
+		#if defined(MPFS_USE_CACHE)
+		MPFSClearCacheStats();
+		#endif
+
+		dwRequests = 0;
+		dCPU = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+		for(j = 0; j < BENCH_LOADS; j++)
+		{
+			for(p = Workloads[i].sFiles; *p; p++, dwRequests++)
+				ServeRequest(*p, NULL);
+		}
+		dCPU = (NowNs(CLOCK_PROCESS_CPUTIME_ID) - dCPU) / dwRequests / 1000.0;
+
+		dwBus = SPIFlashHostStats.dwReadBytes + 4ul*SPIFlashHostStats.dwReads;
+		printf("%-9s %5.1f reads/request %7.1f bus bytes/request %7.1f us bus time/request",
+			Workloads[i].sName, (double)SPIFlashHostStats.dwReads / dwRequests, (double)dwBus / dwRequests,
+			((double)dwBus * 8.0 / BENCH_SPI_MHZ + SPIFlashHostStats.dwReads * BENCH_READ_US) / dwRequests);
+		#if defined(MPFS_USE_CACHE)
+		MPFSGetCacheStats(&stats);
+		printf("   hits %5.1f%%, %4.1f bypasses/request",
+			stats.dwHits + stats.dwMisses ? 100.0 * stats.dwHits / (stats.dwHits + stats.dwMisses) : 0.0,
+			(double)stats.dwBypasses / dwRequests);
+		#endif
+		printf("   %6.2f us CPU/request\n", dCPU);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static void BuildFiles(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills Files[].
+ *
+ * Overview:        Makes the files of Pages[], each dynamic one followed
+ *                  by its index, then fills the image up to BENCH_FILES
+ *                  files with 1500 byte pages "page<n>.htm".
+ *
+ * Note:            Text runs between variables have a random length of
+ *                  0 to twice the average that gives the file its
+ *                  approximate length.  mchp.gif is random bytes.
+ ********************************************************************/
+static void BuildFiles(void)
+{
+	static const char sText[] = "<div class=\"row\"><span class=\"label\">Board status</span><span id=\"led\">";
+	DWORD dwLen, dwExp, dwVarLen, dwID, dwIndex;
+	WORD v, wGap, wAvgGap, j;
+	BYTE i, k, n;
+
+	for(i = 0, n = 0; i < BENCH_PAGES; i++, n++)
+	{
+		strcpy(Files[n].sName, Pages[i].sName);
+		if(strstr(Pages[i].sName, ".gif"))
+		{
+			for(dwLen = 0; dwLen < Pages[i].wLen; dwLen++)
+				Files[n].vData[dwLen] = Files[n].vExpected[dwLen] = (BYTE)LFSRRand();
+			Files[n].dwLen = Files[n].dwExpectedLen = dwLen;
+			continue;
+		}
+
+		wAvgGap = Pages[i].wLen / (Pages[i].wVars + 1u);
+		dwLen = 0;
+		dwExp = 0;
+		dwIndex = 0;
+		for(v = 0; v <= Pages[i].wVars; v++)
+		{
+			// Text, then a variable
+			wGap = Pages[i].wVars ? LFSRRand() % (2u*wAvgGap + 1u) : Pages[i].wLen;
+			for(j = 0; j < wGap; j++, dwLen++)
+				Files[n].vData[dwLen] = Files[n].vExpected[dwExp++] = sText[dwLen % (sizeof(sText) - 1)];
+			if(v == Pages[i].wVars)
+				break;
+
+			// The index record: offset, length and callback ID
+			k = LFSRRand() % BENCH_VARS;
+			dwVarLen = strlen(sVarNames[k]);
+			dwID = k;
+			memcpy((void*)&Files[n+1].vData[dwIndex + 0], (void*)&dwLen, 4);
+			memcpy((void*)&Files[n+1].vData[dwIndex + 4], (void*)&dwVarLen, 4);
+			memcpy((void*)&Files[n+1].vData[dwIndex + 8], (void*)&dwID, 4);
+			dwIndex += 12;
+
+			memcpy((void*)&Files[n].vData[dwLen], (void*)sVarNames[k], dwVarLen);
+			dwLen += dwVarLen;
+			memcpy((void*)&Files[n].vExpected[dwExp], (void*)sVarValues[k], strlen(sVarValues[k]));
+			dwExp += strlen(sVarValues[k]);
+		}
+		Files[n].dwLen = dwLen;
+		Files[n].dwExpectedLen = dwExp;
+
+		if(Pages[i].wVars)
+		{
+			Files[n].wFlags = MPFS2_FLAG_HASINDEX | MPFS2_FLAG_HASVARLEN;
+			Files[++n].dwLen = dwIndex;
+		}
+	}
+
+	for(i = 0; n < BENCH_FILES; i++, n++)
+	{
+		sprintf(Files[n].sName, "page%u.htm", i);
+		for(dwLen = 0; dwLen < 1500u; dwLen++)
+			Files[n].vData[dwLen] = Files[n].vExpected[dwLen] = sText[dwLen % (sizeof(sText) - 1)];
+		Files[n].dwLen = Files[n].dwExpectedLen = dwLen;
+	}
+}
+
+/*********************************************************************
+ * Function:        static void BuildImage(void)
+ *
+ * PreCondition:    BuildFiles() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills vImage[] and dwImageLen.
+ *
+ * Overview:        Writes an MPFS2.2 image of Files[].
+ *
+ * Note:            The layout is described at the top of MPFS2.c.
+ *                  Timestamps are 0.
+ ********************************************************************/
+static WORD wSortHashes[BENCH_FILES];
+
+static void BuildImage(void)
+{
+	WORD wIDs[BENCH_FILES];
+	BYTE* pHashes;
+	BYTE* pFAT;
+	DWORD dwString, dwData, dw;
+	BYTE i;
+
+	memcpy((void*)vImage, (void*)"MPFS\x02\x02", 6);
+	vImage[6] = BENCH_FILES;
+	vImage[7] = 0;
+	pHashes = &vImage[8];
+	pFAT = pHashes + 4ul*BENCH_FILES;
+	dwString = (DWORD)(pFAT - vImage) + BENCH_FILES*BENCH_FAT_RECORD;
+	dwData = dwString;
+	for(i = 0; i < BENCH_FILES; i++)
+		dwData += strlen(Files[i].sName) + 1;
+
+	for(i = 0; i < BENCH_FILES; i++)
+	{
+		wSortHashes[i] = Files[i].sName[0] ? HashName(Files[i].sName) : 0xFFFFu;
+		wIDs[i] = i;
+
+		strcpy((char*)&vImage[dwString], Files[i].sName);
+		memcpy((void*)&vImage[dwData], (void*)Files[i].vData, Files[i].dwLen);
+
+		memset((void*)&pFAT[i*BENCH_FAT_RECORD], 0x00, BENCH_FAT_RECORD);
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 0], (void*)&dwString, 4);
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 4], (void*)&dwData, 4);
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 8], (void*)&Files[i].dwLen, 4);
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 20], (void*)&Files[i].wFlags, 2);
+
+		dwString += strlen(Files[i].sName) + 1;
+		dwData += Files[i].dwLen;
+	}
+	dwImageLen = dwData;
+
+	// The hashes in ascending order, then their file IDs
+	qsort(wIDs, BENCH_FILES, sizeof(WORD), CompareIDs);
+	for(i = 0; i < BENCH_FILES; i++)
+	{
+		memcpy((void*)&pHashes[2ul*i], (void*)&wSortHashes[wIDs[i]], 2);
+		dw = wIDs[i];
+		memcpy((void*)&pHashes[2ul*BENCH_FILES + 2ul*i], (void*)&dw, 2);
+	}
+}
+
+/*********************************************************************
+ * Function:        static WORD HashName(const char* sName)
+ *
+ * PreCondition:    None
+ *
+ * Input:           sName - file name
+ *
+ * Output:          The MPFS2.2 name hash
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Computes the hash MPFSOpen() looks up.
+ *
+ * Note:            None
+ ********************************************************************/
+static WORD HashName(const char* sName)
+{
+	WORD wHash;
+
+	for(wHash = 0; *sName; sName++)
+		wHash = (wHash << 5) - wHash + (BYTE)*sName;
+	return wHash;
+}
+
+// qsort() comparison of two file IDs by hash, then ID
+static int CompareIDs(const void* a, const void* b)
+{
+	WORD wA = *(const WORD*)a, wB = *(const WORD*)b;
+
+	if(wSortHashes[wA] != wSortHashes[wB])
+		return wSortHashes[wA] < wSortHashes[wB] ? -1 : 1;
+	return (int)wA - (int)wB;
+}
+
+/*********************************************************************
+ * Function:        static BYTE FindFile(const char* sName)
+ *
+ * PreCondition:    BuildFiles() has been called.
+ *
+ * Input:           sName - file name
+ *
+ * Output:          Index of the file in Files[], or BENCH_FILES
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Looks the name up in Files[].
+ *
+ * Note:            None
+ ********************************************************************/
+static BYTE FindFile(const char* sName)
+{
+	BYTE i;
+
+	for(i = 0; i < BENCH_FILES; i++)
+	{
+		if(strcmp(Files[i].sName, sName) == 0)
+			break;
+	}
+	return i;
+}
+
+/*********************************************************************
+ * Function:        static DWORD ServeRequest(const char* sFile,
+ *                                            BYTE* pResponse)
+ *
+ * PreCondition:    HTTPInit() has been called.
+ *
+ * Input:           sFile - name of the file to request
+ *                  pResponse - where to copy the response, or NULL
+ *
+ * Output:          Length of the response
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Connects an HTTP socket, writes a GET request for
+ *                  sFile with "Connection: close" into its RX FIFO and
+ *                  calls HTTPServer() until the socket is disconnected,
+ *                  sending the TX FIFO after each call.
+ *
+ * Note:            As in HTTPBench.c.
+ ********************************************************************/
+static DWORD ServeRequest(const char* sFile, BYTE* pResponse)
+{
+	char sRequest[96];
+	TCP_SOCKET hTCP;
+	PTR_BASE ptr;
+	const char* p;
+	DWORD dwLen;
+
+	sprintf(sRequest, "GET /%s HTTP/1.1\r\nHost: 192.168.1.2\r\nConnection: close\r\n\r\n", sFile);
+	hTCP = ConnectSocket();
+	for(ptr = MyTCBStub.rxHead, p = sRequest; *p; p++)
+	{
+		*(BYTE*)ptr = *p;
+		if(++ptr > MyTCBStub.bufferEnd)
+			ptr = MyTCBStub.bufferRxStart;
+	}
+	MyTCBStub.rxHead = ptr;
+
+	dwLen = 0;
+	do
+	{
+		HTTPServer();
+		dwLen += SendAll(hTCP, pResponse ? pResponse + dwLen : NULL);
+	} while(MyTCBStub.smState == TCP_ESTABLISHED);
+
+	// Listen again, and let HTTPServer() see the reset and give the
+	// socket its RX FIFO back
+	CloseSocket();
+	HTTPServer();
+	return dwLen;
+}
+
+/*********************************************************************
+ * Function:        static TCP_SOCKET ConnectSocket(void)
+ *
+ * PreCondition:    HTTPInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          The connected socket
+ *
+ * Side Effects:    Exits if no HTTP socket is listening.
+ *
+ * Overview:        Connects a listening HTTP socket by passing a SYN to
+ *                  FindMatchingSocket().
+ *
+ * Note:            As in TxBench.c.
+ ********************************************************************/
+static TCP_SOCKET ConnectSocket(void)
+{
+	TCP_HEADER header;
+	NODE_INFO remote;
+
+	remote.IPAddr.Val = 0x0101A8C0ul;			// 192.168.1.1
+	memset((void*)&remote.MACAddr, 0x02, sizeof(MAC_ADDR));
+	memset((void*)&header, 0x00, sizeof(header));
+	header.SourcePort = BENCH_REMOTE_PORT;
+	header.DestPort = BENCH_LOCAL_PORT;
+	header.Flags.bits.flagSYN = 1;
+
+	if(!FindMatchingSocket(&header, &remote))
+	{
+		printf("cannot connect an HTTP socket\n");
+		exit(1);
+	}
+
+	SyncTCB();
+	MyTCBStub.smState = TCP_ESTABLISHED;
+	MyTCB.wRemoteMSS = TCP_MAX_SEG_SIZE_TX - 12u;
+	MyTCB.flags.bTimestamps = 1;
+	MyTCB.flags.bSACK = 1;
+	return hCurrentTCP;
+}
+
+/*********************************************************************
+ * Function:        static DWORD SendAll(TCP_SOCKET hSocket,
+ *                                       BYTE* pResponse)
+ *
+ * PreCondition:    ConnectSocket() has returned hSocket.
+ *
+ * Input:           hSocket - socket to send on
+ *                  pResponse - where to copy the TX FIFO, or NULL
+ *
+ * Output:          Number of bytes in the TX FIFO
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies the unacknowledged bytes of the TX FIFO to
+ *                  pResponse, sends them with SendTCP() while the socket
+ *                  is connected and then acknowledges all of them.
+ *
+ * Note:            As in HTTPBench.c.
+ ********************************************************************/
+static DWORD SendAll(TCP_SOCKET hSocket, BYTE* pResponse)
+{
+	PTR_BASE ptr;
+	DWORD dwLen;
+
+	SyncTCBStub(hSocket);
+	SyncTCB();
+	if(MyTCBStub.txHead >= MyTCBStub.txTail)
+		dwLen = MyTCBStub.txHead - MyTCBStub.txTail;
+	else
+		dwLen = (MyTCBStub.bufferRxStart - MyTCBStub.txTail) + (MyTCBStub.txHead - MyTCBStub.bufferTxStart);
+	if(pResponse)
+	{
+		for(ptr = MyTCBStub.txTail; ptr != MyTCBStub.txHead; pResponse++)
+		{
+			*pResponse = *(BYTE*)ptr;
+			if(++ptr >= MyTCBStub.bufferRxStart)
+				ptr = MyTCBStub.bufferTxStart;
+		}
+	}
+
+	if(MyTCBStub.smState == TCP_ESTABLISHED)
+	{
+		MyTCB.remoteWindow = 0xFFFF;
+		MyTCB.wCongWindow = 0xFFFF;
+		while(MyTCB.txUnackedTail != MyTCBStub.txHead)
+			SendTCP(ACK, SENDTCP_RESET_TIMERS);
+	}
+
+	MyTCBStub.txTail = MyTCBStub.txHead;
+	MyTCB.txUnackedTail = MyTCBStub.txHead;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	MyTCBStub.Flags.bTimer2Enabled = 0;
+	MyTCBStub.Flags.bHalfFullFlush = 0;
+	return dwLen;
+}
+
+/*********************************************************************
+ * Function:        static BOOL CheckResponse(const char* sFile,
+ *                                            BYTE* pResponse,
+ *                                            DWORD dwLen)
+ *
+ * PreCondition:    BuildFiles() has been called.
+ *
+ * Input:           sFile - name of the file requested
+ *                  pResponse - the response
+ *                  dwLen - length of the response
+ *
+ * Output:          TRUE if the response is as expected
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Checks the status line, then compares the body
+ *                  after the headers with the expected body of a file
+ *                  in the image.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL CheckResponse(const char* sFile, BYTE* pResponse, DWORD dwLen)
+{
+	DWORD i;
+	BYTE n;
+
+	n = FindFile(sFile);
+	if(dwLen < 17u || memcmp((void*)pResponse, n == BENCH_FILES ? "HTTP/1.1 404" : "HTTP/1.1 200", 12) != 0)
+		return FALSE;
+	if(n == BENCH_FILES)
+		return TRUE;
+
+	// Find the end of the headers
+	for(i = 0; i + 4 <= dwLen; i++)
+	{
+		if(memcmp((void*)&pResponse[i], (void*)"\r\n\r\n", 4) == 0)
+			break;
+	}
+	if(i + 4 > dwLen)
+		return FALSE;
+	i += 4;
+
+	return dwLen - i == Files[n].dwExpectedLen &&
+		memcmp((void*)&pResponse[i], (void*)Files[n].vExpected, dwLen - i) == 0;
+}
+
+// HTTP2 application callbacks: every page is public and has no
+// GET or POST processing
+HTTP_IO_RESULT HTTPExecuteGet(void)
+{
+	return HTTP_IO_DONE;
+}
+
+HTTP_IO_RESULT HTTPExecutePost(void)
+{
+	return HTTP_IO_DONE;
+}
+
+BYTE HTTPNeedsAuth(BYTE* cFile)
+{
+	return 0x80;
+}
+
+BYTE HTTPCheckAuth(BYTE* cUser, BYTE* cPass)
+{
+	return 0x80;
+}
+
+// Dynamic variable callbacks of HTTPPrint.h
+void HTTPPrint_version(void)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[0]);
+}
+
+void HTTPPrint_builddate(void)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[1]);
+}
+
+void HTTPPrint_uptime(void)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[2]);
+}
+
+void HTTPPrint_led(WORD num)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[3 + num]);
+}
@@ -0,0 +1,266 @@
+/*********************************************************************
+ *
+ *  IP checksum benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        ChecksumBench.c
+ * Dependencies:    Helpers.c, Tick.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Checks CalcIPChecksum(), CalcIPChecksumCopy() and UpdateIPChecksum()
+ * in Helpers.c against RefIPChecksum(), the 16-bit word loop of earlier
+ * stack versions, then reports the time CalcIPChecksum() and
+ * RefIPChecksum() take for several packet sizes.
+ *
+ * CalcIPChecksum() is checked for every length up to 2048 bytes at each
+ * alignment of the buffer, with random data.  RefIPChecksum() is only
+ * called on even addresses, as it requires.  CalcIPChecksumCopy() is
+ * checked for the same lengths at every alignment of the source and of
+ * the destination, for both the checksum and the copy.  UpdateIPChecksum() is
+ * checked by changing random words of a random 1460 byte buffer and
+ * comparing the updated checksum with a new CalcIPChecksum() sum.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -I. -I$S/Include -o checksumbench ChecksumBench.c \
+ *       "$S/TCPIP Stack/"{Helpers,Tick}.c && ./checksumbench
+ ********************************************************************/
+#define THIS_IS_STACK_APPLICATION
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_VERIFY_LEN	(2048u)		// Longest length checked
+#define BENCH_UPDATES		(100000ul)	// Number of UpdateIPChecksum() checks
+#define BENCH_BYTES			(256ul*1024ul*1024ul)	// Bytes summed per measurement
+
+// Packet sizes to measure: IP header, small segment, minimum reassembly
+// size, TCP MSS, Ethernet MTU and a large buffer
+static const WORD wSizes[] = {20, 64, 576, 1460, 1500, 8192};
+
+// Declare AppConfig structure and some other supporting stack variables
+APP_CONFIG AppConfig;
+
+// Buffer with room for every alignment of the longest length
+static DWORD dwBuffer[(BENCH_VERIFY_LEN + 8192u)/4u + 1u];
+
+// Private helper functions.
+static WORD RefIPChecksum(BYTE* buffer, WORD count);
+static BOOL VerifyChecksums(void);
+static double TimeChecksum(WORD (*pChecksum)(BYTE*, WORD), BYTE* buffer, WORD wLen);
+static double NowNs(void);
+
+int main(void)
+{
+	BYTE* buffer;
+	double dNew, dRef;
+	WORD i;
+
+	buffer = (BYTE*)dwBuffer;
+	for(i = 0; i < sizeof(dwBuffer); i++)
+		buffer[i] = (BYTE)LFSRRand();
+
+	if(!VerifyChecksums())
+		return 1;
+	printf("CalcIPChecksum(), CalcIPChecksumCopy() and UpdateIPChecksum() match the reference\n");
+
+	for(i = 0; i < sizeof(wSizes)/sizeof(wSizes[0]); i++)
+	{
+		dNew = TimeChecksum(CalcIPChecksum, buffer, wSizes[i]);
+		dRef = TimeChecksum(RefIPChecksum, buffer, wSizes[i]);
+		printf("%5u bytes: %8.1f ns (%6.0f MB/s), reference %8.1f ns (%6.0f MB/s), %4.1fx\n",
+			wSizes[i], dNew, wSizes[i] * 1000.0 / dNew, dRef, wSizes[i] * 1000.0 / dRef, dRef / dNew);
+	}
+
+	// Odd start address, as for a checksum from an odd offset in a packet
+	dNew = TimeChecksum(CalcIPChecksum, buffer + 1, 1460);
+	printf(" 1460 bytes at an odd address: %8.1f ns (%6.0f MB/s)\n", dNew, 1460 * 1000.0 / dNew);
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static BOOL VerifyChecksums(void)
+ *
+ * PreCondition:    dwBuffer[] holds random data.
+ *
+ * Input:           None
+ *
+ * Output:          TRUE if every checksum matched the reference
+ *
+ * Side Effects:    Prints the first mismatch.  Changes words of
+ *                  dwBuffer[].
+ *
+ * Overview:        Compares CalcIPChecksum() and CalcIPChecksumCopy()
+ *                  with RefIPChecksum() for every length and alignment,
+ *                  then UpdateIPChecksum() with CalcIPChecksum() for
+ *                  random word changes.
+ *
+ * Note:            An odd buffer address gives the same checksum as
+ *                  the same bytes copied to an even address.
+ ********************************************************************/
+static BOOL VerifyChecksums(void)
+{
+	static WORD wCopy[BENCH_VERIFY_LEN/2u + 1u];
+	static DWORD dwDest[BENCH_VERIFY_LEN/4u + 2u];
+	BYTE* buffer;
+	BYTE* dest;
+	WORD* pWord;
+	WORD wLen, wOffset, wDestOffset, wChecksum, wOld, wNew;
+	DWORD i;
+
+	buffer = (BYTE*)dwBuffer;
+	for(wOffset = 0; wOffset < 4u; wOffset++)
+	{
+		for(wLen = 0; wLen <= BENCH_VERIFY_LEN; wLen++)
+		{
+			memcpy((void*)wCopy, (void*)(buffer + wOffset), wLen);
+			if(CalcIPChecksum(buffer + wOffset, wLen) != RefIPChecksum((BYTE*)wCopy, wLen))
+			{
+				printf("CalcIPChecksum() mismatch: %u bytes at offset %u\n", wLen, wOffset);
+				return FALSE;
+			}
+
+			// Copy to every destination alignment, checking that the 
+			// bytes around the copy are left alone
+			for(wDestOffset = 0; wDestOffset < 4u; wDestOffset++)
+			{
+				dest = (BYTE*)dwDest + wDestOffset;
+				memset((void*)dwDest, 0x5A, sizeof(dwDest));
+				if(CalcIPChecksumCopy(dest, buffer + wOffset, wLen) != RefIPChecksum((BYTE*)wCopy, wLen)
+					|| memcmp((void*)dest, (void*)wCopy, wLen) != 0
+					|| (wDestOffset && dest[-1] != 0x5A) || dest[wLen] != 0x5A)
+				{
+					printf("CalcIPChecksumCopy() mismatch: %u bytes from offset %u to offset %u\n", wLen, wOffset, wDestOffset);
+					return FALSE;
+				}
+			}
+		}
+	}
+
+	// Change random words, including changes to and from 0x0000 and 0xFFFF
+	pWord = (WORD*)buffer;
+	wChecksum = CalcIPChecksum(buffer, 1460);
+	for(i = 0; i < BENCH_UPDATES; i++)
+	{
+		wOffset = LFSRRand() % 730u;
+		wOld = pWord[wOffset];
+		switch(i & 0x3u)
+		{
+			case 0:  wNew = 0x0000; break;
+			case 1:  wNew = 0xFFFF; break;
+			default: wNew = LFSRRand(); break;
+		}
+		pWord[wOffset] = wNew;
+		wChecksum = UpdateIPChecksum(wChecksum, wOld, wNew);
+		if(wChecksum != CalcIPChecksum(buffer, 1460))
+		{
+			printf("UpdateIPChecksum() mismatch: %04X -> %04X at word %u\n", wOld, wNew, wOffset);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static double TimeChecksum(WORD (*pChecksum)(BYTE*, WORD),
+ *                                             BYTE* buffer, WORD wLen)
+ *
+ * PreCondition:    None
+ *
+ * Input:           pChecksum - checksum function to time
+ *                  buffer - data to sum
+ *                  wLen - number of bytes to sum
+ *
+ * Output:          Average time of one call in ns
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sums about BENCH_BYTES bytes, wLen bytes per call.
+ *
+ * Note:            The function is called through a volatile pointer
+ *                  and the results are accumulated in a volatile
+ *                  variable, so that the calls are not optimized away.
+ ********************************************************************/
+static double TimeChecksum(WORD (*pChecksum)(BYTE*, WORD), BYTE* buffer, WORD wLen)
+{
+	WORD (* volatile pCall)(BYTE*, WORD);
+	DWORD i, dwCalls;
+	volatile WORD wSum;
+	double start;
+
+	pCall = pChecksum;
+	dwCalls = BENCH_BYTES / wLen;
+	wSum = 0;
+	start = NowNs();
+	for(i = 0; i < dwCalls; i++)
+		wSum += pCall(buffer, wLen);
+	return (NowNs() - start) / dwCalls;
+}
+
+/*********************************************************************
+ * Function:        static WORD RefIPChecksum(BYTE* buffer, WORD count)
+ *
+ * PreCondition:    buffer is WORD aligned.
+ *
+ * Input:           buffer - pointer to the data to be checksummed
+ *                  count - number of bytes to be checksummed
+ *
+ * Output:          The calculated checksum
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sums 16-bit words into a 32-bit sum, one word per
+ *                  iteration.
+ *
+ * Note:            CalcIPChecksum() of earlier stack versions.
+ ********************************************************************/
+static WORD RefIPChecksum(BYTE* buffer, WORD count)
+{
+	WORD i;
+	WORD *val;
+	union
+	{
+		WORD w[2];
+		DWORD dw;
+	} sum;
+
+	i = count >> 1;
+	val = (WORD*)buffer;
+
+	sum.dw = 0x00000000ul;
+	while(i--)
+		sum.dw += (DWORD)*val++;
+
+	if(count & 0x1)
+		sum.dw += (DWORD)*(BYTE*)val;
+
+	sum.dw = (DWORD)sum.w[0] + (DWORD)sum.w[1];
+	sum.w[0] += sum.w[1];
+
+	return ~sum.w[0];
+}
+
+/*********************************************************************
+ * Function:        static double NowNs(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          Monotonic time in ns
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads CLOCK_MONOTONIC.
+ *
+ * Note:            None
+ ********************************************************************/
+static double NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
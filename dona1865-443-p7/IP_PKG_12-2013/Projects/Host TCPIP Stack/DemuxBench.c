@@ -0,0 +1,269 @@
+/*********************************************************************
+ *
+ *  TCP and UDP socket lookup benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        DemuxBench.c
+ * Dependencies:    TCP.c, UDP.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the time FindMatchingSocket() in TCP.c and UDP.c takes to
+ * find the socket of an incoming segment.  TCP.c and UDP.c are
+ * included so that their static functions can be called directly;
+ * nothing is sent or received.
+ *
+ * HOST_BENCH_SOCKETS selects the number of TCP and UDP sockets (at most
+ * 254, see TCPIPConfig.h).  Each TCP socket is opened as a server on its
+ * own port and then connected to its own remote IP address and port.
+ * Each UDP socket is opened as a server on its own port.  Three lookups
+ * are timed, in a random socket order:
+ *   TCP hit    segment of an established connection
+ *   TCP miss   segment for a port nobody listens on
+ *   UDP hit    datagram to an open port
+ *
+ * TCP_HASH_BUCKETS and UDP_HASH_BUCKETS can be set with -D to compare
+ * table sizes.
+ *
+ * Build and run:  S=../../Microchip
+ *   for n in 4 16 64 128 250; do
+ *     gcc -O2 -DHOST_BENCH_SOCKETS=$n -I. -I$S -I$S/Include \
+ *         -o demuxbench DemuxBench.c \
+ *         "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP}.c && ./demuxbench
+ *   done
+ ********************************************************************/
+#if !defined(HOST_BENCH_SOCKETS)
+	#define HOST_BENCH_SOCKETS	(16u)
+#endif
+
+// Both modules have a static FindMatchingSocket()
+#define FindMatchingSocket	TCPFindMatchingSocket
+#include "TCPIP Stack/TCP.c"
+#undef FindMatchingSocket
+#define FindMatchingSocket	UDPFindMatchingSocket
+#include "TCPIP Stack/UDP.c"
+#undef FindMatchingSocket
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Lookups per measurement
+#define BENCH_LOOKUPS		(4000000ul)
+
+// Random socket order, repeated until BENCH_LOOKUPS lookups are done
+#define BENCH_ORDER_SIZE	(4096u)
+
+#define BENCH_TCP_PORT		(10000u)	// Local port of TCP socket 0
+#define BENCH_UDP_PORT		(20000u)	// Local port of UDP socket 0
+#define BENCH_REMOTE_PORT	(40000u)	// Remote port of socket 0
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+static TCP_HEADER tcpHeaders[HOST_BENCH_SOCKETS];
+static UDP_HEADER udpHeaders[HOST_BENCH_SOCKETS];
+static NODE_INFO remotes[HOST_BENCH_SOCKETS];
+static WORD order[BENCH_ORDER_SIZE];
+
+static double NowNs(void);
+static void OpenSockets(void);
+static double TimeTCP(TCP_HEADER* headers, BOOL bExpectMatch);
+static double TimeUDP(void);
+
+int main(void)
+{
+	TCP_HEADER missHeaders[HOST_BENCH_SOCKETS];
+	double tcpHit, tcpMiss, udpHit;
+	WORD i;
+
+	TickInit();
+	memset((void*)&AppConfig, 0x00, sizeof(AppConfig));
+	AppConfig.MyIPAddr.Val = 0x0201A8C0ul;		// 192.168.1.2
+	AppConfig.MyMask.Val = 0x00FFFFFFul;
+
+	TCPInit();
+	UDPInit();
+	OpenSockets();
+
+	srand(1);
+	for(i = 0; i < BENCH_ORDER_SIZE; i++)
+		order[i] = (WORD)(rand() % HOST_BENCH_SOCKETS);
+
+	// Same remote nodes and ports, but the local ports aren't in use
+	for(i = 0; i < HOST_BENCH_SOCKETS; i++)
+	{
+		missHeaders[i] = tcpHeaders[i];
+		missHeaders[i].DestPort = BENCH_TCP_PORT + HOST_BENCH_SOCKETS + i;
+	}
+
+	tcpHit = TimeTCP(tcpHeaders, TRUE);
+	tcpMiss = TimeTCP(missHeaders, FALSE);
+	udpHit = TimeUDP();
+
+	printf("%3u sockets: TCP hit %7.1f ns, TCP miss %7.1f ns, UDP hit %7.1f ns\n",
+		(unsigned)HOST_BENCH_SOCKETS, tcpHit, tcpMiss, udpHit);
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static void OpenSockets(void)
+ *
+ * PreCondition:    TCPInit() and UDPInit() have been called.
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills tcpHeaders[], udpHeaders[] and remotes[].
+ *
+ * Overview:        Opens every TCP socket as a server and connects it
+ *                  by passing a SYN from its remote node to
+ *                  FindMatchingSocket(), then opens every UDP socket.
+ *
+ * Note:            The TCP sockets are put in the ESTABLISHED state
+ *                  directly; no SYN+ACK is sent.
+ ********************************************************************/
+static void OpenSockets(void)
+{
+	TCP_SOCKET hTCP;
+	UDP_SOCKET hUDP;
+	WORD i;
+
+	for(i = 0; i < HOST_BENCH_SOCKETS; i++)
+	{
+		remotes[i].IPAddr.Val = 0x0000000Aul | ((DWORD)(i + 1u) << 24);	// 10.0.0.x
+		memset((void*)&remotes[i].MACAddr, 0x02, sizeof(MAC_ADDR));
+
+		memset((void*)&tcpHeaders[i], 0x00, sizeof(TCP_HEADER));
+		tcpHeaders[i].SourcePort = BENCH_REMOTE_PORT + i;
+		tcpHeaders[i].DestPort = BENCH_TCP_PORT + i;
+
+		hTCP = TCPOpen(0, TCP_OPEN_SERVER, BENCH_TCP_PORT + i, TCP_PURPOSE_DEFAULT);
+		if(hTCP == INVALID_SOCKET)
+		{
+			printf("TCPOpen() failed at socket %u\n", i);
+			exit(1);
+		}
+
+		tcpHeaders[i].Flags.bits.flagSYN = 1;
+		if(!TCPFindMatchingSocket(&tcpHeaders[i], &remotes[i]) || hCurrentTCP != hTCP)
+		{
+			printf("TCP socket %u not matched by its SYN\n", i);
+			exit(1);
+		}
+		tcpHeaders[i].Flags.bits.flagSYN = 0;
+		tcpHeaders[i].Flags.bits.flagACK = 1;
+		MyTCBStub.smState = TCP_ESTABLISHED;
+
+		memset((void*)&udpHeaders[i], 0x00, sizeof(UDP_HEADER));
+		udpHeaders[i].SourcePort = BENCH_REMOTE_PORT + i;
+		udpHeaders[i].DestinationPort = BENCH_UDP_PORT + i;
+
+		hUDP = UDPOpenEx(0, UDP_OPEN_SERVER, BENCH_UDP_PORT + i, 0);
+		if(hUDP == INVALID_UDP_SOCKET)
+		{
+			printf("UDPOpenEx() failed at socket %u\n", i);
+			exit(1);
+		}
+	}
+}
+
+/*********************************************************************
+ * Function:        static double TimeTCP(TCP_HEADER* headers,
+ *                                        BOOL bExpectMatch)
+ *
+ * PreCondition:    OpenSockets() has been called.
+ *
+ * Input:           headers - one segment header per socket
+ *                  bExpectMatch - TRUE if every segment must be matched
+ *                                 to the socket of the same index
+ *
+ * Output:          Average time of one TCP FindMatchingSocket() call in ns
+ *
+ * Side Effects:    Exits if a lookup returns the wrong result.
+ *
+ * Overview:        Looks up the segments in the random order.
+ *
+ * Note:            None
+ ********************************************************************/
+static double TimeTCP(TCP_HEADER* headers, BOOL bExpectMatch)
+{
+	DWORD n;
+	WORD i;
+	BOOL bMatch;
+	double start;
+
+	start = NowNs();
+	for(n = 0; n < BENCH_LOOKUPS; n++)
+	{
+		i = order[n % BENCH_ORDER_SIZE];
+		bMatch = TCPFindMatchingSocket(&headers[i], &remotes[i]);
+		if(bMatch != bExpectMatch || (bMatch && hCurrentTCP != i))
+		{
+			printf("Wrong TCP match for socket %u\n", i);
+			exit(1);
+		}
+	}
+	return (NowNs() - start) / BENCH_LOOKUPS;
+}
+
+/*********************************************************************
+ * Function:        static double TimeUDP(void)
+ *
+ * PreCondition:    OpenSockets() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          Average time of one UDP FindMatchingSocket() call in ns
+ *
+ * Side Effects:    Exits if a lookup returns the wrong socket.
+ *
+ * Overview:        Looks up a datagram for each socket in the random
+ *                  order.
+ *
+ * Note:            None
+ ********************************************************************/
+static double TimeUDP(void)
+{
+	DWORD n;
+	WORD i;
+	IP_ADDR localIP;
+	double start;
+
+	localIP.Val = AppConfig.MyIPAddr.Val;
+	start = NowNs();
+	for(n = 0; n < BENCH_LOOKUPS; n++)
+	{
+		i = order[n % BENCH_ORDER_SIZE];
+		if(UDPFindMatchingSocket(&udpHeaders[i], &remotes[i], &localIP) != i)
+		{
+			printf("Wrong UDP match for socket %u\n", i);
+			exit(1);
+		}
+	}
+	return (NowNs() - start) / BENCH_LOOKUPS;
+}
+
+/*********************************************************************
+ * Function:        static double NowNs(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          Monotonic time in ns
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads CLOCK_MONOTONIC.
+ *
+ * Note:            None
+ ********************************************************************/
+static double NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
@@ -0,0 +1,513 @@
+/*********************************************************************
+ *
+ *  Scatter/gather transmit benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        GatherBench.c
+ * Dependencies:    TCP.c, UDP.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the throughput of sending messages made of a 12 byte header
+ * and a payload held in another buffer, for message sizes from 64 to
+ * 1460 bytes, in two ways:
+ *   copy     - UDPPutArray() or TCPPutArray() once for the header and
+ *              once for the payload, then UDPFlush()
+ *   gather   - one UDPFlushFragments() or TCPPutFragments() call with a
+ *              fragment for each
+ * The host MAC gathers UDP fragments with writev(), so with UDP the
+ * payload is not copied to the MAC TX buffer at all.  TCP copies the
+ * fragments to the TX FIFO, which keeps them for retransmission, and
+ * SendTCP() sends them as full sized segments; the TCP times include
+ * SendTCP().
+ *
+ * TCP.c is included so that a socket can be connected directly, as in
+ * TxBench.c.  The host MAC replays an empty capture, so every frame is
+ * dropped by MACFlush() or MACFlushFragments() without a system call and
+ * only the CPU time of the stack is measured.
+ *
+ * Before measuring, the UDP checksums of packets sent with odd and even
+ * header and fragment lengths, by gathering and by copying (more than
+ * MAC_TX_GATHER_FRAGMENTS fragments), and the TX FIFO contents written
+ * by TCPPutFragments(), wrapping included, are verified.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DUDP_USE_TX_CHECKSUM -I. -I$S -I$S/Include \
+ *       -o gatherbench GatherBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP,UDP}.c && ./gatherbench
+ * Without -DUDP_USE_TX_CHECKSUM, UDP is measured without checksums, which
+ * otherwise read all the data once either way, and the UDP packets are
+ * not verified.
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_BYTES			(64ul*1024ul*1024ul)	// Bytes sent per measurement
+#define BENCH_HEADER_LEN	(12u)		// Application header of each message
+#define BENCH_LOCAL_PORT	(10000u)
+#define BENCH_REMOTE_PORT	(40000u)
+
+// Message sizes to measure, header included
+static const WORD wSizes[] = {64, 128, 256, 512, 1024, 1460};
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// Remote node of both sockets
+static NODE_INFO Remote;
+
+static BYTE vHeader[BENCH_HEADER_LEN];
+static BYTE vPayload[MAC_TX_BUFFER_SIZE];
+
+// Private helper functions.
+static TCP_SOCKET ConnectSocket(void);
+static BOOL VerifyUDP(UDP_SOCKET hUDP);
+static BOOL CheckUDPPacket(TX_FRAGMENT* pFragments, BYTE vCount, BOOL bGathered);
+static BOOL VerifyTCP(TCP_SOCKET hTCP);
+static double MeasureUDP(UDP_SOCKET hUDP, WORD wSize, BOOL bGather);
+static double MeasureTCP(TCP_SOCKET hTCP, WORD wSize, BOOL bGather);
+static void DrainTCP(TCP_SOCKET hTCP);
+
+int main(void)
+{
+	UDP_SOCKET hUDP;
+	TCP_SOCKET hTCP;
+	double dCopy, dGather;
+	WORD i;
+
+	// Replay an empty capture: the link is up and nothing is received
+	if(!InitHostReplay())
+		return 1;
+
+	Remote.IPAddr.Val = 0x0101A8C0ul;			// 192.168.1.1
+	memset((void*)&Remote.MACAddr, 0x02, sizeof(MAC_ADDR));
+	for(i = 0; i < sizeof(vHeader); i++)
+		vHeader[i] = (BYTE)LFSRRand();
+	for(i = 0; i < sizeof(vPayload); i++)
+		vPayload[i] = (BYTE)LFSRRand();
+
+	UDPInit();
+	TCPInit();
+
+	hUDP = UDPOpenEx((DWORD_PTR_BASE)(PTR_BASE)&Remote, UDP_OPEN_NODE_INFO, BENCH_LOCAL_PORT, BENCH_REMOTE_PORT);
+	hTCP = ConnectSocket();
+	if(hUDP == INVALID_UDP_SOCKET)
+	{
+		printf("cannot open the UDP socket\n");
+		return 1;
+	}
+
+	#if defined(UDP_USE_TX_CHECKSUM)
+	if(!VerifyUDP(hUDP))
+		return 1;
+	printf("UDP checksums verified\n");
+	#endif
+	if(!VerifyTCP(hTCP))
+		return 1;
+	printf("TCP FIFO contents verified\n");
+
+	printf("message   UDP copy   UDP gather         TCP copy   TCP gather\n");
+	for(i = 0; i < sizeof(wSizes)/sizeof(wSizes[0]); i++)
+	{
+		dCopy = MeasureUDP(hUDP, wSizes[i], FALSE);
+		dGather = MeasureUDP(hUDP, wSizes[i], TRUE);
+		printf("%5u B %6.0f MB/s %6.0f MB/s %4.2fx", wSizes[i], dCopy, dGather, dGather / dCopy);
+		dCopy = MeasureTCP(hTCP, wSizes[i], FALSE);
+		dGather = MeasureTCP(hTCP, wSizes[i], TRUE);
+		printf(" %6.0f MB/s %6.0f MB/s %4.2fx\n", dCopy, dGather, dGather / dCopy);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static TCP_SOCKET ConnectSocket(void)
+ *
+ * PreCondition:    TCPInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          The connected socket
+ *
+ * Side Effects:    Exits if the socket cannot be opened.
+ *
+ * Overview:        Opens a server socket with a 16 KB TX FIFO and
+ *                  connects it by passing a SYN from Remote to
+ *                  FindMatchingSocket().
+ *
+ * Note:            The socket is put in the ESTABLISHED state directly,
+ *                  as in TxBench.c.
+ ********************************************************************/
+static TCP_SOCKET ConnectSocket(void)
+{
+	TCP_SOCKET hTCP;
+	TCP_HEADER header;
+
+	memset((void*)&header, 0x00, sizeof(header));
+	header.SourcePort = BENCH_REMOTE_PORT;
+	header.DestPort = BENCH_LOCAL_PORT;
+	header.Flags.bits.flagSYN = 1;
+
+	hTCP = TCPOpen(0, TCP_OPEN_SERVER, BENCH_LOCAL_PORT, TCP_PURPOSE_TCP_PERFORMANCE_TX);
+	if(hTCP == INVALID_SOCKET || !FindMatchingSocket(&header, &Remote) || hCurrentTCP != hTCP)
+	{
+		printf("cannot connect the TCP socket\n");
+		exit(1);
+	}
+
+	SyncTCB();
+	MyTCBStub.smState = TCP_ESTABLISHED;
+	MyTCB.wRemoteMSS = TCP_MAX_SEG_SIZE_TX - 12u;
+	MyTCB.flags.bTimestamps = 1;
+	MyTCB.flags.bSACK = 1;
+	return hTCP;
+}
+
+/*********************************************************************
+ * Function:        static BOOL VerifyUDP(UDP_SOCKET hUDP)
+ *
+ * PreCondition:    hUDP is open.
+ *
+ * Input:           hUDP - socket to send on
+ *
+ * Output:          TRUE if every packet is correct
+ *
+ * Side Effects:    Prints the first wrong packet.
+ *
+ * Overview:        Sends packets made of 0 to 3 bytes put with
+ *                  UDPPutArray() and fragments of odd and even lengths,
+ *                  gathered (2 fragments) and copied (more than
+ *                  MAC_TX_GATHER_FRAGMENTS), and checks each of them.
+ *
+ * Note:            The payload of the last case does not fit and is
+ *                  truncated.
+ ********************************************************************/
+static BOOL VerifyUDP(UDP_SOCKET hUDP)
+{
+	TX_FRAGMENT Fragments[MAC_TX_GATHER_FRAGMENTS + 1];
+	WORD wPut, wHeader, wPayload, wSent, wTotal;
+	BYTE i, vCount;
+	BOOL bFits;
+
+	for(wPut = 0; wPut < 4u; wPut++)
+	{
+		for(wHeader = 0; wHeader < 4u; wHeader++)
+		{
+			for(wPayload = 0; wPayload < MAC_TX_BUFFER_SIZE; wPayload += 97u)
+			{
+				for(vCount = 2; vCount <= MAC_TX_GATHER_FRAGMENTS + 1u; vCount += MAC_TX_GATHER_FRAGMENTS - 1u)
+				{
+					// Header, payload and single bytes of the payload for
+					// the copied case
+					wTotal = 0;
+					for(i = 0; i < vCount; i++)
+					{
+						Fragments[i].bROM = FALSE;
+						Fragments[i].data.pRAM = &vPayload[i];
+						Fragments[i].wLength = 1;
+						wTotal++;
+					}
+					Fragments[0].data.pRAM = vHeader;
+					Fragments[0].wLength = wHeader;
+					Fragments[1].wLength = wPayload;
+					wTotal += wHeader + wPayload - 2u;
+					bFits = (wPut + wTotal <= MAC_TX_BUFFER_SIZE - sizeof(IP_HEADER) - sizeof(UDP_HEADER));
+
+					if(!UDPIsPutReady(hUDP))
+						return FALSE;
+					UDPPutArray(vHeader, wPut);
+					wSent = UDPFlushFragments(Fragments, vCount);
+					if(!CheckUDPPacket(Fragments, vCount, bFits && vCount <= MAC_TX_GATHER_FRAGMENTS))
+						return FALSE;
+					if(wSent != wTotal && bFits)
+					{
+						printf("UDPFlushFragments() sent %u of %u bytes\n", wSent, wTotal);
+						return FALSE;
+					}
+				}
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static BOOL CheckUDPPacket(TX_FRAGMENT* pFragments,
+ *                                             BYTE vCount, BOOL bGathered)
+ *
+ * PreCondition:    UDPFlushFragments() has just sent pFragments.
+ *
+ * Input:           pFragments - fragments that were sent
+ *                  vCount - number of fragments
+ *                  bGathered - TRUE if the fragments were not copied to
+ *                              the TX buffer
+ *
+ * Output:          TRUE if the UDP checksum is correct
+ *
+ * Side Effects:    Prints a wrong checksum.
+ *
+ * Overview:        Rebuilds the UDP packet from the headers left in the
+ *                  TX buffer and the fragments, then sums it with the
+ *                  pseudoheader, checksum field included.
+ *
+ * Note:            When the fragments were copied, they are in the TX
+ *                  buffer and the packet is taken from there.
+ ********************************************************************/
+static BOOL CheckUDPPacket(TX_FRAGMENT* pFragments, BYTE vCount, BOOL bGathered)
+{
+	static BYTE vPacket[12 + MAC_TX_BUFFER_SIZE];
+	BYTE* pIP;
+	WORD wLen, wInBuffer;
+	BYTE i;
+
+	pIP = (BYTE*)(BASE_TX_ADDR + sizeof(ETHER_HEADER));
+	wLen = (((WORD)pIP[2] << 8) | pIP[3]) - sizeof(IP_HEADER);
+
+	// Source and destination addresses, zero, protocol and UDP length
+	memcpy((void*)vPacket, (void*)&pIP[12], 8);
+	vPacket[8] = 0;
+	vPacket[9] = IP_PROT_UDP;
+	vPacket[10] = (BYTE)(wLen >> 8);
+	vPacket[11] = (BYTE)wLen;
+
+	wInBuffer = wLen;
+	if(bGathered)
+	{
+		for(i = 0; i < vCount; i++)
+			wInBuffer -= pFragments[i].wLength;
+	}
+	memcpy((void*)&vPacket[12], (void*)&pIP[sizeof(IP_HEADER)], wInBuffer);
+	if(bGathered)
+	{
+		for(i = 0; i < vCount; i++)
+		{
+			memcpy((void*)&vPacket[12 + wInBuffer], (void*)pFragments[i].data.pRAM, pFragments[i].wLength);
+			wInBuffer += pFragments[i].wLength;
+		}
+	}
+
+	if(CalcIPChecksum(vPacket, 12u + wLen) != 0u)
+	{
+		printf("wrong UDP checksum in a %u byte packet of %u fragments\n", wLen, vCount);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static BOOL VerifyTCP(TCP_SOCKET hTCP)
+ *
+ * PreCondition:    ConnectSocket() has returned hTCP.
+ *
+ * Input:           hTCP - socket to write to
+ *
+ * Output:          TRUE if the TX FIFO holds the fragments
+ *
+ * Side Effects:    Prints the first mismatch.
+ *
+ * Overview:        Writes fragments of several lengths with
+ *                  TCPPutFragments(), at FIFO positions that move on by
+ *                  an odd number of bytes, and compares what was written
+ *                  to the FIFO with the fragments.
+ *
+ * Note:            The FIFO is emptied by hand after each write, so
+ *                  that the writes wrap around its end.
+ ********************************************************************/
+static BOOL VerifyTCP(TCP_SOCKET hTCP)
+{
+	static BYTE vExpected[BENCH_HEADER_LEN + MAC_TX_BUFFER_SIZE];
+	TX_FRAGMENT Fragments[2];
+	PTR_BASE wHead;
+	WORD wPayload, wPut, w;
+	DWORD i;
+
+	Fragments[0].bROM = FALSE;
+	Fragments[0].data.pRAM = vHeader;
+	Fragments[0].wLength = BENCH_HEADER_LEN;
+	Fragments[1].bROM = FALSE;
+	Fragments[1].data.pRAM = vPayload;
+	memcpy((void*)vExpected, (void*)vHeader, BENCH_HEADER_LEN);
+	memcpy((void*)&vExpected[BENCH_HEADER_LEN], (void*)vPayload, sizeof(vPayload));
+
+	for(i = 0; i < 1000u; i++)
+	{
+		wPayload = (WORD)(i * 37u % sizeof(vPayload));
+		Fragments[1].wLength = wPayload;
+
+		SyncTCBStub(hTCP);
+		wHead = MyTCBStub.txHead;
+		wPut = TCPPutFragments(hTCP, Fragments, 2);
+		if(wPut != BENCH_HEADER_LEN + wPayload)
+		{
+			printf("TCPPutFragments() wrote %u of %u bytes\n", wPut, BENCH_HEADER_LEN + wPayload);
+			return FALSE;
+		}
+
+		SyncTCBStub(hTCP);
+		for(w = 0; w < wPut; w++)
+		{
+			if(*(BYTE*)wHead != vExpected[w])
+			{
+				printf("TCPPutFragments() wrong byte %u of %u\n", w, wPut);
+				return FALSE;
+			}
+			if(++wHead >= MyTCBStub.bufferRxStart)
+				wHead = MyTCBStub.bufferTxStart;
+		}
+		if(wHead != MyTCBStub.txHead)
+		{
+			printf("TCPPutFragments() left txHead at the wrong place\n");
+			return FALSE;
+		}
+
+		// Empty the FIFO
+		SyncTCB();
+		MyTCBStub.txTail = MyTCBStub.txHead;
+		MyTCB.txUnackedTail = MyTCBStub.txHead;
+		MyTCBStub.Flags.bTimer2Enabled = 0;
+		MyTCBStub.Flags.bHalfFullFlush = 0;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static double MeasureUDP(UDP_SOCKET hUDP, WORD wSize,
+ *                                           BOOL bGather)
+ *
+ * PreCondition:    hUDP is open.
+ *
+ * Input:           hUDP - socket to send on
+ *                  wSize - message size, header included
+ *                  bGather - TRUE to send with UDPFlushFragments()
+ *
+ * Output:          Throughput in MB/s
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sends BENCH_BYTES bytes of wSize byte messages, one
+ *                  message per packet.
+ *
+ * Note:            None
+ ********************************************************************/
+static double MeasureUDP(UDP_SOCKET hUDP, WORD wSize, BOOL bGather)
+{
+	TX_FRAGMENT Fragments[2];
+	DWORD i, dwMessages;
+	double start;
+
+	Fragments[0].bROM = FALSE;
+	Fragments[0].data.pRAM = vHeader;
+	Fragments[0].wLength = BENCH_HEADER_LEN;
+	Fragments[1].bROM = FALSE;
+	Fragments[1].data.pRAM = vPayload;
+	Fragments[1].wLength = wSize - BENCH_HEADER_LEN;
+
+	dwMessages = BENCH_BYTES / wSize;
+	start = NowNs(CLOCK_MONOTONIC);
+	for(i = 0; i < dwMessages; i++)
+	{
+		UDPIsPutReady(hUDP);
+		if(bGather)
+		{
+			UDPFlushFragments(Fragments, 2);
+		}
+		else
+		{
+			UDPPutArray(vHeader, BENCH_HEADER_LEN);
+			UDPPutArray(vPayload, wSize - BENCH_HEADER_LEN);
+			UDPFlush();
+		}
+	}
+	return dwMessages * (double)wSize * 1000.0 / (NowNs(CLOCK_MONOTONIC) - start);
+}
+
+/*********************************************************************
+ * Function:        static double MeasureTCP(TCP_SOCKET hTCP, WORD wSize,
+ *                                           BOOL bGather)
+ *
+ * PreCondition:    ConnectSocket() has returned hTCP.
+ *
+ * Input:           hTCP - socket to send on
+ *                  wSize - message size, header included
+ *                  bGather - TRUE to write with TCPPutFragments()
+ *
+ * Output:          Throughput in MB/s
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes wSize byte messages until the TX FIFO has no
+ *                  room for another one, sends the FIFO, and repeats
+ *                  until BENCH_BYTES bytes are sent.
+ *
+ * Note:            None
+ ********************************************************************/
+static double MeasureTCP(TCP_SOCKET hTCP, WORD wSize, BOOL bGather)
+{
+	TX_FRAGMENT Fragments[2];
+	DWORD dwBytes;
+	double start;
+
+	Fragments[0].bROM = FALSE;
+	Fragments[0].data.pRAM = vHeader;
+	Fragments[0].wLength = BENCH_HEADER_LEN;
+	Fragments[1].bROM = FALSE;
+	Fragments[1].data.pRAM = vPayload;
+	Fragments[1].wLength = wSize - BENCH_HEADER_LEN;
+
+	dwBytes = 0;
+	start = NowNs(CLOCK_MONOTONIC);
+	while(dwBytes < BENCH_BYTES)
+	{
+		while(TCPIsPutReady(hTCP) >= wSize)
+		{
+			if(bGather)
+			{
+				TCPPutFragments(hTCP, Fragments, 2);
+			}
+			else
+			{
+				TCPPutArray(hTCP, vHeader, BENCH_HEADER_LEN);
+				TCPPutArray(hTCP, vPayload, wSize - BENCH_HEADER_LEN);
+			}
+			dwBytes += wSize;
+		}
+		DrainTCP(hTCP);
+	}
+	return dwBytes * 1000.0 / (NowNs(CLOCK_MONOTONIC) - start);
+}
+
+/*********************************************************************
+ * Function:        static void DrainTCP(TCP_SOCKET hTCP)
+ *
+ * PreCondition:    ConnectSocket() has returned hTCP.
+ *
+ * Input:           hTCP - socket to send on
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sends the data in the TX FIFO with SendTCP() and then
+ *                  acknowledges all of it.
+ *
+ * Note:            The windows are opened wide, so that every segment
+ *                  is full sized.
+ ********************************************************************/
+static void DrainTCP(TCP_SOCKET hTCP)
+{
+	SyncTCBStub(hTCP);
+	SyncTCB();
+	MyTCB.remoteWindow = 0xFFFF;
+	MyTCB.wCongWindow = 0xFFFF;
+	while(MyTCB.txUnackedTail != MyTCBStub.txHead)
+		SendTCP(ACK, SENDTCP_RESET_TIMERS);
+
+	MyTCBStub.txTail = MyTCB.txUnackedTail;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	MyTCBStub.Flags.bTimer2Enabled = 0;
+	MyTCBStub.Flags.bHalfFullFlush = 0;
+}
@@ -0,0 +1,61 @@
+/**************************************************************
+ * HTTPPrint.h
+ * Provides callback headers and resolution for user's custom
+ * HTTP Application.
+ *
+ * Dynamic variables of the pages HTTPBench.c, LoadBench.c and
+ * CacheBench.c build, in the format the MPFS Utility generates.
+ **************************************************************/
+
+#ifndef __HTTPPRINT_H
+#define __HTTPPRINT_H
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(STACK_USE_HTTP2_SERVER)
+
+extern HTTP_STUB httpStubs[MAX_HTTP_CONNECTIONS];
+extern BYTE curHTTPID;
+
+void HTTPPrint(DWORD callbackID);
+void HTTPPrint_version(void);
+void HTTPPrint_builddate(void);
+void HTTPPrint_uptime(void);
+void HTTPPrint_led(WORD);
+
+void HTTPPrint(DWORD callbackID)
+{
+	switch(callbackID)
+	{
+        case 0x00000000:
+			HTTPPrint_version();
+			break;
+        case 0x00000001:
+			HTTPPrint_builddate();
+			break;
+        case 0x00000002:
+			HTTPPrint_uptime();
+			break;
+        case 0x00000003:
+			HTTPPrint_led(0);
+			break;
+        case 0x00000004:
+			HTTPPrint_led(1);
+			break;
+		default:
+			// Output notification for undefined values
+			TCPPutROMArray(sktHTTP, (ROM BYTE*)"!DEF", 4);
+	}
+
+	return;
+}
+
+void HTTPPrint_(void)
+{
+	TCPPut(sktHTTP, '~');
+	return;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+/*********************************************************************
+ *
+ *	Hardware specific definitions for the host build
+ *
+ *********************************************************************
+ * FileName:        HardwareProfile.h
+ * Dependencies:    Compiler.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * The stack runs as a Linux process on the ETHHost.c MAC driver.  See
+ * ETHHost.h for the TAP and pcap backends.
+ ********************************************************************/
+#ifndef HARDWARE_PROFILE_H
+#define HARDWARE_PROFILE_H
+
+#include "Compiler.h"
+
+// Clock frequency of the PIC32 being modeled.  TICKS_PER_SECOND is
+// derived from GetPeripheralClock().
+#define GetSystemClock()		(80000000ul)
+#define GetInstructionClock()	(GetSystemClock())
+#define GetPeripheralClock()	(GetSystemClock())
+
+// No buttons on a host; released, as on the boards
+#define BUTTON3_IO				(1u)
+
+#endif // #ifndef HARDWARE_PROFILE_H
@@ -0,0 +1,127 @@
+/*********************************************************************
+ *
+ *	Application configuration for the host build
+ *
+ *********************************************************************
+ * FileName:        HostAppConfig.c
+ * Dependencies:    TCPIP.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Loads AppConfig for MainDemo.c and the benches that run the full
+ * stack, and starts the host MAC on an empty capture for the benches
+ * that drive the modules directly.  Link it next to the program source.
+ ********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include "HostAppConfig.h"
+
+/*********************************************************************
+ * Function:        void InitAppConfig(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Loads the default addresses of TCPIPConfig.h.
+ *
+ * Note:            There is no non-volatile storage on the host.
+ ********************************************************************/
+void InitAppConfig(void)
+{
+	memset((void*)&AppConfig, 0x00, sizeof(AppConfig));
+	AppConfig.Flags.bIsDHCPEnabled = FALSE;
+	AppConfig.MyIPAddr.Val = MY_DEFAULT_IP_ADDR_BYTE1 | MY_DEFAULT_IP_ADDR_BYTE2<<8ul | MY_DEFAULT_IP_ADDR_BYTE3<<16ul | MY_DEFAULT_IP_ADDR_BYTE4<<24ul;
+	AppConfig.DefaultIPAddr.Val = AppConfig.MyIPAddr.Val;
+	AppConfig.MyMask.Val = MY_DEFAULT_MASK_BYTE1 | MY_DEFAULT_MASK_BYTE2<<8ul | MY_DEFAULT_MASK_BYTE3<<16ul | MY_DEFAULT_MASK_BYTE4<<24ul;
+	AppConfig.DefaultMask.Val = AppConfig.MyMask.Val;
+	AppConfig.MyGateway.Val = MY_DEFAULT_GATE_BYTE1 | MY_DEFAULT_GATE_BYTE2<<8ul | MY_DEFAULT_GATE_BYTE3<<16ul | MY_DEFAULT_GATE_BYTE4<<24ul;
+	AppConfig.PrimaryDNSServer.Val = MY_DEFAULT_PRIMARY_DNS_BYTE1 | MY_DEFAULT_PRIMARY_DNS_BYTE2<<8ul | MY_DEFAULT_PRIMARY_DNS_BYTE3<<16ul | MY_DEFAULT_PRIMARY_DNS_BYTE4<<24ul;
+	AppConfig.SecondaryDNSServer.Val = MY_DEFAULT_SECONDARY_DNS_BYTE1 | MY_DEFAULT_SECONDARY_DNS_BYTE2<<8ul | MY_DEFAULT_SECONDARY_DNS_BYTE3<<16ul | MY_DEFAULT_SECONDARY_DNS_BYTE4<<24ul;
+
+	AppConfig.MyMACAddr.v[0] = MY_DEFAULT_MAC_BYTE1;
+	AppConfig.MyMACAddr.v[1] = MY_DEFAULT_MAC_BYTE2;
+	AppConfig.MyMACAddr.v[2] = MY_DEFAULT_MAC_BYTE3;
+	AppConfig.MyMACAddr.v[3] = MY_DEFAULT_MAC_BYTE4;
+	AppConfig.MyMACAddr.v[4] = MY_DEFAULT_MAC_BYTE5;
+	AppConfig.MyMACAddr.v[5] = MY_DEFAULT_MAC_BYTE6;
+
+	// MY_DEFAULT_HOST_NAME may be shorter than the field; copy it as a string
+	strncpypgm2ram((char*)AppConfig.NetBIOSName, (ROM char*)MY_DEFAULT_HOST_NAME, sizeof(AppConfig.NetBIOSName)-1);
+	FormatNetBIOSName(AppConfig.NetBIOSName);
+}
+
+/*********************************************************************
+ * Function:        BOOL InitHostReplay(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          TRUE on success, FALSE if the capture cannot be
+ *                  created
+ *
+ * Side Effects:    Sets HOST_MAC_PCAP_IN
+ *
+ * Overview:        Starts the tick, loads AppConfig and starts the
+ *                  host MAC on an empty capture: the link is up and
+ *                  nothing is received, so every frame the benches
+ *                  send goes to the capture output only.
+ *
+ * Note:            The capture is deleted once MACInit() has opened
+ *                  it.  Other modules are initialized by the caller.
+ ********************************************************************/
+BOOL InitHostReplay(void)
+{
+	static const BYTE vEmptyCapture[24] = {0xD4, 0xC3, 0xB2, 0xA1, 2, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0, 0, 1, 0, 0, 0};
+	char sCapture[] = "/tmp/hostreplayXXXXXX";
+	int fd;
+
+	fd = mkstemp(sCapture);
+	if(fd < 0 || write(fd, vEmptyCapture, sizeof(vEmptyCapture)) != sizeof(vEmptyCapture))
+	{
+		printf("cannot create %s\n", sCapture);
+		return FALSE;
+	}
+	close(fd);
+	setenv("HOST_MAC_PCAP_IN", sCapture, 1);
+
+	TickInit();
+	InitAppConfig();
+	MACInit();
+	unlink(sCapture);
+
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        double NowNs(clockid_t clock)
+ *
+ * PreCondition:    None
+ *
+ * Input:           clock - CLOCK_MONOTONIC for elapsed time or
+ *                          CLOCK_PROCESS_CPUTIME_ID for CPU time
+ *
+ * Output:          Time in ns
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads the given clock.
+ *
+ * Note:            None
+ ********************************************************************/
+double NowNs(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
@@ -0,0 +1,23 @@
+/*********************************************************************
+ *
+ *	Application configuration for the host build
+ *
+ *********************************************************************
+ * FileName:        HostAppConfig.h
+ * Dependencies:    TCPIP.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Shared by MainDemo.c and the benches that run the full stack.  Each
+ * program still declares the AppConfig structure itself.
+ ********************************************************************/
+#ifndef HOST_APP_CONFIG_H
+#define HOST_APP_CONFIG_H
+
+#include <time.h>
+
+void InitAppConfig(void);
+BOOL InitHostReplay(void);
+double NowNs(clockid_t clock);
+
+#endif // #ifndef HOST_APP_CONFIG_H
@@ -0,0 +1,733 @@
+/*********************************************************************
+ *
+ *  Compressed file benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        InflateBench.c
+ * Dependencies:    TCP.c, HTTP2.c, MPFS2.c, Inflate.c, zlib
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures what GZIP compression of a page saves in the MPFS2 image,
+ * and what HTTP_USE_INFLATE costs to decompress it for clients that do
+ * not send "Accept-Encoding: gzip".  The same page is in the image as:
+ *   raw     the page itself
+ *   gzip    one deflate stream with a 32 KB window, as the MPFS2
+ *           utilities write it without block indexes.  It is larger
+ *           than HTTP_INFLATE_WINDOW, so it is sent compressed to
+ *           every client.
+ *   blk<n>  deflate blocks of n KB, each started with a full flush,
+ *           and their index (MPFS2_FLAG_HASBLOCKS).  The Java MPFS2
+ *           utility writes 4 KB blocks with its /inflate option.
+ * along with "small.htm", a page smaller than the window compressed
+ * without an index.  For each it reports the bytes of image used, and
+ * the pages per second and CPU time per page of serving it to a client
+ * that accepts GZIP and to one that does not.  It then reports the time
+ * to decompress 100 bytes at a random position of each blk<n> file, as
+ * a response does after another connection has used the shared window.
+ *
+ * The image is built in MPFS_Start[] at startup with zlib, and HTTP
+ * requests are served as in HTTPBench.c.  Each response is checked in a
+ * first pass, on a closed and on a persistent connection.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_HTTP_BENCH -I. -I$S -I$S/Include -o inflatebench \
+ *       InflateBench.c HostAppConfig.c "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP,MPFS2,Inflate,HTTP2}.c \
+ *       -lz && ./inflatebench
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <zlib.h>
+
+#define BENCH_BYTES			(32ul*1024ul*1024ul)	// Page bytes served per measurement
+#define BENCH_LOCAL_PORT	(80u)
+#define BENCH_REMOTE_PORT	(40000u)
+#define BENCH_FAT_RECORD	(22u)					// Size of an MPFS2 FAT record
+#define BENCH_PAGE_LEN		(32768u)				// Length of the page
+#define BENCH_SMALL_LEN		(3000u)					// Length of small.htm
+#define BENCH_MAX_FILE		(BENCH_PAGE_LEN + 4096u)	// Largest file or response
+#define BENCH_SEEKS			(20000ul)				// Random reads per block size
+#define BENCH_ROUNDS		(5u)					// Best of this many measurements
+
+// Files of the image, in order.  Each blk<n> file is followed by its
+// index.
+static const struct
+{
+	const char* sName;
+	WORD wBlockLen;				// 0 for one deflate stream
+	BOOL bZipped;
+} Pages[] =
+{
+	{"raw.htm", 0, FALSE},
+	{"gzip.htm", 0, TRUE},
+	{"blk1.htm", 1024, TRUE},
+	{"blk2.htm", 2048, TRUE},
+	{"blk4.htm", 4096, TRUE},
+	{"small.htm", 0, TRUE}
+};
+#define BENCH_PAGES			(sizeof(Pages)/sizeof(Pages[0]))
+#define BENCH_FILES			(BENCH_PAGES + 3u)		// Pages and the 3 block indexes
+
+// MPFS2 reads the image from here.  MPFS2.c declares it ROM, but it is
+// written once before MPFSInit().
+BYTE MPFS_Start[256ul*1024ul];
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// The page, and each file as stored in the image
+static BYTE vPage[BENCH_PAGE_LEN];
+static BYTE vStored[BENCH_PAGES][BENCH_MAX_FILE];
+static DWORD dwStoredLen[BENCH_PAGES];
+static DWORD dwIndexLen[BENCH_PAGES];
+static WORD wFileID[BENCH_PAGES];
+
+// Private helper functions.
+static void MakePage(void);
+static void BuildImage(void);
+static DWORD Compress(BYTE* pOut, BYTE* pIndex, const BYTE* pData, DWORD dwLen, WORD wBlockLen);
+static void AddFile(BYTE vFile, const char* sName, BYTE* pData, DWORD dwLen, WORD wFlags);
+static DWORD ServePage(BYTE vPageID, BOOL bGzip, BOOL bKeepAlive, BYTE* pResponse);
+static BOOL CheckResponse(BYTE vPageID, BOOL bGzip, BOOL bKeepAlive, BYTE* pResponse, DWORD dwLen);
+static double TimeSeeks(BYTE vPageID);
+static DWORD ServeRequest(const char* sRequest, BYTE* pResponse);
+static TCP_SOCKET ConnectSocket(void);
+static DWORD SendAll(TCP_SOCKET hSocket, BYTE* pResponse);
+
+int main(void)
+{
+	static BYTE vResponse[BENCH_MAX_FILE + 512];
+	DWORD dwPages, dwPageLen, j, dwLen;
+	double dStart, dCPU, dPages[2], dCPUus[2], dBest;
+	BYTE i, k, r;
+
+	// Replay an empty capture: the link is up and nothing is received
+	if(!InitHostReplay())
+		return 1;
+
+	MakePage();
+	BuildImage();
+	MPFSInit();
+	TCPInit();
+	HTTPInit();
+
+	// Every page, to both clients, on both kinds of connection
+	for(i = 0; i < BENCH_PAGES; i++)
+	{
+		for(k = 0; k < 4u; k++)
+		{
+			dwLen = ServePage(i, k & 1, k >> 1, vResponse);
+			if(!CheckResponse(i, k & 1, k >> 1, vResponse, dwLen))
+			{
+				printf("wrong response for %s %s gzip on a %s connection\n", Pages[i].sName, (k & 1) ? "with" : "without",
+					(k >> 1) ? "persistent" : "closed");
+				return 1;
+			}
+		}
+	}
+	printf("Response bodies match the page, decompressed unless the client accepts gzip\n");
+	printf("Window %u bytes, page %u bytes\n", HTTP_INFLATE_WINDOW, BENCH_PAGE_LEN);
+
+	for(i = 0; i < BENCH_PAGES; i++)
+	{
+		dwPageLen = (i == BENCH_PAGES - 1u) ? BENCH_SMALL_LEN : BENCH_PAGE_LEN;
+		dwPages = BENCH_BYTES / dwPageLen;
+		for(k = 0; k < 2u; k++)
+		{
+			dPages[k] = 0;
+			dCPUus[k] = 1e30;
+			for(r = 0; r < BENCH_ROUNDS; r++)
+			{
+				dStart = NowNs(CLOCK_MONOTONIC);
+				dCPU = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+				for(j = 0; j < dwPages / BENCH_ROUNDS; j++)
+					ServePage(i, !k, FALSE, NULL);
+				dCPU = (NowNs(CLOCK_PROCESS_CPUTIME_ID) - dCPU) / (dwPages / BENCH_ROUNDS) / 1000.0;
+				if(dCPU < dCPUus[k])
+				{
+					dCPUus[k] = dCPU;
+					dPages[k] = (dwPages / BENCH_ROUNDS) * 1e9 / (NowNs(CLOCK_MONOTONIC) - dStart);
+				}
+			}
+		}
+		printf("%-9s %5lu + %3lu index bytes (%5.1f%%): gzip client %7.0f pages/s %7.2f us/page   other client %7.0f pages/s %7.2f us/page\n",
+			Pages[i].sName, (unsigned long)dwStoredLen[i], (unsigned long)dwIndexLen[i],
+			100.0 * (dwStoredLen[i] + dwIndexLen[i]) / dwPageLen, dPages[0], dCPUus[0], dPages[1], dCPUus[1]);
+	}
+
+	for(i = 0; i < BENCH_PAGES; i++)
+	{
+		if(Pages[i].wBlockLen == 0u)
+			continue;
+		dBest = 1e30;
+		for(r = 0; r < BENCH_ROUNDS; r++)
+		{
+			dCPU = TimeSeeks(i);
+			if(dCPU < dBest)
+				dBest = dCPU;
+		}
+		printf("%-9s random 100 byte read: %6.2f us\n", Pages[i].sName, dBest);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static void MakePage(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills vPage[].
+ *
+ * Overview:        Writes an HTML table of random rows, which
+ *                  compresses about as well as the pages of the demo
+ *                  application.
+ *
+ * Note:            None
+ ********************************************************************/
+static void MakePage(void)
+{
+	static const char* sWords[] = {"Board", "status", "LED", "button", "network", "address", "gateway", "subnet",
+		"mask", "DHCP", "enabled", "disabled", "uptime", "version", "firmware", "upload", "config", "Microchip",
+		"TCP/IP", "stack", "socket", "server", "client", "port", "host", "name", "primary", "secondary", "DNS"};
+	char sRow[256];
+	DWORD dwLen;
+	WORD wLen;
+	BYTE k;
+	char* p;
+
+	for(dwLen = 0; dwLen < BENCH_PAGE_LEN; dwLen += wLen)
+	{
+		p = sRow + sprintf(sRow, "<tr><td class=\"label\">");
+		for(k = 1 + LFSRRand() % 4u; k; k--)
+			p += sprintf(p, "%s ", sWords[LFSRRand() % (sizeof(sWords)/sizeof(sWords[0]))]);
+		p += sprintf(p, "</td><td class=\"value\" id=\"v%u\">%u.%u.%u.%u</td></tr>\n", LFSRRand() % 1000u,
+			LFSRRand() % 256u, LFSRRand() % 256u, LFSRRand() % 256u, LFSRRand() % 256u);
+		wLen = p - sRow;
+		if(wLen > BENCH_PAGE_LEN - dwLen)
+			wLen = BENCH_PAGE_LEN - dwLen;
+		memcpy((void*)&vPage[dwLen], (void*)sRow, wLen);
+	}
+}
+
+/*********************************************************************
+ * Function:        static void BuildImage(void)
+ *
+ * PreCondition:    MakePage() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills MPFS_Start[], vStored[], dwStoredLen[],
+ *                  dwIndexLen[] and wFileID[].
+ *
+ * Overview:        Writes an MPFS2.1 image of Pages[], each blk<n>
+ *                  page followed by its index.
+ *
+ * Note:            small.htm is the start of the page.
+ ********************************************************************/
+static void BuildImage(void)
+{
+	static BYTE vIndex[4 + 4*(BENCH_PAGE_LEN/1024u + 1u)];
+	BYTE i, vFile;
+
+	memcpy((void*)MPFS_Start, (void*)"MPFS\x02\x01", 6);
+	MPFS_Start[6] = BENCH_FILES;
+	MPFS_Start[7] = 0;
+
+	for(i = 0, vFile = 0; i < BENCH_PAGES; i++)
+	{
+		wFileID[i] = vFile;
+		if(!Pages[i].bZipped)
+		{
+			memcpy((void*)vStored[i], (void*)vPage, BENCH_PAGE_LEN);
+			dwStoredLen[i] = BENCH_PAGE_LEN;
+			AddFile(vFile++, Pages[i].sName, vStored[i], dwStoredLen[i], 0);
+			continue;
+		}
+
+		dwStoredLen[i] = Compress(vStored[i], vIndex, vPage, (i == BENCH_PAGES - 1u) ? BENCH_SMALL_LEN : BENCH_PAGE_LEN, Pages[i].wBlockLen);
+		if(Pages[i].wBlockLen == 0u)
+		{
+			AddFile(vFile++, Pages[i].sName, vStored[i], dwStoredLen[i], MPFS2_FLAG_ISZIPPED);
+			continue;
+		}
+		dwIndexLen[i] = 4 + 4*((BENCH_PAGE_LEN + Pages[i].wBlockLen - 1)/Pages[i].wBlockLen);
+		AddFile(vFile++, Pages[i].sName, vStored[i], dwStoredLen[i], MPFS2_FLAG_ISZIPPED | MPFS2_FLAG_HASBLOCKS);
+		AddFile(vFile++, "", vIndex, dwIndexLen[i], 0);
+	}
+}
+
+/*********************************************************************
+ * Function:        static DWORD Compress(BYTE* pOut, BYTE* pIndex,
+ *                                        const BYTE* pData,
+ *                                        DWORD dwLen, WORD wBlockLen)
+ *
+ * PreCondition:    None
+ *
+ * Input:           pOut - where to write the GZIP file
+ *                  pIndex - where to write the block index, if
+ *                           wBlockLen is not 0
+ *                  pData - data to compress
+ *                  dwLen - length of pData
+ *                  wBlockLen - uncompressed length of each block, or 0
+ *                              for one deflate stream
+ *
+ * Output:          Length of the GZIP file
+ *
+ * Side Effects:    Exits if zlib fails.
+ *
+ * Overview:        Compresses pData at level 9 into a GZIP file, with a
+ *                  full flush after each block, and records the offset
+ *                  in the file at which each block starts.
+ *
+ * Note:            The layout of the index is described in MPFS2.c.
+ ********************************************************************/
+static DWORD Compress(BYTE* pOut, BYTE* pIndex, const BYTE* pData, DWORD dwLen, WORD wBlockLen)
+{
+	static const BYTE vHeader[10] = {0x1f, 0x8b, 0x08, 0, 0, 0, 0, 0, 0x02, 0x03};
+	z_stream z;
+	DWORD dwPos, dwChunk, dwCRC, dwOffset;
+	WORD wBlock;
+
+	memset((void*)&z, 0x00, sizeof(z));
+	if(deflateInit2(&z, 9, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		printf("deflateInit2 failed\n");
+		exit(1);
+	}
+	memcpy((void*)pOut, (void*)vHeader, 10);
+	z.next_out = pOut + 10;
+	z.avail_out = BENCH_MAX_FILE - 18;
+
+	if(wBlockLen)
+	{
+		dwChunk = wBlockLen;
+		memcpy((void*)pIndex, (void*)&dwChunk, 4);
+	}
+	else
+		dwChunk = dwLen;
+	for(dwPos = 0, wBlock = 0; dwPos < dwLen; dwPos += dwChunk, wBlock++)
+	{
+		if(wBlockLen)
+		{
+			dwOffset = 10 + z.total_out;
+			memcpy((void*)&pIndex[4 + 4*wBlock], (void*)&dwOffset, 4);
+		}
+		z.next_in = (Bytef*)&pData[dwPos];
+		z.avail_in = (dwLen - dwPos < dwChunk) ? dwLen - dwPos : dwChunk;
+		if(deflate(&z, (dwPos + dwChunk >= dwLen) ? Z_FINISH : Z_FULL_FLUSH) == Z_STREAM_ERROR || z.avail_in != 0u)
+		{
+			printf("deflate failed\n");
+			exit(1);
+		}
+	}
+	dwPos = 10 + z.total_out;
+	deflateEnd(&z);
+
+	dwCRC = crc32(0, pData, dwLen);
+	memcpy((void*)&pOut[dwPos], (void*)&dwCRC, 4);
+	memcpy((void*)&pOut[dwPos + 4], (void*)&dwLen, 4);
+	return dwPos + 8;
+}
+
+/*********************************************************************
+ * Function:        static void AddFile(BYTE vFile, const char* sName,
+ *                                      BYTE* pData, DWORD dwLen,
+ *                                      WORD wFlags)
+ *
+ * PreCondition:    Files 0 to vFile-1 have been added.
+ *
+ * Input:           vFile - index of the file in the image
+ *                  sName - file name, up to 15 characters
+ *                  pData - file data
+ *                  dwLen - number of bytes of data
+ *                  wFlags - MPFS2_FLAG_* flags of the file
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes the name hash, FAT record, name and data of
+ *                  a file in MPFS_Start[].
+ *
+ * Note:            As in HTTPBench.c.
+ ********************************************************************/
+static void AddFile(BYTE vFile, const char* sName, BYTE* pData, DWORD dwLen, WORD wFlags)
+{
+	static DWORD dwData = 8 + BENCH_FILES*(2 + BENCH_FAT_RECORD + 16);
+	BYTE* pFAT;
+	DWORD dwString;
+	WORD wHash;
+	const char* p;
+
+	for(wHash = 0, p = sName; *p; p++)
+	{
+		wHash += (BYTE)*p;
+		wHash <<= 1;
+	}
+	if(*sName == '\0')
+		wHash = 0xffff;
+	MPFS_Start[8 + 2*vFile] = (BYTE)wHash;
+	MPFS_Start[8 + 2*vFile + 1] = (BYTE)(wHash >> 8);
+
+	dwString = 8 + BENCH_FILES*(2 + BENCH_FAT_RECORD) + vFile*16;
+	strcpy((char*)&MPFS_Start[dwString], sName);
+	memcpy((void*)&MPFS_Start[dwData], (void*)pData, dwLen);
+
+	pFAT = &MPFS_Start[8 + 2*BENCH_FILES + vFile*BENCH_FAT_RECORD];
+	memset((void*)pFAT, 0x00, BENCH_FAT_RECORD);
+	memcpy((void*)&pFAT[0], (void*)&dwString, 4);
+	memcpy((void*)&pFAT[4], (void*)&dwData, 4);
+	memcpy((void*)&pFAT[8], (void*)&dwLen, 4);
+	memcpy((void*)&pFAT[20], (void*)&wFlags, 2);
+	dwData += dwLen;
+}
+
+/*********************************************************************
+ * Function:        static DWORD ServePage(BYTE vPageID, BOOL bGzip,
+ *                                         BOOL bKeepAlive,
+ *                                         BYTE* pResponse)
+ *
+ * PreCondition:    HTTPInit() has been called.
+ *
+ * Input:           vPageID - index of the page in Pages[]
+ *                  bGzip - TRUE if the client accepts gzip
+ *                  bKeepAlive - TRUE for a persistent connection
+ *                  pResponse - where to copy the response, or NULL
+ *
+ * Output:          Length of the response
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Serves a GET request for the page with
+ *                  ServeRequest().
+ *
+ * Note:            None
+ ********************************************************************/
+static DWORD ServePage(BYTE vPageID, BOOL bGzip, BOOL bKeepAlive, BYTE* pResponse)
+{
+	char sRequest[160];
+
+	sprintf(sRequest, "GET /%s HTTP/1.1\r\nHost: 192.168.1.2\r\n%s%s\r\n", Pages[vPageID].sName,
+		bGzip ? "Accept-Encoding: gzip, deflate\r\n" : "", bKeepAlive ? "" : "Connection: close\r\n");
+	return ServeRequest(sRequest, pResponse);
+}
+
+/*********************************************************************
+ * Function:        static BOOL CheckResponse(BYTE vPageID, BOOL bGzip,
+ *                                            BOOL bKeepAlive,
+ *                                            BYTE* pResponse,
+ *                                            DWORD dwLen)
+ *
+ * PreCondition:    BuildImage() has been called.
+ *
+ * Input:           vPageID - index of the page in Pages[]
+ *                  bGzip - TRUE if the client accepted gzip
+ *                  bKeepAlive - TRUE for a persistent connection
+ *                  pResponse - the response
+ *                  dwLen - length of the response
+ *
+ * Output:          TRUE if the body and its headers are as expected
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The body must be the stored file, with a
+ *                  "Content-Encoding: gzip" header, if the client
+ *                  accepted gzip or the page is "gzip.htm", and the
+ *                  page otherwise.  A persistent connection must give
+ *                  the length of the body.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL CheckResponse(BYTE vPageID, BOOL bGzip, BOOL bKeepAlive, BYTE* pResponse, DWORD dwLen)
+{
+	const BYTE* pExpected;
+	DWORD i, dwExpected;
+	BOOL bEncoded;
+	char sLength[32];
+
+	for(i = 0; i + 4 <= dwLen; i++)
+	{
+		if(memcmp((void*)&pResponse[i], (void*)"\r\n\r\n", 4) == 0)
+			break;
+	}
+	if(i + 4 > dwLen)
+		return FALSE;
+	pResponse[i + 2] = '\0';
+
+	bEncoded = Pages[vPageID].bZipped && (bGzip || (Pages[vPageID].wBlockLen == 0u && vPageID != BENCH_PAGES - 1u));
+	if(bEncoded)
+	{
+		pExpected = vStored[vPageID];
+		dwExpected = dwStoredLen[vPageID];
+	}
+	else
+	{
+		pExpected = vPage;
+		dwExpected = (vPageID == BENCH_PAGES - 1u) ? BENCH_SMALL_LEN : BENCH_PAGE_LEN;
+	}
+	if(bEncoded != (strstr((char*)pResponse, "Content-Encoding: gzip") != NULL))
+		return FALSE;
+	sprintf(sLength, "Content-Length: %lu\r\n", (unsigned long)dwExpected);
+	if(bKeepAlive && strstr((char*)pResponse, sLength) == NULL)
+		return FALSE;
+
+	i += 4;
+	return dwLen - i == dwExpected && memcmp((void*)&pResponse[i], (void*)pExpected, dwExpected) == 0;
+}
+
+/*********************************************************************
+ * Function:        static double TimeSeeks(BYTE vPageID)
+ *
+ * PreCondition:    MPFSInit() has been called.
+ *
+ * Input:           vPageID - index of a blk<n> page in Pages[]
+ *
+ * Output:          Time per read in us
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads 100 bytes at BENCH_SEEKS random positions of
+ *                  the page as HTTPSendInflated() does when it resumes
+ *                  a response: the index gives the block, which is
+ *                  decompressed from its start.  The first read is
+ *                  checked.
+ *
+ * Note:            None
+ ********************************************************************/
+static double TimeSeeks(BYTE vPageID)
+{
+	static BYTE vWindow[HTTP_INFLATE_WINDOW];
+	INFLATE_CTX ctx;
+	BYTE vData[100];
+	MPFS_HANDLE hFile, hIndex;
+	DWORD j, dwPos, dwBlockLen, dwOffset;
+	double dCPU;
+
+	hFile = MPFSOpenID(wFileID[vPageID]);
+	hIndex = MPFSOpenID(wFileID[vPageID] + 1);
+	dCPU = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+	for(j = 0; j < BENCH_SEEKS; j++)
+	{
+		dwPos = ((DWORD)LFSRRand() << 16 | LFSRRand()) % (BENCH_PAGE_LEN - sizeof(vData));
+		MPFSSeek(hIndex, 0, MPFS_SEEK_START);
+		MPFSGetLong(hIndex, &dwBlockLen);
+		MPFSSeek(hIndex, 4*(dwPos / dwBlockLen), MPFS_SEEK_FORWARD);
+		MPFSGetLong(hIndex, &dwOffset);
+		MPFSSeek(hFile, dwOffset, MPFS_SEEK_START);
+		InflateInit(&ctx, hFile, vWindow, sizeof(vWindow));
+		InflateGetArray(&ctx, NULL, dwPos % dwBlockLen);
+		InflateGetArray(&ctx, vData, sizeof(vData));
+		if(j == 0u && memcmp((void*)vData, (void*)&vPage[dwPos], sizeof(vData)) != 0)
+		{
+			printf("wrong data at %lu of %s\n", (unsigned long)dwPos, Pages[vPageID].sName);
+			exit(1);
+		}
+	}
+	dCPU = (NowNs(CLOCK_PROCESS_CPUTIME_ID) - dCPU) / BENCH_SEEKS / 1000.0;
+	MPFSClose(hIndex);
+	MPFSClose(hFile);
+	return dCPU;
+}
+
+/*********************************************************************
+ * Function:        static DWORD ServeRequest(const char* sRequest,
+ *                                            BYTE* pResponse)
+ *
+ * PreCondition:    HTTPInit() has been called.
+ *
+ * Input:           sRequest - the request
+ *                  pResponse - where to copy the response, or NULL
+ *
+ * Output:          Length of the response
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Connects an HTTP socket and calls HTTPServer() until
+ *                  the socket is disconnected or awaits the next
+ *                  request.
+ *
+ * Note:            As in HTTPBench.c.
+ ********************************************************************/
+static DWORD ServeRequest(const char* sRequest, BYTE* pResponse)
+{
+	TCP_SOCKET hTCP;
+	PTR_BASE ptr;
+	const char* p;
+	DWORD dwLen;
+	WORD wFree;
+	BYTE vConn;
+
+	hTCP = ConnectSocket();
+	for(vConn = 0; httpStubs[vConn].socket != hTCP; vConn++);
+
+	p = sRequest;
+	dwLen = 0;
+	do
+	{
+		// Receive as much of the request as fits in the RX FIFO
+		wFree = TCPGetRxFIFOFree(hTCP);
+		for(ptr = MyTCBStub.rxHead; *p && wFree; p++, wFree--)
+		{
+			*(BYTE*)ptr = *p;
+			if(++ptr > MyTCBStub.bufferEnd)
+				ptr = MyTCBStub.bufferRxStart;
+		}
+		MyTCBStub.rxHead = ptr;
+
+		HTTPServer();
+		dwLen += SendAll(hTCP, pResponse ? pResponse + dwLen : NULL);
+	} while(MyTCBStub.smState == TCP_ESTABLISHED && httpStubs[vConn].sm != SM_HTTP_WAIT_REQUEST);
+
+	// Listen again, and let HTTPServer() see the reset and give the
+	// socket its RX FIFO back
+	CloseSocket();
+	HTTPServer();
+	return dwLen;
+}
+
+/*********************************************************************
+ * Function:        static TCP_SOCKET ConnectSocket(void)
+ *
+ * PreCondition:    HTTPInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          The connected socket
+ *
+ * Side Effects:    Exits if no HTTP socket is listening.
+ *
+ * Overview:        Connects a listening HTTP socket by passing a SYN to
+ *                  FindMatchingSocket().
+ *
+ * Note:            As in HTTPBench.c.
+ ********************************************************************/
+static TCP_SOCKET ConnectSocket(void)
+{
+	TCP_HEADER header;
+	NODE_INFO remote;
+
+	remote.IPAddr.Val = 0x0101A8C0ul;			// 192.168.1.1
+	memset((void*)&remote.MACAddr, 0x02, sizeof(MAC_ADDR));
+	memset((void*)&header, 0x00, sizeof(header));
+	header.SourcePort = BENCH_REMOTE_PORT;
+	header.DestPort = BENCH_LOCAL_PORT;
+	header.Flags.bits.flagSYN = 1;
+
+	if(!FindMatchingSocket(&header, &remote))
+	{
+		printf("cannot connect an HTTP socket\n");
+		exit(1);
+	}
+
+	SyncTCB();
+	MyTCBStub.smState = TCP_ESTABLISHED;
+	MyTCB.wRemoteMSS = TCP_MAX_SEG_SIZE_TX - 12u;
+	MyTCB.flags.bTimestamps = 1;
+	MyTCB.flags.bSACK = 1;
+	return hCurrentTCP;
+}
+
+/*********************************************************************
+ * Function:        static DWORD SendAll(TCP_SOCKET hSocket,
+ *                                       BYTE* pResponse)
+ *
+ * PreCondition:    ConnectSocket() has returned hSocket.
+ *
+ * Input:           hSocket - socket to send on
+ *                  pResponse - where to copy the TX FIFO, or NULL
+ *
+ * Output:          Number of bytes in the TX FIFO
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies the unacknowledged bytes of the TX FIFO to
+ *                  pResponse, sends them with SendTCP() while the socket
+ *                  is connected and then acknowledges all of them.
+ *
+ * Note:            As in HTTPBench.c.
+ ********************************************************************/
+static DWORD SendAll(TCP_SOCKET hSocket, BYTE* pResponse)
+{
+	PTR_BASE ptr;
+	DWORD dwLen;
+
+	SyncTCBStub(hSocket);
+	SyncTCB();
+	if(MyTCBStub.txHead >= MyTCBStub.txTail)
+		dwLen = MyTCBStub.txHead - MyTCBStub.txTail;
+	else
+		dwLen = (MyTCBStub.bufferRxStart - MyTCBStub.txTail) + (MyTCBStub.txHead - MyTCBStub.bufferTxStart);
+	if(pResponse)
+	{
+		for(ptr = MyTCBStub.txTail; ptr != MyTCBStub.txHead; pResponse++)
+		{
+			*pResponse = *(BYTE*)ptr;
+			if(++ptr >= MyTCBStub.bufferRxStart)
+				ptr = MyTCBStub.bufferTxStart;
+		}
+	}
+
+	if(MyTCBStub.smState == TCP_ESTABLISHED)
+	{
+		MyTCB.remoteWindow = 0xFFFF;
+		MyTCB.wCongWindow = 0xFFFF;
+		while(MyTCB.txUnackedTail != MyTCBStub.txHead)
+			SendTCP(ACK, SENDTCP_RESET_TIMERS);
+	}
+
+	MyTCBStub.txTail = MyTCBStub.txHead;
+	MyTCB.txUnackedTail = MyTCBStub.txHead;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	MyTCBStub.Flags.bTimer2Enabled = 0;
+	MyTCBStub.Flags.bHalfFullFlush = 0;
+	return dwLen;
+}
+
+// HTTP2 application callbacks: every page is public and has no
+// GET or POST processing or dynamic variables
+HTTP_IO_RESULT HTTPExecuteGet(void)
+{
+	return HTTP_IO_DONE;
+}
+
+HTTP_IO_RESULT HTTPExecutePost(void)
+{
+	return HTTP_IO_DONE;
+}
+
+BYTE HTTPNeedsAuth(BYTE* cFile)
+{
+	return 0x80;
+}
+
+BYTE HTTPCheckAuth(BYTE* cUser, BYTE* cPass)
+{
+	return 0x80;
+}
+
+void HTTPPrint_version(void)
+{
+}
+
+void HTTPPrint_builddate(void)
+{
+}
+
+void HTTPPrint_uptime(void)
+{
+}
+
+void HTTPPrint_led(WORD num)
+{
+}
@@ -0,0 +1,577 @@
+/*********************************************************************
+ *
+ *  HTTP requests per second with 1 to 50 concurrent clients
+ *
+ *********************************************************************
+ * FileName:        LoadBench.c
+ * Dependencies:    StackTsk.c, HTTP2.c, MPFS2.c, HTTPPrint.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Reports how many requests per second the HTTP2 server answers for
+ * LOAD_BENCH_CLIENTS concurrent clients, on a static page with a
+ * Content-Length and on a dynamic page, in three ways:
+ *   close       "Connection: close", one connection per request.  The
+ *               dynamic page ends when the server closes.
+ *   keep-alive  one persistent connection per client, the next request
+ *               is sent when the response is complete.  The dynamic page
+ *               is sent with chunked transfer encoding.
+ *   pipelined   as keep-alive, with LOAD_BENCH_DEPTH requests in flight
+ *               on each connection.
+ * Without HTTP_USE_KEEPALIVE the server closes every connection after
+ * the first response, so the last two modes report only the connections
+ * that were answered.  The requests pipelined behind the first one are
+ * dropped, and the socket stays in FIN_WAIT_2 until
+ * TCP_FIN_WAIT_2_TIMEOUT.
+ *
+ * The stack serves the pages from an MPFS2 image built in MPFS_Start[]
+ * at startup, with the socket table of HOST_LOAD_BENCH in
+ * TCPIPConfig.h.  The clients are Linux sockets of this program on the
+ * other side of the TAP, polled between calls to StackTask() and
+ * HTTPServer().  They request the two pages in turn and check
+ * the length of each body.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_LOAD_BENCH -I. -I$S -I$S/Include -o loadbench \
+ *       LoadBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers}.c \
+ *       "$S/TCPIP Stack/"{ARP,IP,ICMP,UDP,TCP,MPFS2,Inflate,HTTP2}.c \
+ *       "$S/TCPIP Stack/"{TCPPerformanceTest,UDPPerformanceTest}.c
+ *   HOST_MAC_TAP=tap0 ./loadbench
+ ********************************************************************/
+
+#define _GNU_SOURCE		// memmem()
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define LOAD_BENCH_CLIENTS		(50u)					// Most concurrent clients
+#define LOAD_BENCH_DEPTH		(4u)					// Requests in flight when pipelined
+#define LOAD_BENCH_PORT			(80u)
+#define LOAD_BENCH_TIME			((DWORD)TICK_SECOND*2)	// Duration of each measurement
+#define LOAD_BENCH_MODES		(3u)					// close, keep-alive and pipelined
+#define LOAD_BENCH_FAT_RECORD	(22u)					// Size of an MPFS2 FAT record
+#define LOAD_BENCH_FILES		(3u)					// Static page, dynamic page and its index
+#define LOAD_BENCH_VARS			(16u)					// Variables of the dynamic page
+#define LOAD_BENCH_MAX_PAGE		(4096u)					// Largest page or response
+
+// Dynamic variables, in the order of their callback IDs in HTTPPrint.h,
+// and the text HTTPPrint() writes for them
+static const char* sVarNames[] = {"~version~", "~builddate~", "~uptime~", "~led(0)~", "~led(1)~"};
+static const char* sVarValues[] = {"5.42", "Oct 18 2026 12:00:00", "1234567", "0", "1"};
+#define LOAD_BENCH_VAR_NAMES	(sizeof(sVarNames)/sizeof(sVarNames[0]))
+
+// Requests of the two pages
+static const char* sPages[2] = {"/static.htm", "/dynamic.htm"};
+
+// MPFS2 reads the image from here.  MPFS2.c declares it ROM, but it is
+// written once before MPFSInit().
+BYTE MPFS_Start[16ul*1024ul];
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// Body lengths of the two pages
+static DWORD dwBodyLen[2];
+
+// One client connection
+typedef struct
+{
+	int fd;						// Linux socket, or -1
+	WORD wSent;					// Requests sent on this connection
+	WORD wDone;					// Responses received on this connection
+	DWORD dwRxLen;				// Bytes in vRx
+	BYTE vRx[2*LOAD_BENCH_MAX_PAGE];
+} LOAD_CLIENT;
+
+static LOAD_CLIENT Clients[LOAD_BENCH_CLIENTS];
+
+// Private helper functions.
+static void BuildImage(void);
+static void AddFile(BYTE vFile, const char* sName, BYTE* pData, DWORD dwLen, WORD wFlags);
+static DWORD RunClients(BYTE vClients, BYTE vMode, DWORD* pdwErrors);
+static BOOL OpenClient(LOAD_CLIENT* c);
+static void CloseClient(LOAD_CLIENT* c);
+static BOOL SendRequests(LOAD_CLIENT* c, BYTE vMode);
+static long ParseResponse(BYTE* pData, DWORD dwLen, BOOL bClosed, DWORD* pdwBody);
+
+int main(void)
+{
+	static const BYTE vClients[] = {1, 2, 5, 10, 20, 50};
+	static const char* sMode[LOAD_BENCH_MODES] = {"close", "keep-alive", "pipelined"};
+	DWORD dwRequests[LOAD_BENCH_MODES], dwErrors;
+	BYTE i, k;
+
+	TickInit();
+	InitAppConfig();
+	BuildImage();
+	MPFSInit();
+	StackInit();
+
+	while(!MACIsLinked())
+		StackTask();
+
+	#if defined(HTTP_USE_KEEPALIVE)
+	printf("HTTP_USE_KEEPALIVE, %u HTTP connections, %lu+%lu byte pages\n", (unsigned)MAX_HTTP_CONNECTIONS, (unsigned long)dwBodyLen[0], (unsigned long)dwBodyLen[1]);
+	#else
+	printf("No HTTP_USE_KEEPALIVE, %u HTTP connections, %lu+%lu byte pages\n", (unsigned)MAX_HTTP_CONNECTIONS, (unsigned long)dwBodyLen[0], (unsigned long)dwBodyLen[1]);
+	#endif
+	for(i = 0; i < sizeof(vClients); i++)
+	{
+		printf("%2u clients: ", vClients[i]);
+		dwErrors = 0;
+		for(k = 0; k < LOAD_BENCH_MODES; k++)
+		{
+			dwRequests[k] = RunClients(vClients[i], k, &dwErrors);
+			printf("%s %6.0f req/s   ", sMode[k], dwRequests[k] * (double)TICK_SECOND / LOAD_BENCH_TIME);
+		}
+		printf("%4.2fx %4.2fx", (double)dwRequests[1] / dwRequests[0], (double)dwRequests[2] / dwRequests[0]);
+		if(dwErrors)
+			printf("   %lu wrong responses", (unsigned long)dwErrors);
+		printf("\n");
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static DWORD RunClients(BYTE vClients, BYTE vMode,
+ *                                          DWORD* pdwErrors)
+ *
+ * PreCondition:    StackInit() has been called and the link is up.
+ *
+ * Input:           vClients - number of concurrent clients
+ *                  vMode - 0 for close, 1 for keep-alive, 2 for
+ *                          pipelined
+ *                  pdwErrors - incremented for each response with a
+ *                              body of the wrong length
+ *
+ * Output:          Number of responses received in LOAD_BENCH_TIME
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Runs the stack and the clients for LOAD_BENCH_TIME,
+ *                  then closes the clients and runs the stack until
+ *                  every HTTP connection is idle again.
+ *
+ * Note:            A client reconnects when its connection is closed.
+ ********************************************************************/
+static DWORD RunClients(BYTE vClients, BYTE vMode, DWORD* pdwErrors)
+{
+	struct pollfd pfd;
+	LOAD_CLIENT* c;
+	DWORD dwStart, dwResponses, dwBody;
+	long lUsed;
+	BYTE i;
+	int n;
+
+	for(i = 0; i < vClients; i++)
+		Clients[i].fd = -1;
+
+	dwResponses = 0;
+	dwStart = TickGet();
+	while(TickGet() - dwStart < LOAD_BENCH_TIME)
+	{
+		StackTask();
+		HTTPServer();
+
+		for(i = 0; i < vClients; i++)
+		{
+			c = &Clients[i];
+			if(c->fd < 0 && !OpenClient(c))
+				continue;
+
+			pfd.fd = c->fd;
+			pfd.events = c->wSent == c->wDone ? POLLOUT : POLLIN;
+			if(poll(&pfd, 1, 0) <= 0)
+				continue;
+			if(c->wSent == c->wDone)
+			{
+				if(!SendRequests(c, vMode))
+					CloseClient(c);
+				continue;
+			}
+
+			n = recv(c->fd, &c->vRx[c->dwRxLen], sizeof(c->vRx) - c->dwRxLen, 0);
+			if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				continue;
+			if(n > 0)
+				c->dwRxLen += n;
+
+			// Take the complete responses
+			while(c->wDone != c->wSent)
+			{
+				lUsed = ParseResponse(c->vRx, c->dwRxLen, n <= 0, &dwBody);
+				if(lUsed <= 0)
+					break;
+				if(dwBody != dwBodyLen[c->wDone & 1u])
+					(*pdwErrors)++;
+				dwResponses++;
+				c->wDone++;
+				c->dwRxLen -= lUsed;
+				memmove((void*)c->vRx, (void*)&c->vRx[lUsed], c->dwRxLen);
+
+				// Keep the pipeline full
+				if(vMode == 2u && n > 0 && !SendRequests(c, vMode))
+					n = 0;
+			}
+
+			if(n <= 0 || c->dwRxLen == sizeof(c->vRx) || (vMode == 0u && c->wDone == c->wSent))
+				CloseClient(c);
+		}
+	}
+
+	for(i = 0; i < vClients; i++)
+		CloseClient(&Clients[i]);
+	for(dwStart = TickGet(); TickGet() - dwStart < TICK_SECOND/4; )
+	{
+		StackTask();
+		HTTPServer();
+	}
+	return dwResponses;
+}
+
+/*********************************************************************
+ * Function:        static BOOL OpenClient(LOAD_CLIENT* c)
+ *
+ * PreCondition:    c->fd is -1.
+ *
+ * Input:           c - client to connect
+ *
+ * Output:          TRUE if the connection was started
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Starts a non-blocking connection to port 80 of the
+ *                  stack.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL OpenClient(LOAD_CLIENT* c)
+{
+	struct sockaddr_in addr;
+
+	memset((void*)&addr, 0x00, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(LOAD_BENCH_PORT);
+	addr.sin_addr.s_addr = AppConfig.MyIPAddr.Val;
+
+	c->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(c->fd < 0)
+		return FALSE;
+	if(fcntl(c->fd, F_SETFL, O_NONBLOCK) < 0
+		|| (connect(c->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS))
+	{
+		CloseClient(c);
+		return FALSE;
+	}
+	c->wSent = 0;
+	c->wDone = 0;
+	c->dwRxLen = 0;
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static void CloseClient(LOAD_CLIENT* c)
+ *
+ * PreCondition:    None
+ *
+ * Input:           c - client to close
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Closes the connection of the client, if any.
+ *
+ * Note:            Responses still in flight are dropped.
+ ********************************************************************/
+static void CloseClient(LOAD_CLIENT* c)
+{
+	if(c->fd >= 0)
+		close(c->fd);
+	c->fd = -1;
+}
+
+/*********************************************************************
+ * Function:        static BOOL SendRequests(LOAD_CLIENT* c, BYTE vMode)
+ *
+ * PreCondition:    The connection of c is writable.
+ *
+ * Input:           c - client to send on
+ *                  vMode - 0 for close, 1 for keep-alive, 2 for
+ *                          pipelined
+ *
+ * Output:          FALSE if the connection failed
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sends requests until LOAD_BENCH_DEPTH are in flight
+ *                  when pipelined, or one otherwise.  In close mode a
+ *                  connection carries a single request.
+ *
+ * Note:            The requests are short enough to be sent whole.
+ ********************************************************************/
+static BOOL SendRequests(LOAD_CLIENT* c, BYTE vMode)
+{
+	char sRequest[96];
+	int n;
+
+	if(vMode == 0u && c->wSent != 0u)
+		return TRUE;
+
+	while(c->wSent - c->wDone < (vMode == 2u ? LOAD_BENCH_DEPTH : 1u))
+	{
+		n = sprintf(sRequest, "GET %s HTTP/1.1\r\nHost: 192.168.1.2\r\n%s\r\n", sPages[c->wSent & 1u],
+			vMode == 0u ? "Connection: close\r\n" : "");
+		if(send(c->fd, sRequest, n, MSG_NOSIGNAL) != n)
+			return FALSE;
+		c->wSent++;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static long ParseResponse(BYTE* pData, DWORD dwLen,
+ *                                            BOOL bClosed,
+ *                                            DWORD* pdwBody)
+ *
+ * PreCondition:    None
+ *
+ * Input:           pData - received bytes, starting with a response
+ *                  dwLen - number of bytes in pData
+ *                  bClosed - TRUE if the server closed the connection
+ *                  pdwBody - where to store the body length
+ *
+ * Output:          Length of the response if it is complete, 0 if
+ *                  more bytes are needed, or -1 if it is malformed
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Finds the end of the headers and the end of the
+ *                  body from Content-Length, from the chunks of a
+ *                  chunked body, or from the end of the connection.
+ *
+ * Note:            Header names are matched as the HTTP2 server
+ *                  writes them.
+ ********************************************************************/
+static long ParseResponse(BYTE* pData, DWORD dwLen, BOOL bClosed, DWORD* pdwBody)
+{
+	DWORD i, dwHeaders, dwChunk;
+	BYTE* p;
+	char* pEnd;
+
+	// Find the end of the headers
+	for(i = 0; i + 4 <= dwLen; i++)
+	{
+		if(memcmp((void*)&pData[i], (void*)"\r\n\r\n", 4) == 0)
+			break;
+	}
+	if(i + 4 > dwLen)
+		return bClosed ? -1 : 0;
+	dwHeaders = i + 4;
+
+	p = (BYTE*)memmem(pData, dwHeaders, "Content-Length: ", 16);
+	if(p)
+	{
+		*pdwBody = strtoul((char*)p + 16, NULL, 10);
+		if(dwLen - dwHeaders < *pdwBody)
+			return bClosed ? -1 : 0;
+		return dwHeaders + *pdwBody;
+	}
+
+	if(!memmem(pData, dwHeaders, "Transfer-Encoding: chunked", 26))
+	{
+		if(!bClosed)
+			return 0;
+		*pdwBody = dwLen - dwHeaders;
+		return dwLen;
+	}
+
+	// Size in hex, CRLF, data, CRLF; the last chunk is empty and
+	// followed by a CRLF
+	*pdwBody = 0;
+	for(i = dwHeaders; ; )
+	{
+		p = (BYTE*)memchr(&pData[i], '\n', dwLen - i);
+		if(!p)
+			return bClosed ? -1 : 0;
+		dwChunk = strtoul((char*)&pData[i], &pEnd, 16);
+		if((BYTE*)pEnd + 1 != p)
+			return -1;
+		i = p + 1 - pData;
+		if(dwLen - i < dwChunk + 2)
+			return bClosed ? -1 : 0;
+		i += dwChunk + 2;
+		*pdwBody += dwChunk;
+		if(dwChunk == 0u)
+			return i;
+	}
+}
+
+/*********************************************************************
+ * Function:        static void BuildImage(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills MPFS_Start[] and dwBodyLen[].
+ *
+ * Overview:        Writes an MPFS2.1 image with "static.htm", a page
+ *                  without variables, and "dynamic.htm", a page with
+ *                  LOAD_BENCH_VARS variables followed by its index.
+ *
+ * Note:            As in HTTPBench.c.  The index has the variable
+ *                  lengths (MPFS2_FLAG_HASVARLEN).
+ ********************************************************************/
+static void BuildImage(void)
+{
+	static const char sText[] = "<tr><td class=\"label\">Board status</td><td class=\"value\">";
+	static BYTE vPage[LOAD_BENCH_MAX_PAGE];
+	static BYTE vIndex[LOAD_BENCH_VARS*12];
+	DWORD dwLen, dwVarLen, dwID;
+	WORD v;
+	BYTE k;
+
+	memcpy((void*)MPFS_Start, (void*)"MPFS\x02\x01", 6);
+	MPFS_Start[6] = LOAD_BENCH_FILES;
+	MPFS_Start[7] = 0;
+
+	dwLen = 0;
+	dwBodyLen[1] = 0;
+	for(v = 0; v <= LOAD_BENCH_VARS; v++)
+	{
+		// Text, then a variable
+		for(dwID = 0; dwID < 64u; dwID++, dwLen++)
+			vPage[dwLen] = sText[dwLen % (sizeof(sText) - 1)];
+		dwBodyLen[1] += 64u;
+		if(v == LOAD_BENCH_VARS)
+			break;
+
+		k = v % LOAD_BENCH_VAR_NAMES;
+		dwVarLen = strlen(sVarNames[k]);
+		dwID = k;
+		memcpy((void*)&vIndex[v*12 + 0], (void*)&dwLen, 4);
+		memcpy((void*)&vIndex[v*12 + 4], (void*)&dwVarLen, 4);
+		memcpy((void*)&vIndex[v*12 + 8], (void*)&dwID, 4);
+		memcpy((void*)&vPage[dwLen], (void*)sVarNames[k], dwVarLen);
+		dwLen += dwVarLen;
+		dwBodyLen[1] += strlen(sVarValues[k]);
+	}
+
+	AddFile(1, "dynamic.htm", vPage, dwLen, MPFS2_FLAG_HASINDEX | MPFS2_FLAG_HASVARLEN);
+	AddFile(2, "", vIndex, LOAD_BENCH_VARS*12ul, 0);
+
+	// The static page is text of the same length as the dynamic one
+	dwBodyLen[0] = dwBodyLen[1];
+	for(dwLen = 0; dwLen < dwBodyLen[0]; dwLen++)
+		vPage[dwLen] = sText[dwLen % (sizeof(sText) - 1)];
+	AddFile(0, "static.htm", vPage, dwBodyLen[0], 0);
+}
+
+/*********************************************************************
+ * Function:        static void AddFile(BYTE vFile, const char* sName,
+ *                                      BYTE* pData, DWORD dwLen,
+ *                                      WORD wFlags)
+ *
+ * PreCondition:    None
+ *
+ * Input:           vFile - index of the file in the image
+ *                  sName - file name, up to 15 characters
+ *                  pData - file data
+ *                  dwLen - number of bytes of data
+ *                  wFlags - MPFS2_FLAG_* flags of the file
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes the name hash, FAT record, name and data of
+ *                  a file in MPFS_Start[].
+ *
+ * Note:            As in HTTPBench.c.  The data of each file follows
+ *                  that of the file added before it.
+ ********************************************************************/
+static void AddFile(BYTE vFile, const char* sName, BYTE* pData, DWORD dwLen, WORD wFlags)
+{
+	static DWORD dwData = 8 + LOAD_BENCH_FILES*(2 + LOAD_BENCH_FAT_RECORD + 16);
+	BYTE* pFAT;
+	DWORD dwString;
+	WORD wHash;
+	const char* p;
+
+	for(wHash = 0, p = sName; *p; p++)
+	{
+		wHash += (BYTE)*p;
+		wHash <<= 1;
+	}
+	MPFS_Start[8 + 2*vFile] = (BYTE)wHash;
+	MPFS_Start[8 + 2*vFile + 1] = (BYTE)(wHash >> 8);
+
+	dwString = 8 + LOAD_BENCH_FILES*(2 + LOAD_BENCH_FAT_RECORD) + vFile*16;
+	strcpy((char*)&MPFS_Start[dwString], sName);
+	memcpy((void*)&MPFS_Start[dwData], (void*)pData, dwLen);
+
+	pFAT = &MPFS_Start[8 + 2*LOAD_BENCH_FILES + vFile*LOAD_BENCH_FAT_RECORD];
+	memset((void*)pFAT, 0x00, LOAD_BENCH_FAT_RECORD);
+	memcpy((void*)&pFAT[0], (void*)&dwString, 4);
+	memcpy((void*)&pFAT[4], (void*)&dwData, 4);
+	memcpy((void*)&pFAT[8], (void*)&dwLen, 4);
+	memcpy((void*)&pFAT[20], (void*)&wFlags, 2);
+	dwData += dwLen;
+}
+
+// HTTP2 application callbacks: every page is public and has no
+// GET or POST processing
+HTTP_IO_RESULT HTTPExecuteGet(void)
+{
+	return HTTP_IO_DONE;
+}
+
+HTTP_IO_RESULT HTTPExecutePost(void)
+{
+	return HTTP_IO_DONE;
+}
+
+BYTE HTTPNeedsAuth(BYTE* cFile)
+{
+	return 0x80;
+}
+
+BYTE HTTPCheckAuth(BYTE* cUser, BYTE* cPass)
+{
+	return 0x80;
+}
+
+// Dynamic variable callbacks of HTTPPrint.h
+void HTTPPrint_version(void)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[0]);
+}
+
+void HTTPPrint_builddate(void)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[1]);
+}
+
+void HTTPPrint_uptime(void)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[2]);
+}
+
+void HTTPPrint_led(WORD num)
+{
+	TCPPutString(sktHTTP, (BYTE*)sVarValues[3 + num]);
+}
@@ -0,0 +1,368 @@
+/*********************************************************************
+ *
+ *  MPFS2 file lookup benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        LookupBench.c
+ * Dependencies:    MPFS2.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the time MPFSOpen() takes to find a file in images of 16 to
+ * 16384 files, for both layouts that MPFS2.c reads:
+ *   2.1  name hashes in file order, read 8 at a time until one
+ *        matches, as MPFS2.c did before the sorted index
+ *   2.2  sorted path hashes and their file IDs, binary searched
+ *
+ * The files are laid out in a directory tree: every directory
+ * "d<n>/s<m>/" holds the same 16 file names, as a site with many
+ * similar sections would.  Each file holds its own number, so that
+ * every open is checked during the first pass, along with a name that
+ * is not in the image.  The timed opens are of random files and of
+ * names that are not in the image, each followed by MPFSClose().
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_MPFS_BENCH -I. -I$S -I$S/Include -o lookupbench \
+ *       LookupBench.c "$S/TCPIP Stack/"{Tick,Helpers,MPFS2}.c && ./lookupbench
+ ********************************************************************/
+#define THIS_IS_STACK_APPLICATION
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_MAX_FILES		(16384u)				// Files in the largest image
+#define BENCH_FAT_RECORD	(22u)					// Size of an MPFS2 FAT record
+#define BENCH_NAME_LEN		(32u)					// Space for each name in the image
+#define BENCH_NAMES			(1024u)					// Random names opened in turn
+#define BENCH_LOOKUPS		(1ul << 24)				// Files x opens per measurement
+#define BENCH_ROUNDS		(5u)					// Best of this many measurements
+
+// Image sizes to measure, in files
+static const WORD wCounts[] = {16, 256, 4096, 16384};
+#define BENCH_COUNTS		(sizeof(wCounts)/sizeof(wCounts[0]))
+
+// The files of each directory
+static ROM char* const sLeaves[16] =
+{
+	"index.htm", "status.xml", "style.css", "logo.gif",
+	"mchp.js", "leds.cgi", "config.htm", "forms.htm",
+	"upload.htm", "cookies.htm", "dynvars.htm", "email.htm",
+	"ddns.htm", "snmp.htm", "footer.inc", "header.inc"
+};
+
+// MPFS2 reads the image from here.  MPFS2.c declares it ROM, but it is
+// written before each MPFSInit().
+BYTE MPFS_Start[8 + BENCH_MAX_FILES*(4 + BENCH_FAT_RECORD + BENCH_NAME_LEN + 4)];
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// Names opened by the timed loops
+static char sHits[BENCH_NAMES][BENCH_NAME_LEN];
+static char sMisses[BENCH_NAMES][BENCH_NAME_LEN];
+
+// Private helper functions.
+static void MakeName(char* sName, WORD wFile);
+static WORD HashName(BYTE* sName, BOOL bSorted);
+static void BuildImage(WORD wFiles, BOOL bSorted);
+static BOOL VerifyImage(WORD wFiles);
+static double TimeOpens(char (*sNames)[BENCH_NAME_LEN], DWORD dwOpens);
+static double NowNs(void);
+
+int main(void)
+{
+	static const char* sLayout[2] = {"2.1 linear", "2.2 sorted"};
+	double dHit[2], dMiss[2];
+	DWORD dwOpens;
+	WORD i, j;
+	BYTE k;
+
+	printf("%-6s", "files");
+	for(k = 0; k < 2u; k++)
+		printf("  %s hit / miss     ", sLayout[k]);
+	printf("  hit   miss\n");
+
+	for(i = 0; i < BENCH_COUNTS; i++)
+	{
+		// The same random names for both layouts
+		for(j = 0; j < BENCH_NAMES; j++)
+		{
+			MakeName(sHits[j], LFSRRand() % wCounts[i]);
+			MakeName(sMisses[j], LFSRRand() % wCounts[i]);
+			memcpy(strrchr(sMisses[j], '/') + 1, "x", 1);
+		}
+
+		dwOpens = BENCH_LOOKUPS / wCounts[i];
+		if(dwOpens < 20000ul)
+			dwOpens = 20000ul;
+		for(k = 0; k < 2u; k++)
+		{
+			BuildImage(wCounts[i], k);
+			MPFSInit();
+			if(!VerifyImage(wCounts[i]))
+				return 1;
+			dHit[k] = TimeOpens(sHits, dwOpens);
+			dMiss[k] = TimeOpens(sMisses, dwOpens);
+		}
+
+		printf("%-6u", wCounts[i]);
+		for(k = 0; k < 2u; k++)
+			printf("  %8.0f / %8.0f ns  ", dHit[k], dMiss[k]);
+		printf("%5.1fx %5.1fx\n", dHit[0] / dHit[1], dMiss[0] / dMiss[1]);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static void MakeName(char* sName, WORD wFile)
+ *
+ * PreCondition:    None
+ *
+ * Input:           sName - buffer of BENCH_NAME_LEN bytes
+ *                  wFile - number of the file
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Writes the path of file wFile, such as
+ *                  "d3/s12/style.css".
+ *
+ * Note:            None
+ ********************************************************************/
+static void MakeName(char* sName, WORD wFile)
+{
+	sprintf(sName, "d%u/s%u/%s", wFile / 256u, (wFile / 16u) % 16u, sLeaves[wFile % 16u]);
+}
+
+/*********************************************************************
+ * Function:        static WORD HashName(BYTE* sName, BOOL bSorted)
+ *
+ * PreCondition:    None
+ *
+ * Input:           sName - a file name
+ *                  bSorted - TRUE for the MPFS2.2 hash
+ *
+ * Output:          The name hash
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Calculates the name hash of either image version.
+ *
+ * Note:            As described at the top of MPFS2.c.
+ ********************************************************************/
+static WORD HashName(BYTE* sName, BOOL bSorted)
+{
+	WORD wHash;
+
+	for(wHash = 0; *sName; sName++)
+	{
+		if(bSorted)
+		{
+			wHash = wHash*31u + *sName;
+		}
+		else
+		{
+			wHash += *sName;
+			wHash <<= 1;
+		}
+	}
+	return wHash;
+}
+
+// Sort key for the MPFS2.2 index: hash, then file ID
+static WORD wSortHashes[BENCH_MAX_FILES];
+
+static int CompareIDs(const void* a, const void* b)
+{
+	WORD wA = *(const WORD*)a, wB = *(const WORD*)b;
+
+	if(wSortHashes[wA] != wSortHashes[wB])
+		return wSortHashes[wA] < wSortHashes[wB] ? -1 : 1;
+	return (int)wA - (int)wB;
+}
+
+/*********************************************************************
+ * Function:        static void BuildImage(WORD wFiles, BOOL bSorted)
+ *
+ * PreCondition:    None
+ *
+ * Input:           wFiles - number of files
+ *                  bSorted - TRUE for an MPFS2.2 image
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills MPFS_Start[].
+ *
+ * Overview:        Writes an image of wFiles files named by
+ *                  MakeName().  Each file holds its number as a DWORD.
+ *
+ * Note:            The layout is described at the top of MPFS2.c.
+ *                  Timestamps and flags are 0.
+ ********************************************************************/
+static void BuildImage(WORD wFiles, BOOL bSorted)
+{
+	static WORD wIDs[BENCH_MAX_FILES];
+	BYTE* pHashes;
+	BYTE* pFAT;
+	DWORD dwString, dwData, dwLen, dwFile;
+	WORD i;
+
+	memcpy((void*)MPFS_Start, bSorted ? "MPFS\x02\x02" : "MPFS\x02\x01", 6);
+	MPFS_Start[6] = (BYTE)wFiles;
+	MPFS_Start[7] = (BYTE)(wFiles >> 8);
+	pHashes = &MPFS_Start[8];
+	pFAT = pHashes + (bSorted ? 4ul : 2ul)*wFiles;
+	dwString = (DWORD)(pFAT - MPFS_Start) + (DWORD)wFiles*BENCH_FAT_RECORD;
+	dwData = dwString + (DWORD)wFiles*BENCH_NAME_LEN;
+	dwLen = 4;
+
+	for(i = 0; i < wFiles; i++)
+	{
+		MakeName((char*)&MPFS_Start[dwString + (DWORD)i*BENCH_NAME_LEN], i);
+		wSortHashes[i] = HashName(&MPFS_Start[dwString + (DWORD)i*BENCH_NAME_LEN], bSorted);
+		wIDs[i] = i;
+
+		dwFile = i;
+		memcpy((void*)&MPFS_Start[dwData + (DWORD)i*4u], (void*)&dwFile, 4);
+
+		memset((void*)&pFAT[(DWORD)i*BENCH_FAT_RECORD], 0x00, BENCH_FAT_RECORD);
+		dwFile = dwString + (DWORD)i*BENCH_NAME_LEN;
+		memcpy((void*)&pFAT[(DWORD)i*BENCH_FAT_RECORD + 0], (void*)&dwFile, 4);
+		dwFile = dwData + (DWORD)i*4u;
+		memcpy((void*)&pFAT[(DWORD)i*BENCH_FAT_RECORD + 4], (void*)&dwFile, 4);
+		memcpy((void*)&pFAT[(DWORD)i*BENCH_FAT_RECORD + 8], (void*)&dwLen, 4);
+	}
+
+	// 2.2 lists the hashes in ascending order, then their file IDs
+	if(bSorted)
+		qsort(wIDs, wFiles, sizeof(WORD), CompareIDs);
+	for(i = 0; i < wFiles; i++)
+	{
+		memcpy((void*)&pHashes[2ul*i], (void*)&wSortHashes[wIDs[i]], 2);
+		if(bSorted)
+			memcpy((void*)&pHashes[2ul*wFiles + 2ul*i], (void*)&wIDs[i], 2);
+	}
+}
+
+/*********************************************************************
+ * Function:        static BOOL VerifyImage(WORD wFiles)
+ *
+ * PreCondition:    MPFSInit() has been called on the image.
+ *
+ * Input:           wFiles - number of files in the image
+ *
+ * Output:          TRUE if every file was found
+ *
+ * Side Effects:    Prints the first failure.
+ *
+ * Overview:        Opens every file and checks its contents and ID,
+ *                  then checks that a name not in the image, and the
+ *                  name of a directory, are not found.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL VerifyImage(WORD wFiles)
+{
+	MPFS_HANDLE hFile;
+	char sName[BENCH_NAME_LEN];
+	DWORD dwFile;
+	WORD i;
+
+	for(i = 0; i < wFiles; i++)
+	{
+		MakeName(sName, i);
+		hFile = MPFSOpen((BYTE*)sName);
+		if(hFile == MPFS_INVALID_HANDLE)
+		{
+			printf("cannot open %s\n", sName);
+			return FALSE;
+		}
+		dwFile = 0xFFFFFFFFul;
+		MPFSGetLong(hFile, &dwFile);
+		if(dwFile != i || MPFSGetID(hFile) != i)
+		{
+			printf("%s opened file %lu\n", sName, (unsigned long)dwFile);
+			MPFSClose(hFile);
+			return FALSE;
+		}
+		MPFSClose(hFile);
+	}
+
+	if((hFile = MPFSOpen((BYTE*)"d0/s0/missing.htm")) != MPFS_INVALID_HANDLE ||
+	   (hFile = MPFSOpen((BYTE*)"d0/s0")) != MPFS_INVALID_HANDLE)
+	{
+		printf("opened a name that is not in the image\n");
+		MPFSClose(hFile);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static double TimeOpens(
+ *                      char (*sNames)[BENCH_NAME_LEN], DWORD dwOpens)
+ *
+ * PreCondition:    MPFSInit() has been called on the image.
+ *
+ * Input:           sNames - BENCH_NAMES names to open in turn
+ *                  dwOpens - number of opens per measurement
+ *
+ * Output:          Best time per open in ns
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Opens and closes the names in turn dwOpens times,
+ *                  BENCH_ROUNDS times, and keeps the fastest.
+ *
+ * Note:            None
+ ********************************************************************/
+static double TimeOpens(char (*sNames)[BENCH_NAME_LEN], DWORD dwOpens)
+{
+	MPFS_HANDLE hFile;
+	double dStart, dNs, dBest;
+	DWORD j;
+	BYTE k;
+
+	dBest = 0;
+	for(k = 0; k < BENCH_ROUNDS; k++)
+	{
+		dStart = NowNs();
+		for(j = 0; j < dwOpens; j++)
+		{
+			hFile = MPFSOpen((BYTE*)sNames[j % BENCH_NAMES]);
+			if(hFile != MPFS_INVALID_HANDLE)
+				MPFSClose(hFile);
+		}
+		dNs = (NowNs() - dStart) / dwOpens;
+		if(k == 0u || dNs < dBest)
+			dBest = dNs;
+	}
+	return dBest;
+}
+
+/*********************************************************************
+ * Function:        static double NowNs(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          Time in ns
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Reads the monotonic clock.
+ *
+ * Note:            None
+ ********************************************************************/
+static double NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
@@ -0,0 +1,173 @@
+/*********************************************************************
+ *
+ *  TCP goodput under packet loss benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        LossBench.c
+ * Dependencies:    TCP.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Sends a TCP stream from the stack to a sink on the Linux side of the
+ * TAP and reports the goodput at several packet loss rates.  TCP.c is
+ * included with DEBUG_GENERATE_TX_LOSS and DEBUG_GENERATE_RX_LOSS set to
+ * a variable, so that one run can step through the loss rates.  TX loss
+ * damages the checksum of outgoing segments, RX loss drops incoming
+ * segments; both are applied at the same rate.
+ *
+ * The sink reads and discards everything sent to LOSS_BENCH_PORT on
+ * 192.168.1.1, for example:
+ *   python3 -c 'import socket, threading; s = socket.socket(); \
+ *     s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1); \
+ *     s.bind(("", 9001)); s.listen(8); \
+ *     f = lambda c: [0 for d in iter(lambda: c.recv(65536), b"")]; \
+ *     [threading.Thread(target=f, args=(s.accept()[0],)).start() \
+ *       for i in iter(int, 1)]' &
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -I. -I$S -I$S/Include -o lossbench LossBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers,ARP,IP,ICMP}.c \
+ *       "$S/TCPIP Stack/"{UDP,TCPPerformanceTest,UDPPerformanceTest}.c
+ *   HOST_MAC_TAP=tap0 ./lossbench
+ * TCP_MIN_RTO_VAL and TCP_MIN_PTO_VAL can be set with -D to compare
+ * retransmission and loss probe timeouts.
+ ********************************************************************/
+
+#include "GenericTypeDefs.h"
+
+// Segments are lost when LFSRRand() returns more than this
+static WORD wLossThreshold = 0xFFFF;
+#define DEBUG_GENERATE_TX_LOSS	wLossThreshold
+#define DEBUG_GENERATE_RX_LOSS	wLossThreshold
+#include "TCPIP Stack/TCP.c"
+
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+
+#define LOSS_BENCH_PORT		(9001u)					// Port of the sink on 192.168.1.1
+#define LOSS_BENCH_TIME		((DWORD)TICK_SECOND*5)	// Duration of each measurement
+#define LOSS_BENCH_TIMEOUT	((DWORD)TICK_SECOND*5)	// Give up on connecting after this time
+
+// Loss rates to measure, in hundredths of a percent
+static const WORD wLossRates[] = {0, 10, 50, 100, 200, 500};
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+static BYTE vData[TCP_MAX_SEG_SIZE_TX];
+
+// Private helper functions.
+static BOOL MeasureGoodput(WORD wRate, DWORD* pdwBytes);
+static void RunStack(DWORD dwTicks);
+
+int main(void)
+{
+	DWORD dwBytes;
+	WORD i;
+
+	TickInit();
+	InitAppConfig();
+	StackInit();
+
+	// Let the link come up
+	while(!MACIsLinked())
+		StackTask();
+
+	for(i = 0; i < sizeof(wLossRates)/sizeof(wLossRates[0]); i++)
+	{
+		if(!MeasureGoodput(wLossRates[i], &dwBytes))
+		{
+			printf("could not connect to 192.168.1.1:%u\n", LOSS_BENCH_PORT);
+			return 1;
+		}
+		printf("loss %u.%02u%%: %8.1f kB/s\n", wLossRates[i]/100u, wLossRates[i]%100u,
+			dwBytes * (double)TICK_SECOND / LOSS_BENCH_TIME / 1000.0);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static BOOL MeasureGoodput(WORD wRate,
+ *                                             DWORD* pdwBytes)
+ *
+ * PreCondition:    StackInit() has been called and the link is up.
+ *
+ * Input:           wRate - loss rate in hundredths of a percent
+ *                  pdwBytes - receives the number of bytes acknowledged
+ *                             by the sink
+ *
+ * Output:          TRUE if the connection was established
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Connects to the sink without loss, then keeps the TX
+ *                  FIFO full for LOSS_BENCH_TIME at the given loss rate.
+ *
+ * Note:            Bytes still in the TX FIFO at the end are not
+ *                  counted.
+ ********************************************************************/
+static BOOL MeasureGoodput(WORD wRate, DWORD* pdwBytes)
+{
+	TCP_SOCKET hSocket;
+	DWORD dwStart, dwPut;
+	IP_ADDR Sink;
+
+	wLossThreshold = 0xFFFF;
+	Sink.Val = AppConfig.MyIPAddr.Val;
+	Sink.v[3] = 1;
+	hSocket = TCPOpen(Sink.Val, TCP_OPEN_IP_ADDRESS, LOSS_BENCH_PORT, TCP_PURPOSE_TCP_PERFORMANCE_TX);
+	if(hSocket == INVALID_SOCKET)
+		return FALSE;
+
+	dwStart = TickGet();
+	while(!TCPIsConnected(hSocket))
+	{
+		if(TickGet() - dwStart > LOSS_BENCH_TIMEOUT)
+		{
+			TCPDisconnect(hSocket);
+			return FALSE;
+		}
+		StackTask();
+	}
+
+	wLossThreshold = 0xFFFF - (WORD)(65536ul * wRate / 10000u);
+	dwPut = 0;
+	dwStart = TickGet();
+	while(TickGet() - dwStart < LOSS_BENCH_TIME)
+	{
+		StackTask();
+		dwPut += TCPPutArray(hSocket, vData, sizeof(vData));
+	}
+	*pdwBytes = dwPut - TCPGetTxFIFOFull(hSocket);
+
+	// Let the sink drain the connection before the next measurement
+	wLossThreshold = 0xFFFF;
+	TCPDisconnect(hSocket);
+	RunStack(TICK_SECOND);
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static void RunStack(DWORD dwTicks)
+ *
+ * PreCondition:    StackInit() has been called.
+ *
+ * Input:           dwTicks - how long to run the stack
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Calls StackTask() for the given time.
+ *
+ * Note:            None
+ ********************************************************************/
+static void RunStack(DWORD dwTicks)
+{
+	DWORD dwStart;
+
+	dwStart = TickGet();
+	while(TickGet() - dwStart < dwTicks)
+		StackTask();
+}
@@ -0,0 +1,385 @@
+/*********************************************************************
+ *
+ *  Static file serving benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        MPFSBench.c
+ * Dependencies:    TCP.c, MPFS2.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the throughput and the CPU time per KB of sending MPFS2
+ * files over a TCP connection, as HTTPSendFile() in HTTP2.c does for
+ * static pages, for files of 1 KB to 500 KB.  Two ways of filling the TX
+ * FIFO are compared:
+ *   copy    MPFSGetArray() into a 64 byte buffer, then TCPPutArray(),
+ *           as HTTP2.c did before TCPPutMPFS()
+ *   direct  TCPPutMPFS(), which reads the file into the TX FIFO
+ *
+ * The image is built in MPFS_Start[] at startup, with random file data.
+ * The connection is set up as in TxBench.c: TCP.c is included, the host
+ * MAC replays an empty capture, and each FIFO fill is sent as full sized
+ * segments with SendTCP() and then treated as acknowledged.  The FIFO
+ * contents are compared with the file during the first pass.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_MPFS_BENCH -I. -I$S -I$S/Include -o mpfsbench \
+ *       MPFSBench.c HostAppConfig.c "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP,MPFS2}.c \
+ *       && ./mpfsbench
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_BYTES			(64ul*1024ul*1024ul)	// Bytes served per measurement
+#define BENCH_LOCAL_PORT	(80u)
+#define BENCH_REMOTE_PORT	(40000u)
+#define BENCH_FAT_RECORD	(22u)					// Size of an MPFS2 FAT record
+
+// File sizes to serve, in KB
+static const WORD wSizes[] = {1, 4, 16, 64, 256, 500};
+#define BENCH_FILES			(sizeof(wSizes)/sizeof(wSizes[0]))
+
+// MPFS2 reads the image from here.  MPFS2.c declares it ROM, but it is
+// written once before MPFSInit().
+BYTE MPFS_Start[8 + BENCH_FILES*(2 + BENCH_FAT_RECORD + 16) + 842ul*1024ul];
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// File data, for checking the TX FIFO
+static BYTE* pFileData[BENCH_FILES];
+
+// Private helper functions.
+static void BuildImage(void);
+static TCP_SOCKET ConnectSocket(void);
+static WORD PutCopy(TCP_SOCKET hSocket, MPFS_HANDLE hFile, WORD wLen);
+static WORD PutDirect(TCP_SOCKET hSocket, MPFS_HANDLE hFile, WORD wLen);
+static BOOL ServeFile(TCP_SOCKET hSocket, BYTE vFile, WORD (*fPut)(TCP_SOCKET, MPFS_HANDLE, WORD), BOOL bCheck);
+static BOOL SendAll(TCP_SOCKET hSocket, BYTE* pExpected);
+
+int main(void)
+{
+	static WORD (* const fPut[2])(TCP_SOCKET, MPFS_HANDLE, WORD) = {PutCopy, PutDirect};
+	static const char* sPut[2] = {"copy", "direct"};
+	TCP_SOCKET hSocket;
+	DWORD dwFiles, j;
+	double dStart, dCPU, dNs[2], dCPUns[2];
+	BYTE i, k;
+
+	// Replay an empty capture: the link is up and nothing is received
+	if(!InitHostReplay())
+		return 1;
+
+	BuildImage();
+	MPFSInit();
+	TCPInit();
+	hSocket = ConnectSocket();
+
+	for(i = 0; i < BENCH_FILES; i++)
+	{
+		for(k = 0; k < 2u; k++)
+		{
+			if(!ServeFile(hSocket, i, fPut[k], TRUE))
+				return 1;
+		}
+	}
+	printf("TX FIFO contents match the files\n");
+
+	for(i = 0; i < BENCH_FILES; i++)
+	{
+		dwFiles = BENCH_BYTES / (wSizes[i] * 1024ul);
+		for(k = 0; k < 2u; k++)
+		{
+			dStart = NowNs(CLOCK_MONOTONIC);
+			dCPU = NowNs(CLOCK_PROCESS_CPUTIME_ID);
+			for(j = 0; j < dwFiles; j++)
+				ServeFile(hSocket, i, fPut[k], FALSE);
+			dCPUns[k] = (NowNs(CLOCK_PROCESS_CPUTIME_ID) - dCPU) / (dwFiles * wSizes[i]);
+			dNs[k] = NowNs(CLOCK_MONOTONIC) - dStart;
+			dNs[k] = dwFiles * wSizes[i] * 1024.0 * 1000.0 / dNs[k];
+		}
+		printf("%4u KB: ", wSizes[i]);
+		for(k = 0; k < 2u; k++)
+			printf("%s %6.0f MB/s %6.0f ns/KB   ", sPut[k], dNs[k], dCPUns[k]);
+		printf("%4.2fx\n", dCPUns[0] / dCPUns[1]);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static void BuildImage(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    Fills MPFS_Start[] and pFileData[].
+ *
+ * Overview:        Writes an MPFS2.1 image with one file of random data
+ *                  per entry of wSizes[], named "f<n>.htm".
+ *
+ * Note:            The layout is described at the top of MPFS2.c.
+ *                  Timestamps and flags are 0.
+ ********************************************************************/
+static void BuildImage(void)
+{
+	BYTE* pHashes;
+	BYTE* pFAT;
+	DWORD dwString, dwData, dwLen, j;
+	WORD wHash;
+	BYTE i, *p;
+	char sName[16];
+
+	memcpy((void*)MPFS_Start, (void*)"MPFS\x02\x01", 6);
+	MPFS_Start[6] = BENCH_FILES;
+	MPFS_Start[7] = 0;
+	pHashes = &MPFS_Start[8];
+	pFAT = pHashes + 2*BENCH_FILES;
+	dwString = 8 + BENCH_FILES*(2 + BENCH_FAT_RECORD);
+	dwData = dwString + BENCH_FILES*16;
+
+	for(i = 0; i < BENCH_FILES; i++)
+	{
+		sprintf(sName, "f%u.htm", wSizes[i]);
+		strcpy((char*)&MPFS_Start[dwString + i*16], sName);
+		for(wHash = 0, p = (BYTE*)sName; *p; p++)
+		{
+			wHash += *p;
+			wHash <<= 1;
+		}
+		pHashes[2*i] = (BYTE)wHash;
+		pHashes[2*i + 1] = (BYTE)(wHash >> 8);
+
+		dwLen = wSizes[i] * 1024ul;
+		pFileData[i] = &MPFS_Start[dwData];
+		for(j = 0; j < dwLen; j++)
+			MPFS_Start[dwData + j] = (BYTE)LFSRRand();
+
+		memset((void*)&pFAT[i*BENCH_FAT_RECORD], 0x00, BENCH_FAT_RECORD);
+		j = dwString + i*16;
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 0], (void*)&j, 4);
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 4], (void*)&dwData, 4);
+		memcpy((void*)&pFAT[i*BENCH_FAT_RECORD + 8], (void*)&dwLen, 4);
+		dwData += dwLen;
+	}
+}
+
+/*********************************************************************
+ * Function:        static TCP_SOCKET ConnectSocket(void)
+ *
+ * PreCondition:    TCPInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          The connected socket
+ *
+ * Side Effects:    Exits if the socket cannot be opened.
+ *
+ * Overview:        Opens a server socket with a 16 KB TX FIFO and
+ *                  connects it by passing a SYN to FindMatchingSocket().
+ *
+ * Note:            As in TxBench.c.
+ ********************************************************************/
+static TCP_SOCKET ConnectSocket(void)
+{
+	TCP_SOCKET hTCP;
+	TCP_HEADER header;
+	NODE_INFO remote;
+
+	remote.IPAddr.Val = 0x0101A8C0ul;			// 192.168.1.1
+	memset((void*)&remote.MACAddr, 0x02, sizeof(MAC_ADDR));
+	memset((void*)&header, 0x00, sizeof(header));
+	header.SourcePort = BENCH_REMOTE_PORT;
+	header.DestPort = BENCH_LOCAL_PORT;
+	header.Flags.bits.flagSYN = 1;
+
+	hTCP = TCPOpen(0, TCP_OPEN_SERVER, BENCH_LOCAL_PORT, TCP_PURPOSE_TCP_PERFORMANCE_TX);
+	if(hTCP == INVALID_SOCKET || !FindMatchingSocket(&header, &remote) || hCurrentTCP != hTCP)
+	{
+		printf("cannot connect the TCP socket\n");
+		exit(1);
+	}
+
+	SyncTCB();
+	MyTCBStub.smState = TCP_ESTABLISHED;
+	MyTCB.wRemoteMSS = TCP_MAX_SEG_SIZE_TX - 12u;
+	MyTCB.flags.bTimestamps = 1;
+	MyTCB.flags.bSACK = 1;
+	return hTCP;
+}
+
+/*********************************************************************
+ * Function:        static WORD PutCopy(TCP_SOCKET hSocket,
+ *                                      MPFS_HANDLE hFile, WORD wLen)
+ *
+ * PreCondition:    hFile is open.
+ *
+ * Input:           hSocket - socket to write to
+ *                  hFile - file to read from
+ *                  wLen - number of bytes to write
+ *
+ * Output:          Number of bytes written
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies the file through a 64 byte buffer, as
+ *                  HTTPSendFile() did before TCPPutMPFS().
+ *
+ * Note:            None
+ ********************************************************************/
+static WORD PutCopy(TCP_SOCKET hSocket, MPFS_HANDLE hFile, WORD wLen)
+{
+	BYTE data[64];
+	WORD w, wTotal;
+
+	for(wTotal = 0; wTotal < wLen; wTotal += w)
+	{
+		w = wLen - wTotal;
+		if(w > sizeof(data))
+			w = sizeof(data);
+		w = MPFSGetArray(hFile, data, w);
+		if(w == 0u)
+			break;
+		TCPPutArray(hSocket, data, w);
+	}
+	return wTotal;
+}
+
+/*********************************************************************
+ * Function:        static WORD PutDirect(TCP_SOCKET hSocket,
+ *                                        MPFS_HANDLE hFile, WORD wLen)
+ *
+ * PreCondition:    hFile is open.
+ *
+ * Input:           hSocket - socket to write to
+ *                  hFile - file to read from
+ *                  wLen - number of bytes to write
+ *
+ * Output:          Number of bytes written
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Calls TCPPutMPFS().
+ *
+ * Note:            None
+ ********************************************************************/
+static WORD PutDirect(TCP_SOCKET hSocket, MPFS_HANDLE hFile, WORD wLen)
+{
+	return TCPPutMPFS(hSocket, hFile, wLen);
+}
+
+/*********************************************************************
+ * Function:        static BOOL ServeFile(TCP_SOCKET hSocket, BYTE vFile,
+ *                      WORD (*fPut)(TCP_SOCKET, MPFS_HANDLE, WORD),
+ *                      BOOL bCheck)
+ *
+ * PreCondition:    ConnectSocket() has returned hSocket.
+ *
+ * Input:           hSocket - socket to send on
+ *                  vFile - index of the file in wSizes[]
+ *                  fPut - function that fills the TX FIFO
+ *                  bCheck - TRUE to compare the TX FIFO with the file
+ *
+ * Output:          TRUE if the whole file was sent and matched
+ *
+ * Side Effects:    Prints the first mismatch.
+ *
+ * Overview:        Opens the file, then fills the TX FIFO with fPut and
+ *                  sends it until the end of the file, like repeated
+ *                  calls of HTTPSendFile().
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL ServeFile(TCP_SOCKET hSocket, BYTE vFile, WORD (*fPut)(TCP_SOCKET, MPFS_HANDLE, WORD), BOOL bCheck)
+{
+	MPFS_HANDLE hFile;
+	char sName[16];
+	DWORD dwSent;
+	WORD wFree, wPut;
+
+	sprintf(sName, "f%u.htm", wSizes[vFile]);
+	hFile = MPFSOpen((BYTE*)sName);
+	if(hFile == MPFS_INVALID_HANDLE)
+	{
+		printf("cannot open %s\n", sName);
+		return FALSE;
+	}
+
+	dwSent = 0;
+	do
+	{
+		wFree = TCPIsPutReady(hSocket);
+		wPut = fPut(hSocket, hFile, wFree);
+		if(!SendAll(hSocket, bCheck ? pFileData[vFile] + dwSent : NULL))
+		{
+			printf("TX FIFO mismatch in %s at offset %lu\n", sName, (unsigned long)dwSent);
+			MPFSClose(hFile);
+			return FALSE;
+		}
+		dwSent += wPut;
+	} while(wPut == wFree);
+	MPFSClose(hFile);
+
+	if(dwSent != wSizes[vFile] * 1024ul)
+	{
+		printf("%lu bytes of %s sent\n", (unsigned long)dwSent, sName);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static BOOL SendAll(TCP_SOCKET hSocket,
+ *                                      BYTE* pExpected)
+ *
+ * PreCondition:    ConnectSocket() has returned hSocket.
+ *
+ * Input:           hSocket - socket to send on
+ *                  pExpected - expected TX FIFO contents, or NULL
+ *
+ * Output:          TRUE if the TX FIFO matched pExpected
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Compares the unacknowledged bytes of the TX FIFO
+ *                  with pExpected, sends them with SendTCP() and then
+ *                  acknowledges all of them.
+ *
+ * Note:            The windows are opened wide, so that every segment
+ *                  is full sized.
+ ********************************************************************/
+static BOOL SendAll(TCP_SOCKET hSocket, BYTE* pExpected)
+{
+	PTR_BASE ptr;
+
+	SyncTCBStub(hSocket);
+	SyncTCB();
+	if(pExpected)
+	{
+		for(ptr = MyTCBStub.txTail; ptr != MyTCBStub.txHead; pExpected++)
+		{
+			if(*(BYTE*)ptr != *pExpected)
+				return FALSE;
+			if(++ptr >= MyTCBStub.bufferRxStart)
+				ptr = MyTCBStub.bufferTxStart;
+		}
+	}
+
+	MyTCB.remoteWindow = 0xFFFF;
+	MyTCB.wCongWindow = 0xFFFF;
+	while(MyTCB.txUnackedTail != MyTCBStub.txHead)
+		SendTCP(ACK, SENDTCP_RESET_TIMERS);
+
+	MyTCBStub.txTail = MyTCB.txUnackedTail;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	MyTCBStub.Flags.bTimer2Enabled = 0;
+	MyTCBStub.Flags.bHalfFullFlush = 0;
+	return TRUE;
+}
@@ -0,0 +1,65 @@
+/*********************************************************************
+ *
+ *  Main Application Entry Point for the host build
+ *
+ *********************************************************************
+ * FileName:        MainDemo.c
+ * Dependencies:    TCPIP.h
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Runs the stack and the TCP and UDP performance test modules in a
+ * Linux process on the ETHHost.c MAC driver.
+ *
+ * The host build is native, 32 or 64 bit.  On an LP64 host the DWORD and
+ * LONG types stay 32 bits wide, and pointers passed through a DWORD-sized
+ * stack parameter use DWORD_PTR_BASE, so position independent executables
+ * work as well.
+ *
+ * Build:  S=../../Microchip
+ *         gcc -O2 -I. -I$S/Include -o stack MainDemo.c HostAppConfig.c \
+ *             "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers,ARP,IP,ICMP}.c \
+ *             "$S/TCPIP Stack/"{UDP,TCP,TCPPerformanceTest,UDPPerformanceTest}.c
+ * Usage:  HOST_MAC_TAP=tap0 ./stack
+ *         Connect to port 9762 to receive and port 9763 to send the
+ *         TCP performance test stream, for example with
+ *         nc 192.168.1.2 9762 | pv > /dev/null
+ ********************************************************************/
+#define THIS_IS_STACK_APPLICATION
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include "HostAppConfig.h"
+
+// Declare AppConfig structure and some other supporting stack variables
+APP_CONFIG AppConfig;
+
+int main(void)
+{
+	// Initialize stack-related hardware components that may be
+	// required by the UART configuration routines
+	TickInit();
+
+	// Initialize Stack and application related NV variables into AppConfig.
+	InitAppConfig();
+
+	// Initialize core stack layers (MAC, ARP, TCP, UDP) and
+	// application modules (HTTP, SNMP, etc.)
+	StackInit();
+
+	// Now that all items are initialized, begin the co-operative
+	// multitasking loop.
+	while(1)
+	{
+		// This task performs normal stack task including checking
+		// for incoming packet, type of packet and calling
+		// appropriate stack entity to process it.
+		StackTask();
+
+		// This tasks invokes each of the core stack application tasks
+		StackApplications();
+
+		TCPPerformanceTask();
+		UDPPerformanceTask();
+	}
+}
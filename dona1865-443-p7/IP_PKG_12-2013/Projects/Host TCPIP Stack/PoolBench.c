@@ -0,0 +1,267 @@
+/*********************************************************************
+ *
+ *  Concurrent HTTP connections for a fixed TCP RAM budget
+ *
+ *********************************************************************
+ * FileName:        PoolBench.c
+ * Dependencies:    TCP.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Reports how many HTTP connections the stack serves at the same time
+ * with TCP_PIC_RAM_SIZE bytes of TCP RAM, while the other services of a
+ * demo application (Telnet, FTP, the performance tests, the UART bridge
+ * and Berkeley sockets) listen idle.  The socket table is the
+ * HOST_POOL_BENCH one of TCPIPConfig.h.  TCP.c is included so that the
+ * table and the socket FIFOs can be inspected.
+ *
+ * The clients are Linux sockets of this program on the other side of the
+ * TAP.  POOL_BENCH_CLIENTS of them connect to port 80 of 192.168.1.2 at
+ * once, send a request and keep the connection open.  Every HTTP socket
+ * answers a request with a short response; a client is served when it
+ * has the whole response.  Connections the stack has no room for wait in
+ * the SYN queue or are retried by Linux, and are not served.
+ *
+ * With TCP_DYNAMIC_FIFOS (the default here) the budget holds the TCBs of
+ * all sockets and a pool from which only connected sockets take FIFOs,
+ * so the idle services leave their FIFO space to HTTP connections.  With
+ * -DTCP_DYNAMIC_FIFOS=0 every socket holds its FIFOs from TCPInit(), and
+ * the table must fit in the budget: the program prints the largest
+ * HOST_POOL_HTTP_SOCKETS that does and exits if it is exceeded.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_POOL_BENCH -I. -I$S -I$S/Include -o poolbench \
+ *       PoolBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers}.c \
+ *       "$S/TCPIP Stack/"{ARP,IP,ICMP,UDP}.c \
+ *       "$S/TCPIP Stack/"{TCPPerformanceTest,UDPPerformanceTest}.c
+ *   HOST_MAC_TAP=tap0 ./poolbench
+ * For the static layout, add -DTCP_DYNAMIC_FIFOS=0
+ * -DHOST_POOL_HTTP_SOCKETS=n with the n printed by the first run.
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define POOL_BENCH_CLIENTS		(64u)					// Concurrent connection attempts
+#define POOL_BENCH_PORT			(80u)
+#define POOL_BENCH_TIME			((DWORD)TICK_SECOND*4)	// Duration of the measurement
+#define POOL_BENCH_FIRST_HTTP	(10u)					// First HTTP socket of the table
+
+static ROM BYTE vRequest[] = "GET / HTTP/1.1\r\n\r\n";
+static ROM BYTE vResponse[] = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK";
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// Private helper functions.
+static DWORD GetStaticSize(WORD wHTTPSockets);
+static DWORD GetPoolInUse(void);
+static void ServeRequests(void);
+
+int main(void)
+{
+	static int fd[POOL_BENCH_CLIENTS];
+	static WORD wReceived[POOL_BENCH_CLIENTS];
+	static BOOL bSent[POOL_BENCH_CLIENTS];
+	struct sockaddr_in addr;
+	struct pollfd pfd;
+	BYTE vBuffer[128];
+	DWORD dwStart, dwInUse, dwMaxInUse;
+	WORD i, wMaxStatic, wServed;
+	int n;
+
+	// Largest static table that fits the budget
+	for(wMaxStatic = 0; GetStaticSize(wMaxStatic + 1) <= TCP_PIC_RAM_SIZE; wMaxStatic++);
+	printf("%lu byte budget, %u byte TCB: a static table fits %u HTTP sockets of %u/%u bytes\n",
+		(unsigned long)TCP_PIC_RAM_SIZE, (unsigned)sizeof(TCB), wMaxStatic,
+		TCPSocketInitializer[POOL_BENCH_FIRST_HTTP].wTXBufferSize, TCPSocketInitializer[POOL_BENCH_FIRST_HTTP].wRXBufferSize);
+	#if !TCP_DYNAMIC_FIFOS
+	if(HOST_POOL_HTTP_SOCKETS > wMaxStatic)
+	{
+		printf("build with -DHOST_POOL_HTTP_SOCKETS=%u or fewer for the static layout\n", wMaxStatic);
+		return 1;
+	}
+	#endif
+
+	TickInit();
+	InitAppConfig();
+	StackInit();
+
+	// The services listen idle, the rest of the table serves HTTP
+	for(i = 0; i < TCP_SOCKET_COUNT; i++)
+	{
+		if(TCPSocketInitializer[i].vSocketPurpose == TCP_PURPOSE_GENERIC_TCP_CLIENT)
+			continue;
+		if(TCPOpen(0, TCP_OPEN_SERVER, i < POOL_BENCH_FIRST_HTTP ? 10000u + i : POOL_BENCH_PORT, TCPSocketInitializer[i].vSocketPurpose) == INVALID_SOCKET)
+		{
+			printf("TCPOpen() failed for socket %u\n", i);
+			return 1;
+		}
+	}
+
+	while(!MACIsLinked())
+		StackTask();
+
+	memset((void*)&addr, 0x00, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(POOL_BENCH_PORT);
+	addr.sin_addr.s_addr = AppConfig.MyIPAddr.Val;
+	for(i = 0; i < POOL_BENCH_CLIENTS; i++)
+	{
+		fd[i] = socket(AF_INET, SOCK_STREAM, 0);
+		if(fd[i] < 0 || fcntl(fd[i], F_SETFL, O_NONBLOCK) < 0
+			|| (connect(fd[i], (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS))
+		{
+			printf("cannot connect client %u\n", i);
+			return 1;
+		}
+	}
+
+	// Run the stack and the clients, keeping every connection open
+	dwMaxInUse = 0;
+	dwStart = TickGet();
+	while(TickGet() - dwStart < POOL_BENCH_TIME)
+	{
+		StackTask();
+		ServeRequests();
+		dwInUse = GetPoolInUse();
+		if(dwInUse > dwMaxInUse)
+			dwMaxInUse = dwInUse;
+
+		for(i = 0; i < POOL_BENCH_CLIENTS; i++)
+		{
+			pfd.fd = fd[i];
+			pfd.events = bSent[i] ? POLLIN : POLLOUT;
+			if(poll(&pfd, 1, 0) <= 0)
+				continue;
+			if(!bSent[i])
+			{
+				bSent[i] = send(fd[i], vRequest, sizeof(vRequest) - 1, 0) == (int)sizeof(vRequest) - 1;
+				continue;
+			}
+			n = recv(fd[i], vBuffer, sizeof(vBuffer), 0);
+			if(n > 0)
+				wReceived[i] += n;
+		}
+	}
+
+	wServed = 0;
+	for(i = 0; i < POOL_BENCH_CLIENTS; i++)
+	{
+		if(wReceived[i] >= sizeof(vResponse) - 1)
+			wServed++;
+		close(fd[i]);
+	}
+	printf("TCP_DYNAMIC_FIFOS %u, %u HTTP sockets: %u of %u connections served concurrently, at most %lu bytes in use\n",
+		(unsigned)TCP_DYNAMIC_FIFOS, (unsigned)HOST_POOL_HTTP_SOCKETS, wServed, POOL_BENCH_CLIENTS, (unsigned long)dwMaxInUse);
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static DWORD GetStaticSize(WORD wHTTPSockets)
+ *
+ * PreCondition:    None
+ *
+ * Input:           wHTTPSockets - number of HTTP sockets in the table
+ *
+ * Output:          Bytes TCPInit() allocates for the table without
+ *                  TCP_DYNAMIC_FIFOS
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Sums the TCB and FIFOs of the services and of
+ *                  wHTTPSockets sockets like the first HTTP socket.
+ *
+ * Note:            Each FIFO has one unused byte.
+ ********************************************************************/
+static DWORD GetStaticSize(WORD wHTTPSockets)
+{
+	DWORD dwSize;
+	WORD i;
+
+	dwSize = 0;
+	for(i = 0; i < POOL_BENCH_FIRST_HTTP; i++)
+		dwSize += sizeof(TCB) + TCPSocketInitializer[i].wTXBufferSize+1 + TCPSocketInitializer[i].wRXBufferSize+1;
+	dwSize += (DWORD)wHTTPSockets * (sizeof(TCB) + TCPSocketInitializer[POOL_BENCH_FIRST_HTTP].wTXBufferSize+1 + TCPSocketInitializer[POOL_BENCH_FIRST_HTTP].wRXBufferSize+1);
+	return dwSize;
+}
+
+/*********************************************************************
+ * Function:        static DWORD GetPoolInUse(void)
+ *
+ * PreCondition:    TCPInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          Bytes of TCP_PIC_RAM held by the TCBs and FIFOs of
+ *                  all sockets
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Adds the FIFOs of every socket to the TCB array and
+ *                  the shared empty FIFOs with TCP_DYNAMIC_FIFOS, or
+ *                  to the TCB before them without.
+ *
+ * Note:            Reads the stubs directly, so the cached stub of
+ *                  TCP_OPTIMIZE_FOR_SIZE is not supported.
+ ********************************************************************/
+static DWORD GetPoolInUse(void)
+{
+	DWORD dwSize;
+	TCP_SOCKET i;
+
+	#if TCP_DYNAMIC_FIFOS
+	dwSize = TCP_PIC_RAM_POOL_ADDRESS - TCP_PIC_RAM_BASE_ADDRESS;
+	for(i = 0; i < TCP_SOCKET_COUNT; i++)
+	{
+		if(TCBStubs[i].bufferTxStart >= TCP_PIC_RAM_POOL_ADDRESS)
+			dwSize += TCBStubs[i].bufferEnd + 1 - TCBStubs[i].bufferTxStart;
+	}
+	#else
+	dwSize = 0;
+	for(i = 0; i < TCP_SOCKET_COUNT; i++)
+		dwSize += sizeof(TCB) + TCBStubs[i].bufferEnd + 1 - TCBStubs[i].bufferTxStart;
+	#endif
+	return dwSize;
+}
+
+/*********************************************************************
+ * Function:        static void ServeRequests(void)
+ *
+ * PreCondition:    The HTTP sockets are open.
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Answers every complete request waiting in an HTTP
+ *                  socket with vResponse, leaving the connection open.
+ *
+ * Note:            Requests are all the same length, so a complete one
+ *                  is recognized by its size.
+ ********************************************************************/
+static void ServeRequests(void)
+{
+	TCP_SOCKET i;
+
+	for(i = POOL_BENCH_FIRST_HTTP; i < TCP_SOCKET_COUNT; i++)
+	{
+		if(TCPIsGetReady(i) < sizeof(vRequest) - 1 || TCPIsPutReady(i) < sizeof(vResponse) - 1)
+			continue;
+		TCPGetArray(i, NULL, sizeof(vRequest) - 1);
+		TCPPutROMArray(i, vResponse, sizeof(vResponse) - 1);
+		TCPFlush(i);
+	}
+}
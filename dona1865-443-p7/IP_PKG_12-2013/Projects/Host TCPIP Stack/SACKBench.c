@@ -0,0 +1,226 @@
+/*********************************************************************
+ *
+ *  TCP retransmission under packet loss benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        SACKBench.c
+ * Dependencies:    TCP.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Sends a TCP stream from the stack to a sink on the Linux side of the
+ * TAP and reports, at several packet loss rates, the goodput and the
+ * number of bytes that were sent more than once.  TCP.c is included as
+ * in LossBench.c, with DEBUG_COUNT_TX_RETRANSMITS set to a variable that
+ * counts the data sent again after a loss was detected.  Lost outgoing
+ * segments leave holes in the receive queue of the sink; lost ACKs and
+ * SACK blocks coming back are lost incoming segments.
+ *
+ * The stream is a byte counter modulo SACK_BENCH_PERIOD, starting at 0
+ * on each connection.  The sink checks every byte it reads against the
+ * counter and resets the connection at the first wrong one, which stops
+ * the benchmark.  The sink listens on SACK_BENCH_PORT of 192.168.1.1,
+ * for example:
+ *   python3 -c 'import socket, struct, threading
+ *   p = bytes(range(251)) * 263
+ *   def f(c):
+ *     n = 0
+ *     for d in iter(lambda: c.recv(65536), b""):
+ *       if d != p[n % 251:n % 251 + len(d)]:
+ *         c.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER,
+ *                      struct.pack("ii", 1, 0))
+ *         break
+ *       n += len(d)
+ *     c.close()
+ *   s = socket.socket()
+ *   s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+ *   s.bind(("", 9003)); s.listen(8)
+ *   while True: threading.Thread(target=f, args=(s.accept()[0],)).start()' &
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -I. -I$S -I$S/Include -o sackbench SACKBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers,ARP,IP,ICMP}.c \
+ *       "$S/TCPIP Stack/"{UDP,TCPPerformanceTest,UDPPerformanceTest}.c
+ *   HOST_MAC_TAP=tap0 ./sackbench
+ * Build with -DTCP_SACK=0 to compare with NewReno recovery alone.
+ *
+ * The receive side, where the stack reassembles out-of-order segments
+ * and sends SACK blocks to the Linux sender, is measured with
+ * UploadBench.c built with -DDEBUG_GENERATE_RX_LOSS=62257 (5% loss).
+ ********************************************************************/
+
+#include "GenericTypeDefs.h"
+
+// Segments are lost when LFSRRand() returns more than this
+static WORD wLossThreshold = 0xFFFF;
+static DWORD dwRetransmitted;
+#define DEBUG_GENERATE_TX_LOSS		wLossThreshold
+#define DEBUG_GENERATE_RX_LOSS		wLossThreshold
+#define DEBUG_COUNT_TX_RETRANSMITS	dwRetransmitted
+#include "TCPIP Stack/TCP.c"
+
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+
+#define SACK_BENCH_PORT		(9003u)					// Port of the checking sink on 192.168.1.1
+#define SACK_BENCH_TIME		((DWORD)TICK_SECOND*5)	// Duration of each measurement
+#define SACK_BENCH_TIMEOUT	((DWORD)TICK_SECOND*5)	// Give up on connecting after this time
+#define SACK_BENCH_PERIOD	(251u)					// Period of the byte counter sent to the sink
+
+// Loss rates to measure, in hundredths of a percent
+static const WORD wLossRates[] = {10, 50, 100, 200, 500};
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// The byte counter, long enough to put a segment from any phase
+static BYTE vData[TCP_MAX_SEG_SIZE_TX + SACK_BENCH_PERIOD];
+
+// Private helper functions.
+static BOOL MeasureGoodput(WORD wRate, DWORD* pdwBytes, BOOL* pbSACK, BOOL* pbCorrupt);
+static void RunStack(DWORD dwTicks);
+
+int main(void)
+{
+	DWORD dwBytes;
+	BOOL bSACK, bCorrupt;
+	WORD i;
+
+	TickInit();
+	InitAppConfig();
+	StackInit();
+
+	for(i = 0; i < sizeof(vData); i++)
+		vData[i] = (BYTE)(i % SACK_BENCH_PERIOD);
+
+	// Let the link come up
+	while(!MACIsLinked())
+		StackTask();
+
+	for(i = 0; i < sizeof(wLossRates)/sizeof(wLossRates[0]); i++)
+	{
+		if(!MeasureGoodput(wLossRates[i], &dwBytes, &bSACK, &bCorrupt))
+		{
+			printf("could not connect to 192.168.1.1:%u\n", SACK_BENCH_PORT);
+			return 1;
+		}
+		if(bCorrupt)
+		{
+			printf("loss %u.%02u%%: the sink received wrong data and reset the connection\n",
+				wLossRates[i]/100u, wLossRates[i]%100u);
+			return 1;
+		}
+		printf("loss %u.%02u%%: %8.1f kB/s, %8lu bytes retransmitted (%5.2f%%)%s\n",
+			wLossRates[i]/100u, wLossRates[i]%100u,
+			dwBytes * (double)TICK_SECOND / SACK_BENCH_TIME / 1000.0,
+			(unsigned long)dwRetransmitted, dwBytes ? dwRetransmitted * 100.0 / dwBytes : 0.0,
+			bSACK ? ", SACK" : "");
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static BOOL MeasureGoodput(WORD wRate,
+ *                                             DWORD* pdwBytes,
+ *                                             BOOL* pbSACK,
+ *                                             BOOL* pbCorrupt)
+ *
+ * PreCondition:    StackInit() has been called and the link is up.
+ *
+ * Input:           wRate - loss rate in hundredths of a percent
+ *                  pdwBytes - receives the number of bytes acknowledged
+ *                             by the sink
+ *                  pbSACK - receives TRUE if SACK was negotiated
+ *                  pbCorrupt - receives TRUE if the sink closed the
+ *                              connection before all data was ACKed
+ *
+ * Output:          TRUE if the connection was established
+ *
+ * Side Effects:    Sets dwRetransmitted to the number of bytes sent
+ *                  again during the measurement.
+ *
+ * Overview:        Connects to the sink without loss, then keeps the TX
+ *                  FIFO full for SACK_BENCH_TIME at the given loss rate.
+ *                  The data left in the TX FIFO is then sent without
+ *                  loss, and the connection must still be open after
+ *                  the sink has checked it.
+ *
+ * Note:            Bytes still in the TX FIFO at the end are not
+ *                  counted.
+ ********************************************************************/
+static BOOL MeasureGoodput(WORD wRate, DWORD* pdwBytes, BOOL* pbSACK, BOOL* pbCorrupt)
+{
+	TCP_SOCKET hSocket;
+	DWORD dwStart, dwPut;
+	IP_ADDR Sink;
+
+	wLossThreshold = 0xFFFF;
+	Sink.Val = AppConfig.MyIPAddr.Val;
+	Sink.v[3] = 1;
+	hSocket = TCPOpen(Sink.Val, TCP_OPEN_IP_ADDRESS, SACK_BENCH_PORT, TCP_PURPOSE_TCP_PERFORMANCE_TX);
+	if(hSocket == INVALID_SOCKET)
+		return FALSE;
+
+	dwStart = TickGet();
+	while(!TCPIsConnected(hSocket))
+	{
+		if(TickGet() - dwStart > SACK_BENCH_TIMEOUT)
+		{
+			TCPDisconnect(hSocket);
+			return FALSE;
+		}
+		StackTask();
+	}
+
+	SyncTCBStub(hSocket);
+	SyncTCB();
+	*pbSACK = MyTCB.flags.bSACK;
+
+	wLossThreshold = 0xFFFF - (WORD)(65536ul * wRate / 10000u);
+	dwRetransmitted = 0;
+	dwPut = 0;
+	dwStart = TickGet();
+	while(TickGet() - dwStart < SACK_BENCH_TIME)
+	{
+		StackTask();
+		dwPut += TCPPutArray(hSocket, &vData[dwPut % SACK_BENCH_PERIOD], TCP_MAX_SEG_SIZE_TX);
+	}
+	*pdwBytes = dwPut - TCPGetTxFIFOFull(hSocket);
+
+	// Let the sink check the rest of the stream, then drain the connection 
+	// before the next measurement
+	wLossThreshold = 0xFFFF;
+	dwStart = TickGet();
+	while(TCPIsConnected(hSocket) && TCPGetTxFIFOFull(hSocket) && (TickGet() - dwStart < SACK_BENCH_TIMEOUT))
+		StackTask();
+	RunStack(TICK_SECOND/10);
+	*pbCorrupt = !TCPIsConnected(hSocket);
+	TCPDisconnect(hSocket);
+	RunStack(TICK_SECOND);
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static void RunStack(DWORD dwTicks)
+ *
+ * PreCondition:    StackInit() has been called.
+ *
+ * Input:           dwTicks - how long to run the stack
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Calls StackTask() for the given time.
+ *
+ * Note:            None
+ ********************************************************************/
+static void RunStack(DWORD dwTicks)
+{
+	DWORD dwStart;
+
+	dwStart = TickGet();
+	while(TickGet() - dwStart < dwTicks)
+		StackTask();
+}
@@ -0,0 +1,715 @@
+/*********************************************************************
+ *
+ *  SSL record throughput benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        SSLBench.c
+ * Dependencies:    TCP.c, SSL.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the CPU time the SSL record layer takes per byte of
+ * application data, with TLS 1.2 TLS_RSA_WITH_AES_128_GCM_SHA256 and
+ * with SSL 3.0 SSL_RSA_WITH_ARCFOUR_128_MD5.  TCP.c and SSL.c are
+ * included so that the sockets can be driven directly.  The host MAC
+ * replays an empty capture, so every frame is dropped by MACFlush().
+ *
+ * First SHA-256, AES-GCM and the TLS 1.2 PRF are checked against known
+ * answers.  Then an SSL client socket and an SSL server socket are
+ * connected to each other: the bytes each one sends are copied into
+ * the RX FIFO of the other, until a full handshake is done.  The RSA
+ * module is a binary library, so it is replaced here by an identity
+ * "encryption" with a 512 bit dummy certificate; only the record layer
+ * is timed.
+ *
+ * For each record size, records are written with TCPPutArray() and
+ * sent with SSLTxRecord(), which encrypts them in place in the TX FIFO
+ * and sends them with SendTCP().  Their bytes are copied to the server,
+ * which decrypts and authenticates them with TCPSSLHandleIncoming(),
+ * and are read back with TCPGetArray() and compared.  Sending and
+ * receiving are timed separately.  The same pair of sockets is then
+ * rekeyed with ARCFOUR and MD5 and timed again.
+ *
+ * Last, a second pair of sockets resumes the session.  A record passed
+ * on in two parts must not be released before its tag has arrived, a
+ * record with one byte changed must be answered with a bad_record_mac
+ * alert and release nothing, and a record header longer than the RX
+ * FIFO must be answered with a record_overflow alert.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -I. -I$S -I$S/Include -DHOST_SSL_BENCH -o sslbench \
+ *       SSLBench.c HostAppConfig.c "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP}.c \
+ *       "$S/TCPIP Stack/"{ARCFOUR,AESGCM,Hashes,Random}.c && ./sslbench
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+#include "TCPIP Stack/SSL.c"
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__i386__) || defined(__x86_64__)
+	#include <x86intrin.h>
+#endif
+
+#define BENCH_BYTES			(4ul*1024*1024)	// Application bytes per measurement
+#define BENCH_HANDSHAKE_ROUNDS	(50u)		// Exchanges allowed per handshake
+#define BENCH_LOCAL_PORT	(10000u)
+#define BENCH_REMOTE_PORT	(40000u)
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+// Dummy certificate: only the SubjectPublicKeyInfo, which is all that
+// SSLRxServerCertificate() reads.  N is 64 bytes, E is 65537.
+ROM BYTE SSL_CERT[] = {
+	0x30, 0x5C, 0x30, 0x0D, 0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01, 0x05,
+	0x00, 0x03, 0x4B, 0x00, 0x30, 0x48, 0x02, 0x41, 0x00,
+	0xC3, 0x5A, 0x19, 0x7E, 0x42, 0x88, 0x0B, 0x6D, 0xF1, 0x27, 0x93, 0x4C, 0xD0, 0x15, 0xA8, 0x3E,
+	0x61, 0xBC, 0x0F, 0x72, 0xE4, 0x39, 0x96, 0x2A, 0x5D, 0xC7, 0x08, 0x8B, 0x34, 0xFE, 0x63, 0x11,
+	0x9A, 0x4F, 0xD2, 0x26, 0x7B, 0xE0, 0x53, 0xAC, 0x18, 0x85, 0x3A, 0xCF, 0x64, 0x07, 0xB9, 0x2D,
+	0xF6, 0x41, 0x9C, 0x13, 0x6E, 0xA5, 0x30, 0xDB, 0x47, 0x82, 0x1F, 0xEA, 0x75, 0x0C, 0xB3, 0x59,
+	0x02, 0x03, 0x01, 0x00, 0x01
+};
+ROM WORD SSL_CERT_LEN = sizeof(SSL_CERT);
+
+// State of the RSA stand-in
+static struct
+{
+	RSA_OP op;				// Operation in progress
+	WORD wKeyLen;			// Key length in bytes
+	BYTE* pData;			// Input
+	WORD wDataLen;			// Input length
+	BYTE* pResult;			// Output, or NULL to work in place
+} rsa;
+
+static BYTE vData[4096];
+static BYTE vWire[8192];
+static BYTE vRead[4096];
+
+// Private helper functions.
+static BOOL CheckKnownAnswers(void);
+static TCP_SOCKET ConnectSocket(WORD wPort);
+static BOOL Handshake(TCP_SOCKET hClient, TCP_SOCKET hServer);
+static void ServiceSSL(TCP_SOCKET hTCP);
+static WORD Transfer(TCP_SOCKET hFrom, TCP_SOCKET hTo, BOOL bTamper);
+static void Deliver(TCP_SOCKET hTo, BYTE* vBytes, WORD wLen);
+static void Rekey(TCP_SOCKET hTCP);
+static BOOL TimeRecords(TCP_SOCKET hClient, TCP_SOCKET hServer, WORD wRecord);
+
+int main(void)
+{
+	static const WORD wRecords[] = {256, 1024, 4096};
+	TCP_SOCKET hClient, hServer;
+	WORD w;
+	BYTE i;
+
+	// Replay an empty capture: the link is up and nothing is received
+	if(!InitHostReplay())
+		return 1;
+
+	for(w = 0; w < sizeof(vData); w++)
+		vData[w] = (BYTE)LFSRRand();
+
+	TCPInit();
+	RandomInit();
+	SSLInit();
+
+	if(!CheckKnownAnswers())
+		return 1;
+	printf("SHA-256, AES-GCM and TLS 1.2 PRF known answers verified\n");
+
+	// Full handshake, then both ciphers on the same connection
+	hClient = ConnectSocket(BENCH_LOCAL_PORT);
+	hServer = ConnectSocket(BENCH_LOCAL_PORT + 1);
+	if(!TCPStartSSLClient(hClient, NULL) || !TCPStartSSLServer(hServer) || !Handshake(hClient, hServer))
+		return 1;
+	printf("full handshake done\n");
+
+	printf("TLS 1.2 AES-128-GCM-SHA256:\n");
+	for(i = 0; i < sizeof(wRecords)/sizeof(wRecords[0]); i++)
+	{
+		if(!TimeRecords(hClient, hServer, wRecords[i]))
+			return 1;
+	}
+
+	Rekey(hClient);
+	Rekey(hServer);
+	printf("SSL 3.0 ARCFOUR-128-MD5:\n");
+	for(i = 0; i < sizeof(wRecords)/sizeof(wRecords[0]); i++)
+	{
+		if(!TimeRecords(hClient, hServer, wRecords[i]))
+			return 1;
+	}
+
+	SyncTCBStub(hClient);
+	CloseSocket();
+	SyncTCBStub(hServer);
+	CloseSocket();
+
+	// Resumed handshake, then records that must not release any data
+	hClient = ConnectSocket(BENCH_LOCAL_PORT + 2);
+	hServer = ConnectSocket(BENCH_LOCAL_PORT + 3);
+	if(!TCPStartSSLClient(hClient, NULL) || !TCPStartSSLServer(hServer) || !Handshake(hClient, hServer))
+		return 1;
+	SyncTCBStub(hServer);
+	SSLStubSync(MyTCBStub.sslStubID);
+	if(sslStub.Flags.bNewSession)
+	{
+		printf("the session was not resumed\n");
+		return 1;
+	}
+	printf("resumed handshake done\n");
+
+	// A record is held in the RX FIFO until its tag has been checked
+	TCPPutArray(hClient, vData, 256);
+	ServiceSSL(hClient);
+	w = Transfer(hClient, INVALID_SOCKET, FALSE);
+	Deliver(hServer, vWire, w - 1);
+	TCPSSLHandleIncoming(hServer);
+	if(TCPIsGetReady(hServer) != 0u)
+	{
+		printf("a record was released before its tag arrived\n");
+		return 1;
+	}
+	Deliver(hServer, &vWire[w - 1], 1);
+	TCPSSLHandleIncoming(hServer);
+	if(TCPGetArray(hServer, vRead, sizeof(vRead)) != 256u || memcmp(vRead, vData, 256))
+	{
+		printf("a record passed on in two parts was lost\n");
+		return 1;
+	}
+	printf("record held until its tag arrived\n");
+
+	TCPPutArray(hClient, vData, 256);
+	ServiceSSL(hClient);
+	Transfer(hClient, hServer, TRUE);
+	TCPSSLHandleIncoming(hServer);
+	SyncTCBStub(hServer);
+	if(MyTCBStub.sslReqMessage != SSL_ALERT_BAD_RECORD_MAC || TCPIsGetReady(hServer) != 0u)
+	{
+		printf("a tampered record was accepted\n");
+		return 1;
+	}
+	printf("tampered record rejected\n");
+
+	// The server's alert is still pending, so the client is sent a header
+	// whose record could never fit.  Only the header is needed.
+	vWire[0] = SSL_APPLICATION;
+	vWire[1] = SSL_VERSION_HI;
+	vWire[2] = SSL_VERSION_LO;
+	vWire[3] = 0x3F;
+	vWire[4] = 0xFF;
+	Deliver(hClient, vWire, 5);
+	TCPSSLHandleIncoming(hClient);
+	SyncTCBStub(hClient);
+	if(MyTCBStub.sslReqMessage != SSL_ALERT_RECORD_OVERFLOW || TCPIsGetReady(hClient) != 0u)
+	{
+		printf("a record longer than the RX FIFO was accepted\n");
+		return 1;
+	}
+	printf("oversized record refused\n");
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        BOOL RSABeginUsage(RSA_OP op, WORD vKeyByteLen)
+ *
+ * PreCondition:    None
+ *
+ * Input:           op - RSA_OP_ENCRYPT or RSA_OP_DECRYPT
+ *                  vKeyByteLen - length of the key in bytes
+ *
+ * Output:          TRUE
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Starts an operation of the RSA stand-in.  Together
+ *                  with the functions below, it replaces the RSA module
+ *                  with an identity function: "encryption" right aligns
+ *                  the data in the key length and "decryption" leaves
+ *                  it where it is.
+ *
+ * Note:            The dummy certificate carries no private key, and the
+ *                  RSA time is not of interest here.
+ ********************************************************************/
+BOOL RSABeginUsage(RSA_OP op, WORD vKeyByteLen)
+{
+	memset((void*)&rsa, 0x00, sizeof(rsa));
+	rsa.op = op;
+	rsa.wKeyLen = vKeyByteLen;
+	return TRUE;
+}
+
+void RSAEndUsage(void)
+{
+}
+
+void RSASetData(BYTE* data, WORD len, RSA_DATA_FORMAT format)
+{
+	rsa.pData = data;
+	rsa.wDataLen = len;
+}
+
+void RSASetResult(BYTE* data, RSA_DATA_FORMAT format)
+{
+	rsa.pResult = data;
+}
+
+void RSASetE(BYTE* data, BYTE len, RSA_DATA_FORMAT format)
+{
+}
+
+void RSASetN(BYTE* data, RSA_DATA_FORMAT format)
+{
+}
+
+RSA_STATUS RSAStep(void)
+{
+	if(rsa.op == RSA_OP_ENCRYPT)
+	{
+		memset((void*)rsa.pResult, 0x00, rsa.wKeyLen - rsa.wDataLen);
+		memcpy((void*)(rsa.pResult + rsa.wKeyLen - rsa.wDataLen), (void*)rsa.pData, rsa.wDataLen);
+	}
+	return RSA_DONE;
+}
+
+/*********************************************************************
+ * Function:        static BOOL CheckKnownAnswers(void)
+ *
+ * PreCondition:    SSLInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          TRUE if all answers are right
+ *
+ * Side Effects:    Prints the first wrong answer.  Overwrites
+ *                  sslSession and sslHash.
+ *
+ * Overview:        Checks SHA-256 with the "abc" message of FIPS 180-2,
+ *                  AES-GCM with test case 4 of the GCM specification
+ *                  and the TLS 1.2 PRF with a P_SHA256 vector.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL CheckKnownAnswers(void)
+{
+	static ROM BYTE vSHA256[32] = {
+		0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+		0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD};
+	static ROM BYTE vKey[16] = {
+		0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08};
+	static ROM BYTE vIV[12] = {
+		0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88};
+	static ROM BYTE vAAD[20] = {
+		0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+		0xAB, 0xAD, 0xDA, 0xD2};
+	static ROM BYTE vPlain[60] = {
+		0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A,
+		0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA, 0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72,
+		0x1C, 0x3C, 0x0C, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+		0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39};
+	static ROM BYTE vCipher[60+16] = {
+		0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72, 0x21, 0xB7, 0x84, 0xD0, 0xD4, 0x9C,
+		0xE3, 0xAA, 0x21, 0x2F, 0x2C, 0x02, 0xA4, 0xE0, 0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC, 0xA1, 0x2E,
+		0x21, 0xD5, 0x14, 0xB2, 0x54, 0x66, 0x93, 0x1C, 0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05,
+		0x1B, 0xA3, 0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91,
+		0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB, 0x94, 0xFA, 0xE9, 0x5A, 0xE7, 0x12, 0x1A, 0x47};
+	static ROM BYTE vPRF[40] = {
+		0x25, 0xB8, 0x93, 0x2C, 0x08, 0x24, 0xC8, 0xF2, 0x96, 0x26, 0x38, 0xEC, 0x1C, 0x6E, 0xC9, 0x9E,
+		0x1B, 0x07, 0x45, 0x7B, 0xC2, 0x65, 0x27, 0x8C, 0x23, 0x06, 0x4C, 0x1D, 0x63, 0xC6, 0x1E, 0x04,
+		0x17, 0x05, 0x35, 0x67, 0xED, 0x3A, 0x0D, 0x6C};
+	static DWORD dwTable[64];
+	AES_GCM_CTX ctx;
+	HASH_SUM hash;
+	BYTE vOut[60+16], vSeed[64];
+	BYTE i;
+
+	SHA256Initialize(&hash);
+	SHA256AddData(&hash, (BYTE*)"abc", 3);
+	SHA256Calculate(&hash, vOut);
+	if(memcmp(vOut, vSHA256, 32))
+	{
+		printf("wrong SHA-256 hash\n");
+		return FALSE;
+	}
+
+	// Encrypt, then decrypt back
+	ctx.table = dwTable;
+	AESGCMInitialize(&ctx, (BYTE*)vKey, (BYTE*)vIV);
+	AESGCMStart(&ctx, (BYTE*)&vIV[4], (BYTE*)vAAD, sizeof(vAAD));
+	memcpy((void*)vOut, (void*)vPlain, sizeof(vPlain));
+	AESGCMEncrypt(&ctx, vOut, 7);
+	AESGCMEncrypt(&ctx, &vOut[7], sizeof(vPlain) - 7);
+	AESGCMCalculate(&ctx, &vOut[sizeof(vPlain)]);
+	if(memcmp(vOut, vCipher, sizeof(vCipher)))
+	{
+		printf("wrong AES-GCM encryption\n");
+		return FALSE;
+	}
+	AESGCMStart(&ctx, (BYTE*)&vIV[4], (BYTE*)vAAD, sizeof(vAAD));
+	AESGCMDecrypt(&ctx, vOut, sizeof(vPlain));
+	AESGCMCalculate(&ctx, &vOut[sizeof(vPlain)]);
+	if(memcmp(vOut, vPlain, sizeof(vPlain)) || memcmp(&vOut[sizeof(vPlain)], &vCipher[sizeof(vPlain)], 16))
+	{
+		printf("wrong AES-GCM decryption\n");
+		return FALSE;
+	}
+
+	// Secret 00..2F, seed 40..7F
+	for(i = 0; i < 48u; i++)
+		sslSession.masterSecret[i] = i;
+	for(i = 0; i < 64u; i++)
+		vSeed[i] = 0x40 + i;
+	GeneratePRF((ROM BYTE*)"key expansion", 13, vSeed, &vSeed[32], vOut, sizeof(vPRF));
+	if(memcmp(vOut, vPRF, sizeof(vPRF)))
+	{
+		printf("wrong TLS 1.2 PRF output\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static TCP_SOCKET ConnectSocket(WORD wPort)
+ *
+ * PreCondition:    TCPInit() has been called.
+ *
+ * Input:           wPort - local port
+ *
+ * Output:          The connected socket
+ *
+ * Side Effects:    Exits if the socket cannot be opened.
+ *
+ * Overview:        Opens a server socket on wPort and connects it by
+ *                  passing a SYN to FindMatchingSocket().
+ *
+ * Note:            As in TxBench.c, with the windows opened wide.
+ ********************************************************************/
+static TCP_SOCKET ConnectSocket(WORD wPort)
+{
+	TCP_SOCKET hTCP;
+	TCP_HEADER header;
+	NODE_INFO remote;
+
+	remote.IPAddr.Val = 0x0101A8C0ul;			// 192.168.1.1
+	memset((void*)&remote.MACAddr, 0x02, sizeof(MAC_ADDR));
+	memset((void*)&header, 0x00, sizeof(header));
+	header.SourcePort = BENCH_REMOTE_PORT;
+	header.DestPort = wPort;
+	header.Flags.bits.flagSYN = 1;
+
+	hTCP = TCPOpen(0, TCP_OPEN_SERVER, wPort, TCP_PURPOSE_DEFAULT);
+	if(hTCP == INVALID_SOCKET || !FindMatchingSocket(&header, &remote) || hCurrentTCP != hTCP)
+	{
+		printf("cannot connect the TCP socket\n");
+		exit(1);
+	}
+
+	SyncTCB();
+	MyTCBStub.smState = TCP_ESTABLISHED;
+	MyTCB.wRemoteMSS = TCP_MAX_SEG_SIZE_TX - 12u;
+	MyTCB.flags.bTimestamps = 1;
+	MyTCB.flags.bSACK = 1;
+	MyTCB.remoteWindow = 0xFFFF;
+	MyTCB.wCongWindow = 0xFFFF;
+	return hTCP;
+}
+
+/*********************************************************************
+ * Function:        static BOOL Handshake(TCP_SOCKET hClient,
+ *                                        TCP_SOCKET hServer)
+ *
+ * PreCondition:    TCPStartSSLClient() has been called for hClient and
+ *                  TCPStartSSLServer() for hServer.
+ *
+ * Input:           hClient - client socket
+ *                  hServer - server socket
+ *
+ * Output:          TRUE if the handshake completed with AES-GCM
+ *
+ * Side Effects:    Prints why the handshake failed.
+ *
+ * Overview:        Lets each socket send what it has and passes it to
+ *                  the other one, until neither is handshaking.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL Handshake(TCP_SOCKET hClient, TCP_SOCKET hServer)
+{
+	BYTE i;
+	BYTE idClient;
+
+	for(i = 0; i < BENCH_HANDSHAKE_ROUNDS; i++)
+	{
+		if(!TCPSSLIsHandshaking(hClient) && !TCPSSLIsHandshaking(hServer))
+			break;
+		ServiceSSL(hClient);
+		if(Transfer(hClient, hServer, FALSE))
+			TCPSSLHandleIncoming(hServer);
+		ServiceSSL(hServer);
+		if(Transfer(hServer, hClient, FALSE))
+			TCPSSLHandleIncoming(hClient);
+	}
+
+	SyncTCBStub(hClient);
+	idClient = MyTCBStub.sslStubID;
+	SyncTCBStub(hServer);
+	if(i == BENCH_HANDSHAKE_ROUNDS || idClient == SSL_INVALID_ID || MyTCBStub.sslStubID == SSL_INVALID_ID)
+	{
+		printf("the handshake did not complete\n");
+		return FALSE;
+	}
+	SSLStubSync(idClient);
+	i = sslStub.cipher;
+	SSLStubSync(MyTCBStub.sslStubID);
+	if(i != SSL_CIPHER_AES_GCM || sslStub.cipher != SSL_CIPHER_AES_GCM)
+	{
+		printf("AES-GCM was not negotiated\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*********************************************************************
+ * Function:        static void ServiceSSL(TCP_SOCKET hTCP)
+ *
+ * PreCondition:    hTCP has an SSL session.
+ *
+ * Input:           hTCP - socket to service
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Does the SSL part of TCPTick(): the RSA work, then
+ *                  an application record with any pending data and any
+ *                  requested message.
+ *
+ * Note:            None
+ ********************************************************************/
+static void ServiceSSL(TCP_SOCKET hTCP)
+{
+	SyncTCBStub(hTCP);
+	if(MyTCBStub.sslStubID == SSL_INVALID_ID)
+		return;
+
+	SSLPeriodic(hTCP, MyTCBStub.sslStubID);
+	SyncTCBStub(hTCP);
+	if(MyTCBStub.sslTxHead != MyTCBStub.txHead && TCPSSLGetPendingTxSize(hTCP) != 0u)
+		SSLTxRecord(hTCP, MyTCBStub.sslStubID, SSL_APPLICATION);
+	if(MyTCBStub.sslReqMessage != SSL_NO_MESSAGE)
+		SSLTxMessage(hTCP, MyTCBStub.sslStubID, MyTCBStub.sslReqMessage);
+}
+
+/*********************************************************************
+ * Function:        static WORD Transfer(TCP_SOCKET hFrom,
+ *                                       TCP_SOCKET hTo, BOOL bTamper)
+ *
+ * PreCondition:    Both sockets are connected.
+ *
+ * Input:           hFrom - socket whose sent bytes are passed on
+ *                  hTo - socket that receives them, or INVALID_SOCKET
+ *                        to leave them in vWire only
+ *                  bTamper - TRUE to change the last byte
+ *
+ * Output:          Number of bytes passed
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Copies the unacknowledged bytes of hFrom's TX FIFO
+ *                  to vWire and acknowledges them, then passes them
+ *                  to hTo with Deliver().
+ *
+ * Note:            TCPSSLPutRecordHeader() has already sent them with
+ *                  SendTCP().  The caller passes them to the SSL module
+ *                  with TCPSSLHandleIncoming().
+ ********************************************************************/
+static WORD Transfer(TCP_SOCKET hFrom, TCP_SOCKET hTo, BOOL bTamper)
+{
+	PTR_BASE ptr;
+	WORD wLen;
+
+	SyncTCBStub(hFrom);
+	SyncTCB();
+	for(wLen = 0, ptr = MyTCBStub.txTail; ptr != MyTCBStub.txHead; wLen++)
+	{
+		vWire[wLen] = *(BYTE*)ptr;
+		if(++ptr >= MyTCBStub.bufferRxStart)
+			ptr = MyTCBStub.bufferTxStart;
+	}
+	MyTCBStub.txTail = MyTCBStub.txHead;
+	MyTCB.txUnackedTail = MyTCBStub.txHead;
+	MyTCB.remoteWindow = 0xFFFF;
+	MyTCB.wCongWindow = 0xFFFF;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	MyTCBStub.Flags.bTimer2Enabled = 0;
+	MyTCBStub.Flags.bHalfFullFlush = 0;
+	if(wLen == 0u)
+		return 0;
+	if(bTamper)
+		vWire[wLen - 1] ^= 0x01;
+
+	if(hTo != INVALID_SOCKET)
+		Deliver(hTo, vWire, wLen);
+	return wLen;
+}
+
+/*********************************************************************
+ * Function:        static void Deliver(TCP_SOCKET hTo, BYTE* vBytes,
+ *                                      WORD wLen)
+ *
+ * PreCondition:    hTo is connected.
+ *
+ * Input:           hTo - socket that receives the bytes
+ *                  vBytes - bytes received
+ *                  wLen - number of bytes
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Adds the bytes to hTo's RX FIFO.  As in TCPProcess(),
+ *                  they are added at sslRxHead.
+ *
+ * Note:            The caller passes them to the SSL module with
+ *                  TCPSSLHandleIncoming().
+ ********************************************************************/
+static void Deliver(TCP_SOCKET hTo, BYTE* vBytes, WORD wLen)
+{
+	PTR_BASE ptr;
+	WORD w;
+
+	SyncTCBStub(hTo);
+	for(w = 0, ptr = MyTCBStub.sslRxHead; w < wLen; w++)
+	{
+		*(BYTE*)ptr = vBytes[w];
+		if(++ptr > MyTCBStub.bufferEnd)
+			ptr = MyTCBStub.bufferRxStart;
+	}
+	MyTCBStub.sslRxHead = ptr;
+}
+
+/*********************************************************************
+ * Function:        static void Rekey(TCP_SOCKET hTCP)
+ *
+ * PreCondition:    The handshake is done.
+ *
+ * Input:           hTCP - socket to rekey
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Switches the connection to ARCFOUR and MD5, with
+ *                  keys made from the master secret and fixed random
+ *                  values, as the SSL 3.0 handshake would.
+ *
+ * Note:            Both ends must be rekeyed before the next record.
+ ********************************************************************/
+static void Rekey(TCP_SOCKET hTCP)
+{
+	SyncTCBStub(hTCP);
+	SSLStubSync(MyTCBStub.sslStubID);
+	sslStub.cipher = SSL_CIPHER_ARCFOUR_MD5;
+	SSLHashAlloc(&sslStub.idRxHash);
+
+	SSLSessionSync(sslStub.idSession);
+	SSLKeysSync(sslStubID);
+	memset((void*)sslKeys.Local.random, sslStub.Flags.bIsServer ? 0x53 : 0x43, 32);
+	memset((void*)sslKeys.Remote.random, sslStub.Flags.bIsServer ? 0x43 : 0x53, 32);
+	SSLBufferSync(SSL_INVALID_ID);
+	SSLHashSync(SSL_INVALID_ID);
+	GenerateSessionKeys();
+	sslKeys.Local.app.sequence = 0;
+	sslKeys.Remote.app.sequence = 0;
+}
+
+/*********************************************************************
+ * Function:        static BOOL TimeRecords(TCP_SOCKET hClient,
+ *                                          TCP_SOCKET hServer,
+ *                                          WORD wRecord)
+ *
+ * PreCondition:    The handshake is done.
+ *
+ * Input:           hClient - socket that sends
+ *                  hServer - socket that receives
+ *                  wRecord - application bytes per record
+ *
+ * Output:          TRUE if every record was received intact
+ *
+ * Side Effects:    Prints the times per byte.
+ *
+ * Overview:        Sends BENCH_BYTES in records of wRecord bytes, from
+ *                  the client to the server, timing the sending and
+ *                  the receiving apart.
+ *
+ * Note:            Each record starts at a different offset of vData.
+ ********************************************************************/
+static BOOL TimeRecords(TCP_SOCKET hClient, TCP_SOCKET hServer, WORD wRecord)
+{
+	QWORD qwTxCycles, qwRxCycles, qw;
+	DWORD dwBytes, dwOffset;
+	double dTxNs, dRxNs, start;
+
+	dwBytes = 0;
+	dwOffset = 0;
+	qwTxCycles = 0;
+	qwRxCycles = 0;
+	dTxNs = 0;
+	dRxNs = 0;
+	while(dwBytes < BENCH_BYTES)
+	{
+		dwOffset = (dwOffset + 97) % (sizeof(vData) - wRecord + 1);
+
+		qw = 0;
+		start = NowNs(CLOCK_MONOTONIC);
+		#if defined(__i386__) || defined(__x86_64__)
+		qw = __rdtsc();
+		#endif
+		if(TCPPutArray(hClient, &vData[dwOffset], wRecord) != wRecord)
+		{
+			printf("no room for a %u byte record\n", wRecord);
+			return FALSE;
+		}
+		SyncTCBStub(hClient);
+		SSLTxRecord(hClient, MyTCBStub.sslStubID, SSL_APPLICATION);
+		#if defined(__i386__) || defined(__x86_64__)
+		qwTxCycles += __rdtsc() - qw;
+		#endif
+		dTxNs += NowNs(CLOCK_MONOTONIC) - start;
+
+		Transfer(hClient, hServer, FALSE);
+
+		start = NowNs(CLOCK_MONOTONIC);
+		#if defined(__i386__) || defined(__x86_64__)
+		qw = __rdtsc();
+		#endif
+		TCPSSLHandleIncoming(hServer);
+		if(TCPGetArray(hServer, vRead, sizeof(vRead)) != wRecord)
+		{
+			printf("a %u byte record was lost\n", wRecord);
+			return FALSE;
+		}
+		#if defined(__i386__) || defined(__x86_64__)
+		qwRxCycles += __rdtsc() - qw;
+		#endif
+		dRxNs += NowNs(CLOCK_MONOTONIC) - start;
+
+		if(memcmp(vRead, &vData[dwOffset], wRecord))
+		{
+			printf("a %u byte record was corrupted\n", wRecord);
+			return FALSE;
+		}
+		dwBytes += wRecord;
+	}
+
+	printf("%5u byte records: send %6.3f ns per byte (%5.0f MB/s), receive %6.3f ns per byte (%5.0f MB/s)",
+		wRecord, dTxNs / dwBytes, dwBytes * 1000.0 / dTxNs, dRxNs / dwBytes, dwBytes * 1000.0 / dRxNs);
+	if(qwTxCycles)
+		printf(", %5.1f/%5.1f cycles per byte", (double)qwTxCycles / dwBytes, (double)qwRxCycles / dwBytes);
+	printf("\n");
+	return TRUE;
+}
@@ -0,0 +1,268 @@
+/*********************************************************************
+ *
+ *	Microchip TCP/IP Stack Demo Application Configuration Header
+ *
+ *********************************************************************
+ * FileName:        TCPIPConfig.h
+ * Dependencies:    Microchip TCP/IP Stack
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Configuration of the host build.  The sockets are sized for the
+ * TCPPerformanceTest and UDPPerformanceTest modules.
+ ********************************************************************/
+#ifndef __TCPIPCONFIG_H
+#define __TCPIPCONFIG_H
+
+#include "GenericTypeDefs.h"
+#include "Compiler.h"
+
+// =======================================================================
+//   Application Options
+// =======================================================================
+
+#define STACK_USE_ICMP_SERVER			// Ping query and response capability
+#define STACK_USE_TCP_PERFORMANCE_TEST	// Module for testing TCP TX performance characteristics.  NOTE: Affects performance of other tasks.
+#define STACK_USE_UDP_PERFORMANCE_TEST	// Module for testing UDP TX performance characteristics.  NOTE: Affects performance of other tasks.
+
+// The benchmarks open client sockets
+#define STACK_CLIENT_MODE
+
+// MPFSBench.c serves files from an MPFS2 image in RAM (MPFS_Start[]),
+// LookupBench.c opens them, and HTTPBench.c, InflateBench.c and 
+// LoadBench.c serve them with the HTTP2 server.  CacheBench.c serves 
+// them from an image in SPI Flash (SPIFlashHost.c), through the MPFS2 
+// read cache unless built with -DMPFS_CACHE_PAGES=0.
+#if defined(HOST_CACHE_BENCH)
+	#define MPFS_USE_SPI_FLASH
+	#define MPFS_RESERVE_BLOCK			(0ul)
+	#if !defined(MPFS_CACHE_PAGES)
+		#define MPFS_CACHE_PAGES		(32u)
+	#endif
+#endif
+#if defined(HOST_MPFS_BENCH) || defined(HOST_HTTP_BENCH) || defined(HOST_LOAD_BENCH) || defined(HOST_CACHE_BENCH)
+	#define STACK_USE_MPFS2
+	#if defined(HOST_LOAD_BENCH)
+		#define MAX_MPFS_HANDLES			(2ul*MAX_HTTP_CONNECTIONS+1ul)
+	#else
+		#define MAX_MPFS_HANDLES			(7ul)
+	#endif
+#endif
+#if defined(HOST_HTTP_BENCH) || defined(HOST_LOAD_BENCH) || defined(HOST_CACHE_BENCH)
+	#define STACK_USE_HTTP2_SERVER
+#endif
+
+// SSLBench.c connects SSL clients to SSL servers in the same stack, 
+// with TLS 1.2 AES-GCM and with SSL 3.0 ARCFOUR
+#if defined(HOST_SSL_BENCH)
+	#define STACK_USE_SSL_SERVER
+	#define STACK_USE_SSL_CLIENT
+	#define STACK_USE_SSL_AES_GCM
+#endif
+
+// =======================================================================
+//   Network Addressing Options
+// =======================================================================
+
+#define MY_DEFAULT_HOST_NAME			"HOSTSTACK"
+
+#define MY_DEFAULT_MAC_BYTE1            (0x00)	// Locally chosen, the
+#define MY_DEFAULT_MAC_BYTE2            (0x04)	// TAP interface has its
+#define MY_DEFAULT_MAC_BYTE3            (0xA3)	// own address on the
+#define MY_DEFAULT_MAC_BYTE4            (0x01)	// host side
+#define MY_DEFAULT_MAC_BYTE5            (0x02)
+#define MY_DEFAULT_MAC_BYTE6            (0x03)
+
+#define MY_DEFAULT_IP_ADDR_BYTE1        (192ul)	// Host side of the TAP
+#define MY_DEFAULT_IP_ADDR_BYTE2        (168ul)	// is 192.168.1.1
+#define MY_DEFAULT_IP_ADDR_BYTE3        (1ul)
+#define MY_DEFAULT_IP_ADDR_BYTE4        (2ul)
+
+#define MY_DEFAULT_MASK_BYTE1           (0xFFul)
+#define MY_DEFAULT_MASK_BYTE2           (0xFFul)
+#define MY_DEFAULT_MASK_BYTE3           (0xFFul)
+#define MY_DEFAULT_MASK_BYTE4           (0x00ul)
+
+#define MY_DEFAULT_GATE_BYTE1           (192ul)
+#define MY_DEFAULT_GATE_BYTE2           (168ul)
+#define MY_DEFAULT_GATE_BYTE3           (1ul)
+#define MY_DEFAULT_GATE_BYTE4           (1ul)
+
+#define MY_DEFAULT_PRIMARY_DNS_BYTE1	(192ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE2	(168ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE3	(1ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE4	(1ul)
+
+#define MY_DEFAULT_SECONDARY_DNS_BYTE1	(0ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE2	(0ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE3	(0ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE4	(0ul)
+
+// =======================================================================
+//   Transport Layer Options
+// =======================================================================
+
+// Allocate how much total RAM (in bytes) you want to allocate
+// for use by your TCP TCBs, RX FIFOs, and TX FIFOs.  The host MAC
+// has no Ethernet RAM, so everything is in TCP_PIC_RAM.  Each socket
+// takes a TCB of 105 to 116 bytes with TCP_SACK, or 74 to 84 bytes
+// without it (see TCP.h), where it took 41 to 48 bytes before the
+// congestion control and TCP option support was added.  Sizes carried
+// over from older configurations may need to grow to fit.
+#define TCP_ETH_RAM_SIZE					(0ul)
+#if defined(HOST_POOL_BENCH)
+	#define TCP_PIC_RAM_SIZE				(32768ul)
+#else
+	#define TCP_PIC_RAM_SIZE				(131072ul)
+#endif
+#define TCP_SPI_RAM_SIZE					(0ul)
+#define TCP_SPI_RAM_BASE_ADDRESS			(0x00)
+
+// PoolBench.c allocates the FIFOs per connection (TCP_DYNAMIC_FIFOS in 
+// TCP.c) unless built with -DTCP_DYNAMIC_FIFOS=0
+#if defined(HOST_POOL_BENCH)
+	#if !defined(HOST_POOL_HTTP_SOCKETS)
+		#define HOST_POOL_HTTP_SOCKETS		(16u)
+	#endif
+	#if !defined(TCP_DYNAMIC_FIFOS)
+		#define TCP_DYNAMIC_FIFOS			(1u)
+	#endif
+#endif
+
+// The host benchmarks run on a LAN or TAP link, so retransmissions may 
+// start after 20 ms instead of the 200 ms default of TCP.c
+#if !defined(TCP_MIN_RTO_VAL)
+	#define TCP_MIN_RTO_VAL					((DWORD)TICK_SECOND/50)
+#endif
+
+// Define names of socket types
+#define TCP_SOCKET_TYPES
+	#define TCP_PURPOSE_GENERIC_TCP_CLIENT 0
+	#define TCP_PURPOSE_GENERIC_TCP_SERVER 1
+	#define TCP_PURPOSE_TELNET 2
+	#define TCP_PURPOSE_FTP_COMMAND 3
+	#define TCP_PURPOSE_FTP_DATA 4
+	#define TCP_PURPOSE_TCP_PERFORMANCE_TX 5
+	#define TCP_PURPOSE_TCP_PERFORMANCE_RX 6
+	#define TCP_PURPOSE_UART_2_TCP_BRIDGE 7
+	#define TCP_PURPOSE_HTTP_SERVER 8
+	#define TCP_PURPOSE_DEFAULT 9
+	#define TCP_PURPOSE_BERKELEY_SERVER 10
+	#define TCP_PURPOSE_BERKELEY_CLIENT 11
+#define END_OF_TCP_SOCKET_TYPES
+
+#if defined(__TCP_C)
+	// Define what types of sockets are needed, how many of
+	// each to include, where their TCB, TX FIFO, and RX FIFO
+	// should be stored, and how big the RX and TX FIFOs should
+	// be.
+	#define TCP_CONFIGURATION
+	ROM struct
+	{
+		BYTE vSocketPurpose;
+		BYTE vMemoryMedium;
+		WORD wTXBufferSize;
+		WORD wRXBufferSize;
+	} TCPSocketInitializer[] =
+	{
+	#if defined(HOST_BENCH_SOCKETS)
+		// DemuxBench.c and ARPBench.c: HOST_BENCH_SOCKETS small sockets 
+		// of one type
+		[0 ... HOST_BENCH_SOCKETS-1] = {TCP_PURPOSE_DEFAULT, TCP_PIC_RAM, 64, 64},
+	#elif defined(HOST_UPLOAD_BENCH)
+		// UploadBench.c: one receive socket with about the largest window 
+		// a WORD sized FIFO allows
+		{TCP_PURPOSE_TCP_PERFORMANCE_RX, TCP_PIC_RAM, 40, 65000},
+	#elif defined(HOST_POOL_BENCH)
+		// PoolBench.c: the services of a demo application, followed by 
+		// HOST_POOL_HTTP_SOCKETS HTTP sockets
+		{TCP_PURPOSE_GENERIC_TCP_CLIENT, TCP_PIC_RAM, 125, 100},
+		{TCP_PURPOSE_GENERIC_TCP_SERVER, TCP_PIC_RAM, 20, 20},
+		{TCP_PURPOSE_TELNET, TCP_PIC_RAM, 200, 150},
+		{TCP_PURPOSE_FTP_COMMAND, TCP_PIC_RAM, 100, 40},
+		{TCP_PURPOSE_FTP_DATA, TCP_PIC_RAM, 0, 128},
+		{TCP_PURPOSE_TCP_PERFORMANCE_TX, TCP_PIC_RAM, 200, 1},
+		{TCP_PURPOSE_TCP_PERFORMANCE_RX, TCP_PIC_RAM, 40, 1500},
+		{TCP_PURPOSE_UART_2_TCP_BRIDGE, TCP_PIC_RAM, 256, 256},
+		{TCP_PURPOSE_DEFAULT, TCP_PIC_RAM, 200, 200},
+		{TCP_PURPOSE_BERKELEY_SERVER, TCP_PIC_RAM, 25, 20},
+		[10 ... 10+HOST_POOL_HTTP_SOCKETS-1] = {TCP_PURPOSE_HTTP_SERVER, TCP_PIC_RAM, 1024, 1024},
+	#elif defined(HOST_HTTP_BENCH) || defined(HOST_CACHE_BENCH)
+		// HTTPBench.c and CacheBench.c: one socket per HTTP connection 
+		// (MAX_HTTP_CONNECTIONS)
+		[0 ... 2] = {TCP_PURPOSE_HTTP_SERVER, TCP_PIC_RAM, 1024, 1024},
+	#elif defined(HOST_LOAD_BENCH)
+		// LoadBench.c: one socket per HTTP connection 
+		// (MAX_HTTP_CONNECTIONS)
+		[0 ... 49] = {TCP_PURPOSE_HTTP_SERVER, TCP_PIC_RAM, 1024, 1024},
+	#elif defined(HOST_SSL_BENCH)
+		// SSLBench.c: two client and server pairs
+		[0 ... 3] = {TCP_PURPOSE_DEFAULT, TCP_PIC_RAM, 8192, 8192},
+	#else
+		{TCP_PURPOSE_TCP_PERFORMANCE_TX, TCP_PIC_RAM, 16384, 40},
+		{TCP_PURPOSE_TCP_PERFORMANCE_RX, TCP_PIC_RAM, 40, 16384},
+		{TCP_PURPOSE_DEFAULT, TCP_PIC_RAM, 1000, 1000},
+	#endif
+	};
+	#define END_OF_TCP_CONFIGURATION
+#endif
+
+// Maximum number of simultaneously open sockets
+#if defined(HOST_BENCH_SOCKETS)
+	#define MAX_UDP_SOCKETS     (HOST_BENCH_SOCKETS)
+#else
+	#define MAX_UDP_SOCKETS     (10u)
+#endif
+
+// =======================================================================
+//   Application-Specific Options
+// =======================================================================
+
+// -- HTTP2 Server options -----------------------------------------------
+
+	// Maximum numbers of simultaneous HTTP connections allowed.
+	// Each connection consumes 2 bytes of RAM and a TCP socket
+	#if defined(HOST_LOAD_BENCH)
+		#define MAX_HTTP_CONNECTIONS	(50u)
+	#else
+		#define MAX_HTTP_CONNECTIONS	(3u)
+	#endif
+
+	// Indicate what file to serve when no specific one is requested
+	#define HTTP_DEFAULT_FILE		"index.htm"
+	#define HTTPS_DEFAULT_FILE		"index.htm"
+	#define HTTP_DEFAULT_LEN		(10u)		// For buffer overrun protection.
+												// Set to longest length of above two strings.
+
+	// Configure MPFS over HTTP updating
+	// Comment this line to disable updating via HTTP
+	#define HTTP_MPFS_UPLOAD		"mpfsupload"
+
+	// Optionally store HTTP data in the Ethernet buffer RAM
+	#define HTTP_USE_POST			// Enable POST support
+	#define HTTP_USE_COOKIES		// Enable cookie support
+	#define HTTP_USE_AUTHENTICATION	// Enable basic authentication support
+	#define HTTP_USE_KEEPALIVE		// Enable persistent connections and pipelining
+	#define HTTP_USE_INFLATE		// Decompress GZIP files for clients that do not accept them
+
+	// Maximum data length for authentication, cookies, and GET/POST arguments
+	#define HTTP_MAX_DATA_LEN		(100u)
+
+	// Minimum space before the HTTP module calls a callback
+	#define HTTP_MIN_CALLBACK_FREE	(16u)
+
+	// The host MAC has no Ethernet RAM to save the connection states in
+	#define HTTP_SAVE_CONTEXT_IN_PIC_RAM
+
+// -- SSL Options --------------------------------------------------------
+
+	#define MAX_SSL_CONNECTIONS		(2ul)	// Maximum connections via SSL
+	#define MAX_SSL_SESSIONS		(2ul)	// Max # of cached SSL sessions
+	#define MAX_SSL_BUFFERS			(4ul)	// Max # of SSL buffers (2 per socket)
+	#define MAX_SSL_HASHES			(6ul)	// Max # of SSL hashes (3 per socket while handshaking)
+
+	// Bits in SSL RSA key.  SSLBench.c stands in for the RSA module, so
+	// only the size of the key matters.
+	#define SSL_RSA_KEY_SIZE		(512ul)
+
+#endif
@@ -0,0 +1,226 @@
+/*********************************************************************
+ *
+ *  TCP transmit CPU cost benchmark for the host build
+ *
+ *********************************************************************
+ * FileName:        TxBench.c
+ * Dependencies:    TCP.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Measures the CPU time SendTCP() takes per byte of data sent: copying
+ * the data from the TX FIFO to the MAC TX buffer, building the headers
+ * and calculating the TCP checksum.  TCP.c is included so that SendTCP()
+ * can be called directly.  The host MAC replays an empty capture, so the
+ * link is up and every frame is dropped by MACFlush() without a system
+ * call.
+ *
+ * One socket is connected as in DemuxBench.c, with timestamps on, as
+ * with Linux peers.  Each round fills the TX FIFO with TCPPutArray(),
+ * sends it as full sized segments and then treats it as acknowledged.
+ * The FIFO holds one byte less than a multiple of the round size, so
+ * the segments start at every alignment and some wrap around the end of
+ * the FIFO.  The checksums of the first rounds are verified.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -I. -I$S -I$S/Include -o txbench TxBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{ETHHost,Tick,Helpers,ARP,IP}.c && ./txbench
+ * Build with -DTCP_CHECKSUM_ON_COPY=1 to sum the data while it is
+ * copied instead of summing the MAC TX buffer again.
+ ********************************************************************/
+
+#include "TCPIP Stack/TCP.c"
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+	#include <x86intrin.h>
+#endif
+
+#define BENCH_ROUNDS		(20000ul)	// FIFO fills sent per measurement
+#define BENCH_CHECK_ROUNDS	(64u)		// Rounds with verified checksums
+#define BENCH_LOCAL_PORT	(10000u)
+#define BENCH_REMOTE_PORT	(40000u)
+
+// The stack modules refer to AppConfig
+APP_CONFIG AppConfig;
+
+static BYTE vData[16384];
+
+// Private helper functions.
+static TCP_SOCKET ConnectSocket(void);
+static DWORD SendRound(TCP_SOCKET hSocket, BOOL bCheck);
+static BOOL CheckSegment(void);
+
+int main(void)
+{
+	TCP_SOCKET hSocket;
+	QWORD qwCycles;
+	DWORD i, dwBytes;
+	double start, dNs;
+
+	// Replay an empty capture: the link is up and nothing is received
+	if(!InitHostReplay())
+		return 1;
+
+	for(i = 0; i < sizeof(vData); i++)
+		vData[i] = (BYTE)LFSRRand();
+
+	TCPInit();
+	hSocket = ConnectSocket();
+
+	for(i = 0; i < BENCH_CHECK_ROUNDS; i++)
+	{
+		if(!SendRound(hSocket, TRUE))
+			return 1;
+	}
+	printf("TCP checksums verified, TCP_CHECKSUM_ON_COPY %u\n", (unsigned)TCP_CHECKSUM_ON_COPY);
+
+	dwBytes = 0;
+	qwCycles = 0;
+	start = NowNs(CLOCK_MONOTONIC);
+	#if defined(__i386__) || defined(__x86_64__)
+	qwCycles = __rdtsc();
+	#endif
+	for(i = 0; i < BENCH_ROUNDS; i++)
+		dwBytes += SendRound(hSocket, FALSE);
+	#if defined(__i386__) || defined(__x86_64__)
+	qwCycles = __rdtsc() - qwCycles;
+	#endif
+	dNs = NowNs(CLOCK_MONOTONIC) - start;
+
+	printf("%lu bytes: %6.3f ns per byte (%6.0f MB/s)", (unsigned long)dwBytes, dNs / dwBytes, dwBytes * 1000.0 / dNs);
+	if(qwCycles)
+		printf(", %6.3f cycles per byte", (double)qwCycles / dwBytes);
+	printf("\n");
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static TCP_SOCKET ConnectSocket(void)
+ *
+ * PreCondition:    TCPInit() has been called.
+ *
+ * Input:           None
+ *
+ * Output:          The connected socket
+ *
+ * Side Effects:    Exits if the socket cannot be opened.
+ *
+ * Overview:        Opens a server socket with a 16 KB TX FIFO and
+ *                  connects it by passing a SYN to FindMatchingSocket().
+ *
+ * Note:            The socket is put in the ESTABLISHED state directly,
+ *                  with the options of a Linux peer.  The send windows
+ *                  are set by SendRound().
+ ********************************************************************/
+static TCP_SOCKET ConnectSocket(void)
+{
+	TCP_SOCKET hTCP;
+	TCP_HEADER header;
+	NODE_INFO remote;
+
+	remote.IPAddr.Val = 0x0101A8C0ul;			// 192.168.1.1
+	memset((void*)&remote.MACAddr, 0x02, sizeof(MAC_ADDR));
+	memset((void*)&header, 0x00, sizeof(header));
+	header.SourcePort = BENCH_REMOTE_PORT;
+	header.DestPort = BENCH_LOCAL_PORT;
+	header.Flags.bits.flagSYN = 1;
+
+	hTCP = TCPOpen(0, TCP_OPEN_SERVER, BENCH_LOCAL_PORT, TCP_PURPOSE_TCP_PERFORMANCE_TX);
+	if(hTCP == INVALID_SOCKET || !FindMatchingSocket(&header, &remote) || hCurrentTCP != hTCP)
+	{
+		printf("cannot connect the TCP socket\n");
+		exit(1);
+	}
+
+	SyncTCB();
+	MyTCBStub.smState = TCP_ESTABLISHED;
+	MyTCB.wRemoteMSS = TCP_MAX_SEG_SIZE_TX - 12u;
+	MyTCB.flags.bTimestamps = 1;
+	MyTCB.flags.bSACK = 1;
+	return hTCP;
+}
+
+/*********************************************************************
+ * Function:        static DWORD SendRound(TCP_SOCKET hSocket, BOOL bCheck)
+ *
+ * PreCondition:    ConnectSocket() has returned hSocket.
+ *
+ * Input:           hSocket - socket to send on
+ *                  bCheck - TRUE to verify the checksum of every segment
+ *
+ * Output:          Number of data bytes sent, 0 if a checksum is wrong
+ *
+ * Side Effects:    Prints the first wrong checksum.
+ *
+ * Overview:        Fills the TX FIFO, sends it with SendTCP() and then
+ *                  acknowledges all of it.
+ *
+ * Note:            The windows are opened wide, so that every segment
+ *                  is full sized.
+ ********************************************************************/
+static DWORD SendRound(TCP_SOCKET hSocket, BOOL bCheck)
+{
+	DWORD dwBytes;
+
+	dwBytes = TCPPutArray(hSocket, vData, TCPIsPutReady(hSocket));
+
+	SyncTCBStub(hSocket);
+	SyncTCB();
+	MyTCB.remoteWindow = 0xFFFF;
+	MyTCB.wCongWindow = 0xFFFF;
+	while(MyTCB.txUnackedTail != MyTCBStub.txHead)
+	{
+		SendTCP(ACK, SENDTCP_RESET_TIMERS);
+		if(bCheck && !CheckSegment())
+			return 0;
+	}
+
+	MyTCBStub.txTail = MyTCB.txUnackedTail;
+	MyTCBStub.Flags.bTimerEnabled = 0;
+	return dwBytes;
+}
+
+/*********************************************************************
+ * Function:        static BOOL CheckSegment(void)
+ *
+ * PreCondition:    A segment has just been written to the TX buffer.
+ *
+ * Input:           None
+ *
+ * Output:          TRUE if its TCP checksum is correct
+ *
+ * Side Effects:    Prints a wrong checksum.
+ *
+ * Overview:        Sums the pseudoheader and the segment in the TX
+ *                  buffer, checksum field included.
+ *
+ * Note:            None
+ ********************************************************************/
+static BOOL CheckSegment(void)
+{
+	static BYTE vSegment[12 + 1500];
+	BYTE* pIP;
+	WORD wLen;
+
+	pIP = (BYTE*)(BASE_TX_ADDR + sizeof(ETHER_HEADER));
+	wLen = (((WORD)pIP[2] << 8) | pIP[3]) - sizeof(IP_HEADER);
+
+	// Source and destination addresses, zero, protocol and TCP length
+	memcpy((void*)vSegment, (void*)&pIP[12], 8);
+	vSegment[8] = 0;
+	vSegment[9] = IP_PROT_TCP;
+	vSegment[10] = (BYTE)(wLen >> 8);
+	vSegment[11] = (BYTE)wLen;
+	memcpy((void*)&vSegment[12], (void*)&pIP[sizeof(IP_HEADER)], wLen);
+
+	if(CalcIPChecksum(vSegment, 12u + wLen) != 0u)
+	{
+		printf("wrong TCP checksum in a %u byte segment\n", wLen);
+		return FALSE;
+	}
+	return TRUE;
+}
@@ -0,0 +1,167 @@
+/*********************************************************************
+ *
+ *  TCP upload throughput versus round trip time benchmark
+ *
+ *********************************************************************
+ * FileName:        UploadBench.c
+ * Dependencies:    TCPIP.h, ETHHost.c
+ * Processor:       Linux host
+ * Compiler:        GCC
+ *
+ * Receives a TCP stream from a client on the Linux side of the TAP and
+ * reports the goodput at several round trip times, as for an HTTP MPFS
+ * upload or an FTP put.  The round trip time is set with the RX delay of
+ * the host MAC (MACHostSetRxDelay()), which holds every received frame
+ * for the given time.
+ *
+ * The client connects to UPLOAD_BENCH_PORT on 192.168.1.2 and sends
+ * until the connection is closed, then connects again, for example:
+ *   python3 -c 'import socket, time
+ *   while True:
+ *     try:
+ *       s = socket.create_connection(("192.168.1.2", 9002), timeout=5)
+ *       while True: s.sendall(bytes(range(251))*256)
+ *     except OSError: time.sleep(0.1)' &
+ * The stream is a byte counter modulo UPLOAD_BENCH_PERIOD, starting at 0
+ * on each connection.  Every byte read is checked against it, so data 
+ * that is reassembled out of place stops the benchmark.  The period is 
+ * prime so that no power of two offset goes unnoticed.
+ *
+ * Build and run:  S=../../Microchip
+ *   gcc -O2 -DHOST_UPLOAD_BENCH -I. -I$S/Include -o uploadbench \
+ *       UploadBench.c HostAppConfig.c \
+ *       "$S/TCPIP Stack/"{StackTsk,ETHHost,Tick,Helpers}.c \
+ *       "$S/TCPIP Stack/"{ARP,IP,ICMP,UDP,TCP}.c \
+ *       "$S/TCPIP Stack/"{TCPPerformanceTest,UDPPerformanceTest}.c
+ *   HOST_MAC_TAP=tap0 ./uploadbench
+ * TCP_MAX_SEG_SIZE_RX, TCP_WINDOW_SCALE and TCP_TIMESTAMPS can be set
+ * with -D to compare, for example -DTCP_MAX_SEG_SIZE_RX=536
+ * -DTCP_WINDOW_SCALE=0 -DTCP_TIMESTAMPS=0 for the options of older
+ * stack versions.
+ ********************************************************************/
+#define THIS_IS_STACK_APPLICATION
+
+#include "TCPIP Stack/TCPIP.h"
+
+#include "HostAppConfig.h"
+
+#include <stdio.h>
+
+#define UPLOAD_BENCH_PORT		(9002u)					// Port the client connects to
+#define UPLOAD_BENCH_TIME		((DWORD)TICK_SECOND*5)	// Duration of each measurement
+#define UPLOAD_BENCH_TIMEOUT	((DWORD)TICK_SECOND*10)	// Give up waiting for the client after this time
+#define UPLOAD_BENCH_PERIOD		(251u)					// Period of the byte counter the client sends
+
+// Round trip times to measure, in ms
+static const WORD wRTTs[] = {0, 1, 2, 5, 10, 20, 50};
+
+// Declare AppConfig structure and some other supporting stack variables
+APP_CONFIG AppConfig;
+
+// Private helper functions.
+static BOOL MeasureGoodput(TCP_SOCKET hSocket, DWORD* pdwBytes, BOOL* pbCorrupt);
+
+int main(void)
+{
+	TCP_SOCKET hSocket;
+	DWORD dwBytes;
+	BOOL bCorrupt;
+	WORD i;
+
+	TickInit();
+	InitAppConfig();
+	StackInit();
+
+	hSocket = TCPOpen(0, TCP_OPEN_SERVER, UPLOAD_BENCH_PORT, TCP_PURPOSE_TCP_PERFORMANCE_RX);
+	if(hSocket == INVALID_SOCKET)
+	{
+		printf("TCPOpen() failed\n");
+		return 1;
+	}
+
+	for(i = 0; i < sizeof(wRTTs)/sizeof(wRTTs[0]); i++)
+	{
+		MACHostSetRxDelay(wRTTs[i] * 1000ul);
+		if(!MeasureGoodput(hSocket, &dwBytes, &bCorrupt))
+		{
+			printf("no client connected to port %u\n", UPLOAD_BENCH_PORT);
+			return 1;
+		}
+		if(bCorrupt)
+		{
+			printf("RTT %2u ms: byte %lu of the stream is wrong\n", wRTTs[i], (unsigned long)dwBytes);
+			return 1;
+		}
+		printf("RTT %2u ms: %8.1f kB/s\n", wRTTs[i],
+			dwBytes * (double)TICK_SECOND / UPLOAD_BENCH_TIME / 1000.0);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * Function:        static BOOL MeasureGoodput(TCP_SOCKET hSocket,
+ *                                             DWORD* pdwBytes,
+ *                                             BOOL* pbCorrupt)
+ *
+ * PreCondition:    StackInit() has been called and hSocket is a
+ *                  listening server socket.
+ *
+ * Input:           hSocket - socket the client connects to
+ *                  pdwBytes - receives the number of bytes read, or
+ *                             the offset of the first wrong byte
+ *                  pbCorrupt - receives TRUE if a byte read is not the
+ *                              one the client sent
+ *
+ * Output:          TRUE if a client connected
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Waits for the client, reads and checks everything
+ *                  it sends for UPLOAD_BENCH_TIME, then disconnects so
+ *                  that the socket listens again.
+ *
+ * Note:            The connection is set up with the current RX delay,
+ *                  so the RTO starts from a measured round trip time.
+ ********************************************************************/
+static BOOL MeasureGoodput(TCP_SOCKET hSocket, DWORD* pdwBytes, BOOL* pbCorrupt)
+{
+	BYTE vData[1024];
+	DWORD dwStart;
+	WORD w, wLen;
+	BYTE vExpected;
+
+	dwStart = TickGet();
+	while(!TCPIsConnected(hSocket))
+	{
+		if(TickGet() - dwStart > UPLOAD_BENCH_TIMEOUT)
+			return FALSE;
+		StackTask();
+	}
+
+	*pdwBytes = 0;
+	*pbCorrupt = FALSE;
+	vExpected = 0;
+	dwStart = TickGet();
+	while(!*pbCorrupt && (TickGet() - dwStart < UPLOAD_BENCH_TIME))
+	{
+		StackTask();
+		while(!*pbCorrupt && ((wLen = TCPGetArray(hSocket, vData, sizeof(vData))) != 0u))
+		{
+			for(w = 0; w < wLen; w++)
+			{
+				if(vData[w] != vExpected)
+				{
+					*pbCorrupt = TRUE;
+					break;
+				}
+				if(++vExpected == UPLOAD_BENCH_PERIOD)
+					vExpected = 0;
+			}
+			*pdwBytes += w;
+		}
+	}
+
+	TCPDisconnect(hSocket);
+	StackTask();
+	return TRUE;
+}